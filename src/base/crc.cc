@@ -0,0 +1,281 @@
+/* <base/crc.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <base/crc.h>.
+ */
+
+#include <base/crc.h>
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define BASE_CRC_X86
+#endif
+
+using namespace Base;
+
+namespace {
+
+  /* Bit reflected generator polynomials. */
+  const uint32_t CRC32_POLY = 0xedb88320;
+
+  const uint32_t CRC32C_POLY = 0x82f63b78;
+
+  /* Lookup tables for slicing by 8.  Table[0] is the usual byte at a time
+     table, and Table[k][b] is the CRC of byte b followed by k zero bytes. */
+  struct TSliceBy8Tables {
+    uint32_t Table[8][256];
+
+    explicit TSliceBy8Tables(uint32_t poly) {
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+
+        for (int j = 0; j < 8; ++j) {
+          crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+        }
+
+        Table[0][i] = crc;
+      }
+
+      for (size_t i = 0; i < 256; ++i) {
+        for (size_t k = 1; k < 8; ++k) {
+          uint32_t prev = Table[k - 1][i];
+          Table[k][i] = (prev >> 8) ^ Table[0][prev & 0xff];
+        }
+      }
+    }
+  };  // TSliceBy8Tables
+
+  const TSliceBy8Tables &GetCrc32Tables() {
+    static const TSliceBy8Tables tables(CRC32_POLY);
+    return tables;
+  }
+
+  const TSliceBy8Tables &GetCrc32cTables() {
+    static const TSliceBy8Tables tables(CRC32C_POLY);
+    return tables;
+  }
+
+  /* Compilers turn this into a single load on little endian CPUs. */
+  inline uint32_t LoadLe32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) |
+        (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) |
+        (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  /* 'crc' is the running CRC state, without the initial and final
+     inversion. */
+  uint32_t SliceBy8Update(const TSliceBy8Tables &tables, uint32_t crc,
+      const uint8_t *p, size_t n) {
+    const uint32_t (&t)[8][256] = tables.Table;
+
+    for (; n >= 8; p += 8, n -= 8) {
+      uint32_t lo = LoadLe32(p) ^ crc;
+      uint32_t hi = LoadLe32(p + 4);
+      crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+          t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+          t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+
+    for (; n; ++p, --n) {
+      crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc;
+  }
+
+#ifdef BASE_CRC_X86
+  bool CpuidEcxHas(unsigned int bits) {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx & bits) == bits);
+  }
+
+  /* Fold 'n' bytes at 'p' into 'crc' using carryless multiplication.  'n'
+     must be at least 64 and a multiple of 16.  This follows Intel's "Fast CRC
+     Computation for Generic Polynomials Using PCLMULQDQ Instruction", with
+     the constants for the bit reflected CRC-32 polynomial. */
+  __attribute__((target("pclmul,sse4.1")))
+  uint32_t PclmulFold(uint32_t crc, const uint8_t *p, size_t n) {
+    const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+    const __m128i k5 = _mm_set_epi64x(0, 0x163cd6124);
+    const __m128i poly_mu = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+    const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+    const __m128i *in = reinterpret_cast<const __m128i *>(p);
+    __m128i x1 = _mm_xor_si128(_mm_loadu_si128(in),
+        _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x2 = _mm_loadu_si128(in + 1);
+    __m128i x3 = _mm_loadu_si128(in + 2);
+    __m128i x4 = _mm_loadu_si128(in + 3);
+    in += 4;
+    n -= 64;
+
+    /* Fold 64 bytes at a time into four 128 bit accumulators. */
+    for (; n >= 64; in += 4, n -= 64) {
+      x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x00),
+          _mm_clmulepi64_si128(x1, k1k2, 0x11)), _mm_loadu_si128(in));
+      x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x00),
+          _mm_clmulepi64_si128(x2, k1k2, 0x11)), _mm_loadu_si128(in + 1));
+      x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x00),
+          _mm_clmulepi64_si128(x3, k1k2, 0x11)), _mm_loadu_si128(in + 2));
+      x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x00),
+          _mm_clmulepi64_si128(x4, k1k2, 0x11)), _mm_loadu_si128(in + 3));
+    }
+
+    /* Fold the four accumulators into one. */
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00),
+        _mm_clmulepi64_si128(x1, k3k4, 0x11)), x2);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00),
+        _mm_clmulepi64_si128(x1, k3k4, 0x11)), x3);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00),
+        _mm_clmulepi64_si128(x1, k3k4, 0x11)), x4);
+
+    /* Fold any remaining 16 byte blocks. */
+    for (; n >= 16; ++in, n -= 16) {
+      x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00),
+          _mm_clmulepi64_si128(x1, k3k4, 0x11)), _mm_loadu_si128(in));
+    }
+
+    /* Reduce 128 bits to 64, then 64 to 32 ... */
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8),
+        _mm_clmulepi64_si128(k3k4, x1, 0x01));
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 4),
+        _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00));
+
+    /* ... and finish with a Barrett reduction. */
+    __m128i t = _mm_and_si128(
+        _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly_mu, 0x10),
+        mask32);
+    x1 = _mm_xor_si128(x1, _mm_clmulepi64_si128(t, poly_mu, 0x00));
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+  }
+
+  __attribute__((target("sse4.2")))
+  uint32_t Sse42Update(uint32_t crc, const uint8_t *p, size_t n) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+
+    for (; n >= 8; p += 8, n -= 8) {
+      uint64_t v = 0;
+      std::memcpy(&v, p, sizeof(v));
+      crc64 = _mm_crc32_u64(crc64, v);
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+#endif
+
+    for (; n >= 4; p += 4, n -= 4) {
+      uint32_t v = 0;
+      std::memcpy(&v, p, sizeof(v));
+      crc = _mm_crc32_u32(crc, v);
+    }
+
+    for (; n; ++p, --n) {
+      crc = _mm_crc32_u8(crc, *p);
+    }
+
+    return crc;
+  }
+#endif  // BASE_CRC_X86
+
+  using TCrcFn = uint32_t (*)(const void *, size_t);
+
+  TCrcFn ChooseCrc32() {
+    return CpuHasPclmul() ? &ComputeCrc32Pclmul : &ComputeCrc32SliceBy8;
+  }
+
+  TCrcFn ChooseCrc32c() {
+    return CpuHasSse42() ? &ComputeCrc32cSse42 : &ComputeCrc32cSliceBy8;
+  }
+
+}  // namespace
+
+uint32_t Base::ComputeCrc32(const void *data, size_t data_size) {
+  static const TCrcFn fn = ChooseCrc32();
+  return fn(data, data_size);
+}
+
+uint32_t Base::ComputeCrc32c(const void *data, size_t data_size) {
+  static const TCrcFn fn = ChooseCrc32c();
+  return fn(data, data_size);
+}
+
+uint32_t Base::ComputeCrc32SliceBy8(const void *data, size_t data_size) {
+  return ~SliceBy8Update(GetCrc32Tables(), 0xffffffff,
+      reinterpret_cast<const uint8_t *>(data), data_size);
+}
+
+bool Base::CpuHasPclmul() {
+#ifdef BASE_CRC_X86
+  static const bool result = CpuidEcxHas(bit_PCLMUL | bit_SSE4_1);
+  return result;
+#else
+  return false;
+#endif
+}
+
+uint32_t Base::ComputeCrc32Pclmul(const void *data, size_t data_size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+  uint32_t crc = 0xffffffff;
+
+#ifdef BASE_CRC_X86
+  if (data_size >= 64) {
+    size_t fold_size = data_size & ~static_cast<size_t>(15);
+    crc = PclmulFold(crc, p, fold_size);
+    p += fold_size;
+    data_size -= fold_size;
+  }
+#endif
+
+  return ~SliceBy8Update(GetCrc32Tables(), crc, p, data_size);
+}
+
+uint32_t Base::ComputeCrc32cSliceBy8(const void *data, size_t data_size) {
+  return ~SliceBy8Update(GetCrc32cTables(), 0xffffffff,
+      reinterpret_cast<const uint8_t *>(data), data_size);
+}
+
+bool Base::CpuHasSse42() {
+#ifdef BASE_CRC_X86
+  static const bool result = CpuidEcxHas(bit_SSE4_2);
+  return result;
+#else
+  return false;
+#endif
+}
+
+uint32_t Base::ComputeCrc32cSse42(const void *data, size_t data_size) {
+#ifdef BASE_CRC_X86
+  return ~Sse42Update(0xffffffff, reinterpret_cast<const uint8_t *>(data),
+      data_size);
+#else
+  return ComputeCrc32cSliceBy8(data, data_size);
+#endif
+}
+
+const char *Base::GetCrc32ImplName() {
+  return CpuHasPclmul() ? "pclmul" : "slice_by_8";
+}
+
+const char *Base::GetCrc32cImplName() {
+  return CpuHasSse42() ? "sse4.2" : "slice_by_8";
+}
@@ -16,21 +16,54 @@
    limitations under the License.
    ----------------------------------------------------------------------------
 
-   Function for computing 32-bit CRC.
+   Functions for computing 32-bit CRCs.  ComputeCrc32() computes the standard
+   CRC-32 (as in zlib and Kafka's v0 and v1 message formats), and
+   ComputeCrc32c() computes CRC-32C (Castagnoli, as in Kafka's v2 record
+   format).  Both choose the fastest implementation the CPU supports the first
+   time they are called.
  */
 
 #pragma once
 
 #include <cstddef>
-
-#include <boost/crc.hpp>
+#include <cstdint>
 
 namespace Base {
 
-  static inline uint32_t ComputeCrc32(const void *data, size_t data_size) {
-    boost::crc_32_type result;
-    result.process_bytes(data, data_size);
-    return result.checksum();
-  }
+  uint32_t ComputeCrc32(const void *data, size_t data_size);
+
+  uint32_t ComputeCrc32c(const void *data, size_t data_size);
+
+  /* The individual implementations are exposed below for unit tests and
+     benchmarks.  Normal callers should use the above functions. */
+
+  /* Portable table driven implementation, processing 8 bytes per step. */
+  uint32_t ComputeCrc32SliceBy8(const void *data, size_t data_size);
+
+  /* Return true if the CPU supports the carryless multiply (PCLMULQDQ) and
+     SSE4.1 instructions that ComputeCrc32Pclmul() requires. */
+  bool CpuHasPclmul();
+
+  /* Folds 64 bytes per step with carryless multiplication, and uses
+     ComputeCrc32SliceBy8() for short inputs and leftover bytes.  Must only be
+     called if CpuHasPclmul() returns true. */
+  uint32_t ComputeCrc32Pclmul(const void *data, size_t data_size);
+
+  /* Portable table driven implementation, processing 8 bytes per step. */
+  uint32_t ComputeCrc32cSliceBy8(const void *data, size_t data_size);
+
+  /* Return true if the CPU supports the SSE4.2 crc32 instruction that
+     ComputeCrc32cSse42() requires. */
+  bool CpuHasSse42();
+
+  /* Uses the SSE4.2 crc32 instruction.  Must only be called if CpuHasSse42()
+     returns true. */
+  uint32_t ComputeCrc32cSse42(const void *data, size_t data_size);
+
+  /* Return a short name for the implementation that ComputeCrc32() or
+     ComputeCrc32c() uses on this CPU (for instance, "pclmul"). */
+  const char *GetCrc32ImplName();
+
+  const char *GetCrc32cImplName();
 
 }  // Base
@@ -0,0 +1,145 @@
+/* <base/crc.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <base/crc.h>.
+ */
+
+#include <base/crc.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <boost/crc.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+
+namespace {
+
+  using TBoostCrc32c =
+      boost::crc_optimal<32, 0x1edc6f41, 0xffffffff, 0xffffffff, true, true>;
+
+  uint32_t BoostCrc32(const void *data, size_t data_size) {
+    boost::crc_32_type result;
+    result.process_bytes(data, data_size);
+    return result.checksum();
+  }
+
+  uint32_t BoostCrc32c(const void *data, size_t data_size) {
+    TBoostCrc32c result;
+    result.process_bytes(data, data_size);
+    return result.checksum();
+  }
+
+  /* Pseudorandom test data, with some slack so every length can be tested
+     at every alignment. */
+  std::vector<uint8_t> MakeData(size_t size) {
+    std::vector<uint8_t> result(size + 16);
+    uint32_t state = 2463534242U;
+
+    for (uint8_t &b : result) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      b = static_cast<uint8_t>(state);
+    }
+
+    return result;
+  }
+
+  /* The fixture for testing CRC functions. */
+  class TCrcTest : public ::testing::Test {
+    protected:
+    TCrcTest() {
+    }
+
+    virtual ~TCrcTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TCrcTest
+
+  TEST_F(TCrcTest, KnownValues) {
+    const char *check = "123456789";
+    size_t len = std::strlen(check);
+    ASSERT_EQ(ComputeCrc32(check, len), 0xcbf43926U);
+    ASSERT_EQ(ComputeCrc32SliceBy8(check, len), 0xcbf43926U);
+    ASSERT_EQ(ComputeCrc32c(check, len), 0xe3069283U);
+    ASSERT_EQ(ComputeCrc32cSliceBy8(check, len), 0xe3069283U);
+    ASSERT_EQ(ComputeCrc32(check, 0), 0U);
+    ASSERT_EQ(ComputeCrc32c(check, 0), 0U);
+  }
+
+  TEST_F(TCrcTest, Crc32MatchesBoost) {
+    std::vector<uint8_t> data = MakeData(4096);
+    bool have_pclmul = CpuHasPclmul();
+
+    for (size_t offset = 0; offset < 16; ++offset) {
+      for (size_t len = 0; len <= 4096;
+           len += ((len < 300) ? 1 : 61)) {
+        const uint8_t *p = &data[offset];
+        uint32_t expected = BoostCrc32(p, len);
+        ASSERT_EQ(ComputeCrc32SliceBy8(p, len), expected) << len;
+        ASSERT_EQ(ComputeCrc32(p, len), expected) << len;
+
+        if (have_pclmul) {
+          ASSERT_EQ(ComputeCrc32Pclmul(p, len), expected) << len;
+        }
+      }
+    }
+  }
+
+  TEST_F(TCrcTest, Crc32cMatchesBoost) {
+    std::vector<uint8_t> data = MakeData(4096);
+    bool have_sse42 = CpuHasSse42();
+
+    for (size_t offset = 0; offset < 16; ++offset) {
+      for (size_t len = 0; len <= 4096;
+           len += ((len < 300) ? 1 : 61)) {
+        const uint8_t *p = &data[offset];
+        uint32_t expected = BoostCrc32c(p, len);
+        ASSERT_EQ(ComputeCrc32cSliceBy8(p, len), expected) << len;
+        ASSERT_EQ(ComputeCrc32c(p, len), expected) << len;
+
+        if (have_sse42) {
+          ASSERT_EQ(ComputeCrc32cSse42(p, len), expected) << len;
+        }
+      }
+    }
+  }
+
+  TEST_F(TCrcTest, ImplNames) {
+    ASSERT_STREQ(GetCrc32ImplName(),
+        CpuHasPclmul() ? "pclmul" : "slice_by_8");
+    ASSERT_STREQ(GetCrc32cImplName(),
+        CpuHasSse42() ? "sse4.2" : "slice_by_8");
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
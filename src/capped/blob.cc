@@ -32,5 +32,6 @@ size_t TBlob::DoGetDataInFirstBlock(char *&data) const {
   }
 
   data = &FirstBlock->Data[0];
-  return (FirstBlock->NextBlock == nullptr) ? LastBlockSize : GetBlockSize();
+  return (FirstBlock->NextBlock == nullptr) ?
+      LastBlockSize : GetBlockSize(FirstBlock);
 }
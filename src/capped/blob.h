@@ -70,12 +70,13 @@ namespace Capped {
     /* No copying allowed. */
     TBlob &operator=(const TBlob &) = delete;
 
-    /* Return the number of bytes in a (full) block.  All blocks except for
-       possibly the last block are full. */
-    size_t GetBlockSize() const {
+    /* Return the number of bytes in the given (full) block.  All blocks
+       except for possibly the last block are full.  Blocks may differ in size
+       if our pool has size classes. */
+    size_t GetBlockSize(const TBlock *block) const {
       assert(this);
       assert(Pool);
-      return Pool->GetDataSize();
+      return Pool->GetDataSize(block);
     }
 
     /* True iff. this blob is non-empty. */
@@ -118,7 +119,8 @@ namespace Capped {
       assert(cb);
 
       for (TBlock *block = FirstBlock; block; block = block->NextBlock) {
-        if (!cb(block->Data, block->NextBlock ? GetBlockSize() : LastBlockSize,
+        if (!cb(block->Data,
+                block->NextBlock ? GetBlockSize(block) : LastBlockSize,
                 context)) {
           return false;
         }
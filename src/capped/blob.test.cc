@@ -98,6 +98,51 @@ namespace {
     ASSERT_EQ(strcmp(str, Str), 0);
   }
 
+  TEST_F(TBlobTest, SizeClasses) {
+    TPool pool(64, 256, 4096, TPool::TSync::Unguarded);
+    string expected;
+
+    for (size_t i = 0; i < 20; ++i) {
+      expected += Str;
+    }
+
+    /* Without reserving, each write fills the last chunk and then gets more,
+       so the blob has chunks of different sizes. */
+    TWriter writer(&pool);
+
+    for (size_t i = 0; i < 20; ++i) {
+      writer.Write(Str, StrSize);
+    }
+
+    TBlob blob = writer.DraftBlob();
+    ASSERT_EQ(blob.Size(), expected.size());
+    ASSERT_EQ(ToString(blob), expected);
+    string read_back(expected.size(), ' ');
+    TReader reader(&blob);
+    reader.Read(&read_back[0], read_back.size());
+    ASSERT_FALSE(reader);
+    ASSERT_EQ(read_back, expected);
+    blob.Reset();
+
+    /* Reserved space that isn't written to goes back to the pool. */
+    writer.Reserve(1000);
+    writer.Write(Str, StrSize);
+    blob = writer.DraftBlob();
+    ASSERT_EQ(ToString(blob), Str);
+    size_t in_use_bytes = 0;
+    size_t max_bytes = 0;
+    pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(in_use_bytes, 256U);
+    blob.Reset();
+
+    /* Reserving without writing makes an empty blob. */
+    writer.Reserve(10);
+    blob = writer.DraftBlob();
+    ASSERT_FALSE(blob);
+    pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(in_use_bytes, 0U);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -21,7 +21,10 @@
 
 #include <capped/pool.h>
 
+#include <algorithm>
+#include <atomic>
 #include <new>
+#include <unordered_set>
 #include <utility>
 
 #include <base/error_utils.h>
@@ -30,9 +33,50 @@ using namespace std;
 using namespace Base;
 using namespace Capped;
 
+const size_t TPool::MAGAZINE_MAX_BLOCKS;
+
+const size_t TPool::MAGAZINE_MAX_BYTES;
+
+static std::atomic<uint64_t> NextPoolId(1);
+
+/* IDs of live pools that use magazines. */
+static std::mutex &LivePoolIdsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+static std::unordered_set<uint64_t> &LivePoolIds() {
+  static std::unordered_set<uint64_t> ids;
+  return ids;
+}
+
+static void RegisterPoolId(uint64_t id) {
+  std::lock_guard<std::mutex> lock(LivePoolIdsMutex());
+  LivePoolIds().insert(id);
+}
+
+static void UnregisterPoolId(uint64_t id) noexcept {
+  std::lock_guard<std::mutex> lock(LivePoolIdsMutex());
+  LivePoolIds().erase(id);
+}
+
+static size_t RoundUpToPowerOf2(size_t n) noexcept {
+  size_t result = 1;
+
+  while (result < n) {
+    result <<= 1;
+  }
+
+  return result;
+}
+
 TPool::TPool(size_t block_size, size_t block_count, TSync sync_policy)
     : BlockSize(max(block_size, sizeof(TBlock))), BlockCount(block_count),
-      Guarded(sync_policy != TSync::Unguarded), FirstFreeBlock(nullptr) {
+      ChunkOverhead(GetBlockOverhead()),
+      Guarded(sync_policy != TSync::Unguarded),
+      ThreadCached(sync_policy == TSync::ThreadCached), Id(NextPoolId++),
+      FirstFreeBlock(nullptr), FreeBlockCount(block_count), MaxBytes(0),
+      HeldBytes(0) {
   /* Allocate enough storage space for all our blocks. */
   size_t size = BlockSize * BlockCount;
   Storage = new char[size];
@@ -41,15 +85,87 @@ TPool::TPool(size_t block_size, size_t block_count, TSync sync_policy)
   for (char *ptr = Storage; ptr < Storage + size; ptr += BlockSize) {
     new (ptr) TBlock(FirstFreeBlock);
   }
+
+  if (ThreadCached) {
+    RegisterPoolId(Id);
+  }
+}
+
+TPool::TPool(size_t min_chunk_size, size_t max_chunk_size, size_t max_bytes,
+    TSync sync_policy)
+    : BlockSize(RoundUpToPowerOf2(max(max_chunk_size,
+          CHUNK_HEADER_SIZE + sizeof(TBlock)))),
+      BlockCount(max_bytes / BlockSize),
+      ChunkOverhead(CHUNK_HEADER_SIZE + GetBlockOverhead()),
+      Guarded(sync_policy != TSync::Unguarded),
+      ThreadCached(sync_policy == TSync::ThreadCached), Id(NextPoolId++),
+      FirstFreeBlock(nullptr), FreeBlockCount(0), Storage(nullptr),
+      MaxBytes(max_bytes), HeldBytes(0) {
+  for (size_t chunk_size = RoundUpToPowerOf2(max(min_chunk_size,
+           CHUNK_HEADER_SIZE + sizeof(TBlock)));
+       chunk_size <= BlockSize;
+       chunk_size <<= 1) {
+    SizeClasses.push_back({chunk_size, nullptr, 0, 0});
+  }
+
+  if (ThreadCached) {
+    RegisterPoolId(Id);
+  }
 }
 
 TPool::~TPool() noexcept {
   assert(this);
-  delete [] Storage;
+
+  if (ThreadCached) {
+    UnregisterPoolId(Id);
+  }
+
+  if (Storage) {
+    delete [] Storage;
+    return;
+  }
+
+  for (TSizeClass &size_class : SizeClasses) {
+    while (size_class.FirstFreeChunk) {
+      TBlock *chunk = TBlock::Unlink(size_class.FirstFreeChunk);
+      operator delete(reinterpret_cast<char *>(chunk) - CHUNK_HEADER_SIZE);
+    }
+  }
+
+  for (TMagazine &magazine : Magazines) {
+    for (TFreeList &list : magazine.Lists) {
+      while (list.First) {
+        TBlock *chunk = TBlock::Unlink(list.First);
+        operator delete(reinterpret_cast<char *>(chunk) - CHUNK_HEADER_SIZE);
+      }
+    }
+  }
 }
 
 void *TPool::Alloc() {
   assert(this);
+  assert(Storage);
+
+  if (ThreadCached) {
+    TMagazine &magazine = GetMagazine();
+
+    {
+      std::lock_guard<std::mutex> lock(magazine.Mutex);
+
+      if (FillMagazine(magazine, 0, 1)) {
+        TFreeList &list = magazine.Lists[0];
+        --list.Count;
+        magazine.UpdateHeldCount();
+        return TBlock::Unlink(list.First);
+      }
+
+      magazine.UpdateHeldCount();
+    }
+
+    /* Other threads may be holding the free blocks we need. */
+    DrainMagazines();
+  }
+
   TOpt<std::lock_guard<std::mutex>> opt_lock;
 
   if (Guarded) {
@@ -62,13 +178,39 @@ void *TPool::Alloc() {
     throw TMemoryCapReached();
   }
 
+  --FreeBlockCount;
   return TBlock::Unlink(FirstFreeBlock);
 }
 
 TPool::TBlock *TPool::AllocList(size_t block_count) {
   assert(this);
+  assert(Storage);
   TBlock *first_block = nullptr;
 
+  if (block_count && ThreadCached) {
+    TMagazine &magazine = GetMagazine();
+
+    {
+      std::lock_guard<std::mutex> lock(magazine.Mutex);
+
+      if (FillMagazine(magazine, 0, block_count)) {
+        TFreeList &list = magazine.Lists[0];
+        list.Count -= block_count;
+        magazine.UpdateHeldCount();
+
+        for (; block_count; --block_count) {
+          TBlock::Unlink(list.First)->Link(first_block);
+        }
+
+        return first_block;
+      }
+
+      magazine.UpdateHeldCount();
+    }
+
+    DrainMagazines();
+  }
+
   if (block_count) {
     TOpt<std::lock_guard<std::mutex>> opt_lock;
 
@@ -86,16 +228,120 @@ TPool::TBlock *TPool::AllocList(size_t block_count) {
       }
 
       TBlock::Unlink(FirstFreeBlock)->Link(first_block);
+      --FreeBlockCount;
     }
   }
 
   return first_block;
 }
 
+TPool::TBlock *TPool::AllocChunks(size_t size) {
+  assert(this);
+
+  if (SizeClasses.empty()) {
+    size_t data_size = GetDataSize();
+    return AllocList((size + data_size - 1) / data_size);
+  }
+
+  TBlock *first_chunk = nullptr;
+
+  if (size == 0) {
+    return first_chunk;
+  }
+
+  size_t max_data_size = BlockSize - ChunkOverhead;
+  size_t full_count = size / max_data_size;
+  size_t tail_size = size % max_data_size;
+
+  if (ThreadCached) {
+    size_t top_class = SizeClasses.size() - 1;
+    size_t tail_class = tail_size ? FindSizeClass(tail_size) : top_class;
+    size_t top_count = full_count;
+
+    if (tail_size && (tail_class == top_class)) {
+      ++top_count;
+    }
+
+    TMagazine &magazine = GetMagazine();
+
+    {
+      std::lock_guard<std::mutex> lock(magazine.Mutex);
+
+      if (FillMagazine(magazine, top_class, top_count) &&
+          ((tail_class == top_class) ||
+           FillMagazine(magazine, tail_class, 1))) {
+        if (tail_size) {
+          TFreeList &list = magazine.Lists[tail_class];
+          --list.Count;
+          first_chunk = TBlock::Unlink(list.First);
+          first_chunk->NextBlock = nullptr;
+        }
+
+        TFreeList &list = magazine.Lists[top_class];
+        list.Count -= full_count;
+        magazine.UpdateHeldCount();
+
+        for (; full_count; --full_count) {
+          TBlock::Unlink(list.First)->Link(first_chunk);
+        }
+
+        return first_chunk;
+      }
+
+      magazine.UpdateHeldCount();
+    }
+
+    DrainMagazines();
+  }
+
+  TOpt<std::lock_guard<std::mutex>> opt_lock;
+
+  if (Guarded) {
+    opt_lock.MakeKnown(Mutex);
+  }
+
+  /* Allocate the tail chunk first, since chunks are linked at the head of
+     the list and it must come last. */
+  if (tail_size) {
+    first_chunk = DoAllocChunk(FindSizeClass(tail_size));
+
+    if (!first_chunk) {
+      throw TMemoryCapReached();
+    }
+
+    first_chunk->NextBlock = nullptr;
+  }
+
+  for (; full_count; --full_count) {
+    TBlock *chunk = DoAllocChunk(SizeClasses.size() - 1);
+
+    if (!chunk) {
+      if (first_chunk) {
+        DoFreeList(first_chunk);
+      }
+
+      throw TMemoryCapReached();
+    }
+
+    chunk->Link(first_chunk);
+  }
+
+  return first_chunk;
+}
+
 void TPool::Free(void *ptr) noexcept {
   assert(this);
 
   if (ptr) {
+    if (ThreadCached) {
+      TBlock *block = nullptr;
+      new (ptr) TBlock(block);
+      TMagazine &magazine = GetMagazine();
+      std::lock_guard<std::mutex> lock(magazine.Mutex);
+      PutInMagazine(magazine, block);
+      return;
+    }
+
     TOpt<std::lock_guard<std::mutex>> opt_lock;
 
     if (Guarded) {
@@ -113,6 +359,13 @@ void TPool::FreeList(TBlock *first_block) {
     return;
   }
 
+  if (ThreadCached) {
+    TMagazine &magazine = GetMagazine();
+    std::lock_guard<std::mutex> lock(magazine.Mutex);
+    PutInMagazine(magazine, first_block);
+    return;
+  }
+
   TOpt<std::lock_guard<std::mutex>> opt_lock;
 
   if (Guarded) {
@@ -122,12 +375,356 @@ void TPool::FreeList(TBlock *first_block) {
   DoFreeList(first_block);
 }
 
+std::vector<TPool::TSizeClassStats> TPool::GetStats(size_t &in_use_bytes,
+    size_t &max_bytes) const {
+  assert(this);
+  std::vector<TSizeClassStats> result;
+
+  /* Count the blocks in magazines.  Blocks may move between the magazines
+     and the shared free lists while we look, so the result is approximate
+     when other threads are busy. */
+  std::vector<size_t> cached(SizeClasses.empty() ? 1 : SizeClasses.size(), 0);
+
+  if (ThreadCached) {
+    std::lock_guard<std::mutex> magazines_lock(MagazinesMutex);
+
+    for (const TMagazine &magazine : Magazines) {
+      std::lock_guard<std::mutex> lock(magazine.Mutex);
+
+      for (size_t i = 0; i < cached.size(); ++i) {
+        cached[i] += magazine.Lists[i].Count;
+      }
+    }
+  }
+
+  TOpt<std::lock_guard<std::mutex>> opt_lock;
+
+  if (Guarded) {
+    opt_lock.MakeKnown(Mutex);
+  }
+
+  if (SizeClasses.empty()) {
+    size_t free_count = std::min(BlockCount, FreeBlockCount + cached[0]);
+    result.push_back({BlockSize, BlockCount - free_count, free_count});
+    in_use_bytes = (BlockCount - free_count) * BlockSize;
+    max_bytes = BlockCount * BlockSize;
+    return result;
+  }
+
+  in_use_bytes = 0;
+
+  for (size_t i = 0; i < SizeClasses.size(); ++i) {
+    const TSizeClass &size_class = SizeClasses[i];
+    size_t cached_count = std::min(size_class.InUseCount, cached[i]);
+    size_t in_use_count = size_class.InUseCount - cached_count;
+    result.push_back({size_class.ChunkSize, in_use_count,
+        size_class.FreeCount + cached_count});
+    in_use_bytes += in_use_count * size_class.ChunkSize;
+  }
+
+  max_bytes = MaxBytes;
+  return result;
+}
+
+size_t TPool::FindSizeClass(size_t size) const noexcept {
+  assert(this);
+  assert(!SizeClasses.empty());
+  assert(size <= (BlockSize - ChunkOverhead));
+  size_t i = 0;
+
+  while ((SizeClasses[i].ChunkSize - ChunkOverhead) < size) {
+    ++i;
+    assert(i < SizeClasses.size());
+  }
+
+  return i;
+}
+
+TPool::TBlock *TPool::DoAllocChunk(size_t size_class) {
+  assert(this);
+  assert(size_class < SizeClasses.size());
+  TSizeClass &sc = SizeClasses[size_class];
+
+  if (sc.FirstFreeChunk) {
+    --sc.FreeCount;
+    ++sc.InUseCount;
+    return TBlock::Unlink(sc.FirstFreeChunk);
+  }
+
+  if ((HeldBytes + sc.ChunkSize) > MaxBytes) {
+    ReleaseCachedChunks(sc.ChunkSize);
+
+    if ((HeldBytes + sc.ChunkSize) > MaxBytes) {
+      return nullptr;
+    }
+  }
+
+  char *mem = static_cast<char *>(operator new(sc.ChunkSize));
+  *reinterpret_cast<size_t *>(mem) = size_class;
+  TBlock *chunk = nullptr;
+  new (mem + CHUNK_HEADER_SIZE) TBlock(chunk);
+  HeldBytes += sc.ChunkSize;
+  ++sc.InUseCount;
+  return chunk;
+}
+
+void TPool::ReleaseCachedChunks(size_t size) noexcept {
+  assert(this);
+
+  for (size_t i = SizeClasses.size(); i; ) {
+    --i;
+    TSizeClass &sc = SizeClasses[i];
+
+    while (sc.FirstFreeChunk) {
+      if ((HeldBytes + size) <= MaxBytes) {
+        return;
+      }
+
+      TBlock *chunk = TBlock::Unlink(sc.FirstFreeChunk);
+      --sc.FreeCount;
+      HeldBytes -= sc.ChunkSize;
+      operator delete(reinterpret_cast<char *>(chunk) - CHUNK_HEADER_SIZE);
+    }
+  }
+}
+
+struct TPool::TThreadMagazines final {
+  NO_COPY_SEMANTICS(TThreadMagazines);
+
+  struct TItem final {
+    uint64_t PoolId;
+
+    TPool *Pool;
+
+    TMagazine *Magazine;
+  };  // TItem
+
+  /* Maps pool IDs to the thread's magazines.  Threads use few pools, so a
+     linear search is fine.  Entries for destroyed pools are never matched
+     again, since pool IDs aren't reused.  They are pruned when the thread
+     first uses another pool, so the map holds at most one entry per live
+     pool plus the one being added. */
+  std::vector<TItem> Items;
+
+  TThreadMagazines() = default;
+
+  ~TThreadMagazines() noexcept {
+    /* Holding the registry lock keeps each live pool from being destroyed
+       while we release its magazine. */
+    std::lock_guard<std::mutex> lock(LivePoolIdsMutex());
+    const std::unordered_set<uint64_t> &live = LivePoolIds();
+
+    for (const TItem &item : Items) {
+      if (live.count(item.PoolId)) {
+        item.Pool->ReleaseMagazine(*item.Magazine);
+      }
+    }
+  }
+};  // TPool::TThreadMagazines
+
+TPool::TMagazine &TPool::GetMagazine() {
+  assert(this);
+  assert(ThreadCached);
+  static thread_local TThreadMagazines thread_magazines;
+  std::vector<TThreadMagazines::TItem> &magazine_map = thread_magazines.Items;
+
+  for (const TThreadMagazines::TItem &item : magazine_map) {
+    if (item.PoolId == Id) {
+      return *item.Magazine;
+    }
+  }
+
+  TMagazine *magazine = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(MagazinesMutex);
+    Magazines.emplace_back(SizeClasses.empty() ? 1 : SizeClasses.size());
+    magazine = &Magazines.back();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(LivePoolIdsMutex());
+    const std::unordered_set<uint64_t> &live = LivePoolIds();
+    magazine_map.erase(std::remove_if(magazine_map.begin(),
+        magazine_map.end(),
+        [&live](const TThreadMagazines::TItem &item) {
+          return (live.count(item.PoolId) == 0);
+        }), magazine_map.end());
+  }
+
+  magazine_map.push_back({Id, this, magazine});
+  return *magazine;
+}
+
+void TPool::ReleaseMagazine(TMagazine &magazine) noexcept {
+  assert(this);
+  assert(ThreadCached);
+  std::lock_guard<std::mutex> magazines_lock(MagazinesMutex);
+
+  {
+    std::lock_guard<std::mutex> magazine_lock(magazine.Mutex);
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    for (TFreeList &list : magazine.Lists) {
+      for (; list.First; --list.Count) {
+        DoFree(TBlock::Unlink(list.First));
+      }
+    }
+
+    magazine.UpdateHeldCount();
+  }
+
+  for (auto iter = Magazines.begin(); iter != Magazines.end(); ++iter) {
+    if (&*iter == &magazine) {
+      Magazines.erase(iter);
+      break;
+    }
+  }
+}
+
+size_t TPool::GetMagazineLimit(size_t size_class) const noexcept {
+  assert(this);
+  size_t chunk_size = SizeClasses.empty() ?
+      BlockSize : SizeClasses[size_class].ChunkSize;
+  return std::max<size_t>(2,
+      std::min(MAGAZINE_MAX_BLOCKS, MAGAZINE_MAX_BYTES / chunk_size));
+}
+
+bool TPool::FillMagazine(TMagazine &magazine, size_t size_class,
+    size_t count) {
+  assert(this);
+  TFreeList &list = magazine.Lists[size_class];
+
+  if (list.Count >= count) {
+    return true;
+  }
+
+  /* Take what we need now, plus half a magazine for later. */
+  size_t want = (count - list.Count) + (GetMagazineLimit(size_class) / 2);
+  std::lock_guard<std::mutex> lock(Mutex);
+
+  if (SizeClasses.empty()) {
+    for (; want && FirstFreeBlock; --want) {
+      TBlock::Unlink(FirstFreeBlock)->Link(list.First);
+      --FreeBlockCount;
+      ++list.Count;
+    }
+
+    return (list.Count >= count);
+  }
+
+  /* Take cached chunks first, and only allocate as many new ones as we need
+     right now. */
+  for (TSizeClass &sc = SizeClasses[size_class];
+       want && sc.FirstFreeChunk;
+       --want) {
+    DoAllocChunk(size_class)->Link(list.First);
+    ++list.Count;
+  }
+
+  while (list.Count < count) {
+    TBlock *chunk = DoAllocChunk(size_class);
+
+    if (!chunk) {
+      return false;
+    }
+
+    chunk->Link(list.First);
+    ++list.Count;
+  }
+
+  return true;
+}
+
+void TPool::PutInMagazine(TMagazine &magazine, TBlock *first_block) noexcept {
+  assert(this);
+  assert(first_block);
+  bool flush = false;
+
+  do {
+    TBlock *block = TBlock::Unlink(first_block);
+    size_t size_class = SizeClasses.empty() ? 0 : GetSizeClass(block);
+    TFreeList &list = magazine.Lists[size_class];
+    block->Link(list.First);
+
+    if (++list.Count > GetMagazineLimit(size_class)) {
+      flush = true;
+    }
+  } while (first_block);
+
+  if (flush) {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    for (size_t i = 0; i < magazine.Lists.size(); ++i) {
+      TFreeList &list = magazine.Lists[i];
+      size_t limit = GetMagazineLimit(i);
+
+      if (list.Count > limit) {
+        for (; list.Count > (limit / 2); --list.Count) {
+          DoFree(TBlock::Unlink(list.First));
+        }
+      }
+    }
+  }
+
+  magazine.UpdateHeldCount();
+}
+
+void TPool::DrainMagazines() noexcept {
+  assert(this);
+  TBlock *first_block = nullptr;
+
+  {
+    std::lock_guard<std::mutex> magazines_lock(MagazinesMutex);
+
+    for (TMagazine &magazine : Magazines) {
+      /* Under memory pressure, allocations keep failing and draining.  Skip
+         magazines that are already empty rather than taking their locks
+         each time.  A block freed into one just after we look is missed,
+         the same as one freed just after we drain it. */
+      if (magazine.HeldCount.load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+
+      std::lock_guard<std::mutex> lock(magazine.Mutex);
+
+      for (TFreeList &list : magazine.Lists) {
+        while (list.First) {
+          TBlock::Unlink(list.First)->Link(first_block);
+        }
+
+        list.Count = 0;
+      }
+
+      magazine.UpdateHeldCount();
+    }
+  }
+
+  if (first_block) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    DoFreeList(first_block);
+  }
+}
+
 void TPool::DoFree(void *ptr) noexcept {
   assert(this);
   assert(ptr);
-  assert(Storage <= ptr);
-  assert(ptr < Storage + BlockSize * BlockCount);
-  new (ptr) TBlock(FirstFreeBlock);
+
+  if (SizeClasses.empty()) {
+    assert(Storage <= ptr);
+    assert(ptr < Storage + BlockSize * BlockCount);
+    new (ptr) TBlock(FirstFreeBlock);
+    ++FreeBlockCount;
+    return;
+  }
+
+  /* Keep the chunk cached for reuse.  It still counts against the cap, and
+     is given back to the heap if another size class needs the room. */
+  TSizeClass &sc = SizeClasses[GetSizeClass(static_cast<TBlock *>(ptr))];
+  assert(sc.InUseCount);
+  --sc.InUseCount;
+  new (ptr) TBlock(sc.FirstFreeChunk);
+  ++sc.FreeCount;
 }
 
 void TPool::DoFreeList(TBlock *first_block) {
@@ -21,9 +21,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <list>
 #include <mutex>
+#include <vector>
 
 #include <base/no_copy_semantics.h>
 #include <base/opt.h>
@@ -31,14 +35,39 @@
 
 namespace Capped {
 
-  /* A pool of storage blocks with capped memory usage. */
+  /* A pool of storage blocks with capped memory usage.  The pool works in one
+     of two modes, chosen by the constructor.  In fixed block mode, all blocks
+     have the same size and are carved out of storage allocated up front.  In
+     size class mode, chunks come in power-of-two size classes and are
+     allocated from the heap as needed, with a single cap on the total bytes
+     held by all classes.  This lets a blob use one or a few right-sized
+     chunks rather than many small blocks or one mostly empty block.  In both
+     modes, a chunk list is a list of TBlock, and GetDataSize(block) gives the
+     capacity of each.
+
+     With TSync::ThreadCached, each thread that uses the pool gets a magazine
+     of free blocks with its own lock, which only that thread normally takes.
+     Allocations are served from the magazine, which is refilled in bulk
+     from the shared free lists under the pool mutex.  Frees go to the
+     magazine, and when it gets too full, half of it is flushed in bulk to the
+     shared free lists.  Blocks in magazines are still free blocks of the
+     pool, so the cap is exact.  If an allocation can't be satisfied from the
+     magazine and the shared free lists, all magazines are drained into the
+     shared free lists before giving up, so blocks cached by other threads
+     are never lost to the cap.  Draining skips empty magazines, so repeated
+     failures under memory pressure don't keep taking every magazine lock.
+     When a thread exits, its magazines are flushed to the shared free lists
+     and destroyed, so threads that come and go don't strand blocks. */
   class TPool final {
     NO_COPY_SEMANTICS(TPool);
 
     public:
-    enum class TSync : bool {
-      Unguarded = false,
-      Mutexed = true
+    enum class TSync {
+      Unguarded,
+      Mutexed,
+
+      /* Mutexed, with per-thread magazines of free blocks. */
+      ThreadCached
     };  // TSync
 
     /* This structure sits at the start of each block of free storage. */
@@ -81,27 +110,56 @@ namespace Capped {
       char Data[sizeof(void *)];
     };  // TPool::TBlock
 
+    /* Occupancy of one size class. */
+    struct TSizeClassStats final {
+      /* Size in bytes of each chunk, including overhead. */
+      size_t ChunkSize;
+
+      /* Number of chunks allocated to callers. */
+      size_t InUseCount;
+
+      /* Number of chunks cached by the pool for reuse. */
+      size_t FreeCount;
+    };  // TSizeClassStats
+
     /* Return the number of bytes of overhead contained in a block.  This is
-       the block size minus the amount of actual storage space in the block. */
+       the block size minus the amount of actual storage space in the block.
+       Chunks in size class mode have additional overhead. */
     static size_t GetBlockOverhead() {
       return sizeof(void *);
     }
 
-    /* Construct a pool which will hold the given number of blocks, each of
-       which is of the given size.  */
+    /* Construct a pool in fixed block mode which will hold the given number
+       of blocks, each of which is of the given size.  */
     TPool(size_t block_size, size_t block_count, TSync sync_policy);
 
+    /* Construct a pool in size class mode.  Chunk sizes are powers of two
+       from 'min_chunk_size' to 'max_chunk_size', which are rounded up to
+       powers of two if necessary.  At most 'max_bytes' bytes of chunks
+       (including overhead) are held at once, whether allocated to callers or
+       cached for reuse. */
+    TPool(size_t min_chunk_size, size_t max_chunk_size, size_t max_bytes,
+        TSync sync_policy);
+
     /* Free all storage.  Make sure no one is using our storage before this
        happens. */
     ~TPool() noexcept;
 
-    /* Allocate a block of storage, or throw TMemoryCapReached if we're out. */
+    /* Allocate a block of storage, or throw TMemoryCapReached if we're out.
+       Fixed block mode only. */
     void *Alloc();
 
     /* Allocate a linked list of blocks, or throw TMemoryCapReached we don't
-       have enough. */
+       have enough.  Fixed block mode only. */
     TBlock *AllocList(size_t block_count);
 
+    /* Allocate a linked list of chunks with a total data capacity of at
+       least 'size' bytes, or throw TMemoryCapReached if we don't have enough.
+       In size class mode, all chunks but the last are of the largest class,
+       and the last is the smallest class that holds the rest.  Returns null
+       if 'size' is 0. */
+    TBlock *AllocChunks(size_t size);
+
     /* Return a block of storage to the pool.  It's safe to free a null
        pointer, we just do nothing. */
     void Free(void *ptr) noexcept;
@@ -110,25 +168,176 @@ namespace Capped {
        list, we just do nothing. */
     void FreeList(TBlock *first_block);
 
-    /* The size of the data field in each block. */
+    /* The size of the data field in each block.  In size class mode, this
+       is for a chunk of the largest class. */
     size_t GetDataSize() const {
       assert(this);
-      return BlockSize - GetBlockOverhead();;
+      return BlockSize - ChunkOverhead;
     }
 
-    /* The number of blocks in the whole pool, free and allocated. */
+    /* The size of the data field in the given block, which must come from
+       this pool. */
+    size_t GetDataSize(const TBlock *block) const noexcept {
+      assert(this);
+      assert(block);
+
+      if (SizeClasses.empty()) {
+        return BlockSize - ChunkOverhead;
+      }
+
+      return SizeClasses[GetSizeClass(block)].ChunkSize - ChunkOverhead;
+    }
+
+    /* The number of blocks in the whole pool, free and allocated.  In size
+       class mode, this is the number of chunks of the largest class that
+       would fit under the cap. */
     size_t GetBlockCount() const {
       assert(this);
       return BlockCount;
     }
 
-    /* The size of each block, in bytes. */
+    /* The size of each block, in bytes.  In size class mode, this is the size
+       of a chunk of the largest class. */
     size_t GetBlockSize() const {
       assert(this);
       return BlockSize;
     }
 
+    bool HasSizeClasses() const noexcept {
+      assert(this);
+      return !SizeClasses.empty();
+    }
+
+    /* Return the number of live threads that have a magazine for this pool.
+     */
+    size_t GetMagazineCount() const {
+      assert(this);
+      std::lock_guard<std::mutex> lock(MagazinesMutex);
+      return Magazines.size();
+    }
+
+    /* Return the occupancy of each size class, smallest first.  In fixed
+       block mode, there is a single class.  Also return the number of bytes
+       allocated to callers, and the cap. */
+    std::vector<TSizeClassStats> GetStats(size_t &in_use_bytes,
+        size_t &max_bytes) const;
+
     private:
+    /* A list of free blocks of one size class. */
+    struct TFreeList final {
+      TBlock *First;
+
+      size_t Count;
+
+      TFreeList() noexcept
+          : First(nullptr), Count(0) {
+      }
+    };  // TFreeList
+
+    /* A thread's cache of free blocks, with one list per size class (or a
+       single list in fixed block mode).  Lock ordering is 'MagazinesMutex',
+       then a magazine's 'Mutex', then the pool's 'Mutex'. */
+    struct TMagazine final {
+      mutable std::mutex Mutex;
+
+      std::vector<TFreeList> Lists;
+
+      /* Total count of blocks in 'Lists'.  Only written while holding
+         'Mutex', but read without it by DrainMagazines(). */
+      std::atomic<size_t> HeldCount;
+
+      explicit TMagazine(size_t list_count)
+          : Lists(list_count), HeldCount(0) {
+      }
+
+      /* Caller must hold 'Mutex'.  Update 'HeldCount' after changing
+         'Lists'. */
+      void UpdateHeldCount() noexcept {
+        size_t count = 0;
+
+        for (const TFreeList &list : Lists) {
+          count += list.Count;
+        }
+
+        HeldCount.store(count, std::memory_order_relaxed);
+      }
+    };  // TMagazine
+
+    /* Max number of blocks and bytes a magazine holds for one size class.
+       When it holds more, it is flushed down to half the limit. */
+    static const size_t MAGAZINE_MAX_BLOCKS = 64;
+
+    static const size_t MAGAZINE_MAX_BYTES = 64 * 1024;
+
+    /* Per size class state. */
+    struct TSizeClass final {
+      size_t ChunkSize;
+
+      /* The first cached chunk, or null if there are none. */
+      TBlock *FirstFreeChunk;
+
+      size_t FreeCount;
+
+      /* Chunks allocated to callers or held in magazines. */
+      size_t InUseCount;
+    };  // TSizeClass
+
+    /* In size class mode, each chunk starts with a header holding its size
+       class index, followed by the TBlock.  This keeps the TBlock suitably
+       aligned. */
+    static const size_t CHUNK_HEADER_SIZE = 2 * sizeof(void *);
+
+    static size_t GetSizeClass(const TBlock *block) noexcept {
+      return *reinterpret_cast<const size_t *>(
+          reinterpret_cast<const char *>(block) - CHUNK_HEADER_SIZE);
+    }
+
+    /* Return the index of the smallest size class with at least 'size' bytes
+       of data capacity, which must not exceed that of the largest class. */
+    size_t FindSizeClass(size_t size) const noexcept;
+
+    /* Size class mode only.  Caller must hold the mutex if 'Guarded' is
+       true.  Take a chunk of the given class from the cache or the heap,
+       returning null if the cap has been reached. */
+    TBlock *DoAllocChunk(size_t size_class);
+
+    /* Size class mode only.  Caller must hold the mutex if 'Guarded' is
+       true.  Give cached chunks back to the heap, largest first, until there
+       is room for 'size' more bytes under the cap or the cache is empty. */
+    void ReleaseCachedChunks(size_t size) noexcept;
+
+    /* Owns the calling thread's magazines for all pools, and releases them
+       when the thread exits. */
+    struct TThreadMagazines;
+
+    /* Return the magazine of the calling thread, creating it if needed. */
+    TMagazine &GetMagazine();
+
+    /* Caller must not hold any magazine mutex or the pool mutex.  Flush
+       'magazine' to the shared free lists and destroy it.  Called when the
+       thread that owns it exits. */
+    void ReleaseMagazine(TMagazine &magazine) noexcept;
+
+    /* Return the max number of blocks a magazine holds for the given class.
+     */
+    size_t GetMagazineLimit(size_t size_class) const noexcept;
+
+    /* Caller must hold the magazine's mutex, but not the pool mutex.  Make
+       sure the magazine's list for the given class has at least 'count'
+       blocks, refilling it from the shared free lists if needed.  Returns
+       false if there aren't enough. */
+    bool FillMagazine(TMagazine &magazine, size_t size_class, size_t count);
+
+    /* Caller must hold the magazine's mutex, but not the pool mutex.  Put a
+       list of blocks in the magazine, flushing to the shared free lists if it
+       gets too full. */
+    void PutInMagazine(TMagazine &magazine, TBlock *first_block) noexcept;
+
+    /* Caller must not hold any magazine mutex or the pool mutex.  Move the
+       contents of all magazines to the shared free lists.  Empty magazines
+       aren't locked. */
+    void DrainMagazines() noexcept;
+
     /* Similar to Free() but mutex is not acquired.  Assumes that 'ptr' is not
        null. */
     void DoFree(void *ptr) noexcept;
@@ -140,21 +349,49 @@ namespace Capped {
     /* See accessors. */
     const size_t BlockSize, BlockCount;
 
+    /* Bytes in a block that aren't available for data. */
+    const size_t ChunkOverhead;
+
     /* If true then the pool is protected by a mutex (see below).  Otherwise
        access to the pool is unsynchronized. */
     const bool Guarded;
 
+    /* True iff. we use per-thread magazines. */
+    const bool ThreadCached;
+
+    /* Unique among all pools ever created by this process.  Used to find a
+       thread's magazine.  IDs of live pools with 'ThreadCached' set are kept
+       in a registry, so threads can prune entries for destroyed pools. */
+    const uint64_t Id;
+
+    /* Protects 'Magazines'. */
+    mutable std::mutex MagazinesMutex;
+
+    /* One magazine for each live thread that has used the pool. */
+    std::list<TMagazine> Magazines;
+
     /* if 'Guarded' above is true then access to the pool is guarded by this
        mutex.  Otherwise the mutex is unused and access to the pool is
        unguarded. */
-    std::mutex Mutex;
+    mutable std::mutex Mutex;
 
     /* The first block available to be allocated, or null if we're out of
-       blocks. */
+       blocks.  Fixed block mode only. */
     TBlock *FirstFreeBlock;
 
-    /* Our storage space.  Never null. */
+    /* Number of blocks on the list above. */
+    size_t FreeBlockCount;
+
+    /* Our storage space.  Null iff. we are in size class mode. */
     char *Storage;
+
+    /* Size classes, smallest first.  Empty iff. we are in fixed block mode.
+     */
+    std::vector<TSizeClass> SizeClasses;
+
+    /* Size class mode only.  Our cap in bytes, and the bytes held in chunks
+       allocated to callers or cached. */
+    size_t MaxBytes, HeldBytes;
   };  // TPool
 
 }  // Capped
@@ -21,8 +21,12 @@
 
 #include <capped/pool.h>
   
+#include <atomic>
 #include <cstdint>
+#include <future>
 #include <memory>
+#include <thread>
+#include <vector>
   
 #include <gtest/gtest.h>
   
@@ -102,6 +106,260 @@ namespace {
     ASSERT_FALSE(TryNewPoint());
   }
 
+  TEST_F(TPoolTest, SizeClasses) {
+    TPool pool(64, 1024, 2048, TPool::TSync::Unguarded);
+    ASSERT_TRUE(pool.HasSizeClasses());
+    ASSERT_EQ(pool.GetBlockSize(), 1024U);
+    size_t max_data_size = pool.GetDataSize();
+    TPool::TBlock *a = pool.AllocChunks(max_data_size);
+    ASSERT_TRUE(a != nullptr);
+    ASSERT_TRUE(a->NextBlock == nullptr);
+    ASSERT_EQ(pool.GetDataSize(a), max_data_size);
+    TPool::TBlock *b = pool.AllocChunks(max_data_size);
+
+    /* Both chunks together use up the cap. */
+    ASSERT_THROW(pool.AllocChunks(1), TMemoryCapReached);
+
+    /* A freed chunk is cached, then given back to make room for a chunk of
+       another size. */
+    pool.FreeList(a);
+    size_t in_use_bytes = 0;
+    size_t max_bytes = 0;
+    std::vector<TPool::TSizeClassStats> stats =
+        pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(stats.size(), 5U);
+    ASSERT_EQ(stats[0].ChunkSize, 64U);
+    ASSERT_EQ(stats[4].ChunkSize, 1024U);
+    ASSERT_EQ(stats[4].InUseCount, 1U);
+    ASSERT_EQ(stats[4].FreeCount, 1U);
+    ASSERT_EQ(in_use_bytes, 1024U);
+    ASSERT_EQ(max_bytes, 2048U);
+    TPool::TBlock *c = pool.AllocChunks(10);
+    ASSERT_LT(pool.GetDataSize(c), 64U);
+    ASSERT_GE(pool.GetDataSize(c), 10U);
+    stats = pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(stats[0].InUseCount, 1U);
+    ASSERT_EQ(stats[4].FreeCount, 0U);
+    ASSERT_EQ(in_use_bytes, 1024U + 64U);
+    pool.FreeList(b);
+    pool.FreeList(c);
+
+    /* A large allocation gets full chunks of the largest size, then one right
+       sized chunk for the rest. */
+    TPool::TBlock *d = pool.AllocChunks(max_data_size + 100);
+    ASSERT_EQ(pool.GetDataSize(d), max_data_size);
+    ASSERT_TRUE(d->NextBlock != nullptr);
+    ASSERT_GE(pool.GetDataSize(d->NextBlock), 100U);
+    ASSERT_LT(pool.GetDataSize(d->NextBlock), 128U);
+    ASSERT_TRUE(d->NextBlock->NextBlock == nullptr);
+    pool.FreeList(d);
+    stats = pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(in_use_bytes, 0U);
+  }
+
+  TEST_F(TPoolTest, ThreadCached) {
+    TPool pool(64, 100, TPool::TSync::ThreadCached);
+
+    /* Blocks freed by a thread are flushed from its magazine when it exits.
+     */
+    std::thread t([&pool]() {
+      std::vector<void *> v;
+
+      for (size_t i = 0; i < 100; ++i) {
+        v.push_back(pool.Alloc());
+      }
+
+      for (void *ptr : v) {
+        pool.Free(ptr);
+      }
+    });
+    t.join();
+
+    /* They aren't lost to the cap, and the cap is still exact. */
+    ASSERT_EQ(pool.GetMagazineCount(), 0U);
+    std::vector<void *> v;
+
+    for (size_t i = 0; i < 100; ++i) {
+      v.push_back(pool.Alloc());
+    }
+
+    ASSERT_THROW(pool.Alloc(), TMemoryCapReached);
+    size_t in_use_bytes = 0;
+    size_t max_bytes = 0;
+    std::vector<TPool::TSizeClassStats> stats =
+        pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(stats.size(), 1U);
+    ASSERT_EQ(stats[0].InUseCount, 100U);
+    ASSERT_EQ(stats[0].FreeCount, 0U);
+    ASSERT_EQ(in_use_bytes, 6400U);
+
+    for (void *ptr : v) {
+      pool.Free(ptr);
+    }
+
+    TPool::TBlock *list = pool.AllocList(100);
+    ASSERT_THROW(pool.AllocList(1), TMemoryCapReached);
+    pool.FreeList(list);
+    stats = pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(stats[0].InUseCount, 0U);
+    ASSERT_EQ(stats[0].FreeCount, 100U);
+    ASSERT_EQ(in_use_bytes, 0U);
+  }
+
+  TEST_F(TPoolTest, ThreadCachedDrainAfterFailure) {
+    TPool pool(64, 100, TPool::TSync::ThreadCached);
+    std::vector<void *> v;
+
+    for (size_t i = 0; i < 100; ++i) {
+      v.push_back(pool.Alloc());
+    }
+
+    /* Failing again with all magazines empty doesn't need to drain them. */
+    ASSERT_THROW(pool.Alloc(), TMemoryCapReached);
+    ASSERT_THROW(pool.AllocList(1), TMemoryCapReached);
+
+    /* A block freed into another thread's magazine is still found. */
+    void *ptr = v.back();
+    v.pop_back();
+    std::thread t([&pool, ptr]() {
+      pool.Free(ptr);
+    });
+    t.join();
+    v.push_back(pool.Alloc());
+    ASSERT_THROW(pool.Alloc(), TMemoryCapReached);
+
+    for (void *p : v) {
+      pool.Free(p);
+    }
+  }
+
+  TEST_F(TPoolTest, ThreadCachedManyPools) {
+    /* The thread's map from pools to magazines drops destroyed pools rather
+       than growing with each one. */
+    for (size_t i = 0; i < 1000; ++i) {
+      TPool pool(64, 10, TPool::TSync::ThreadCached);
+      void *ptr = pool.Alloc();
+      pool.Free(ptr);
+      size_t in_use_bytes = 0;
+      size_t max_bytes = 0;
+      pool.GetStats(in_use_bytes, max_bytes);
+      ASSERT_EQ(in_use_bytes, 0U);
+    }
+  }
+
+  TEST_F(TPoolTest, ThreadCachedThreadExit) {
+    TPool pool(64, 100, TPool::TSync::ThreadCached);
+
+    /* Threads that come and go don't leave magazines or blocks behind. */
+    for (size_t i = 0; i < 100; ++i) {
+      std::thread t([&pool]() {
+        TPool::TBlock *list = pool.AllocList(10);
+        void *ptr = pool.Alloc();
+        pool.FreeList(list);
+        pool.Free(ptr);
+        ASSERT_EQ(pool.GetMagazineCount(), 1U);
+      });
+      t.join();
+      ASSERT_EQ(pool.GetMagazineCount(), 0U);
+    }
+
+    size_t in_use_bytes = 0;
+    size_t max_bytes = 0;
+    std::vector<TPool::TSizeClassStats> stats =
+        pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(in_use_bytes, 0U);
+    ASSERT_EQ(stats[0].FreeCount, 100U);
+
+    /* A thread may outlive a pool it used. */
+    std::promise<void> pool_used, pool_destroyed;
+    std::unique_ptr<TPool> p(new TPool(64, 10, TPool::TSync::ThreadCached));
+    std::thread t([&p, &pool_used, &pool_destroyed]() {
+      p->Free(p->Alloc());
+      pool_used.set_value();
+      pool_destroyed.get_future().wait();
+    });
+    pool_used.get_future().wait();
+    p.reset();
+    pool_destroyed.set_value();
+    t.join();
+  }
+
+  TEST_F(TPoolTest, ThreadCachedSizeClasses) {
+    TPool pool(64, 1024, 2048, TPool::TSync::ThreadCached);
+    size_t max_data_size = pool.GetDataSize();
+
+    /* Another thread leaves the whole cap cached in its magazine. */
+    std::thread t([&pool, max_data_size]() {
+      TPool::TBlock *a = pool.AllocChunks(max_data_size);
+      TPool::TBlock *b = pool.AllocChunks(max_data_size);
+      pool.FreeList(a);
+      pool.FreeList(b);
+    });
+    t.join();
+
+    /* A chunk of another size can still be had. */
+    TPool::TBlock *c = pool.AllocChunks(10);
+    ASSERT_TRUE(c != nullptr);
+    TPool::TBlock *d = pool.AllocChunks(max_data_size);
+    ASSERT_THROW(pool.AllocChunks(max_data_size), TMemoryCapReached);
+    pool.FreeList(c);
+    pool.FreeList(d);
+    size_t in_use_bytes = 0;
+    size_t max_bytes = 0;
+    pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(in_use_bytes, 0U);
+  }
+
+  TEST_F(TPoolTest, ThreadCachedStress) {
+    const size_t block_count = 256;
+    TPool pool(64, block_count, TPool::TSync::ThreadCached);
+    std::atomic<size_t> in_use(0);
+    std::atomic<bool> over_cap(false);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < 4; ++i) {
+      threads.emplace_back([&, i]() {
+        std::vector<std::pair<TPool::TBlock *, size_t>> held;
+
+        for (size_t j = 0; j < 20000; ++j) {
+          size_t count = 1 + ((i + j) % 8);
+
+          try {
+            held.emplace_back(pool.AllocList(count), count);
+
+            if ((in_use += count) > block_count) {
+              over_cap = true;
+            }
+          } catch (const TMemoryCapReached &) {
+          }
+
+          if (held.size() > 8) {
+            in_use -= held.front().second;
+            pool.FreeList(held.front().first);
+            held.erase(held.begin());
+          }
+        }
+
+        for (const auto &item : held) {
+          in_use -= item.second;
+          pool.FreeList(item.first);
+        }
+      });
+    }
+
+    for (std::thread &t : threads) {
+      t.join();
+    }
+
+    ASSERT_FALSE(over_cap);
+    size_t in_use_bytes = 0;
+    size_t max_bytes = 0;
+    std::vector<TPool::TSizeClassStats> stats =
+        pool.GetStats(in_use_bytes, max_bytes);
+    ASSERT_EQ(in_use_bytes, 0U);
+    ASSERT_EQ(stats[0].FreeCount, block_count);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
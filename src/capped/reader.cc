@@ -32,9 +32,6 @@ using namespace Capped;
 TReader &TReader::Advance(void *data, size_t size) {
   assert(this);
 
-  /* Getting the block size will fail in the case where the blob is empty, so
-     we first protect ourselves. */
-
   if (size == 0) {
     return *this;
   }
@@ -44,9 +41,6 @@ TReader &TReader::Advance(void *data, size_t size) {
     throw TMemoryCapReached();
   }
 
-  /* Now it's safe to get the block size. */
-  size_t block_size = Blob->GetBlockSize();
-
   while (size) {
     /* If we're out of data, throw. */
     if (!Cursor) {
@@ -57,7 +51,7 @@ TReader &TReader::Advance(void *data, size_t size) {
        enough to satisfy the read, we'll just finish up and exit the loop. */
     size_t avail = Block ?
         (Block->Data + (Block->NextBlock ?
-             block_size : Blob->LastBlockSize) - Cursor) :
+             Blob->GetBlockSize(Block) : Blob->LastBlockSize) - Cursor) :
         0;
     assert(BytesRemaining >= avail);
 
@@ -48,68 +48,88 @@ TBlob TWriter::DraftBlob() noexcept {
   TBlob result;
 
   if (FirstBlock) {
-    result = TBlob(Pool, FirstBlock, Cursor - LastBlock->Data, NumBytes);
+    /* Give back any reserved blocks we didn't write to. */
+    Pool->FreeList(LastBlock->NextBlock);
+    LastBlock->NextBlock = nullptr;
+
+    if (NumBytes) {
+      result = TBlob(Pool, FirstBlock, Cursor - LastBlock->Data, NumBytes);
+    } else {
+      Pool->FreeList(FirstBlock);
+    }
+
     Init();
   }
 
   return result;
 }
 
+TWriter &TWriter::Reserve(size_t size) {
+  assert(this);
+
+  if (size <= Avail) {
+    return *this;
+  }
+
+  /* Allocate enough blocks to hold the rest and link them on to the end of
+     our list. */
+  TBlock *block = Pool->AllocChunks(size - Avail);
+  assert(block);
+
+  if (TailBlock) {
+    TailBlock->NextBlock = block;
+  } else {
+    /* We don't have any blocks yet, so the new ones become the first blocks
+       in our list. */
+    FirstBlock = block;
+    LastBlock = block;
+    Cursor = block->Data;
+  }
+
+  for (; ; block = block->NextBlock) {
+    Avail += Pool->GetDataSize(block);
+
+    if (block->NextBlock == nullptr) {
+      break;
+    }
+  }
+
+  TailBlock = block;
+  return *this;
+}
+
 TWriter &TWriter::Write(const void *data, size_t size) {
   assert(this);
   assert(data || !size);
-  /* Determine if we need to allocate more blocks and, if so, where we'll link
-     them on to our list. */
-  size_t block_size = Pool->GetDataSize();
-  TBlock **link;
+
+  if (size == 0) {
+    return *this;
+  }
+
+  Reserve(size);
   size_t bytes_to_write = size;
 
-  if (LastBlock) {
-    size_t avail = LastBlock->Data + block_size - Cursor;
+  for (; ; ) {
+    assert(LastBlock);
+    size_t avail = LastBlock->Data + Pool->GetDataSize(LastBlock) - Cursor;
 
     if (size <= avail) {
-      /* The new data fits entirely in the existing space, so we won't need to
-         link on any more blocks. */
+      /* The rest of the data fits in the current block. */
       memcpy(Cursor, data, size);
       Cursor += size;
-      NumBytes += size;
-      return *this;
+      break;
     }
 
-    /* The new data doesn't entirely fit, but we'll make a start.  We will need
-       to allocate more blocks, and we'll link them to the end of our existing
-       list. */
+    /* Fill the current block and move on to the next one, which Reserve()
+       made sure we have. */
     memcpy(Cursor, data, avail);
     reinterpret_cast<const char *&>(data) += avail;
     size -= avail;
-    link = &(LastBlock->NextBlock);
-  } else {
-    /* We don't have any blocks yet, so we'll definitely need to allocate some.
-       We'll link them on as the first blocks in our list. */
-    link = &FirstBlock;
-  }
-
-  assert(link);
-
-  /* Allocate enough blocks to hold the remainder of the new data and link them
-     on. */
-  TBlock *block = Pool->AllocList((size + block_size - 1) / block_size);
-  *link = block;
-
-  /* Copy as many whole blocks as we can. */
-  while (size > block_size) {
-    assert(block);
-    memcpy(block->Data, data, block_size);
-    reinterpret_cast<const char *&>(data) += block_size;
-    size -= block_size;
-    block = block->NextBlock;
+    LastBlock = LastBlock->NextBlock;
+    Cursor = LastBlock->Data;
   }
 
-  /* Copy in the last of the new data (a whole or partial block) and get ready
-     for the next write. */
-  memcpy(block->Data, data, size);
-  LastBlock = block;
-  Cursor = block->Data + size;
+  Avail -= bytes_to_write;
   NumBytes += bytes_to_write;
   return *this;
 }
@@ -118,6 +138,8 @@ void TWriter::Init() noexcept {
   assert(this);
   FirstBlock = nullptr;
   LastBlock = nullptr;
+  TailBlock = nullptr;
   Cursor = nullptr;
+  Avail = 0;
   NumBytes = 0;
 }
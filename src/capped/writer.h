@@ -32,7 +32,9 @@ namespace Capped {
      required.  When you have finished writing, call DraftBlob() to return your
      data in blob form.  The writer is then ready to be used again.  If you
      wish to reset the writer without constructing a blob, call CancelBlob().
-   */
+     If you know how much data you will write, call Reserve() first so the
+     blocks are allocated all at once.  This matters for a pool with size
+     classes, where it lets the data go into a few right-sized chunks. */
   class TWriter final {
     NO_COPY_SEMANTICS(TWriter);
 
@@ -54,31 +56,44 @@ namespace Capped {
      */
     TBlob DraftBlob() noexcept;
 
+    /* Make sure there is room for 'size' more bytes without allocating,
+       or throw TMemoryCapReached.  Reserved space left unused when the blob
+       is drafted goes back to the pool. */
+    TWriter &Reserve(size_t size);
+
     /* Copy the given data to the end of the blob we're building. */
     TWriter &Write(const void *data, size_t size);
 
     private:
 
     /* Returns the writer to the empty state.  This simply nulls out
-       FirstBlock, LastBlock, and Cursor without freeing anything, so make sure
-       ownership of the data has been transferred to some other structure
-       before you call this function. */
+       FirstBlock, LastBlock, TailBlock, and Cursor without freeing anything,
+       so make sure ownership of the data has been transferred to some other
+       structure before you call this function. */
     void Init() noexcept;
 
     /* The pool which we allocate blocks. */
     TPool *Pool;
 
-    /* The first and last blocks in our linked list.  These are both null iff.
-       we're empty.  If we're non-empty but, both pointers will be non-null.
+    /* The first and last blocks holding our data.  These are both null iff.
+       we have no blocks.  If we have blocks, both pointers will be non-null.
        If all our data fits in one chunk, both pointers will point to the same
        block.  If we use two or more chunks, then these pointers will point to
        different blocks. */
     TBlock *FirstBlock, *LastBlock;
 
+    /* The end of our linked list.  Blocks after LastBlock are reserved but
+       not yet written to.  This is null iff. LastBlock is null. */
+    TBlock *TailBlock;
+
     /* The position with in our last block's chunk where Write() will append
        more data.  This is null iff. LastBlock is null. */
     char *Cursor;
 
+    /* The number of bytes that can be written from Cursor to the end of
+       TailBlock. */
+    size_t Avail;
+
     /* The total # of bytes that have been written so far. */
     size_t NumBytes;
 
@@ -93,6 +93,8 @@ void TAnomalyTracker::TrackDiscard(TMsg &msg, TDiscardReason reason) {
     } else {
       ++iter->second;
     }
+  } else if (reason == TDiscardReason::Expired) {
+    ++FillingReport->ExpiredDiscardMap[msg_topic];
   }
 }
 
@@ -128,6 +130,27 @@ void TAnomalyTracker::TrackNoMemDiscard(TMsg::TTimestamp timestamp,
   UpdateTopicMap(FillingReport->DiscardTopicMap, std::move(topic), timestamp);
 }
 
+void TAnomalyTracker::TrackTopicQuotaDiscard(TMsg::TTimestamp timestamp,
+    const char *topic_begin, const char *topic_end, const void *key_begin,
+    const void *key_end, const void *value_begin, const void *value_end) {
+  assert(this);
+  assert(topic_begin);
+  assert(topic_end >= topic_begin);
+  assert(key_begin || (key_end == key_begin));
+  assert(key_end >= key_begin);
+  assert(value_begin || (value_end == value_begin));
+  assert(value_end >= value_begin);
+  uint64_t now = ClockFn();
+  DiscardFileLogger.LogTopicQuotaDiscard(timestamp, topic_begin, topic_end,
+      key_begin, key_end, value_begin, value_end);
+  std::string topic(topic_begin, topic_end);
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  AdvanceReportPeriod(now);
+  ++FillingReport->TopicQuotaDiscardMap[topic];
+  UpdateTopicMap(FillingReport->DiscardTopicMap, std::move(topic), timestamp);
+}
+
 void TAnomalyTracker::TrackMalformedMsgDiscard(const void *prefix_begin,
     const void *prefix_end) {
   assert(this);
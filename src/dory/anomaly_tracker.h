@@ -114,7 +114,8 @@ namespace Dory {
 
     /* This stores per-topic counts of messages discarded due to the message
        rate limiting mechanism.  Discards due to rate limiting are tracked both
-       here and using the above TMap mechanism. */
+       here and using the above TMap mechanism.  The same type is used for
+       per-topic counts of discards due to topic buffer quotas. */
     using TRateLimitMap = std::map<std::string, size_t>;
 
     /* Contains all info tracked by the anomaly tracker. */
@@ -148,6 +149,16 @@ namespace Dory {
          'DiscardTopicMap' above. */
       TRateLimitMap RateLimitDiscardMap;
 
+      /* Per-topic counts of messages discarded because the topic reached its
+         buffered byte quota and the shared burst region was full.  Each such
+         discard is tracked both here and in 'DiscardTopicMap' above. */
+      TRateLimitMap TopicQuotaDiscardMap;
+
+      /* Per-topic counts of messages discarded because they were older than
+         their topic's max age.  Each such discard is tracked both here and in
+         'DiscardTopicMap' above. */
+      TRateLimitMap ExpiredDiscardMap;
+
       /* List of most recently discarded malformed messages.  The most recently
          seen message is at the front of the list.  For messages exceeding a
          certain length, only a prefix of the message is stored. */
@@ -270,6 +281,13 @@ namespace Dory {
         const char *topic_end, const void *key_begin, const void *key_end,
         const void *value_begin, const void *value_end);
 
+    /* Track a discard due to a topic having reached its buffered byte quota
+       with no room left in the shared burst region.  Parameters are the same
+       as for TrackNoMemDiscard(). */
+    void TrackTopicQuotaDiscard(TMsg::TTimestamp timestamp,
+        const char *topic_begin, const char *topic_end, const void *key_begin,
+        const void *key_end, const void *value_begin, const void *value_end);
+
     /* Track a discard due to a message whose topic could not be identified.
        We save prefixes of recently seen invalid message strings to facilitate
        troubleshooting. */
@@ -0,0 +1,151 @@
+/* <dory/background_metadata_fetcher.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/background_metadata_fetcher.h>.
+ */
+
+#include <dory/background_metadata_fetcher.h>
+
+#include <cstdlib>
+
+#include <syslog.h>
+#include <unistd.h>
+
+#include <base/fd.h>
+#include <base/gettid.h>
+#include <dory/kafka_proto/metadata/version_util.h>
+#include <dory/util/dory_rate_limiter.h>
+#include <server/counter.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::KafkaProto::Metadata;
+using namespace Dory::Util;
+
+SERVER_COUNTER(BackgroundMetadataFetchFail);
+SERVER_COUNTER(BackgroundMetadataFetchSuccess);
+
+static unsigned GetRandomNumber() {
+  return std::rand();
+}
+
+TBackgroundMetadataFetcher::TBackgroundMetadataFetcher(const TConfig &config,
+    const std::vector<THostAndPort> &brokers,
+    TIdempotentProducer &idempotent_producer)
+    : Config(config),
+      Brokers(brokers),
+      IdempotentProducer(idempotent_producer),
+      MetadataFetcher(ChooseMetadataProto(
+          config.MetadataApiVersion.IsKnown() ?
+              *config.MetadataApiVersion : 0)) {
+  assert(!Brokers.empty());
+}
+
+TBackgroundMetadataFetcher::~TBackgroundMetadataFetcher() noexcept {
+  ShutdownOnDestroy();
+}
+
+void TBackgroundMetadataFetcher::Run() {
+  assert(this);
+  int tid = static_cast<int>(Gettid());
+  syslog(LOG_NOTICE, "Background metadata fetch thread %d started", tid);
+
+  try {
+    TDoryRateLimiter retry_rate_limiter(Config.PauseRateLimitInitial,
+        Config.PauseRateLimitMaxDouble, Config.MinPauseDelay,
+        GetRandomNumber);
+    const TFd &shutdown_request_fd = GetShutdownRequestFd();
+
+    for (; ; ) {
+      Result = TryGetMetadata();
+
+      if (Result) {
+        BackgroundMetadataFetchSuccess.Increment();
+        break;
+      }
+
+      BackgroundMetadataFetchFail.Increment();
+      size_t delay = retry_rate_limiter.ComputeDelay();
+      syslog(LOG_ERR, "Background metadata request failed for all known "
+             "brokers, waiting %lu milliseconds before retry",
+             static_cast<unsigned long>(delay));
+
+      if (shutdown_request_fd.IsReadable(delay)) {
+        break;  // got shutdown signal
+      }
+
+      retry_rate_limiter.OnAction();
+    }
+  } catch (const std::exception &x) {
+    syslog(LOG_ERR, "Fatal error in background metadata fetch thread %d: %s",
+           tid, x.what());
+    _exit(EXIT_FAILURE);
+  } catch (...) {
+    syslog(LOG_ERR, "Fatal unknown error in background metadata fetch thread "
+           "%d", tid);
+    _exit(EXIT_FAILURE);
+  }
+
+  syslog(LOG_NOTICE, "Background metadata fetch thread %d finished %s", tid,
+         Result ? "with metadata" : "on shutdown");
+}
+
+std::shared_ptr<TMetadata> TBackgroundMetadataFetcher::TryGetMetadata() {
+  assert(this);
+  TMetadataFetcher::TDisconnecter disconnecter(MetadataFetcher);
+  size_t chosen = std::rand() % Brokers.size();
+  std::shared_ptr<TMetadata> result;
+
+  for (size_t i = 0;
+       i < Brokers.size();
+       chosen = ((chosen + 1) % Brokers.size()), ++i) {
+    const THostAndPort &broker = Brokers[chosen];
+
+    if (!MetadataFetcher.Connect(broker.Host, broker.Port)) {
+      syslog(LOG_ERR, "Background metadata fetch failed to connect to "
+             "broker %s port %d", broker.Host.c_str(),
+             static_cast<int>(broker.Port));
+      continue;
+    }
+
+    result = MetadataFetcher.Fetch(Config.KafkaSocketTimeout * 1000);
+
+    if (result && !result->SanityCheck()) {
+      syslog(LOG_ERR, "Background metadata sanity check failed!!!");
+      result.reset();
+    }
+
+    if (result) {
+      if (IdempotentProducer.NeedsProducerId()) {
+        int64_t producer_id = -1;
+        int16_t producer_epoch = -1;
+
+        if (MetadataFetcher.InitProducerId(producer_id, producer_epoch,
+                Config.KafkaSocketTimeout * 1000)) {
+          IdempotentProducer.SetProducerId(producer_id, producer_epoch);
+        }
+      }
+
+      break;  // success
+    }
+
+    MetadataFetcher.Disconnect();
+  }
+
+  return std::move(result);
+}
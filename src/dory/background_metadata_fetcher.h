@@ -0,0 +1,78 @@
+/* <dory/background_metadata_fetcher.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Thread that fetches metadata while the router thread is already routing
+   messages using metadata from an on-disk snapshot.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <dory/config.h>
+#include <dory/idempotent_producer.h>
+#include <dory/metadata.h>
+#include <dory/metadata_fetcher.h>
+#include <dory/util/host_and_port.h>
+#include <thread/fd_managed_thread.h>
+
+namespace Dory {
+
+  class TBackgroundMetadataFetcher final : public Thread::TFdManagedThread {
+    NO_COPY_SEMANTICS(TBackgroundMetadataFetcher);
+
+    public:
+    /* The thread tries each broker in 'brokers' until it gets metadata, and
+       keeps trying until it succeeds or gets a shutdown request.  If
+       'idempotent_producer' needs a producer ID, the thread also asks for one
+       from the broker that provided the metadata. */
+    TBackgroundMetadataFetcher(const TConfig &config,
+        const std::vector<Util::THostAndPort> &brokers,
+        TIdempotentProducer &idempotent_producer);
+
+    virtual ~TBackgroundMetadataFetcher() noexcept;
+
+    /* Call only after Join().  Returned shared_ptr contains the fetched
+       metadata, or nothing if the thread was shut down first. */
+    std::shared_ptr<TMetadata> TakeResult() {
+      assert(this);
+      assert(!IsStarted());
+      return std::move(Result);
+    }
+
+    protected:
+    virtual void Run() override;
+
+    private:
+    std::shared_ptr<TMetadata> TryGetMetadata();
+
+    const TConfig &Config;
+
+    const std::vector<Util::THostAndPort> Brokers;
+
+    TIdempotentProducer &IdempotentProducer;
+
+    TMetadataFetcher MetadataFetcher;
+
+    std::shared_ptr<TMetadata> Result;
+  };  // TBackgroundMetadataFetcher
+
+}  // Dory
@@ -0,0 +1,72 @@
+/* <dory/batch/adaptive_batch_stats.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/batch/adaptive_batch_stats.h>.
+ */
+
+#include <dory/batch/adaptive_batch_stats.h>
+
+#include <algorithm>
+
+using namespace Dory;
+using namespace Dory::Batch;
+
+const float TAdaptiveBatchStats::ACK_LATENCY_SMOOTHING = 0.25f;
+
+void TAdaptiveBatchStats::RecordAckLatency(uint64_t latency) {
+  assert(this);
+  double sample = static_cast<double>(latency * 1000);
+  uint64_t old_value = AckLatencyUs.load();
+  uint64_t new_value = 0;
+
+  /* Several connector threads may report concurrently, so retry until our
+     update is applied on top of the latest value. */
+  do {
+    double old_avg = static_cast<double>(old_value);
+    new_value = (old_value == 0) ?
+        static_cast<uint64_t>(sample) :
+        static_cast<uint64_t>(old_avg +
+            (ACK_LATENCY_SMOOTHING * (sample - old_avg)));
+  } while (!AckLatencyUs.compare_exchange_weak(old_value, new_value));
+}
+
+void TAdaptiveBatchStats::UpdateGroup(const std::string &group,
+    const TGroupStats &stats) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+  Groups[group] = stats;
+}
+
+void TAdaptiveBatchStats::GetStats(
+    std::vector<TGroupStatsItem> &group_stats) const {
+  assert(this);
+  group_stats.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    for (const auto &item : Groups) {
+      group_stats.push_back(item);
+    }
+  }
+
+  std::sort(group_stats.begin(), group_stats.end(),
+      [](const TGroupStatsItem &x, const TGroupStatsItem &y) {
+        return x.first < y.first;
+      });
+}
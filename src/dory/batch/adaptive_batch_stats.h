@@ -0,0 +1,119 @@
+/* <dory/batch/adaptive_batch_stats.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for sharing state between adaptive batchers and reporting their
+   effective thresholds.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  namespace Batch {
+
+    /* Shared by the router thread and all connector threads.  Connector
+       threads report how long brokers take to ACK produce requests, and
+       batchers in adaptive mode subtract a running average of that from their
+       latency budget.  Each adaptive batcher also publishes its current
+       effective thresholds here so they can be shown on the status page. */
+    class TAdaptiveBatchStats final {
+      NO_COPY_SEMANTICS(TAdaptiveBatchStats);
+
+      public:
+      /* Weight given to the most recent sample when updating the running ACK
+         latency. */
+      static const float ACK_LATENCY_SMOOTHING;
+
+      struct TGroupStats {
+        /* Configured latency budget in milliseconds. */
+        size_t LatencyTarget;
+
+        /* Effective time limit in milliseconds. */
+        size_t TimeLimit;
+
+        /* Effective byte limit, or 0 if there is no byte limit. */
+        size_t ByteCount;
+
+        /* Recent arrival rate in bytes per second. */
+        uint64_t ByteRate;
+
+        /* ACK latency estimate in milliseconds used to compute 'TimeLimit'.
+         */
+        size_t AckLatency;
+
+        TGroupStats()
+            : LatencyTarget(0),
+              TimeLimit(0),
+              ByteCount(0),
+              ByteRate(0),
+              AckLatency(0) {
+        }
+      };  // TGroupStats
+
+      TAdaptiveBatchStats()
+          : AckLatencyUs(0) {
+      }
+
+      /* Called by a connector thread when it gets the ACK for a produce
+         request that was sent 'latency' milliseconds ago. */
+      void RecordAckLatency(uint64_t latency);
+
+      /* Return the running average ACK latency in milliseconds, or 0 if no
+         ACKs have been received yet. */
+      size_t GetAckLatency() const {
+        assert(this);
+        return static_cast<size_t>(AckLatencyUs.load() / 1000);
+      }
+
+      /* Called by an adaptive batcher to publish its thresholds.  'group'
+         identifies the batcher (for instance, a topic). */
+      void UpdateGroup(const std::string &group, const TGroupStats &stats);
+
+      /* The first item is the group name, and the second item is stats for
+         that group. */
+      using TGroupStatsItem = std::pair<std::string, TGroupStats>;
+
+      /* On return, 'group_stats' will contain stats for all groups that have
+         published thresholds, sorted by group name. */
+      void GetStats(std::vector<TGroupStatsItem> &group_stats) const;
+
+      private:
+      /* Running average ACK latency in microseconds. */
+      std::atomic<uint64_t> AckLatencyUs;
+
+      /* Protects 'Groups'. */
+      mutable std::mutex Mutex;
+
+      std::unordered_map<std::string, TGroupStats> Groups;
+    };  // TAdaptiveBatchStats
+
+  }  // Batch
+
+}  // Dory
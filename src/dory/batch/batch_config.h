@@ -32,19 +32,34 @@ namespace Dory {
       TBatchConfig()
           : TimeLimit(0),
             MsgCount(0),
-            ByteCount(0) {
+            ByteCount(0),
+            LatencyTarget(0) {
       }
 
-      TBatchConfig(size_t time_limit, size_t msg_count, size_t byte_count)
+      TBatchConfig(size_t time_limit, size_t msg_count, size_t byte_count,
+          size_t latency_target = 0)
           : TimeLimit(time_limit),
             MsgCount(msg_count),
-            ByteCount(byte_count) {
+            ByteCount(byte_count),
+            LatencyTarget(latency_target) {
       }
 
       TBatchConfig(const TBatchConfig &) = default;
 
       TBatchConfig& operator=(const TBatchConfig &) = default;
 
+      bool operator==(const TBatchConfig &that) const {
+        assert(this);
+        return (TimeLimit == that.TimeLimit) && (MsgCount == that.MsgCount) &&
+            (ByteCount == that.ByteCount) &&
+            (LatencyTarget == that.LatencyTarget);
+      }
+
+      bool operator!=(const TBatchConfig &that) const {
+        assert(this);
+        return !(*this == that);
+      }
+
       void Clear() {
         assert(this);
         *this = TBatchConfig();
@@ -55,10 +70,21 @@ namespace Dory {
       size_t MsgCount;
 
       size_t ByteCount;
+
+      /* If nonzero, batching is adaptive.  This is the latency budget in
+         milliseconds, and the effective time and byte limits are derived
+         from it, the observed arrival rate, and the observed broker ACK
+         latency.  'TimeLimit' and 'ByteCount' then act as upper bounds. */
+      size_t LatencyTarget;
     };  // TBatchConfig
 
     inline bool BatchingIsEnabled(const TBatchConfig &config) {
-      return config.TimeLimit || config.MsgCount || config.ByteCount;
+      return config.TimeLimit || config.MsgCount || config.ByteCount ||
+          config.LatencyTarget;
+    }
+
+    inline bool AdaptiveBatchingIsEnabled(const TBatchConfig &config) {
+      return (config.LatencyTarget != 0);
     }
 
     inline bool TimeLimitIsEnabled(const TBatchConfig &config) {
@@ -151,7 +151,9 @@ static TBatchConfig ToBatchConfig(const TBatchConf::TBatchValues &values) {
   size_t time_limit = values.OptTimeLimit.IsKnown() ? *values.OptTimeLimit : 0;
   size_t msg_count = values.OptMsgCount.IsKnown() ? *values.OptMsgCount : 0;
   size_t byte_count = values.OptByteCount.IsKnown() ? *values.OptByteCount : 0;
-  return TBatchConfig(time_limit, msg_count, byte_count);
+  size_t latency_target = values.OptLatencyTarget.IsKnown() ?
+      *values.OptLatencyTarget : 0;
+  return TBatchConfig(time_limit, msg_count, byte_count, latency_target);
 }
 
 TGlobalBatchConfig TBatchConfigBuilder::BuildFromConf(const TBatchConf &conf) {
@@ -27,14 +27,27 @@ using namespace Base;
 using namespace Dory;
 using namespace Dory::Batch;
 
+/* Weight given to the most recent measurement interval when updating the
+   running arrival rate of an adaptive batcher. */
+static const double RATE_SMOOTHING = 0.25;
+
 TBatcherCore::TBatcherCore()
-    : MinTimestamp(std::numeric_limits<TMsg::TTimestamp>::max()),
+    : AdaptiveStats(nullptr),
+      ByteRate(-1.0),
+      RateWindowStart(0),
+      RateWindowBytes(0),
+      MinTimestamp(std::numeric_limits<TMsg::TTimestamp>::max()),
       MsgCount(0),
       ByteCount(0) {
 }
 
 TBatcherCore::TBatcherCore(const TBatchConfig &config)
     : Config(config),
+      Effective(config),
+      AdaptiveStats(nullptr),
+      ByteRate(-1.0),
+      RateWindowStart(0),
+      RateWindowBytes(0),
       MinTimestamp(std::numeric_limits<TMsg::TTimestamp>::max()),
       MsgCount(0),
       ByteCount(0) {
@@ -43,11 +56,29 @@ TBatcherCore::TBatcherCore(const TBatchConfig &config)
 TOpt<TMsg::TTimestamp> TBatcherCore::GetNextCompleteTime() const {
   assert(this);
 
-  if (IsEmpty() || !TimeLimitIsEnabled(Config)) {
+  if (IsEmpty() || !TimeLimitIsEnabled(Effective)) {
     return TOpt<TMsg::TTimestamp>();
   }
 
-  return TOpt<TMsg::TTimestamp>(MinTimestamp + Config.TimeLimit);
+  return TOpt<TMsg::TTimestamp>(MinTimestamp + Effective.TimeLimit);
+}
+
+bool TBatcherCore::SetConfig(const TBatchConfig &config,
+    TMsg::TTimestamp now) {
+  assert(this);
+  Config = config;
+
+  if (AdaptiveBatchingIsEnabled(Config)) {
+    ComputeEffectiveConfig();
+  } else {
+    Effective = Config;
+  }
+
+  if (IsEmpty()) {
+    return false;
+  }
+
+  return !Dory::Batch::BatchingIsEnabled(Config) || TestAllLimits(now);
 }
 
 TBatcherCore::TAction
@@ -66,7 +97,23 @@ TBatcherCore::ProcessNewMsg(TMsg::TTimestamp now, const TMsg::TPtr &msg) {
      is enabled. */
   size_t body_size = std::max(size_t(1), msg->GetKeyAndValue().Size());
 
-  if (ByteCountLimitIsEnabled(Config) && (body_size >= Config.ByteCount)) {
+  bool adaptive = AdaptiveBatchingIsEnabled(Config);
+  bool publish_stats = false;
+
+  if (adaptive) {
+    publish_stats = UpdateByteRate(now, body_size) && AdaptiveStats;
+
+    if (IsEmpty()) {
+      ComputeEffectiveConfig();
+    }
+  }
+
+  if (ByteCountLimitIsEnabled(Effective) &&
+      (body_size >= Effective.ByteCount)) {
+    if (publish_stats) {
+      PublishStats();
+    }
+
     ClearState();
     return TAction::LeaveMsgAndReturnBatch;
   }
@@ -74,7 +121,19 @@ TBatcherCore::ProcessNewMsg(TMsg::TTimestamp now, const TMsg::TPtr &msg) {
   if (TestByteCountExceeded(body_size)) {
     ClearState();
 
-    if (TestMsgCount(true) || TestTimeLimit(now, timestamp)) {
+    /* The message starts a new batch, so it gets fresh thresholds.  Under
+       sustained load, most batches close this way, so this is where adapting
+       to a higher arrival rate matters most. */
+    if (adaptive) {
+      ComputeEffectiveConfig();
+    }
+
+    if (publish_stats) {
+      PublishStats();
+    }
+
+    if (TestMsgCount(true) || TestByteCount(body_size) ||
+        TestTimeLimit(now, timestamp)) {
       return TAction::LeaveMsgAndReturnBatch;
     }
 
@@ -82,6 +141,10 @@ TBatcherCore::ProcessNewMsg(TMsg::TTimestamp now, const TMsg::TPtr &msg) {
     return TAction::ReturnBatchAndTakeMsg;
   }
 
+  if (publish_stats) {
+    PublishStats();
+  }
+
   UpdateState(timestamp, body_size);
 
   if (TestAllLimits(now)) {
@@ -103,43 +166,43 @@ bool TBatcherCore::TestTimeLimit(TMsg::TTimestamp now,
     TMsg::TTimestamp new_msg_timestamp) const {
   assert(this);
 
-  if (!TimeLimitIsEnabled(Config)) {
+  if (!TimeLimitIsEnabled(Effective)) {
     return false;
   }
 
   TMsg::TTimestamp min_ts = std::min(MinTimestamp, new_msg_timestamp);
-  return (now >= static_cast<TMsg::TTimestamp>(min_ts + Config.TimeLimit));
+  return (now >= static_cast<TMsg::TTimestamp>(min_ts + Effective.TimeLimit));
 }
 
 bool TBatcherCore::TestMsgCount(bool adding_msg) const {
   assert(this);
 
-  if (!MsgCountLimitIsEnabled(Config)) {
+  if (!MsgCountLimitIsEnabled(Effective)) {
     return false;
   }
 
   size_t to_add = adding_msg ? 1 : 0;
-  return ((MsgCount + to_add) >= Config.MsgCount);
+  return ((MsgCount + to_add) >= Effective.MsgCount);
 }
 
 bool TBatcherCore::TestByteCount(size_t bytes_to_add) const {
   assert(this);
 
-  if (!ByteCountLimitIsEnabled(Config)) {
+  if (!ByteCountLimitIsEnabled(Effective)) {
     return false;
   }
 
-  return ((ByteCount + bytes_to_add) >= Config.ByteCount);
+  return ((ByteCount + bytes_to_add) >= Effective.ByteCount);
 }
 
 bool TBatcherCore::TestByteCountExceeded(size_t bytes_to_add) const {
   assert(this);
 
-  if (!ByteCountLimitIsEnabled(Config)) {
+  if (!ByteCountLimitIsEnabled(Effective)) {
     return false;
   }
 
-  return ((ByteCount + bytes_to_add) > Config.ByteCount);
+  return ((ByteCount + bytes_to_add) > Effective.ByteCount);
 }
 
 void TBatcherCore::UpdateState(TMsg::TTimestamp timestamp, size_t body_size) {
@@ -148,3 +211,73 @@ void TBatcherCore::UpdateState(TMsg::TTimestamp timestamp, size_t body_size) {
   ++MsgCount;
   ByteCount += body_size;
 }
+
+bool TBatcherCore::UpdateByteRate(TMsg::TTimestamp now, size_t body_size) {
+  assert(this);
+
+  if (RateWindowStart == 0) {
+    RateWindowStart = now;
+    RateWindowBytes = body_size;
+    return false;
+  }
+
+  RateWindowBytes += body_size;
+  TMsg::TTimestamp window = std::max<TMsg::TTimestamp>(Config.LatencyTarget,
+      1);
+
+  if ((now < RateWindowStart) || ((now - RateWindowStart) < window)) {
+    return false;
+  }
+
+  double sample = static_cast<double>(RateWindowBytes) /
+      static_cast<double>(now - RateWindowStart);
+  ByteRate = (ByteRate < 0.0) ?
+      sample : (ByteRate + (RATE_SMOOTHING * (sample - ByteRate)));
+  RateWindowStart = now;
+  RateWindowBytes = 0;
+  return true;
+}
+
+void TBatcherCore::ComputeEffectiveConfig() {
+  assert(this);
+  assert(AdaptiveBatchingIsEnabled(Config));
+  Effective = Config;
+
+  /* Whatever part of the latency budget the broker is expected to consume
+     waiting to ACK is not available for batching.  Always allow at least 1
+     millisecond, since a time limit of 0 would disable the time limit. */
+  size_t ack_latency = AdaptiveStats ? AdaptiveStats->GetAckLatency() : 0;
+  size_t time_limit = (Config.LatencyTarget > ack_latency) ?
+      (Config.LatencyTarget - ack_latency) : 1;
+
+  if (!TimeLimitIsEnabled(Config) || (time_limit < Config.TimeLimit)) {
+    Effective.TimeLimit = time_limit;
+  }
+
+  if (ByteRate < 0.0) {
+    return;
+  }
+
+  /* Close the batch once it holds about as much data as we expect to arrive
+     within the time limit.  When traffic is light, this is a small value, so
+     messages go out with little added delay instead of waiting for data that
+     is unlikely to arrive. */
+  size_t byte_count = std::max<size_t>(1, static_cast<size_t>(
+      ByteRate * static_cast<double>(Effective.TimeLimit)));
+
+  if (!ByteCountLimitIsEnabled(Config) || (byte_count < Config.ByteCount)) {
+    Effective.ByteCount = byte_count;
+  }
+}
+
+void TBatcherCore::PublishStats() const {
+  assert(this);
+  assert(AdaptiveStats);
+  TAdaptiveBatchStats::TGroupStats stats;
+  stats.LatencyTarget = Config.LatencyTarget;
+  stats.TimeLimit = Effective.TimeLimit;
+  stats.ByteCount = Effective.ByteCount;
+  stats.ByteRate = static_cast<uint64_t>(std::max(ByteRate, 0.0) * 1000.0);
+  stats.AckLatency = AdaptiveStats->GetAckLatency();
+  AdaptiveStats->UpdateGroup(Group, stats);
+}
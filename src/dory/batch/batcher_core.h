@@ -23,9 +23,12 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <string>
 
 #include <base/opt.h>
+#include <dory/batch/adaptive_batch_stats.h>
 #include <dory/batch/batch_config.h>
 #include <dory/msg.h>
 
@@ -50,6 +53,16 @@ namespace Dory {
 
       TBatcherCore &operator=(const TBatcherCore &) = default;
 
+      /* In adaptive mode, get ACK latency estimates from 'stats' and publish
+         effective thresholds there under the name 'group'.  'stats' may be
+         null, in which case ACK latency is assumed to be 0. */
+      void SetAdaptiveStats(TAdaptiveBatchStats *stats,
+          const std::string &group) {
+        assert(this);
+        AdaptiveStats = stats;
+        Group = group;
+      }
+
       bool BatchingIsEnabled() const {
         assert(this);
         return Dory::Batch::BatchingIsEnabled(Config);
@@ -60,6 +73,13 @@ namespace Dory {
         return Config;
       }
 
+      /* Return the thresholds in effect for the current batch.  These are the
+         same as the configured thresholds unless batching is adaptive. */
+      const TBatchConfig &GetEffectiveConfig() const {
+        assert(this);
+        return Effective;
+      }
+
       bool IsEmpty() const {
         assert(this);
         return (MsgCount == 0);
@@ -77,6 +97,13 @@ namespace Dory {
 
       Base::TOpt<TMsg::TTimestamp> GetNextCompleteTime() const;
 
+      /* Replace the configuration without discarding the current batch, which
+         is held to the new thresholds from now on.  Return true if the
+         current batch is nonempty and complete under the new configuration,
+         in which case the caller should take it.  This is used when dory
+         reloads its config file. */
+      bool SetConfig(const TBatchConfig &config, TMsg::TTimestamp now);
+
       TAction ProcessNewMsg(TMsg::TTimestamp now, const TMsg::TPtr &msg);
 
       void ClearState();
@@ -99,8 +126,36 @@ namespace Dory {
 
       void UpdateState(TMsg::TTimestamp timestamp, size_t body_size);
 
+      /* Account for a new message of 'body_size' bytes in the arrival rate
+         measurement.  Return true if this finished a measurement interval,
+         updating 'ByteRate'. */
+      bool UpdateByteRate(TMsg::TTimestamp now, size_t body_size);
+
+      void ComputeEffectiveConfig();
+
+      void PublishStats() const;
+
       TBatchConfig Config;
 
+      /* Thresholds applied to the current batch.  In adaptive mode, these are
+         recomputed each time a new batch starts, so they stay fixed while a
+         batch is being built. */
+      TBatchConfig Effective;
+
+      TAdaptiveBatchStats *AdaptiveStats;
+
+      std::string Group;
+
+      /* Running average arrival rate in bytes per millisecond, or a negative
+         value if no rate has been measured yet. */
+      double ByteRate;
+
+      /* Start of the current arrival rate measurement interval, or 0 if no
+         message has arrived yet. */
+      TMsg::TTimestamp RateWindowStart;
+
+      size_t RateWindowBytes;
+
       TMsg::TTimestamp MinTimestamp;
 
       size_t MsgCount;
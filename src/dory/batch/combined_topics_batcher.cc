@@ -32,6 +32,22 @@ using namespace Dory;
 using namespace Dory::Batch;
 using namespace Dory::Util;
 
+bool TCombinedTopicsBatcher::TConfig::operator==(const TConfig &that) const {
+  assert(this);
+
+  if ((BatchConfig != that.BatchConfig) ||
+      (ExcludeTopicFilter != that.ExcludeTopicFilter)) {
+    return false;
+  }
+
+  if (TopicFilter == that.TopicFilter) {
+    return true;
+  }
+
+  return TopicFilter && that.TopicFilter &&
+      (*TopicFilter == *that.TopicFilter);
+}
+
 TCombinedTopicsBatcher::TCombinedTopicsBatcher(const TConfig &config)
     : CoreState(config.BatchConfig),
       TopicFilter(config.TopicFilter),
@@ -99,6 +115,22 @@ TCombinedTopicsBatcher::AddMsg(TMsg::TPtr &&msg, TMsg::TTimestamp now) {
   return TopicMap.Get();
 }
 
+std::list<std::list<TMsg::TPtr>>
+TCombinedTopicsBatcher::SetConfig(const TConfig &config,
+    TMsg::TTimestamp now) {
+  assert(this);
+  TopicFilter = config.TopicFilter;
+  ExcludeTopicFilter = config.ExcludeTopicFilter;
+
+  /* Messages already in the batch stay there even if the new topic filter
+     excludes their topics.  They go out with the rest of the batch. */
+  if (CoreState.SetConfig(config.BatchConfig, now)) {
+    return TakeBatch();
+  }
+
+  return std::list<std::list<TMsg::TPtr>>();
+}
+
 std::list<std::list<TMsg::TPtr>>
 TCombinedTopicsBatcher::TakeBatch() {
   assert(this);
@@ -78,6 +78,13 @@ namespace Dory {
 
         TConfig& operator=(TConfig &&) = default;
 
+        bool operator==(const TConfig &that) const;
+
+        bool operator!=(const TConfig &that) const {
+          assert(this);
+          return !(*this == that);
+        }
+
         private:
         TBatchConfig BatchConfig;
 
@@ -95,6 +102,13 @@ namespace Dory {
         return TConfig(CoreState.GetConfig(), TopicFilter, ExcludeTopicFilter);
       }
 
+      /* See TBatcherCore::SetAdaptiveStats(). */
+      void SetAdaptiveStats(TAdaptiveBatchStats *stats,
+          const std::string &group) {
+        assert(this);
+        CoreState.SetAdaptiveStats(stats, group);
+      }
+
       bool IsEmpty() const {
         assert(this);
         assert(CoreState.IsEmpty() == TopicMap.IsEmpty());
@@ -116,6 +130,13 @@ namespace Dory {
         return CoreState.GetNextCompleteTime();
       }
 
+      /* Replace the configuration, keeping the current batch unless it is
+         complete under the new configuration.  In that case, empty out the
+         batcher and return the batch, grouped by topic.  Otherwise return an
+         empty list.  This is used when dory reloads its config file. */
+      std::list<std::list<TMsg::TPtr>> SetConfig(const TConfig &config,
+          TMsg::TTimestamp now);
+
       /* Empty out the batcher, and return all messages it contained, grouped
          by topic. */
       std::list<std::list<TMsg::TPtr>> TakeBatch();
@@ -57,6 +57,31 @@ namespace Dory {
 
       TGlobalBatchConfig &operator=(TGlobalBatchConfig &&) = default;
 
+      /* Compares everything the dispatcher uses.  This is all fields, since
+         the dispatcher's broker message queues also do per topic batching, and
+         its produce request factories use both limits. */
+      bool operator==(const TGlobalBatchConfig &that) const {
+        assert(this);
+
+        if ((CombinedTopicsConfig != that.CombinedTopicsConfig) ||
+            (ProduceRequestDataLimit != that.ProduceRequestDataLimit) ||
+            (MessageMaxBytes != that.MessageMaxBytes)) {
+          return false;
+        }
+
+        if (PerTopicConfig == that.PerTopicConfig) {
+          return true;
+        }
+
+        return PerTopicConfig && that.PerTopicConfig &&
+            (*PerTopicConfig == *that.PerTopicConfig);
+      }
+
+      bool operator!=(const TGlobalBatchConfig &that) const {
+        assert(this);
+        return !(*this == that);
+      }
+
       void Clear() {
         assert(this);
         *this = TGlobalBatchConfig();
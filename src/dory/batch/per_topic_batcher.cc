@@ -30,11 +30,61 @@ using namespace Dory;
 using namespace Dory::Batch;
 
 TPerTopicBatcher::TPerTopicBatcher(const std::shared_ptr<TConfig> &config)
-    : Config(config) {
+    : Config(config),
+      AdaptiveStats(nullptr) {
 }
 
 TPerTopicBatcher::TPerTopicBatcher(std::shared_ptr<TConfig> &&config)
-    : Config(std::move(config)) {
+    : Config(std::move(config)),
+      AdaptiveStats(nullptr) {
+}
+
+std::list<std::list<TMsg::TPtr>>
+TPerTopicBatcher::SetConfig(const std::shared_ptr<TConfig> &config,
+    TMsg::TTimestamp now) {
+  assert(this);
+  Config = config;
+
+  if (!Config) {
+    std::list<std::list<TMsg::TPtr>> result = GetAllBatches();
+    BatchMap.clear();
+    return std::move(result);
+  }
+
+  std::list<std::list<TMsg::TPtr>> result;
+
+  /* Each topic's batcher holds a copy of the old configuration for its topic,
+     so update the ones whose configuration changed. */
+  for (auto &item : BatchMap) {
+    const TBatchConfig &topic_config = Config->Get(item.first);
+    TBatchMapEntry &entry = item.second;
+
+    if (entry.Batcher.GetConfig() == topic_config) {
+      continue;
+    }
+
+    if (entry.ExpiryRef != ExpiryTracker.end()) {
+      ExpiryTracker.erase(entry.ExpiryRef);
+      entry.ExpiryRef = ExpiryTracker.end();
+    }
+
+    std::list<TMsg::TPtr> batch =
+        entry.Batcher.SetConfig(topic_config, now);
+
+    if (!batch.empty()) {
+      result.push_back(std::move(batch));
+    }
+
+    TOpt<TMsg::TTimestamp> opt_nct = entry.Batcher.GetNextCompleteTime();
+
+    if (opt_nct.IsKnown()) {
+      entry.ExpiryRef = ExpiryTracker.insert(
+          TBatchExpiryRecord(*opt_nct, item.first));
+    }
+  }
+
+  result.splice(result.end(), GetCompleteBatches(now));
+  return std::move(result);
 }
 
 std::list<std::list<TMsg::TPtr>>
@@ -50,6 +100,7 @@ TPerTopicBatcher::AddMsg(TMsg::TPtr &&msg, TMsg::TTimestamp now) {
             TBatchMapEntry(Config->Get(topic), ExpiryTracker.end())));
     assert(result.second);
     iter = result.first;
+    iter->second.Batcher.SetAdaptiveStats(AdaptiveStats, GroupPrefix + topic);
   }
 
   std::list<std::list<TMsg::TPtr>> complete_topic_batches;
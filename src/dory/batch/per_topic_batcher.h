@@ -31,6 +31,7 @@
 
 #include <base/no_copy_semantics.h>
 #include <base/opt.h>
+#include <dory/batch/adaptive_batch_stats.h>
 #include <dory/batch/batch_config.h>
 #include <dory/batch/single_topic_batcher.h>
 #include <dory/msg.h>
@@ -59,6 +60,17 @@ namespace Dory {
 
         TConfig& operator=(TConfig &&) = default;
 
+        bool operator==(const TConfig &that) const {
+          assert(this);
+          return (DefaultTopic == that.DefaultTopic) &&
+              (PerTopic == that.PerTopic);
+        }
+
+        bool operator!=(const TConfig &that) const {
+          assert(this);
+          return !(*this == that);
+        }
+
         const TBatchConfig &Get(const std::string &topic) const {
           assert(this);
           auto iter = PerTopic.find(topic);
@@ -86,6 +98,27 @@ namespace Dory {
         return Config;
       }
 
+      /* For topics with adaptive batching, get ACK latency estimates from
+         'stats' and publish effective thresholds there.  The group name for
+         each topic is 'group_prefix' followed by the topic.  Applies to
+         topics not yet seen by the batcher, so should be called before any
+         messages are added. */
+      void SetAdaptiveStats(TAdaptiveBatchStats *stats,
+          const std::string &group_prefix) {
+        assert(this);
+        AdaptiveStats = stats;
+        GroupPrefix = group_prefix;
+      }
+
+      /* Replace the batching configuration, which may be null to disable
+         batching.  Incomplete batches are kept, and are held to their topics'
+         new thresholds from now on.  Return the batches that are complete
+         under the new configuration, including all batches for topics that no
+         longer have batching enabled.  This is used when dory reloads its
+         config file. */
+      std::list<std::list<TMsg::TPtr>>
+      SetConfig(const std::shared_ptr<TConfig> &config, TMsg::TTimestamp now);
+
       std::list<std::list<TMsg::TPtr>>
       AddMsg(TMsg::TPtr &&msg, TMsg::TTimestamp now);
 
@@ -191,6 +224,10 @@ namespace Dory {
       /* Per-topic batching configuration obtained from a config file. */
       std::shared_ptr<TConfig> Config;
 
+      TAdaptiveBatchStats *AdaptiveStats;
+
+      std::string GroupPrefix;
+
       /* Key is topic and value is batch of messages for topic. */
       std::unordered_map<std::string, TBatchMapEntry> BatchMap;
 
@@ -30,6 +30,7 @@
 #include <capped/reader.h>
 #include <dory/batch/batch_config.h>
 #include <dory/batch/batch_config_builder.h>
+#include <dory/batch/global_batch_config.h>
 #include <dory/msg.h>
 #include <dory/msg_creator.h>
 #include <dory/test_util/misc_util.h>
@@ -77,6 +78,18 @@ namespace {
     return std::move(builder.Build().GetPerTopicConfig());
   }
 
+  TGlobalBatchConfig MakeGlobalBatchConfig(size_t broker_time_limit,
+      size_t message_max_bytes) {
+    TBatchConfigBuilder builder;
+    TBatchConfig config;
+    config.TimeLimit = 10;
+    builder.AddTopic("t1", &config);
+    config.TimeLimit = broker_time_limit;
+    builder.SetBrokerConfig(&config);
+    builder.SetMessageMaxBytes(message_max_bytes);
+    return builder.Build();
+  }
+
   /* The fixture for testing class TPerTopicBatcher. */
   class TPerTopicBatcherTest : public ::testing::Test {
     protected:
@@ -93,6 +106,20 @@ namespace {
     }
   };  // TPerTopicBatcherTest
 
+  TEST_F(TPerTopicBatcherTest, ConfigEquality) {
+    /* On config file reload, the router thread restarts the dispatcher only
+       if the batch config differs. */
+    ASSERT_TRUE(*MakeTopicBatchConfig() == *MakeTopicBatchConfig());
+    ASSERT_TRUE(*MakeTopicBatchConfig() != *MakeDisabledTopicBatchConfig());
+    ASSERT_TRUE(MakeGlobalBatchConfig(5, 1000) ==
+        MakeGlobalBatchConfig(5, 1000));
+    ASSERT_TRUE(MakeGlobalBatchConfig(5, 1000) !=
+        MakeGlobalBatchConfig(6, 1000));
+    ASSERT_TRUE(MakeGlobalBatchConfig(5, 1000) !=
+        MakeGlobalBatchConfig(5, 2000));
+    ASSERT_TRUE(MakeGlobalBatchConfig(5, 1000) != TGlobalBatchConfig());
+  }
+
   TEST_F(TPerTopicBatcherTest, Test1) {
     TTestMsgCreator mc;  // create this first since it contains buffer pool
     TPerTopicBatcher batcher(MakeDisabledTopicBatchConfig());
@@ -356,6 +383,111 @@ namespace {
     ASSERT_FALSE(opt_nct.IsKnown());
   }
 
+  TEST_F(TPerTopicBatcherTest, SetConfigTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    TPerTopicBatcher batcher(MakeTopicBatchConfig());
+    TMsg::TPtr msg = mc.NewMsg("t1", "t1 msg 1", 5);
+    std::list<std::list<TMsg::TPtr>> complete_batches =
+        SetProcessed(batcher.AddMsg(std::move(msg), 5));
+    ASSERT_TRUE(complete_batches.empty());
+    msg = mc.NewMsg("t2", "t2 msg 1", 5);
+    complete_batches = SetProcessed(batcher.AddMsg(std::move(msg), 6));
+    ASSERT_TRUE(complete_batches.empty());
+    ASSERT_TRUE(batcher.GetNextCompleteTime().IsKnown());
+
+    /* Switching to a config with batching disabled for all topics should hand
+       back the incomplete batches. */
+    complete_batches = SetProcessed(
+        batcher.SetConfig(MakeDisabledTopicBatchConfig(), 6));
+    ASSERT_TRUE(batcher.SanityCheck());
+    ASSERT_EQ(complete_batches.size(), 2U);
+    ASSERT_FALSE(batcher.GetNextCompleteTime().IsKnown());
+
+    /* The new config applies to topics that were batched before. */
+    msg = mc.NewMsg("t1", "t1 msg 2", 5);
+    complete_batches = batcher.AddMsg(std::move(msg), 7);
+    ASSERT_TRUE(batcher.SanityCheck());
+    ASSERT_TRUE(!!msg);
+    SetProcessed(msg);
+    ASSERT_TRUE(complete_batches.empty());
+
+    /* Switch back, and check that batching resumes. */
+    complete_batches = batcher.SetConfig(MakeTopicBatchConfig(), 7);
+    ASSERT_TRUE(complete_batches.empty());
+    msg = mc.NewMsg("t1", "t1 msg 3", 5);
+    complete_batches = SetProcessed(batcher.AddMsg(std::move(msg), 8));
+    ASSERT_FALSE(!!msg);
+    ASSERT_TRUE(complete_batches.empty());
+    TOpt<TMsg::TTimestamp> opt_nct = batcher.GetNextCompleteTime();
+    ASSERT_TRUE(opt_nct.IsKnown());
+    ASSERT_EQ(*opt_nct, 15);
+    complete_batches = SetProcessed(batcher.GetAllBatches());
+    ASSERT_EQ(complete_batches.size(), 1U);
+  }
+
+  TEST_F(TPerTopicBatcherTest, SetConfigKeepBatchesTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    TPerTopicBatcher batcher(MakeTopicBatchConfig());
+    TMsg::TPtr msg = mc.NewMsg("t1", "t1 msg 1", 5);
+    std::list<std::list<TMsg::TPtr>> complete_batches =
+        SetProcessed(batcher.AddMsg(std::move(msg), 5));
+    ASSERT_TRUE(complete_batches.empty());
+    msg = mc.NewMsg("t2", "t2 msg 1", 5);
+    complete_batches = SetProcessed(batcher.AddMsg(std::move(msg), 5));
+    ASSERT_TRUE(complete_batches.empty());
+    msg = mc.NewMsg("t3", "t3 msg 1", 5);
+    complete_batches = SetProcessed(batcher.AddMsg(std::move(msg), 5));
+    ASSERT_TRUE(complete_batches.empty());
+    TOpt<TMsg::TTimestamp> opt_nct = batcher.GetNextCompleteTime();
+    ASSERT_TRUE(opt_nct.IsKnown());
+    ASSERT_EQ(*opt_nct, 15);
+
+    /* Topic t1 gets a longer time limit, t2 gets a message count limit its
+       batch already meets, and t3 is unchanged. */
+    TBatchConfigBuilder builder;
+    TBatchConfig config;
+    config.TimeLimit = 50;
+    config.MsgCount = 3;
+    builder.AddTopic("t1", &config);
+    config.TimeLimit = 20;
+    config.MsgCount = 1;
+    builder.AddTopic("t2", &config);
+    config.TimeLimit = 30;
+    config.MsgCount = 5;
+    builder.AddTopic("t3", &config);
+    config.TimeLimit = 40;
+    config.MsgCount = 3;
+    builder.SetDefaultTopic(&config);
+    complete_batches = SetProcessed(batcher.SetConfig(
+        builder.Build().GetPerTopicConfig(), 7));
+    ASSERT_TRUE(batcher.SanityCheck());
+
+    /* Only the batch that is complete under the new config comes back.  The
+       others keep their messages. */
+    ASSERT_EQ(complete_batches.size(), 1U);
+    ASSERT_EQ(complete_batches.front().size(), 1U);
+    ASSERT_EQ(complete_batches.front().front()->GetTopic(), "t2");
+    opt_nct = batcher.GetNextCompleteTime();
+    ASSERT_TRUE(opt_nct.IsKnown());
+    ASSERT_EQ(*opt_nct, 35);
+    complete_batches = SetProcessed(batcher.GetCompleteBatches(35));
+    ASSERT_EQ(complete_batches.size(), 1U);
+    ASSERT_EQ(complete_batches.front().front()->GetTopic(), "t3");
+    opt_nct = batcher.GetNextCompleteTime();
+    ASSERT_TRUE(opt_nct.IsKnown());
+    ASSERT_EQ(*opt_nct, 55);
+    msg = mc.NewMsg("t1", "t1 msg 2", 40);
+    complete_batches = SetProcessed(batcher.AddMsg(std::move(msg), 40));
+    ASSERT_FALSE(!!msg);
+    ASSERT_TRUE(complete_batches.empty());
+    msg = mc.NewMsg("t1", "t1 msg 3", 41);
+    complete_batches = SetProcessed(batcher.AddMsg(std::move(msg), 41));
+    ASSERT_FALSE(!!msg);
+    ASSERT_EQ(complete_batches.size(), 1U);
+    ASSERT_EQ(complete_batches.front().size(), 3U);
+    ASSERT_TRUE(batcher.SanityCheck());
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -59,6 +59,18 @@ namespace Dory {
         return CoreState.GetConfig();
       }
 
+      const TBatchConfig &GetEffectiveConfig() const {
+        assert(this);
+        return CoreState.GetEffectiveConfig();
+      }
+
+      /* See TBatcherCore::SetAdaptiveStats(). */
+      void SetAdaptiveStats(TAdaptiveBatchStats *stats,
+          const std::string &group) {
+        assert(this);
+        CoreState.SetAdaptiveStats(stats, group);
+      }
+
       bool BatchingIsEnabled() const {
         assert(this);
         return CoreState.BatchingIsEnabled();
@@ -77,6 +89,20 @@ namespace Dory {
         return CoreState.GetNextCompleteTime();
       }
 
+      /* Replace the configuration, keeping the current batch unless it is
+         complete under the new configuration.  In that case, empty out the
+         batcher and return the batch.  Otherwise return an empty list. */
+      std::list<TMsg::TPtr> SetConfig(const TBatchConfig &config,
+          TMsg::TTimestamp now) {
+        assert(this);
+
+        if (CoreState.SetConfig(config, now)) {
+          return TakeBatch();
+        }
+
+        return std::list<TMsg::TPtr>();
+      }
+
       /* Empty out the batcher, and return all messages it contained. */
       std::list<TMsg::TPtr> TakeBatch() {
         assert(this);
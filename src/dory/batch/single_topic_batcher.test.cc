@@ -23,6 +23,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <capped/blob.h>
 #include <capped/pool.h>
@@ -287,6 +288,133 @@ namespace {
     ASSERT_TRUE(batcher.IsEmpty());
   }
 
+  TEST_F(TSingleTopicBatcherTest, AdaptiveTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+
+    /* Latency budget of 20 ms, with upper bounds of 50 ms and 1000 bytes.
+       Brokers take 5 ms to ACK, leaving 15 ms for batching. */
+    TBatchConfig config(50, 0, 1000, 20);
+    TAdaptiveBatchStats stats;
+    stats.RecordAckLatency(5);
+    ASSERT_EQ(stats.GetAckLatency(), 5U);
+    TSingleTopicBatcher batcher(config);
+    batcher.SetAdaptiveStats(&stats, "topic Bugs Bunny");
+    ASSERT_TRUE(batcher.BatchingIsEnabled());
+    TMsg::TPtr msg = mc.NewMsg("Bugs Bunny", "wabbits", 100);
+    std::list<TMsg::TPtr> msg_list =
+        SetProcessed(batcher.AddMsg(std::move(msg), 100));
+    ASSERT_FALSE(!!msg);
+    ASSERT_TRUE(msg_list.empty());
+    ASSERT_EQ(batcher.GetEffectiveConfig().TimeLimit, 15U);
+
+    /* No arrival rate is known yet, so the configured byte limit applies. */
+    ASSERT_EQ(batcher.GetEffectiveConfig().ByteCount, 1000U);
+    TOpt<TMsg::TTimestamp> opt_ts = batcher.GetNextCompleteTime();
+    ASSERT_TRUE(opt_ts.IsKnown());
+    ASSERT_EQ(*opt_ts, 115U);
+    msg = mc.NewMsg("Bugs Bunny", "x", 110);
+    msg_list = SetProcessed(batcher.AddMsg(std::move(msg), 110));
+    ASSERT_FALSE(!!msg);
+    ASSERT_TRUE(msg_list.empty());
+    msg_list = SetProcessed(batcher.TakeBatch());
+    ASSERT_EQ(msg_list.size(), 2U);
+
+    /* This finishes the first 20 ms measurement interval, in which 15 bytes
+       arrived.  At 0.75 bytes per ms, we expect about 11 bytes within the
+       15 ms time limit, so the new batch is limited to that. */
+    msg = mc.NewMsg("Bugs Bunny", "wabbits", 120);
+    msg_list = SetProcessed(batcher.AddMsg(std::move(msg), 120));
+    ASSERT_FALSE(!!msg);
+    ASSERT_TRUE(msg_list.empty());
+    ASSERT_EQ(batcher.GetEffectiveConfig().TimeLimit, 15U);
+    ASSERT_EQ(batcher.GetEffectiveConfig().ByteCount, 11U);
+    std::vector<TAdaptiveBatchStats::TGroupStatsItem> group_stats;
+    stats.GetStats(group_stats);
+    ASSERT_EQ(group_stats.size(), 1U);
+    ASSERT_EQ(group_stats[0].first, "topic Bugs Bunny");
+    ASSERT_EQ(group_stats[0].second.LatencyTarget, 20U);
+    ASSERT_EQ(group_stats[0].second.TimeLimit, 15U);
+    ASSERT_EQ(group_stats[0].second.ByteCount, 11U);
+    ASSERT_EQ(group_stats[0].second.ByteRate, 750U);
+    ASSERT_EQ(group_stats[0].second.AckLatency, 5U);
+    msg = mc.NewMsg("Bugs Bunny", "1234", 121);
+    msg_list = SetProcessed(batcher.AddMsg(std::move(msg), 121));
+    ASSERT_FALSE(!!msg);
+    ASSERT_EQ(msg_list.size(), 2U);
+    ASSERT_TRUE(batcher.IsEmpty());
+  }
+
+  TEST_F(TSingleTopicBatcherTest, AdaptiveLimitsTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+
+    /* With no ACK latency estimate, the whole 20 ms budget would be available,
+       but the configured time limit of 10 ms is an upper bound. */
+    TBatchConfig config(10, 0, 0, 20);
+    TSingleTopicBatcher batcher(config);
+    TMsg::TPtr msg = mc.NewMsg("Bugs Bunny", "wabbits", 0);
+    std::list<TMsg::TPtr> msg_list =
+        SetProcessed(batcher.AddMsg(std::move(msg), 0));
+    ASSERT_FALSE(!!msg);
+    ASSERT_EQ(batcher.GetEffectiveConfig().TimeLimit, 10U);
+    ASSERT_EQ(batcher.GetEffectiveConfig().ByteCount, 0U);
+    msg_list = SetProcessed(batcher.TakeBatch());
+    ASSERT_EQ(msg_list.size(), 1U);
+
+    /* If brokers take longer to ACK than the whole budget, batch for as
+       short a time as possible. */
+    TAdaptiveBatchStats stats;
+    stats.RecordAckLatency(30);
+    TSingleTopicBatcher slow_batcher(config);
+    slow_batcher.SetAdaptiveStats(&stats, "topic Bugs Bunny");
+    msg = mc.NewMsg("Bugs Bunny", "wabbits", 0);
+    msg_list = SetProcessed(slow_batcher.AddMsg(std::move(msg), 0));
+    ASSERT_FALSE(!!msg);
+    ASSERT_TRUE(msg_list.empty());
+    ASSERT_EQ(slow_batcher.GetEffectiveConfig().TimeLimit, 1U);
+    msg = mc.NewMsg("Bugs Bunny", "x", 0);
+    msg_list = SetProcessed(slow_batcher.AddMsg(std::move(msg), 1));
+    ASSERT_FALSE(!!msg);
+    ASSERT_EQ(msg_list.size(), 2U);
+  }
+
+  TEST_F(TSingleTopicBatcherTest, AdaptiveRateIncreaseTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+
+    /* Latency budget of 20 ms, with no ACK latency estimate. */
+    TBatchConfig config(1000, 0, 100000, 20);
+    TSingleTopicBatcher batcher(config);
+    TMsg::TTimestamp now = 0;
+    std::list<TMsg::TPtr> msg_list;
+
+    /* Light traffic: a 10 byte message every 15 ms. */
+    for (; now < 100; now += 15) {
+      TMsg::TPtr msg = mc.NewMsg("Bugs Bunny", "0123456789", now);
+      msg_list = SetProcessed(batcher.AddMsg(std::move(msg), now));
+      ASSERT_FALSE(!!msg);
+    }
+
+    size_t light_byte_count = batcher.GetEffectiveConfig().ByteCount;
+    ASSERT_LT(light_byte_count, 20U);
+
+    /* Traffic rises to a 10 byte message every ms.  Each message overflows
+       the small byte limit, so every batch closes on the byte limit with the
+       next message starting a new batch.  The thresholds must still adapt. */
+    size_t batch_count = 0;
+
+    for (; now < 300; ++now) {
+      TMsg::TPtr msg = mc.NewMsg("Bugs Bunny", "0123456789", now);
+      msg_list = SetProcessed(batcher.AddMsg(std::move(msg), now));
+      ASSERT_FALSE(!!msg);
+
+      if (!msg_list.empty()) {
+        ++batch_count;
+      }
+    }
+
+    ASSERT_GT(batcher.GetEffectiveConfig().ByteCount, 10 * light_byte_count);
+    ASSERT_LT(batch_count, 100U);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
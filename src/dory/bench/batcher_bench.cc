@@ -0,0 +1,149 @@
+/* <dory/bench/batcher_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/batcher_bench.h>.
+ */
+
+#include <dory/bench/batcher_bench.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <dory/batch/batch_config.h>
+#include <dory/batch/batch_config_builder.h>
+#include <dory/batch/combined_topics_batcher.h>
+#include <dory/batch/per_topic_batcher.h>
+#include <dory/bench/bench_util.h>
+#include <dory/msg.h>
+
+using namespace Dory;
+using namespace Dory::Batch;
+using namespace Dory::Bench;
+
+namespace {
+
+  /* Messages in each complete batch. */
+  const size_t BATCH_MSG_COUNT = 64;
+
+  /* Messages are created this many at a time outside the timed region. */
+  const size_t CHUNK_SIZE = 4096;
+
+  const size_t VALUE_SIZE = 100;
+
+  std::vector<std::string> MakeTopics(size_t count) {
+    std::vector<std::string> result;
+
+    for (size_t i = 0; i < count; ++i) {
+      result.push_back("bench_topic_" + std::to_string(i));
+    }
+
+    return result;
+  }
+
+  /* Feed 'iterations' messages to 'add_msg', which returns complete
+     batches, and return the time spent in 'add_msg'. */
+  template <typename TAddMsg>
+  uint64_t FeedMsgs(size_t iterations, const std::vector<std::string> &topics,
+      TBenchMsgs &msgs, TAddMsg add_msg) {
+    TStopwatch sw;
+    std::list<TMsg::TPtr> input;
+    std::list<std::list<TMsg::TPtr>> done;
+
+    for (size_t i = 0; i < iterations; i += CHUNK_SIZE) {
+      msgs.Create(topics, std::min(CHUNK_SIZE, iterations - i), input);
+      sw.Start();
+
+      for (TMsg::TPtr &msg : input) {
+        done.splice(done.end(), add_msg(std::move(msg)));
+      }
+
+      sw.Stop();
+      TBenchMsgs::Destroy(input);
+      TBenchMsgs::Destroy(done);
+    }
+
+    return sw.GetElapsedNs();
+  }
+
+  void RunPerTopic(TBenchHarness &harness, size_t topic_count) {
+    std::string name = "per_topic_batcher/add_msg/topics_" +
+        std::to_string(topic_count);
+
+    if (!harness.IsSelected(name)) {
+      return;
+    }
+
+    std::vector<std::string> topics = MakeTopics(topic_count);
+    TBatchConfigBuilder builder;
+    TBatchConfig config(0, BATCH_MSG_COUNT, 0);
+    builder.SetDefaultTopic(&config);
+    TPerTopicBatcher batcher(builder.Build().GetPerTopicConfig());
+    TBenchMsgs msgs(0, VALUE_SIZE);
+    harness.Run(name, VALUE_SIZE,
+        [&](size_t iterations) {
+          uint64_t ns = FeedMsgs(iterations, topics, msgs,
+              [&batcher](TMsg::TPtr &&msg) {
+                return batcher.AddMsg(std::move(msg), 0);
+              });
+          std::list<std::list<TMsg::TPtr>> rest = batcher.GetAllBatches();
+          TBenchMsgs::Destroy(rest);
+          return ns;
+        });
+  }
+
+  void RunCombinedTopics(TBenchHarness &harness, size_t topic_count) {
+    std::string name = "combined_topics_batcher/add_msg/topics_" +
+        std::to_string(topic_count);
+
+    if (!harness.IsSelected(name)) {
+      return;
+    }
+
+    std::vector<std::string> topics = MakeTopics(topic_count);
+
+    /* An empty exclusion filter lets all topics be batched together. */
+    TCombinedTopicsBatcher batcher(TCombinedTopicsBatcher::TConfig(
+        TBatchConfig(0, BATCH_MSG_COUNT, 0),
+        std::make_shared<TCombinedTopicsBatcher::TTopicFilter>(), true));
+    TBenchMsgs msgs(0, VALUE_SIZE);
+    harness.Run(name, VALUE_SIZE,
+        [&](size_t iterations) {
+          uint64_t ns = FeedMsgs(iterations, topics, msgs,
+              [&batcher](TMsg::TPtr &&msg) {
+                return batcher.AddMsg(std::move(msg), 0);
+              });
+          std::list<std::list<TMsg::TPtr>> rest = batcher.TakeBatch();
+          TBenchMsgs::Destroy(rest);
+          return ns;
+        });
+  }
+
+}  // namespace
+
+void Dory::Bench::RunBatcherBenchmarks(TBenchHarness &harness) {
+  for (size_t topic_count : {1, 16, 256}) {
+    RunPerTopic(harness, topic_count);
+    RunCombinedTopics(harness, topic_count);
+  }
+}
@@ -0,0 +1,165 @@
+/* <dory/bench/bench_harness.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/bench_harness.h>.
+ */
+
+#include <dory/bench/bench_harness.h>
+
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include <base/indent.h>
+#include <dory/build_id.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Bench;
+
+TBenchHarness::TBenchHarness(const std::string &filter, size_t min_time_ms,
+    size_t repetitions)
+    : Filter(filter),
+      MinTimeNs(std::max<uint64_t>(min_time_ms, 1) * 1000000),
+      Repetitions(std::max<size_t>(repetitions, 1)) {
+}
+
+bool TBenchHarness::IsSelected(const std::string &name) const {
+  assert(this);
+  return Filter.empty() || (name.find(Filter) != std::string::npos);
+}
+
+void TBenchHarness::Run(const std::string &name, size_t bytes_per_op,
+    const TBenchFn &fn) {
+  assert(this);
+
+  if (!IsSelected(name)) {
+    return;
+  }
+
+  TBenchResult result;
+  result.Name = name;
+  result.BytesPerOp = bytes_per_op;
+  std::vector<double> ns_per_op;
+
+  try {
+    result.Iterations = Calibrate(fn);
+
+    for (size_t i = 0; i < Repetitions; ++i) {
+      uint64_t ns = fn(result.Iterations);
+      ns_per_op.push_back(static_cast<double>(ns) /
+          static_cast<double>(result.Iterations));
+    }
+  } catch (const std::exception &x) {
+    /* Report the failure but keep going, so one broken case doesn't hide
+       the results of all the others. */
+    std::cerr << "skipping " << name << ": " << x.what() << std::endl;
+    return;
+  }
+
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+  result.NsPerOp = ns_per_op[ns_per_op.size() / 2];
+  result.MinNsPerOp = ns_per_op.front();
+  result.MaxNsPerOp = ns_per_op.back();
+  std::cerr << std::left << std::setw(48) << name << std::right << std::fixed
+      << std::setprecision(1) << std::setw(12) << result.NsPerOp << " ns/op";
+
+  if (bytes_per_op && (result.NsPerOp > 0)) {
+    std::cerr << std::setw(10) << (static_cast<double>(bytes_per_op) * 1000.0
+        / result.NsPerOp) << " MB/s";
+  }
+
+  std::cerr << std::endl;
+  Results.push_back(std::move(result));
+}
+
+void TBenchHarness::WriteJson(std::ostream &os) const {
+  assert(this);
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"min_time_ms\": " << (MinTimeNs / 1000000) << ","
+        << std::endl
+        << ind1 << "\"repetitions\": " << Repetitions << "," << std::endl
+        << ind1 << "\"results\": [" << std::endl;
+
+    for (size_t i = 0; i < Results.size(); ++i) {
+      const TBenchResult &r = Results[i];
+      TIndent ind2(ind1);
+      os << ind2 << "{" << std::endl;
+
+      {
+        TIndent ind3(ind2);
+        os << ind3 << "\"name\": \"" << r.Name << "\"," << std::endl
+            << ind3 << "\"iterations\": " << r.Iterations << "," << std::endl
+            << ind3 << "\"ns_per_op\": " << r.NsPerOp << "," << std::endl
+            << ind3 << "\"min_ns_per_op\": " << r.MinNsPerOp << ","
+            << std::endl
+            << ind3 << "\"max_ns_per_op\": " << r.MaxNsPerOp << ","
+            << std::endl
+            << ind3 << "\"ops_per_sec\": "
+            << ((r.NsPerOp > 0) ? (1e9 / r.NsPerOp) : 0.0) << ","
+            << std::endl
+            << ind3 << "\"bytes_per_op\": " << r.BytesPerOp << ","
+            << std::endl
+            << ind3 << "\"mb_per_sec\": "
+            << ((r.NsPerOp > 0) ?
+                (static_cast<double>(r.BytesPerOp) * 1000.0 / r.NsPerOp) :
+                0.0)
+            << std::endl;
+      }
+
+      os << ind2 << ((i + 1 < Results.size()) ? "}," : "}") << std::endl;
+    }
+
+    os << ind1 << "]" << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+size_t TBenchHarness::Calibrate(const TBenchFn &fn) const {
+  assert(this);
+  const size_t max_iterations = std::numeric_limits<uint32_t>::max();
+  size_t iterations = 1;
+
+  /* Grow the iteration count until a run takes long enough to give a
+     reasonable estimate, then scale it up to the minimum time. */
+  for (; ; ) {
+    uint64_t ns = std::max<uint64_t>(fn(iterations), 1);
+
+    if (ns >= MinTimeNs) {
+      return iterations;
+    }
+
+    if ((ns >= (MinTimeNs / 10)) || (iterations >= max_iterations)) {
+      double scaled = static_cast<double>(iterations) *
+          static_cast<double>(MinTimeNs) / static_cast<double>(ns);
+      return static_cast<size_t>(std::min(scaled * 1.1,
+          static_cast<double>(max_iterations))) + 1;
+    }
+
+    iterations = std::min(iterations * 10, max_iterations);
+  }
+}
@@ -0,0 +1,149 @@
+/* <dory/bench/bench_harness.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Minimal timing harness for Dory's microbenchmarks.  Each benchmark case is
+   run with an iteration count chosen so that one repetition takes at least a
+   minimum amount of time, and the results are written as JSON so they can be
+   compared from commit to commit.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  namespace Bench {
+
+    /* Accumulates elapsed time over any number of Start()/Stop() intervals,
+       so a benchmark case can leave its setup work out of the measurement. */
+    class TStopwatch final {
+      NO_COPY_SEMANTICS(TStopwatch);
+
+      public:
+      TStopwatch()
+          : ElapsedNs(0) {
+      }
+
+      void Start() {
+        assert(this);
+        StartTime = std::chrono::steady_clock::now();
+      }
+
+      void Stop() {
+        assert(this);
+        ElapsedNs += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - StartTime).count());
+      }
+
+      uint64_t GetElapsedNs() const {
+        assert(this);
+        return ElapsedNs;
+      }
+
+      private:
+      std::chrono::steady_clock::time_point StartTime;
+
+      uint64_t ElapsedNs;
+    };  // TStopwatch
+
+    /* A benchmark case performs its operation 'iterations' times and returns
+       the time in nanoseconds spent on the operation itself. */
+    using TBenchFn = std::function<uint64_t (size_t iterations)>;
+
+    struct TBenchResult {
+      std::string Name;
+
+      /* Iterations per repetition. */
+      size_t Iterations;
+
+      /* Bytes processed by one operation, or 0 if not meaningful. */
+      size_t BytesPerOp;
+
+      /* Median, fastest, and slowest time per operation over all
+         repetitions. */
+      double NsPerOp;
+
+      double MinNsPerOp;
+
+      double MaxNsPerOp;
+
+      TBenchResult()
+          : Iterations(0),
+            BytesPerOp(0),
+            NsPerOp(0),
+            MinNsPerOp(0),
+            MaxNsPerOp(0) {
+      }
+    };  // TBenchResult
+
+    class TBenchHarness final {
+      NO_COPY_SEMANTICS(TBenchHarness);
+
+      public:
+      /* Only cases whose names contain 'filter' are run (an empty filter
+         matches everything).  Each case is repeated 'repetitions' times, with
+         each repetition taking at least 'min_time_ms' milliseconds. */
+      TBenchHarness(const std::string &filter, size_t min_time_ms,
+          size_t repetitions);
+
+      /* Return true if a case named 'name' would be run.  Callers can use
+         this to skip expensive setup for filtered out cases. */
+      bool IsSelected(const std::string &name) const;
+
+      /* Run case 'name' if selected, and record its result.  If nonzero,
+         'bytes_per_op' is used to report throughput.  If 'fn' throws, the
+         error is reported to stderr and no result is recorded. */
+      void Run(const std::string &name, size_t bytes_per_op,
+          const TBenchFn &fn);
+
+      const std::vector<TBenchResult> &GetResults() const {
+        assert(this);
+        return Results;
+      }
+
+      /* Write all results recorded so far as a JSON document. */
+      void WriteJson(std::ostream &os) const;
+
+      private:
+      /* Return an iteration count for which one call to 'fn' takes at least
+         the minimum time. */
+      size_t Calibrate(const TBenchFn &fn) const;
+
+      const std::string Filter;
+
+      const uint64_t MinTimeNs;
+
+      const size_t Repetitions;
+
+      std::vector<TBenchResult> Results;
+    };  // TBenchHarness
+
+  }  // Bench
+
+}  // Dory
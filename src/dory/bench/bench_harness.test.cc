@@ -0,0 +1,139 @@
+/* <dory/bench/bench_harness.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/bench/bench_harness.h>.
+ */
+
+#include <dory/bench/bench_harness.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace Dory;
+using namespace Dory::Bench;
+
+namespace {
+
+  /* The fixture for testing class TBenchHarness. */
+  class TBenchHarnessTest : public ::testing::Test {
+    protected:
+    TBenchHarnessTest() {
+    }
+
+    virtual ~TBenchHarnessTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TBenchHarnessTest
+
+  TEST_F(TBenchHarnessTest, CalibrationTest) {
+    TBenchHarness harness("", 5, 3);
+    size_t calls = 0;
+    size_t max_iterations = 0;
+
+    /* Pretend each iteration takes 1 microsecond. */
+    harness.Run("fake/case", 100,
+        [&](size_t iterations) {
+          ++calls;
+          max_iterations = std::max(max_iterations, iterations);
+          return static_cast<uint64_t>(iterations) * 1000;
+        });
+    ASSERT_EQ(harness.GetResults().size(), 1U);
+    const TBenchResult &r = harness.GetResults()[0];
+    ASSERT_EQ(r.Name, "fake/case");
+    ASSERT_EQ(r.BytesPerOp, 100U);
+
+    /* 5 ms at 1 microsecond per iteration needs at least 5000
+       iterations. */
+    ASSERT_GE(r.Iterations, 5000U);
+    ASSERT_EQ(r.Iterations, max_iterations);
+    ASSERT_GT(calls, 3U);
+    ASSERT_DOUBLE_EQ(r.NsPerOp, 1000.0);
+    ASSERT_DOUBLE_EQ(r.MinNsPerOp, 1000.0);
+    ASSERT_DOUBLE_EQ(r.MaxNsPerOp, 1000.0);
+  }
+
+  TEST_F(TBenchHarnessTest, FilterTest) {
+    TBenchHarness harness("gate", 1, 1);
+    ASSERT_TRUE(harness.IsSelected("gate/put_get"));
+    ASSERT_FALSE(harness.IsSelected("pool/alloc_free"));
+    bool ran = false;
+    harness.Run("pool/alloc_free", 0,
+        [&](size_t iterations) {
+          ran = true;
+          return static_cast<uint64_t>(iterations) * 1000000;
+        });
+    ASSERT_FALSE(ran);
+    ASSERT_TRUE(harness.GetResults().empty());
+  }
+
+  TEST_F(TBenchHarnessTest, ErrorTest) {
+    TBenchHarness harness("", 1, 1);
+    harness.Run("bad", 0,
+        [](size_t) -> uint64_t {
+          throw std::runtime_error("broken");
+        });
+    harness.Run("good", 0,
+        [](size_t iterations) {
+          return static_cast<uint64_t>(iterations) * 1000000;
+        });
+    ASSERT_EQ(harness.GetResults().size(), 1U);
+    ASSERT_EQ(harness.GetResults()[0].Name, "good");
+  }
+
+  TEST_F(TBenchHarnessTest, JsonTest) {
+    TBenchHarness harness("", 1, 1);
+
+    for (const char *name : {"a/b", "c/d"}) {
+      harness.Run(name, 10,
+          [](size_t iterations) {
+            return static_cast<uint64_t>(iterations) * 1000000;
+          });
+    }
+
+    std::ostringstream os;
+    harness.WriteJson(os);
+    std::string json = os.str();
+    ASSERT_NE(json.find("\"name\": \"a/b\","), std::string::npos);
+    ASSERT_NE(json.find("\"name\": \"c/d\","), std::string::npos);
+    ASSERT_NE(json.find("\"ns_per_op\": 1e+06,"), std::string::npos);
+    ASSERT_NE(json.find("\"bytes_per_op\": 10,"), std::string::npos);
+    ASSERT_NE(json.find("\"repetitions\": 1,"), std::string::npos);
+
+    /* Results are separated by commas, with none after the last. */
+    ASSERT_NE(json.find("},\n"), std::string::npos);
+    ASSERT_EQ(json.find("},\n    ]"), std::string::npos);
+    ASSERT_EQ(json.back(), '\n');
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
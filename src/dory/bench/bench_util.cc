@@ -0,0 +1,90 @@
+/* <dory/bench/bench_util.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/bench_util.h>.
+ */
+
+#include <dory/bench/bench_util.h>
+
+#include <utility>
+#include <vector>
+
+#include <dory/msg_creator.h>
+
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Bench;
+
+TBenchMsgs::TBenchMsgs(size_t key_size, size_t value_size)
+    : Key(key_size, 'k'),
+      Value(value_size, 'v'),
+      /* Enough for several thousand messages of the largest sizes the
+         benchmarks use to be outstanding at once. */
+      Pool(256, 256 * 1024, TPool::TSync::Mutexed) {
+}
+
+void TBenchMsgs::Create(const std::vector<std::string> &topics, size_t count,
+    std::list<TMsg::TPtr> &result) {
+  assert(this);
+  assert(!topics.empty());
+
+  for (size_t i = 0; i < count; ++i) {
+    result.push_back(CreateOne(topics[i % topics.size()]));
+  }
+}
+
+TMsg::TPtr TBenchMsgs::CreateOne(const std::string &topic) {
+  assert(this);
+  return TMsgCreator::CreateAnyPartitionMsg(0, topic.data(),
+      topic.data() + topic.size(), Key.data(), Key.size(), Value.data(),
+      Value.size(), false, Pool, MsgStateTracker);
+}
+
+void TBenchMsgs::Destroy(std::list<TMsg::TPtr> &msgs) {
+  for (TMsg::TPtr &msg : msgs) {
+    if (msg) {
+      msg->SetState(TMsg::TState::Processed);
+    }
+  }
+
+  msgs.clear();
+}
+
+void TBenchMsgs::Destroy(std::list<std::list<TMsg::TPtr>> &batches) {
+  for (std::list<TMsg::TPtr> &batch : batches) {
+    Destroy(batch);
+  }
+
+  batches.clear();
+}
+
+std::unique_ptr<TConfig> Dory::Bench::MakeDefaultDoryConfig() {
+  /* These options are required, but their values don't matter here. */
+  std::vector<const char *> args;
+  args.push_back("dory");
+  args.push_back("--config_path");
+  args.push_back("/nonexistent/path");
+  args.push_back("--msg_buffer_max");
+  args.push_back("1");
+  args.push_back("--receive_socket_name");
+  args.push_back("dummy_value");
+  args.push_back(nullptr);
+  return std::unique_ptr<TConfig>(new TConfig(
+      static_cast<int>(args.size() - 1), const_cast<char **>(&args[0]),
+      true));
+}
@@ -0,0 +1,89 @@
+/* <dory/bench/bench_util.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Helpers shared by Dory's microbenchmarks.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <capped/pool.h>
+#include <dory/config.h>
+#include <dory/msg.h>
+#include <dory/msg_state_tracker.h>
+
+namespace Dory {
+
+  namespace Bench {
+
+    /* Creates AnyPartition messages with fixed size keys and values.  The
+       message contents are filler, since none of the benchmarked code looks
+       at them. */
+    class TBenchMsgs final {
+      NO_COPY_SEMANTICS(TBenchMsgs);
+
+      public:
+      TBenchMsgs(size_t key_size, size_t value_size);
+
+      /* Create 'count' messages, assigning topics from 'topics' round-robin,
+         and append them to 'result'. */
+      void Create(const std::vector<std::string> &topics, size_t count,
+          std::list<TMsg::TPtr> &result);
+
+      TMsg::TPtr CreateOne(const std::string &topic);
+
+      /* Destroy messages, first marking them processed so their destructors
+         don't complain. */
+      static void Destroy(std::list<TMsg::TPtr> &msgs);
+
+      static void Destroy(std::list<std::list<TMsg::TPtr>> &batches);
+
+      Capped::TPool &GetPool() {
+        assert(this);
+        return Pool;
+      }
+
+      TMsgStateTracker &GetMsgStateTracker() {
+        assert(this);
+        return MsgStateTracker;
+      }
+
+      private:
+      const std::string Key;
+
+      const std::string Value;
+
+      Capped::TPool Pool;
+
+      TMsgStateTracker MsgStateTracker;
+    };  // TBenchMsgs
+
+    /* Return a Dory config with default settings, for code that requires
+       one. */
+    std::unique_ptr<TConfig> MakeDefaultDoryConfig();
+
+  }  // Bench
+
+}  // Dory
@@ -0,0 +1,179 @@
+/* <dory/bench/compression_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/compression_bench.h>.
+ */
+
+#include <dory/bench/compression_bench.h>
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <base/opt.h>
+#include <dory/compress/compression_codec_api.h>
+#include <dory/compress/compression_type.h>
+#include <dory/compress/get_compression_codec.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Bench;
+using namespace Dory::Compress;
+
+namespace {
+
+  struct TPayload {
+    const char *Name;
+
+    std::vector<uint8_t> Data;
+  };  // TPayload
+
+  /* Log-like text, which is typical of what Dory's clients send. */
+  std::vector<uint8_t> MakeTextPayload(size_t size) {
+    static const char *const words[] = {
+      "GET", "POST", "/api/v1/users", "/api/v1/orders", "200", "404",
+      "latency_ms", "user_id", "session", "request", "OK", "timeout"
+    };
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+    std::string text;
+    uint64_t n = 0;
+
+    while (text.size() < size) {
+      text += "{\"ts\": ";
+      text += std::to_string(1500000000000 + (n * 37));
+      text += ", \"msg\": \"";
+      text += words[n % word_count];
+      text += " ";
+      text += words[(n * 7) % word_count];
+      text += "\", \"value\": ";
+      text += std::to_string((n * 2654435761) % 100000);
+      text += "}\n";
+      ++n;
+    }
+
+    return std::vector<uint8_t>(text.begin(), text.begin() + size);
+  }
+
+  /* Pseudorandom bytes, which don't compress. */
+  std::vector<uint8_t> MakeRandomPayload(size_t size) {
+    std::vector<uint8_t> result(size);
+    uint64_t state = 88172645463325252ULL;
+
+    for (uint8_t &b : result) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      b = static_cast<uint8_t>(state >> 32);
+    }
+
+    return result;
+  }
+
+  void RunCodec(TBenchHarness &harness, const char *codec_name,
+      const TCompressionCodecApi &codec, const std::vector<int> &levels,
+      const std::vector<TPayload> &payloads) {
+    for (const TPayload &payload : payloads) {
+      const std::vector<uint8_t> &in = payload.Data;
+      std::string suffix = std::string("/") + payload.Name + "/" +
+          std::to_string(in.size());
+      std::vector<uint8_t> compressed;
+
+      for (int level : levels) {
+        TOpt<int> opt_level;
+
+        if (level >= 0) {
+          opt_level.MakeKnown(level);
+        }
+
+        std::string level_name = opt_level.IsKnown() ?
+            ("/level_" + std::to_string(level)) : std::string();
+        std::vector<uint8_t> out(codec.ComputeCompressedResultBufSpace(
+            &in[0], in.size(), opt_level));
+        size_t out_size = 0;
+        harness.Run(std::string("compress/") + codec_name + level_name +
+            suffix, in.size(),
+            [&](size_t iterations) {
+              TStopwatch sw;
+              sw.Start();
+
+              for (size_t i = 0; i < iterations; ++i) {
+                out_size = codec.Compress(&in[0], in.size(), &out[0],
+                    out.size(), opt_level);
+              }
+
+              sw.Stop();
+              return sw.GetElapsedNs();
+            });
+
+        if (compressed.empty()) {
+          /* Keep the output of the first level for the uncompress case. */
+          out_size = codec.Compress(&in[0], in.size(), &out[0], out.size(),
+              opt_level);
+          compressed.assign(out.begin(), out.begin() + out_size);
+        }
+      }
+
+      std::vector<uint8_t> out(codec.ComputeUncompressedResultBufSpace(
+          &compressed[0], compressed.size()));
+      harness.Run(std::string("uncompress/") + codec_name + suffix, in.size(),
+          [&](size_t iterations) {
+            TStopwatch sw;
+            sw.Start();
+
+            for (size_t i = 0; i < iterations; ++i) {
+              codec.Uncompress(&compressed[0], compressed.size(), &out[0],
+                  out.size());
+            }
+
+            sw.Stop();
+            return sw.GetElapsedNs();
+          });
+    }
+  }
+
+}  // namespace
+
+void Dory::Bench::RunCompressionBenchmarks(TBenchHarness &harness) {
+  std::vector<TPayload> payloads;
+
+  for (size_t size : {1024, 64 * 1024}) {
+    payloads.push_back(TPayload{"text", MakeTextPayload(size)});
+    payloads.push_back(TPayload{"random", MakeRandomPayload(size)});
+    payloads.push_back(TPayload{"zeros", std::vector<uint8_t>(size, 0)});
+  }
+
+  /* A negative level means "use the codec's default". */
+  RunCodec(harness, "gzip", *GetCompressionCodec(TCompressionType::Gzip),
+      {1, 6, 9}, payloads);
+  RunCodec(harness, "lz4", *GetCompressionCodec(TCompressionType::Lz4),
+      {0, 9}, payloads);
+  const TCompressionCodecApi *snappy = nullptr;
+
+  try {
+    /* Snappy is loaded with dlopen(), so it may not be installed. */
+    snappy = GetCompressionCodec(TCompressionType::Snappy);
+  } catch (const std::exception &x) {
+    std::cerr << "skipping snappy: " << x.what() << std::endl;
+  }
+
+  if (snappy) {
+    RunCodec(harness, "snappy", *snappy, {-1}, payloads);
+  }
+}
@@ -0,0 +1,91 @@
+/* <dory/bench/crc_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/crc_bench.h>.
+ */
+
+#include <dory/bench/crc_bench.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/crc.hpp>
+
+#include <base/crc.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Bench;
+
+namespace {
+
+  using TCrcFn = uint32_t (*)(const void *, size_t);
+
+  uint32_t BoostCrc32(const void *data, size_t data_size) {
+    boost::crc_32_type result;
+    result.process_bytes(data, data_size);
+    return result.checksum();
+  }
+
+  void RunOne(TBenchHarness &harness, const std::string &name, TCrcFn fn,
+      const std::vector<uint8_t> &data) {
+    harness.Run(name + "/" + std::to_string(data.size()), data.size(),
+        [fn, &data](size_t iterations) {
+          TStopwatch sw;
+          uint32_t sum = 0;
+          sw.Start();
+
+          for (size_t i = 0; i < iterations; ++i) {
+            sum += fn(&data[0], data.size());
+          }
+
+          sw.Stop();
+
+          /* Keep the compiler from discarding the calls. */
+          volatile uint32_t sink = sum;
+          static_cast<void>(sink);
+          return sw.GetElapsedNs();
+        });
+  }
+
+}  // namespace
+
+void Dory::Bench::RunCrcBenchmarks(TBenchHarness &harness) {
+  for (size_t size : {64, 1024, 64 * 1024}) {
+    std::vector<uint8_t> data(size);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    RunOne(harness, "crc32/boost", &BoostCrc32, data);
+    RunOne(harness, "crc32/slice_by_8", &ComputeCrc32SliceBy8, data);
+
+    if (CpuHasPclmul()) {
+      RunOne(harness, "crc32/pclmul", &ComputeCrc32Pclmul, data);
+    }
+
+    RunOne(harness, "crc32c/slice_by_8", &ComputeCrc32cSliceBy8, data);
+
+    if (CpuHasSse42()) {
+      RunOne(harness, "crc32c/sse4.2", &ComputeCrc32cSse42, data);
+    }
+  }
+}
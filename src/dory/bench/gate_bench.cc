@@ -0,0 +1,73 @@
+/* <dory/bench/gate_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/gate_bench.h>.
+ */
+
+#include <dory/bench/gate_bench.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <thread>
+
+#include <thread/gate.h>
+
+using namespace Dory;
+using namespace Dory::Bench;
+using namespace Thread;
+
+void Dory::Bench::RunGateBenchmarks(TBenchHarness &harness) {
+  harness.Run("gate/put_get/same_thread", 0,
+      [](size_t iterations) {
+        TGate<size_t> gate;
+        TStopwatch sw;
+        sw.Start();
+
+        for (size_t i = 0; i < iterations; ++i) {
+          gate.Put(size_t(i));
+          gate.Get();
+        }
+
+        sw.Stop();
+        return sw.GetElapsedNs();
+      });
+
+  /* The consumer gets whatever has accumulated each time it wakes up, as
+     Dory's router and dispatcher threads do. */
+  harness.Run("gate/put_get/cross_thread", 0,
+      [](size_t iterations) {
+        TGate<size_t> gate;
+        TStopwatch sw;
+        sw.Start();
+        std::thread consumer(
+            [&gate, iterations]() {
+              for (size_t received = 0; received < iterations; ) {
+                received += gate.Get().size();
+              }
+            });
+
+        for (size_t i = 0; i < iterations; ++i) {
+          gate.Put(size_t(i));
+        }
+
+        consumer.join();
+        sw.Stop();
+        return sw.GetElapsedNs();
+      });
+}
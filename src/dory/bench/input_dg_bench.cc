@@ -0,0 +1,127 @@
+/* <dory/bench/input_dg_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/input_dg_bench.h>.
+ */
+
+#include <dory/bench/input_dg_bench.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dory/anomaly_tracker.h>
+#include <dory/bench/bench_util.h>
+#include <dory/config.h>
+#include <dory/discard_file_logger.h>
+#include <dory/input_dg/any_partition/v0/v0_write_msg.h>
+#include <dory/input_dg/input_dg_util.h>
+#include <dory/input_dg/partition_key/v0/v0_write_msg.h>
+#include <dory/msg.h>
+
+using namespace Dory;
+using namespace Dory::Bench;
+using namespace Dory::InputDg;
+
+namespace {
+
+  /* Built messages are destroyed this many at a time outside the timed
+     region. */
+  const size_t CHUNK_SIZE = 4096;
+
+  const size_t KEY_SIZE = 16;
+
+  std::vector<uint8_t> MakeDg(bool partition_key, const std::string &topic,
+      const std::string &key, const std::string &value) {
+    std::vector<uint8_t> dg;
+    size_t dg_size = 0;
+
+    if (partition_key) {
+      input_dg_p_key_v0_compute_msg_size(&dg_size, topic.size(), key.size(),
+          value.size());
+      dg.resize(dg_size);
+      input_dg_p_key_v0_write_msg(&dg[0], 0, 7, topic.data(),
+          topic.data() + topic.size(), key.data(), key.data() + key.size(),
+          value.data(), value.data() + value.size());
+    } else {
+      input_dg_any_p_v0_compute_msg_size(&dg_size, topic.size(), key.size(),
+          value.size());
+      dg.resize(dg_size);
+      input_dg_any_p_v0_write_msg(&dg[0], 0, topic.data(),
+          topic.data() + topic.size(), key.data(), key.data() + key.size(),
+          value.data(), value.data() + value.size());
+    }
+
+    return dg;
+  }
+
+  void RunOne(TBenchHarness &harness, const TConfig &config,
+      bool partition_key, size_t value_size) {
+    std::string name = std::string("input_dg/build_msg/") +
+        (partition_key ? "partition_key" : "any_partition") + "/value_" +
+        std::to_string(value_size);
+
+    if (!harness.IsSelected(name)) {
+      return;
+    }
+
+    std::vector<uint8_t> dg = MakeDg(partition_key, "bench_topic",
+        std::string(KEY_SIZE, 'k'), std::string(value_size, 'v'));
+    TBenchMsgs msgs(0, 0);
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0,
+        std::numeric_limits<size_t>::max());
+    harness.Run(name, dg.size(),
+        [&](size_t iterations) {
+          TStopwatch sw;
+          std::list<TMsg::TPtr> built;
+
+          for (size_t i = 0; i < iterations; i += CHUNK_SIZE) {
+            size_t count = std::min(CHUNK_SIZE, iterations - i);
+            sw.Start();
+
+            for (size_t j = 0; j < count; ++j) {
+              built.push_back(BuildMsgFromDg(&dg[0], dg.size(), config,
+                  msgs.GetPool(), anomaly_tracker,
+                  msgs.GetMsgStateTracker()));
+            }
+
+            sw.Stop();
+            TBenchMsgs::Destroy(built);
+          }
+
+          return sw.GetElapsedNs();
+        });
+  }
+
+}  // namespace
+
+void Dory::Bench::RunInputDgBenchmarks(TBenchHarness &harness) {
+  std::unique_ptr<TConfig> config = MakeDefaultDoryConfig();
+
+  for (bool partition_key : {false, true}) {
+    for (size_t value_size : {100, 1000, 10000}) {
+      RunOne(harness, *config, partition_key, value_size);
+    }
+  }
+}
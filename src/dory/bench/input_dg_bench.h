@@ -0,0 +1,36 @@
+/* <dory/bench/input_dg_bench.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Microbenchmarks for input datagram parsing.
+ */
+
+#pragma once
+
+#include <dory/bench/bench_harness.h>
+
+namespace Dory {
+
+  namespace Bench {
+
+    /* Time InputDg::BuildMsgFromDg() for AnyPartition and PartitionKey
+       datagrams across value sizes. */
+    void RunInputDgBenchmarks(TBenchHarness &harness);
+
+  }  // Bench
+
+}  // Dory
@@ -0,0 +1,160 @@
+/* <dory/bench/micro_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Microbenchmarks for Dory's message dispatch hot path: produce request
+   serialization, compression, checksums, batching, interthread message
+   passing, buffer pool allocation, and input datagram parsing.  Results are
+   written as JSON.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <base/basename.h>
+#include <dory/bench/batcher_bench.h>
+#include <dory/bench/bench_harness.h>
+#include <dory/bench/compression_bench.h>
+#include <dory/bench/crc_bench.h>
+#include <dory/bench/gate_bench.h>
+#include <dory/bench/input_dg_bench.h>
+#include <dory/bench/pool_bench.h>
+#include <dory/bench/produce_request_bench.h>
+#include <dory/build_id.h>
+#include <dory/util/arg_parse_error.h>
+#include <tclap/CmdLine.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Bench;
+using namespace Dory::Util;
+
+struct TConfig {
+  /* Throws TArgParseError on error parsing args. */
+  TConfig(int argc, char *argv[]);
+
+  /* Only benchmarks whose names contain this are run. */
+  std::string Filter;
+
+  size_t MinTime;
+
+  size_t Repetitions;
+
+  /* Results go to stdout if this is empty. */
+  std::string OutputPath;
+};  // TConfig
+
+static void ParseArgs(int argc, char *argv[], TConfig &config) {
+  using namespace TCLAP;
+  const std::string prog_name = Basename(argv[0]);
+  std::vector<const char *> arg_vec(&argv[0], &argv[0] + argc);
+  arg_vec[0] = prog_name.c_str();
+
+  try {
+    CmdLine cmd("Microbenchmarks for Dory's message dispatch hot path", ' ',
+        dory_build_id);
+    ValueArg<decltype(config.Filter)> arg_filter("", "filter",
+        "Only run benchmarks whose names contain this string.", false,
+        config.Filter, "STRING");
+    cmd.add(arg_filter);
+    ValueArg<decltype(config.MinTime)> arg_min_time("", "min_time",
+        "Minimum time for each repetition of a benchmark.", false,
+        config.MinTime, "MS");
+    cmd.add(arg_min_time);
+    ValueArg<decltype(config.Repetitions)> arg_repetitions("",
+        "repetitions", "Number of times to repeat each benchmark.  The "
+        "median is reported along with the fastest and slowest times.",
+        false, config.Repetitions, "COUNT");
+    cmd.add(arg_repetitions);
+    ValueArg<decltype(config.OutputPath)> arg_output("", "output",
+        "Write JSON results to this file rather than standard output.",
+        false, config.OutputPath, "PATH");
+    cmd.add(arg_output);
+    cmd.parse(argc, &arg_vec[0]);
+    config.Filter = arg_filter.getValue();
+    config.MinTime = arg_min_time.getValue();
+    config.Repetitions = arg_repetitions.getValue();
+    config.OutputPath = arg_output.getValue();
+  } catch (const ArgException &x) {
+    throw TArgParseError(x.error(), x.argId());
+  }
+}
+
+TConfig::TConfig(int argc, char *argv[])
+    : MinTime(200),
+      Repetitions(3) {
+  ParseArgs(argc, argv, *this);
+}
+
+static int micro_bench_main(int argc, char *argv[]) {
+  TConfig config(argc, argv);
+
+  if ((config.MinTime == 0) || (config.Repetitions == 0)) {
+    std::cerr << "--min_time and --repetitions must be at least 1"
+        << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  TBenchHarness harness(config.Filter, config.MinTime, config.Repetitions);
+  RunProduceRequestBenchmarks(harness);
+  RunCompressionBenchmarks(harness);
+  RunCrcBenchmarks(harness);
+  RunBatcherBenchmarks(harness);
+  RunGateBenchmarks(harness);
+  RunPoolBenchmarks(harness);
+  RunInputDgBenchmarks(harness);
+
+  if (config.OutputPath.empty()) {
+    harness.WriteJson(std::cout);
+  } else {
+    std::ofstream ofs(config.OutputPath);
+    harness.WriteJson(ofs);
+
+    if (!ofs) {
+      std::cerr << "error: failed to write " << config.OutputPath
+          << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  int ret = EXIT_SUCCESS;
+
+  try {
+    ret = micro_bench_main(argc, argv);
+  } catch (const TArgParseError &x) {
+    /* Error parsing command line arguments. */
+    std::cerr << x.what() << std::endl;
+    ret = EXIT_FAILURE;
+  } catch (const std::exception &ex) {
+    std::cerr << "error: " << ex.what() << std::endl;
+    ret = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: uncaught unknown exception" << std::endl;
+    ret = EXIT_FAILURE;
+  }
+
+  return ret;
+}
@@ -0,0 +1,102 @@
+/* <dory/bench/pool_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/pool_bench.h>.
+ */
+
+#include <dory/bench/pool_bench.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <capped/memory_cap_reached.h>
+#include <capped/pool.h>
+
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Bench;
+
+namespace {
+
+  /* Allocations each thread keeps outstanding, like messages in flight. */
+  const size_t WINDOW = 16;
+
+  void WorkerMain(TPool &pool, size_t iterations) {
+    std::vector<TPool::TBlock *> window(WINDOW, nullptr);
+
+    for (size_t i = 0; i < iterations; ++i) {
+      TPool::TBlock *&slot = window[i % WINDOW];
+
+      if (slot) {
+        pool.FreeList(slot);
+        slot = nullptr;
+      }
+
+      try {
+        slot = pool.AllocList(1);
+      } catch (const TMemoryCapReached &) {
+      }
+    }
+
+    for (TPool::TBlock *list : window) {
+      pool.FreeList(list);
+    }
+  }
+
+  void RunOne(TBenchHarness &harness, TPool::TSync sync_policy,
+      const char *sync_name, size_t thread_count) {
+    harness.Run(std::string("pool/alloc_free/") + sync_name + "/threads_" +
+        std::to_string(thread_count), 0,
+        [sync_policy, thread_count](size_t iterations) {
+          TPool pool(128, 1024 * 1024, sync_policy);
+          std::vector<std::thread> threads;
+          size_t per_thread = (iterations + thread_count - 1) / thread_count;
+          TStopwatch sw;
+          sw.Start();
+
+          for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(WorkerMain, std::ref(pool), per_thread);
+          }
+
+          for (std::thread &t : threads) {
+            t.join();
+          }
+
+          sw.Stop();
+
+          /* Report time per allocation across all threads, so the result
+             reflects total throughput. */
+          return static_cast<uint64_t>(static_cast<double>(sw.GetElapsedNs())
+              * static_cast<double>(iterations) /
+              static_cast<double>(per_thread * thread_count));
+        });
+  }
+
+}  // namespace
+
+void Dory::Bench::RunPoolBenchmarks(TBenchHarness &harness) {
+  for (size_t thread_count : {1, 2, 4, 8}) {
+    RunOne(harness, TPool::TSync::Mutexed, "mutexed", thread_count);
+    RunOne(harness, TPool::TSync::ThreadCached, "thread_cached",
+        thread_count);
+  }
+}
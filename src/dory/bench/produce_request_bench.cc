@@ -0,0 +1,176 @@
+/* <dory/bench/produce_request_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/bench/produce_request_bench.h>.
+ */
+
+#include <dory/bench/produce_request_bench.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/opt.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/batch/batch_config_builder.h>
+#include <dory/batch/global_batch_config.h>
+#include <dory/bench/bench_util.h>
+#include <dory/compress/compression_type.h>
+#include <dory/compression_stats.h>
+#include <dory/conf/compression_conf.h>
+#include <dory/config.h>
+#include <dory/discard_file_logger.h>
+#include <dory/idempotent_producer.h>
+#include <dory/kafka_proto/produce/produce_protocol.h>
+#include <dory/kafka_proto/produce/version_util.h>
+#include <dory/metadata.h>
+#include <dory/msg.h>
+#include <dory/msg_dispatch/common.h>
+#include <dory/msg_dispatch/produce_request_factory.h>
+#include <dory/priority_lane_stats.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Batch;
+using namespace Dory::Bench;
+using namespace Dory::Compress;
+using namespace Dory::Conf;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::MsgDispatch;
+
+namespace {
+
+  /* Messages in each produce request. */
+  const size_t MSGS_PER_REQUEST = 64;
+
+  const size_t PARTITIONS_PER_TOPIC = 8;
+
+  std::vector<std::string> MakeTopics(size_t count) {
+    std::vector<std::string> result;
+
+    for (size_t i = 0; i < count; ++i) {
+      result.push_back("bench_topic_" + std::to_string(i));
+    }
+
+    return result;
+  }
+
+  /* All partitions of all topics are on a single broker, which the factory
+     builds requests for. */
+  std::shared_ptr<TMetadata> MakeMetadata(
+      const std::vector<std::string> &topics) {
+    TMetadata::TBuilder builder;
+    builder.OpenBrokerList();
+    builder.AddBroker(1, "localhost", 9092);
+    builder.CloseBrokerList();
+
+    for (const std::string &topic : topics) {
+      builder.OpenTopic(topic);
+
+      for (size_t i = 0; i < PARTITIONS_PER_TOPIC; ++i) {
+        builder.AddPartitionToTopic(static_cast<int32_t>(i), 1, true, 0);
+      }
+
+      builder.CloseTopic();
+    }
+
+    return std::shared_ptr<TMetadata>(builder.Build());
+  }
+
+  TCompressionConf MakeCompressionConf(TCompressionType type) {
+    TCompressionConf::TBuilder builder;
+    builder.AddNamedConfig("bench", type, 0, TOpt<int>());
+    builder.SetDefaultTopicConfig("bench");
+    return builder.Build();
+  }
+
+  void RunOne(TBenchHarness &harness, const TConfig &config,
+      TCompressionType compression_type, size_t topic_count,
+      size_t value_size) {
+    std::string name = std::string("produce_request/") +
+        ToString(compression_type) + "/topics_" +
+        std::to_string(topic_count) + "/value_" + std::to_string(value_size);
+
+    if (!harness.IsSelected(name)) {
+      return;
+    }
+
+    std::vector<std::string> topics = MakeTopics(topic_count);
+    TBatchConfigBuilder batch_builder;
+    batch_builder.SetProduceRequestDataLimit(1024 * 1024);
+    batch_builder.SetMessageMaxBytes(1024 * 1024);
+    TGlobalBatchConfig batch_config = batch_builder.Build();
+    TCompressionConf compression_conf = MakeCompressionConf(compression_type);
+    std::shared_ptr<TProduceProtocol> protocol(ChooseProduceProto(0));
+    /* Probe interval 0 means every message set is compressed, so the results
+       don't depend on how well the test data compresses. */
+    TCompressionStats compression_stats(0);
+    TPriorityLaneStats lane_stats;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TIdempotentProducer idempotent_producer(false, anomaly_tracker);
+    TProduceRequestFactory factory(config, batch_config, compression_conf,
+        compression_stats, lane_stats, idempotent_producer, protocol, 0);
+    factory.Init(compression_conf, MakeMetadata(topics));
+    TBenchMsgs msgs(0, value_size);
+    std::vector<uint8_t> dst;
+    harness.Run(name, MSGS_PER_REQUEST * value_size,
+        [&](size_t iterations) {
+          TStopwatch sw;
+
+          for (size_t i = 0; i < iterations; ++i) {
+            /* Queue one batch per topic, as the router thread would. */
+            for (const std::string &topic : topics) {
+              std::list<TMsg::TPtr> batch;
+              msgs.Create({topic}, MSGS_PER_REQUEST / topics.size(), batch);
+              factory.Put(std::move(batch));
+            }
+
+            sw.Start();
+            TOpt<TProduceRequest> request = factory.BuildRequest(dst);
+            sw.Stop();
+            std::list<std::list<TMsg::TPtr>> done = factory.GetAll();
+
+            if (request.IsKnown()) {
+              EmptyAllTopics(request->second, done);
+            }
+
+            TBenchMsgs::Destroy(done);
+          }
+
+          return sw.GetElapsedNs();
+        });
+  }
+
+}  // namespace
+
+void Dory::Bench::RunProduceRequestBenchmarks(TBenchHarness &harness) {
+  std::unique_ptr<TConfig> config = MakeDefaultDoryConfig();
+
+  for (TCompressionType type :
+       {TCompressionType::None, TCompressionType::Lz4}) {
+    for (size_t topic_count : {1, 16}) {
+      for (size_t value_size : {100, 1000, 10000}) {
+        RunOne(harness, *config, type, topic_count, value_size);
+      }
+    }
+  }
+}
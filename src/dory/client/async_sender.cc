@@ -0,0 +1,226 @@
+/* <dory/client/async_sender.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/client/async_sender.h>.
+ */
+
+#include <dory/client/async_sender.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <dory/client/status_codes.h>
+
+using namespace Dory;
+using namespace Dory::Client;
+
+TAsyncSender::TAsyncSender(std::unique_ptr<TClientSenderBase> &&sender,
+    size_t max_queued_bytes, TFullPolicy full_policy)
+    : Sender(std::move(sender)),
+      MaxQueuedBytes(max_queued_bytes),
+      FullPolicy(full_policy),
+      FlushBytes(0),
+      BatchesTaken(0),
+      BatchesDone(0),
+      FlusherWaiting(false),
+      ShuttingDown(false),
+      Connected(false) {
+  assert(Sender);
+  FlusherThread = std::thread(&TAsyncSender::Run, this);
+}
+
+TAsyncSender::~TAsyncSender() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ShuttingDown = true;
+  }
+
+  DataAvailable.notify_one();
+  FlusherThread.join();
+}
+
+bool TAsyncSender::Send(const void *msg, size_t msg_size) {
+  assert(this);
+  std::unique_lock<std::mutex> lock(Mutex);
+
+  if (msg_size > MaxQueuedBytes) {
+    ++Stats.MsgsDropped;
+    return false;
+  }
+
+  while ((FillBuf.Data.size() + FlushBytes + msg_size) > MaxQueuedBytes) {
+    if (FullPolicy == TFullPolicy::Drop) {
+      ++Stats.MsgsDropped;
+      return false;
+    }
+
+    BatchDone.wait(lock);
+  }
+
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(msg);
+  FillBuf.Data.insert(FillBuf.Data.end(), p, p + msg_size);
+  FillBuf.Sizes.push_back(msg_size);
+  ++Stats.MsgsQueued;
+
+  /* Only pay for waking the background thread when it is idle.  Otherwise
+     the message goes out with the batch after the one being written. */
+  if (FlusherWaiting) {
+    FlusherWaiting = false;
+    lock.unlock();
+    DataAvailable.notify_one();
+  }
+
+  return true;
+}
+
+void TAsyncSender::Flush() {
+  assert(this);
+  std::unique_lock<std::mutex> lock(Mutex);
+
+  /* Everything queued now goes out with the batch after the one being
+     written, or with the current one if nothing is queued. */
+  uint64_t target = BatchesTaken + (FillBuf.Sizes.empty() ? 0 : 1);
+
+  if (!FillBuf.Sizes.empty() && FlusherWaiting) {
+    FlusherWaiting = false;
+    DataAvailable.notify_one();
+  }
+
+  BatchDone.wait(lock, [this, target] { return BatchesDone >= target; });
+}
+
+TAsyncSender::TStats TAsyncSender::GetStats() const {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+  return Stats;
+}
+
+void TAsyncSender::Run() {
+  assert(this);
+
+  for (; ; ) {
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+
+      while (FillBuf.Sizes.empty() && !ShuttingDown) {
+        FlusherWaiting = true;
+        DataAvailable.wait(lock);
+      }
+
+      FlusherWaiting = false;
+
+      if (FillBuf.Sizes.empty()) {
+        break;  // shutting down, and everything has been written
+      }
+
+      /* Take everything queued so far as the next batch.  The buffers trade
+         places, so both keep their allocated space. */
+      std::swap(FillBuf, FlushBuf);
+      FillBuf.Data.clear();
+      FillBuf.Sizes.clear();
+      FlushBytes = FlushBuf.Data.size();
+      ++BatchesTaken;
+    }
+
+    WriteBatch();
+  }
+
+  if (Connected) {
+    Sender->Reset();
+  }
+}
+
+void TAsyncSender::WriteBatch() {
+  assert(this);
+  std::vector<dory_msg_buf_t> msgs(FlushBuf.Sizes.size());
+  const uint8_t *pos = FlushBuf.Data.data();
+
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    msgs[i].msg = pos;
+    msgs[i].msg_size = FlushBuf.Sizes[i];
+    pos += FlushBuf.Sizes[i];
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<int> status(msgs.size(), DORY_OK);
+  int err = 0;
+
+  try {
+    if (!Connected) {
+      Sender->PrepareToSend();
+      Connected = true;
+    }
+
+    /* A message too large to send is only marked in 'status'.  It doesn't
+       stop the rest of the batch, or need a new connection. */
+    Sender->SendBatch(msgs.data(), msgs.size(), status.data());
+  } catch (const std::system_error &x) {
+    err = x.code().value();
+
+    /* If sending started, 'status' tells which messages got through. */
+    if (!Connected) {
+      std::fill(status.begin(), status.end(), err);
+    }
+  } catch (const std::exception &) {
+    err = EINVAL;
+    std::fill(status.begin(), status.end(), err);
+  }
+
+  if (err && Connected) {
+    /* Reconnect for the next batch. */
+    Sender->Reset();
+    Connected = false;
+  }
+
+  size_t sent_count = 0;
+
+  for (int s : status) {
+    if (s == DORY_OK) {
+      ++sent_count;
+    } else if (err == 0) {
+      err = s;
+    }
+  }
+
+  uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++Stats.FlushCount;
+    Stats.FlushTotalUs += elapsed;
+    Stats.FlushMaxUs = std::max(Stats.FlushMaxUs, elapsed);
+
+    Stats.MsgsSent += sent_count;
+    Stats.MsgsFailed += msgs.size() - sent_count;
+
+    if (err) {
+      Stats.LastError = err;
+    }
+
+    FlushBytes = 0;
+    ++BatchesDone;
+  }
+
+  BatchDone.notify_all();
+}
@@ -0,0 +1,177 @@
+/* <dory/client/async_sender.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Client class that queues messages in memory and sends them to Dory from a
+   background thread.  Sending a message only costs the caller a copy into
+   the queue.  The background thread takes everything queued since its last
+   write and sends it to Dory in one batch, using sendmmsg() for UNIX domain
+   datagram sockets or large writes for stream sockets (see
+   TClientSenderBase::SendBatch()).
+ */
+
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <dory/client/client_sender_base.h>
+
+namespace Dory {
+
+  namespace Client {
+
+    class TAsyncSender final {
+      NO_COPY_SEMANTICS(TAsyncSender);
+
+      public:
+      /* What Send() does when the queue doesn't have room for a message. */
+      enum class TFullPolicy {
+        /* Discard the message. */
+        Drop,
+
+        /* Wait until the background thread makes room. */
+        Block
+      };  // TFullPolicy
+
+      struct TStats {
+        /* Messages accepted by Send(). */
+        uint64_t MsgsQueued;
+
+        /* Messages written to Dory. */
+        uint64_t MsgsSent;
+
+        /* Messages discarded because the queue was full or the message was
+           larger than the queue's memory budget. */
+        uint64_t MsgsDropped;
+
+        /* Messages discarded because writing them to Dory failed. */
+        uint64_t MsgsFailed;
+
+        /* Number of batches written to Dory, and the total and maximum time
+           in microseconds spent writing them. */
+        uint64_t FlushCount;
+
+        uint64_t FlushTotalUs;
+
+        uint64_t FlushMaxUs;
+
+        /* errno value from last failed write, or 0 if none. */
+        int LastError;
+
+        TStats()
+            : MsgsQueued(0),
+              MsgsSent(0),
+              MsgsDropped(0),
+              MsgsFailed(0),
+              FlushCount(0),
+              FlushTotalUs(0),
+              FlushMaxUs(0),
+              LastError(0) {
+        }
+      };  // TStats
+
+      /* Send messages to Dory through 'sender', which must not have been
+         prepared yet.  At most 'max_queued_bytes' bytes of messages are
+         queued at once, including the batch being written.  Starts the
+         background thread, which connects to Dory.  If connecting fails,
+         it tries again on each batch, and the messages in batches that
+         can't be written are counted as failed. */
+      TAsyncSender(std::unique_ptr<TClientSenderBase> &&sender,
+          size_t max_queued_bytes, TFullPolicy full_policy);
+
+      /* Sends everything still queued, then stops the background thread. */
+      ~TAsyncSender() noexcept;
+
+      /* Queue a copy of the message for sending.  Return true if queued, or
+         false if dropped.  Safe to call from multiple threads. */
+      bool Send(const void *msg, size_t msg_size);
+
+      /* Wait until everything queued before the call has been written to
+         Dory, or has failed. */
+      void Flush();
+
+      TStats GetStats() const;
+
+      private:
+      /* Messages waiting to be written.  They are stored back to back in
+         'Data'.  'Sizes' gives their sizes in order. */
+      struct TBuf {
+        std::vector<uint8_t> Data;
+
+        std::vector<size_t> Sizes;
+      };  // TBuf
+
+      void Run();
+
+      /* Write everything in 'FlushBuf' to Dory.  Called by the background
+         thread without 'Mutex' held. */
+      void WriteBatch();
+
+      std::unique_ptr<TClientSenderBase> Sender;
+
+      const size_t MaxQueuedBytes;
+
+      const TFullPolicy FullPolicy;
+
+      /* Protects everything below except 'FlushBuf' and 'Connected', which
+         only the background thread uses. */
+      mutable std::mutex Mutex;
+
+      /* Signaled when messages are queued while the background thread is
+         waiting, and on shutdown. */
+      std::condition_variable DataAvailable;
+
+      /* Signaled when the background thread finishes a batch. */
+      std::condition_variable BatchDone;
+
+      /* Application threads append messages here. */
+      TBuf FillBuf;
+
+      /* Size of batch the background thread is writing. */
+      size_t FlushBytes;
+
+      /* Incremented each time the background thread takes 'FillBuf'. */
+      uint64_t BatchesTaken;
+
+      /* Incremented each time the background thread finishes a batch. */
+      uint64_t BatchesDone;
+
+      bool FlusherWaiting;
+
+      bool ShuttingDown;
+
+      TStats Stats;
+
+      /* Batch being written by background thread. */
+      TBuf FlushBuf;
+
+      bool Connected;
+
+      std::thread FlusherThread;
+    };  // TAsyncSender
+
+  }  // Client
+
+}  // Dory
@@ -0,0 +1,257 @@
+/* <dory/client/async_sender.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/client/async_sender.h>.
+ */
+
+#include <dory/client/async_sender.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <base/fd.h>
+#include <base/tmp_file_name.h>
+#include <dory/client/unix_dg_sender.h>
+#include <dory/client/unix_stream_sender.h>
+#include <socket/address.h>
+#include <socket/named_unix_socket.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Client;
+using namespace Socket;
+
+namespace {
+
+  /* The fixture for testing class TAsyncSender. */
+  class TAsyncSenderTest : public ::testing::Test {
+    protected:
+    TAsyncSenderTest() {
+    }
+
+    virtual ~TAsyncSenderTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TAsyncSenderTest
+
+  static void BindServer(TNamedUnixSocket &sock, const char *path) {
+    TAddress address;
+    address.SetFamily(AF_LOCAL);
+    address.SetPath(path);
+    Bind(sock, address);
+  }
+
+  static std::string MakeMsg(size_t n) {
+    return "message " + std::to_string(n);
+  }
+
+  TEST_F(TAsyncSenderTest, Datagram) {
+    TTmpFileName path;
+    TNamedUnixSocket server(SOCK_DGRAM, 0);
+    BindServer(server, path);
+    const size_t msg_count = 200;
+
+    /* The receive queue of a UNIX domain datagram socket may be short, so
+       read concurrently.  Each message arrives as its own datagram. */
+    std::vector<std::string> received;
+    std::thread reader([&server, &received, msg_count] {
+      char buf[64];
+
+      while (received.size() < msg_count) {
+        ssize_t ret = recv(server.GetFd(), buf, sizeof(buf), 0);
+
+        if (ret <= 0) {
+          break;
+        }
+
+        received.push_back(std::string(buf, ret));
+      }
+    });
+
+    {
+      TAsyncSender sender(
+          std::unique_ptr<TClientSenderBase>(new TUnixDgSender(path)), 1024,
+          TAsyncSender::TFullPolicy::Block);
+
+      for (size_t i = 0; i < msg_count; ++i) {
+        std::string msg = MakeMsg(i);
+        ASSERT_TRUE(sender.Send(msg.data(), msg.size()));
+      }
+
+      sender.Flush();
+      TAsyncSender::TStats stats = sender.GetStats();
+      ASSERT_EQ(stats.MsgsQueued, msg_count);
+      ASSERT_EQ(stats.MsgsSent, msg_count);
+      ASSERT_EQ(stats.MsgsDropped, 0U);
+      ASSERT_EQ(stats.MsgsFailed, 0U);
+      ASSERT_GE(stats.FlushCount, 1U);
+      ASSERT_LE(stats.FlushCount, msg_count);
+      ASSERT_GE(stats.FlushTotalUs, stats.FlushMaxUs);
+    }
+
+    reader.join();
+    ASSERT_EQ(received.size(), msg_count);
+
+    for (size_t i = 0; i < msg_count; ++i) {
+      ASSERT_EQ(received[i], MakeMsg(i));
+    }
+  }
+
+  TEST_F(TAsyncSenderTest, OversizeDatagram) {
+    TTmpFileName path;
+    TNamedUnixSocket server(SOCK_DGRAM, 0);
+    BindServer(server, path);
+
+    /* Larger than any UNIX domain datagram socket send buffer. */
+    std::string big(8 * 1024 * 1024, 'x');
+    std::vector<std::string> batch = { MakeMsg(0), big, MakeMsg(1) };
+    std::vector<dory_msg_buf_t> msgs(batch.size());
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      msgs[i].msg = batch[i].data();
+      msgs[i].msg_size = batch[i].size();
+    }
+
+    /* Only the large message fails, and the rest of the batch is sent. */
+    TUnixDgSender dg_sender(path);
+    dg_sender.PrepareToSend();
+    std::vector<int> status(msgs.size(), -1);
+    dg_sender.SendBatch(msgs.data(), msgs.size(), status.data());
+    ASSERT_EQ(status[0], DORY_OK);
+    ASSERT_EQ(status[1], EMSGSIZE);
+    ASSERT_EQ(status[2], DORY_OK);
+    ASSERT_THROW(dg_sender.SendBatch(msgs.data(), msgs.size()),
+        std::system_error);
+    dg_sender.Reset();
+
+    {
+      TAsyncSender sender(
+          std::unique_ptr<TClientSenderBase>(new TUnixDgSender(path)),
+          2 * big.size(), TAsyncSender::TFullPolicy::Block);
+
+      for (const std::string &msg : batch) {
+        ASSERT_TRUE(sender.Send(msg.data(), msg.size()));
+      }
+
+      sender.Flush();
+      TAsyncSender::TStats stats = sender.GetStats();
+      ASSERT_EQ(stats.MsgsQueued, 3U);
+      ASSERT_EQ(stats.MsgsSent, 2U);
+      ASSERT_EQ(stats.MsgsFailed, 1U);
+      ASSERT_EQ(stats.LastError, EMSGSIZE);
+    }
+
+    /* Everything but the large messages arrives, in order. */
+    char buf[64];
+
+    for (size_t i = 0; i < 6; ++i) {
+      ssize_t ret = recv(server.GetFd(), buf, sizeof(buf), MSG_DONTWAIT);
+      ASSERT_GT(ret, 0);
+      ASSERT_EQ(std::string(buf, ret), MakeMsg(i % 2));
+    }
+  }
+
+  TEST_F(TAsyncSenderTest, Stream) {
+    TTmpFileName path;
+    TNamedUnixSocket server(SOCK_STREAM, 0);
+    BindServer(server, path);
+    ASSERT_EQ(listen(server.GetFd(), 1), 0);
+    std::string expected;
+    const size_t msg_count = 1000;
+
+    {
+      /* The small budget forces many batches. */
+      TAsyncSender sender(
+          std::unique_ptr<TClientSenderBase>(new TUnixStreamSender(path)),
+          256, TAsyncSender::TFullPolicy::Block);
+
+      for (size_t i = 0; i < msg_count; ++i) {
+        std::string msg = MakeMsg(i);
+        ASSERT_TRUE(sender.Send(msg.data(), msg.size()));
+        expected += msg;
+      }
+
+      /* The destructor sends everything still queued. */
+    }
+
+    TFd conn(accept(server.GetFd(), nullptr, nullptr));
+    ASSERT_TRUE(conn.IsOpen());
+    std::string received;
+    char buf[4096];
+
+    for (; ; ) {
+      ssize_t ret = read(conn, buf, sizeof(buf));
+      ASSERT_GE(ret, 0);
+
+      if (ret == 0) {
+        break;
+      }
+
+      received.append(buf, ret);
+    }
+
+    ASSERT_EQ(received, expected);
+  }
+
+  TEST_F(TAsyncSenderTest, DropAndFail) {
+    /* Nothing listens here, so writes fail. */
+    TTmpFileName path;
+    TAsyncSender sender(
+        std::unique_ptr<TClientSenderBase>(new TUnixDgSender(path)), 64,
+        TAsyncSender::TFullPolicy::Drop);
+
+    /* Too large for the budget. */
+    std::string big(65, 'x');
+    ASSERT_FALSE(sender.Send(big.data(), big.size()));
+
+    for (size_t i = 0; i < 3; ++i) {
+      std::string msg = MakeMsg(i);
+      sender.Send(msg.data(), msg.size());
+    }
+
+    sender.Flush();
+    TAsyncSender::TStats stats = sender.GetStats();
+    ASSERT_EQ(stats.MsgsQueued + stats.MsgsDropped, 4U);
+    ASSERT_GE(stats.MsgsDropped, 1U);
+    ASSERT_EQ(stats.MsgsFailed, stats.MsgsQueued);
+    ASSERT_EQ(stats.MsgsSent, 0U);
+    ASSERT_NE(stats.LastError, 0);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
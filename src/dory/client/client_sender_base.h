@@ -22,10 +22,16 @@
 #pragma once
 
 #include <cassert>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
+#include <system_error>
+#include <vector>
 
+#include <base/error_utils.h>
 #include <base/no_copy_semantics.h>
+#include <dory/client/dory_client.h>
+#include <dory/client/status_codes.h>
 
 namespace Dory {
 
@@ -48,6 +54,33 @@ namespace Dory {
         DoSend(reinterpret_cast<const uint8_t *>(msg), msg_size);
       }
 
+      /* Send the 'msg_count' messages in 'msgs', in order, with as few system
+         calls as the transport allows.  If 'status' is not null, it must
+         point to an array of 'msg_count' ints, and on return (or throw),
+         status[i] is DORY_OK if msgs[i] was sent, or an errno value
+         otherwise.  In this case, a message too large to send (EMSGSIZE) is
+         only marked in 'status', and the rest are still sent.  Any other
+         error throws std::system_error.  If 'status' is null, any error
+         throws. */
+      void SendBatch(const dory_msg_buf_t *msgs, size_t msg_count,
+          int *status = nullptr) {
+        assert(this);
+
+        if (status) {
+          DoSendBatch(msgs, msg_count, status);
+          return;
+        }
+
+        std::vector<int> tmp_status(msg_count, DORY_OK);
+        DoSendBatch(msgs, msg_count, tmp_status.data());
+
+        for (int s : tmp_status) {
+          if (s != DORY_OK) {
+            Base::ThrowSystemError(s);
+          }
+        }
+      }
+
       void Reset() {
         assert(this);
         DoReset();
@@ -60,6 +93,35 @@ namespace Dory {
 
       virtual void DoSend(const uint8_t *msg, size_t msg_size) = 0;
 
+      /* See SendBatch().  'status' is never null.  The default
+         implementation sends the messages one at a time. */
+      virtual void DoSendBatch(const dory_msg_buf_t *msgs, size_t msg_count,
+          int *status) {
+        assert(this);
+        assert(status || (msg_count == 0));
+
+        for (size_t i = 0; i < msg_count; ++i) {
+          try {
+            DoSend(reinterpret_cast<const uint8_t *>(msgs[i].msg),
+                msgs[i].msg_size);
+            status[i] = DORY_OK;
+          } catch (const std::system_error &x) {
+            int err = x.code().value();
+
+            if (err == EMSGSIZE) {
+              status[i] = err;
+              continue;
+            }
+
+            for (; i < msg_count; ++i) {
+              status[i] = err;
+            }
+
+            throw;
+          }
+        }
+      }
+
       virtual void DoReset() = 0;
     };  // TClientSenderBase
 
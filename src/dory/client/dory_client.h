@@ -104,6 +104,38 @@ typedef struct dory_client_socket {
   struct sockaddr_un server_addr;
 } dory_client_socket_t;
 
+/* One message in a batch passed to dory_client_socket_send_batch(). */
+typedef struct dory_msg_buf {
+  /* Points to message, which must not be null. */
+  const void *msg;
+
+  /* Message size in bytes, which must be > 0. */
+  size_t msg_size;
+} dory_msg_buf_t;
+
+/* A shared memory ring for sending messages to Dory at very high rates.
+   Sending a message copies it into memory shared with Dory, and usually
+   involves no system calls.  Only one thread may send through a ring at a
+   time. */
+typedef struct dory_shm_ring {
+  /* Control connection to Dory.  Negative when not opened. */
+  int ctl_fd;
+
+  /* eventfd for waking up Dory when the ring becomes nonempty. */
+  int doorbell_fd;
+
+  /* Shared mapping containing ring. */
+  void *mem;
+
+  size_t mem_size;
+
+  /* Size of data area of ring. */
+  size_t data_size;
+
+  /* Our copy of the ring's head. */
+  uint64_t head;
+} dory_shm_ring_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -196,10 +228,68 @@ int dory_client_socket_bind(dory_client_socket_t *client_socket,
 int dory_client_socket_send(const dory_client_socket_t *client_socket,
     const void *msg, size_t msg_size);
 
+/* Send the 'msg_count' messages in 'msgs' to Dory, in order, using as few
+   system calls as possible.  'client_socket' is a dory_client_socket_t for
+   which dory_client_socket_bind() has successfully been called.  If 'status'
+   is not null, it must point to an array of 'msg_count' ints, and on return,
+   status[i] holds the result for msgs[i]: DORY_OK if it was sent, or an errno
+   value otherwise.  Sending stops at the first error, except for EMSGSIZE,
+   which only affects the message that is too large, so the remaining messages
+   are still sent.  Messages not attempted after sending stops get the status
+   of the error that stopped it.  If 'sent_count' is not null, the number of
+   messages sent is stored there.
+
+   Return DORY_OK if all messages were sent.  Otherwise return the errno value
+   for the first message that wasn't sent.  A return value of EAGAIN means
+   the socket is nonblocking and Dory's receive buffer is full.  In this case
+   the messages marked with EAGAIN were not sent and may be sent again later,
+   and all messages before them were either sent or failed with EMSGSIZE. */
+int dory_client_socket_send_batch(const dory_client_socket_t *client_socket,
+    const dory_msg_buf_t *msgs, size_t msg_count, int *status,
+    size_t *sent_count);
+
 /* Call this function when finished sending messages.  Calling this function
    again on an already closed dory_client_socket_t object is harmless. */
 void dory_client_socket_close(dory_client_socket_t *client_socket);
 
+/* Initialize a dory_shm_ring_t structure.  This must be called before its
+   first use, but should not be called again on the object after that.  On
+   return, 'ring' is in an empty state. */
+void dory_shm_ring_init(dory_shm_ring_t *ring);
+
+/* Obtain a shared memory ring from Dory by connecting to its shared memory
+   control socket at 'server_path' (see Dory's --shm_socket_name option).
+   Return DORY_OK on success.  On error, return one of two types of error
+   codes:
+
+       1.  If return value is negative, then it is an error code defined in
+           <dory/client/status_codes.h>.  In this case, it will be one of
+           { DORY_CLIENT_SOCK_IS_OPENED, DORY_SERVER_SOCK_PATH_TOO_LONG }.
+
+       2.  If return value is > 0, then it is an errno value indicating the
+           cause of failure.  EBUSY indicates that Dory has reached its limit
+           on rings in use, and EPROTO indicates an unexpected reply.
+
+   On successful return, you must call dory_shm_ring_close() when done
+   sending messages. */
+int dory_shm_ring_open(dory_shm_ring_t *ring, const char *server_path);
+
+/* Send a message to Dory through 'ring', which dory_shm_ring_open() has
+   successfully opened.  'msg' points to the message to send, which is in the
+   same format as for dory_client_socket_send(), and 'msg_size' gives the
+   message size in bytes.  Return DORY_OK on success.  Return EAGAIN if the
+   ring doesn't currently have space for the message, in which case you can
+   try again once Dory has caught up.  Return EMSGSIZE if the message is too
+   large to ever fit in the ring.  Any other value > 0 is an errno value
+   indicating what went wrong. */
+int dory_shm_ring_send(dory_shm_ring_t *ring, const void *msg,
+    size_t msg_size);
+
+/* Call this function when finished sending messages.  Dory still processes
+   all messages sent before the ring was closed.  Calling this function again
+   on an already closed dory_shm_ring_t object is harmless. */
+void dory_shm_ring_close(dory_shm_ring_t *ring);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -97,6 +97,15 @@ namespace Dory {
         return dory_client_socket_send(&Sock, msg, msg_size);
       }
 
+      /* Send a batch of messages to Dory with as few system calls as
+         possible.  See dory_client_socket_send_batch() for the meanings of
+         the parameters and return value. */
+      int SendBatch(const dory_msg_buf_t *msgs, size_t msg_count,
+          int *status = nullptr, size_t *sent_count = nullptr) const noexcept {
+        return dory_client_socket_send_batch(&Sock, msgs, msg_count, status,
+            sent_count);
+      }
+
       /* Call this method when you are done sending messages to Dory.  It is
          harmless to call Close() on an already closed object.  After calling
          Close(), you can call Bind() again if you wish to resume communication
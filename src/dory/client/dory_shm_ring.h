@@ -0,0 +1,113 @@
+/* <dory/client/dory_shm_ring.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for writing messages to a shared memory ring obtained from Dory.
+ */
+
+#pragma once
+
+#include <utility>
+
+#include <dory/client/dory_client.h>
+
+namespace Dory {
+
+  namespace Client {
+
+    /* This is a simple C++ wrapper around a dory_shm_ring_t structure.  See
+       the comments in <dory/client/dory_client.h> for the meanings of the
+       return values. */
+    class TDoryShmRing {
+      /* Copying and assignment not permitted. */
+      TDoryShmRing(const TDoryShmRing &) = delete;
+      TDoryShmRing &operator=(TDoryShmRing &) = delete;
+
+      public:
+      /* Create a new ring object.  You must call Open() to prepare the object
+         for sending messages to Dory. */
+      TDoryShmRing() noexcept {
+        dory_shm_ring_init(&Ring);
+      }
+
+      virtual ~TDoryShmRing() noexcept {
+        Close();
+      }
+
+      /* Move constructor.  Transplant state from 'that' to object being
+         constructed, leaving 'that' in an empty (i.e. newly constructed)
+         state. */
+      TDoryShmRing(TDoryShmRing &&that) noexcept {
+        MoveState(that);
+      }
+
+      /* Move assignment operator.  On assignment to self, this is a no-op.
+         Otherwise, close ring and transplant state from 'that', leaving
+         'that' in an empty (i.e. newly constructed) state. */
+      TDoryShmRing &operator=(TDoryShmRing &&that) noexcept {
+        if (this != &that) {
+          Close();
+          MoveState(that);
+        }
+
+        return *this;
+      }
+
+      /* Swap our internal state with internal state of 'that'. */
+      void Swap(TDoryShmRing &that) noexcept {
+        std::swap(Ring, that.Ring);
+      }
+
+      /* After calling this method and getting a return value of DORY_OK, you
+         are ready to call Send(). */
+      int Open(const char *server_path) noexcept {
+        return dory_shm_ring_open(&Ring, server_path);
+      }
+
+      /* A true return value indicates that the ring is open and ready for
+         sending messages to Dory via Send() method below. */
+      bool IsOpen() const noexcept {
+        return (Ring.ctl_fd >= 0);
+      }
+
+      /* Send a message to Dory.  You must call Open() above with a successful
+         return value before calling this method.  A return value of EAGAIN
+         means the ring is currently full. */
+      int Send(const void *msg, size_t msg_size) noexcept {
+        return dory_shm_ring_send(&Ring, msg, msg_size);
+      }
+
+      /* Call this method when you are done sending messages to Dory.  It is
+         harmless to call Close() on an already closed object.  After calling
+         Close(), you can call Open() again to get a new ring. */
+      void Close() noexcept {
+        dory_shm_ring_close(&Ring);
+      }
+
+      private:
+      /* Helper method for move construction and assignment. */
+      void MoveState(TDoryShmRing &that) noexcept {
+        Ring = that.Ring;
+        dory_shm_ring_init(&that.Ring);
+      }
+
+      dory_shm_ring_t Ring;
+    };  // TDoryShmRing
+
+  }  // Client
+
+}  // Dory
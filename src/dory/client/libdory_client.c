@@ -19,6 +19,9 @@
    Dory client C library implementation.
  */
 
+/* Needed for sendmmsg(). */
+#define _GNU_SOURCE
+
 #include <dory/client/dory_client.h>
 
 #include <assert.h>
@@ -26,7 +29,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -34,6 +39,7 @@
 #include <dory/client/build_id.h>
 #include <dory/input_dg/any_partition/v0/v0_write_msg.h>
 #include <dory/input_dg/partition_key/v0/v0_write_msg.h>
+#include <dory/shm/shm_ring_layout.h>
 
 const char EXPORT_SYM *dory_get_build_id() {
   return dory_client_lib_build_id;
@@ -222,6 +228,98 @@ int EXPORT_SYM dory_client_socket_send(
   return (ret < 0) ? errno : DORY_OK;
 }
 
+/* Maximum number of messages passed to a single sendmmsg() call.  This keeps
+   the per-call arrays small enough to live on the stack, while still
+   amortizing the system call overhead over many messages. */
+enum { SEND_BATCH_MAX = 64 };
+
+int EXPORT_SYM dory_client_socket_send_batch(
+    const dory_client_socket_t *client_socket, const dory_msg_buf_t *msgs,
+    size_t msg_count, int *status, size_t *sent_count) {
+  assert(client_socket);
+  assert(msgs || (msg_count == 0));
+  struct mmsghdr hdrs[SEND_BATCH_MAX];
+  struct iovec iovs[SEND_BATCH_MAX];
+  size_t sent = 0;
+  size_t i = 0;
+  int result = DORY_OK;
+
+  while (i < msg_count) {
+    size_t n = msg_count - i;
+
+    if (n > SEND_BATCH_MAX) {
+      n = SEND_BATCH_MAX;
+    }
+
+    size_t j;
+
+    for (j = 0; j < n; ++j) {
+      const dory_msg_buf_t *buf = &msgs[i + j];
+      assert(buf->msg);
+      assert(buf->msg_size);
+      iovs[j].iov_base = (void *) buf->msg;
+      iovs[j].iov_len = buf->msg_size;
+      memset(&hdrs[j], 0, sizeof(hdrs[j]));
+      hdrs[j].msg_hdr.msg_name = (void *) &client_socket->server_addr;
+      hdrs[j].msg_hdr.msg_namelen = sizeof(client_socket->server_addr);
+      hdrs[j].msg_hdr.msg_iov = &iovs[j];
+      hdrs[j].msg_hdr.msg_iovlen = 1;
+    }
+
+    int ret = sendmmsg(client_socket->sock_fd, hdrs, (unsigned int) n, 0);
+
+    if (ret > 0) {
+      /* A partial send means the message after the last one sent got an
+         error, which the next call reports. */
+      for (j = 0; j < (size_t) ret; ++j) {
+        if (status) {
+          status[i + j] = DORY_OK;
+        }
+      }
+
+      i += (size_t) ret;
+      sent += (size_t) ret;
+      continue;
+    }
+
+    /* The message at index i wasn't sent. */
+    int err = (ret < 0) ? errno : EIO;
+
+    if (err == EINTR) {
+      continue;
+    }
+
+    if (err == EWOULDBLOCK) {
+      err = EAGAIN;
+    }
+
+    if (result == DORY_OK) {
+      result = err;
+    }
+
+    if (status) {
+      status[i] = err;
+    }
+
+    ++i;
+
+    if (err != EMSGSIZE) {
+      /* Mark the rest as not sent. */
+      for (; i < msg_count; ++i) {
+        if (status) {
+          status[i] = err;
+        }
+      }
+    }
+  }
+
+  if (sent_count) {
+    *sent_count = sent;
+  }
+
+  return result;
+}
+
 void EXPORT_SYM dory_client_socket_close(
     dory_client_socket_t *client_socket) {
   assert(client_socket);
@@ -231,3 +329,273 @@ void EXPORT_SYM dory_client_socket_close(
     client_socket->sock_fd = -1;
   }
 }
+
+void EXPORT_SYM dory_shm_ring_init(dory_shm_ring_t *ring) {
+  assert(ring);
+  ring->ctl_fd = -1;
+  ring->doorbell_fd = -1;
+  ring->mem = NULL;
+  ring->mem_size = 0;
+  ring->data_size = 0;
+  ring->head = 0;
+}
+
+static inline uint64_t *get_ring_field(void *mem, size_t offset) {
+  return (uint64_t *) (((uint8_t *) mem) + offset);
+}
+
+/* Receive hello message from Dory, with memfd and doorbell fds attached. */
+static int recv_ring_fds(int ctl_fd, int *mem_fd, int *doorbell_fd) {
+  *mem_fd = -1;
+  *doorbell_fd = -1;
+  uint8_t hello[SHM_HELLO_SIZE];
+  struct iovec iov;
+  iov.iov_base = hello;
+  iov.iov_len = sizeof(hello);
+  union {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  ssize_t ret = 0;
+
+  do {
+    ret = recvmsg(ctl_fd, &msg, MSG_CMSG_CLOEXEC);
+  } while ((ret < 0) && (errno == EINTR));
+
+  if (ret < 0) {
+    return errno;
+  }
+
+  struct cmsghdr *cmsg = NULL;
+  int fds[2] = { -1, -1 };
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) &&
+        (cmsg->cmsg_type == SCM_RIGHTS)) {
+      size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+      if (count > 2) {
+        count = 2;
+      }
+
+      memcpy(fds, CMSG_DATA(cmsg), count * sizeof(int));
+    }
+  }
+
+  int status = DORY_OK;
+
+  if ((ret != sizeof(hello)) || (hello[0] != SHM_PROTOCOL_VERSION)) {
+    status = EPROTO;
+  } else if (hello[1] == SHM_STATUS_TOO_MANY_RINGS) {
+    status = EBUSY;
+  } else if ((hello[1] != SHM_STATUS_OK) || (fds[0] < 0) || (fds[1] < 0) ||
+      (msg.msg_flags & MSG_CTRUNC)) {
+    status = EPROTO;
+  }
+
+  if (status != DORY_OK) {
+    if (fds[0] >= 0) {
+      close(fds[0]);
+    }
+
+    if (fds[1] >= 0) {
+      close(fds[1]);
+    }
+
+    return status;
+  }
+
+  *mem_fd = fds[0];
+  *doorbell_fd = fds[1];
+  return DORY_OK;
+}
+
+/* Map ring from 'mem_fd' and check its header. */
+static int map_ring(dory_shm_ring_t *ring, int mem_fd) {
+  struct stat st;
+
+  if (fstat(mem_fd, &st) < 0) {
+    return errno;
+  }
+
+  size_t mem_size = (size_t) st.st_size;
+
+  if (mem_size < SHM_RING_DATA_OFFSET) {
+    return EPROTO;
+  }
+
+  void *mem = mmap(NULL, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      mem_fd, 0);
+
+  if (mem == MAP_FAILED) {
+    return errno;
+  }
+
+  const uint8_t *bytes = (const uint8_t *) mem;
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  memcpy(&magic, bytes + SHM_RING_MAGIC_OFFSET, sizeof(magic));
+  memcpy(&version, bytes + SHM_RING_VERSION_OFFSET, sizeof(version));
+  uint64_t data_size = *get_ring_field(mem, SHM_RING_DATA_SIZE_OFFSET);
+
+  if ((magic != SHM_RING_MAGIC) || (version != SHM_RING_VERSION) ||
+      (data_size < SHM_RING_RECORD_ALIGN) ||
+      (data_size & (data_size - 1)) ||
+      (data_size > (mem_size - SHM_RING_DATA_OFFSET))) {
+    munmap(mem, mem_size);
+    return EPROTO;
+  }
+
+  ring->mem = mem;
+  ring->mem_size = mem_size;
+  ring->data_size = (size_t) data_size;
+  ring->head = __atomic_load_n(get_ring_field(mem, SHM_RING_HEAD_OFFSET),
+      __ATOMIC_ACQUIRE);
+  return DORY_OK;
+}
+
+int EXPORT_SYM dory_shm_ring_open(dory_shm_ring_t *ring,
+    const char *server_path) {
+  assert(ring);
+  assert(server_path);
+
+  if (ring->ctl_fd >= 0) {
+    return DORY_CLIENT_SOCK_IS_OPENED;
+  }
+
+  struct sockaddr_un server_addr;
+  memset(&server_addr, 0, sizeof(server_addr));
+  server_addr.sun_family = AF_LOCAL;
+
+  if (strlen(server_path) >= sizeof(server_addr.sun_path)) {
+    return DORY_SERVER_SOCK_PATH_TOO_LONG;
+  }
+
+  strncpy(server_addr.sun_path, server_path, sizeof(server_addr.sun_path));
+  int ctl_fd = socket(AF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (ctl_fd < 0) {
+    return errno;
+  }
+
+  int mem_fd = -1;
+  int doorbell_fd = -1;
+  int status = DORY_OK;
+
+  if (connect(ctl_fd, (const struct sockaddr *) &server_addr,
+          sizeof(server_addr)) < 0) {
+    status = errno;
+    goto fail;
+  }
+
+  status = recv_ring_fds(ctl_fd, &mem_fd, &doorbell_fd);
+
+  if (status != DORY_OK) {
+    goto fail;
+  }
+
+  status = map_ring(ring, mem_fd);
+
+  /* The mapping stays valid after the memfd is closed. */
+  close(mem_fd);
+
+  if (status != DORY_OK) {
+    goto fail;
+  }
+
+  ring->ctl_fd = ctl_fd;
+  ring->doorbell_fd = doorbell_fd;
+  return DORY_OK;
+
+fail:
+  if (doorbell_fd >= 0) {
+    close(doorbell_fd);
+  }
+
+  close(ctl_fd);
+  return status;
+}
+
+int EXPORT_SYM dory_shm_ring_send(dory_shm_ring_t *ring, const void *msg,
+    size_t msg_size) {
+  assert(ring);
+  assert(ring->mem);
+  assert(msg);
+
+  /* Dory reads the first 4 bytes as the datagram size field. */
+  if (msg_size < 4) {
+    return EINVAL;
+  }
+
+  size_t rec_size = (msg_size + SHM_RING_RECORD_ALIGN - 1) &
+      ~((size_t) SHM_RING_RECORD_ALIGN - 1);
+
+  if (rec_size > ring->data_size) {
+    return EMSGSIZE;
+  }
+
+  uint64_t *head_field = get_ring_field(ring->mem, SHM_RING_HEAD_OFFSET);
+  uint64_t *tail_field = get_ring_field(ring->mem, SHM_RING_TAIL_OFFSET);
+  uint8_t *data = ((uint8_t *) ring->mem) + SHM_RING_DATA_OFFSET;
+  uint64_t old_head = ring->head;
+  uint64_t tail = __atomic_load_n(tail_field, __ATOMIC_ACQUIRE);
+  size_t pos = (size_t) (old_head & (ring->data_size - 1));
+  size_t contig = ring->data_size - pos;
+
+  /* A record never wraps around the end of the data area.  If it doesn't
+     fit, the rest of the data area is padding. */
+  size_t pad = (rec_size > contig) ? contig : 0;
+
+  if ((ring->data_size - (old_head - tail)) < (pad + rec_size)) {
+    return EAGAIN;
+  }
+
+  if (pad) {
+    memset(data + pos, 0, 4);
+    pos = 0;
+  }
+
+  memcpy(data + pos, msg, msg_size);
+  ring->head = old_head + pad + rec_size;
+  __atomic_store_n(head_field, ring->head, __ATOMIC_RELEASE);
+
+  /* Pairs with the fence Dory executes after finding the ring empty.  Either
+     Dory sees our new head, or we see that it consumed everything before it
+     and ring the doorbell. */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(tail_field, __ATOMIC_ACQUIRE) == old_head) {
+    uint64_t one = 1;
+
+    if ((write(ring->doorbell_fd, &one, sizeof(one)) < 0) &&
+        (errno != EAGAIN)) {
+      return errno;
+    }
+  }
+
+  return DORY_OK;
+}
+
+void EXPORT_SYM dory_shm_ring_close(dory_shm_ring_t *ring) {
+  assert(ring);
+
+  if (ring->mem) {
+    munmap(ring->mem, ring->mem_size);
+  }
+
+  if (ring->doorbell_fd >= 0) {
+    close(ring->doorbell_fd);
+  }
+
+  if (ring->ctl_fd >= 0) {
+    close(ring->ctl_fd);
+  }
+
+  dory_shm_ring_init(ring);
+}
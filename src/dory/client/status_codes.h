@@ -42,5 +42,8 @@ enum {
   DORY_CLIENT_SOCK_PATH_TOO_LONG = -5,
 
   /* Pathname of Dory server socket is too long. */
-  DORY_SERVER_SOCK_PATH_TOO_LONG = -6
+  DORY_SERVER_SOCK_PATH_TOO_LONG = -6,
+
+  /* Message in batch refers to a topic not in the batch's topic table. */
+  DORY_INVALID_TOPIC_INDEX = -7
 };
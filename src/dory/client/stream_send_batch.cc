@@ -0,0 +1,117 @@
+/* <dory/client/stream_send_batch.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/client/stream_send_batch.h>.
+ */
+
+#include <dory/client/stream_send_batch.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <base/error_utils.h>
+#include <dory/client/status_codes.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Client;
+
+/* Maximum number of pieces passed to a single sendmsg() call. */
+static const size_t MAX_IOV = 1024;
+
+/* Mark each message in 'status' as sent if all of it is within the first
+   'written' bytes, or as failed with 'err' otherwise. */
+static void SetStatus(const dory_msg_buf_t *msgs, size_t msg_count,
+    int *status, size_t written, int err) {
+  if (status == nullptr) {
+    return;
+  }
+
+  size_t end = 0;
+
+  for (size_t i = 0; i < msg_count; ++i) {
+    end += msgs[i].msg_size;
+    status[i] = (end <= written) ? DORY_OK : err;
+  }
+}
+
+void Dory::Client::StreamSendBatch(int fd, const dory_msg_buf_t *msgs,
+    size_t msg_count, int *status) {
+  assert(msgs || (msg_count == 0));
+  std::vector<struct iovec> iov;
+
+  for (size_t i = 0; i < msg_count; ++i) {
+    uint8_t *msg =
+        reinterpret_cast<uint8_t *>(const_cast<void *>(msgs[i].msg));
+
+    if (!iov.empty()) {
+      struct iovec &last = iov.back();
+
+      if ((reinterpret_cast<uint8_t *>(last.iov_base) + last.iov_len) == msg) {
+        last.iov_len += msgs[i].msg_size;
+        continue;
+      }
+    }
+
+    iov.push_back({ msg, msgs[i].msg_size });
+  }
+
+  size_t first = 0;
+  size_t total_written = 0;
+
+  while (first < iov.size()) {
+    struct msghdr hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov[first];
+    hdr.msg_iovlen = std::min(MAX_IOV, iov.size() - first);
+    ssize_t ret = sendmsg(fd, &hdr, MSG_NOSIGNAL);
+
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      SetStatus(msgs, msg_count, status, total_written, errno);
+      IfLt0(ret);  // this will throw
+    }
+
+    /* Skip past what was written, which may end in the middle of a piece. */
+    size_t written = static_cast<size_t>(ret);
+    total_written += written;
+
+    while (written && (written >= iov[first].iov_len)) {
+      written -= iov[first].iov_len;
+      ++first;
+    }
+
+    if (written) {
+      iov[first].iov_base =
+          reinterpret_cast<uint8_t *>(iov[first].iov_base) + written;
+      iov[first].iov_len -= written;
+    }
+  }
+
+  SetStatus(msgs, msg_count, status, total_written, DORY_OK);
+}
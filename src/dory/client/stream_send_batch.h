@@ -0,0 +1,44 @@
+/* <dory/client/stream_send_batch.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Function for sending a batch of messages over a stream socket to Dory.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <dory/client/dory_client.h>
+
+namespace Dory {
+
+  namespace Client {
+
+    /* Write the 'msg_count' messages in 'msgs' to stream socket 'fd', in
+       order.  Messages that are adjacent in memory are written as a single
+       piece, and all pieces are passed to as few sendmsg() calls as
+       possible.  Handles partial writes.  Throws std::system_error on error.
+       If 'status' is not null, it must point to an array of 'msg_count'
+       ints.  Before returning or throwing, status[i] is set to DORY_OK if
+       all of msgs[i] was written, or the errno value otherwise. */
+    void StreamSendBatch(int fd, const dory_msg_buf_t *msgs,
+        size_t msg_count, int *status = nullptr);
+
+  }  // Client
+
+}  // Dory
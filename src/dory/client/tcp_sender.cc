@@ -29,6 +29,7 @@
 #include <sys/types.h>
 
 #include <base/error_utils.h>
+#include <dory/client/stream_send_batch.h>
 
 using namespace Base;
 using namespace Dory;
@@ -51,6 +52,12 @@ void TTcpSender::DoSend(const uint8_t *msg, size_t msg_size) {
   IfLt0(send(Sock, msg, msg_size, MSG_NOSIGNAL));
 }
 
+void TTcpSender::DoSendBatch(const dory_msg_buf_t *msgs, size_t msg_count,
+    int *status) {
+  assert(this);
+  StreamSendBatch(Sock, msgs, msg_count, status);
+}
+
 void TTcpSender::DoReset() {
   assert(this);
   Sock.Reset();
@@ -101,6 +101,8 @@ struct TConfig {
   bool Bad;
 
   size_t Print;
+
+  size_t Batch;
 };  // TConfig
 
 static void ParseArgs(int argc, char *argv[], TConfig &config) {
@@ -156,6 +158,11 @@ static void ParseArgs(int argc, char *argv[], TConfig &config) {
         "print message number every nth message.", false, config.Print,
         "PRINT");
     cmd.add(arg_print);
+    ValueArg<decltype(config.Batch)> arg_batch("", "batch", "Send messages "
+        "in batches of this size, with one sendmmsg() call per batch.  Only "
+        "valid with --socket_path.  With --interval, the interval applies to "
+        "batches rather than messages.", false, config.Batch, "BATCH");
+    cmd.add(arg_batch);
     cmd.parse(argc, &arg_vec[0]);
     config.SocketPath = arg_socket_path.getValue();
     config.StreamSocketPath = arg_stream_socket_path.getValue();
@@ -185,6 +192,7 @@ static void ParseArgs(int argc, char *argv[], TConfig &config) {
     config.Pad = arg_pad.getValue();
     config.Bad = arg_bad.getValue();
     config.Print = arg_print.getValue();
+    config.Batch = arg_batch.getValue();
 
     if (arg_socket_path.isSet()) {
       ++input_type_count;
@@ -202,6 +210,14 @@ static void ParseArgs(int argc, char *argv[], TConfig &config) {
     throw TArgParseError(x.error(), x.argId());
   }
 
+  if (config.Batch == 0) {
+    throw TArgParseError("--batch value must be > 0.");
+  }
+
+  if ((config.Batch > 1) && config.SocketPath.empty()) {
+    throw TArgParseError("--batch requires --socket_path.");
+  }
+
   if (config.Stdin && config.ValueSpecified) {
     throw TArgParseError(
         "You cannot specify --value <VALUE> and --stdin simultaneously.");
@@ -216,7 +232,8 @@ TConfig::TConfig(int argc, char *argv[])
       Seq(false),
       Pad(0),
       Bad(false),
-      Print(0) {
+      Print(0),
+      Batch(1) {
   ParseArgs(argc, argv, *this);
 }
 
@@ -330,6 +347,45 @@ static TClientSenderBase *CreateSender(const TConfig &cfg) {
   return new TTcpSender(*cfg.Port);
 }
 
+/* Send messages in batches of cfg.Batch, using one sendmmsg() call per
+   batch. */
+static int SendBatches(const TConfig &cfg) {
+  TUnixDgSender sender(cfg.SocketPath);
+  sender.PrepareToSend();
+  std::vector<std::vector<uint8_t>> dg_bufs(cfg.Batch);
+  std::vector<dory_msg_buf_t> msgs(cfg.Batch);
+  const clockid_t CLOCK_TYPE = CLOCK_MONOTONIC_RAW;
+  TTime deadline;
+
+  for (size_t i = 1; i <= cfg.Count; ) {
+    size_t batch_size = std::min(cfg.Batch, cfg.Count - i + 1);
+
+    for (size_t j = 0; j < batch_size; ++j) {
+      std::vector<uint8_t> &dg_buf = dg_bufs[j];
+
+      if (!CreateDg(dg_buf, cfg, i + j)) {
+        return EXIT_FAILURE;
+      }
+
+      msgs[j].msg = &dg_buf[0];
+      msgs[j].msg_size = dg_buf.size();
+    }
+
+    SleepMicroseconds(deadline.RemainingMicroseconds(CLOCK_TYPE));
+    deadline.Now(CLOCK_TYPE);
+    sender.SendBatch(&msgs[0], batch_size);
+    deadline.AddMicroseconds(cfg.Interval);
+
+    for (size_t j = 0; j < batch_size; ++j, ++i) {
+      if (cfg.Print && ((i % cfg.Print) == 0)) {
+        std::cout << i << " messages written" << std::endl;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
 static int ToDoryMain(int argc, char *argv[]) {
   std::unique_ptr<TConfig> cfg;
 
@@ -341,6 +397,10 @@ static int ToDoryMain(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  if (cfg->Batch > 1) {
+    return SendBatches(*cfg);
+  }
+
   std::unique_ptr<TClientSenderBase> sender(CreateSender(*cfg));
   sender->PrepareToSend();
   std::vector<uint8_t> dg_buf;
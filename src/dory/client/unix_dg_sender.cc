@@ -62,6 +62,24 @@ void TUnixDgSender::DoSend(const uint8_t *msg, size_t msg_size) {
   }
 }
 
+void TUnixDgSender::DoSendBatch(const dory_msg_buf_t *msgs,
+    size_t msg_count, int *status) {
+  assert(this);
+
+  if (Sock.SendBatch(msgs, msg_count, status) == DORY_OK) {
+    return;
+  }
+
+  /* Messages too large to send are skipped, and the rest are still sent.
+     Any other error stops sending. */
+  for (size_t i = 0; i < msg_count; ++i) {
+    if ((status[i] != DORY_OK) && (status[i] != EMSGSIZE)) {
+      assert(status[i] > 0);
+      ThrowSystemError(status[i]);
+    }
+  }
+}
+
 void TUnixDgSender::DoReset() {
   assert(this);
   Sock.Close();
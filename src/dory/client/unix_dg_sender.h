@@ -53,6 +53,10 @@ namespace Dory {
 
       virtual void DoSend(const uint8_t *msg, size_t msg_size);
 
+      /* Sends the messages with sendmmsg(). */
+      virtual void DoSendBatch(const dory_msg_buf_t *msgs, size_t msg_count,
+          int *status);
+
       virtual void DoReset();
 
       private:
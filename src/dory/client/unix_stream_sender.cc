@@ -30,6 +30,7 @@
 
 #include <base/error_utils.h>
 #include <dory/client/path_too_long.h>
+#include <dory/client/stream_send_batch.h>
 
 using namespace Base;
 using namespace Dory;
@@ -57,6 +58,12 @@ void TUnixStreamSender::DoSend(const uint8_t *msg, size_t msg_size) {
   IfLt0(send(Sock, msg, msg_size, MSG_NOSIGNAL));
 }
 
+void TUnixStreamSender::DoSendBatch(const dory_msg_buf_t *msgs,
+    size_t msg_count, int *status) {
+  assert(this);
+  StreamSendBatch(Sock, msgs, msg_count, status);
+}
+
 void TUnixStreamSender::DoReset() {
   assert(this);
   Sock.Reset();
@@ -234,12 +234,29 @@ size_t TLz4Codec::Uncompress(const void *input_buf, size_t input_buf_size,
   return out_offset;  // size in bytes of uncompressed output
 }
 
+/* Frame preferences used by DoCompress().  The result buffer space must be
+   computed with the same preferences, since they affect the frame header
+   size. */
+static LZ4F_preferences_t MakePrefs(int compression_level,
+    size_t input_size) {
+  LZ4F_preferences_t prefs;
+  std::memset(&prefs, 0, sizeof(prefs));
+  prefs.compressionLevel = compression_level;
+  prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+  prefs.frameInfo.contentSize = input_size;
+  return prefs;
+}
+
 size_t TLz4Codec::DoComputeCompressedResultBufSpace(
     const void * /*uncompressed_data*/, size_t uncompressed_size,
-    int /*compression_level*/) const {
+    int compression_level) const {
   assert(this);
-  return CheckLz4Status(LZ4F_compressBound(uncompressed_size, nullptr),
-      "LZ4F_compressBound");
+  LZ4F_preferences_t prefs = MakePrefs(compression_level, uncompressed_size);
+
+  /* Unlike LZ4F_compressBound(), this includes space for the frame header,
+     which DoCompress() writes in addition to the compressed blocks. */
+  return CheckLz4Status(LZ4F_compressFrameBound(uncompressed_size, &prefs),
+      "LZ4F_compressFrameBound");
 }
 
 size_t TLz4Codec::DoCompress(const void *input_buf, size_t input_buf_size,
@@ -257,11 +274,7 @@ size_t TLz4Codec::DoCompress(const void *input_buf, size_t input_buf_size,
       }
   );
 
-  LZ4F_preferences_t prefs;
-  std::memset(&prefs, 0, sizeof(prefs));
-  prefs.compressionLevel = compression_level;
-  prefs.frameInfo.blockMode = LZ4F_blockIndependent;
-  prefs.frameInfo.contentSize = input_buf_size;
+  LZ4F_preferences_t prefs = MakePrefs(compression_level, input_buf_size);
   size_t bytes_written = CheckLz4Status(
       LZ4F_compressBegin(cctx, out_buf, output_buf_size, &prefs),
       "LZ4F_compressBegin");
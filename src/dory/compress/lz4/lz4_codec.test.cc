@@ -21,6 +21,8 @@
 
 #include <dory/compress/lz4/lz4_codec.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -139,6 +141,38 @@ namespace {
     ASSERT_EQ(final_result, to_compress);
   }
 
+  TEST_F(TLz4CodecTest, IncompressibleTest) {
+    const TLz4Codec &codec = TLz4Codec::The();
+    std::string to_compress;
+    uint32_t state = 12345;
+
+    /* Pseudorandom data doesn't compress, so the compressed size includes
+       the full frame overhead. */
+    for (size_t i = 0; i < 64 * 1024; ++i) {
+      state = (state * 1103515245) + 12345;
+      to_compress.push_back(static_cast<char>(state >> 16));
+    }
+
+    TOpt<int> level;
+    std::vector<char> compressed_output(
+        codec.ComputeCompressedResultBufSpace(to_compress.data(),
+            to_compress.size(), level));
+    size_t result_size = codec.Compress(to_compress.data(), to_compress.size(),
+        &compressed_output[0], compressed_output.size(), level);
+    ASSERT_LE(result_size, compressed_output.size());
+    compressed_output.resize(result_size);
+
+    std::vector<char> uncompressed_output(
+        codec.ComputeUncompressedResultBufSpace(&compressed_output[0],
+            compressed_output.size()));
+    result_size = codec.Uncompress(&compressed_output[0],
+        compressed_output.size(), &uncompressed_output[0],
+        uncompressed_output.size());
+    ASSERT_EQ(result_size, to_compress.size());
+    ASSERT_TRUE(std::equal(to_compress.begin(), to_compress.end(),
+        uncompressed_output.begin()));
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,116 @@
+/* <dory/compression_stats.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/compression_stats.h>.
+ */
+
+#include <dory/compression_stats.h>
+
+#include <algorithm>
+
+using namespace Dory;
+
+const float TCompressionStats::RATIO_SMOOTHING = 0.25f;
+
+bool TCompressionStats::ShouldCompress(const std::string &topic) {
+  assert(this);
+
+  if (ProbeInterval == 0) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  TTopicState &state = TopicState[topic];
+
+  if (!state.Stats.Skipping) {
+    return true;
+  }
+
+  if (++state.SinceProbe >= ProbeInterval) {
+    /* Probe to see whether the topic has started compressing well. */
+    state.SinceProbe = 0;
+    return true;
+  }
+
+  ++state.Stats.SkipCount;
+  return false;
+}
+
+void TCompressionStats::RecordCompression(const std::string &topic,
+    size_t uncompressed_size, size_t compressed_size, uint64_t elapsed_ns,
+    float max_ratio) {
+  assert(this);
+
+  /* Compute the ratio the same way TProduceRequestFactory does, so we agree
+     with it on which message sets were sent compressed. */
+  float ratio = uncompressed_size ?
+      (static_cast<float>(compressed_size) /
+       static_cast<float>(uncompressed_size)) :
+      1.0f;
+  bool sent_compressed = (ratio <= max_ratio);
+  std::lock_guard<std::mutex> lock(Mutex);
+  TTopicState &state = TopicState[topic];
+  TTopicStats &stats = state.Stats;
+
+  if (stats.AttemptCount == 0) {
+    stats.RecentRatio = ratio;
+  } else {
+    stats.RecentRatio += (ratio - stats.RecentRatio) * RATIO_SMOOTHING;
+  }
+
+  ++stats.AttemptCount;
+  stats.UncompressedBytes += uncompressed_size;
+  stats.CompressedBytes += compressed_size;
+  stats.CompressionNs += elapsed_ns;
+
+  if (!sent_compressed) {
+    ++stats.NotCompressibleCount;
+  } else if (compressed_size < uncompressed_size) {
+    stats.BytesSaved += uncompressed_size - compressed_size;
+  }
+
+  if (stats.Skipping && sent_compressed) {
+    /* A probe succeeded.  Let the average start over from here so a single
+       bad message set doesn't put the topic right back into skipping. */
+    stats.Skipping = false;
+    stats.RecentRatio = ratio;
+  } else {
+    stats.Skipping = (ProbeInterval != 0) && (stats.RecentRatio > max_ratio);
+  }
+
+  state.SinceProbe = 0;
+}
+
+void TCompressionStats::GetStats(
+    std::vector<TTopicStatsItem> &topic_stats) const {
+  assert(this);
+  topic_stats.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    for (const auto &item : TopicState) {
+      topic_stats.push_back(std::make_pair(item.first, item.second.Stats));
+    }
+  }
+
+  std::sort(topic_stats.begin(), topic_stats.end(),
+      [](const TTopicStatsItem &x, const TTopicStatsItem &y) {
+        return x.first < y.first;
+      });
+}
@@ -0,0 +1,146 @@
+/* <dory/compression_stats.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for tracking per-topic compression statistics and deciding when
+   compression of a topic's message sets is worth attempting.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  /* Shared by all connector threads.  Tracks how well each topic's message
+     sets compress and how much CPU time compressing them costs.  A topic
+     whose recent compression ratio exceeds the configured maximum is treated
+     as incompressible: its message sets are sent uncompressed without a
+     compression attempt, except for one out of every 'probe_interval'
+     message sets, which is compressed as a probe.  A probe that compresses
+     well enough returns the topic to normal compression. */
+  class TCompressionStats final {
+    NO_COPY_SEMANTICS(TCompressionStats);
+
+    public:
+    /* Weight given to the most recent message set when updating a topic's
+       running compression ratio. */
+    static const float RATIO_SMOOTHING;
+
+    struct TTopicStats {
+      /* Number of message sets we attempted to compress. */
+      uint64_t AttemptCount;
+
+      /* Number of attempts whose result compressed too poorly to send. */
+      uint64_t NotCompressibleCount;
+
+      /* Number of message sets sent uncompressed without an attempt, because
+         the topic was considered incompressible. */
+      uint64_t SkipCount;
+
+      /* Total input and output sizes of all compression attempts. */
+      uint64_t UncompressedBytes;
+
+      uint64_t CompressedBytes;
+
+      /* Bytes saved by message sets actually sent compressed. */
+      uint64_t BytesSaved;
+
+      /* Total time spent compressing, in nanoseconds. */
+      uint64_t CompressionNs;
+
+      /* Running average of compressed size / uncompressed size. */
+      float RecentRatio;
+
+      /* True if the topic is currently considered incompressible. */
+      bool Skipping;
+
+      TTopicStats()
+          : AttemptCount(0),
+            NotCompressibleCount(0),
+            SkipCount(0),
+            UncompressedBytes(0),
+            CompressedBytes(0),
+            BytesSaved(0),
+            CompressionNs(0),
+            RecentRatio(0.0f),
+            Skipping(false) {
+      }
+    };  // TTopicStats
+
+    /* A 'probe_interval' value of 0 disables skipping, so that compression is
+       always attempted.  Statistics are still collected in that case. */
+    explicit TCompressionStats(size_t probe_interval)
+        : ProbeInterval(probe_interval) {
+    }
+
+    size_t GetProbeInterval() const {
+      assert(this);
+      return ProbeInterval;
+    }
+
+    /* Called before compressing a message set for 'topic'.  Returns false if
+       the message set should be sent uncompressed without trying. */
+    bool ShouldCompress(const std::string &topic);
+
+    /* Record a compression attempt for 'topic' that turned
+       'uncompressed_size' bytes into 'compressed_size' bytes in
+       'elapsed_ns' nanoseconds.  'max_ratio' is the largest ratio of
+       compressed to uncompressed size for which the compressed result is
+       sent. */
+    void RecordCompression(const std::string &topic, size_t uncompressed_size,
+        size_t compressed_size, uint64_t elapsed_ns, float max_ratio);
+
+    /* The first item is the topic, and the second item is stats for that
+       topic. */
+    using TTopicStatsItem = std::pair<std::string, TTopicStats>;
+
+    /* On return, 'topic_stats' will contain stats for all topics that have
+       had at least one message set considered for compression, sorted by
+       topic. */
+    void GetStats(std::vector<TTopicStatsItem> &topic_stats) const;
+
+    private:
+    struct TTopicState {
+      TTopicStats Stats;
+
+      /* Message sets skipped since the last probe. */
+      size_t SinceProbe;
+
+      TTopicState()
+          : SinceProbe(0) {
+      }
+    };  // TTopicState
+
+    const size_t ProbeInterval;
+
+    /* Protects 'TopicState'. */
+    mutable std::mutex Mutex;
+
+    std::unordered_map<std::string, TTopicState> TopicState;
+  };  // TCompressionStats
+
+}  // Dory
@@ -0,0 +1,167 @@
+/* <dory/compression_stats.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/compression_stats.h>.
+ */
+
+#include <dory/compression_stats.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace Dory;
+
+namespace {
+
+  /* Max ratio for the tests below, and sizes that fall on each side of it. */
+  const float MAX_RATIO = 0.75f;
+
+  const size_t INPUT_SIZE = 1000;
+
+  const size_t GOOD_SIZE = 300;
+
+  const size_t BAD_SIZE = 990;
+
+  /* Count how many of the next 'n' message sets for 'topic' would be
+     compressed, recording 'compressed_size' as the result of each attempt. */
+  size_t RunMsgSets(TCompressionStats &stats, const std::string &topic,
+      size_t n, size_t compressed_size) {
+    size_t attempts = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+      if (stats.ShouldCompress(topic)) {
+        ++attempts;
+        stats.RecordCompression(topic, INPUT_SIZE, compressed_size, 10,
+            MAX_RATIO);
+      }
+    }
+
+    return attempts;
+  }
+
+  /* The fixture for testing class TCompressionStats. */
+  class TCompressionStatsTest : public ::testing::Test {
+    protected:
+    TCompressionStatsTest() {
+    }
+
+    virtual ~TCompressionStatsTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TCompressionStatsTest
+
+  TEST_F(TCompressionStatsTest, CompressibleTopic) {
+    TCompressionStats stats(32);
+    ASSERT_EQ(RunMsgSets(stats, "t1", 100, GOOD_SIZE), 100U);
+    std::vector<TCompressionStats::TTopicStatsItem> result;
+    stats.GetStats(result);
+    ASSERT_EQ(result.size(), 1U);
+    ASSERT_EQ(result[0].first, "t1");
+    const TCompressionStats::TTopicStats &s = result[0].second;
+    ASSERT_EQ(s.AttemptCount, 100U);
+    ASSERT_EQ(s.NotCompressibleCount, 0U);
+    ASSERT_EQ(s.SkipCount, 0U);
+    ASSERT_EQ(s.UncompressedBytes, 100U * INPUT_SIZE);
+    ASSERT_EQ(s.CompressedBytes, 100U * GOOD_SIZE);
+    ASSERT_EQ(s.BytesSaved, 100U * (INPUT_SIZE - GOOD_SIZE));
+    ASSERT_EQ(s.CompressionNs, 1000U);
+    ASSERT_FLOAT_EQ(s.RecentRatio, 0.3f);
+    ASSERT_FALSE(s.Skipping);
+  }
+
+  TEST_F(TCompressionStatsTest, IncompressibleTopic) {
+    TCompressionStats stats(32);
+
+    /* The first attempt establishes the running ratio, so the topic starts
+       being skipped right away.  After that, only one message set out of
+       every 32 is probed. */
+    ASSERT_EQ(RunMsgSets(stats, "t1", 1 + (32 * 10), BAD_SIZE), 11U);
+    std::vector<TCompressionStats::TTopicStatsItem> result;
+    stats.GetStats(result);
+    ASSERT_EQ(result.size(), 1U);
+    const TCompressionStats::TTopicStats &s = result[0].second;
+    ASSERT_EQ(s.AttemptCount, 11U);
+    ASSERT_EQ(s.NotCompressibleCount, 11U);
+    ASSERT_EQ(s.SkipCount, 310U);
+    ASSERT_EQ(s.BytesSaved, 0U);
+    ASSERT_TRUE(s.Skipping);
+  }
+
+  TEST_F(TCompressionStatsTest, OccasionalBadMsgSet) {
+    TCompressionStats stats(32);
+    ASSERT_EQ(RunMsgSets(stats, "t1", 10, GOOD_SIZE), 10U);
+
+    /* A single poorly compressing message set should not stop compression
+       of a topic that usually compresses well. */
+    ASSERT_EQ(RunMsgSets(stats, "t1", 1, BAD_SIZE), 1U);
+    ASSERT_EQ(RunMsgSets(stats, "t1", 10, GOOD_SIZE), 10U);
+
+    /* A sustained run of them should. */
+    ASSERT_LT(RunMsgSets(stats, "t1", 100, BAD_SIZE), 10U);
+  }
+
+  TEST_F(TCompressionStatsTest, Recovery) {
+    TCompressionStats stats(4);
+    ASSERT_EQ(RunMsgSets(stats, "t1", 1, BAD_SIZE), 1U);
+
+    /* Skip 3, then probe.  The probe compresses well, so everything after it
+       is compressed. */
+    ASSERT_EQ(RunMsgSets(stats, "t1", 3, GOOD_SIZE), 0U);
+    ASSERT_EQ(RunMsgSets(stats, "t1", 20, GOOD_SIZE), 20U);
+    std::vector<TCompressionStats::TTopicStatsItem> result;
+    stats.GetStats(result);
+    ASSERT_EQ(result.size(), 1U);
+    ASSERT_FALSE(result[0].second.Skipping);
+    ASSERT_EQ(result[0].second.SkipCount, 3U);
+  }
+
+  TEST_F(TCompressionStatsTest, ProbeIntervalZero) {
+    TCompressionStats stats(0);
+    ASSERT_EQ(RunMsgSets(stats, "t1", 50, BAD_SIZE), 50U);
+    ASSERT_EQ(RunMsgSets(stats, "t2", 50, GOOD_SIZE), 50U);
+    std::vector<TCompressionStats::TTopicStatsItem> result;
+    stats.GetStats(result);
+    ASSERT_EQ(result.size(), 2U);
+    ASSERT_EQ(result[0].first, "t1");
+    ASSERT_EQ(result[0].second.NotCompressibleCount, 50U);
+    ASSERT_FALSE(result[0].second.Skipping);
+    ASSERT_EQ(result[1].first, "t2");
+    ASSERT_EQ(result[1].second.NotCompressibleCount, 0U);
+  }
+
+  TEST_F(TCompressionStatsTest, TopicsIndependent) {
+    TCompressionStats stats(8);
+    ASSERT_EQ(RunMsgSets(stats, "bad", 1, BAD_SIZE), 1U);
+    ASSERT_EQ(RunMsgSets(stats, "good", 16, GOOD_SIZE), 16U);
+    ASSERT_EQ(RunMsgSets(stats, "bad", 16, BAD_SIZE), 2U);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -54,6 +54,10 @@ namespace Dory {
         Base::TOpt<size_t> OptMsgCount;
 
         Base::TOpt<size_t> OptByteCount;
+
+        /* Latency budget in milliseconds for adaptive batching.  Unknown if
+           batching is static. */
+        Base::TOpt<size_t> OptLatencyTarget;
       };  // TBatchValues
 
       struct TTopicConf {
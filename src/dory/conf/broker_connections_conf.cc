@@ -0,0 +1,74 @@
+/* <dory/conf/broker_connections_conf.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/conf/broker_connections_conf.h>.
+ */
+
+#include <dory/conf/broker_connections_conf.h>
+
+#include <utility>
+
+using namespace Dory;
+using namespace Dory::Conf;
+
+std::string
+TBrokerConnectionsConf::TBuilder::TDuplicateBrokerConfig::CreateMsg(
+    int32_t broker_id) {
+  std::string msg("Broker connections config contains duplicate "
+                  "specification for broker ID ");
+  msg += std::to_string(broker_id);
+  return std::move(msg);
+}
+
+void TBrokerConnectionsConf::TBuilder::Reset() {
+  assert(this);
+  BuildResult = TBrokerConnectionsConf();
+}
+
+void TBrokerConnectionsConf::TBuilder::SetDefaultCount(size_t count) {
+  assert(this);
+
+  if (count == 0) {
+    throw TZeroConnectionCount();
+  }
+
+  BuildResult.DefaultCount = count;
+}
+
+void TBrokerConnectionsConf::TBuilder::SetBrokerCount(int32_t broker_id,
+    size_t count) {
+  assert(this);
+
+  if (count == 0) {
+    throw TZeroConnectionCount();
+  }
+
+  auto result = BuildResult.BrokerConfigs.insert(
+      std::make_pair(broker_id, count));
+
+  if (!result.second) {
+    throw TDuplicateBrokerConfig(broker_id);
+  }
+}
+
+TBrokerConnectionsConf TBrokerConnectionsConf::TBuilder::Build() {
+  assert(this);
+  TBrokerConnectionsConf result = std::move(BuildResult);
+  Reset();
+  return std::move(result);
+}
@@ -0,0 +1,142 @@
+/* <dory/conf/broker_connections_conf.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class representing the number of TCP connections to open to each Kafka
+   broker, as obtained from Dory's config file.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <base/no_copy_semantics.h>
+#include <dory/conf/conf_error.h>
+
+namespace Dory {
+
+  namespace Conf {
+
+    class TBrokerConnectionsConf {
+      public:
+      class TBuilder;
+
+      /* Key is Kafka broker ID and value is connection count. */
+      using TBrokerMap = std::unordered_map<int32_t, size_t>;
+
+      TBrokerConnectionsConf()
+          : DefaultCount(1) {
+      }
+
+      TBrokerConnectionsConf(const TBrokerConnectionsConf &) = default;
+
+      TBrokerConnectionsConf(TBrokerConnectionsConf &&) = default;
+
+      TBrokerConnectionsConf &operator=(const TBrokerConnectionsConf &) =
+          default;
+
+      TBrokerConnectionsConf &operator=(TBrokerConnectionsConf &&) = default;
+
+      bool operator==(const TBrokerConnectionsConf &that) const {
+        assert(this);
+        return (DefaultCount == that.DefaultCount) &&
+            (BrokerConfigs == that.BrokerConfigs);
+      }
+
+      bool operator!=(const TBrokerConnectionsConf &that) const {
+        assert(this);
+        return !(*this == that);
+      }
+
+      /* Returns the connection count for brokers not listed in the map
+         returned by GetBrokerConfigs(). */
+      size_t GetDefaultCount() const {
+        assert(this);
+        return DefaultCount;
+      }
+
+      const TBrokerMap &GetBrokerConfigs() const {
+        assert(this);
+        return BrokerConfigs;
+      }
+
+      /* Returns the connection count for the broker with Kafka ID
+         'broker_id'. */
+      size_t GetCount(int32_t broker_id) const {
+        assert(this);
+        auto iter = BrokerConfigs.find(broker_id);
+        return (iter == BrokerConfigs.end()) ? DefaultCount : iter->second;
+      }
+
+      private:
+      size_t DefaultCount;
+
+      TBrokerMap BrokerConfigs;
+    };  // TBrokerConnectionsConf
+
+    class TBrokerConnectionsConf::TBuilder {
+      NO_COPY_SEMANTICS(TBuilder);
+
+      public:
+      /* Exception base class. */
+      class TErrorBase : public TConfError {
+        protected:
+        explicit TErrorBase(std::string &&msg)
+            : TConfError(std::move(msg)) {
+        }
+      };  // TErrorBase
+
+      class TDuplicateBrokerConfig final : public TErrorBase {
+        public:
+        explicit TDuplicateBrokerConfig(int32_t broker_id)
+            : TErrorBase(CreateMsg(broker_id)) {
+        }
+
+        private:
+        static std::string CreateMsg(int32_t broker_id);
+      };  // TDuplicateBrokerConfig
+
+      class TZeroConnectionCount final : public TErrorBase {
+        public:
+        TZeroConnectionCount()
+            : TErrorBase("Broker connections config contains connection "
+                  "count of zero") {
+        }
+      };  // TZeroConnectionCount
+
+      TBuilder() = default;
+
+      void Reset();
+
+      void SetDefaultCount(size_t count);
+
+      void SetBrokerCount(int32_t broker_id, size_t count);
+
+      TBrokerConnectionsConf Build();
+
+      private:
+      TBrokerConnectionsConf BuildResult;
+    };  // TBrokerConnectionsConf::TBuilder
+
+  }  // Conf
+
+}  // Dory
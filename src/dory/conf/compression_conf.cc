@@ -59,6 +59,20 @@ bool TCompressionConf::StringToType(const char *s, TCompressionType &result) {
   return false;
 }
 
+bool TCompressionConf::TConf::operator==(const TConf &that) const {
+  assert(this);
+  return (Type == that.Type) && (MinSize == that.MinSize) &&
+      (Level.IsKnown() == that.Level.IsKnown()) &&
+      (Level.IsUnknown() || (*Level == *that.Level));
+}
+
+bool TCompressionConf::operator==(const TCompressionConf &that) const {
+  assert(this);
+  return (SizeThresholdPercent == that.SizeThresholdPercent) &&
+      (DefaultTopicConfig == that.DefaultTopicConfig) &&
+      (TopicConfigs == that.TopicConfigs);
+}
+
 std::string TCompressionConf::TBuilder::TDuplicateNamedConfig::CreateMsg(
     const std::string &config_name) {
   std::string msg("Compression config contains duplicate named config: [");
@@ -67,6 +67,13 @@ namespace Dory {
         TConf(const TConf &) = default;
 
         TConf &operator=(const TConf &) = default;
+
+        bool operator==(const TConf &that) const;
+
+        bool operator!=(const TConf &that) const {
+          assert(this);
+          return !(*this == that);
+        }
       };  // TConf
 
       using TTopicMap = std::unordered_map<std::string, TConf>;
@@ -91,6 +98,13 @@ namespace Dory {
 
       TCompressionConf &operator=(TCompressionConf &&) = default;
 
+      bool operator==(const TCompressionConf &that) const;
+
+      bool operator!=(const TCompressionConf &that) const {
+        assert(this);
+        return !(*this == that);
+      }
+
       size_t GetSizeThresholdPercent() const {
         assert(this);
         return SizeThresholdPercent;
@@ -82,6 +82,10 @@ void TConf::TBuilder::Reset() {
   BatchingConfBuilder.Reset();
   CompressionConfBuilder.Reset();
   TopicRateConfBuilder.Reset();
+  TopicQuotaConfBuilder.Reset();
+  TopicPriorityConfBuilder.Reset();
+  TopicMaxAgeConfBuilder.Reset();
+  BrokerConnectionsConfBuilder.Reset();
 }
 
 void TConf::TBuilder::ProcessSingleBatchingNamedConfig(
@@ -91,7 +95,8 @@ void TConf::TBuilder::ProcessSingleBatchingNamedConfig(
       TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY);
   RequireAllChildElementLeaves(config_elem);
   auto subsection_map = GetSubsectionElements(config_elem,
-      {{"time", true}, {"messages", true}, {"bytes", true}}, false);
+      {{"time", true}, {"messages", true}, {"bytes", true},
+       {"latencyTarget", false}}, false);
   TBatchConf::TBatchValues values;
   values.OptTimeLimit = TAttrReader::GetOptInt2<size_t>(
       *subsection_map["time"], "value", "disable",
@@ -103,8 +108,20 @@ void TConf::TBuilder::ProcessSingleBatchingNamedConfig(
       *subsection_map["bytes"], "value", "disable",
       TOpts::REQUIRE_PRESENCE | TOpts::STRICT_EMPTY_VALUE | TOpts::ALLOW_K);
 
+  if (subsection_map.count("latencyTarget")) {
+    const DOMElement &elem = *subsection_map["latencyTarget"];
+    size_t latency_target = TAttrReader::GetInt<size_t>(elem, "value");
+
+    if (latency_target == 0) {
+      throw TAttrError("Attribute value must be positive", elem, "value");
+    }
+
+    values.OptLatencyTarget.MakeKnown(latency_target);
+  }
+
   if (values.OptTimeLimit.IsUnknown() && values.OptMsgCount.IsUnknown() &&
-      values.OptByteCount.IsUnknown()) {
+      values.OptByteCount.IsUnknown() &&
+      values.OptLatencyTarget.IsUnknown()) {
     std::string msg("Named batching config [");
     msg += name;
     msg += "] must not have a setting of [disable] for all values";
@@ -330,15 +347,30 @@ void TConf::TBuilder::ProcessTopicRateElem(const DOMElement &topic_rate_elem) {
     const DOMElement &elem = *item;
     std::string name = TAttrReader::GetString(elem, "name",
         TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY);
-    TOpt<size_t> opt_max_count = TAttrReader::GetOptInt2<size_t>(elem,
-        "maxCount", "unlimited",
-        TOpts::REQUIRE_PRESENCE | TOpts::STRICT_EMPTY_VALUE | TOpts::ALLOW_K);
-
-    if (opt_max_count.IsKnown()) {
-      TopicRateConfBuilder.AddBoundedNamedConfig(name,
-          TAttrReader::GetInt<size_t>(elem, "interval"), *opt_max_count);
+    TOpt<size_t> opt_msg_rate = TAttrReader::GetOptInt<size_t>(elem,
+        "msgRate", TOpts::ALLOW_K | TOpts::ALLOW_M);
+    TOpt<size_t> opt_byte_rate = TAttrReader::GetOptInt<size_t>(elem,
+        "byteRate", TOpts::ALLOW_K | TOpts::ALLOW_M);
+
+    if (opt_msg_rate.IsKnown() || opt_byte_rate.IsKnown()) {
+      /* Token bucket mode: "interval" and "maxCount" are not used. */
+      TopicRateConfBuilder.AddTokenBucketNamedConfig(name, opt_msg_rate,
+          TAttrReader::GetOptInt<size_t>(elem, "msgBurst",
+              TOpts::ALLOW_K | TOpts::ALLOW_M),
+          opt_byte_rate,
+          TAttrReader::GetOptInt<size_t>(elem, "byteBurst",
+              TOpts::ALLOW_K | TOpts::ALLOW_M));
     } else {
-      TopicRateConfBuilder.AddUnlimitedNamedConfig(name);
+      TOpt<size_t> opt_max_count = TAttrReader::GetOptInt2<size_t>(elem,
+          "maxCount", "unlimited", TOpts::REQUIRE_PRESENCE |
+              TOpts::STRICT_EMPTY_VALUE | TOpts::ALLOW_K);
+
+      if (opt_max_count.IsKnown()) {
+        TopicRateConfBuilder.AddBoundedNamedConfig(name,
+            TAttrReader::GetInt<size_t>(elem, "interval"), *opt_max_count);
+      } else {
+        TopicRateConfBuilder.AddUnlimitedNamedConfig(name);
+      }
     }
   }
 
@@ -367,6 +399,155 @@ void TConf::TBuilder::ProcessTopicRateElem(const DOMElement &topic_rate_elem) {
   BuildResult.TopicRateConf = TopicRateConfBuilder.Build();
 }
 
+void TConf::TBuilder::ProcessTopicQuotaElem(
+    const DOMElement &topic_quota_elem) {
+  assert(this);
+  auto subsection_map = GetSubsectionElements(topic_quota_elem,
+      {
+        {"burst", false}, {"namedConfigs", true}, {"defaultTopic", true},
+        {"topicConfigs", false}
+      }, false);
+
+  if (subsection_map.count("burst")) {
+    const DOMElement &elem = *subsection_map["burst"];
+    RequireLeaf(elem);
+    TopicQuotaConfBuilder.SetBurstBytes(TAttrReader::GetInt<size_t>(elem,
+        "maxBytes", TOpts::ALLOW_K | TOpts::ALLOW_M));
+  }
+
+  const DOMElement &named_configs_elem = *subsection_map["namedConfigs"];
+  RequireAllChildElementLeaves(named_configs_elem);
+  auto item_vec = GetItemListElements(named_configs_elem, "config");
+
+  for (const auto &item : item_vec) {
+    const DOMElement &elem = *item;
+    std::string name = TAttrReader::GetString(elem, "name",
+        TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY);
+    TOpt<size_t> opt_max_bytes = TAttrReader::GetOptInt2<size_t>(elem,
+        "maxBytes", "unlimited",
+        TOpts::REQUIRE_PRESENCE | TOpts::STRICT_EMPTY_VALUE | TOpts::ALLOW_K |
+            TOpts::ALLOW_M);
+
+    if (opt_max_bytes.IsKnown()) {
+      TopicQuotaConfBuilder.AddBoundedNamedConfig(name, *opt_max_bytes);
+    } else {
+      TopicQuotaConfBuilder.AddUnlimitedNamedConfig(name);
+    }
+  }
+
+  {
+    const DOMElement &elem = *subsection_map["defaultTopic"];
+    RequireLeaf(elem);
+    TopicQuotaConfBuilder.SetDefaultTopicConfig(TAttrReader::GetString(
+        elem, "config", TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY));
+  }
+
+  if (subsection_map.count("topicConfigs")) {
+    const DOMElement &elem = *subsection_map["topicConfigs"];
+    RequireAllChildElementLeaves(elem);
+    auto topic_item_vec = GetItemListElements(elem, "topic");
+
+    for (const auto &item : topic_item_vec) {
+      const DOMElement &topic_elem = *item;
+      std::string name = TAttrReader::GetString(topic_elem, "name",
+          TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY);
+      TopicQuotaConfBuilder.SetTopicConfig(name,
+          TAttrReader::GetString(topic_elem, "config",
+              TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY));
+    }
+  }
+
+  BuildResult.TopicQuotaConf = TopicQuotaConfBuilder.Build();
+}
+
+void TConf::TBuilder::ProcessTopicPriorityElem(
+    const DOMElement &topic_priority_elem) {
+  assert(this);
+  auto subsection_map = GetSubsectionElements(topic_priority_elem,
+      {{"lowPriorityLimit", false}, {"highPriorityTopics", true}}, false);
+
+  if (subsection_map.count("lowPriorityLimit")) {
+    const DOMElement &elem = *subsection_map["lowPriorityLimit"];
+    RequireLeaf(elem);
+    TopicPriorityConfBuilder.SetLowPriorityMaxBytes(
+        TAttrReader::GetInt<size_t>(elem, "maxBytes",
+            TOpts::ALLOW_K | TOpts::ALLOW_M));
+  }
+
+  const DOMElement &topics_elem = *subsection_map["highPriorityTopics"];
+  RequireAllChildElementLeaves(topics_elem);
+  auto item_vec = GetItemListElements(topics_elem, "topic");
+
+  for (const auto &item : item_vec) {
+    TopicPriorityConfBuilder.AddHighPriorityTopic(TAttrReader::GetString(
+        *item, "name", TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY));
+  }
+
+  BuildResult.TopicPriorityConf = TopicPriorityConfBuilder.Build();
+}
+
+void TConf::TBuilder::ProcessTopicMaxAgeElem(const DOMElement &max_age_elem) {
+  assert(this);
+  auto subsection_map = GetSubsectionElements(max_age_elem,
+      {{"defaultTopic", false}, {"topicConfigs", false}}, false);
+
+  if (subsection_map.count("defaultTopic")) {
+    const DOMElement &elem = *subsection_map["defaultTopic"];
+    RequireLeaf(elem);
+    TopicMaxAgeConfBuilder.SetDefaultTopicMaxAge(
+        TAttrReader::GetOptInt2<size_t>(elem, "maxAge", "unlimited",
+            TOpts::REQUIRE_PRESENCE | TOpts::STRICT_EMPTY_VALUE |
+                TOpts::ALLOW_K));
+  }
+
+  if (subsection_map.count("topicConfigs")) {
+    const DOMElement &elem = *subsection_map["topicConfigs"];
+    RequireAllChildElementLeaves(elem);
+    auto item_vec = GetItemListElements(elem, "topic");
+
+    for (const auto &item : item_vec) {
+      const DOMElement &topic_elem = *item;
+      TopicMaxAgeConfBuilder.SetTopicMaxAge(
+          TAttrReader::GetString(topic_elem, "name",
+              TOpts::TRIM_WHITESPACE | TOpts::THROW_IF_EMPTY),
+          TAttrReader::GetOptInt2<size_t>(topic_elem, "maxAge", "unlimited",
+              TOpts::REQUIRE_PRESENCE | TOpts::STRICT_EMPTY_VALUE |
+                  TOpts::ALLOW_K));
+    }
+  }
+
+  BuildResult.TopicMaxAgeConf = TopicMaxAgeConfBuilder.Build();
+}
+
+void TConf::TBuilder::ProcessBrokerConnectionsElem(
+    const DOMElement &broker_connections_elem) {
+  assert(this);
+  auto subsection_map = GetSubsectionElements(broker_connections_elem,
+      {{"defaultBroker", false}, {"brokerConfigs", false}}, false);
+
+  if (subsection_map.count("defaultBroker")) {
+    const DOMElement &elem = *subsection_map["defaultBroker"];
+    RequireLeaf(elem);
+    BrokerConnectionsConfBuilder.SetDefaultCount(
+        TAttrReader::GetInt<size_t>(elem, "count"));
+  }
+
+  if (subsection_map.count("brokerConfigs")) {
+    const DOMElement &elem = *subsection_map["brokerConfigs"];
+    RequireAllChildElementLeaves(elem);
+    auto item_vec = GetItemListElements(elem, "broker");
+
+    for (const auto &item : item_vec) {
+      const DOMElement &broker_elem = *item;
+      BrokerConnectionsConfBuilder.SetBrokerCount(
+          TAttrReader::GetInt<int32_t>(broker_elem, "id"),
+          TAttrReader::GetInt<size_t>(broker_elem, "count"));
+    }
+  }
+
+  BuildResult.BrokerConnectionsConf = BrokerConnectionsConfBuilder.Build();
+}
+
 void TConf::TBuilder::ProcessInitialBrokersElem(
     const DOMElement &initial_brokers_elem) {
   assert(this);
@@ -396,7 +577,9 @@ void TConf::TBuilder::ProcessRootElem(const DOMElement &root_elem) {
   auto subsection_map = GetSubsectionElements(root_elem,
       {
         {"batching", true}, {"compression", true},
-        {"topicRateLimiting", false}, {"initialBrokers", true}
+        {"topicRateLimiting", false}, {"topicBufferQuotas", false},
+        {"topicPriority", false}, {"messageMaxAge", false},
+        {"brokerConnections", false}, {"initialBrokers", true}
       },
       false);
 
@@ -413,5 +596,33 @@ void TConf::TBuilder::ProcessRootElem(const DOMElement &root_elem) {
     BuildResult.TopicRateConf = TopicRateConfBuilder.Build();
   }
 
+  if (subsection_map.count("topicBufferQuotas")) {
+    ProcessTopicQuotaElem(*subsection_map["topicBufferQuotas"]);
+  } else {
+    /* The config file has no <topicBufferQuotas> element, so create a default
+       config that imposes no quota on any topic. */
+    TopicQuotaConfBuilder.AddUnlimitedNamedConfig("unlimited");
+    TopicQuotaConfBuilder.SetDefaultTopicConfig("unlimited");
+    BuildResult.TopicQuotaConf = TopicQuotaConfBuilder.Build();
+  }
+
+  /* If the config file has no <topicPriority> element, all topics are low
+     priority, which is the same as having no priorities. */
+  if (subsection_map.count("topicPriority")) {
+    ProcessTopicPriorityElem(*subsection_map["topicPriority"]);
+  }
+
+  /* If the config file has no <messageMaxAge> element, messages never
+     expire. */
+  if (subsection_map.count("messageMaxAge")) {
+    ProcessTopicMaxAgeElem(*subsection_map["messageMaxAge"]);
+  }
+
+  /* If the config file has no <brokerConnections> element, we open a single
+     connection to each broker. */
+  if (subsection_map.count("brokerConnections")) {
+    ProcessBrokerConnectionsElem(*subsection_map["brokerConnections"]);
+  }
+
   ProcessInitialBrokersElem(*subsection_map["initialBrokers"]);
 }
@@ -31,7 +31,11 @@
 
 #include <base/no_copy_semantics.h>
 #include <dory/conf/batch_conf.h>
+#include <dory/conf/broker_connections_conf.h>
 #include <dory/conf/compression_conf.h>
+#include <dory/conf/topic_max_age_conf.h>
+#include <dory/conf/topic_priority_conf.h>
+#include <dory/conf/topic_quota_conf.h>
 #include <dory/conf/topic_rate_conf.h>
 #include <dory/util/host_and_port.h>
 
@@ -60,6 +64,26 @@ namespace Dory {
         return TopicRateConf;
       }
 
+      const TTopicQuotaConf &GetTopicQuotaConf() const {
+        assert(this);
+        return TopicQuotaConf;
+      }
+
+      const TTopicPriorityConf &GetTopicPriorityConf() const {
+        assert(this);
+        return TopicPriorityConf;
+      }
+
+      const TTopicMaxAgeConf &GetTopicMaxAgeConf() const {
+        assert(this);
+        return TopicMaxAgeConf;
+      }
+
+      const TBrokerConnectionsConf &GetBrokerConnectionsConf() const {
+        assert(this);
+        return BrokerConnectionsConf;
+      }
+
       const std::vector<TBroker> &GetInitialBrokers() const {
         assert(this);
         return InitialBrokers;
@@ -72,6 +96,14 @@ namespace Dory {
 
       TTopicRateConf TopicRateConf;
 
+      TTopicQuotaConf TopicQuotaConf;
+
+      TTopicPriorityConf TopicPriorityConf;
+
+      TTopicMaxAgeConf TopicMaxAgeConf;
+
+      TBrokerConnectionsConf BrokerConnectionsConf;
+
       std::vector<TBroker> InitialBrokers;
     };  // TConf
 
@@ -107,6 +139,17 @@ namespace Dory {
 
       void ProcessTopicRateElem(const xercesc::DOMElement &topic_rate_elem);
 
+      void ProcessTopicQuotaElem(
+          const xercesc::DOMElement &topic_quota_elem);
+
+      void ProcessTopicPriorityElem(
+          const xercesc::DOMElement &topic_priority_elem);
+
+      void ProcessTopicMaxAgeElem(const xercesc::DOMElement &max_age_elem);
+
+      void ProcessBrokerConnectionsElem(
+          const xercesc::DOMElement &broker_connections_elem);
+
       void ProcessInitialBrokersElem(
           const xercesc::DOMElement &initial_brokers_elem);
 
@@ -123,6 +166,14 @@ namespace Dory {
       TCompressionConf::TBuilder CompressionConfBuilder;
 
       TTopicRateConf::TBuilder TopicRateConfBuilder;
+
+      TTopicQuotaConf::TBuilder TopicQuotaConfBuilder;
+
+      TTopicPriorityConf::TBuilder TopicPriorityConfBuilder;
+
+      TTopicMaxAgeConf::TBuilder TopicMaxAgeConfBuilder;
+
+      TBrokerConnectionsConf::TBuilder BrokerConnectionsConfBuilder;
     };  // TConf::TBuilder
 
   }  // Conf
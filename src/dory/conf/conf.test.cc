@@ -74,6 +74,7 @@ namespace {
         << "                <time value=\"5\" />" << std::endl
         << "                <messages value=\"disable\" />" << std::endl
         << "                <bytes value=\"20k\" />" << std::endl
+        << "                <latencyTarget value=\"25\" />" << std::endl
         << "            </config>" << std::endl
         << "        </namedConfigs>" << std::endl
         << std::endl
@@ -138,6 +139,8 @@ namespace {
         << "maxCount=\"500\" />" << std::endl
         << "            <config name=\"config2\" interval=\"20000\" "
         << "maxCount=\"4k\" />" << std::endl
+        << "            <config name=\"bucket\" msgRate=\"200\" "
+        << "msgBurst=\"1k\" byteRate=\"1m\" />" << std::endl
         << "        </namedConfigs>" << std::endl
         << "" << std::endl
         << "        <defaultTopic config=\"config1\" />" << std::endl
@@ -148,9 +151,57 @@ namespace {
         << std::endl
         << "            <topic name=\"topic3\" config=\"config2\" />"
         << std::endl
+        << "            <topic name=\"topic4\" config=\"bucket\" />"
+        << std::endl
         << "        </topicConfigs>" << std::endl
         << "    </topicRateLimiting>" << std::endl
         << std::endl
+        << "    <topicBufferQuotas>" << std::endl
+        << "        <burst maxBytes=\"2m\" />" << std::endl
+        << "        <namedConfigs>" << std::endl
+        << "            <config name=\"small\" maxBytes=\"64k\" />"
+        << std::endl
+        << "            <config name=\"infinity\" maxBytes=\"unlimited\" />"
+        << std::endl
+        << "            <config name=\"large\" maxBytes=\"10m\" />"
+        << std::endl
+        << "        </namedConfigs>" << std::endl
+        << "" << std::endl
+        << "        <defaultTopic config=\"large\" />" << std::endl
+        << "" << std::endl
+        << "        <topicConfigs>" << std::endl
+        << "            <topic name=\"topic1\" config=\"small\" />"
+        << std::endl
+        << "            <topic name=\"topic2\" config=\"infinity\" />"
+        << std::endl
+        << "        </topicConfigs>" << std::endl
+        << "    </topicBufferQuotas>" << std::endl
+        << std::endl
+        << "    <topicPriority>" << std::endl
+        << "        <lowPriorityLimit maxBytes=\"8m\" />" << std::endl
+        << "        <highPriorityTopics>" << std::endl
+        << "            <topic name=\"billing\" />" << std::endl
+        << "            <topic name=\"alerts\" />" << std::endl
+        << "        </highPriorityTopics>" << std::endl
+        << "    </topicPriority>" << std::endl
+        << std::endl
+        << "    <messageMaxAge>" << std::endl
+        << "        <defaultTopic maxAge=\"unlimited\" />" << std::endl
+        << "        <topicConfigs>" << std::endl
+        << "            <topic name=\"analytics\" maxAge=\"60000\" />"
+        << std::endl
+        << "            <topic name=\"metrics\" maxAge=\"5k\" />"
+        << std::endl
+        << "        </topicConfigs>" << std::endl
+        << "    </messageMaxAge>" << std::endl
+        << std::endl
+        << "    <brokerConnections>" << std::endl
+        << "        <defaultBroker count=\"2\" />" << std::endl
+        << "        <brokerConfigs>" << std::endl
+        << "            <broker id=\"5\" count=\"4\" />" << std::endl
+        << "        </brokerConfigs>" << std::endl
+        << "    </brokerConnections>" << std::endl
+        << std::endl
         << "    <initialBrokers>" << std::endl
         << "        <broker host=\"host1\" port=\"9092\" />" << std::endl
         << "        <broker host=\"host2\" port=\"9093\" />" << std::endl
@@ -172,6 +223,7 @@ namespace {
     ASSERT_EQ(*values.OptMsgCount, 100U);
     ASSERT_TRUE(values.OptByteCount.IsKnown());
     ASSERT_EQ(*values.OptByteCount, 200U);
+    ASSERT_FALSE(values.OptLatencyTarget.IsKnown());
     ASSERT_TRUE(batch_conf.GetDefaultTopicAction() ==
         TBatchConf::TTopicAction::PerTopic);
     values = batch_conf.GetDefaultTopicConfig();
@@ -180,6 +232,8 @@ namespace {
     ASSERT_FALSE(values.OptMsgCount.IsKnown());
     ASSERT_TRUE(values.OptByteCount.IsKnown());
     ASSERT_EQ(*values.OptByteCount, 20U * 1024U);
+    ASSERT_TRUE(values.OptLatencyTarget.IsKnown());
+    ASSERT_EQ(*values.OptLatencyTarget, 25U);
 
     const TBatchConf::TTopicMap &topic_map = batch_conf.GetTopicConfigs();
     ASSERT_EQ(topic_map.size(), 2U);
@@ -266,7 +320,7 @@ namespace {
     ASSERT_EQ(*default_topic_rate_conf.MaxCount, 500U);
     const TTopicRateConf::TTopicMap &topic_rate_configs =
         topic_rate_conf.GetTopicConfigs();
-    ASSERT_EQ(topic_rate_configs.size(), 3U);
+    ASSERT_EQ(topic_rate_configs.size(), 4U);
     TTopicRateConf::TTopicMap::const_iterator rate_topic_iter =
         topic_rate_configs.find("topic1");
     ASSERT_TRUE(rate_topic_iter != topic_rate_configs.end());
@@ -282,6 +336,61 @@ namespace {
     ASSERT_EQ(rate_topic_iter->second.Interval, 20000U);
     ASSERT_TRUE(rate_topic_iter->second.MaxCount.IsKnown());
     ASSERT_EQ(*rate_topic_iter->second.MaxCount, 4096U);
+    ASSERT_FALSE(rate_topic_iter->second.IsTokenBucket());
+    rate_topic_iter = topic_rate_configs.find("topic4");
+    ASSERT_TRUE(rate_topic_iter != topic_rate_configs.end());
+    ASSERT_TRUE(rate_topic_iter->second.IsTokenBucket());
+    ASSERT_TRUE(rate_topic_iter->second.MaxCount.IsUnknown());
+    ASSERT_EQ(*rate_topic_iter->second.MsgRate, 200U);
+    ASSERT_EQ(*rate_topic_iter->second.MsgBurst, 1024U);
+    ASSERT_EQ(*rate_topic_iter->second.ByteRate, 1024U * 1024U);
+    ASSERT_EQ(*rate_topic_iter->second.ByteBurst, 1024U * 1024U);
+
+    const TTopicQuotaConf &topic_quota_conf = conf.GetTopicQuotaConf();
+    ASSERT_TRUE(topic_quota_conf.IsEnabled());
+    ASSERT_EQ(topic_quota_conf.GetBurstBytes(), 2U * 1024U * 1024U);
+    ASSERT_TRUE(topic_quota_conf.GetDefaultTopicConfig().MaxBytes.IsKnown());
+    ASSERT_EQ(*topic_quota_conf.GetDefaultTopicConfig().MaxBytes,
+        10U * 1024U * 1024U);
+    const TTopicQuotaConf::TTopicMap &topic_quota_configs =
+        topic_quota_conf.GetTopicConfigs();
+    ASSERT_EQ(topic_quota_configs.size(), 2U);
+    auto quota_topic_iter = topic_quota_configs.find("topic1");
+    ASSERT_TRUE(quota_topic_iter != topic_quota_configs.end());
+    ASSERT_TRUE(quota_topic_iter->second.MaxBytes.IsKnown());
+    ASSERT_EQ(*quota_topic_iter->second.MaxBytes, 64U * 1024U);
+    quota_topic_iter = topic_quota_configs.find("topic2");
+    ASSERT_TRUE(quota_topic_iter != topic_quota_configs.end());
+    ASSERT_TRUE(quota_topic_iter->second.MaxBytes.IsUnknown());
+
+    const TTopicPriorityConf &topic_priority_conf =
+        conf.GetTopicPriorityConf();
+    ASSERT_TRUE(topic_priority_conf.IsEnabled());
+    ASSERT_EQ(topic_priority_conf.GetHighPriorityTopics().size(), 2U);
+    ASSERT_TRUE(topic_priority_conf.IsHighPriority("billing"));
+    ASSERT_TRUE(topic_priority_conf.IsHighPriority("alerts"));
+    ASSERT_FALSE(topic_priority_conf.IsHighPriority("topic1"));
+    ASSERT_TRUE(topic_priority_conf.GetLowPriorityMaxBytes().IsKnown());
+    ASSERT_EQ(*topic_priority_conf.GetLowPriorityMaxBytes(),
+        8U * 1024U * 1024U);
+
+    const TTopicMaxAgeConf &max_age_conf = conf.GetTopicMaxAgeConf();
+    ASSERT_TRUE(max_age_conf.IsEnabled());
+    ASSERT_TRUE(max_age_conf.GetDefaultTopicMaxAge().IsUnknown());
+    ASSERT_EQ(max_age_conf.GetTopicConfigs().size(), 2U);
+    ASSERT_TRUE(max_age_conf.GetMaxAge("analytics").IsKnown());
+    ASSERT_EQ(*max_age_conf.GetMaxAge("analytics"), 60000U);
+    ASSERT_EQ(*max_age_conf.GetMaxAge("metrics"), 5U * 1024U);
+    ASSERT_TRUE(max_age_conf.GetMaxAge("topic1").IsUnknown());
+    ASSERT_EQ(max_age_conf.GetDeadline("analytics", 1000), 61000U);
+    ASSERT_EQ(max_age_conf.GetDeadline("topic1", 1000), UINT64_MAX);
+
+    const TBrokerConnectionsConf &connections_conf =
+        conf.GetBrokerConnectionsConf();
+    ASSERT_EQ(connections_conf.GetDefaultCount(), 2U);
+    ASSERT_EQ(connections_conf.GetBrokerConfigs().size(), 1U);
+    ASSERT_EQ(connections_conf.GetCount(5), 4U);
+    ASSERT_EQ(connections_conf.GetCount(6), 2U);
 
     const std::vector<TConf::TBroker> &broker_vec = conf.GetInitialBrokers();
     ASSERT_EQ(broker_vec.size(), 2U);
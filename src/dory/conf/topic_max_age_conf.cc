@@ -0,0 +1,102 @@
+/* <dory/conf/topic_max_age_conf.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+   Implements <dory/conf/topic_max_age_conf.h>.
+ */
+
+#include <dory/conf/topic_max_age_conf.h>
+
+#include <utility>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Conf;
+
+const TOpt<size_t> &TTopicMaxAgeConf::GetMaxAge(
+    const std::string &topic) const {
+  assert(this);
+  auto iter = TopicConfigs.find(topic);
+  return (iter == TopicConfigs.end()) ? DefaultTopicMaxAge : iter->second;
+}
+
+uint64_t TTopicMaxAgeConf::GetDeadline(const std::string &topic,
+    uint64_t creation_timestamp) const {
+  assert(this);
+
+  if (!Enabled) {
+    return UINT64_MAX;
+  }
+
+  const TOpt<size_t> &max_age = GetMaxAge(topic);
+  return max_age.IsKnown() ? (creation_timestamp + *max_age) : UINT64_MAX;
+}
+
+std::string TTopicMaxAgeConf::TBuilder::TDuplicateTopicConfig::CreateMsg(
+    const std::string &topic) {
+  std::string msg("Message max age config contains duplicate specification "
+                  "for topic [");
+  msg += topic;
+  msg += "]";
+  return std::move(msg);
+}
+
+void TTopicMaxAgeConf::TBuilder::Reset() {
+  assert(this);
+  BuildResult = TTopicMaxAgeConf();
+}
+
+void TTopicMaxAgeConf::TBuilder::SetDefaultTopicMaxAge(
+    const TOpt<size_t> &max_age) {
+  assert(this);
+
+  if (max_age.IsKnown() && (*max_age == 0)) {
+    throw TZeroMaxAge();
+  }
+
+  BuildResult.DefaultTopicMaxAge = max_age;
+}
+
+void TTopicMaxAgeConf::TBuilder::SetTopicMaxAge(const std::string &topic,
+    const TOpt<size_t> &max_age) {
+  assert(this);
+
+  if (max_age.IsKnown() && (*max_age == 0)) {
+    throw TZeroMaxAge();
+  }
+
+  auto result = BuildResult.TopicConfigs.insert(
+      std::make_pair(topic, max_age));
+
+  if (!result.second) {
+    throw TDuplicateTopicConfig(topic);
+  }
+}
+
+TTopicMaxAgeConf TTopicMaxAgeConf::TBuilder::Build() {
+  assert(this);
+  TTopicMaxAgeConf result = std::move(BuildResult);
+  result.Enabled = result.DefaultTopicMaxAge.IsKnown();
+
+  for (const auto &item : result.TopicConfigs) {
+    if (item.second.IsKnown()) {
+      result.Enabled = true;
+    }
+  }
+
+  Reset();
+  return std::move(result);
+}
@@ -0,0 +1,144 @@
+/* <dory/conf/topic_max_age_conf.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+   Class representing per-topic message max age configuration obtained from
+   Dory's config file.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <base/no_copy_semantics.h>
+#include <base/opt.h>
+#include <dory/conf/conf_error.h>
+
+namespace Dory {
+
+  namespace Conf {
+
+    class TTopicMaxAgeConf {
+      public:
+      class TBuilder;
+
+      /* Key is topic and value is optional max age in milliseconds.  The
+         unknown state indicates no max age for the topic, overriding the
+         default. */
+      using TTopicMap = std::unordered_map<std::string, Base::TOpt<size_t>>;
+
+      TTopicMaxAgeConf()
+          : Enabled(false) {
+      }
+
+      TTopicMaxAgeConf(const TTopicMaxAgeConf &) = default;
+
+      TTopicMaxAgeConf(TTopicMaxAgeConf &&) = default;
+
+      TTopicMaxAgeConf &operator=(const TTopicMaxAgeConf &) = default;
+
+      TTopicMaxAgeConf &operator=(TTopicMaxAgeConf &&) = default;
+
+      /* Returns the optional max age in milliseconds for topics not listed
+         in the map returned by GetTopicConfigs().  If the optional value is
+         in the unknown state then this indicates no max age. */
+      const Base::TOpt<size_t> &GetDefaultTopicMaxAge() const {
+        assert(this);
+        return DefaultTopicMaxAge;
+      }
+
+      const TTopicMap &GetTopicConfigs() const {
+        assert(this);
+        return TopicConfigs;
+      }
+
+      /* Returns the optional max age in milliseconds for 'topic'. */
+      const Base::TOpt<size_t> &GetMaxAge(const std::string &topic) const;
+
+      /* Returns the monotonic raw timestamp in milliseconds after which a
+         message for 'topic' created at 'creation_timestamp' is expired, or
+         UINT64_MAX if the topic has no max age. */
+      uint64_t GetDeadline(const std::string &topic,
+          uint64_t creation_timestamp) const;
+
+      /* Returns true if at least one topic has a max age. */
+      bool IsEnabled() const {
+        assert(this);
+        return Enabled;
+      }
+
+      private:
+      Base::TOpt<size_t> DefaultTopicMaxAge;
+
+      TTopicMap TopicConfigs;
+
+      bool Enabled;
+    };  // TTopicMaxAgeConf
+
+    class TTopicMaxAgeConf::TBuilder {
+      NO_COPY_SEMANTICS(TBuilder);
+
+      public:
+      /* Exception base class. */
+      class TErrorBase : public TConfError {
+        protected:
+        explicit TErrorBase(std::string &&msg)
+            : TConfError(std::move(msg)) {
+        }
+      };  // TErrorBase
+
+      class TDuplicateTopicConfig final : public TErrorBase {
+        public:
+        explicit TDuplicateTopicConfig(const std::string &topic)
+            : TErrorBase(CreateMsg(topic)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &topic);
+      };  // TDuplicateTopicConfig
+
+      class TZeroMaxAge final : public TErrorBase {
+        public:
+        TZeroMaxAge()
+            : TErrorBase("Message max age config contains max age of zero") {
+        }
+      };  // TZeroMaxAge
+
+      TBuilder() = default;
+
+      void Reset();
+
+      /* An unknown value for 'max_age' specifies no max age. */
+      void SetDefaultTopicMaxAge(const Base::TOpt<size_t> &max_age);
+
+      /* An unknown value for 'max_age' specifies no max age. */
+      void SetTopicMaxAge(const std::string &topic,
+          const Base::TOpt<size_t> &max_age);
+
+      TTopicMaxAgeConf Build();
+
+      private:
+      TTopicMaxAgeConf BuildResult;
+    };  // TTopicMaxAgeConf::TBuilder
+
+  }  // Conf
+
+}  // Dory
@@ -0,0 +1,68 @@
+/* <dory/conf/topic_priority_conf.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/conf/topic_priority_conf.h>.
+ */
+
+#include <dory/conf/topic_priority_conf.h>
+
+#include <utility>
+
+using namespace Dory;
+using namespace Dory::Conf;
+
+std::string TTopicPriorityConf::TBuilder::TDuplicateTopic::CreateMsg(
+    const std::string &topic) {
+  std::string msg("Topic priority config contains duplicate high priority "
+                  "topic: [");
+  msg += topic;
+  msg += "]";
+  return std::move(msg);
+}
+
+void TTopicPriorityConf::TBuilder::Reset() {
+  assert(this);
+  BuildResult = TTopicPriorityConf();
+}
+
+void TTopicPriorityConf::TBuilder::AddHighPriorityTopic(
+    const std::string &topic) {
+  assert(this);
+
+  if (!BuildResult.HighPriorityTopics.insert(topic).second) {
+    throw TDuplicateTopic(topic);
+  }
+}
+
+void TTopicPriorityConf::TBuilder::SetLowPriorityMaxBytes(size_t max_bytes) {
+  assert(this);
+  BuildResult.LowPriorityMaxBytes.MakeKnown(max_bytes);
+}
+
+TTopicPriorityConf TTopicPriorityConf::TBuilder::Build() {
+  assert(this);
+
+  if (BuildResult.LowPriorityMaxBytes.IsKnown() &&
+      BuildResult.HighPriorityTopics.empty()) {
+    throw TMissingHighPriorityTopics();
+  }
+
+  TTopicPriorityConf result = std::move(BuildResult);
+  Reset();
+  return std::move(result);
+}
@@ -0,0 +1,135 @@
+/* <dory/conf/topic_priority_conf.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class representing per-topic priority configuration obtained from Dory's
+   config file.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+#include <base/no_copy_semantics.h>
+#include <base/opt.h>
+#include <dory/conf/conf_error.h>
+
+namespace Dory {
+
+  namespace Conf {
+
+    class TTopicPriorityConf {
+      public:
+      class TBuilder;
+
+      using TTopicSet = std::unordered_set<std::string>;
+
+      TTopicPriorityConf() = default;
+
+      TTopicPriorityConf(const TTopicPriorityConf &) = default;
+
+      TTopicPriorityConf(TTopicPriorityConf &&) = default;
+
+      TTopicPriorityConf &operator=(const TTopicPriorityConf &) = default;
+
+      TTopicPriorityConf &operator=(TTopicPriorityConf &&) = default;
+
+      /* Returns the set of topics whose messages go in the high priority
+         lane.  Messages for all other topics go in the low priority lane. */
+      const TTopicSet &GetHighPriorityTopics() const {
+        assert(this);
+        return HighPriorityTopics;
+      }
+
+      bool IsHighPriority(const std::string &topic) const {
+        assert(this);
+        return (HighPriorityTopics.count(topic) != 0);
+      }
+
+      /* Returns the optional maximum # of bytes of message data that all low
+         priority topics combined may have buffered.  Once this is reached,
+         low priority messages are discarded so that the remaining buffer
+         space is left for high priority messages.  If the optional value is
+         in the unknown state then this indicates no maximum. */
+      const Base::TOpt<size_t> &GetLowPriorityMaxBytes() const {
+        assert(this);
+        return LowPriorityMaxBytes;
+      }
+
+      /* Returns true if at least one topic is high priority. */
+      bool IsEnabled() const {
+        assert(this);
+        return !HighPriorityTopics.empty();
+      }
+
+      private:
+      TTopicSet HighPriorityTopics;
+
+      Base::TOpt<size_t> LowPriorityMaxBytes;
+    };  // TTopicPriorityConf
+
+    class TTopicPriorityConf::TBuilder {
+      NO_COPY_SEMANTICS(TBuilder);
+
+      public:
+      /* Exception base class. */
+      class TErrorBase : public TConfError {
+        protected:
+        explicit TErrorBase(std::string &&msg)
+            : TConfError(std::move(msg)) {
+        }
+      };  // TErrorBase
+
+      class TDuplicateTopic final : public TErrorBase {
+        public:
+        explicit TDuplicateTopic(const std::string &topic)
+            : TErrorBase(CreateMsg(topic)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &topic);
+      };  // TDuplicateTopic
+
+      class TMissingHighPriorityTopics final : public TErrorBase {
+        public:
+        TMissingHighPriorityTopics()
+            : TErrorBase("Topic priority config specifies low priority limit "
+                         "but no high priority topics") {
+        }
+      };  // TMissingHighPriorityTopics
+
+      TBuilder() = default;
+
+      void Reset();
+
+      void AddHighPriorityTopic(const std::string &topic);
+
+      void SetLowPriorityMaxBytes(size_t max_bytes);
+
+      TTopicPriorityConf Build();
+
+      private:
+      TTopicPriorityConf BuildResult;
+    };  // TTopicPriorityConf::TBuilder
+
+  }  // Conf
+
+}  // Dory
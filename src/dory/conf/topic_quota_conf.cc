@@ -0,0 +1,161 @@
+/* <dory/conf/topic_quota_conf.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/conf/topic_quota_conf.h>.
+ */
+
+#include <dory/conf/topic_quota_conf.h>
+
+#include <utility>
+
+using namespace Dory;
+using namespace Dory::Conf;
+
+bool TTopicQuotaConf::IsEnabled() const {
+  assert(this);
+
+  if (DefaultTopicConfig.MaxBytes.IsKnown()) {
+    return true;
+  }
+
+  for (const auto &item : TopicConfigs) {
+    if (item.second.MaxBytes.IsKnown()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::string TTopicQuotaConf::TBuilder::TDuplicateNamedConfig::CreateMsg(
+    const std::string &config_name) {
+  std::string msg("Topic buffer quota config contains duplicate named "
+                  "config: [");
+  msg += config_name;
+  msg += "]";
+  return std::move(msg);
+}
+
+std::string TTopicQuotaConf::TBuilder::TUnknownDefaultTopicConfig::CreateMsg(
+    const std::string &config_name) {
+  std::string msg("Topic buffer quota config defaultTopic definition "
+                  "references unknown named config: [");
+  msg += config_name;
+  msg += "]";
+  return std::move(msg);
+}
+
+std::string TTopicQuotaConf::TBuilder::TDuplicateTopicConfig::CreateMsg(
+    const std::string &topic) {
+  std::string msg("Topic buffer quota config contains duplicate "
+                  "specification for topic [");
+  msg += topic;
+  msg += "]";
+  return std::move(msg);
+}
+
+std::string TTopicQuotaConf::TBuilder::TUnknownTopicConfig::CreateMsg(
+    const std::string &topic, const std::string &config_name) {
+  std::string msg("Topic buffer quota config for topic [");
+  msg += topic;
+  msg += "] references unknown named config: [";
+  msg += config_name;
+  msg += "]";
+  return std::move(msg);
+}
+
+void TTopicQuotaConf::TBuilder::Reset() {
+  assert(this);
+  NamedConfigs.clear();
+  BuildResult = TTopicQuotaConf();
+  GotDefaultTopic = false;
+}
+
+void TTopicQuotaConf::TBuilder::AddBoundedNamedConfig(const std::string &name,
+    size_t max_bytes) {
+  assert(this);
+  auto result = NamedConfigs.insert(std::make_pair(name, TConf(max_bytes)));
+
+  if (!result.second) {
+    throw TDuplicateNamedConfig(name);
+  }
+}
+
+void TTopicQuotaConf::TBuilder::AddUnlimitedNamedConfig(
+    const std::string &name) {
+  assert(this);
+  auto result = NamedConfigs.insert(std::make_pair(name, TConf()));
+
+  if (!result.second) {
+    throw TDuplicateNamedConfig(name);
+  }
+}
+
+void TTopicQuotaConf::TBuilder::SetDefaultTopicConfig(
+    const std::string &config_name) {
+  assert(this);
+
+  if (GotDefaultTopic) {
+    throw TDuplicateDefaultTopicConfig();
+  }
+
+  auto iter = NamedConfigs.find(config_name);
+
+  if (iter == NamedConfigs.end()) {
+    throw TUnknownDefaultTopicConfig(config_name);
+  }
+
+  BuildResult.DefaultTopicConfig = iter->second;
+  GotDefaultTopic = true;
+}
+
+void TTopicQuotaConf::TBuilder::SetTopicConfig(const std::string &topic,
+    const std::string &config_name) {
+  assert(this);
+
+  if (BuildResult.TopicConfigs.find(topic) != BuildResult.TopicConfigs.end()) {
+    throw TDuplicateTopicConfig(topic);
+  }
+
+  auto iter = NamedConfigs.find(config_name);
+
+  if (iter == NamedConfigs.end()) {
+    throw TUnknownTopicConfig(topic, config_name);
+  }
+
+  BuildResult.TopicConfigs.insert(std::make_pair(topic, iter->second));
+}
+
+void TTopicQuotaConf::TBuilder::SetBurstBytes(size_t burst_bytes) {
+  assert(this);
+  BuildResult.BurstBytes = burst_bytes;
+}
+
+TTopicQuotaConf TTopicQuotaConf::TBuilder::Build() {
+  assert(this);
+
+  if (!GotDefaultTopic) {
+    throw TMissingDefaultTopic();
+  }
+
+  NamedConfigs.clear();
+  GotDefaultTopic = false;
+  TTopicQuotaConf result = std::move(BuildResult);
+  BuildResult = TTopicQuotaConf();
+  return std::move(result);
+}
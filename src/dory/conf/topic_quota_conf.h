@@ -0,0 +1,205 @@
+/* <dory/conf/topic_quota_conf.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class representing per-topic buffered byte quota configuration obtained
+   from Dory's config file.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <base/no_copy_semantics.h>
+#include <base/opt.h>
+#include <dory/conf/conf_error.h>
+
+namespace Dory {
+
+  namespace Conf {
+
+    class TTopicQuotaConf {
+      public:
+      class TBuilder;
+
+      struct TConf {
+        /* Optional maximum # of bytes of message data that a given topic may
+           have buffered before messages for that topic start drawing from the
+           shared burst region.  If the optional value is in the unknown state
+           then this indicates no maximum (i.e. infinite quota). */
+        Base::TOpt<size_t> MaxBytes;
+
+        /* Default constructor specifies no limit. */
+        TConf() = default;
+
+        explicit TConf(size_t max_bytes)
+            : MaxBytes(max_bytes) {
+        }
+
+        TConf(const TConf &) = default;
+
+        TConf &operator=(const TConf &) = default;
+      };  // TConf
+
+      using TTopicMap = std::unordered_map<std::string, TConf>;
+
+      TTopicQuotaConf()
+          : BurstBytes(0) {
+      }
+
+      TTopicQuotaConf(const TTopicQuotaConf &) = default;
+
+      TTopicQuotaConf(TTopicQuotaConf &&) = default;
+
+      TTopicQuotaConf &operator=(const TTopicQuotaConf &) = default;
+
+      TTopicQuotaConf &operator=(TTopicQuotaConf &&) = default;
+
+      const TConf &GetDefaultTopicConfig() const {
+        assert(this);
+        return DefaultTopicConfig;
+      }
+
+      const TTopicMap &GetTopicConfigs() const {
+        assert(this);
+        return TopicConfigs;
+      }
+
+      /* Returns the size in bytes of the region shared by all topics that
+         have reached their quotas. */
+      size_t GetBurstBytes() const {
+        assert(this);
+        return BurstBytes;
+      }
+
+      /* Returns true if at least one topic has a finite quota. */
+      bool IsEnabled() const;
+
+      private:
+      TConf DefaultTopicConfig;
+
+      TTopicMap TopicConfigs;
+
+      size_t BurstBytes;
+    };  // TTopicQuotaConf
+
+    class TTopicQuotaConf::TBuilder {
+      NO_COPY_SEMANTICS(TBuilder);
+
+      public:
+      /* Exception base class. */
+      class TErrorBase : public TConfError {
+        protected:
+        explicit TErrorBase(std::string &&msg)
+            : TConfError(std::move(msg)) {
+        }
+      };  // TErrorBase
+
+      class TDuplicateNamedConfig final : public TErrorBase {
+        public:
+        explicit TDuplicateNamedConfig(const std::string &config_name)
+            : TErrorBase(CreateMsg(config_name)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &config_name);
+      };  // TDuplicateNamedConfig
+
+      class TDuplicateDefaultTopicConfig final : public TErrorBase {
+        public:
+        TDuplicateDefaultTopicConfig()
+            : TErrorBase("Topic buffer quota config contains duplicate "
+                         "defaultTopic definition") {
+        }
+      };  // TDuplicateDefaultTopicConfig
+
+      class TUnknownDefaultTopicConfig final : public TErrorBase {
+        public:
+        explicit TUnknownDefaultTopicConfig(const std::string &config_name)
+            : TErrorBase(CreateMsg(config_name)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &config_name);
+      };  // TUnknownDefaultTopicConfig
+
+      class TDuplicateTopicConfig final : public TErrorBase {
+        public:
+        explicit TDuplicateTopicConfig(const std::string &topic)
+            : TErrorBase(CreateMsg(topic)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &topic);
+      };  // TDuplicateTopicConfig
+
+      class TUnknownTopicConfig final : public TErrorBase {
+        public:
+        TUnknownTopicConfig(const std::string &topic,
+            const std::string &config_name)
+            : TErrorBase(CreateMsg(topic, config_name)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &topic,
+            const std::string &config_name);
+      };  // TUnknownTopicConfig
+
+      class TMissingDefaultTopic final : public TErrorBase {
+        public:
+        TMissingDefaultTopic()
+            : TErrorBase("Topic buffer quota config is missing defaultTopic "
+                         "definition") {
+        }
+      };  // TMissingDefaultTopic
+
+      TBuilder()
+          : GotDefaultTopic(false) {
+      }
+
+      void Reset();
+
+      /* Add a named config with a finite byte quota. */
+      void AddBoundedNamedConfig(const std::string &name, size_t max_bytes);
+
+      /* Add a named config with an unlimited byte quota. */
+      void AddUnlimitedNamedConfig(const std::string &name);
+
+      void SetDefaultTopicConfig(const std::string &config_name);
+
+      void SetTopicConfig(const std::string &topic,
+          const std::string &config_name);
+
+      void SetBurstBytes(size_t burst_bytes);
+
+      TTopicQuotaConf Build();
+
+      private:
+      std::unordered_map<std::string, TConf> NamedConfigs;
+
+      TTopicQuotaConf BuildResult;
+
+      bool GotDefaultTopic;
+    };  // TTopicQuotaConf::TBuilder
+
+  }  // Conf
+
+}  // Dory
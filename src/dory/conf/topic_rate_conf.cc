@@ -25,6 +25,7 @@
 
 #include <dory/util/misc_util.h>
 
+using namespace Base;
 using namespace Dory;
 using namespace Dory::Conf;
 using namespace Dory::Util;
@@ -65,6 +66,24 @@ std::string TTopicRateConf::TBuilder::TZeroRateLimitInterval::CreateMsg(
   return std::move(msg);
 }
 
+std::string TTopicRateConf::TBuilder::TZeroTokenBucketSetting::CreateMsg(
+    const std::string &config_name) {
+  std::string msg("Topic rate limiting config contains token bucket rate or "
+                  "burst of zero for named config: [");
+  msg += config_name;
+  msg += "]";
+  return std::move(msg);
+}
+
+std::string TTopicRateConf::TBuilder::TBurstWithoutRate::CreateMsg(
+    const std::string &config_name) {
+  std::string msg("Topic rate limiting config specifies token bucket burst "
+                  "without corresponding rate for named config: [");
+  msg += config_name;
+  msg += "]";
+  return std::move(msg);
+}
+
 std::string TTopicRateConf::TBuilder::TUnknownTopicConfig::CreateMsg(
     const std::string &topic, const std::string &config_name) {
   std::string msg("Topic rate limiting config for topic [");
@@ -108,6 +127,44 @@ void TTopicRateConf::TBuilder::AddUnlimitedNamedConfig(
   }
 }
 
+void TTopicRateConf::TBuilder::AddTokenBucketNamedConfig(
+    const std::string &name, const TOpt<size_t> &msg_rate,
+    const TOpt<size_t> &msg_burst, const TOpt<size_t> &byte_rate,
+    const TOpt<size_t> &byte_burst) {
+  assert(this);
+  assert(msg_rate.IsKnown() || byte_rate.IsKnown());
+
+  if ((msg_burst.IsKnown() && !msg_rate.IsKnown()) ||
+      (byte_burst.IsKnown() && !byte_rate.IsKnown())) {
+    throw TBurstWithoutRate(name);
+  }
+
+  for (const TOpt<size_t> *setting :
+       {&msg_rate, &msg_burst, &byte_rate, &byte_burst}) {
+    if (setting->IsKnown() && (**setting == 0)) {
+      throw TZeroTokenBucketSetting(name);
+    }
+  }
+
+  TConf conf;
+
+  if (msg_rate.IsKnown()) {
+    conf.MsgRate = msg_rate;
+    conf.MsgBurst = msg_burst.IsKnown() ? msg_burst : msg_rate;
+  }
+
+  if (byte_rate.IsKnown()) {
+    conf.ByteRate = byte_rate;
+    conf.ByteBurst = byte_burst.IsKnown() ? byte_burst : byte_rate;
+  }
+
+  auto result = NamedConfigs.insert(std::make_pair(name, conf));
+
+  if (!result.second) {
+    throw TDuplicateNamedConfig(name);
+  }
+}
+
 void TTopicRateConf::TBuilder::SetDefaultTopicConfig(
     const std::string &config_name) {
   assert(this);
@@ -52,6 +52,22 @@ namespace Dory {
            state then this indicates no maximum (i.e. infinite limit). */
         Base::TOpt<size_t> MaxCount;
 
+        /* The remaining fields configure token bucket mode, which is used
+           instead of 'Interval' and 'MaxCount' when either rate below is
+           known.  'MsgRate' and 'ByteRate' give the sustained number of
+           messages and bytes per second allowed for a topic.  'MsgBurst' and
+           'ByteBurst' give the bucket sizes (i.e. the largest burst allowed
+           after a quiet period).  A burst is known whenever its rate is
+           known, and defaults to one second's worth of its rate.  A rate in
+           the unknown state indicates no limit of that kind. */
+        Base::TOpt<size_t> MsgRate;
+
+        Base::TOpt<size_t> MsgBurst;
+
+        Base::TOpt<size_t> ByteRate;
+
+        Base::TOpt<size_t> ByteBurst;
+
         /* Default constructor specifies no limit. */
         TConf()
             : Interval(1) {
@@ -65,6 +81,17 @@ namespace Dory {
         TConf(const TConf &) = default;
 
         TConf &operator=(const TConf &) = default;
+
+        bool IsTokenBucket() const {
+          assert(this);
+          return MsgRate.IsKnown() || ByteRate.IsKnown();
+        }
+
+        /* Return true if this config limits messages in any way. */
+        bool IsLimited() const {
+          assert(this);
+          return MaxCount.IsKnown() || IsTokenBucket();
+        }
       };  // TConf
 
       using TTopicMap = std::unordered_map<std::string, TConf>;
@@ -127,6 +154,26 @@ namespace Dory {
         static std::string CreateMsg(const std::string &config_name);
       };  // TZeroRateLimitInterval
 
+      class TZeroTokenBucketSetting final : public TErrorBase {
+        public:
+        explicit TZeroTokenBucketSetting(const std::string &config_name)
+            : TErrorBase(CreateMsg(config_name)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &config_name);
+      };  // TZeroTokenBucketSetting
+
+      class TBurstWithoutRate final : public TErrorBase {
+        public:
+        explicit TBurstWithoutRate(const std::string &config_name)
+            : TErrorBase(CreateMsg(config_name)) {
+        }
+
+        private:
+        static std::string CreateMsg(const std::string &config_name);
+      };  // TBurstWithoutRate
+
       class TDuplicateDefaultTopicConfig final : public TErrorBase {
         public:
         TDuplicateDefaultTopicConfig()
@@ -188,6 +235,15 @@ namespace Dory {
       /* Add a named config with an unlimited maximum count. */
       void AddUnlimitedNamedConfig(const std::string &name);
 
+      /* Add a named config that uses token bucket mode.  At least one of
+         'msg_rate' and 'byte_rate' must be known, and a burst may only be
+         given along with its rate.  Rates and bursts must be > 0. */
+      void AddTokenBucketNamedConfig(const std::string &name,
+          const Base::TOpt<size_t> &msg_rate,
+          const Base::TOpt<size_t> &msg_burst,
+          const Base::TOpt<size_t> &byte_rate,
+          const Base::TOpt<size_t> &byte_burst);
+
       void SetDefaultTopicConfig(const std::string &config_name);
 
       void SetTopicConfig(const std::string &topic,
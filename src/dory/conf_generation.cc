@@ -0,0 +1,69 @@
+/* <dory/conf_generation.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/conf_generation.h>.
+ */
+
+#include <dory/conf_generation.h>
+
+#include <cassert>
+
+#include <base/time_util.h>
+
+using namespace Base;
+using namespace Dory;
+
+TConfGeneration::TConfGeneration() {
+  Info.InUse = 1;
+  Info.InUseSince = GetEpochMilliseconds();
+  Info.Loaded = 1;
+}
+
+size_t TConfGeneration::RecordLoaded() {
+  assert(this);
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  return ++Info.Loaded;
+}
+
+void TConfGeneration::RecordFailure(const std::string &error) {
+  assert(this);
+  uint64_t now = GetEpochMilliseconds();
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  ++Info.FailedCount;
+  Info.LastError = error;
+  Info.LastErrorTime = now;
+}
+
+void TConfGeneration::RecordInUse(size_t generation) {
+  assert(this);
+  uint64_t now = GetEpochMilliseconds();
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  assert(generation <= Info.Loaded);
+  Info.InUse = generation;
+  Info.InUseSince = now;
+}
+
+TConfGeneration::TInfo TConfGeneration::GetInfo() const {
+  assert(this);
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  return Info;
+}
@@ -0,0 +1,96 @@
+/* <dory/conf_generation.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for tracking which generation of the config file is in use.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  /* Keeps track of which generation of the config file dory is using.  The
+     config file loaded at startup is generation 1, and each successful reload
+     gets the next generation number.  This info is reported by Mongoose, so
+     thread synchronization is necessary. */
+  class TConfGeneration final {
+    NO_COPY_SEMANTICS(TConfGeneration);
+
+    public:
+    struct TInfo {
+      /* Generation in use by the router thread and dispatcher. */
+      size_t InUse;
+
+      /* When 'InUse' took effect, in milliseconds since the epoch. */
+      uint64_t InUseSince;
+
+      /* Most recent generation that was loaded and validated.  If this is
+         greater than 'InUse', the router thread has not yet swapped it in. */
+      size_t Loaded;
+
+      /* Number of reload attempts that failed because the config file was
+         invalid. */
+      size_t FailedCount;
+
+      /* Error message for the most recent failed reload, or empty if there
+         has been none. */
+      std::string LastError;
+
+      /* When the most recent failed reload happened, in milliseconds since
+         the epoch. */
+      uint64_t LastErrorTime;
+
+      TInfo()
+          : InUse(0),
+            InUseSince(0),
+            Loaded(0),
+            FailedCount(0),
+            LastErrorTime(0) {
+      }
+    };  // TInfo
+
+    /* Starts with generation 1 in use. */
+    TConfGeneration();
+
+    /* Called by main thread after it has loaded and validated a new config
+       file.  Returns the new config's generation number. */
+    size_t RecordLoaded();
+
+    /* Called by main thread when a reload fails. */
+    void RecordFailure(const std::string &error);
+
+    /* Called by router thread when it has swapped in 'generation'. */
+    void RecordInUse(size_t generation);
+
+    TInfo GetInfo() const;
+
+    private:
+    /* Protects 'Info' from concurrent access by Mongoose, the main thread, and
+       the router thread. */
+    mutable std::mutex Mutex;
+
+    TInfo Info;
+  };  // TConfGeneration
+
+}  // Dory
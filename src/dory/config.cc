@@ -138,6 +138,13 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
         "msg_buffer_max", "Maximum amount of memory in Kb to use for "
         "buffering messages.", true, config.MsgBufferMax, "MAX_KB");
     cmd.add(arg_msg_buffer_max);
+    SwitchArg arg_pool_size_classes("", "pool_size_classes", "Store message "
+        "data in power-of-two sized chunks from 64 bytes to 64 Kb rather "
+        "than fixed size blocks.", cmd, config.PoolSizeClasses);
+    SwitchArg arg_pool_thread_cache("", "pool_thread_cache", "Give each "
+        "thread that allocates or frees message data its own cache of free "
+        "blocks, to reduce contention on the buffer pool lock.", cmd,
+        config.PoolThreadCache);
     ValueArg<decltype(config.MaxInputMsgSize)> arg_max_input_msg_size("",
         "max_input_msg_size", "Maximum input message size in bytes expected "
         "from clients sending UNIX domain datagrams.  This limit does NOT "
@@ -179,6 +186,11 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
         "required_acks", "Required ACKs value to send in produce requests.",
         false, config.RequiredAcks, "REQUIRED_ACKS");
     cmd.add(arg_required_acks);
+    SwitchArg arg_idempotent_producer("", "idempotent_producer", "Get a "
+        "producer ID from Kafka and assign sequence numbers to messages so "
+        "brokers discard duplicates caused by resending.  Requires produce "
+        "API version 3 and a required ACKs value of -1.", cmd,
+        config.IdempotentProducer);
     ValueArg<decltype(config.ReplicationTimeout)> arg_replication_timeout("",
         "replication_timeout", "Replication timeout value in millisceonds to "
         "send in produce requests.", false, config.ReplicationTimeout,
@@ -201,6 +213,18 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
         "periodic metadata updates", false, config.MetadataRefreshInterval,
         "INTERVAL_MINUTES");
     cmd.add(arg_metadata_refresh_interval);
+    SwitchArg arg_partial_metadata_refresh("", "partial_metadata_refresh",
+        "Request metadata only for topics that Dory has sent messages to, "
+        "and keep cached metadata for other topics.  Metadata for all topics "
+        "is still requested at the interval given by "
+        "--full_metadata_refresh_interval.", cmd,
+        config.PartialMetadataRefresh);
+    ValueArg<decltype(config.FullMetadataRefreshInterval)>
+        arg_full_metadata_refresh_interval("",
+        "full_metadata_refresh_interval", "Minimum interval in minutes between requests for metadata for all "
+        "topics when --partial_metadata_refresh is specified.", false,
+        config.FullMetadataRefreshInterval, "MINUTES");
+    cmd.add(arg_full_metadata_refresh_interval);
     ValueArg<decltype(config.KafkaSocketTimeout)> arg_kafka_socket_timeout("",
         "kafka_socket_timeout", "Socket timeout in seconds to use when "
         "communicating with Kafka broker.", false, config.KafkaSocketTimeout,
@@ -249,6 +273,13 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
         "even if it is unchanged.  This should be disabled for normal "
         "operation, but enabling it may be useful for testing.", cmd,
         config.SkipCompareMetadataOnRefresh);
+    ValueArg<decltype(config.MetadataSnapshotPath)>
+        arg_metadata_snapshot_path("", "metadata_snapshot_path", "Absolute "
+        "pathname of local file where the last good metadata will be saved.  "
+        "On startup, Dory routes messages using the saved metadata while it "
+        "fetches fresh metadata in the background.  If unspecified, metadata "
+        "is not saved.", false, config.MetadataSnapshotPath, "PATH");
+    cmd.add(arg_metadata_snapshot_path);
     ValueArg<decltype(config.DiscardLogPath)> arg_discard_log_path("",
         "discard_log_path", "Absolute pathname of local file where discards "
         "will be logged.  This is intended for debugging.  If unspecified, "
@@ -287,9 +318,93 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
         "size in bytes to write to discard report", false,
         config.DiscardReportBadMsgPrefixSize, "MAX_BYTES");
     cmd.add(arg_discard_report_bad_msg_prefix_size);
+    ValueArg<decltype(config.SpoolDir)> arg_spool_dir("", "spool_dir",
+        "Absolute pathname of local directory (preferably on an SSD) where "
+        "messages are spooled when the buffer space limit given by "
+        "msg_buffer_max is reached.  Spooled messages are fed back to Kafka "
+        "in the order they were received as buffer space becomes available.  "
+        "If unspecified, messages are discarded when buffer space runs out.",
+        false, config.SpoolDir, "DIR");
+    cmd.add(arg_spool_dir);
+    ValueArg<decltype(config.SpoolMaxSize)> arg_spool_max_size("",
+        "spool_max_size", "Maximum amount of disk space in Kb to use for "
+        "spooling messages.  Only meaningful when spool_dir is specified.",
+        false, config.SpoolMaxSize, "MAX_KB");
+    cmd.add(arg_spool_max_size);
+    ValueArg<decltype(config.SpoolSegmentSize)> arg_spool_segment_size("",
+        "spool_segment_size", "Size in Kb of each memory-mapped spool "
+        "segment file.  Only meaningful when spool_dir is specified.", false,
+        config.SpoolSegmentSize, "SIZE_KB");
+    cmd.add(arg_spool_segment_size);
+    ValueArg<decltype(config.JournalDir)> arg_journal_dir("", "journal_dir",
+        "Absolute pathname of local directory where a journal of messages "
+        "received is written.  On startup, messages left undelivered by a "
+        "previous run (for instance due to a crash) are recovered from the "
+        "journal and sent before any new input, and tracked as possible "
+        "duplicates.  If unspecified, journaling is disabled.", false,
+        config.JournalDir, "DIR");
+    cmd.add(arg_journal_dir);
+    ValueArg<decltype(config.JournalSegmentSize)> arg_journal_segment_size(
+        "", "journal_segment_size", "Size in Kb at which a new journal "
+        "segment file is started.  Only meaningful when journal_dir is "
+        "specified.", false, config.JournalSegmentSize, "SIZE_KB");
+    cmd.add(arg_journal_segment_size);
+    ValueArg<decltype(config.JournalMaxSize)> arg_journal_max_size("",
+        "journal_max_size", "Size in Kb of journal segment files above which "
+        "the oldest segment is compacted by copying its unprocessed messages "
+        "forward, so it can be deleted.  0 means no limit.  Only meaningful "
+        "when journal_dir is specified.", false, config.JournalMaxSize,
+        "MAX_KB");
+    cmd.add(arg_journal_max_size);
+    ValueArg<decltype(config.JournalFlushInterval)>
+        arg_journal_flush_interval("", "journal_flush_interval",
+        "Interval in milliseconds at which buffered journal records are "
+        "written to disk.  Messages received within this interval before a "
+        "crash may be lost.  Only meaningful when journal_dir is specified.",
+        false, config.JournalFlushInterval, "MILLISECONDS");
+    cmd.add(arg_journal_flush_interval);
+    ValueArg<decltype(config.HandoffSocket)> arg_handoff_socket("",
+        "handoff_socket", "Pathname of UNIX domain stream control socket for "
+        "upgrading dory without interrupting input.  On startup, if another "
+        "dory process is listening on this socket, the new process takes "
+        "over its input sockets, and the old process stops reading input and "
+        "exits once it has delivered the messages it buffered.  Otherwise the "
+        "new process creates its input sockets as usual.  Either way, the new "
+        "process then listens on this socket for its own successor.  If "
+        "unspecified, handoff is disabled.", false, config.HandoffSocket,
+        "PATH");
+    cmd.add(arg_handoff_socket);
+    ValueArg<decltype(config.ShmSocketName)> arg_shm_socket_name("",
+        "shm_socket_name", "Pathname of UNIX domain stream control socket "
+        "for clients that send messages through shared memory rings.  Each "
+        "client that connects gets its own ring.  If unspecified, shared "
+        "memory input is disabled.", false, config.ShmSocketName, "PATH");
+    cmd.add(arg_shm_socket_name);
+    ValueArg<std::string> arg_shm_socket_mode("", "shm_socket_mode",
+        "File permission bits for shared memory control socket.  If "
+        "unspecified, the umask determines the permission bits.  To specify "
+        "an octal value, you must use a 0 prefix.", false, "", "MODE");
+    cmd.add(arg_shm_socket_mode);
+    ValueArg<decltype(config.ShmRingSize)> arg_shm_ring_size("",
+        "shm_ring_size", "Size in Kb of the data area of each shared memory "
+        "ring.  Must be a power of 2.  A message sent through a ring can't "
+        "be larger than this.", false, config.ShmRingSize, "SIZE_KB");
+    cmd.add(arg_shm_ring_size);
+    ValueArg<decltype(config.ShmMaxRings)> arg_shm_max_rings("",
+        "shm_max_rings", "Maximum number of shared memory rings in use at "
+        "once.  Clients that connect once the limit is reached are "
+        "refused.", false, config.ShmMaxRings, "MAX_RINGS");
+    cmd.add(arg_shm_max_rings);
     SwitchArg arg_topic_autocreate("", "topic_autocreate", "Enable support "
         "for automatic topic creation.  The Kafka brokers must also be "
         "configured to support this.", cmd, config.TopicAutocreate);
+    ValueArg<decltype(config.CompressionProbeInterval)>
+        arg_compression_probe_interval("", "compression_probe_interval",
+        "When a topic's recent message sets have compressed too poorly to be "
+        "sent compressed, attempt compression on only one out of every N of "
+        "its message sets until one compresses well.  0 means always attempt "
+        "compression.", false, config.CompressionProbeInterval, "N");
+    cmd.add(arg_compression_probe_interval);
     cmd.parse(argc, &arg_vec[0]);
     config.ConfigPath = arg_config_path.getValue();
     config.LogLevel = StringToLogLevel(arg_log_level.getValue());
@@ -325,6 +440,8 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
     config.StatusPort = arg_status_port.getValue();
     config.StatusLoopbackOnly = arg_status_loopback_only.getValue();
     config.MsgBufferMax = arg_msg_buffer_max.getValue();
+    config.PoolSizeClasses = arg_pool_size_classes.getValue();
+    config.PoolThreadCache = arg_pool_thread_cache.getValue();
     config.MaxInputMsgSize = arg_max_input_msg_size.getValue();
     config.MaxStreamInputMsgSize = arg_max_stream_input_msg_size.getValue();
     config.AllowLargeUnixDatagrams = arg_allow_large_unix_datagrams.getValue();
@@ -341,11 +458,15 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
     }
 
     config.RequiredAcks = arg_required_acks.getValue();
+    config.IdempotentProducer = arg_idempotent_producer.getValue();
     config.ReplicationTimeout = arg_replication_timeout.getValue();
     config.ShutdownMaxDelay = arg_shutdown_max_delay.getValue();
     config.DispatcherRestartMaxDelay =
         arg_dispatcher_restart_max_delay.getValue();
     config.MetadataRefreshInterval = arg_metadata_refresh_interval.getValue();
+    config.PartialMetadataRefresh = arg_partial_metadata_refresh.getValue();
+    config.FullMetadataRefreshInterval =
+        arg_full_metadata_refresh_interval.getValue();
     config.KafkaSocketTimeout = arg_kafka_socket_timeout.getValue();
     config.PauseRateLimitInitial = arg_pause_rate_limit_initial.getValue();
     config.PauseRateLimitMaxDouble =
@@ -358,6 +479,7 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
     config.MsgDebugByteLimit = arg_msg_debug_byte_limit.getValue();
     config.SkipCompareMetadataOnRefresh =
         arg_skip_compare_metadata_on_refresh.getValue();
+    config.MetadataSnapshotPath = arg_metadata_snapshot_path.getValue();
     config.DiscardLogPath = arg_discard_log_path.getValue();
     config.DiscardLogMaxFileSize = arg_discard_log_max_file_size.getValue();
     config.DiscardLogMaxArchiveSize =
@@ -366,13 +488,39 @@ static void ParseArgs(int argc, char *argv[], TConfig &config,
         arg_discard_log_bad_msg_prefix_size.getValue();
     config.DiscardReportBadMsgPrefixSize =
         arg_discard_report_bad_msg_prefix_size.getValue();
+    config.SpoolDir = arg_spool_dir.getValue();
+    config.SpoolMaxSize = arg_spool_max_size.getValue();
+    config.SpoolSegmentSize = arg_spool_segment_size.getValue();
+    config.JournalDir = arg_journal_dir.getValue();
+    config.JournalSegmentSize = arg_journal_segment_size.getValue();
+    config.JournalMaxSize = arg_journal_max_size.getValue();
+    config.JournalFlushInterval = arg_journal_flush_interval.getValue();
+    config.HandoffSocket = arg_handoff_socket.getValue();
+    config.ShmSocketName = arg_shm_socket_name.getValue();
+    ProcessModeArg(arg_shm_socket_mode.getValue(), "shm_socket_mode",
+        config.ShmSocketMode);
+    config.ShmRingSize = arg_shm_ring_size.getValue();
+    config.ShmMaxRings = arg_shm_max_rings.getValue();
     config.TopicAutocreate = arg_topic_autocreate.getValue();
+    config.CompressionProbeInterval =
+        arg_compression_probe_interval.getValue();
 
     if (!arg_receive_socket_name.isSet() &&
-        !arg_receive_stream_socket_name.isSet() && !arg_input_port.isSet()) {
+        !arg_receive_stream_socket_name.isSet() && !arg_input_port.isSet() &&
+        !arg_shm_socket_name.isSet()) {
       throw TArgParseError("At least one of (--receive_socket_name, "
-          "--receive_stream_socket_name, --input_port) options must be "
-          "specified.");
+          "--receive_stream_socket_name, --input_port, --shm_socket_name) "
+          "options must be specified.");
+    }
+
+    if (!arg_shm_socket_name.isSet() && arg_shm_socket_mode.isSet()) {
+      throw TArgParseError("Option --shm_socket_mode is only allowed when "
+          "--shm_socket_name is specified.");
+    }
+
+    if ((config.ShmRingSize == 0) ||
+        (config.ShmRingSize & (config.ShmRingSize - 1))) {
+      throw TArgParseError("Option --shm_ring_size must be a power of 2.");
     }
 
     if (!arg_receive_socket_name.isSet()) {
@@ -407,6 +555,8 @@ TConfig::TConfig(int argc, char *argv[], bool allow_input_bind_ephemeral)
       StatusPort(9090),
       StatusLoopbackOnly(false),
       MsgBufferMax(256 * 1024),
+      PoolSizeClasses(false),
+      PoolThreadCache(false),
       MaxInputMsgSize(64 * 1024),
       MaxStreamInputMsgSize(2 * 1024 * 1024),
       AllowLargeUnixDatagrams(false),
@@ -414,10 +564,13 @@ TConfig::TConfig(int argc, char *argv[], bool allow_input_bind_ephemeral)
       Daemon(false),
       ClientIdWasEmpty(true),
       RequiredAcks(-1),
+      IdempotentProducer(false),
       ReplicationTimeout(10000),
       ShutdownMaxDelay(30000),
       DispatcherRestartMaxDelay(5000),
       MetadataRefreshInterval(15),
+      PartialMetadataRefresh(false),
+      FullMetadataRefreshInterval(240),
       KafkaSocketTimeout(60),
       PauseRateLimitInitial(5000),
       PauseRateLimitMaxDouble(4),
@@ -432,7 +585,15 @@ TConfig::TConfig(int argc, char *argv[], bool allow_input_bind_ephemeral)
       DiscardLogMaxArchiveSize(8 * 1024),
       DiscardLogBadMsgPrefixSize(256),
       DiscardReportBadMsgPrefixSize(256),
-      TopicAutocreate(false) {
+      SpoolMaxSize(1024 * 1024),
+      SpoolSegmentSize(64 * 1024),
+      JournalSegmentSize(64 * 1024),
+      JournalMaxSize(1024 * 1024),
+      JournalFlushInterval(100),
+      ShmRingSize(1024),
+      ShmMaxRings(64),
+      TopicAutocreate(false),
+      CompressionProbeInterval(32) {
   ParseArgs(argc, argv, *this, allow_input_bind_ephemeral);
 }
 
@@ -512,6 +673,10 @@ void Dory::LogConfig(const TConfig &config) {
          config.StatusLoopbackOnly ? "true" : "false");
   syslog(LOG_NOTICE, "Buffered message limit %lu kbytes",
          static_cast<unsigned long>(config.MsgBufferMax));
+  syslog(LOG_NOTICE, "Buffer uses size classes: %s",
+         config.PoolSizeClasses ? "true" : "false");
+  syslog(LOG_NOTICE, "Buffer uses per-thread caches: %s",
+         config.PoolThreadCache ? "true" : "false");
   syslog(LOG_NOTICE, "Max datagram input message size %lu bytes",
          static_cast<unsigned long>(config.MaxInputMsgSize));
   syslog(LOG_NOTICE, "Max stream input message size %lu bytes",
@@ -529,6 +694,8 @@ void Dory::LogConfig(const TConfig &config) {
   syslog(LOG_NOTICE, "Client ID [%s]", config.ClientId.c_str());
   syslog(LOG_NOTICE, "Required ACKs %d",
          static_cast<int>(config.RequiredAcks));
+  syslog(LOG_NOTICE, "Idempotent producer: %s",
+         config.IdempotentProducer ? "true" : "false");
   syslog(LOG_NOTICE, "Replication timeout %d milliseconds",
          static_cast<int>(config.ReplicationTimeout));
   syslog(LOG_NOTICE, "Shutdown send grace period %lu milliseconds",
@@ -537,6 +704,14 @@ void Dory::LogConfig(const TConfig &config) {
          static_cast<unsigned long>(config.DispatcherRestartMaxDelay));
   syslog(LOG_NOTICE, "Metadata refresh interval %lu minutes",
          static_cast<unsigned long>(config.MetadataRefreshInterval));
+
+  if (config.PartialMetadataRefresh) {
+    syslog(LOG_NOTICE, "Partial metadata refresh enabled: full refresh "
+           "interval %lu minutes",
+           static_cast<unsigned long>(config.FullMetadataRefreshInterval));
+  } else {
+    syslog(LOG_NOTICE, "Partial metadata refresh disabled");
+  }
   syslog(LOG_NOTICE, "Kafka socket timeout %lu seconds",
          static_cast<unsigned long>(config.KafkaSocketTimeout));
   syslog(LOG_NOTICE, "Pause rate limit initial %lu milliseconds",
@@ -555,6 +730,13 @@ void Dory::LogConfig(const TConfig &config) {
   syslog(LOG_NOTICE, "Skip comparing metadata on refresh: %s",
          config.SkipCompareMetadataOnRefresh ? "true" : "false");
 
+  if (config.MetadataSnapshotPath.empty()) {
+    syslog(LOG_NOTICE, "Metadata snapshot is disabled");
+  } else {
+    syslog(LOG_NOTICE, "Metadata snapshot file: [%s]",
+           config.MetadataSnapshotPath.c_str());
+  }
+
   if (config.DiscardLogPath.empty()) {
     syslog(LOG_NOTICE, "Discard logfile creation is disabled");
   } else {
@@ -569,7 +751,64 @@ void Dory::LogConfig(const TConfig &config) {
 
   syslog(LOG_NOTICE, "Discard report bad msg prefix size: %lu bytes",
          static_cast<unsigned long>(config.DiscardReportBadMsgPrefixSize));
+  if (config.SpoolDir.empty()) {
+    syslog(LOG_NOTICE, "Overflow spool is disabled");
+  } else {
+    syslog(LOG_NOTICE, "Overflow spool directory: [%s]",
+           config.SpoolDir.c_str());
+    syslog(LOG_NOTICE, "Overflow spool max size: %lu kbytes",
+           static_cast<unsigned long>(config.SpoolMaxSize));
+    syslog(LOG_NOTICE, "Overflow spool segment size: %lu kbytes",
+           static_cast<unsigned long>(config.SpoolSegmentSize));
+  }
+
+  if (config.JournalDir.empty()) {
+    syslog(LOG_NOTICE, "Message journal is disabled");
+  } else {
+    syslog(LOG_NOTICE, "Message journal directory: [%s]",
+           config.JournalDir.c_str());
+    syslog(LOG_NOTICE, "Message journal segment size: %lu kbytes",
+           static_cast<unsigned long>(config.JournalSegmentSize));
+
+    if (config.JournalMaxSize) {
+      syslog(LOG_NOTICE, "Message journal max size: %lu kbytes",
+             static_cast<unsigned long>(config.JournalMaxSize));
+    } else {
+      syslog(LOG_NOTICE, "Message journal max size: unlimited");
+    }
+    syslog(LOG_NOTICE, "Message journal flush interval: %lu ms",
+           static_cast<unsigned long>(config.JournalFlushInterval));
+  }
+
+  if (config.HandoffSocket.empty()) {
+    syslog(LOG_NOTICE, "Socket handoff is disabled");
+  } else {
+    syslog(LOG_NOTICE, "Socket handoff control socket: [%s]",
+           config.HandoffSocket.c_str());
+  }
+
+  if (config.ShmSocketName.empty()) {
+    syslog(LOG_NOTICE, "Shared memory input is disabled");
+  } else {
+    syslog(LOG_NOTICE, "Shared memory input control socket [%s]",
+           config.ShmSocketName.c_str());
+    syslog(LOG_NOTICE, "Shared memory input control socket mode %s",
+           BuildModeString(config.ShmSocketMode).c_str());
+    syslog(LOG_NOTICE, "Shared memory ring size: %lu kbytes",
+           static_cast<unsigned long>(config.ShmRingSize));
+    syslog(LOG_NOTICE, "Shared memory max rings: %lu",
+           static_cast<unsigned long>(config.ShmMaxRings));
+  }
+
   syslog(LOG_NOTICE, config.TopicAutocreate ?
          "Automatic topic creation enabled" :
          "Automatic topic creation disabled");
+
+  if (config.CompressionProbeInterval) {
+    syslog(LOG_NOTICE, "Compression probe interval: %lu message sets",
+           static_cast<unsigned long>(config.CompressionProbeInterval));
+  } else {
+    syslog(LOG_NOTICE, "Skipping compression of poorly compressing topics "
+           "is disabled");
+  }
 }
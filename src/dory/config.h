@@ -65,6 +65,10 @@ namespace Dory {
 
     size_t MsgBufferMax;
 
+    bool PoolSizeClasses;
+
+    bool PoolThreadCache;
+
     size_t MaxInputMsgSize;
 
     size_t MaxStreamInputMsgSize;
@@ -81,6 +85,8 @@ namespace Dory {
 
     int16_t RequiredAcks;
 
+    bool IdempotentProducer;
+
     size_t ReplicationTimeout;
 
     size_t ShutdownMaxDelay;
@@ -89,6 +95,10 @@ namespace Dory {
 
     size_t MetadataRefreshInterval;
 
+    bool PartialMetadataRefresh;
+
+    size_t FullMetadataRefreshInterval;
+
     size_t KafkaSocketTimeout;
 
     size_t PauseRateLimitInitial;
@@ -109,6 +119,8 @@ namespace Dory {
 
     bool SkipCompareMetadataOnRefresh;
 
+    std::string MetadataSnapshotPath;
+
     std::string DiscardLogPath;
 
     size_t DiscardLogMaxFileSize;
@@ -119,7 +131,39 @@ namespace Dory {
 
     size_t DiscardReportBadMsgPrefixSize;
 
+    /* Empty means "overflow spool is disabled". */
+    std::string SpoolDir;
+
+    size_t SpoolMaxSize;
+
+    size_t SpoolSegmentSize;
+
+    /* Empty means "message journal is disabled". */
+    std::string JournalDir;
+
+    size_t JournalSegmentSize;
+
+    /* 0 means "no limit". */
+    size_t JournalMaxSize;
+
+    size_t JournalFlushInterval;
+
+    /* Empty means "socket handoff is disabled". */
+    std::string HandoffSocket;
+
+    /* Empty means "shared memory input is disabled". */
+    std::string ShmSocketName;
+
+    Base::TOpt<mode_t> ShmSocketMode;
+
+    size_t ShmRingSize;
+
+    size_t ShmMaxRings;
+
     bool TopicAutocreate;
+
+    /* 0 means "always attempt compression". */
+    size_t CompressionProbeInterval;
   };  // TConfig
 
   void LogConfig(const TConfig &config);
@@ -192,6 +192,10 @@ static const char *ReasonToBlurb(TDiscardFileLogger::TDiscardReason reason) {
       return "RATE_LIMIT";
     case TDiscardFileLogger::TDiscardReason::FailedTopicAutocreate:
       return "TOPIC_AUTOCREATE_FAIL";
+    case TDiscardFileLogger::TDiscardReason::TopicQuota:
+      return "TOPIC_QUOTA";
+    case TDiscardFileLogger::TDiscardReason::Expired:
+      return "EXPIRED";
     NO_DEFAULT_CASE;
   }
 
@@ -242,6 +246,24 @@ void TDiscardFileLogger::LogNoMemDiscard(TMsg::TTimestamp timestamp,
     const char *topic_begin, const char *topic_end, const void *key_begin,
     const void *key_end, const void *value_begin, const void *value_end) {
   assert(this);
+  LogIntakeDiscard("NO_MEM", timestamp, topic_begin, topic_end, key_begin,
+      key_end, value_begin, value_end);
+}
+
+void TDiscardFileLogger::LogTopicQuotaDiscard(TMsg::TTimestamp timestamp,
+    const char *topic_begin, const char *topic_end, const void *key_begin,
+    const void *key_end, const void *value_begin, const void *value_end) {
+  assert(this);
+  LogIntakeDiscard(ReasonToBlurb(TDiscardReason::TopicQuota), timestamp,
+      topic_begin, topic_end, key_begin, key_end, value_begin, value_end);
+}
+
+void TDiscardFileLogger::LogIntakeDiscard(const char *reason_blurb,
+    TMsg::TTimestamp timestamp, const char *topic_begin,
+    const char *topic_end, const void *key_begin, const void *key_end,
+    const void *value_begin, const void *value_end) {
+  assert(this);
+  assert(reason_blurb);
   assert(topic_begin);
   assert(topic_end >= topic_begin);
   assert(key_begin || (key_end == key_begin));
@@ -258,8 +280,8 @@ void TDiscardFileLogger::LogNoMemDiscard(TMsg::TTimestamp timestamp,
       reinterpret_cast<const uint8_t *>(key_begin);
   size_t value_size = reinterpret_cast<const uint8_t *>(value_end) -
       reinterpret_cast<const uint8_t *>(value_begin);
-  WriteToLog(ComposeLogEntry(timestamp, "DISC", "NO_MEM", topic, key_begin,
-                 std::min(key_size, MaxMsgPrefixLen), value_begin,
+  WriteToLog(ComposeLogEntry(timestamp, "DISC", reason_blurb, topic,
+                 key_begin, std::min(key_size, MaxMsgPrefixLen), value_begin,
                  std::min(value_size, MaxMsgPrefixLen)));
 }
 
@@ -65,7 +65,9 @@ namespace Dory {
       ServerShutdown,
       NoAvailablePartitions,
       RateLimit,
-      FailedTopicAutocreate
+      FailedTopicAutocreate,
+      TopicQuota,
+      Expired
     };
 
     TDiscardFileLogger();
@@ -137,6 +139,13 @@ namespace Dory {
         const char *topic_end, const void *key_begin, const void *key_end,
         const void *value_begin, const void *value_end);
 
+    /* Write a log entry indicating that a message is being discarded because
+       its topic has reached its buffered byte quota and the shared burst
+       region is full.  Parameters are the same as for LogNoMemDiscard(). */
+    void LogTopicQuotaDiscard(TMsg::TTimestamp timestamp,
+        const char *topic_begin, const char *topic_end, const void *key_begin,
+        const void *key_end, const void *value_begin, const void *value_end);
+
     /* Write a log entry indicating that a malformed message is being
        discarded.  'msg_begin' points to the first byte of the message.
        'msg_end' points one position past the last byte of the message. */
@@ -238,6 +247,12 @@ namespace Dory {
 
     void EnforceMaxPrefixLen(std::vector<uint8_t> &msg);
 
+    /* Common implementation for LogNoMemDiscard() and
+       LogTopicQuotaDiscard(). */
+    void LogIntakeDiscard(const char *reason_blurb, TMsg::TTimestamp timestamp,
+        const char *topic_begin, const char *topic_end, const void *key_begin,
+        const void *key_end, const void *value_begin, const void *value_end);
+
     Base::TFd OpenLogPath(const char *log_path);
 
     void DisableLogging();
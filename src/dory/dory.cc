@@ -115,8 +115,11 @@ static int DoryMain(int argc, char *argv[]) {
 
   dory_config.Reset();
 
-  /* Fail early if server is already running. */
-  dory->BindStatusSocket(false);
+  /* Fail early if server is already running, unless we are taking over from
+     it. */
+  if (!dory->RequestHandoff()) {
+    dory->BindStatusSocket(false);
+  }
 
   LogConfig(dory->GetConfig());
 
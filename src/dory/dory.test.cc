@@ -99,6 +99,7 @@ namespace {
           BrokerPort(broker_port),
           MsgBufferMaxKb(msg_buffer_max_kb),
           DoryConf(dory_conf),
+          ConfFile("/tmp/dory_tmp.XXXXXX", true),
           DoryReturnValue(EXIT_FAILURE) {
     }
 
@@ -108,6 +109,7 @@ namespace {
           BrokerPort(broker_port),
           MsgBufferMaxKb(msg_buffer_max_kb),
           DoryConf(std::move(dory_conf)),
+          ConfFile("/tmp/dory_tmp.XXXXXX", true),
           DoryReturnValue(EXIT_FAILURE) {
     }
 
@@ -184,6 +186,11 @@ namespace {
       return Dory.get();
     }
 
+    /* This must not be called until SyncStart() has been called.  Replace
+       the contents of the config file with 'dory_conf' and ask the dory
+       server to reload it.  The reload happens asynchronously. */
+    void ReloadConf(const std::string &dory_conf);
+
     virtual void RequestShutdown() override;
 
     using TFdManagedThread::Join;
@@ -209,6 +216,10 @@ namespace {
 
     std::string DoryConf;
 
+    /* Holds 'DoryConf'.  This must stay around while dory is running, since
+       dory rereads it on config reload. */
+    TTmpFile ConfFile;
+
     int DoryReturnValue;
 
     std::unique_ptr<TDoryServer> Dory;
@@ -221,9 +232,7 @@ namespace {
 
   bool TDoryTestServer::SyncStart() {
     assert(this);
-    TTmpFile tmp_file;
-    tmp_file.SetDeleteOnDestroy(true);
-    std::ofstream ofs(tmp_file.GetName());
+    std::ofstream ofs(ConfFile.GetName());
     ofs << DoryConf;
     ofs.close();
     std::string msg_buffer_max_str =
@@ -231,7 +240,7 @@ namespace {
     std::vector<const char *> args;
     args.push_back("dory");
     args.push_back("--config_path");
-    args.push_back(tmp_file.GetName());
+    args.push_back(ConfFile.GetName());
     args.push_back("--msg_buffer_max");
     args.push_back(msg_buffer_max_str.c_str());
 
@@ -287,6 +296,15 @@ namespace {
     return true;
   }
 
+  void TDoryTestServer::ReloadConf(const std::string &dory_conf) {
+    assert(this);
+    DoryConf = dory_conf;
+    std::ofstream ofs(ConfFile.GetName(), std::ios::trunc);
+    ofs << DoryConf;
+    ofs.close();
+    Dory->RequestConfReload();
+  }
+
   void TDoryTestServer::RequestShutdown() {
     assert(this);
 
@@ -1853,6 +1871,153 @@ namespace {
     ASSERT_EQ(server.GetDoryReturnValue(), EXIT_SUCCESS);
   }
 
+  /* Create a configuration with per-topic batching that closes a batch after
+     'batch_msg_count' messages, and compression disabled. */
+  std::string CreatePerTopicBatchConf(in_port_t broker_port,
+      size_t batch_msg_count) {
+    std::ostringstream os;
+    os << "<?xml version=\"1.0\" encoding=\"US-ASCII\"?>" << std::endl
+       << "<doryConfig>" << std::endl
+       << "    <batching>" << std::endl
+       << "        <namedConfigs>" << std::endl
+       << "            <config name=\"config1\">" << std::endl
+       << "                <time value=\"disable\" />" << std::endl
+       << "                <messages value=\"" << batch_msg_count << "\" />"
+       << std::endl
+       << "                <bytes value=\"disable\" />" << std::endl
+       << "            </config>" << std::endl
+       << "        </namedConfigs>" << std::endl
+       << "        <produceRequestDataLimit value=\"1024k\" />" << std::endl
+       << "        <messageMaxBytes value=\"1024k\" />" << std::endl
+       << "        <combinedTopics enable=\"false\" />" << std::endl
+       << "        <defaultTopic action=\"perTopic\" config=\"config1\" />"
+       << std::endl
+       << "    </batching>" << std::endl
+       << "    <compression>" << std::endl
+       << "        <namedConfigs>" << std::endl
+       << "            <config name=\"noComp\" type=\"none\" />" << std::endl
+       << "        </namedConfigs>" << std::endl
+       << std::endl
+       << "        <defaultTopic config=\"noComp\" />" << std::endl
+       << "    </compression>" << std::endl
+       << "    <initialBrokers>" << std::endl
+       << "        <broker host=\"localhost\" port=\"" << broker_port <<"\" />"
+       << std::endl
+       << "    </initialBrokers>" << std::endl
+       << "</doryConfig>" << std::endl;
+    return os.str();
+  }
+
+  TEST_F(TDoryTest, ConfReloadNoResendTest) {
+    std::string topic("scooby_doo");
+    std::vector<std::string> kafka_config;
+    CreateKafkaConfig(1, topic.c_str(), 1, kafka_config);
+
+    /* Delay each ACK long enough that the first produce request is still
+       waiting for its ACK when the config reload happens. */
+    kafka_config.insert(kafka_config.begin() + 1,
+        "port 10000 read_delay 0:1 ack_delay 2000:1");
+    TMockKafkaConfig kafka(kafka_config);
+    kafka.StartKafka();
+    Dory::MockKafkaServer::TMainThread &mock_kafka = *kafka.MainThread;
+
+    /* Translate virtual port from the mock Kafka server setup file into a
+       physical port.  See big comment in <dory/mock_kafka_server/port_map.h>
+       for an explanation of what is going on here. */
+    in_port_t port = mock_kafka.VirtualPortToPhys(10000);
+
+    assert(port);
+    TDoryTestServer server(port, 1024, CreatePerTopicBatchConf(port, 4));
+    server.UseUnixDgSocket();
+    bool started = server.SyncStart();
+    ASSERT_TRUE(started);
+    TDoryServer *dory = server.GetDory();
+    TDoryClientSocket sock;
+    int ret = sock.Bind(server.GetUnixDgSocketName());
+    ASSERT_EQ(ret, DORY_OK);
+    std::vector<uint8_t> dg_buf;
+
+    /* These complete a batch under the initial config. */
+    for (size_t i = 0; i < 4; ++i) {
+      MakeDg(dg_buf, topic, "Scooby");
+      ret = sock.Send(&dg_buf[0], dg_buf.size());
+      ASSERT_EQ(ret, DORY_OK);
+    }
+
+    /* Change only the per-topic batching config while the batch sent above
+       awaits its ACK.  The dispatcher must not restart, so the batch must not
+       be resent. */
+    SleepMilliseconds(500);
+    ASSERT_EQ(dory->GetAckCount(), 0U);
+    server.ReloadConf(CreatePerTopicBatchConf(port, 3));
+
+    for (size_t i = 0;
+         (dory->GetConfGeneration().GetInfo().InUse < 2) && (i < 3000);
+         ++i) {
+      SleepMilliseconds(10);
+    }
+
+    ASSERT_EQ(dory->GetConfGeneration().GetInfo().InUse, 2U);
+
+    /* These complete a batch only under the new config. */
+    for (size_t i = 0; i < 3; ++i) {
+      MakeDg(dg_buf, topic, "Shaggy");
+      ret = sock.Send(&dg_buf[0], dg_buf.size());
+      ASSERT_EQ(ret, DORY_OK);
+    }
+
+    for (size_t i = 0; (dory->GetAckCount() < 2) && (i < 3000); ++i) {
+      SleepMilliseconds(10);
+    }
+
+    ASSERT_EQ(dory->GetAckCount(), 2U);
+    using TTracker = TReceivedRequestTracker;
+    std::list<TTracker::TRequestInfo> received;
+    std::vector<std::string> first_values;
+    std::vector<size_t> msg_counts;
+
+    /* Give a resend (if there is one) time to show up before checking. */
+    for (size_t i = 0; i < 300; ++i) {
+      mock_kafka.NonblockingGetHandledRequests(received);
+
+      for (auto &item : received) {
+        if (item.MetadataRequestInfo.IsKnown()) {
+          ASSERT_EQ(item.MetadataRequestInfo->ReturnedErrorCode, 0);
+        } else if (item.ProduceRequestInfo.IsKnown()) {
+          const TTracker::TProduceRequestInfo &info = *item.ProduceRequestInfo;
+          ASSERT_EQ(info.Topic, topic);
+          ASSERT_EQ(info.ReturnedErrorCode, 0);
+          first_values.push_back(info.FirstMsgValue);
+          msg_counts.push_back(info.MsgCount);
+        } else {
+          ASSERT_TRUE(false);
+        }
+      }
+
+      received.clear();
+      SleepMilliseconds(10);
+    }
+
+    ASSERT_EQ(first_values.size(), 2U);
+    ASSERT_EQ(first_values[0], "Scooby");
+    ASSERT_EQ(msg_counts[0], 4U);
+    ASSERT_EQ(first_values[1], "Shaggy");
+    ASSERT_EQ(msg_counts[1], 3U);
+    ASSERT_EQ(dory->GetAckCount(), 2U);
+
+    TAnomalyTracker::TInfo bad_stuff;
+    dory->GetAnomalyTracker().GetInfo(bad_stuff);
+    ASSERT_EQ(bad_stuff.DiscardTopicMap.size(), 0U);
+    ASSERT_EQ(bad_stuff.DuplicateTopicMap.size(), 0U);
+    ASSERT_EQ(bad_stuff.BadTopics.size(), 0U);
+    ASSERT_EQ(bad_stuff.MalformedMsgCount, 0U);
+    ASSERT_EQ(bad_stuff.UnsupportedVersionMsgCount, 0U);
+
+    server.RequestShutdown();
+    server.Join();
+    ASSERT_EQ(server.GetDoryReturnValue(), EXIT_SUCCESS);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
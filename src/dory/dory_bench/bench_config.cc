@@ -0,0 +1,328 @@
+/* <dory/dory_bench/bench_config.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/dory_bench/bench_config.h>.
+ */
+
+#include <dory/dory_bench/bench_config.h>
+
+#include <vector>
+
+#include <base/basename.h>
+#include <base/no_default_case.h>
+#include <dory/build_id.h>
+#include <dory/mock_kafka_server/latency_dist.h>
+#include <dory/util/arg_parse_error.h>
+#include <tclap/CmdLine.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::DoryBench;
+using namespace Dory::Util;
+
+static TBenchConfig::TInputType ParseInputType(const std::string &s) {
+  if (s == "dg") {
+    return TBenchConfig::TInputType::UnixDg;
+  }
+
+  if (s == "stream") {
+    return TBenchConfig::TInputType::UnixStream;
+  }
+
+  if (s == "tcp") {
+    return TBenchConfig::TInputType::Tcp;
+  }
+
+  throw TArgParseError("--input must be one of (dg, stream, tcp)");
+}
+
+static TBenchConfig::TSizeDist ParseSizeDist(const std::string &s) {
+  if (s == "fixed") {
+    return TBenchConfig::TSizeDist::Fixed;
+  }
+
+  if (s == "uniform") {
+    return TBenchConfig::TSizeDist::Uniform;
+  }
+
+  if (s == "exponential") {
+    return TBenchConfig::TSizeDist::Exponential;
+  }
+
+  throw TArgParseError(
+      "--size_dist must be one of (fixed, uniform, exponential)");
+}
+
+static void ParseArgs(int argc, char *argv[], TBenchConfig &config) {
+  using namespace TCLAP;
+  const std::string prog_name = Basename(argv[0]);
+  std::vector<const char *> arg_vec(&argv[0], &argv[0] + argc);
+  arg_vec[0] = prog_name.c_str();
+
+  try {
+    CmdLine cmd("End to end benchmark that runs Dory against an in-process "
+        "mock Kafka cluster.", ' ', dory_build_id);
+    ValueArg<decltype(config.Threads)> arg_threads("", "threads",
+        "Number of client threads sending messages.", false, config.Threads,
+        "COUNT");
+    cmd.add(arg_threads);
+    ValueArg<std::string> arg_input("", "input", "Input mechanism: dg (UNIX "
+        "domain datagram), stream (UNIX domain stream), or tcp.", false, "dg",
+        "TYPE");
+    cmd.add(arg_input);
+    ValueArg<decltype(config.Warmup)> arg_warmup("", "warmup", "Seconds to "
+        "send before measuring.", false, config.Warmup, "SECONDS");
+    cmd.add(arg_warmup);
+    ValueArg<decltype(config.Duration)> arg_duration("", "duration",
+        "Seconds to measure for.", false, config.Duration, "SECONDS");
+    cmd.add(arg_duration);
+    ValueArg<decltype(config.Rate)> arg_rate("", "rate", "Messages per "
+        "second sent by each client thread.  0 means as fast as possible.",
+        false, config.Rate, "RATE");
+    cmd.add(arg_rate);
+    ValueArg<decltype(config.Topics)> arg_topics("", "topics", "Number of "
+        "topics.  Each client thread cycles through all topics.", false,
+        config.Topics, "COUNT");
+    cmd.add(arg_topics);
+    ValueArg<decltype(config.Partitions)> arg_partitions("", "partitions",
+        "Partitions per topic.", false, config.Partitions, "COUNT");
+    cmd.add(arg_partitions);
+    ValueArg<decltype(config.Brokers)> arg_brokers("", "brokers", "Number of "
+        "mock brokers.", false, config.Brokers, "COUNT");
+    cmd.add(arg_brokers);
+    ValueArg<decltype(config.ValueSize)> arg_value_size("", "value_size",
+        "Message value size in bytes (mean for exponential distribution, "
+        "minimum for uniform).  Must be at least 8, since each value starts "
+        "with a timestamp.", false, config.ValueSize, "BYTES");
+    cmd.add(arg_value_size);
+    ValueArg<decltype(config.ValueSizeMax)> arg_value_size_max("",
+        "value_size_max", "Maximum message value size for uniform and "
+        "exponential distributions.  Defaults to 10 times --value_size.",
+        false, config.ValueSizeMax, "BYTES");
+    cmd.add(arg_value_size_max);
+    ValueArg<std::string> arg_size_dist("", "size_dist", "Value size "
+        "distribution: fixed, uniform, or exponential.", false, "fixed",
+        "DIST");
+    cmd.add(arg_size_dist);
+    ValueArg<decltype(config.KeySize)> arg_key_size("", "key_size",
+        "Message key size in bytes.", false, config.KeySize, "BYTES");
+    cmd.add(arg_key_size);
+    SwitchArg arg_partition_key("", "partition_key", "Send PartitionKey "
+        "messages with random partition keys, rather than AnyPartition "
+        "messages.", cmd, config.PartitionKey);
+    ValueArg<decltype(config.BatchTime)> arg_batch_time("", "batch_time",
+        "Batching time limit in milliseconds.  0 disables the limit.", false,
+        config.BatchTime, "MS");
+    cmd.add(arg_batch_time);
+    ValueArg<decltype(config.BatchMsgs)> arg_batch_msgs("", "batch_msgs",
+        "Batching message count limit.  0 disables the limit.", false,
+        config.BatchMsgs, "COUNT");
+    cmd.add(arg_batch_msgs);
+    ValueArg<decltype(config.BatchBytes)> arg_batch_bytes("", "batch_bytes",
+        "Batching size limit in bytes.  0 disables the limit.  If all "
+        "batching limits are 0, batching is disabled.", false,
+        config.BatchBytes, "BYTES");
+    cmd.add(arg_batch_bytes);
+    ValueArg<decltype(config.Compression)> arg_compression("", "compression",
+        "Compression type: none, gzip, snappy, or lz4.", false,
+        config.Compression, "TYPE");
+    cmd.add(arg_compression);
+    ValueArg<decltype(config.CompressionMinSize)> arg_compression_min_size("",
+        "compression_min_size", "Minimum message set size in bytes for "
+        "compression.", false, config.CompressionMinSize, "BYTES");
+    cmd.add(arg_compression_min_size);
+    ValueArg<int> arg_compression_level("", "compression_level",
+        "Compression level.  Defaults to the codec's default.", false, 0,
+        "LEVEL");
+    cmd.add(arg_compression_level);
+    ValueArg<decltype(config.MsgBufferMax)> arg_msg_buffer_max("",
+        "msg_buffer_max", "Dory's message buffer size in Kb.", false,
+        config.MsgBufferMax, "MAX_KB");
+    cmd.add(arg_msg_buffer_max);
+    SwitchArg arg_mock_sink("", "mock_sink", "Run the mock Kafka server in "
+        "high-throughput sink mode.", cmd, config.MockSink);
+    ValueArg<decltype(config.MockSinkSample)> arg_mock_sink_sample("",
+        "mock_sink_sample", "In sink mode, decode one of every N produce "
+        "requests to measure latency.", false, config.MockSinkSample, "N");
+    cmd.add(arg_mock_sink_sample);
+    ValueArg<decltype(config.MockAckLatency)> arg_mock_ack_latency("",
+        "mock_ack_latency", "Delay each ACK from the mock Kafka server by a "
+        "random amount: none, fixed:US, uniform:MIN_US:MAX_US, or "
+        "longtail:MEDIAN_US:P99_US.", false, config.MockAckLatency, "DIST");
+    cmd.add(arg_mock_ack_latency);
+    ValueArg<decltype(config.MockBandwidth)> arg_mock_bandwidth("",
+        "mock_bandwidth", "Limit the rate at which each mock Kafka broker "
+        "reads from each connection.  0 means unlimited.", false,
+        config.MockBandwidth, "BYTES_PER_SEC");
+    cmd.add(arg_mock_bandwidth);
+    ValueArg<decltype(config.MockErrorRate)> arg_mock_error_rate("",
+        "mock_error_rate", "Fraction of message sets that get a retriable "
+        "error ACK (request timed out) from the mock Kafka server.", false,
+        config.MockErrorRate, "RATE");
+    cmd.add(arg_mock_error_rate);
+    ValueArg<decltype(config.MockLeaderFlap)> arg_mock_leader_flap("",
+        "mock_leader_flap", "Move leadership of the first topic's partition 0 "
+        "back and forth between two brokers with this period.  0 means "
+        "never.", false, config.MockLeaderFlap, "MS");
+    cmd.add(arg_mock_leader_flap);
+    ValueArg<decltype(config.Output)> arg_output("", "output", "File to write "
+        "JSON results to.  Defaults to standard output.", false,
+        config.Output, "PATH");
+    cmd.add(arg_output);
+    SwitchArg arg_log_echo("", "log_echo", "Echo syslog messages to standard "
+        "error.", cmd, config.LogEcho);
+    cmd.parse(argc, &arg_vec[0]);
+    config.Threads = arg_threads.getValue();
+    config.InputType = ParseInputType(arg_input.getValue());
+    config.Warmup = arg_warmup.getValue();
+    config.Duration = arg_duration.getValue();
+    config.Rate = arg_rate.getValue();
+    config.Topics = arg_topics.getValue();
+    config.Partitions = arg_partitions.getValue();
+    config.Brokers = arg_brokers.getValue();
+    config.ValueSize = arg_value_size.getValue();
+    config.ValueSizeMax = arg_value_size_max.isSet() ?
+        arg_value_size_max.getValue() : (10 * config.ValueSize);
+    config.SizeDist = ParseSizeDist(arg_size_dist.getValue());
+    config.KeySize = arg_key_size.getValue();
+    config.PartitionKey = arg_partition_key.getValue();
+    config.BatchTime = arg_batch_time.getValue();
+    config.BatchMsgs = arg_batch_msgs.getValue();
+    config.BatchBytes = arg_batch_bytes.getValue();
+    config.Compression = arg_compression.getValue();
+    config.CompressionMinSize = arg_compression_min_size.getValue();
+
+    if (arg_compression_level.isSet()) {
+      config.CompressionLevel.MakeKnown(arg_compression_level.getValue());
+    }
+
+    config.MsgBufferMax = arg_msg_buffer_max.getValue();
+    config.MockSink = arg_mock_sink.getValue();
+    config.MockSinkSample = arg_mock_sink_sample.getValue();
+    config.MockAckLatency = arg_mock_ack_latency.getValue();
+
+    try {
+      MockKafkaServer::TLatencyDist dist(config.MockAckLatency);
+    } catch (const MockKafkaServer::TLatencyDist::TBadSpec &x) {
+      throw TArgParseError(x.what());
+    }
+
+    config.MockBandwidth = arg_mock_bandwidth.getValue();
+    config.MockErrorRate = arg_mock_error_rate.getValue();
+
+    if (!((config.MockErrorRate >= 0.0) && (config.MockErrorRate <= 1.0))) {
+      throw TArgParseError("--mock_error_rate must be from 0 to 1");
+    }
+
+    config.MockLeaderFlap = arg_mock_leader_flap.getValue();
+
+    if (config.MockLeaderFlap && (config.Brokers < 2)) {
+      throw TArgParseError("--mock_leader_flap requires at least 2 brokers");
+    }
+    config.Output = arg_output.getValue();
+    config.LogEcho = arg_log_echo.getValue();
+  } catch (const ArgException &x) {
+    throw TArgParseError(x.error(), x.argId());
+  }
+
+  if ((config.Threads == 0) || (config.Topics == 0) ||
+      (config.Partitions == 0) || (config.Brokers == 0) ||
+      (config.Duration == 0)) {
+    throw TArgParseError("--threads, --topics, --partitions, --brokers, and "
+        "--duration must be at least 1");
+  }
+
+  if (config.ValueSize < 8) {
+    throw TArgParseError("--value_size must be at least 8");
+  }
+
+  if ((config.SizeDist != TBenchConfig::TSizeDist::Fixed) &&
+      (config.ValueSizeMax < config.ValueSize)) {
+    throw TArgParseError("--value_size_max must be at least --value_size");
+  }
+
+  if ((config.Compression != "none") && (config.Compression != "gzip") &&
+      (config.Compression != "snappy") && (config.Compression != "lz4")) {
+    throw TArgParseError(
+        "--compression must be one of (none, gzip, snappy, lz4)");
+  }
+}
+
+TBenchConfig::TBenchConfig(int argc, char *argv[])
+    : Threads(4),
+      InputType(TInputType::UnixDg),
+      Warmup(2),
+      Duration(10),
+      Rate(0),
+      Topics(1),
+      Partitions(8),
+      Brokers(2),
+      ValueSize(100),
+      ValueSizeMax(1000),
+      SizeDist(TSizeDist::Fixed),
+      KeySize(0),
+      PartitionKey(false),
+      BatchTime(10),
+      BatchMsgs(0),
+      BatchBytes(65536),
+      Compression("none"),
+      CompressionMinSize(0),
+      MsgBufferMax(65536),
+      MockSink(false),
+      MockSinkSample(16),
+      MockAckLatency("none"),
+      MockBandwidth(0),
+      MockErrorRate(0.0),
+      MockLeaderFlap(0),
+      LogEcho(false) {
+  ParseArgs(argc, argv, *this);
+}
+
+const char *Dory::DoryBench::ToString(TBenchConfig::TInputType input_type) {
+  switch (input_type) {
+    case TBenchConfig::TInputType::UnixDg: {
+      break;
+    }
+    case TBenchConfig::TInputType::UnixStream: {
+      return "stream";
+    }
+    case TBenchConfig::TInputType::Tcp: {
+      return "tcp";
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return "dg";
+}
+
+const char *Dory::DoryBench::ToString(TBenchConfig::TSizeDist size_dist) {
+  switch (size_dist) {
+    case TBenchConfig::TSizeDist::Fixed: {
+      break;
+    }
+    case TBenchConfig::TSizeDist::Uniform: {
+      return "uniform";
+    }
+    case TBenchConfig::TSizeDist::Exponential: {
+      return "exponential";
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return "fixed";
+}
@@ -0,0 +1,142 @@
+/* <dory/dory_bench/bench_config.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Configuration for dory_bench.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <base/opt.h>
+
+namespace Dory {
+
+  namespace DoryBench {
+
+    struct TBenchConfig {
+      enum class TInputType {
+        UnixDg,
+        UnixStream,
+        Tcp
+      };  // TInputType
+
+      /* How message value sizes are chosen. */
+      enum class TSizeDist {
+        /* Always 'ValueSize'. */
+        Fixed,
+
+        /* Uniform from 'ValueSize' to 'ValueSizeMax'. */
+        Uniform,
+
+        /* Exponential with mean 'ValueSize', capped at 'ValueSizeMax'. */
+        Exponential
+      };  // TSizeDist
+
+      /* Throws Dory::Util::TArgParseError on error parsing args. */
+      TBenchConfig(int argc, char *argv[]);
+
+      size_t Threads;
+
+      TInputType InputType;
+
+      /* Seconds of load before measuring starts. */
+      size_t Warmup;
+
+      /* Seconds to measure for. */
+      size_t Duration;
+
+      /* Messages per second per client thread.  0 means no limit. */
+      size_t Rate;
+
+      size_t Topics;
+
+      size_t Partitions;
+
+      size_t Brokers;
+
+      size_t ValueSize;
+
+      size_t ValueSizeMax;
+
+      TSizeDist SizeDist;
+
+      size_t KeySize;
+
+      /* Send PartitionKey messages with random partition keys rather than
+         AnyPartition messages. */
+      bool PartitionKey;
+
+      /* Batching limits.  0 disables a limit.  If all are 0, batching is
+         disabled. */
+      size_t BatchTime;
+
+      size_t BatchMsgs;
+
+      size_t BatchBytes;
+
+      /* One of "none", "gzip", "snappy", "lz4". */
+      std::string Compression;
+
+      size_t CompressionMinSize;
+
+      Base::TOpt<int> CompressionLevel;
+
+      size_t MsgBufferMax;
+
+      /* Run the mock Kafka server in sink mode, so it is less likely to be
+         the bottleneck.  Latency is then measured from sampled requests
+         only. */
+      bool MockSink;
+
+      /* In sink mode, fully decode one of every 'MockSinkSample' produce
+         requests for latency measurement. */
+      size_t MockSinkSample;
+
+      /* The following simulate slow brokers and unreliable links.  See the
+         setup file documentation in <dory/mock_kafka_server/setup.h>. */
+
+      /* Random ACK latency for every broker, as a latency distribution
+         specification (for instance, "longtail:2000:50000"). */
+      std::string MockAckLatency;
+
+      /* Bandwidth limit in bytes per second for each connection to a broker
+         (0 means unlimited). */
+      size_t MockBandwidth;
+
+      /* Fraction of message sets that get a retriable error ACK. */
+      double MockErrorRate;
+
+      /* If nonzero, leadership of partition 0 of the first topic moves back
+         and forth between two brokers with this period in milliseconds. */
+      size_t MockLeaderFlap;
+
+      /* Where to write JSON results.  Empty means standard output. */
+      std::string Output;
+
+      bool LogEcho;
+    };  // TBenchConfig
+
+    const char *ToString(TBenchConfig::TInputType input_type);
+
+    const char *ToString(TBenchConfig::TSizeDist size_dist);
+
+  }  // DoryBench
+
+}  // Dory
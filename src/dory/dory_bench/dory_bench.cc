@@ -0,0 +1,677 @@
+/* <dory/dory_bench/dory_bench.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   End to end benchmark: runs Dory in-process against the mock Kafka server,
+   drives it from client threads, and reports the results as JSON.
+ */
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <netinet/in.h>
+#include <signal.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/indent.h>
+#include <base/no_default_case.h>
+#include <base/opt.h>
+#include <base/tmp_dir.h>
+#include <base/tmp_file.h>
+#include <base/tmp_file_name.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/build_id.h>
+#include <dory/client/client_sender_base.h>
+#include <dory/client/tcp_sender.h>
+#include <dory/client/unix_dg_sender.h>
+#include <dory/client/unix_stream_sender.h>
+#include <dory/config.h>
+#include <dory/dory_bench/bench_config.h>
+#include <dory/dory_bench/latency_collector.h>
+#include <dory/dory_bench/load_generator.h>
+#include <dory/dory_bench/thread_cpu.h>
+#include <dory/dory_server.h>
+#include <dory/mock_kafka_server/config.h>
+#include <dory/mock_kafka_server/main_thread.h>
+#include <dory/util/arg_parse_error.h>
+#include <dory/util/dory_xml_init.h>
+#include <dory/util/handle_xml_errors.h>
+#include <dory/util/misc_util.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Client;
+using namespace Dory::DoryBench;
+using namespace Dory::Util;
+
+/* Thread names identify each thread's role in the CPU report.  Threads
+   inherit their creator's name, so naming a thread before it creates others
+   tags all of them. */
+static const char MAIN_THREAD_NAME[] = "dory_bench";
+
+static const char MOCK_KAFKA_THREAD_NAME[] = "mock_kafka";
+
+static const char DORY_THREAD_NAME[] = "dory";
+
+static std::string CreateKafkaSetup(const TBenchConfig &config,
+    const std::vector<std::string> &topics) {
+  /* Simulate the brokers on consecutive virtual ports starting at 10000, and
+     spread the first partitions of the topics across the brokers. */
+  std::ostringstream os;
+  os << "ports 10000 " << config.Brokers << std::endl;
+
+  for (size_t i = 0; i < config.Brokers; ++i) {
+    if (config.MockAckLatency != "none") {
+      os << "port_ack_latency " << (10000 + i) << " "
+          << config.MockAckLatency << std::endl;
+    }
+
+    if (config.MockBandwidth) {
+      os << "port_bandwidth " << (10000 + i) << " " << config.MockBandwidth
+          << std::endl;
+    }
+  }
+
+  for (size_t i = 0; i < topics.size(); ++i) {
+    os << "topic " << topics[i] << " " << config.Partitions << " "
+        << (i % config.Brokers) << std::endl;
+  }
+
+  if (config.MockErrorRate > 0.0) {
+    for (const std::string &topic : topics) {
+      for (size_t i = 0; i < config.Partitions; ++i) {
+        /* 7 is "request timed out", which Dory retries. */
+        os << "partition_error_rate " << topic << " " << i << " 7 "
+            << config.MockErrorRate << std::endl;
+      }
+    }
+  }
+
+  if (config.MockLeaderFlap && !topics.empty()) {
+    /* Partition 0 of the first topic starts on the first broker. */
+    os << "leader_flap " << topics[0] << " 0 " << config.MockLeaderFlap
+        << " 10001" << std::endl;
+  }
+
+  return os.str();
+}
+
+static std::string BatchLimit(size_t value) {
+  return value ? boost::lexical_cast<std::string>(value) : "disable";
+}
+
+static std::string CreateDoryConf(const TBenchConfig &config,
+    in_port_t broker_port) {
+  bool batching = config.BatchTime || config.BatchMsgs || config.BatchBytes;
+  std::ostringstream os;
+  os << "<?xml version=\"1.0\" encoding=\"US-ASCII\"?>" << std::endl
+     << "<doryConfig>" << std::endl
+     << "    <batching>" << std::endl;
+
+  if (batching) {
+    os << "        <namedConfigs>" << std::endl
+       << "            <config name=\"bench\">" << std::endl
+       << "                <time value=\"" << BatchLimit(config.BatchTime)
+       << "\" />" << std::endl
+       << "                <messages value=\"" << BatchLimit(config.BatchMsgs)
+       << "\" />" << std::endl
+       << "                <bytes value=\"" << BatchLimit(config.BatchBytes)
+       << "\" />" << std::endl
+       << "            </config>" << std::endl
+       << "        </namedConfigs>" << std::endl;
+  }
+
+  os << "        <produceRequestDataLimit value=\"1024k\" />" << std::endl
+     << "        <messageMaxBytes value=\"1024k\" />" << std::endl
+     << "        <combinedTopics enable=\"false\" />" << std::endl;
+
+  if (batching) {
+    os << "        <defaultTopic action=\"perTopic\" config=\"bench\" />"
+       << std::endl;
+  } else {
+    os << "        <defaultTopic action=\"disable\" />" << std::endl;
+  }
+
+  os << "    </batching>" << std::endl
+     << "    <compression>" << std::endl
+     << "        <namedConfigs>" << std::endl
+     << "            <config name=\"bench\" type=\"" << config.Compression
+     << "\"";
+
+  if (config.Compression != "none") {
+    os << " minSize=\"" << config.CompressionMinSize << "\"";
+
+    if (config.CompressionLevel.IsKnown()) {
+      os << " level=\"" << *config.CompressionLevel << "\"";
+    }
+  }
+
+  os << " />" << std::endl
+     << "        </namedConfigs>" << std::endl
+     << std::endl
+     << "        <defaultTopic config=\"bench\" />" << std::endl
+     << "    </compression>" << std::endl
+     << "    <initialBrokers>" << std::endl
+     << "        <broker host=\"localhost\" port=\"" << broker_port << "\" />"
+     << std::endl
+     << "    </initialBrokers>" << std::endl
+     << "</doryConfig>" << std::endl;
+  return os.str();
+}
+
+static void WriteFile(const TTmpFile &file, const std::string &contents) {
+  std::ofstream ofs(file.GetName());
+  ofs << contents;
+  ofs.close();
+
+  if (!ofs) {
+    throw std::runtime_error(std::string("Failed to write file ") +
+        file.GetName());
+  }
+}
+
+/* Counters sampled at the start and end of the measurement interval. */
+struct TSnapshot {
+  std::chrono::steady_clock::time_point Time;
+
+  uint64_t MsgsSent;
+
+  uint64_t BytesSent;
+
+  uint64_t SendErrors;
+
+  uint64_t MsgsReceived;
+
+  size_t AckCount;
+
+  std::map<pid_t, TThreadCpu> Cpu;
+
+  TSnapshot()
+      : MsgsSent(0),
+        BytesSent(0),
+        SendErrors(0),
+        MsgsReceived(0),
+        AckCount(0) {
+  }
+};  // TSnapshot
+
+static TSnapshot TakeSnapshot(
+    const std::vector<std::unique_ptr<TLoadGenerator>> &clients,
+    const TLatencyCollector &collector,
+    const MockKafkaServer::TMainThread &mock_kafka, bool mock_sink,
+    const TDoryServer &dory) {
+  TSnapshot result;
+  result.Time = std::chrono::steady_clock::now();
+
+  for (const auto &client : clients) {
+    result.MsgsSent += client->GetMsgsSent();
+    result.BytesSent += client->GetBytesSent();
+    result.SendErrors += client->GetSendErrors();
+  }
+
+  /* In sink mode, only sampled requests reach the collector.  The sink
+     doesn't decompress, so a compressed message set counts as one message.
+   */
+  result.MsgsReceived = mock_sink ?
+      static_cast<uint64_t>(mock_kafka.GetSinkStats().Msgs) :
+      collector.GetMsgsReceived();
+  result.AckCount = dory.GetAckCount();
+  result.Cpu = GetThreadCpu();
+  return result;
+}
+
+static std::unique_ptr<TClientSenderBase> CreateSender(
+    const TBenchConfig &config, const char *dg_socket_name,
+    const char *stream_socket_name, in_port_t input_port) {
+  std::unique_ptr<TClientSenderBase> result;
+
+  switch (config.InputType) {
+    case TBenchConfig::TInputType::UnixDg: {
+      result.reset(new TUnixDgSender(dg_socket_name));
+      break;
+    }
+    case TBenchConfig::TInputType::UnixStream: {
+      result.reset(new TUnixStreamSender(stream_socket_name));
+      break;
+    }
+    case TBenchConfig::TInputType::Tcp: {
+      result.reset(new TTcpSender(input_port));
+      break;
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return result;
+}
+
+static double PerSecond(uint64_t count, double seconds) {
+  return (seconds > 0.0) ? (static_cast<double>(count) / seconds) : 0.0;
+}
+
+static void WriteResults(std::ostream &os, const TBenchConfig &config,
+    const TSnapshot &start, const TSnapshot &finish,
+    const TLatencyCollector::TLatencySummary &latency,
+    const TAnomalyTracker::TInfo &anomalies) {
+  double seconds = std::chrono::duration<double>(
+      finish.Time - start.Time).count();
+  size_t discards = 0;
+
+  for (const auto &item : anomalies.DiscardTopicMap) {
+    discards += item.second.Count;
+  }
+
+  /* CPU time used during the measurement interval, per thread and per role.
+     Threads created during the interval start from zero. */
+  std::map<pid_t, TThreadCpu> thread_cpu;
+  std::map<std::string, double> role_cpu;
+  double total_cpu = 0.0;
+
+  for (const auto &item : finish.Cpu) {
+    TThreadCpu delta = item.second;
+    auto iter = start.Cpu.find(item.first);
+
+    if (iter != start.Cpu.end()) {
+      delta.UserSeconds -= iter->second.UserSeconds;
+      delta.SystemSeconds -= iter->second.SystemSeconds;
+    }
+
+    double cpu = delta.UserSeconds + delta.SystemSeconds;
+    role_cpu[delta.Name] += cpu;
+    total_cpu += cpu;
+    thread_cpu[item.first] = delta;
+  }
+
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"config\": {" << std::endl;
+
+    {
+      TIndent ind2(ind1);
+      os << ind2 << "\"threads\": " << config.Threads << "," << std::endl
+          << ind2 << "\"input\": \"" << ToString(config.InputType) << "\","
+          << std::endl
+          << ind2 << "\"rate\": " << config.Rate << "," << std::endl
+          << ind2 << "\"topics\": " << config.Topics << "," << std::endl
+          << ind2 << "\"partitions\": " << config.Partitions << ","
+          << std::endl
+          << ind2 << "\"brokers\": " << config.Brokers << "," << std::endl
+          << ind2 << "\"value_size\": " << config.ValueSize << ","
+          << std::endl
+          << ind2 << "\"value_size_max\": " << config.ValueSizeMax << ","
+          << std::endl
+          << ind2 << "\"size_dist\": \"" << ToString(config.SizeDist)
+          << "\"," << std::endl
+          << ind2 << "\"key_size\": " << config.KeySize << "," << std::endl
+          << ind2 << "\"partition_key\": "
+          << (config.PartitionKey ? "true" : "false") << "," << std::endl
+          << ind2 << "\"batch_time\": " << config.BatchTime << ","
+          << std::endl
+          << ind2 << "\"batch_msgs\": " << config.BatchMsgs << ","
+          << std::endl
+          << ind2 << "\"batch_bytes\": " << config.BatchBytes << ","
+          << std::endl
+          << ind2 << "\"compression\": \"" << config.Compression << "\","
+          << std::endl
+          << ind2 << "\"compression_min_size\": "
+          << config.CompressionMinSize << "," << std::endl
+          << ind2 << "\"msg_buffer_max\": " << config.MsgBufferMax << ","
+          << std::endl
+          << ind2 << "\"mock_sink\": " << (config.MockSink ? "true" : "false")
+          << "," << std::endl
+          << ind2 << "\"mock_ack_latency\": \"" << config.MockAckLatency
+          << "\"," << std::endl
+          << ind2 << "\"mock_bandwidth\": " << config.MockBandwidth << ","
+          << std::endl
+          << ind2 << "\"mock_error_rate\": " << config.MockErrorRate << ","
+          << std::endl
+          << ind2 << "\"mock_leader_flap\": " << config.MockLeaderFlap
+          << std::endl;
+    }
+
+    uint64_t sent = finish.MsgsSent - start.MsgsSent;
+    uint64_t bytes = finish.BytesSent - start.BytesSent;
+    uint64_t received = finish.MsgsReceived - start.MsgsReceived;
+    os << ind1 << "}," << std::endl
+        << ind1 << "\"duration\": " << seconds << "," << std::endl
+        << ind1 << "\"msgs_sent\": " << sent << "," << std::endl
+        << ind1 << "\"msgs_per_sec\": " << PerSecond(sent, seconds) << ","
+        << std::endl
+        << ind1 << "\"bytes_per_sec\": " << PerSecond(bytes, seconds) << ","
+        << std::endl
+        << ind1 << "\"msgs_delivered\": " << received << "," << std::endl
+        << ind1 << "\"delivered_msgs_per_sec\": "
+        << PerSecond(received, seconds) << "," << std::endl
+        << ind1 << "\"acks\": " << (finish.AckCount - start.AckCount) << ","
+        << std::endl
+        << ind1 << "\"send_errors\": "
+        << (finish.SendErrors - start.SendErrors) << "," << std::endl
+        << ind1 << "\"discards\": {" << std::endl;
+
+    {
+      TIndent ind2(ind1);
+      os << ind2 << "\"total\": " << discards << "," << std::endl
+          << ind2 << "\"malformed\": " << anomalies.MalformedMsgCount
+          << std::endl;
+    }
+
+    os << ind1 << "}," << std::endl
+        << ind1 << "\"latency_us\": {" << std::endl;
+
+    {
+      TIndent ind2(ind1);
+      os << ind2 << "\"samples\": " << latency.Samples << "," << std::endl
+          << ind2 << "\"min\": " << latency.Min << "," << std::endl
+          << ind2 << "\"p50\": " << latency.P50 << "," << std::endl
+          << ind2 << "\"p90\": " << latency.P90 << "," << std::endl
+          << ind2 << "\"p99\": " << latency.P99 << "," << std::endl
+          << ind2 << "\"p999\": " << latency.P999 << "," << std::endl
+          << ind2 << "\"max\": " << latency.Max << std::endl;
+    }
+
+    os << ind1 << "}," << std::endl
+        << ind1 << "\"cpu\": {" << std::endl;
+
+    {
+      TIndent ind2(ind1);
+      os << ind2 << "\"total_sec\": " << total_cpu << "," << std::endl
+          << ind2 << "\"roles\": {" << std::endl;
+
+      {
+        TIndent ind3(ind2);
+        size_t i = 0;
+
+        for (const auto &item : role_cpu) {
+          os << ind3 << "\"" << item.first << "\": " << item.second
+              << ((++i < role_cpu.size()) ? "," : "") << std::endl;
+        }
+      }
+
+      os << ind2 << "}," << std::endl
+          << ind2 << "\"threads\": [" << std::endl;
+
+      {
+        TIndent ind3(ind2);
+        size_t i = 0;
+
+        for (const auto &item : thread_cpu) {
+          os << ind3 << "{" << std::endl;
+
+          {
+            TIndent ind4(ind3);
+            os << ind4 << "\"tid\": " << item.first << "," << std::endl
+                << ind4 << "\"role\": \"" << item.second.Name << "\","
+                << std::endl
+                << ind4 << "\"user_sec\": " << item.second.UserSeconds << ","
+                << std::endl
+                << ind4 << "\"system_sec\": " << item.second.SystemSeconds
+                << std::endl;
+          }
+
+          os << ind3 << "}" << ((++i < thread_cpu.size()) ? "," : "")
+              << std::endl;
+        }
+      }
+
+      os << ind2 << "]" << std::endl;
+    }
+
+    os << ind1 << "}" << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+static int dory_bench_main(int argc, char *argv[]) {
+  TBenchConfig config(argc, argv);
+  SetThreadName(MAIN_THREAD_NAME);
+
+  /* Stream clients get EPIPE rather than a signal if Dory drops them. */
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<std::string> topics;
+
+  for (size_t i = 0; i < config.Topics; ++i) {
+    topics.push_back("bench_topic_" + boost::lexical_cast<std::string>(i));
+  }
+
+  /* Start the mock Kafka cluster.  A high quiet level keeps it from writing
+     a line of output for every message set it receives. */
+  TTmpFile kafka_setup_file;
+  kafka_setup_file.SetDeleteOnDestroy(true);
+  WriteFile(kafka_setup_file, CreateKafkaSetup(config, topics));
+  TTmpDir kafka_output_dir("/tmp/dory_tmp.XXXXXX", true);
+  std::vector<const char *> kafka_args;
+  kafka_args.push_back("mock_kafka_server");
+  kafka_args.push_back("--output_dir");
+  kafka_args.push_back(kafka_output_dir.GetName());
+  kafka_args.push_back("--setup_file");
+  kafka_args.push_back(kafka_setup_file.GetName());
+  kafka_args.push_back("--quiet_level");
+  kafka_args.push_back("3");
+
+  std::string sink_sample_str =
+      boost::lexical_cast<std::string>(config.MockSinkSample);
+
+  if (config.MockSink) {
+    kafka_args.push_back("--sink");
+    kafka_args.push_back("--sink_sample");
+    kafka_args.push_back(sink_sample_str.c_str());
+  }
+
+  if (config.LogEcho) {
+    kafka_args.push_back("--log_echo");
+  }
+
+  kafka_args.push_back(nullptr);
+  MockKafkaServer::TConfig kafka_config(kafka_args.size() - 1,
+      const_cast<char **>(&kafka_args[0]));
+  MockKafkaServer::TMainThread mock_kafka(kafka_config);
+  SetThreadName(MOCK_KAFKA_THREAD_NAME);
+  mock_kafka.Start();
+  SetThreadName(MAIN_THREAD_NAME);
+
+  if (!mock_kafka.GetInitWaitFd().IsReadable(30000)) {
+    std::cerr << "Mock Kafka server failed to initialize" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Start consuming request info right away, since the mock Kafka server
+     queues info for every request it handles. */
+  TLatencyCollector collector(mock_kafka);
+  collector.Start();
+
+  /* Write a Dory config file and start Dory. */
+  TTmpFile dory_conf_file;
+  dory_conf_file.SetDeleteOnDestroy(true);
+  WriteFile(dory_conf_file,
+      CreateDoryConf(config, mock_kafka.VirtualPortToPhys(10000)));
+  TTmpFileName dg_socket_name;
+  TTmpFileName stream_socket_name;
+  std::string msg_buffer_max_str =
+      boost::lexical_cast<std::string>(config.MsgBufferMax);
+  std::vector<const char *> dory_args;
+  dory_args.push_back("dory");
+  dory_args.push_back("--config_path");
+  dory_args.push_back(dory_conf_file.GetName());
+  dory_args.push_back("--msg_buffer_max");
+  dory_args.push_back(msg_buffer_max_str.c_str());
+
+  switch (config.InputType) {
+    case TBenchConfig::TInputType::UnixDg: {
+      dory_args.push_back("--receive_socket_name");
+      dory_args.push_back(dg_socket_name);
+      break;
+    }
+    case TBenchConfig::TInputType::UnixStream: {
+      dory_args.push_back("--receive_stream_socket_name");
+      dory_args.push_back(stream_socket_name);
+      break;
+    }
+    case TBenchConfig::TInputType::Tcp: {
+      dory_args.push_back("--input_port");
+      dory_args.push_back("0");  // 0 means "request ephemeral port"
+      break;
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  dory_args.push_back("--client_id");
+  dory_args.push_back("dory_bench");
+  dory_args.push_back("--status_loopback_only");
+  dory_args.push_back("--log_level");
+  dory_args.push_back("LOG_NOTICE");
+
+  if (config.LogEcho) {
+    dory_args.push_back("--log_echo");
+  }
+
+  dory_args.push_back(nullptr);
+  TDoryXmlInit xml_init;
+  xml_init.Init();
+  TOpt<TDoryServer::TServerConfig> dory_config;
+  bool large_sendbuf_required = false;
+  TOpt<std::string> opt_err_msg = HandleXmlErrors(
+      [&]() -> void {
+        dory_config.MakeKnown(TDoryServer::CreateConfig(
+            dory_args.size() - 1, const_cast<char **>(&dory_args[0]),
+            large_sendbuf_required, true, true));
+      }
+  );
+
+  if (opt_err_msg.IsKnown()) {
+    std::cerr << *opt_err_msg << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const Dory::TConfig &cmd_line_config = dory_config->GetCmdLineConfig();
+  InitSyslog(dory_args[0], cmd_line_config.LogLevel, cmd_line_config.LogEcho);
+  TDoryServer dory(std::move(*dory_config));
+  dory_config.Reset();
+  int dory_result = EXIT_FAILURE;
+  std::thread dory_thread(
+      [&]() -> void {
+        SetThreadName(DORY_THREAD_NAME);
+
+        try {
+          dory.BindStatusSocket(true);
+          dory_result = dory.Run();
+        } catch (const std::exception &x) {
+          syslog(LOG_ERR, "Dory server error: %s", x.what());
+        }
+      }
+  );
+
+  bool dory_started = dory.GetInitWaitFd().IsReadable(30000);
+  std::vector<std::unique_ptr<TLoadGenerator>> clients;
+  TOpt<TSnapshot> start, finish;
+
+  if (dory_started) {
+    for (size_t i = 0; i < config.Threads; ++i) {
+      clients.emplace_back(new TLoadGenerator(config, i, topics,
+          CreateSender(config, dg_socket_name, stream_socket_name,
+              dory.GetInputPort())));
+    }
+
+    for (auto &client : clients) {
+      client->Start();
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.Warmup));
+    start.MakeKnown(TakeSnapshot(clients, collector, mock_kafka,
+        config.MockSink, dory));
+    collector.SetRecording(true);
+    std::this_thread::sleep_for(std::chrono::seconds(config.Duration));
+    collector.SetRecording(false);
+    finish.MakeKnown(TakeSnapshot(clients, collector, mock_kafka,
+        config.MockSink, dory));
+
+    for (auto &client : clients) {
+      client->StopAndJoin();
+    }
+  } else {
+    std::cerr << "Dory server failed to initialize" << std::endl;
+  }
+
+  TAnomalyTracker::TInfo anomalies;
+  dory.GetAnomalyTracker().GetInfo(anomalies);
+  dory.RequestShutdown();
+  dory_thread.join();
+  collector.StopAndJoin();
+  mock_kafka.RequestShutdown();
+  mock_kafka.Join();
+
+  if (!dory_started) {
+    return EXIT_FAILURE;
+  }
+
+  TLatencyCollector::TLatencySummary latency = collector.GetSummary();
+
+  if (config.Output.empty()) {
+    WriteResults(std::cout, config, *start, *finish, latency, anomalies);
+  } else {
+    std::ofstream ofs(config.Output);
+    WriteResults(ofs, config, *start, *finish, latency, anomalies);
+
+    if (!ofs) {
+      std::cerr << "Failed to write " << config.Output << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return (dory_result == EXIT_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+  int ret = EXIT_SUCCESS;
+
+  try {
+    ret = dory_bench_main(argc, argv);
+  } catch (const TArgParseError &x) {
+    /* Error parsing command line arguments. */
+    std::cerr << x.what() << std::endl;
+    ret = EXIT_FAILURE;
+  } catch (const std::exception &x) {
+    std::cerr << "Error: " << x.what() << std::endl;
+    ret = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "Unknown error" << std::endl;
+    ret = EXIT_FAILURE;
+  }
+
+  return ret;
+}
@@ -0,0 +1,151 @@
+/* <dory/dory_bench/latency_collector.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/dory_bench/latency_collector.h>.
+ */
+
+#include <dory/dory_bench/latency_collector.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <list>
+#include <string>
+
+#include <syslog.h>
+
+#include <dory/dory_bench/load_generator.h>
+#include <dory/dory_bench/thread_cpu.h>
+#include <dory/mock_kafka_server/received_request_tracker.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::DoryBench;
+using namespace Dory::MockKafkaServer;
+
+TLatencyCollector::TLatencyCollector(TMainThread &mock_kafka)
+    : MockKafka(mock_kafka),
+      StopRequested(false),
+      Recording(false),
+      MsgsReceived(0) {
+}
+
+TLatencyCollector::~TLatencyCollector() noexcept {
+  if (Thread.joinable()) {
+    StopRequested = true;
+    Thread.join();
+  }
+}
+
+void TLatencyCollector::Start() {
+  assert(this);
+  assert(!Thread.joinable());
+  Thread = std::thread(&TLatencyCollector::Run, this);
+}
+
+void TLatencyCollector::StopAndJoin() {
+  assert(this);
+  StopRequested = true;
+
+  if (Thread.joinable()) {
+    Thread.join();
+  }
+}
+
+static uint64_t Percentile(const std::vector<uint64_t> &sorted,
+    double fraction) {
+  assert(!sorted.empty());
+  size_t index = static_cast<size_t>(
+      fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+TLatencyCollector::TLatencySummary TLatencyCollector::GetSummary() {
+  assert(this);
+  std::vector<uint64_t> sorted;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    sorted = Samples;
+  }
+
+  TLatencySummary result;
+
+  if (sorted.empty()) {
+    return result;
+  }
+
+  std::sort(sorted.begin(), sorted.end());
+  result.Samples = sorted.size();
+  result.Min = sorted.front();
+  result.P50 = Percentile(sorted, 0.5);
+  result.P90 = Percentile(sorted, 0.9);
+  result.P99 = Percentile(sorted, 0.99);
+  result.P999 = Percentile(sorted, 0.999);
+  result.Max = sorted.back();
+  return result;
+}
+
+void TLatencyCollector::Run() {
+  assert(this);
+  SetThreadName("bench_latency");
+  std::list<TReceivedRequestTracker::TRequestInfo> info_list;
+  std::vector<uint64_t> batch;
+
+  try {
+    while (!StopRequested) {
+      /* Time out periodically to check for a stop request. */
+      if (!MockKafka.GetHandledRequestsAvailableFd().IsReadable(100)) {
+        continue;
+      }
+
+      MockKafka.NonblockingGetHandledRequests(info_list);
+      uint64_t now = GetValueTimestamp();
+      bool recording = Recording;
+
+      for (const auto &info : info_list) {
+        if (info.ProduceRequestInfo.IsUnknown()) {
+          continue;
+        }
+
+        const auto &produce_info = *info.ProduceRequestInfo;
+        MsgsReceived += produce_info.MsgCount;
+        const std::string &value = produce_info.FirstMsgValue;
+
+        if (recording && (value.size() >= VALUE_TIMESTAMP_SIZE)) {
+          uint64_t ts = 0;
+          std::memcpy(&ts, value.data(), sizeof(ts));
+
+          if (ts <= now) {
+            batch.push_back((now - ts) / 1000);
+          }
+        }
+      }
+
+      info_list.clear();
+
+      if (!batch.empty()) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Samples.insert(Samples.end(), batch.begin(), batch.end());
+        batch.clear();
+      }
+    }
+  } catch (const std::exception &x) {
+    syslog(LOG_ERR, "Benchmark latency collector failed: %s", x.what());
+  }
+}
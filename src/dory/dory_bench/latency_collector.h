@@ -0,0 +1,115 @@
+/* <dory/dory_bench/latency_collector.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Thread that consumes request info from the mock Kafka server and records
+   end to end latencies.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <dory/mock_kafka_server/main_thread.h>
+
+namespace Dory {
+
+  namespace DoryBench {
+
+    class TLatencyCollector final {
+      NO_COPY_SEMANTICS(TLatencyCollector);
+
+      public:
+      struct TLatencySummary {
+        size_t Samples;
+
+        /* All values below are in microseconds. */
+        uint64_t Min;
+
+        uint64_t P50;
+
+        uint64_t P90;
+
+        uint64_t P99;
+
+        uint64_t P999;
+
+        uint64_t Max;
+
+        TLatencySummary()
+            : Samples(0),
+              Min(0),
+              P50(0),
+              P90(0),
+              P99(0),
+              P999(0),
+              Max(0) {
+        }
+      };  // TLatencySummary
+
+      explicit TLatencyCollector(MockKafkaServer::TMainThread &mock_kafka);
+
+      ~TLatencyCollector() noexcept;
+
+      void Start();
+
+      void StopAndJoin();
+
+      /* Latency samples are recorded only while recording is enabled. */
+      void SetRecording(bool recording) {
+        assert(this);
+        Recording = recording;
+      }
+
+      /* Total messages received by the mock Kafka server. */
+      uint64_t GetMsgsReceived() const {
+        assert(this);
+        return MsgsReceived;
+      }
+
+      TLatencySummary GetSummary();
+
+      private:
+      void Run();
+
+      MockKafkaServer::TMainThread &MockKafka;
+
+      std::atomic<bool> StopRequested;
+
+      std::atomic<bool> Recording;
+
+      std::atomic<uint64_t> MsgsReceived;
+
+      std::mutex Mutex;
+
+      /* One sample per message set: the latency of the set's first
+         message, in microseconds.  Protected by 'Mutex'. */
+      std::vector<uint64_t> Samples;
+
+      std::thread Thread;
+    };  // TLatencyCollector
+
+  }  // DoryBench
+
+}  // Dory
@@ -0,0 +1,205 @@
+/* <dory/dory_bench/load_generator.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/dory_bench/load_generator.h>.
+ */
+
+#include <dory/dory_bench/load_generator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <syslog.h>
+
+#include <base/no_default_case.h>
+#include <base/time_util.h>
+#include <dory/client/dory_client.h>
+#include <dory/dory_bench/thread_cpu.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Client;
+using namespace Dory::DoryBench;
+
+uint64_t Dory::DoryBench::GetValueTimestamp() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/* xorshift64*: cheap enough not to show up in the benchmark results. */
+static uint64_t NextRandom(uint64_t &state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+TLoadGenerator::TLoadGenerator(const TBenchConfig &config, size_t index,
+    const std::vector<std::string> &topics,
+    std::unique_ptr<TClientSenderBase> &&sender)
+    : Config(config),
+      Index(index),
+      Topics(topics),
+      Sender(std::move(sender)),
+      RandState(0x9e3779b97f4a7c15ULL * (index + 1)),
+      Key(config.KeySize, 'k'),
+      StopRequested(false),
+      MsgsSent(0),
+      BytesSent(0),
+      SendErrors(0) {
+}
+
+TLoadGenerator::~TLoadGenerator() noexcept {
+  if (Thread.joinable()) {
+    StopRequested = true;
+    Thread.join();
+  }
+}
+
+void TLoadGenerator::Start() {
+  assert(this);
+  assert(!Thread.joinable());
+  Thread = std::thread(&TLoadGenerator::Run, this);
+}
+
+void TLoadGenerator::StopAndJoin() {
+  assert(this);
+  StopRequested = true;
+
+  if (Thread.joinable()) {
+    Thread.join();
+  }
+}
+
+size_t TLoadGenerator::ChooseValueSize() {
+  assert(this);
+
+  switch (Config.SizeDist) {
+    case TBenchConfig::TSizeDist::Fixed: {
+      break;
+    }
+    case TBenchConfig::TSizeDist::Uniform: {
+      return Config.ValueSize + (NextRandom(RandState) %
+          (Config.ValueSizeMax - Config.ValueSize + 1));
+    }
+    case TBenchConfig::TSizeDist::Exponential: {
+      /* Uniform in (0, 1], so the log is finite. */
+      double u = (static_cast<double>(NextRandom(RandState) >> 11) + 1.0) /
+          9007199254740992.0;
+      double size = -std::log(u) * static_cast<double>(Config.ValueSize);
+      return std::max(VALUE_TIMESTAMP_SIZE,
+          std::min(Config.ValueSizeMax, static_cast<size_t>(size)));
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return Config.ValueSize;
+}
+
+void TLoadGenerator::BuildMsg(const std::string &topic) {
+  assert(this);
+  Value.resize(ChooseValueSize(), 'v');
+  uint64_t ts = GetValueTimestamp();
+  std::memcpy(&Value[0], &ts, sizeof(ts));
+  const char *key = Key.empty() ? nullptr :
+      reinterpret_cast<const char *>(&Key[0]);
+  size_t msg_size = 0;
+  int ret = 0;
+
+  if (Config.PartitionKey) {
+    ret = dory_find_partition_key_msg_size(topic.size(), Key.size(),
+        Value.size(), &msg_size);
+  } else {
+    ret = dory_find_any_partition_msg_size(topic.size(), Key.size(),
+        Value.size(), &msg_size);
+  }
+
+  if (ret != DORY_OK) {
+    throw std::runtime_error("Benchmark message is too large");
+  }
+
+  Buf.resize(msg_size);
+  uint64_t timestamp = GetEpochMilliseconds();
+
+  if (Config.PartitionKey) {
+    ret = dory_write_partition_key_msg(&Buf[0], Buf.size(),
+        static_cast<int32_t>(NextRandom(RandState) >> 33), topic.c_str(),
+        static_cast<int64_t>(timestamp), key, Key.size(), &Value[0],
+        Value.size());
+  } else {
+    ret = dory_write_any_partition_msg(&Buf[0], Buf.size(), topic.c_str(),
+        static_cast<int64_t>(timestamp), key, Key.size(), &Value[0],
+        Value.size());
+  }
+
+  if (ret != DORY_OK) {
+    throw std::runtime_error("Failed to write benchmark message");
+  }
+}
+
+void TLoadGenerator::Run() {
+  assert(this);
+  SetThreadName("bench_client");
+  std::chrono::steady_clock::duration interval(0);
+
+  if (Config.Rate) {
+    interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / static_cast<double>(Config.Rate)));
+  }
+
+  try {
+    Sender->PrepareToSend();
+    auto next_send = std::chrono::steady_clock::now();
+
+    for (size_t i = Index; !StopRequested; ++i) {
+      if (Config.Rate) {
+        std::this_thread::sleep_until(next_send);
+        next_send += interval;
+      }
+
+      BuildMsg(Topics[i % Topics.size()]);
+
+      try {
+        Sender->Send(&Buf[0], Buf.size());
+      } catch (const std::system_error &) {
+        ++SendErrors;
+
+        /* Reconnect on the next message.  Dory may have closed a stream
+           connection, or a datagram may have been too large. */
+        Sender->Reset();
+        Sender->PrepareToSend();
+        continue;
+      }
+
+      ++MsgsSent;
+      BytesSent += Buf.size();
+    }
+  } catch (const std::exception &x) {
+    syslog(LOG_ERR, "Benchmark client thread %lu failed: %s",
+        static_cast<unsigned long>(Index), x.what());
+  }
+
+  Sender->Reset();
+}
@@ -0,0 +1,120 @@
+/* <dory/dory_bench/load_generator.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Client thread that sends benchmark messages to Dory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <dory/client/client_sender_base.h>
+#include <dory/dory_bench/bench_config.h>
+
+namespace Dory {
+
+  namespace DoryBench {
+
+    /* Each message value sent by a load generator begins with this many bytes
+       holding the value of std::chrono::steady_clock::now() in nanoseconds
+       (native byte order) at the time the message was created.  The latency
+       collector reads it back from the mock Kafka server. */
+    const size_t VALUE_TIMESTAMP_SIZE = 8;
+
+    /* Get the current time in the format stored in message values. */
+    uint64_t GetValueTimestamp();
+
+    class TLoadGenerator final {
+      NO_COPY_SEMANTICS(TLoadGenerator);
+
+      public:
+      /* Messages are sent round-robin to the topics in 'topics'.  'index'
+         identifies the generator and seeds its random number generator. */
+      TLoadGenerator(const TBenchConfig &config, size_t index,
+          const std::vector<std::string> &topics,
+          std::unique_ptr<Client::TClientSenderBase> &&sender);
+
+      ~TLoadGenerator() noexcept;
+
+      void Start();
+
+      /* Tell the thread to stop sending and wait for it to finish. */
+      void StopAndJoin();
+
+      uint64_t GetMsgsSent() const {
+        assert(this);
+        return MsgsSent;
+      }
+
+      uint64_t GetBytesSent() const {
+        assert(this);
+        return BytesSent;
+      }
+
+      uint64_t GetSendErrors() const {
+        assert(this);
+        return SendErrors;
+      }
+
+      private:
+      size_t ChooseValueSize();
+
+      /* Write a message to 'Buf' for the given topic. */
+      void BuildMsg(const std::string &topic);
+
+      void Run();
+
+      const TBenchConfig &Config;
+
+      const size_t Index;
+
+      const std::vector<std::string> &Topics;
+
+      std::unique_ptr<Client::TClientSenderBase> Sender;
+
+      /* Random state for value sizes and partition keys. */
+      uint64_t RandState;
+
+      std::vector<uint8_t> Key;
+
+      std::vector<uint8_t> Value;
+
+      std::vector<uint8_t> Buf;
+
+      std::atomic<bool> StopRequested;
+
+      std::atomic<uint64_t> MsgsSent;
+
+      std::atomic<uint64_t> BytesSent;
+
+      std::atomic<uint64_t> SendErrors;
+
+      std::thread Thread;
+    };  // TLoadGenerator
+
+  }  // DoryBench
+
+}  // Dory
@@ -0,0 +1,113 @@
+/* <dory/dory_bench/thread_cpu.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/dory_bench/thread_cpu.h>.
+ */
+
+#include <dory/dory_bench/thread_cpu.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace Dory;
+using namespace Dory::DoryBench;
+
+/* Parse the contents of /proc/self/task/TID/stat into 'result'.  Return false
+   on failure. */
+static bool ParseStat(const std::string &stat, TThreadCpu &result) {
+  /* The second field is the thread name in parentheses.  Since the name may
+     contain spaces or parentheses, find the last ')' and parse the remaining
+     fields from there. */
+  std::string::size_type open = stat.find('(');
+  std::string::size_type close = stat.rfind(')');
+
+  if ((open == std::string::npos) || (close == std::string::npos) ||
+      (close < open)) {
+    return false;
+  }
+
+  result.Name.assign(stat, open + 1, close - open - 1);
+  std::istringstream is(stat.substr(close + 1));
+  std::string field;
+
+  /* Skip fields 3 (state) through 13 (cmajflt).  Fields 14 and 15 are utime
+     and stime, in clock ticks. */
+  for (size_t i = 3; i < 14; ++i) {
+    if (!(is >> field)) {
+      return false;
+    }
+  }
+
+  unsigned long long utime = 0, stime = 0;
+
+  if (!(is >> utime >> stime)) {
+    return false;
+  }
+
+  static const double ticks_per_second =
+      static_cast<double>(sysconf(_SC_CLK_TCK));
+  result.UserSeconds = static_cast<double>(utime) / ticks_per_second;
+  result.SystemSeconds = static_cast<double>(stime) / ticks_per_second;
+  return true;
+}
+
+void Dory::DoryBench::SetThreadName(const char *name) {
+  pthread_setname_np(pthread_self(), name);
+}
+
+std::map<pid_t, TThreadCpu> Dory::DoryBench::GetThreadCpu() {
+  std::map<pid_t, TThreadCpu> result;
+  DIR *dir = opendir("/proc/self/task");
+
+  if (dir == nullptr) {
+    return result;
+  }
+
+  for (const dirent *entry = readdir(dir);
+       entry != nullptr;
+       entry = readdir(dir)) {
+    char *end = nullptr;
+    long tid = std::strtol(entry->d_name, &end, 10);
+
+    if ((end == entry->d_name) || (*end != '\0')) {
+      continue;  // "." or ".."
+    }
+
+    std::ifstream ifs(std::string("/proc/self/task/") + entry->d_name +
+        "/stat");
+    std::string stat;
+
+    if (!std::getline(ifs, stat)) {
+      continue;  // thread exited
+    }
+
+    TThreadCpu cpu;
+
+    if (ParseStat(stat, cpu)) {
+      result[static_cast<pid_t>(tid)] = cpu;
+    }
+  }
+
+  closedir(dir);
+  return result;
+}
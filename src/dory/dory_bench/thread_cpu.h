@@ -0,0 +1,60 @@
+/* <dory/dory_bench/thread_cpu.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Utility for reading per-thread CPU usage of the current process from
+   /proc.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <sys/types.h>
+
+namespace Dory {
+
+  namespace DoryBench {
+
+    struct TThreadCpu {
+      /* Thread name as reported by the kernel (truncated to 15 chars). */
+      std::string Name;
+
+      /* User and system CPU time consumed so far, in seconds. */
+      double UserSeconds;
+
+      double SystemSeconds;
+
+      TThreadCpu()
+          : UserSeconds(0),
+            SystemSeconds(0) {
+      }
+    };  // TThreadCpu
+
+    /* Set the name of the calling thread, which GetThreadCpu() reports.  The
+       kernel truncates names to 15 chars. */
+    void SetThreadName(const char *name);
+
+    /* Return CPU usage for each live thread of the current process, keyed by
+       thread ID.  Threads that exit while the information is gathered are
+       silently omitted. */
+    std::map<pid_t, TThreadCpu> GetThreadCpu();
+
+  }  // DoryBench
+
+}  // Dory
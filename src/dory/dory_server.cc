@@ -29,6 +29,8 @@
 #include <memory>
 #include <set>
 #include <stdexcept>
+#include <system_error>
+#include <utility>
 
 #include <arpa/inet.h>
 #include <poll.h>
@@ -48,6 +50,7 @@
 #include <dory/kafka_proto/metadata/version_util.h>
 #include <dory/kafka_proto/produce/version_util.h>
 #include <dory/msg.h>
+#include <dory/util/handle_xml_errors.h>
 #include <dory/util/init_notifier.h>
 #include <dory/util/misc_util.h>
 #include <dory/util/time_util.h>
@@ -72,6 +75,9 @@ using namespace Signal;
 using namespace Socket;
 using namespace Thread;
 
+SERVER_COUNTER(ConfReloadFail);
+SERVER_COUNTER(ConfReloadSuccess);
+SERVER_COUNTER(GotReloadSignal);
 SERVER_COUNTER(GotShutdownSignal);
 SERVER_COUNTER(StreamClientWorkerStdException);
 SERVER_COUNTER(StreamClientWorkerUnknownException);
@@ -119,7 +125,8 @@ static bool CheckUnixDgSize(const TConfig &cfg) {
 
 TDoryServer::TSignalHandlerInstaller::TSignalHandlerInstaller()
     : SigintInstaller(SIGINT, &HandleShutdownSignal),
-      SigtermInstaller(SIGTERM, &HandleShutdownSignal) {
+      SigtermInstaller(SIGTERM, &HandleShutdownSignal),
+      SighupInstaller(SIGHUP, &HandleReloadSignal) {
 }
 
 TDoryServer::TServerConfig
@@ -159,6 +166,37 @@ TDoryServer::CreateConfig(int argc, char **argv, bool &large_sendbuf_required,
     THROW_ERROR(TBadDiscardLogMaxFileSize);
   }
 
+  if (!cfg->SpoolDir.empty()) {
+    if (cfg->SpoolDir[0] != '/') {
+      THROW_ERROR(TBadSpoolDir);
+    }
+
+    if ((cfg->SpoolSegmentSize == 0) ||
+        (cfg->SpoolSegmentSize > cfg->SpoolMaxSize)) {
+      THROW_ERROR(TBadSpoolSize);
+    }
+  }
+
+  if (!cfg->JournalDir.empty()) {
+    if (cfg->JournalDir[0] != '/') {
+      THROW_ERROR(TBadJournalDir);
+    }
+
+    if ((cfg->JournalSegmentSize == 0) || (cfg->JournalFlushInterval == 0) ||
+        (cfg->JournalFlushInterval >
+            static_cast<size_t>(std::numeric_limits<int>::max()))) {
+      THROW_ERROR(TBadJournalConfig);
+    }
+  }
+
+  if (!cfg->HandoffSocket.empty() && !cfg->JournalDir.empty()) {
+    THROW_ERROR(TBadHandoffConfig);
+  }
+
+  if (!cfg->HandoffSocket.empty() && !cfg->ShmSocketName.empty()) {
+    THROW_ERROR(TShmHandoffUnsupported);
+  }
+
   /* Verify that Dory supports any requested API version(s).  Once Dory has
      started, cases where the brokers don't support a requested API version
      will be handled. */
@@ -173,6 +211,18 @@ TDoryServer::CreateConfig(int argc, char **argv, bool &large_sendbuf_required,
     THROW_ERROR(TUnsupportedProduceApiVersion);
   }
 
+  if (cfg->IdempotentProducer) {
+    if (!cfg->ProduceApiVersion.IsKnown() ||
+        !std::unique_ptr<TProduceProtocol>(ChooseProduceProto(
+            *cfg->ProduceApiVersion))->SupportsIdempotence()) {
+      THROW_ERROR(TIdempotentProducerNeedsProduceApi);
+    }
+
+    if (cfg->RequiredAcks != -1) {
+      THROW_ERROR(TIdempotentProducerNeedsAllAcks);
+    }
+  }
+
   Conf::TConf conf = Conf::TConf::TBuilder(enable_lz4).Build(
       cfg->ConfigPath.c_str());
   TGlobalBatchConfig batch_config =
@@ -190,7 +240,7 @@ TDoryServer::CreateConfig(int argc, char **argv, bool &large_sendbuf_required,
   std::srand(static_cast<unsigned>(t.tv_sec ^ t.tv_nsec));
 
   return TServerConfig(std::move(cfg), std::move(conf),
-      std::move(batch_config), pool_block_size);
+      std::move(batch_config), enable_lz4, pool_block_size);
 }
 
 void TDoryServer::HandleShutdownSignal(int /*signum*/) {
@@ -202,6 +252,15 @@ void TDoryServer::HandleShutdownSignal(int /*signum*/) {
   }
 }
 
+void TDoryServer::HandleReloadSignal(int /*signum*/) {
+  std::lock_guard<std::mutex> lock(ServerListMutex);
+
+  for (TDoryServer *server: ServerList) {
+    assert(server);
+    server->RequestConfReload();
+  }
+}
+
 static void WorkerPoolFatalErrorHandler(const char *msg) noexcept {
   syslog(LOG_ERR, "Fatal worker pool error: %s", msg);
   _exit(1);
@@ -225,33 +284,78 @@ ComputeBlockCount(size_t max_buffer_kb, size_t block_size) {
 TDoryServer::TDoryServer(TServerConfig &&config)
     : Config(std::move(config.Config)),
       Conf(std::move(config.Conf)),
+      EnableLz4(config.EnableLz4),
       PoolBlockSize(config.PoolBlockSize),
       Started(false),
-      Pool(PoolBlockSize,
-           ComputeBlockCount(Config->MsgBufferMax, PoolBlockSize),
-           Capped::TPool::TSync::Mutexed),
       AnomalyTracker(DiscardFileLogger, Config->DiscardReportInterval,
                      Config->DiscardReportBadMsgPrefixSize),
+      CompressionStats(Config->CompressionProbeInterval),
+      IdempotentProducer(Config->IdempotentProducer, AnomalyTracker),
       StatusPort(0),
       DebugSetup(Config->DebugDir.c_str(), Config->MsgDebugTimeLimit,
                  Config->MsgDebugByteLimit),
-      Dispatcher(*Config, Conf.GetCompressionConf(), MsgStateTracker,
-          AnomalyTracker, config.BatchConfig, DebugSetup),
+      Dispatcher(*Config, Conf.GetCompressionConf(),
+          Conf.GetBrokerConnectionsConf(), MsgStateTracker,
+          AnomalyTracker, CompressionStats, LaneStats, AdaptiveBatchStats,
+          IdempotentProducer, config.BatchConfig, DebugSetup),
       RouterThread(*Config, Conf, AnomalyTracker, MsgStateTracker,
-          config.BatchConfig, DebugSetup, Dispatcher),
+          config.BatchConfig, AdaptiveBatchStats, IdempotentProducer,
+          DebugSetup, Dispatcher, ConfGeneration),
       MetadataTimestamp(RouterThread.GetMetadataTimestamp()),
+      HandingOff(false),
       ShutdownRequested(ATOMIC_FLAG_INIT) {
+  Capped::TPool::TSync pool_sync = Config->PoolThreadCache ?
+      Capped::TPool::TSync::ThreadCached : Capped::TPool::TSync::Mutexed;
+
+  if (Config->PoolSizeClasses) {
+    Pool.MakeKnown(POOL_MIN_CHUNK_SIZE, POOL_MAX_CHUNK_SIZE,
+        std::max<size_t>(POOL_MAX_CHUNK_SIZE, 1024 * Config->MsgBufferMax),
+        pool_sync);
+  } else {
+    Pool.MakeKnown(PoolBlockSize,
+        ComputeBlockCount(Config->MsgBufferMax, PoolBlockSize), pool_sync);
+  }
+
+  /* The quota object also enforces the low priority limit, so create it if
+     either feature is configured. */
+  if (Conf.GetTopicQuotaConf().IsEnabled() ||
+      Conf.GetTopicPriorityConf().GetLowPriorityMaxBytes().IsKnown()) {
+    TopicQuota.MakeKnown(Conf.GetTopicQuotaConf(),
+        Conf.GetTopicPriorityConf());
+  }
+
   if (!Config->ReceiveStreamSocketName.empty() ||
       Config->InputPort.IsKnown()) {
     /* Create thread pool if UNIX stream or TCP input is enabled. */
     StreamClientWorkerPool.MakeKnown(WorkerPoolFatalErrorHandler);
   }
 
-  if (!Config->ReceiveSocketName.empty()) {
-    UnixDgInputAgent.MakeKnown(*Config, Pool, MsgStateTracker, AnomalyTracker,
+  if (!Config->SpoolDir.empty()) {
+    /* Input threads never wait for the spool thread to write to disk, so
+       allow a few maximum size messages to queue up in memory. */
+    OverflowSpool.MakeKnown(Config->SpoolDir.c_str(),
+        1024 * Config->SpoolMaxSize, 1024 * Config->SpoolSegmentSize,
+        std::max<size_t>(4 * 1024 * 1024,
+                         2 * Config->MaxStreamInputMsgSize),
+        Config->NoLogDiscard, *Pool, MsgStateTracker, AnomalyTracker,
         RouterThread.GetMsgChannel());
   }
 
+  if (!Config->JournalDir.empty()) {
+    MsgJournal.MakeKnown(Config->JournalDir.c_str(),
+        1024 * Config->JournalSegmentSize, 1024 * Config->JournalMaxSize,
+        Config->JournalFlushInterval, *Pool, MsgStateTracker, AnomalyTracker,
+        RouterThread.GetMsgChannel());
+    MsgStateTracker.SetJournal(MsgJournal.TryGet());
+    RouterThread.SetJournal(MsgJournal.TryGet());
+  }
+
+  if (!Config->ReceiveSocketName.empty()) {
+    UnixDgInputAgent.MakeKnown(*Config, *Pool, MsgStateTracker,
+        AnomalyTracker, RouterThread.GetMsgChannel(), OverflowSpool.TryGet(),
+        TopicQuota.TryGet());
+  }
+
   if (!Config->ReceiveStreamSocketName.empty()) {
     assert(StreamClientWorkerPool.IsKnown());
     UnixStreamInputAgent.MakeKnown(STREAM_BACKLOG,
@@ -269,6 +373,12 @@ TDoryServer::TDoryServer(TServerConfig &&config)
         TcpServerFatalErrorHandler);
   }
 
+  if (!Config->ShmSocketName.empty()) {
+    ShmInputAgent.MakeKnown(*Config, *Pool, MsgStateTracker, AnomalyTracker,
+        RouterThread.GetMsgChannel(), OverflowSpool.TryGet(),
+        TopicQuota.TryGet());
+  }
+
   config.BatchConfig.Clear();
   std::lock_guard<std::mutex> lock(ServerListMutex);
   ServerList.push_front(this);
@@ -277,6 +387,10 @@ TDoryServer::TDoryServer(TServerConfig &&config)
 
 TDoryServer::~TDoryServer() noexcept {
   assert(this);
+
+  /* The journal is destroyed before some objects that may still process
+     messages. */
+  MsgStateTracker.SetJournal(nullptr);
   std::lock_guard<std::mutex> lock(ServerListMutex);
   assert(*MyServerListItem == this);
   ServerList.erase(MyServerListItem);
@@ -301,6 +415,67 @@ void TDoryServer::BindStatusSocket(bool bind_ephemeral) {
   assert(bind_ephemeral || (StatusPort == Config->StatusPort));
 }
 
+bool TDoryServer::RequestHandoff() {
+  assert(this);
+
+  if (Config->HandoffSocket.empty()) {
+    return false;
+  }
+
+  if (!HandoffClient.Connect(Config->HandoffSocket.c_str())) {
+    syslog(LOG_NOTICE, "No old dory process to take over from");
+    return false;
+  }
+
+  syslog(LOG_NOTICE, "Taking over input sockets from old dory process");
+  Handoff::TInputSockets &sockets = HandoffClient.GetSockets();
+
+  /* Only use sockets that match our config.  Until the handoff is confirmed,
+     the old process owns the socket files, so we must leave them alone if we
+     fail to start. */
+  if (UnixDgInputAgent.IsKnown()) {
+    if (sockets.UnixDg.IsOpen() &&
+        (GetSockName(sockets.UnixDg).GetPath() ==
+            Config->ReceiveSocketName)) {
+      UnixDgInputAgent->AdoptSocket(std::move(sockets.UnixDg));
+      UnixDgInputAgent->SetUnlinkOnClose(false);
+    } else {
+      syslog(LOG_WARNING, "Old dory process has no UNIX datagram socket "
+          "matching our config: creating new socket");
+    }
+  }
+
+  if (UnixStreamInputAgent.IsKnown()) {
+    if (sockets.UnixStream.IsOpen() &&
+        (GetSockName(sockets.UnixStream).GetPath() ==
+            Config->ReceiveStreamSocketName)) {
+      UnixStreamInputAgent->Adopt(std::move(sockets.UnixStream));
+      UnixStreamInputAgent->SetUnlinkOnClose(false);
+    } else {
+      syslog(LOG_WARNING, "Old dory process has no UNIX stream socket "
+          "matching our config: creating new socket");
+    }
+  }
+
+  if (TcpInputAgent.IsKnown()) {
+    if (sockets.Tcp.IsOpen() &&
+        (GetSockName(sockets.Tcp).GetPort() == *Config->InputPort)) {
+      TcpInputAgent->Adopt(std::move(sockets.Tcp));
+    } else {
+      syslog(LOG_WARNING, "Old dory process has no TCP socket matching our "
+          "config: creating new socket");
+    }
+  }
+
+  /* Don't hold on to sockets we aren't reading from, since clients would
+     get stuck on them. */
+  sockets.UnixDg.Reset();
+  sockets.UnixStream.Reset();
+  sockets.Tcp.Reset();
+  StatusPort = Config->StatusPort;
+  return true;
+}
+
 int TDoryServer::Run() {
   assert(this);
 
@@ -329,29 +504,47 @@ int TDoryServer::Run() {
    */
   TWebInterface web_interface(StatusPort, MsgStateTracker, AnomalyTracker,
       MetadataTimestamp, RouterThread.GetMetadataUpdateRequestSem(),
-      DebugSetup);
+      DebugSetup, *Pool, CompressionStats, ConfReloadRequestSem,
+      ConfGeneration, TopicQuota.TryGet(), LaneStats, AdaptiveBatchStats);
 
   bool no_error = StartMsgHandlingThreads();
 
   /* This starts the input agents and router thread but doesn't wait for the
      router thread to finish initialization. */
   if (no_error) {
-    /* Initialization of all input agents succeeded.  Start the Mongoose HTTP
-       server, which provides Dory's web interface.  It runs in separate
-       threads. */
-    web_interface.StartHttpServer(Config->StatusLoopbackOnly);
+    if (HandoffClient.GetOldServerExitFd().IsOpen()) {
+      /* We are reading from the input sockets, so the old process can stop.
+         The socket files are ours now. */
+      try {
+        HandoffClient.ConfirmReady();
+      } catch (const std::system_error &x) {
+        syslog(LOG_WARNING, "Failed to confirm handoff, old dory process "
+            "may have exited: %s", x.what());
+      }
 
-    /* We can close this now, since Mongoose has the port claimed. */
-    TmpStatusSocket.Reset();
+      if (UnixDgInputAgent.IsKnown()) {
+        UnixDgInputAgent->SetUnlinkOnClose(true);
+      }
+
+      if (UnixStreamInputAgent.IsKnown()) {
+        UnixStreamInputAgent->SetUnlinkOnClose(true);
+      }
 
-    syslog(LOG_NOTICE,
-        "Started web interface, waiting for signals and errors");
+      syslog(LOG_NOTICE, "Handoff confirmed, web interface will start when "
+          "old dory process exits");
+    } else {
+      /* Initialization of all input agents succeeded.  Start the Mongoose
+         HTTP server, which provides Dory's web interface.  It runs in
+         separate threads. */
+      StartWebInterface(web_interface);
+    }
 
+    syslog(LOG_NOTICE, "Waiting for signals and errors");
     init_notifier.Notify();
 
     /* Wait for signals and fatal errors.  Return when it is time for the
        server to shut down. */
-    if (!HandleEvents()) {
+    if (!HandleEvents(web_interface)) {
       no_error = false;
     }
   }
@@ -368,10 +561,38 @@ void TDoryServer::RequestShutdown() {
   }
 }
 
+void TDoryServer::RequestConfReload() {
+  assert(this);
+  GotReloadSignal.Increment();
+  ConfReloadRequestSem.Push();
+}
+
+void TDoryServer::StartWebInterface(TWebInterface &web_interface) {
+  assert(this);
+  web_interface.StartHttpServer(Config->StatusLoopbackOnly);
+
+  /* We can close this now, since Mongoose has the port claimed. */
+  TmpStatusSocket.Reset();
+
+  syslog(LOG_NOTICE, "Started web interface");
+
+  if (!Config->HandoffSocket.empty()) {
+    HandoffServer.MakeKnown(Config->HandoffSocket.c_str(),
+        UnixDgInputAgent.IsKnown() ?
+            int(UnixDgInputAgent->GetSocket()) : -1,
+        UnixStreamInputAgent.IsKnown() ?
+            int(UnixStreamInputAgent->GetListeningSocket()) : -1,
+        TcpInputAgent.IsKnown() ?
+            int(TcpInputAgent->GetListeningSocket()) : -1);
+    HandoffServer->Start();
+  }
+}
+
 TStreamClientHandler *TDoryServer::CreateStreamClientHandler(bool is_tcp) {
   assert(this);
-  return new TStreamClientHandler(is_tcp, *Config, Pool, MsgStateTracker,
-      AnomalyTracker, RouterThread.GetMsgChannel(), *StreamClientWorkerPool);
+  return new TStreamClientHandler(is_tcp, *Config, *Pool, MsgStateTracker,
+      AnomalyTracker, RouterThread.GetMsgChannel(), *StreamClientWorkerPool,
+      OverflowSpool.TryGet(), TopicQuota.TryGet());
 }
 
 bool TDoryServer::StartMsgHandlingThreads() {
@@ -387,6 +608,38 @@ bool TDoryServer::StartMsgHandlingThreads() {
         Config->DiscardLogBadMsgPrefixSize);
   }
 
+  if (MsgJournal.IsKnown()) {
+    /* Start this before the input agents, so messages recovered from a
+       previous run are queued for the router thread ahead of any new input.
+       Recovery stops blocking startup if it runs out of buffer space, since
+       the router thread must then deliver messages before it can continue. */
+    syslog(LOG_NOTICE, "Starting message journal");
+    MsgJournal->Start();
+    std::array<struct pollfd, 2> events;
+    events[0].fd = MsgJournal->GetRecoveryWaitFd();
+    events[0].events = POLLIN;
+    events[0].revents = 0;
+    events[1].fd = MsgJournal->GetShutdownWaitFd();
+    events[1].events = POLLIN;
+    events[1].revents = 0;
+    IfLt0(poll(&events[0], events.size(), -1));
+
+    if (events[1].revents) {
+      syslog(LOG_NOTICE, "Server shutting down due to error in message "
+          "journal recovery");
+      return false;
+    }
+
+    syslog(LOG_NOTICE, "Message journal recovered %lu messages at startup",
+        static_cast<unsigned long>(MsgJournal->GetRecoveredMsgCount()));
+  }
+
+  if (OverflowSpool.IsKnown()) {
+    /* Start this before the input agents, which may hand it messages. */
+    syslog(LOG_NOTICE, "Starting overflow spool");
+    OverflowSpool->Start();
+  }
+
   if (StreamClientWorkerPool.IsKnown()) {
     StreamClientWorkerPool->Start();
   }
@@ -423,6 +676,16 @@ bool TDoryServer::StartMsgHandlingThreads() {
     }
   }
 
+  if (ShmInputAgent.IsKnown()) {
+    syslog(LOG_NOTICE, "Starting shared memory input agent");
+
+    if (!ShmInputAgent->SyncStart()) {
+      syslog(LOG_NOTICE, "Server shutting down due to error starting shared "
+          "memory input agent");
+      return false;
+    }
+  }
+
   /* Wait for the input agents to finish initialization, but don't wait for the
      router thread since Kafka problems can delay its initialization
      indefinitely.  Even while the router thread is still starting, the input
@@ -463,7 +726,7 @@ static void ReportStreamClientWorkerErrors(
   }
 }
 
-bool TDoryServer::HandleEvents() {
+bool TDoryServer::HandleEvents(TWebInterface &web_interface) {
   assert(this);
 
   /* This is for periodically verifying that we are getting queried for discard
@@ -471,7 +734,7 @@ bool TDoryServer::HandleEvents() {
   TTimerFd discard_query_check_timer(
       1000 * (1 + Config->DiscardReportInterval));
 
-  std::array<struct pollfd, 8> events;
+  std::array<struct pollfd, 15> events;
   struct pollfd &discard_query_check = events[0];
   struct pollfd &unix_dg_input_agent_error = events[1];
   struct pollfd &unix_stream_input_agent_error = events[2];
@@ -480,6 +743,13 @@ bool TDoryServer::HandleEvents() {
   struct pollfd &shutdown_request = events[5];
   struct pollfd &worker_pool_worker_error = events[6];
   struct pollfd &worker_pool_fatal_error = events[7];
+  struct pollfd &overflow_spool_error = events[8];
+  struct pollfd &msg_journal_error = events[9];
+  struct pollfd &old_server_exit = events[10];
+  struct pollfd &handoff_done = events[11];
+  struct pollfd &handoff_server_error = events[12];
+  struct pollfd &shm_input_agent_error = events[13];
+  struct pollfd &conf_reload_request = events[14];
   discard_query_check.fd = discard_query_check_timer.GetFd();
   discard_query_check.events = POLLIN;
   unix_dg_input_agent_error.fd = UnixDgInputAgent.IsKnown() ?
@@ -506,6 +776,25 @@ bool TDoryServer::HandleEvents() {
 
   worker_pool_worker_error.events = POLLIN;
   worker_pool_fatal_error.events = POLLIN;
+  overflow_spool_error.fd = OverflowSpool.IsKnown() ?
+      int(OverflowSpool->GetShutdownWaitFd()) : -1;
+  overflow_spool_error.events = POLLIN;
+  msg_journal_error.fd = MsgJournal.IsKnown() ?
+      int(MsgJournal->GetShutdownWaitFd()) : -1;
+  msg_journal_error.events = POLLIN;
+  old_server_exit.fd = HandoffClient.GetOldServerExitFd();
+  old_server_exit.events = POLLIN;
+  handoff_done.fd = HandoffServer.IsKnown() ?
+      int(HandoffServer->GetHandoffDoneFd()) : -1;
+  handoff_done.events = POLLIN;
+  handoff_server_error.fd = HandoffServer.IsKnown() ?
+      int(HandoffServer->GetShutdownWaitFd()) : -1;
+  handoff_server_error.events = POLLIN;
+  shm_input_agent_error.fd = ShmInputAgent.IsKnown() ?
+      int(ShmInputAgent->GetShutdownWaitFd()) : -1;
+  shm_input_agent_error.events = POLLIN;
+  conf_reload_request.fd = ConfReloadRequestSem.GetFd();
+  conf_reload_request.events = POLLIN;
   bool fatal_error = false;
 
   for (; ; ) {
@@ -514,7 +803,7 @@ bool TDoryServer::HandleEvents() {
     }
 
     int ret = ppoll(&events[0], events.size(), nullptr,
-        TSet(TSet::Exclude, { SIGINT, SIGTERM }).Get());
+        TSet(TSet::Exclude, { SIGINT, SIGTERM, SIGHUP }).Get());
     assert(ret);
 
     if ((ret < 0) && (errno != EINTR)) {
@@ -542,6 +831,13 @@ bool TDoryServer::HandleEvents() {
       fatal_error = true;
     }
 
+    if (shm_input_agent_error.revents) {
+      assert(ShmInputAgent.IsKnown());
+      syslog(LOG_ERR, "Main thread detected shared memory input agent "
+          "termination on fatal error");
+      fatal_error = true;
+    }
+
     if (router_thread_error.revents) {
       syslog(LOG_ERR, "Main thread detected router thread termination on "
           "fatal error");
@@ -554,6 +850,20 @@ bool TDoryServer::HandleEvents() {
       fatal_error = true;
     }
 
+    if (overflow_spool_error.revents) {
+      assert(OverflowSpool.IsKnown());
+      syslog(LOG_ERR, "Main thread detected overflow spool termination on "
+          "fatal error");
+      fatal_error = true;
+    }
+
+    if (msg_journal_error.revents) {
+      assert(MsgJournal.IsKnown());
+      syslog(LOG_ERR, "Main thread detected message journal termination on "
+          "fatal error");
+      fatal_error = true;
+    }
+
     if (worker_pool_worker_error.revents) {
       assert(StreamClientWorkerPool.IsKnown());
       ReportStreamClientWorkerErrors(
@@ -573,11 +883,80 @@ bool TDoryServer::HandleEvents() {
       syslog(LOG_NOTICE, "Got shutdown signal while server running");
       break;
     }
+
+    if (conf_reload_request.revents) {
+      ConfReloadRequestSem.Pop();
+      ReloadConf();
+    }
+
+    if (old_server_exit.revents) {
+      /* The old process released the status port and control socket. */
+      syslog(LOG_NOTICE, "Old dory process exited");
+      HandoffClient.Reset();
+      old_server_exit.fd = -1;
+      StartWebInterface(web_interface);
+      handoff_done.fd = HandoffServer.IsKnown() ?
+          int(HandoffServer->GetHandoffDoneFd()) : -1;
+      handoff_server_error.fd = HandoffServer.IsKnown() ?
+          int(HandoffServer->GetShutdownWaitFd()) : -1;
+    }
+
+    if (handoff_server_error.revents) {
+      /* Not fatal, since message handling is unaffected. */
+      syslog(LOG_ERR, "Main thread detected handoff thread termination on "
+          "error: handoff disabled");
+      handoff_server_error.fd = -1;
+      handoff_done.fd = -1;
+    } else if (handoff_done.revents) {
+      syslog(LOG_NOTICE, "New dory process took over input, shutting down");
+      HandingOff = true;
+      break;
+    }
   }
 
   return !fatal_error;
 }
 
+void TDoryServer::ReloadConf() {
+  assert(this);
+  syslog(LOG_NOTICE, "Reloading config file %s", Config->ConfigPath.c_str());
+  TOpt<Conf::TConf> conf;
+  TOpt<TGlobalBatchConfig> batch_config;
+  TOpt<std::string> opt_err_msg;
+
+  /* Any problem with the new config file is reported, and the config file
+     currently in use stays in effect. */
+  try {
+    opt_err_msg = HandleXmlErrors(
+        [&]() -> void {
+          conf.MakeKnown(Conf::TConf::TBuilder(EnableLz4).Build(
+              Config->ConfigPath.c_str()));
+          batch_config.MakeKnown(
+              TBatchConfigBuilder().BuildFromConf(conf->GetBatchConf()));
+          LoadCompressionLibraries(conf->GetCompressionConf());
+        }
+    );
+  } catch (const std::exception &x) {
+    opt_err_msg.MakeKnown(x.what());
+  }
+
+  if (opt_err_msg.IsKnown()) {
+    ConfReloadFail.Increment();
+    ConfGeneration.RecordFailure(*opt_err_msg);
+    syslog(LOG_ERR, "Config file reload failed: %s", opt_err_msg->c_str());
+    return;
+  }
+
+  assert(conf.IsKnown());
+  assert(batch_config.IsKnown());
+  ConfReloadSuccess.Increment();
+  size_t generation = ConfGeneration.RecordLoaded();
+  syslog(LOG_NOTICE, "Loaded config file generation %lu",
+         static_cast<unsigned long>(generation));
+  RouterThread.RequestConfReload(generation, std::move(*conf),
+      std::move(*batch_config));
+}
+
 static void ShutDownInputAgent(Thread::TFdManagedThread &agent,
     const char *agent_name, bool &shutdown_ok) {
   if (agent.IsStarted()) {
@@ -622,6 +1001,11 @@ void TDoryServer::DiscardFinalMsgs(std::list<TMsg::TPtr> &msg_list) {
 
       AnomalyTracker.TrackDiscard(msg,
           TAnomalyTracker::TDiscardReason::ServerShutdown);
+
+      if (MsgJournal.IsKnown()) {
+        MsgJournal->Retain(*msg);
+      }
+
       MsgStateTracker.MsgEnterProcessed(*msg);
     } else {
       assert(false);
@@ -635,11 +1019,33 @@ bool TDoryServer::Shutdown() {
   assert(this);
   bool shutdown_ok = true;
 
+  if (HandoffServer.IsKnown() && HandoffServer->IsStarted()) {
+    HandoffServer->RequestShutdown();
+    HandoffServer->Join();
+  }
+
+  if (HandingOff) {
+    /* The new process is reading from our input sockets, so leave their
+       files alone.  Messages we have already buffered are delivered below as
+       in a normal shutdown. */
+    if (UnixDgInputAgent.IsKnown()) {
+      UnixDgInputAgent->SetUnlinkOnClose(false);
+    }
+
+    if (UnixStreamInputAgent.IsKnown()) {
+      UnixStreamInputAgent->SetUnlinkOnClose(false);
+    }
+  }
+
   /* We could parallelize the shutdown by first calling each agent's
      RequestShutdown() method and then calling each agent's Join() method.
      However, the agents should be very quick to respond so it's not really
      worth the effort. */
 
+  if (ShmInputAgent.IsKnown()) {
+    ShutDownInputAgent(*ShmInputAgent, "shared memory", shutdown_ok);
+  }
+
   if (TcpInputAgent.IsKnown()) {
     ShutDownInputAgent(*TcpInputAgent, "TCP", shutdown_ok);
   }
@@ -659,6 +1065,15 @@ bool TDoryServer::Shutdown() {
         StreamClientWorkerPool->GetAllPendingErrors());
   }
 
+  /* Shut this down after the input agents, which may hand it messages, and
+     before the router thread, which it feeds. */
+  if (OverflowSpool.IsKnown() && OverflowSpool->IsStarted()) {
+    syslog(LOG_NOTICE, "Shutting down overflow spool");
+    OverflowSpool->RequestShutdown();
+    OverflowSpool->Join();
+    syslog(LOG_NOTICE, "Overflow spool terminated");
+  }
+
   /* TODO: Make this more uniform relative to shutdown of input agents. */
   bool router_thread_started = RouterThread.IsStarted();
 
@@ -682,6 +1097,14 @@ bool TDoryServer::Shutdown() {
   assert(!router_thread_started || msg_list.empty());
   DiscardFinalMsgs(msg_list);
 
+  /* Shut this down last, so it records everything discarded above. */
+  if (MsgJournal.IsKnown() && MsgJournal->IsStarted()) {
+    syslog(LOG_NOTICE, "Shutting down message journal");
+    MsgJournal->RequestShutdown();
+    MsgJournal->Join();
+    syslog(LOG_NOTICE, "Message journal terminated");
+  }
+
   syslog(LOG_NOTICE, "Dory shutdown finished");
 
   /* Let the DiscardFileLogger destructor disable discard file logging.  Then
@@ -692,6 +1115,10 @@ bool TDoryServer::Shutdown() {
 
 const int TDoryServer::STREAM_BACKLOG = 16;
 
+const size_t TDoryServer::POOL_MIN_CHUNK_SIZE = 64;
+
+const size_t TDoryServer::POOL_MAX_CHUNK_SIZE = 64 * 1024;
+
 std::mutex TDoryServer::ServerListMutex;
 
 std::list<TDoryServer *> TDoryServer::ServerList;
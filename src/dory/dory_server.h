@@ -38,18 +38,29 @@
 #include <base/thrower.h>
 #include <capped/pool.h>
 #include <dory/anomaly_tracker.h>
+#include <dory/batch/adaptive_batch_stats.h>
 #include <dory/batch/global_batch_config.h>
+#include <dory/compression_stats.h>
 #include <dory/conf/conf.h>
+#include <dory/conf_generation.h>
 #include <dory/config.h>
 #include <dory/debug/debug_setup.h>
 #include <dory/discard_file_logger.h>
+#include <dory/handoff/handoff_client.h>
+#include <dory/handoff/handoff_server.h>
+#include <dory/idempotent_producer.h>
+#include <dory/journal/msg_journal.h>
 #include <dory/unix_dg_input_agent.h>
 #include <dory/metadata_timestamp.h>
 #include <dory/msg_dispatch/kafka_dispatcher.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/priority_lane_stats.h>
 #include <dory/router_thread.h>
+#include <dory/shm/shm_input_agent.h>
+#include <dory/spool/overflow_spool.h>
 #include <dory/stream_client_handler.h>
 #include <dory/stream_client_work_fn.h>
+#include <dory/topic_quota.h>
 #include <server/tcp_ipv4_server.h>
 #include <server/unix_stream_server.h>
 #include <signal/handler_installer.h>
@@ -57,6 +68,8 @@
 
 namespace Dory {
 
+  class TWebInterface;
+
   class TDoryServer final {
     NO_COPY_SEMANTICS(TDoryServer);
 
@@ -97,6 +110,35 @@ namespace Dory {
                  "maximum input message size.  To disable discard logfile "
                  "generation, leave discard_log_path unspecified.");
 
+    DEFINE_ERROR(TBadSpoolDir, std::runtime_error,
+                 "spool_dir must be an absolute path");
+
+    DEFINE_ERROR(TBadSpoolSize, std::runtime_error,
+                 "spool_segment_size must be positive and no larger than "
+                 "spool_max_size");
+
+    DEFINE_ERROR(TBadJournalDir, std::runtime_error,
+                 "journal_dir must be an absolute path");
+
+    DEFINE_ERROR(TBadJournalConfig, std::runtime_error,
+                 "journal_segment_size and journal_flush_interval must be "
+                 "positive");
+
+    DEFINE_ERROR(TBadHandoffConfig, std::runtime_error,
+                 "handoff_socket can't be used with journal_dir, since the "
+                 "old and new processes would share the journal");
+
+    DEFINE_ERROR(TShmHandoffUnsupported, std::runtime_error,
+                 "handoff_socket can't be used with shm_socket_name, since "
+                 "shared memory rings can't be handed to the new process");
+
+    DEFINE_ERROR(TIdempotentProducerNeedsProduceApi, std::runtime_error,
+                 "idempotent_producer requires a produce_api_version that "
+                 "supports idempotence (version 3)");
+
+    DEFINE_ERROR(TIdempotentProducerNeedsAllAcks, std::runtime_error,
+                 "idempotent_producer requires a required_acks value of -1");
+
     class TServerConfig final {
       NO_COPY_SEMANTICS(TServerConfig);
 
@@ -113,10 +155,11 @@ namespace Dory {
       private:
       TServerConfig(std::unique_ptr<const TConfig> &&config,
           Conf::TConf &&conf, Batch::TGlobalBatchConfig &&batch_config,
-          size_t pool_block_size)
+          bool enable_lz4, size_t pool_block_size)
           : Config(std::move(config)),
             Conf(std::move(conf)),
             BatchConfig(std::move(batch_config)),
+            EnableLz4(enable_lz4),
             PoolBlockSize(pool_block_size) {
       }
 
@@ -126,6 +169,8 @@ namespace Dory {
 
       Batch::TGlobalBatchConfig BatchConfig;
 
+      bool EnableLz4;
+
       size_t PoolBlockSize;
 
       friend class TDoryServer;
@@ -143,6 +188,8 @@ namespace Dory {
       Signal::THandlerInstaller SigintInstaller;
 
       Signal::THandlerInstaller SigtermInstaller;
+
+      Signal::THandlerInstaller SighupInstaller;
     };  // TSignalHandlerInstaller
 
     static TServerConfig CreateConfig(int argc, char **argv,
@@ -151,6 +198,8 @@ namespace Dory {
 
     static void HandleShutdownSignal(int signum);
 
+    static void HandleReloadSignal(int signum);
+
     explicit TDoryServer(TServerConfig &&config);
 
     ~TDoryServer() noexcept;
@@ -172,9 +221,21 @@ namespace Dory {
       return AnomalyTracker;
     }
 
+    /* Used for testing. */
+    const TConfGeneration &GetConfGeneration() const {
+      assert(this);
+      return ConfGeneration;
+    }
+
     /* Test code passes true for 'bind_ephemeral'. */
     void BindStatusSocket(bool bind_ephemeral = false);
 
+    /* If handoff_socket is configured and another dory process is listening
+       on it, take over that process's input sockets and return true.  In
+       this case, don't call BindStatusSocket(), since the old process still
+       has the status port.  Otherwise return false. */
+    bool RequestHandoff();
+
     in_port_t GetStatusPort() const {
       assert(this);
       return StatusPort;
@@ -207,6 +268,10 @@ namespace Dory {
        dory. */
     void RequestShutdown();
 
+    /* Called by SIGHUP handler.  Also called by test code.  The main thread
+       reloads the config file and hands it to the router thread. */
+    void RequestConfReload();
+
     private:
     /* Thread pool type for handling local TCP and UNIX domain stream client
        connections. */
@@ -218,7 +283,16 @@ namespace Dory {
        agents. */
     bool StartMsgHandlingThreads();
 
-    bool HandleEvents();
+    /* Start the web interface and the handoff server, if configured.  When
+       taking over from an old process, this waits until the old process has
+       exited. */
+    void StartWebInterface(TWebInterface &web_interface);
+
+    bool HandleEvents(TWebInterface &web_interface);
+
+    /* Load and validate the config file, and hand it to the router thread.  On
+       error, the config in use stays in effect. */
+    void ReloadConf();
 
     void DiscardFinalMsgs(std::list<TMsg::TPtr> &msg_list);
 
@@ -228,6 +302,11 @@ namespace Dory {
        TODO: consider providing command line option(s) for setting backlog. */
     static const int STREAM_BACKLOG;
 
+    /* Smallest and largest chunk sizes when --pool_size_classes is given. */
+    static const size_t POOL_MIN_CHUNK_SIZE;
+
+    static const size_t POOL_MAX_CHUNK_SIZE;
+
     /* Protects 'ServerList' below. */
     static std::mutex ServerListMutex;
 
@@ -240,14 +319,24 @@ namespace Dory {
     /* Configuration obtained from command line arguments. */
     const std::unique_ptr<const TConfig> Config;
 
-    /* Configuration obtained from config file. */
+    /* Configuration obtained from config file at startup. */
     Conf::TConf Conf;
 
+    /* Passed to config file builder when reloading config file. */
+    const bool EnableLz4;
+
     const size_t PoolBlockSize;
 
     bool Started;
 
-    Capped::TPool Pool;
+    /* Always known after construction.  The mode depends on
+       --pool_size_classes, which is why this is optional. */
+    Base::TOpt<Capped::TPool> Pool;
+
+    /* Known only if the config file specifies a finite buffer quota for at
+       least one topic.  Messages hold charges against this, so it is declared
+       before everything that holds messages. */
+    Base::TOpt<TTopicQuota> TopicQuota;
 
     /* This is declared _before_ the input thread, router thread, and
        dispatcher so it gets destroyed after them.  Its destructor stops
@@ -260,6 +349,26 @@ namespace Dory {
     /* For tracking discarded messages and possible duplicates. */
     TAnomalyTracker AnomalyTracker;
 
+    /* Per-topic compression stats, shared by the dispatcher's connector
+       threads and reported by the web interface. */
+    TCompressionStats CompressionStats;
+
+    /* Queue depth and latency stats for the high and low priority lanes,
+       shared by the dispatcher's connector threads and reported by the web
+       interface. */
+    TPriorityLaneStats LaneStats;
+
+    /* ACK latency estimate and effective thresholds for adaptive batching,
+       shared by the router thread and the dispatcher's connector threads. */
+    Batch::TAdaptiveBatchStats AdaptiveBatchStats;
+
+    /* Producer ID and sequence numbers for idempotent produce requests,
+       shared by the router thread and the dispatcher's connector threads. */
+    TIdempotentProducer IdempotentProducer;
+
+    /* Tracks which version of the config file is in use. */
+    TConfGeneration ConfGeneration;
+
     /* The only purpose of this is to prevent multiple instances of the server
        from running simultaneously.  In this case, we want to fail as early as
        possible.  Once Mongoose has started, it has the port claimed so we
@@ -274,6 +383,18 @@ namespace Dory {
 
     TRouterThread RouterThread;
 
+    /* When enabled, input agents hand messages here rather than discarding
+       them when 'Pool' is full.  Declared after 'RouterThread', since it
+       feeds spooled messages to the router thread, and before the input
+       agents, since they hand messages to it. */
+    Base::TOpt<Spool::TOverflowSpool> OverflowSpool;
+
+    /* When enabled, records messages received by the router thread until they
+       are processed, and recovers messages left unprocessed by a previous run.
+       Declared after 'RouterThread', since it feeds recovered messages to the
+       router thread. */
+    Base::TOpt<Journal::TMsgJournal> MsgJournal;
+
     /* Thread pool for handling local TCP and UNIX domain stream client
        connections. */
     Base::TOpt<TWorkerPool> StreamClientWorkerPool;
@@ -293,8 +414,23 @@ namespace Dory {
        stream sockets. */
     Base::TOpt<Server::TTcpIpv4Server> TcpInputAgent;
 
+    /* Server for clients that send messages through shared memory rings.
+       This avoids system calls for co-located clients with very high
+       message rates. */
+    Base::TOpt<Shm::TShmInputAgent> ShmInputAgent;
+
     const TMetadataTimestamp &MetadataTimestamp;
 
+    /* Connection to the old process we are taking over from.  Stays open
+       until the old process exits. */
+    Handoff::THandoffClient HandoffClient;
+
+    /* When enabled, hands our input sockets to a new process. */
+    Base::TOpt<Handoff::THandoffServer> HandoffServer;
+
+    /* Set when a new process has taken over our input sockets. */
+    bool HandingOff;
+
     /* Set when we get a shutdown signal or test code calls RequestShutdown().
        Here we use atomic flag because test process might get signal while
        calling RequestShutdown().
@@ -307,6 +443,9 @@ namespace Dory {
 
     /* SIGINT/SIGTERM handler pushes this. */
     Base::TEventSemaphore ShutdownRequestSem;
+
+    /* SIGHUP handler and web interface push this. */
+    Base::TEventSemaphore ConfReloadRequestSem;
   };  // TDoryServer
 
 }  // Dory
@@ -0,0 +1,98 @@
+/* <dory/handoff/handoff_client.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/handoff/handoff_client.h>.
+ */
+
+#include <dory/handoff/handoff_client.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <syslog.h>
+
+#include <base/error_utils.h>
+#include <socket/address.h>
+#include <socket/fd_passing.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Handoff;
+using namespace Socket;
+
+bool THandoffClient::Connect(const char *path) {
+  assert(this);
+  Reset();
+  TFd conn(socket(AF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0));
+  TAddress address;
+  address.SetFamily(AF_LOCAL);
+  address.SetPath(path);
+
+  if (connect(conn, address, address.GetLen()) < 0) {
+    if ((errno == ENOENT) || (errno == ECONNREFUSED)) {
+      /* No old process to take over from. */
+      return false;
+    }
+
+    IfLt0(-1);  // this will throw
+  }
+
+  if (!conn.IsReadable(HANDOFF_TIMEOUT)) {
+    ThrowSystemError(ETIMEDOUT);
+  }
+
+  uint8_t hello[HANDOFF_HELLO_SIZE];
+  std::vector<TFd> fds;
+  size_t size = RecvFds(conn, hello, sizeof(hello), fds);
+
+  if ((size != sizeof(hello)) || (hello[0] != HANDOFF_PROTOCOL_VERSION)) {
+    syslog(LOG_ERR, "Got bad handoff message from old dory process");
+    ThrowSystemError(EPROTO);
+  }
+
+  const uint8_t mask = hello[1];
+  auto iter = fds.begin();
+
+  for (auto item : {
+           std::make_pair(THandoffSocket::UnixDg, &Sockets.UnixDg),
+           std::make_pair(THandoffSocket::UnixStream, &Sockets.UnixStream),
+           std::make_pair(THandoffSocket::Tcp, &Sockets.Tcp) }) {
+    if (mask & static_cast<uint8_t>(item.first)) {
+      if (iter == fds.end()) {
+        syslog(LOG_ERR, "Old dory process sent too few sockets on handoff");
+        ThrowSystemError(EPROTO);
+      }
+
+      *item.second = std::move(*iter);
+      ++iter;
+    }
+  }
+
+  Conn = std::move(conn);
+  return true;
+}
+
+void THandoffClient::ConfirmReady() {
+  assert(this);
+  assert(Conn.IsOpen());
+  const uint8_t ready = HANDOFF_READY;
+  IfLt0(send(Conn, &ready, sizeof(ready), MSG_NOSIGNAL));
+}
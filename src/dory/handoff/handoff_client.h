@@ -0,0 +1,78 @@
+/* <dory/handoff/handoff_client.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   New process side of a socket handoff.  See
+   <dory/handoff/handoff_protocol.h>.
+ */
+
+#pragma once
+
+#include <cassert>
+
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+#include <dory/handoff/handoff_protocol.h>
+
+namespace Dory {
+
+  namespace Handoff {
+
+    class THandoffClient final {
+      NO_COPY_SEMANTICS(THandoffClient);
+
+      public:
+      THandoffClient() = default;
+
+      /* Connect to the control socket at 'path' and receive the input
+         sockets of the old process.  Returns false if no process is listening
+         at 'path'.  Throws std::system_error on other errors, including a
+         timeout waiting for the old process. */
+      bool Connect(const char *path);
+
+      /* Sockets received by Connect().  The caller moves the ones it uses out
+         of here. */
+      TInputSockets &GetSockets() noexcept {
+        assert(this);
+        return Sockets;
+      }
+
+      /* Call once the new process is accepting input on the sockets, to tell
+         the old process to stop intake. */
+      void ConfirmReady();
+
+      /* Becomes readable when the old process exits.  Valid between
+         Connect() and Reset(). */
+      const Base::TFd &GetOldServerExitFd() const noexcept {
+        assert(this);
+        return Conn;
+      }
+
+      void Reset() noexcept {
+        assert(this);
+        Conn.Reset();
+      }
+
+      private:
+      Base::TFd Conn;
+
+      TInputSockets Sockets;
+    };  // THandoffClient
+
+  }  // Handoff
+
+}  // Dory
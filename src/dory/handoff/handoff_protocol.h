@@ -0,0 +1,78 @@
+/* <dory/handoff/handoff_protocol.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Protocol for handing input sockets from a running dory process to a new
+   one, so dory can be upgraded without interrupting input.
+
+   1.  The new process connects to the control socket of the old process.
+
+   2.  The old process sends a message of HANDOFF_HELLO_SIZE bytes: the
+       protocol version followed by a bitmask of THandoffSocket values, with
+       the sockets it has attached as SCM_RIGHTS ancillary data in bitmask
+       order.
+
+   3.  The new process starts accepting input on the sockets, and then sends
+       a single byte (HANDOFF_READY) to tell the old process to stop intake.
+
+   4.  The old process closes and unlinks its control socket, stops reading
+       from the input sockets without unlinking their files, and delivers the
+       messages it has buffered.  It keeps the connection open until it
+       exits, so the new process knows when it can claim the status port and
+       the control socket.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <base/fd.h>
+
+namespace Dory {
+
+  namespace Handoff {
+
+    const uint8_t HANDOFF_PROTOCOL_VERSION = 1;
+
+    const size_t HANDOFF_HELLO_SIZE = 2;
+
+    const uint8_t HANDOFF_READY = 1;
+
+    /* Milliseconds either side waits for the other to respond. */
+    const int HANDOFF_TIMEOUT = 30000;
+
+    /* Bits for the socket bitmask in the hello message. */
+    enum class THandoffSocket : uint8_t {
+      UnixDg = 0x01,
+      UnixStream = 0x02,
+      Tcp = 0x04
+    };  // THandoffSocket
+
+    /* Input sockets passed between processes.  A socket that isn't passed is
+       left closed. */
+    struct TInputSockets {
+      Base::TFd UnixDg;
+
+      Base::TFd UnixStream;
+
+      Base::TFd Tcp;
+    };  // TInputSockets
+
+  }  // Handoff
+
+}  // Dory
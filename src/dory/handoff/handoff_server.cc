@@ -0,0 +1,217 @@
+/* <dory/handoff/handoff_server.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/handoff/handoff_server.h>.
+ */
+
+#include <dory/handoff/handoff_server.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/gettid.h>
+#include <dory/handoff/handoff_protocol.h>
+#include <server/counter.h>
+#include <socket/address.h>
+#include <socket/fd_passing.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Handoff;
+using namespace Socket;
+
+SERVER_COUNTER(HandoffDone);
+SERVER_COUNTER(HandoffFailed);
+SERVER_COUNTER(HandoffSocketsSent);
+
+THandoffServer::THandoffServer(const char *path, int unix_dg_sock,
+    int unix_stream_sock, int tcp_sock)
+    : UnixDgSock(unix_dg_sock),
+      UnixStreamSock(unix_stream_sock),
+      TcpSock(tcp_sock),
+      ControlSocket(SOCK_STREAM, 0) {
+  /* A socket file left behind by a process that crashed would make bind()
+     fail. */
+  int ret = unlink(path);
+
+  if ((ret < 0) && (errno != ENOENT)) {
+    IfLt0(ret);  // this will throw
+  }
+
+  TAddress address;
+  address.SetFamily(AF_LOCAL);
+  address.SetPath(path);
+  Bind(ControlSocket, address);
+
+  /* Only the owner should be able to take over our sockets. */
+  IfLt0(chmod(path, 0600));
+  IfLt0(listen(ControlSocket, 1));
+}
+
+THandoffServer::~THandoffServer() noexcept {
+  /* This will shut down the thread if something unexpected happens. */
+  ShutdownOnDestroy();
+}
+
+void THandoffServer::Run() {
+  assert(this);
+  int tid = static_cast<int>(Gettid());
+  syslog(LOG_NOTICE, "Handoff thread %d started", tid);
+  bool caught_fatal_exception = false;
+
+  try {
+    DoRun();
+  } catch (const std::exception &x) {
+    caught_fatal_exception = true;
+    syslog(LOG_ERR, "Fatal error in handoff thread %d: %s", tid, x.what());
+  } catch (...) {
+    caught_fatal_exception = true;
+    syslog(LOG_ERR, "Fatal unknown error in handoff thread %d", tid);
+  }
+
+  syslog(LOG_NOTICE, "Handoff thread %d finished %s", tid,
+         caught_fatal_exception ? "on error" : "normally");
+}
+
+void THandoffServer::DoRun() {
+  assert(this);
+  std::array<struct pollfd, 2> events;
+  struct pollfd &shutdown_request_event = events[0];
+  struct pollfd &new_server_event = events[1];
+  shutdown_request_event.fd = GetShutdownRequestFd();
+  shutdown_request_event.events = POLLIN;
+  new_server_event.fd = ControlSocket.GetFd();
+  new_server_event.events = POLLIN;
+
+  for (; ; ) {
+    for (auto &item : events) {
+      item.revents = 0;
+    }
+
+    IfLt0(poll(&events[0], events.size(), -1));
+
+    if (shutdown_request_event.revents) {
+      break;
+    }
+
+    if (new_server_event.revents) {
+      int fd = accept4(ControlSocket, nullptr, nullptr, SOCK_CLOEXEC);
+
+      if (fd < 0) {
+        if ((errno == EINTR) || (errno == ECONNABORTED) ||
+            (errno == EAGAIN)) {
+          continue;
+        }
+
+        IfLt0(fd);  // this will throw
+      }
+
+      TFd conn(fd);
+      syslog(LOG_NOTICE, "New dory process connected for handoff");
+
+      if (HandOff(conn)) {
+        HandoffDone.Increment();
+        syslog(LOG_NOTICE, "New dory process took over input sockets");
+        NewServerConn = std::move(conn);
+        ControlSocket.Reset();
+        HandoffDoneSem.Push();
+
+        /* Nothing left to do but wait for the main thread to shut us down.
+         */
+        GetShutdownRequestFd().IsReadable(-1);
+        break;
+      }
+
+      HandoffFailed.Increment();
+    }
+  }
+}
+
+bool THandoffServer::HandOff(const TFd &conn) {
+  assert(this);
+  uint8_t hello[HANDOFF_HELLO_SIZE] = { HANDOFF_PROTOCOL_VERSION, 0 };
+  std::vector<int> fds;
+
+  if (UnixDgSock >= 0) {
+    hello[1] |= static_cast<uint8_t>(THandoffSocket::UnixDg);
+    fds.push_back(UnixDgSock);
+  }
+
+  if (UnixStreamSock >= 0) {
+    hello[1] |= static_cast<uint8_t>(THandoffSocket::UnixStream);
+    fds.push_back(UnixStreamSock);
+  }
+
+  if (TcpSock >= 0) {
+    hello[1] |= static_cast<uint8_t>(THandoffSocket::Tcp);
+    fds.push_back(TcpSock);
+  }
+
+  try {
+    SendFds(conn, hello, sizeof(hello), fds);
+  } catch (const std::system_error &x) {
+    syslog(LOG_ERR, "Failed to send input sockets to new dory process: %s",
+        x.what());
+    return false;
+  }
+
+  HandoffSocketsSent.Increment();
+
+  /* The new process confirms once it is accepting input.  Until then, we
+     keep reading from the sockets too. */
+  std::array<struct pollfd, 2> events;
+  events[0].fd = GetShutdownRequestFd();
+  events[0].events = POLLIN;
+  events[0].revents = 0;
+  events[1].fd = conn;
+  events[1].events = POLLIN;
+  events[1].revents = 0;
+  int ret = IfLt0(poll(&events[0], events.size(), HANDOFF_TIMEOUT));
+
+  if (events[0].revents) {
+    return false;
+  }
+
+  if (ret == 0) {
+    syslog(LOG_ERR, "Timed out waiting for new dory process to confirm "
+        "handoff");
+    return false;
+  }
+
+  uint8_t reply = 0;
+  ssize_t size = recv(conn, &reply, sizeof(reply), 0);
+
+  if ((size != sizeof(reply)) || (reply != HANDOFF_READY)) {
+    syslog(LOG_ERR, "New dory process failed before confirming handoff");
+    return false;
+  }
+
+  return true;
+}
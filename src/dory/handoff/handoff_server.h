@@ -0,0 +1,92 @@
+/* <dory/handoff/handoff_server.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Thread that hands the input sockets of a running dory process to a new
+   one.  See <dory/handoff/handoff_protocol.h>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <string>
+
+#include <base/event_semaphore.h>
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+#include <socket/named_unix_socket.h>
+#include <thread/fd_managed_thread.h>
+
+namespace Dory {
+
+  namespace Handoff {
+
+    /* Listens on a UNIX domain stream control socket.  When a new process
+       connects, passes it the input sockets.  Once the new process confirms
+       it is accepting input, closes and unlinks the control socket and makes
+       the fd returned by GetHandoffDoneFd() readable.  The main thread then
+       stops intake and shuts down.  The connection to the new process stays
+       open until this object is destroyed.  A new process that fails before
+       confirming leaves us running as before. */
+    class THandoffServer final : public Thread::TFdManagedThread {
+      NO_COPY_SEMANTICS(THandoffServer);
+
+      public:
+      /* Bind the control socket at 'path', replacing any stale socket file.
+         The remaining parameters are the input sockets to hand off, or -1
+         for disabled inputs.  The caller keeps ownership of them, and must
+         keep them open while the thread runs.  Throws std::system_error on
+         error. */
+      THandoffServer(const char *path, int unix_dg_sock, int unix_stream_sock,
+          int tcp_sock);
+
+      virtual ~THandoffServer() noexcept;
+
+      /* Becomes readable once a new process has taken over the input
+         sockets. */
+      const Base::TFd &GetHandoffDoneFd() const noexcept {
+        assert(this);
+        return HandoffDoneSem.GetFd();
+      }
+
+      protected:
+      virtual void Run() override;
+
+      private:
+      void DoRun();
+
+      /* Pass the input sockets over 'conn' and wait for the new process to
+         confirm.  Returns true on success. */
+      bool HandOff(const Base::TFd &conn);
+
+      const int UnixDgSock;
+
+      const int UnixStreamSock;
+
+      const int TcpSock;
+
+      Socket::TNamedUnixSocket ControlSocket;
+
+      /* Connection to the process we handed off to. */
+      Base::TFd NewServerConn;
+
+      Base::TEventSemaphore HandoffDoneSem;
+    };  // THandoffServer
+
+  }  // Handoff
+
+}  // Dory
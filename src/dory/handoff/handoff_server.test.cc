@@ -0,0 +1,134 @@
+/* <dory/handoff/handoff_server.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/handoff/handoff_server.h>.
+ */
+
+#include <dory/handoff/handoff_server.h>
+
+#include <memory>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <base/fd.h>
+#include <base/tmp_dir.h>
+#include <dory/handoff/handoff_client.h>
+#include <socket/address.h>
+#include <socket/named_unix_socket.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Handoff;
+using namespace Socket;
+
+namespace {
+
+  /* The fixture for testing class THandoffServer. */
+  class THandoffServerTest : public ::testing::Test {
+    protected:
+    THandoffServerTest() {
+    }
+
+    virtual ~THandoffServerTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // THandoffServerTest
+
+  TEST_F(THandoffServerTest, NoOldServer) {
+    TTmpDir dir("/tmp/dory_handoff_test.XXXXXX", true);
+    std::string control_path = std::string(dir.GetName()) + "/control";
+    THandoffClient client;
+    ASSERT_FALSE(client.Connect(control_path.c_str()));
+  }
+
+  TEST_F(THandoffServerTest, HandOff) {
+    TTmpDir dir("/tmp/dory_handoff_test.XXXXXX", true);
+    std::string control_path = std::string(dir.GetName()) + "/control";
+    std::string dg_path = std::string(dir.GetName()) + "/dg";
+    TNamedUnixSocket dg_sock(SOCK_DGRAM, 0);
+    TAddress dg_address;
+    dg_address.SetFamily(AF_LOCAL);
+    dg_address.SetPath(dg_path.c_str());
+    Bind(dg_sock, dg_address);
+    TFd tcp_sock(socket(AF_INET, SOCK_STREAM, 0));
+    Bind(tcp_sock, TAddress(TAddress::IPv4Loopback, 0));
+    listen(tcp_sock, 16);
+    in_port_t port = GetSockName(tcp_sock).GetPort();
+
+    std::unique_ptr<THandoffServer> server(new THandoffServer(
+        control_path.c_str(), dg_sock.GetFd(), -1, tcp_sock));
+    server->Start();
+    THandoffClient client;
+    ASSERT_TRUE(client.Connect(control_path.c_str()));
+    TInputSockets &sockets = client.GetSockets();
+    ASSERT_TRUE(sockets.UnixDg.IsOpen());
+    ASSERT_FALSE(sockets.UnixStream.IsOpen());
+    ASSERT_TRUE(sockets.Tcp.IsOpen());
+    ASSERT_EQ(std::string(GetSockName(sockets.UnixDg).GetPath()), dg_path);
+    ASSERT_EQ(GetSockName(sockets.Tcp).GetPort(), port);
+
+    /* Nothing happens until the new process confirms. */
+    ASSERT_FALSE(server->GetHandoffDoneFd().IsReadable(100));
+    client.ConfirmReady();
+    ASSERT_TRUE(server->GetHandoffDoneFd().IsReadable(15000));
+    ASSERT_NE(access(control_path.c_str(), F_OK), 0);
+
+    /* The connection tells the new process when the old one is gone. */
+    server->RequestShutdown();
+    server->Join();
+    ASSERT_FALSE(client.GetOldServerExitFd().IsReadable(0));
+    server.reset();
+    ASSERT_TRUE(client.GetOldServerExitFd().IsReadable(0));
+  }
+
+  TEST_F(THandoffServerTest, NewServerFails) {
+    TTmpDir dir("/tmp/dory_handoff_test.XXXXXX", true);
+    std::string control_path = std::string(dir.GetName()) + "/control";
+    TFd tcp_sock(socket(AF_INET, SOCK_STREAM, 0));
+    THandoffServer server(control_path.c_str(), -1, -1, tcp_sock);
+    server.Start();
+
+    {
+      THandoffClient client;
+      ASSERT_TRUE(client.Connect(control_path.c_str()));
+      ASSERT_TRUE(client.GetSockets().Tcp.IsOpen());
+    }
+
+    /* The old process keeps running, and can still hand off. */
+    THandoffClient client;
+    ASSERT_TRUE(client.Connect(control_path.c_str()));
+    client.ConfirmReady();
+    ASSERT_TRUE(server.GetHandoffDoneFd().IsReadable(15000));
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
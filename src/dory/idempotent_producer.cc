@@ -0,0 +1,165 @@
+/* <dory/idempotent_producer.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/idempotent_producer.h>.
+ */
+
+#include <dory/idempotent_producer.h>
+
+#include <syslog.h>
+
+#include <server/counter.h>
+
+using namespace Dory;
+using namespace Dory::KafkaProto::Produce;
+
+SERVER_COUNTER(IdempotentProducerIdSet);
+SERVER_COUNTER(IdempotentProducerReset);
+SERVER_COUNTER(IdempotentResequenceMsg);
+
+TIdempotentProducer::TIdempotentProducer(bool enabled,
+    TAnomalyTracker &anomaly_tracker)
+    : Enabled(enabled),
+      AnomalyTracker(anomaly_tracker),
+      ProducerId(-1),
+      ProducerEpoch(-1),
+      Generation(1) {
+}
+
+bool TIdempotentProducer::NeedsProducerId() const {
+  assert(this);
+
+  if (!Enabled) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  return (ProducerId < 0);
+}
+
+void TIdempotentProducer::SetProducerId(int64_t producer_id,
+    int16_t producer_epoch) {
+  assert(this);
+  assert(Enabled);
+  assert(producer_id >= 0);
+  IdempotentProducerIdSet.Increment();
+  syslog(LOG_NOTICE, "Using idempotent producer ID %lld epoch %d",
+      static_cast<long long>(producer_id), static_cast<int>(producer_epoch));
+  std::lock_guard<std::mutex> lock(Mutex);
+  ProducerId = producer_id;
+  ProducerEpoch = producer_epoch;
+  NewGeneration();
+}
+
+void TIdempotentProducer::Reset(uint32_t generation) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+
+  if ((ProducerId < 0) || (generation != Generation.load())) {
+    return;  // already reset, or got a new producer ID since then
+  }
+
+  IdempotentProducerReset.Increment();
+  syslog(LOG_WARNING, "Dropping idempotent producer ID %lld",
+      static_cast<long long>(ProducerId));
+  ProducerId = -1;
+  ProducerEpoch = -1;
+  NewGeneration();
+}
+
+TProducerSequence TIdempotentProducer::AssignSequences(
+    const std::string &topic, int32_t partition,
+    const std::list<TMsg::TPtr> &msg_set) {
+  assert(this);
+  assert(!msg_set.empty());
+  std::lock_guard<std::mutex> lock(Mutex);
+
+  if (ProducerId < 0) {
+    return TProducerSequence();
+  }
+
+  uint32_t generation = Generation.load();
+  int32_t &next = NextSequence[topic][partition];
+
+  /* A resend can keep its sequence numbers if they start the set, are
+     consecutive, and any messages after them without sequence numbers can be
+     numbered starting right after them.  The latter requires that no numbers
+     have been assigned after them. */
+  int32_t base = next;
+  size_t held = 0;
+  size_t i = 0;
+  bool reuse = true;
+
+  for (const TMsg::TPtr &msg : msg_set) {
+    if (msg->GetProducerGeneration() == generation) {
+      int32_t seq = msg->GetProduceSequence();
+
+      if (held == 0) {
+        base = seq;
+      }
+
+      if ((i != held) || (seq != AddToSequence(base, held))) {
+        reuse = false;
+        break;
+      }
+
+      ++held;
+    }
+
+    ++i;
+  }
+
+  if (reuse && held && (held < msg_set.size()) &&
+      (AddToSequence(base, held) != next)) {
+    reuse = false;
+  }
+
+  if (!reuse) {
+    base = next;
+  }
+
+  i = 0;
+
+  for (const TMsg::TPtr &msg : msg_set) {
+    if (!reuse || (msg->GetProducerGeneration() != generation)) {
+      if (msg->GetProduceSequence() >= 0) {
+        /* This message was sent before under a sequence number that no
+           longer applies, so Kafka can't detect a duplicate. */
+        AnomalyTracker.TrackDuplicate(*msg);
+        IdempotentResequenceMsg.Increment();
+      }
+
+      msg->SetProduceSequence(generation, AddToSequence(base, i));
+    }
+
+    ++i;
+  }
+
+  if (!reuse || (held < msg_set.size())) {
+    next = AddToSequence(base, msg_set.size());
+  }
+
+  return TProducerSequence(ProducerId, ProducerEpoch, base);
+}
+
+void TIdempotentProducer::NewGeneration() {
+  assert(this);
+  uint32_t generation = Generation.load() + 1;
+  Generation.store(generation ? generation : 1);
+  NextSequence.clear();
+}
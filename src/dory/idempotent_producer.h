@@ -0,0 +1,123 @@
+/* <dory/idempotent_producer.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for tracking the producer ID and per-partition sequence numbers used
+   to send idempotent produce requests.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <base/no_copy_semantics.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/kafka_proto/produce/produce_request_writer_api.h>
+#include <dory/msg.h>
+
+namespace Dory {
+
+  /* Shared by the router thread and all connector threads.  When enabled, the
+     router thread gets a producer ID from Kafka and connector threads assign
+     sequence numbers to messages as they serialize them, so a broker discards
+     a message set that it already has when the set is resent.  A message
+     keeps its sequence number until it is acknowledged, so a resend reuses
+     the original number as long as the producer ID hasn't changed and the
+     message goes to the same partition.  Each change of producer ID starts a
+     new generation, and sequence numbers from older generations no longer
+     apply. */
+  class TIdempotentProducer final {
+    NO_COPY_SEMANTICS(TIdempotentProducer);
+
+    public:
+    TIdempotentProducer(bool enabled, TAnomalyTracker &anomaly_tracker);
+
+    bool IsEnabled() const {
+      assert(this);
+      return Enabled;
+    }
+
+    /* Return true if enabled without a producer ID, in which case the router
+       thread should request one.  Until it gets one, produce requests are
+       sent without idempotence. */
+    bool NeedsProducerId() const;
+
+    /* Called by the router thread with a newly assigned producer ID. */
+    void SetProducerId(int64_t producer_id, int16_t producer_epoch);
+
+    /* Called by a connector thread when a broker rejects the producer ID or
+       sequence numbers of messages whose generation is 'generation'.  Drop
+       the producer ID, unless it has already changed since then. */
+    void Reset(uint32_t generation);
+
+    /* Return true if 'msg' holds a sequence number that still applies, so a
+       resend can't create a duplicate. */
+    bool HoldsCurrentSequence(const TMsg &msg) const {
+      assert(this);
+      uint32_t generation = msg.GetProducerGeneration();
+      return (generation != 0) && (generation == Generation.load());
+    }
+
+    /* Called by a connector thread for each message set it serializes.
+       Assign sequence numbers to the messages in 'msg_set' that need them,
+       and return what goes in the set's batch header.  Messages that already
+       hold sequence numbers keep them if they still apply and are
+       consecutive.  Otherwise they are renumbered and tracked as possible
+       duplicates. */
+    KafkaProto::Produce::TProducerSequence AssignSequences(
+        const std::string &topic, int32_t partition,
+        const std::list<TMsg::TPtr> &msg_set);
+
+    private:
+    /* Kafka sequence numbers wrap from INT32_MAX to 0. */
+    static int32_t AddToSequence(int32_t sequence, size_t n) {
+      return static_cast<int32_t>((static_cast<uint64_t>(sequence) + n) %
+          (static_cast<uint64_t>(INT32_MAX) + 1));
+    }
+
+    /* Start a new generation.  Caller must hold 'Mutex'. */
+    void NewGeneration();
+
+    const bool Enabled;
+
+    TAnomalyTracker &AnomalyTracker;
+
+    /* Protects everything below except 'Generation', which is only modified
+       while holding it. */
+    mutable std::mutex Mutex;
+
+    /* -1 if we have no producer ID. */
+    int64_t ProducerId;
+
+    int16_t ProducerEpoch;
+
+    /* Never 0, which TMsg uses to indicate no sequence number. */
+    std::atomic<uint32_t> Generation;
+
+    /* Next sequence number to assign for each topic and partition in the
+       current generation. */
+    std::unordered_map<std::string, std::unordered_map<int32_t, int32_t>>
+        NextSequence;
+  };  // TIdempotentProducer
+
+}  // Dory
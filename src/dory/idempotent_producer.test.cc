@@ -0,0 +1,222 @@
+/* <dory/idempotent_producer.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/idempotent_producer.h>
+ */
+
+#include <dory/idempotent_producer.h>
+
+#include <list>
+#include <string>
+
+#include <capped/pool.h>
+#include <dory/discard_file_logger.h>
+#include <dory/msg_creator.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/test_util/misc_util.h>
+
+#include <gtest/gtest.h>
+
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::TestUtil;
+
+namespace {
+
+  /* The fixture for testing class TIdempotentProducer. */
+  class TIdempotentProducerTest : public ::testing::Test {
+    protected:
+    TIdempotentProducerTest()
+        : Pool(64, 1024, TPool::TSync::Mutexed),
+          AnomalyTracker(DiscardFileLogger, 0, 256) {
+    }
+
+    virtual ~TIdempotentProducerTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+
+    std::list<TMsg::TPtr> NewMsgSet(size_t count) {
+      std::list<TMsg::TPtr> msg_set;
+      std::string topic("topic");
+      std::string value("value");
+
+      for (size_t i = 0; i < count; ++i) {
+        msg_set.push_back(TMsgCreator::CreateAnyPartitionMsg(0, topic.data(),
+            topic.data() + topic.size(), "", 0, value.data(), value.size(),
+            false, Pool, MsgStateTracker));
+        SetProcessed(msg_set.back());
+      }
+
+      return msg_set;
+    }
+
+    size_t GetDuplicateCount() {
+      TAnomalyTracker::TInfo info;
+      AnomalyTracker.GetInfo(info);
+      auto iter = info.DuplicateTopicMap.find("topic");
+      return (iter == info.DuplicateTopicMap.end()) ? 0 : iter->second.Count;
+    }
+
+    TPool Pool;
+
+    TMsgStateTracker MsgStateTracker;
+
+    TDiscardFileLogger DiscardFileLogger;
+
+    TAnomalyTracker AnomalyTracker;
+  };  // TIdempotentProducerTest
+
+  TEST_F(TIdempotentProducerTest, DisabledTest) {
+    TIdempotentProducer producer(false, AnomalyTracker);
+    ASSERT_FALSE(producer.IsEnabled());
+    ASSERT_FALSE(producer.NeedsProducerId());
+  }
+
+  TEST_F(TIdempotentProducerTest, NoProducerIdTest) {
+    TIdempotentProducer producer(true, AnomalyTracker);
+    ASSERT_TRUE(producer.NeedsProducerId());
+    std::list<TMsg::TPtr> msg_set = NewMsgSet(2);
+    TProducerSequence seq = producer.AssignSequences("topic", 0, msg_set);
+    ASSERT_EQ(seq.ProducerId, -1);
+    ASSERT_EQ(seq.ProducerEpoch, -1);
+    ASSERT_EQ(seq.BaseSequence, -1);
+
+    for (const TMsg::TPtr &msg : msg_set) {
+      ASSERT_FALSE(producer.HoldsCurrentSequence(*msg));
+      ASSERT_EQ(msg->GetProduceSequence(), -1);
+    }
+  }
+
+  TEST_F(TIdempotentProducerTest, AssignTest) {
+    TIdempotentProducer producer(true, AnomalyTracker);
+    producer.SetProducerId(1000, 3);
+    ASSERT_FALSE(producer.NeedsProducerId());
+    std::list<TMsg::TPtr> set1 = NewMsgSet(3);
+    TProducerSequence seq = producer.AssignSequences("topic", 0, set1);
+    ASSERT_EQ(seq.ProducerId, 1000);
+    ASSERT_EQ(seq.ProducerEpoch, 3);
+    ASSERT_EQ(seq.BaseSequence, 0);
+    int32_t expected = 0;
+
+    for (const TMsg::TPtr &msg : set1) {
+      ASSERT_TRUE(producer.HoldsCurrentSequence(*msg));
+      ASSERT_EQ(msg->GetProduceSequence(), expected);
+      ++expected;
+    }
+
+    std::list<TMsg::TPtr> set2 = NewMsgSet(2);
+    seq = producer.AssignSequences("topic", 0, set2);
+    ASSERT_EQ(seq.BaseSequence, 3);
+
+    /* Each partition has its own sequence. */
+    std::list<TMsg::TPtr> set3 = NewMsgSet(1);
+    seq = producer.AssignSequences("topic", 1, set3);
+    ASSERT_EQ(seq.BaseSequence, 0);
+    ASSERT_EQ(GetDuplicateCount(), 0U);
+  }
+
+  TEST_F(TIdempotentProducerTest, ResendTest) {
+    TIdempotentProducer producer(true, AnomalyTracker);
+    producer.SetProducerId(1000, 0);
+    std::list<TMsg::TPtr> set1 = NewMsgSet(2);
+    producer.AssignSequences("topic", 0, set1);
+
+    /* A resend of the same set keeps its sequence numbers. */
+    TProducerSequence seq = producer.AssignSequences("topic", 0, set1);
+    ASSERT_EQ(seq.BaseSequence, 0);
+    ASSERT_EQ(set1.front()->GetProduceSequence(), 0);
+    ASSERT_EQ(set1.back()->GetProduceSequence(), 1);
+
+    /* The resent messages may be batched with new ones, which continue the
+       sequence. */
+    std::list<TMsg::TPtr> set2 = NewMsgSet(2);
+    set1.splice(set1.end(), set2);
+    seq = producer.AssignSequences("topic", 0, set1);
+    ASSERT_EQ(seq.BaseSequence, 0);
+    int32_t expected = 0;
+
+    for (const TMsg::TPtr &msg : set1) {
+      ASSERT_EQ(msg->GetProduceSequence(), expected);
+      ++expected;
+    }
+
+    std::list<TMsg::TPtr> set3 = NewMsgSet(1);
+    seq = producer.AssignSequences("topic", 0, set3);
+    ASSERT_EQ(seq.BaseSequence, 4);
+    ASSERT_EQ(GetDuplicateCount(), 0U);
+  }
+
+  TEST_F(TIdempotentProducerTest, ResetTest) {
+    TIdempotentProducer producer(true, AnomalyTracker);
+    producer.SetProducerId(1000, 0);
+    std::list<TMsg::TPtr> set1 = NewMsgSet(2);
+    producer.AssignSequences("topic", 0, set1);
+    uint32_t generation = set1.front()->GetProducerGeneration();
+    ASSERT_NE(generation, 0U);
+    producer.Reset(generation);
+    ASSERT_TRUE(producer.NeedsProducerId());
+    ASSERT_FALSE(producer.HoldsCurrentSequence(*set1.front()));
+
+    /* A second reset for the same generation does nothing. */
+    producer.SetProducerId(1001, 0);
+    producer.Reset(generation);
+    ASSERT_FALSE(producer.NeedsProducerId());
+
+    /* Messages sent under the old producer ID are renumbered and tracked as
+       possible duplicates. */
+    std::list<TMsg::TPtr> set2 = NewMsgSet(1);
+    set1.splice(set1.end(), set2);
+    TProducerSequence seq = producer.AssignSequences("topic", 0, set1);
+    ASSERT_EQ(seq.ProducerId, 1001);
+    ASSERT_EQ(seq.BaseSequence, 0);
+    int32_t expected = 0;
+
+    for (const TMsg::TPtr &msg : set1) {
+      ASSERT_TRUE(producer.HoldsCurrentSequence(*msg));
+      ASSERT_EQ(msg->GetProduceSequence(), expected);
+      ++expected;
+    }
+
+    ASSERT_EQ(GetDuplicateCount(), 2U);
+  }
+
+  TEST_F(TIdempotentProducerTest, OutOfOrderTest) {
+    TIdempotentProducer producer(true, AnomalyTracker);
+    producer.SetProducerId(1000, 0);
+    std::list<TMsg::TPtr> set1 = NewMsgSet(2);
+    producer.AssignSequences("topic", 0, set1);
+    std::list<TMsg::TPtr> set2 = NewMsgSet(2);
+    producer.AssignSequences("topic", 0, set2);
+
+    /* Resending the first set together with a new message can't continue
+       its sequence, since numbers were assigned after it. */
+    std::list<TMsg::TPtr> set3 = NewMsgSet(1);
+    set1.splice(set1.end(), set3);
+    TProducerSequence seq = producer.AssignSequences("topic", 0, set1);
+    ASSERT_EQ(seq.BaseSequence, 4);
+    ASSERT_EQ(set1.back()->GetProduceSequence(), 6);
+    ASSERT_EQ(GetDuplicateCount(), 2U);
+  }
+
+}  // namespace
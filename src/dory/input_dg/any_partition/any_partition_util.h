@@ -29,6 +29,8 @@
 #include <dory/anomaly_tracker.h>
 #include <dory/msg.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
 
 namespace Dory {
 
@@ -41,7 +43,9 @@ namespace Dory {
           const uint8_t *versioned_part_begin,
           const uint8_t *versioned_part_end, Capped::TPool &pool,
           TAnomalyTracker &anomaly_tracker,
-          TMsgStateTracker &msg_state_tracker, bool no_log_discard);
+          TMsgStateTracker &msg_state_tracker,
+          Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
+          bool no_log_discard);
 
     }  // AnyPartition
 
@@ -124,5 +124,5 @@ TMsg::TPtr TV0InputDgReader::BuildMsg() {
   const uint8_t *value_begin = pos;
   return TryCreateAnyPartitionMsg(ts, topic_begin, topic_end, key_begin,
       key_sz, value_begin, value_sz, Pool, AnomalyTracker, MsgStateTracker,
-      NoLogDiscard);
+      OverflowSpool, TopicQuota, NoLogDiscard);
 }
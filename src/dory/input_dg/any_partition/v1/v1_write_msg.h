@@ -0,0 +1,58 @@
+/* <dory/input_dg/any_partition/v1/v1_write_msg.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Functions for creating version 1 (batch) AnyPartition datagrams to write to
+   Dory's input socket.  See <dory/input_dg/v1/v1_write_batch.h> for details.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <dory/client/status_codes.h>
+#include <dory/input_dg/v1/v1_write_batch.h>
+
+/* This is a pure C implementation.  Avoiding C++ here allows C programs to use
+   the client library without having to link to the standard C++ library. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* See <dory/client/status_codes.h> for definitions of returned status codes.
+ */
+
+/* Compute size of batch datagram with 'topic_count' topics given by 'topics'
+   and 'msg_count' messages given by 'msgs'.  On success, DORY_OK will be
+   returned, and *result will contain the computed size in bytes.  On error,
+   DORY_TOPIC_TOO_LARGE, DORY_MSG_TOO_LARGE, or DORY_INVALID_TOPIC_INDEX will
+   be returned. */
+int input_dg_any_p_v1_compute_msg_size(size_t *result,
+    const input_dg_v1_topic_t *topics, size_t topic_count,
+    const input_dg_v1_msg_t *msgs, size_t msg_count);
+
+/* Write batch datagram into 'result_buf'.  It is assumed that 'result_buf' has
+   enough space for entire datagram (see
+   input_dg_any_p_v1_compute_msg_size()). */
+void input_dg_any_p_v1_write_msg(void *result_buf,
+    const input_dg_v1_topic_t *topics, size_t topic_count,
+    const input_dg_v1_msg_t *msgs, size_t msg_count);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -35,10 +35,14 @@
 using namespace Capped;
 using namespace Dory;
 using namespace Dory::InputDg;
+using namespace Dory::Spool;
 using namespace Dory::Util;
 
 SERVER_COUNTER(InputAgentDiscardMsgMalformed);
 SERVER_COUNTER(InputAgentDiscardMsgNoMem);
+SERVER_COUNTER(InputAgentDiscardMsgSpoolFull);
+SERVER_COUNTER(InputAgentDiscardMsgTopicQuota);
+SERVER_COUNTER(InputAgentSpoolMsg);
 
 void Dory::InputDg::DiscardMalformedMsg(const uint8_t *msg_begin,
     size_t msg_size, TAnomalyTracker &anomaly_tracker, bool no_log_discard) {
@@ -82,15 +86,105 @@ void Dory::InputDg::DiscardMsgNoMem(TMsg::TTimestamp timestamp,
   }
 }
 
+void Dory::InputDg::DiscardMsgTopicQuota(TMsg::TTimestamp timestamp,
+    const char *topic_begin, const char *topic_end, const void *key_begin,
+    const void *key_end, const void *value_begin, const void *value_end,
+    TAnomalyTracker &anomaly_tracker, bool no_log_discard) {
+  assert(topic_begin);
+  assert(topic_end >= topic_begin);
+  assert(key_begin || (key_end == key_begin));
+  assert(key_end >= key_begin);
+  assert(value_begin || (value_end == value_begin));
+  assert(value_end >= value_begin);
+  anomaly_tracker.TrackTopicQuotaDiscard(timestamp, topic_begin, topic_end,
+      key_begin, key_end, value_begin, value_end);
+  InputAgentDiscardMsgTopicQuota.Increment();
+
+  if (!no_log_discard) {
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      /* Make the topic into a C string for logging. */
+      std::string topic(topic_begin, topic_end);
+
+      syslog(LOG_ERR,
+             "Discarding message due to topic buffer quota (topic: [%s])",
+             topic.c_str());
+    }
+  }
+}
+
+/* Return true if a new message must go to 'overflow_spool' because it holds
+   older messages.  Otherwise the new message would reach the router thread
+   ahead of them.  If the spool is full, the caller discards the message
+   rather than creating it directly. */
+static inline bool SpoolInOrder(const TOverflowSpool *overflow_spool) {
+  return overflow_spool && (overflow_spool->GetSpooledMsgCount() != 0);
+}
+
+/* Discard a message that can't be spooled behind the messages already in the
+   spool.  Like messages discarded by the spool itself, it is reported as a
+   discard due to lack of buffer space. */
+static void DiscardMsgSpoolFull(TMsg::TTimestamp timestamp,
+    const char *topic_begin, const char *topic_end, const void *key_begin,
+    size_t key_size, const void *value_begin, size_t value_size,
+    TAnomalyTracker &anomaly_tracker, bool no_log_discard) {
+  anomaly_tracker.TrackNoMemDiscard(timestamp, topic_begin, topic_end,
+      key_begin, reinterpret_cast<const uint8_t *>(key_begin) + key_size,
+      value_begin,
+      reinterpret_cast<const uint8_t *>(value_begin) + value_size);
+  InputAgentDiscardMsgSpoolFull.Increment();
+
+  if (!no_log_discard) {
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      /* Make the topic into a C string for logging. */
+      std::string topic(topic_begin, topic_end);
+
+      syslog(LOG_ERR,
+             "Discarding message since overflow spool is full (topic: [%s])",
+             topic.c_str());
+    }
+  }
+}
+
 TMsg::TPtr Dory::InputDg::TryCreateAnyPartitionMsg(int64_t timestamp,
     const char *topic_begin, const char *topic_end, const void *key_begin,
     size_t key_size, const void *value_begin, size_t value_size,
     Capped::TPool &pool, TAnomalyTracker &anomaly_tracker,
-    TMsgStateTracker &msg_state_tracker, bool no_log_discard) {
+    TMsgStateTracker &msg_state_tracker, TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota, bool no_log_discard) {
   assert(topic_begin);
   assert(topic_end > topic_begin);
   assert(key_begin);
   assert(value_begin);
+  TTopicQuota::TCharge charge;
+
+  if (topic_quota &&
+      !topic_quota->TryCharge(topic_begin, topic_end, key_size + value_size,
+          charge)) {
+    DiscardMsgTopicQuota(timestamp, topic_begin, topic_end, key_begin,
+        reinterpret_cast<const uint8_t *>(key_begin) + key_size, value_begin,
+        reinterpret_cast<const uint8_t *>(value_begin) + value_size,
+        anomaly_tracker, no_log_discard);
+    return TMsg::TPtr();
+  }
+
+  if (SpoolInOrder(overflow_spool)) {
+    if (overflow_spool->TryPut(TMsg::TRoutingType::AnyPartition, 0,
+            timestamp, topic_begin, topic_end, key_begin, key_size,
+            value_begin, value_size)) {
+      InputAgentSpoolMsg.Increment();
+    } else {
+      DiscardMsgSpoolFull(timestamp, topic_begin, topic_end, key_begin,
+          key_size, value_begin, value_size, anomaly_tracker,
+          no_log_discard);
+    }
+
+    return TMsg::TPtr();
+  }
+
   TMsg::TPtr msg;
 
   try {
@@ -98,10 +192,20 @@ TMsg::TPtr Dory::InputDg::TryCreateAnyPartitionMsg(int64_t timestamp,
         key_begin, key_size, value_begin, value_size, false, pool,
         msg_state_tracker);
   } catch (const TMemoryCapReached &) {
-    /* Memory cap prevented message creation.  Report discard below. */
+    /* Memory cap prevented message creation.  Spool the message if possible,
+       or report discard below. */
+    if (overflow_spool &&
+        overflow_spool->TryPut(TMsg::TRoutingType::AnyPartition, 0, timestamp,
+            topic_begin, topic_end, key_begin, key_size, value_begin,
+            value_size)) {
+      InputAgentSpoolMsg.Increment();
+      return TMsg::TPtr();
+    }
   }
 
-  if (!msg) {
+  if (msg) {
+    msg->SetQuotaCharge(std::move(charge));
+  } else {
     DiscardMsgNoMem(timestamp, topic_begin, topic_end, key_begin,
         reinterpret_cast<const uint8_t *>(key_begin) + key_size, value_begin,
         reinterpret_cast<const uint8_t *>(value_begin) + value_size,
@@ -115,11 +219,38 @@ TMsg::TPtr Dory::InputDg::TryCreatePartitionKeyMsg(int32_t partition_key,
     int64_t timestamp, const char *topic_begin, const char *topic_end,
     const void *key_begin, size_t key_size, const void *value_begin,
     size_t value_size, Capped::TPool &pool, TAnomalyTracker &anomaly_tracker,
-    TMsgStateTracker &msg_state_tracker, bool no_log_discard) {
+    TMsgStateTracker &msg_state_tracker, TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota, bool no_log_discard) {
   assert(topic_begin);
   assert(topic_end > topic_begin);
   assert(key_begin);
   assert(value_begin);
+  TTopicQuota::TCharge charge;
+
+  if (topic_quota &&
+      !topic_quota->TryCharge(topic_begin, topic_end, key_size + value_size,
+          charge)) {
+    DiscardMsgTopicQuota(timestamp, topic_begin, topic_end, key_begin,
+        reinterpret_cast<const uint8_t *>(key_begin) + key_size, value_begin,
+        reinterpret_cast<const uint8_t *>(value_begin) + value_size,
+        anomaly_tracker, no_log_discard);
+    return TMsg::TPtr();
+  }
+
+  if (SpoolInOrder(overflow_spool)) {
+    if (overflow_spool->TryPut(TMsg::TRoutingType::PartitionKey,
+            partition_key, timestamp, topic_begin, topic_end, key_begin,
+            key_size, value_begin, value_size)) {
+      InputAgentSpoolMsg.Increment();
+    } else {
+      DiscardMsgSpoolFull(timestamp, topic_begin, topic_end, key_begin,
+          key_size, value_begin, value_size, anomaly_tracker,
+          no_log_discard);
+    }
+
+    return TMsg::TPtr();
+  }
+
   TMsg::TPtr msg;
 
   try {
@@ -127,10 +258,20 @@ TMsg::TPtr Dory::InputDg::TryCreatePartitionKeyMsg(int32_t partition_key,
         topic_begin, topic_end, key_begin, key_size, value_begin, value_size,
         false, pool, msg_state_tracker);
   } catch (const TMemoryCapReached &) {
-    /* Memory cap prevented message creation.  Report discard below. */
+    /* Memory cap prevented message creation.  Spool the message if possible,
+       or report discard below. */
+    if (overflow_spool &&
+        overflow_spool->TryPut(TMsg::TRoutingType::PartitionKey,
+            partition_key, timestamp, topic_begin, topic_end, key_begin,
+            key_size, value_begin, value_size)) {
+      InputAgentSpoolMsg.Increment();
+      return TMsg::TPtr();
+    }
   }
 
-  if (!msg) {
+  if (msg) {
+    msg->SetQuotaCharge(std::move(charge));
+  } else {
     DiscardMsgNoMem(timestamp, topic_begin, topic_end, key_begin,
         reinterpret_cast<const uint8_t *>(key_begin) + key_size, value_begin,
         reinterpret_cast<const uint8_t *>(value_begin) + value_size,
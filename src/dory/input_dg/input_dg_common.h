@@ -29,6 +29,8 @@
 #include <dory/anomaly_tracker.h>
 #include <dory/msg.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
 
 namespace Dory {
 
@@ -42,17 +44,34 @@ namespace Dory {
         const void *value_begin, const void *value_end,
         TAnomalyTracker &anomaly_tracker, bool no_log_discard);
 
+    void DiscardMsgTopicQuota(TMsg::TTimestamp timestamp,
+        const char *topic_begin, const char *topic_end, const void *key_begin,
+        const void *key_end, const void *value_begin, const void *value_end,
+        TAnomalyTracker &anomaly_tracker, bool no_log_discard);
+
+    /* Returns an empty TMsg::TPtr if there is not enough buffer space to
+       create the message.  In that case, the message is handed to
+       'overflow_spool' if not null.  If that fails too, the message is
+       discarded.  While 'overflow_spool' holds messages, new messages are
+       also handed to it, so the router thread gets messages in the order
+       they arrived.  If the spool can't take them, they are discarded
+       rather than passed ahead of the spooled messages.  If 'topic_quota'
+       is not null and the message's topic is over its buffer quota, the
+       message is discarded without trying the buffer pool or the spool. */
     TMsg::TPtr TryCreateAnyPartitionMsg(int64_t timestamp,
         const char *topic_begin, const char *topic_end, const void *key_begin,
         size_t key_size, const void *value_begin, size_t value_size,
         Capped::TPool &pool, TAnomalyTracker &anomaly_tracker,
-        TMsgStateTracker &msg_state_tracker, bool no_log_discard);
+        TMsgStateTracker &msg_state_tracker,
+        Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
+        bool no_log_discard);
 
     TMsg::TPtr TryCreatePartitionKeyMsg(int32_t partition_key,
         int64_t timestamp, const char *topic_begin, const char *topic_end,
         const void *key_begin, size_t key_size, const void *value_begin,
         size_t value_size, Capped::TPool &pool,
         TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
+        Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
         bool no_log_discard);
 
   }  // InputDg
@@ -23,6 +23,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <utility>
 
 #include <syslog.h>
 
@@ -31,6 +32,7 @@
 #include <dory/input_dg/input_dg_common.h>
 #include <dory/input_dg/input_dg_constants.h>
 #include <dory/input_dg/partition_key/partition_key_util.h>
+#include <dory/input_dg/v1/v1_input_dg_reader.h>
 #include <dory/util/time_util.h>
 #include <server/counter.h>
 
@@ -39,13 +41,15 @@ using namespace Dory;
 using namespace Dory::InputDg;
 using namespace Dory::InputDg::AnyPartition;
 using namespace Dory::InputDg::PartitionKey;
+using namespace Dory::InputDg::V1;
 using namespace Dory::Util;
 
 SERVER_COUNTER(InputAgentDiscardMsgUnsupportedApiKey);
 
 TMsg::TPtr Dory::InputDg::BuildMsgFromDg(const void *dg, size_t dg_size,
     const TConfig &config, Capped::TPool &pool,
-    TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker) {
+    TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
+    Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota) {
   assert(dg);
   const uint8_t *dg_bytes = reinterpret_cast<const uint8_t *>(dg);
   size_t fixed_part_size = INPUT_DG_SZ_FIELD_SIZE +
@@ -76,12 +80,14 @@ TMsg::TPtr Dory::InputDg::BuildMsgFromDg(const void *dg, size_t dg_size,
     case 256: {
       return BuildAnyPartitionMsgFromDg(dg_bytes, dg_size, api_version,
           versioned_part_begin, versioned_part_end, pool, anomaly_tracker,
-          msg_state_tracker, config.NoLogDiscard);
+          msg_state_tracker, overflow_spool, topic_quota,
+          config.NoLogDiscard);
     }
     case 257: {
       return BuildPartitionKeyMsgFromDg(dg_bytes, dg_size, api_version,
           versioned_part_begin, versioned_part_end, pool, anomaly_tracker,
-          msg_state_tracker, config.NoLogDiscard);
+          msg_state_tracker, overflow_spool, topic_quota,
+          config.NoLogDiscard);
     }
     default: {
       break;
@@ -102,3 +108,42 @@ TMsg::TPtr Dory::InputDg::BuildMsgFromDg(const void *dg, size_t dg_size,
   InputAgentDiscardMsgUnsupportedApiKey.Increment();
   return TMsg::TPtr();
 }
+
+void Dory::InputDg::BuildMsgsFromDg(const void *dg, size_t dg_size,
+    const TConfig &config, Capped::TPool &pool,
+    TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
+    std::list<TMsg::TPtr> &msg_list, Spool::TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota) {
+  assert(dg);
+  const uint8_t *dg_bytes = reinterpret_cast<const uint8_t *>(dg);
+  size_t fixed_part_size = INPUT_DG_SZ_FIELD_SIZE +
+      INPUT_DG_API_KEY_FIELD_SIZE + INPUT_DG_API_VERSION_FIELD_SIZE;
+
+  /* Anything other than a well formed batch datagram header is handled
+     (and possibly discarded) by BuildMsgFromDg(). */
+  if ((dg_size >= fixed_part_size) &&
+      (ReadInt32FromHeader(dg_bytes) == static_cast<int32_t>(dg_size))) {
+    int16_t api_key = ReadInt16FromHeader(dg_bytes + INPUT_DG_SZ_FIELD_SIZE);
+    size_t key_part_size = INPUT_DG_SZ_FIELD_SIZE +
+        INPUT_DG_API_KEY_FIELD_SIZE;
+    int16_t api_version = ReadInt16FromHeader(dg_bytes + key_part_size);
+
+    if (((api_key == 256) || (api_key == 257)) && (api_version == 1)) {
+      TV1InputDgReader reader(dg_bytes, dg_bytes + fixed_part_size,
+          dg_bytes + dg_size, (api_key == 256) ?
+              TMsg::TRoutingType::AnyPartition :
+              TMsg::TRoutingType::PartitionKey,
+          pool, anomaly_tracker, msg_state_tracker, overflow_spool,
+          topic_quota, config.NoLogDiscard);
+      reader.BuildMsgs(msg_list);
+      return;
+    }
+  }
+
+  TMsg::TPtr msg = BuildMsgFromDg(dg, dg_size, config, pool, anomaly_tracker,
+      msg_state_tracker, overflow_spool, topic_quota);
+
+  if (msg) {
+    msg_list.push_back(std::move(msg));
+  }
+}
@@ -23,20 +23,40 @@
 #pragma once
 
 #include <cstddef>
+#include <list>
 
 #include <capped/pool.h>
 #include <dory/anomaly_tracker.h>
 #include <dory/config.h>
 #include <dory/msg.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
 
 namespace Dory {
 
   namespace InputDg {
 
+    /* If 'overflow_spool' is not null, messages that can't be created due to
+       the buffer space cap are handed to it rather than discarded.  If
+       'topic_quota' is not null, messages are charged against their topics'
+       buffer quotas, and discarded if over quota. */
     TMsg::TPtr BuildMsgFromDg(const void *dg, size_t dg_size,
         const TConfig &config, Capped::TPool &pool,
-        TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker);
+        TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
+        Spool::TOverflowSpool *overflow_spool = nullptr,
+        TTopicQuota *topic_quota = nullptr);
+
+    /* Same as above, except that a version 1 (batch) datagram yields a
+       message for each of its records.  Built messages are appended to
+       'msg_list'.  Malformed records in a batch are discarded individually.
+     */
+    void BuildMsgsFromDg(const void *dg, size_t dg_size,
+        const TConfig &config, Capped::TPool &pool,
+        TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
+        std::list<TMsg::TPtr> &msg_list,
+        Spool::TOverflowSpool *overflow_spool = nullptr,
+        TTopicQuota *topic_quota = nullptr);
 
   }  // InputDg
 
@@ -32,6 +32,7 @@ using namespace Capped;
 using namespace Dory;
 using namespace Dory::InputDg;
 using namespace Dory::InputDg::PartitionKey;
+using namespace Dory::Spool;
 using namespace Dory::Util;
 
 SERVER_COUNTER(InputAgentDiscardPartitionKeyMsgUnsupportedApiVersion);
@@ -41,7 +42,8 @@ TMsg::TPtr Dory::InputDg::PartitionKey::BuildPartitionKeyMsgFromDg(
     const uint8_t *dg_bytes, size_t dg_size, int16_t api_version,
     const uint8_t *versioned_part_begin, const uint8_t *versioned_part_end,
     TPool &pool, TAnomalyTracker &anomaly_tracker,
-    TMsgStateTracker &msg_state_tracker, bool no_log_discard) {
+    TMsgStateTracker &msg_state_tracker, TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota, bool no_log_discard) {
   assert(dg_bytes);
   assert(versioned_part_begin > dg_bytes);
   assert(versioned_part_end > versioned_part_begin);
@@ -51,7 +53,8 @@ TMsg::TPtr Dory::InputDg::PartitionKey::BuildPartitionKeyMsgFromDg(
     case 0: {
       return V0::TV0InputDgReader(dg_bytes, versioned_part_begin,
           versioned_part_end, pool, anomaly_tracker,
-          msg_state_tracker, no_log_discard).BuildMsg();
+          msg_state_tracker, overflow_spool, topic_quota,
+          no_log_discard).BuildMsg();
     }
     default: {
       break;
@@ -133,5 +133,5 @@ TMsg::TPtr TV0InputDgReader::BuildMsg() {
   const uint8_t *value_begin = pos;
   return TryCreatePartitionKeyMsg(partition_key, ts, topic_begin, topic_end,
       key_begin, key_sz, value_begin, value_sz, Pool, AnomalyTracker,
-      MsgStateTracker, NoLogDiscard);
+      MsgStateTracker, OverflowSpool, TopicQuota, NoLogDiscard);
 }
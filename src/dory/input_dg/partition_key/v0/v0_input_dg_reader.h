@@ -33,6 +33,8 @@
 #include <dory/input_dg/partition_key/v0/v0_input_dg_constants.h>
 #include <dory/msg.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
 
 namespace Dory {
 
@@ -49,7 +51,9 @@ namespace Dory {
           TV0InputDgReader(const uint8_t *dg_begin,
               const uint8_t *data_begin, const uint8_t *data_end,
               Capped::TPool &pool, TAnomalyTracker &anomaly_tracker,
-              TMsgStateTracker &msg_state_tracker, bool no_log_discard)
+              TMsgStateTracker &msg_state_tracker,
+              Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
+              bool no_log_discard)
               : DgBegin(dg_begin),
                 DataBegin(data_begin),
                 DataEnd(data_end),
@@ -58,7 +62,9 @@ namespace Dory {
                 NoLogDiscard(no_log_discard),
                 Pool(pool),
                 AnomalyTracker(anomaly_tracker),
-                MsgStateTracker(msg_state_tracker) {
+                MsgStateTracker(msg_state_tracker),
+                OverflowSpool(overflow_spool),
+                TopicQuota(topic_quota) {
             assert(DgBegin);
             assert(DataBegin > DgBegin);
             assert(DataEnd >= DataBegin);
@@ -94,6 +100,14 @@ namespace Dory {
           TAnomalyTracker &AnomalyTracker;
 
           TMsgStateTracker &MsgStateTracker;
+
+          /* If not null, messages that don't fit in 'Pool' are handed to the
+             spool rather than discarded. */
+          Spool::TOverflowSpool * const OverflowSpool;
+
+          /* If not null, messages are charged against their topics' buffer
+             quotas. */
+          TTopicQuota * const TopicQuota;
         };  // class TV0InputDgReader
 
       }  // V0
@@ -0,0 +1,36 @@
+/* <dory/input_dg/partition_key/v1/v1_write_msg.c>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/input_dg/partition_key/v1/v1_write_msg.h>.
+ */
+
+#include <dory/input_dg/partition_key/v1/v1_write_msg.h>
+
+int input_dg_p_key_v1_compute_msg_size(size_t *result,
+    const input_dg_v1_topic_t *topics, size_t topic_count,
+    const input_dg_v1_msg_t *msgs, size_t msg_count) {
+  return input_dg_v1_compute_batch_size(result, 1, topics, topic_count,
+      msgs, msg_count);
+}
+
+void input_dg_p_key_v1_write_msg(void *result_buf,
+    const input_dg_v1_topic_t *topics, size_t topic_count,
+    const input_dg_v1_msg_t *msgs, size_t msg_count) {
+  input_dg_v1_write_batch(result_buf, 257, 1, topics, topic_count, msgs,
+      msg_count);
+}
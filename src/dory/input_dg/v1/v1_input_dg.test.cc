@@ -0,0 +1,371 @@
+/* <dory/input_dg/v1/v1_input_dg.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/input_dg/v1/v1_input_dg_reader.h>,
+   <dory/input_dg/any_partition/v1/v1_write_msg.h>, and
+   <dory/input_dg/partition_key/v1/v1_write_msg.h>.
+ */
+
+#include <dory/input_dg/input_dg_util.h>
+#include <dory/input_dg/any_partition/v1/v1_write_msg.h>
+#include <dory/input_dg/partition_key/v1/v1_write_msg.h>
+
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/field_access.h>
+#include <capped/pool.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/client/status_codes.h>
+#include <dory/conf/topic_quota_conf.h>
+#include <dory/config.h>
+#include <dory/input_dg/input_dg_constants.h>
+#include <dory/input_dg/v1/v1_input_dg_constants.h>
+#include <dory/msg.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/test_util/misc_util.h>
+#include <dory/topic_quota.h>
+
+#include <gtest/gtest.h>
+
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::InputDg;
+using namespace Dory::TestUtil;
+
+namespace {
+
+  struct TTestConfig {
+    std::vector<const char *> Args;
+
+    std::unique_ptr<Dory::TConfig> Cfg;
+
+    std::unique_ptr<TPool> Pool;
+
+    TDiscardFileLogger DiscardFileLogger;
+
+    TAnomalyTracker AnomalyTracker;
+
+    TMsgStateTracker MsgStateTracker;
+
+    TTestConfig();
+
+    size_t GetMalformedCount() {
+      TAnomalyTracker::TInfo info;
+      AnomalyTracker.GetInfo(info);
+      return info.MalformedMsgCount;
+    }
+  };  // TTestConfig
+
+  TTestConfig::TTestConfig()
+      : Pool(new TPool(128, 16384, TPool::TSync::Mutexed)),
+        AnomalyTracker(DiscardFileLogger, 0,
+                       std::numeric_limits<size_t>::max()) {
+    Args.push_back("dory");
+    Args.push_back("--config_path");
+    Args.push_back("/nonexistent/path");
+    Args.push_back("--msg_buffer_max");
+    Args.push_back("1");  // dummy value
+    Args.push_back("--receive_socket_name");
+    Args.push_back("dummy_value");
+    Args.push_back(nullptr);
+    Cfg.reset(new Dory::TConfig(Args.size() - 1, const_cast<char **>(&Args[0]),
+        true));
+  }
+
+  input_dg_v1_topic_t MakeTopic(const std::string &topic) {
+    input_dg_v1_topic_t result;
+    result.topic_begin = topic.data();
+    result.topic_end = topic.data() + topic.size();
+    return result;
+  }
+
+  input_dg_v1_msg_t MakeMsg(size_t topic_index, int64_t timestamp,
+      int32_t partition_key, const std::string &key,
+      const std::string &value) {
+    input_dg_v1_msg_t result;
+    result.topic_index = topic_index;
+    result.timestamp = timestamp;
+    result.partition_key = partition_key;
+    result.key_begin = key.data();
+    result.key_end = key.data() + key.size();
+    result.value_begin = value.data();
+    result.value_end = value.data() + value.size();
+    return result;
+  }
+
+  /* Return offset of first record in an AnyPartition datagram written with
+     the given topics. */
+  size_t GetFirstRecordOffset(const std::vector<std::string> &topics) {
+    size_t offset = INPUT_DG_SZ_FIELD_SIZE + INPUT_DG_API_KEY_FIELD_SIZE +
+        INPUT_DG_API_VERSION_FIELD_SIZE + INPUT_DG_V1_FLAGS_FIELD_SIZE +
+        INPUT_DG_V1_TOPIC_COUNT_FIELD_SIZE;
+
+    for (const std::string &topic : topics) {
+      offset += INPUT_DG_V1_TOPIC_SZ_FIELD_SIZE + topic.size();
+    }
+
+    return offset;
+  }
+
+  /* The fixture for testing reading/writing of v1 (batch) input datagrams.
+   */
+  class TV1InputDgTest : public ::testing::Test {
+    protected:
+    TV1InputDgTest() {
+    }
+
+    virtual ~TV1InputDgTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TV1InputDgTest
+
+  TEST_F(TV1InputDgTest, AnyPartition) {
+    TTestConfig cfg;
+    std::vector<std::string> topic_names = { "topic1", "topic2" };
+    std::vector<input_dg_v1_topic_t> topics;
+
+    for (const std::string &topic : topic_names) {
+      topics.push_back(MakeTopic(topic));
+    }
+
+    std::string key1("key1"), key2(""), key3("key3");
+    std::string value1("value1"), value2("value2"), value3("");
+    std::vector<input_dg_v1_msg_t> msgs;
+    msgs.push_back(MakeMsg(1, 101, 0, key1, value1));
+    msgs.push_back(MakeMsg(0, 102, 0, key2, value2));
+    msgs.push_back(MakeMsg(1, 103, 0, key3, value3));
+    size_t dg_size = 0;
+    int result = input_dg_any_p_v1_compute_msg_size(&dg_size, &topics[0],
+        topics.size(), &msgs[0], msgs.size());
+    ASSERT_EQ(result, DORY_OK);
+    std::vector<uint8_t> buf(dg_size);
+    input_dg_any_p_v1_write_msg(&buf[0], &topics[0], topics.size(), &msgs[0],
+        msgs.size());
+    std::list<TMsg::TPtr> msg_list;
+    BuildMsgsFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker, msg_list);
+    ASSERT_EQ(msg_list.size(), 3U);
+
+    for (TMsg::TPtr &msg : msg_list) {
+      SetProcessed(msg);
+      ASSERT_TRUE(msg->GetRoutingType() == TMsg::TRoutingType::AnyPartition);
+    }
+
+    auto iter = msg_list.begin();
+    ASSERT_EQ((*iter)->GetTimestamp(), 101);
+    ASSERT_EQ((*iter)->GetTopic(), "topic2");
+    ASSERT_TRUE(KeyEquals(*iter, key1));
+    ASSERT_TRUE(ValueEquals(*iter, value1));
+    ++iter;
+    ASSERT_EQ((*iter)->GetTimestamp(), 102);
+    ASSERT_EQ((*iter)->GetTopic(), "topic1");
+    ASSERT_TRUE(KeyEquals(*iter, key2));
+    ASSERT_TRUE(ValueEquals(*iter, value2));
+    ++iter;
+    ASSERT_EQ((*iter)->GetTimestamp(), 103);
+    ASSERT_EQ((*iter)->GetTopic(), "topic2");
+    ASSERT_TRUE(KeyEquals(*iter, key3));
+    ASSERT_TRUE(ValueEquals(*iter, value3));
+    ASSERT_EQ(cfg.GetMalformedCount(), 0U);
+
+    /* A batch datagram is not accepted where a single message is
+       expected. */
+    TMsg::TPtr msg = BuildMsgFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker);
+    ASSERT_FALSE(!!msg);
+  }
+
+  TEST_F(TV1InputDgTest, TopicQuota) {
+    TTestConfig cfg;
+    Conf::TTopicQuotaConf::TBuilder b;
+    b.AddBoundedNamedConfig("default", 12);
+    b.SetDefaultTopicConfig("default");
+    TTopicQuota quota(b.Build());
+    std::vector<std::string> topic_names = { "topic1", "topic2" };
+    std::vector<input_dg_v1_topic_t> topics;
+
+    for (const std::string &topic : topic_names) {
+      topics.push_back(MakeTopic(topic));
+    }
+
+    std::string key(""), value("value1");
+    std::vector<input_dg_v1_msg_t> msgs;
+    msgs.push_back(MakeMsg(0, 1, 0, key, value));
+    msgs.push_back(MakeMsg(0, 2, 0, key, value));
+    msgs.push_back(MakeMsg(0, 3, 0, key, value));
+    msgs.push_back(MakeMsg(1, 4, 0, key, value));
+    size_t dg_size = 0;
+    ASSERT_EQ(input_dg_any_p_v1_compute_msg_size(&dg_size, &topics[0],
+        topics.size(), &msgs[0], msgs.size()), DORY_OK);
+    std::vector<uint8_t> buf(dg_size);
+    input_dg_any_p_v1_write_msg(&buf[0], &topics[0], topics.size(), &msgs[0],
+        msgs.size());
+    std::list<TMsg::TPtr> msg_list;
+    BuildMsgsFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker, msg_list, nullptr, &quota);
+
+    /* The third message for "topic1" exceeds the topic's quota, but the
+       message for "topic2" is unaffected. */
+    ASSERT_EQ(msg_list.size(), 3U);
+
+    for (TMsg::TPtr &msg : msg_list) {
+      SetProcessed(msg);
+    }
+
+    ASSERT_EQ(msg_list.back()->GetTopic(), "topic2");
+    TAnomalyTracker::TInfo info;
+    cfg.AnomalyTracker.GetInfo(info);
+    ASSERT_EQ(info.TopicQuotaDiscardMap.size(), 1U);
+    ASSERT_EQ(info.TopicQuotaDiscardMap["topic1"], 1U);
+    ASSERT_EQ(info.DiscardTopicMap.size(), 1U);
+
+    /* Destroying the messages returns their bytes to the topic quotas. */
+    msg_list.clear();
+
+    for (const auto &s : quota.GetTopicStats()) {
+      ASSERT_EQ(s.UsedBytes, 0U);
+    }
+  }
+
+  TEST_F(TV1InputDgTest, PartitionKey) {
+    TTestConfig cfg;
+    std::string topic_name("topic");
+    input_dg_v1_topic_t topic = MakeTopic(topic_name);
+    std::string key("key"), value1("value1"), value2("value2");
+    std::vector<input_dg_v1_msg_t> msgs;
+    msgs.push_back(MakeMsg(0, 1, 12345, key, value1));
+    msgs.push_back(MakeMsg(0, 2, -7, key, value2));
+    size_t dg_size = 0;
+    ASSERT_EQ(input_dg_p_key_v1_compute_msg_size(&dg_size, &topic, 1,
+        &msgs[0], msgs.size()), DORY_OK);
+    std::vector<uint8_t> buf(dg_size);
+    input_dg_p_key_v1_write_msg(&buf[0], &topic, 1, &msgs[0], msgs.size());
+    std::list<TMsg::TPtr> msg_list;
+    BuildMsgsFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker, msg_list);
+    ASSERT_EQ(msg_list.size(), 2U);
+
+    for (TMsg::TPtr &msg : msg_list) {
+      SetProcessed(msg);
+      ASSERT_TRUE(msg->GetRoutingType() == TMsg::TRoutingType::PartitionKey);
+      ASSERT_EQ(msg->GetTopic(), topic_name);
+      ASSERT_TRUE(KeyEquals(msg, key));
+    }
+
+    ASSERT_EQ(msg_list.front()->GetPartitionKey(), 12345);
+    ASSERT_TRUE(ValueEquals(msg_list.front(), value1));
+    ASSERT_EQ(msg_list.back()->GetPartitionKey(), -7);
+    ASSERT_TRUE(ValueEquals(msg_list.back(), value2));
+  }
+
+  TEST_F(TV1InputDgTest, MalformedRecord) {
+    TTestConfig cfg;
+    std::vector<std::string> topic_names = { "topic" };
+    input_dg_v1_topic_t topic = MakeTopic(topic_names[0]);
+    std::string key(""), value1("value1"), value2("value2"),
+        value3("value3");
+    std::vector<input_dg_v1_msg_t> msgs;
+    msgs.push_back(MakeMsg(0, 1, 0, key, value1));
+    msgs.push_back(MakeMsg(0, 2, 0, key, value2));
+    msgs.push_back(MakeMsg(0, 3, 0, key, value3));
+    size_t dg_size = 0;
+    ASSERT_EQ(input_dg_any_p_v1_compute_msg_size(&dg_size, &topic, 1,
+        &msgs[0], msgs.size()), DORY_OK);
+    std::vector<uint8_t> buf(dg_size);
+    input_dg_any_p_v1_write_msg(&buf[0], &topic, 1, &msgs[0], msgs.size());
+
+    /* Corrupt the topic index of the second record. */
+    size_t record_size = INPUT_DG_V1_RECORD_SZ_FIELD_SIZE +
+        INPUT_DG_V1_TOPIC_INDEX_FIELD_SIZE + INPUT_DG_V1_TS_FIELD_SIZE +
+        INPUT_DG_V1_KEY_SZ_FIELD_SIZE + INPUT_DG_V1_VALUE_SZ_FIELD_SIZE +
+        value1.size();
+    size_t second_record = GetFirstRecordOffset(topic_names) + record_size;
+    WriteInt16ToHeader(&buf[second_record + INPUT_DG_V1_RECORD_SZ_FIELD_SIZE],
+        5);
+    std::list<TMsg::TPtr> msg_list;
+    BuildMsgsFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker, msg_list);
+    ASSERT_EQ(msg_list.size(), 2U);
+    msg_list = SetProcessed(std::move(msg_list));
+    ASSERT_TRUE(ValueEquals(msg_list.front(), value1));
+    ASSERT_TRUE(ValueEquals(msg_list.back(), value3));
+    ASSERT_EQ(cfg.GetMalformedCount(), 1U);
+    msg_list.clear();
+
+    /* A record whose size runs past the end of the datagram loses only
+       itself and what follows. */
+    WriteInt16ToHeader(&buf[second_record + INPUT_DG_V1_RECORD_SZ_FIELD_SIZE],
+        0);
+    WriteInt32ToHeader(&buf[second_record], 1000);
+    BuildMsgsFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker, msg_list);
+    ASSERT_EQ(msg_list.size(), 1U);
+    msg_list = SetProcessed(std::move(msg_list));
+    ASSERT_TRUE(ValueEquals(msg_list.front(), value1));
+    ASSERT_EQ(cfg.GetMalformedCount(), 2U);
+    msg_list.clear();
+
+    /* A bad topic table loses the entire datagram. */
+    WriteInt32ToHeader(&buf[second_record], record_size -
+        INPUT_DG_V1_RECORD_SZ_FIELD_SIZE);
+    size_t topic_count_offset = INPUT_DG_SZ_FIELD_SIZE +
+        INPUT_DG_API_KEY_FIELD_SIZE + INPUT_DG_API_VERSION_FIELD_SIZE +
+        INPUT_DG_V1_FLAGS_FIELD_SIZE;
+    WriteInt16ToHeader(&buf[topic_count_offset], 100);
+    BuildMsgsFromDg(&buf[0], buf.size(), *cfg.Cfg, *cfg.Pool,
+        cfg.AnomalyTracker, cfg.MsgStateTracker, msg_list);
+    ASSERT_TRUE(msg_list.empty());
+    ASSERT_EQ(cfg.GetMalformedCount(), 3U);
+  }
+
+  TEST_F(TV1InputDgTest, WriterErrors) {
+    std::string topic_name("topic"), key("key"), value("value");
+    input_dg_v1_topic_t topic = MakeTopic(topic_name);
+    input_dg_v1_msg_t msg = MakeMsg(1, 0, 0, key, value);
+    size_t dg_size = 0;
+    ASSERT_EQ(input_dg_any_p_v1_compute_msg_size(&dg_size, &topic, 1, &msg,
+        1), DORY_INVALID_TOPIC_INDEX);
+    std::string big_topic(40000, 'x');
+    topic = MakeTopic(big_topic);
+    msg.topic_index = 0;
+    ASSERT_EQ(input_dg_any_p_v1_compute_msg_size(&dg_size, &topic, 1, &msg,
+        1), DORY_TOPIC_TOO_LARGE);
+
+    /* An empty batch is valid. */
+    ASSERT_EQ(input_dg_any_p_v1_compute_msg_size(&dg_size, nullptr, 0,
+        nullptr, 0), DORY_OK);
+    ASSERT_EQ(dg_size, GetFirstRecordOffset(std::vector<std::string>()));
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,45 @@
+/* <dory/input_dg/v1/v1_input_dg_constants.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Constants related to version 1 (batch) of the input datagram format.  The
+   format is shared by AnyPartition and PartitionKey datagrams, except that
+   records in PartitionKey datagrams have a partition key field.
+ */
+
+#pragma once
+
+/* It should be possible to compile everything in here with a C compiler.
+   That's why there are no namespaces below. */
+
+enum { INPUT_DG_V1_FLAGS_FIELD_SIZE = 2 };
+
+enum { INPUT_DG_V1_TOPIC_COUNT_FIELD_SIZE = 2 };
+
+enum { INPUT_DG_V1_TOPIC_SZ_FIELD_SIZE = 2 };
+
+enum { INPUT_DG_V1_RECORD_SZ_FIELD_SIZE = 4 };
+
+enum { INPUT_DG_V1_TOPIC_INDEX_FIELD_SIZE = 2 };
+
+enum { INPUT_DG_V1_TS_FIELD_SIZE = 8 };
+
+enum { INPUT_DG_V1_PARTITION_KEY_FIELD_SIZE = 4 };
+
+enum { INPUT_DG_V1_KEY_SZ_FIELD_SIZE = 4 };
+
+enum { INPUT_DG_V1_VALUE_SZ_FIELD_SIZE = 4 };
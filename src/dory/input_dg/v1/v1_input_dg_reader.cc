@@ -0,0 +1,214 @@
+/* <dory/input_dg/v1/v1_input_dg_reader.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/input_dg/v1/v1_input_dg_reader.h>.
+ */
+
+#include <dory/input_dg/v1/v1_input_dg_reader.h>
+
+#include <base/field_access.h>
+#include <dory/input_dg/input_dg_common.h>
+#include <server/counter.h>
+
+using namespace Dory;
+using namespace Dory::InputDg;
+using namespace Dory::InputDg::V1;
+
+SERVER_COUNTER(InputAgentProcessBatchDg);
+SERVER_COUNTER(InputAgentProcessBatchRecord);
+SERVER_COUNTER(InputAgentDiscardBatchRecordMalformed);
+
+void TV1InputDgReader::BuildMsgs(std::list<TMsg::TPtr> &msg_list) {
+  assert(this);
+  InputAgentProcessBatchDg.Increment();
+  const uint8_t *pos = DataBegin;
+
+  if ((DataEnd - pos) < INPUT_DG_V1_FLAGS_FIELD_SIZE) {
+    DiscardMalformedMsg(DgBegin, DgSize, AnomalyTracker, NoLogDiscard);
+    return;
+  }
+
+  int16_t flags = ReadInt16FromHeader(pos);
+
+  if (flags) {
+    DiscardMalformedMsg(DgBegin, DgSize, AnomalyTracker, NoLogDiscard);
+    return;
+  }
+
+  pos += INPUT_DG_V1_FLAGS_FIELD_SIZE;
+  pos = ReadTopicTable(pos);
+
+  if (pos == nullptr) {
+    DiscardMalformedMsg(DgBegin, DgSize, AnomalyTracker, NoLogDiscard);
+    return;
+  }
+
+  while (pos < DataEnd) {
+    InputAgentProcessBatchRecord.Increment();
+
+    if ((DataEnd - pos) < INPUT_DG_V1_RECORD_SZ_FIELD_SIZE) {
+      /* Trailing garbage too small to hold a record. */
+      InputAgentDiscardBatchRecordMalformed.Increment();
+      DiscardMalformedMsg(pos, DataEnd - pos, AnomalyTracker, NoLogDiscard);
+      break;
+    }
+
+    int32_t rec_sz = ReadInt32FromHeader(pos);
+
+    if ((rec_sz < 0) ||
+        ((DataEnd - pos - INPUT_DG_V1_RECORD_SZ_FIELD_SIZE) < rec_sz)) {
+      /* Without a valid size, the start of the next record is unknown, so
+         the rest of the datagram is lost. */
+      InputAgentDiscardBatchRecordMalformed.Increment();
+      DiscardMalformedMsg(pos, DataEnd - pos, AnomalyTracker, NoLogDiscard);
+      break;
+    }
+
+    const uint8_t *rec_begin = pos + INPUT_DG_V1_RECORD_SZ_FIELD_SIZE;
+    const uint8_t *rec_end = rec_begin + rec_sz;
+    TMsg::TPtr msg = BuildMsgFromRecord(rec_begin, rec_end);
+
+    if (msg) {
+      msg_list.push_back(std::move(msg));
+    }
+
+    pos = rec_end;
+  }
+}
+
+const uint8_t *TV1InputDgReader::ReadTopicTable(const uint8_t *pos) {
+  assert(this);
+
+  if ((DataEnd - pos) < INPUT_DG_V1_TOPIC_COUNT_FIELD_SIZE) {
+    return nullptr;
+  }
+
+  int16_t topic_count = ReadInt16FromHeader(pos);
+
+  if (topic_count < 0) {
+    return nullptr;
+  }
+
+  pos += INPUT_DG_V1_TOPIC_COUNT_FIELD_SIZE;
+  Topics.clear();
+  Topics.reserve(topic_count);
+
+  for (int16_t i = 0; i < topic_count; ++i) {
+    if ((DataEnd - pos) < INPUT_DG_V1_TOPIC_SZ_FIELD_SIZE) {
+      return nullptr;
+    }
+
+    int16_t topic_sz = ReadInt16FromHeader(pos);
+
+    if (topic_sz <= 0) {
+      return nullptr;
+    }
+
+    pos += INPUT_DG_V1_TOPIC_SZ_FIELD_SIZE;
+
+    if ((DataEnd - pos) < topic_sz) {
+      return nullptr;
+    }
+
+    const char *topic_begin = reinterpret_cast<const char *>(pos);
+    Topics.push_back(std::make_pair(topic_begin, topic_begin + topic_sz));
+    pos += topic_sz;
+  }
+
+  return pos;
+}
+
+TMsg::TPtr TV1InputDgReader::BuildMsgFromRecord(const uint8_t *rec_begin,
+    const uint8_t *rec_end) {
+  assert(this);
+  const uint8_t *pos = rec_begin;
+  const bool has_partition_key =
+      (RoutingType == TMsg::TRoutingType::PartitionKey);
+  const ptrdiff_t fixed_sz = INPUT_DG_V1_TOPIC_INDEX_FIELD_SIZE +
+      INPUT_DG_V1_TS_FIELD_SIZE +
+      (has_partition_key ? INPUT_DG_V1_PARTITION_KEY_FIELD_SIZE : 0) +
+      INPUT_DG_V1_KEY_SZ_FIELD_SIZE;
+
+  /* On error, discard the record including its size field. */
+  const uint8_t *discard_begin = rec_begin - INPUT_DG_V1_RECORD_SZ_FIELD_SIZE;
+  size_t discard_size = rec_end - discard_begin;
+
+  if ((rec_end - pos) < fixed_sz) {
+    InputAgentDiscardBatchRecordMalformed.Increment();
+    DiscardMalformedMsg(discard_begin, discard_size, AnomalyTracker,
+        NoLogDiscard);
+    return TMsg::TPtr();
+  }
+
+  int16_t topic_index = ReadInt16FromHeader(pos);
+  pos += INPUT_DG_V1_TOPIC_INDEX_FIELD_SIZE;
+  int64_t ts = ReadInt64FromHeader(pos);
+  pos += INPUT_DG_V1_TS_FIELD_SIZE;
+  int32_t partition_key = 0;
+
+  if (has_partition_key) {
+    partition_key = ReadInt32FromHeader(pos);
+    pos += INPUT_DG_V1_PARTITION_KEY_FIELD_SIZE;
+  }
+
+  int32_t key_sz = ReadInt32FromHeader(pos);
+  pos += INPUT_DG_V1_KEY_SZ_FIELD_SIZE;
+
+  if ((topic_index < 0) ||
+      (static_cast<size_t>(topic_index) >= Topics.size()) || (key_sz < 0) ||
+      ((rec_end - pos) < key_sz)) {
+    InputAgentDiscardBatchRecordMalformed.Increment();
+    DiscardMalformedMsg(discard_begin, discard_size, AnomalyTracker,
+        NoLogDiscard);
+    return TMsg::TPtr();
+  }
+
+  const uint8_t *key_begin = pos;
+  pos += key_sz;
+
+  if ((rec_end - pos) < INPUT_DG_V1_VALUE_SZ_FIELD_SIZE) {
+    InputAgentDiscardBatchRecordMalformed.Increment();
+    DiscardMalformedMsg(discard_begin, discard_size, AnomalyTracker,
+        NoLogDiscard);
+    return TMsg::TPtr();
+  }
+
+  int32_t value_sz = ReadInt32FromHeader(pos);
+  pos += INPUT_DG_V1_VALUE_SZ_FIELD_SIZE;
+
+  if ((value_sz < 0) || ((rec_end - pos) != value_sz)) {
+    InputAgentDiscardBatchRecordMalformed.Increment();
+    DiscardMalformedMsg(discard_begin, discard_size, AnomalyTracker,
+        NoLogDiscard);
+    return TMsg::TPtr();
+  }
+
+  const uint8_t *value_begin = pos;
+  const auto &topic = Topics[topic_index];
+
+  if (has_partition_key) {
+    return TryCreatePartitionKeyMsg(partition_key, ts, topic.first,
+        topic.second, key_begin, key_sz, value_begin, value_sz, Pool,
+        AnomalyTracker, MsgStateTracker, OverflowSpool, TopicQuota,
+        NoLogDiscard);
+  }
+
+  return TryCreateAnyPartitionMsg(ts, topic.first, topic.second, key_begin,
+      key_sz, value_begin, value_sz, Pool, AnomalyTracker, MsgStateTracker,
+      OverflowSpool, TopicQuota, NoLogDiscard);
+}
@@ -0,0 +1,137 @@
+/* <dory/input_dg/v1/v1_input_dg_reader.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for reading datagram from dory's input socket that conforms to
+   version 1 (batch) of the input format for AnyPartition or PartitionKey
+   messages.  Builds a TMsg for each record in the datagram.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <capped/pool.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/input_dg/v1/v1_input_dg_constants.h>
+#include <dory/msg.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
+
+namespace Dory {
+
+  namespace InputDg {
+
+    namespace V1 {
+
+      class TV1InputDgReader final {
+        NO_COPY_SEMANTICS(TV1InputDgReader);
+
+        public:
+        TV1InputDgReader(const uint8_t *dg_begin, const uint8_t *data_begin,
+            const uint8_t *data_end, TMsg::TRoutingType routing_type,
+            Capped::TPool &pool, TAnomalyTracker &anomaly_tracker,
+            TMsgStateTracker &msg_state_tracker,
+            Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
+            bool no_log_discard)
+            : DgBegin(dg_begin),
+              DataBegin(data_begin),
+              DataEnd(data_end),
+              DgSize(data_end - dg_begin),
+              RoutingType(routing_type),
+              NoLogDiscard(no_log_discard),
+              Pool(pool),
+              AnomalyTracker(anomaly_tracker),
+              MsgStateTracker(msg_state_tracker),
+              OverflowSpool(overflow_spool),
+              TopicQuota(topic_quota) {
+          assert(DgBegin);
+          assert(DataBegin > DgBegin);
+          assert(DataEnd >= DataBegin);
+        }
+
+        /* Append a message to 'msg_list' for each record in the datagram.
+           A malformed record is discarded by itself, and the records
+           around it are still processed.  If the header or topic table is
+           malformed, the entire datagram is discarded. */
+        void BuildMsgs(std::list<TMsg::TPtr> &msg_list);
+
+        private:
+        /* Read topic table starting at 'pos' into 'Topics'.  On success,
+           return pointer to first byte after table.  Return nullptr if
+           table is malformed. */
+        const uint8_t *ReadTopicTable(const uint8_t *pos);
+
+        /* Build a message from the record whose fields (following the size
+           field) occupy [rec_begin, rec_end).  Return an empty TMsg::TPtr
+           if the record was discarded. */
+        TMsg::TPtr BuildMsgFromRecord(const uint8_t *rec_begin,
+            const uint8_t *rec_end);
+
+        /* Points to first byte of input datagram. */
+        const uint8_t * const DgBegin;
+
+        /* Points to first byte of version-specific part of input
+           datagram. */
+        const uint8_t * const DataBegin;
+
+        /* Points one byte past last byte of input datagram. */
+        const uint8_t * const DataEnd;
+
+        /* Size in bytes of input datagram. */
+        const size_t DgSize;
+
+        /* AnyPartition or PartitionKey, as given by the API key.  Records
+           have a partition key field only in the latter case. */
+        const TMsg::TRoutingType RoutingType;
+
+        bool NoLogDiscard;
+
+        /* Pool to allocate space for TMsg objects we are building from
+           input datagram. */
+        Capped::TPool &Pool;
+
+        /* Records discarded while building messages are recorded here. */
+        TAnomalyTracker &AnomalyTracker;
+
+        TMsgStateTracker &MsgStateTracker;
+
+        /* If not null, messages that don't fit in 'Pool' are handed to the
+           spool rather than discarded. */
+        Spool::TOverflowSpool * const OverflowSpool;
+
+        /* If not null, messages are charged against their topics' buffer
+           quotas. */
+        TTopicQuota * const TopicQuota;
+
+        /* Topic table from datagram header.  Each item gives the beginning
+           and end of a topic. */
+        std::vector<std::pair<const char *, const char *>> Topics;
+      };  // class TV1InputDgReader
+
+    }  // V1
+
+  }  // InputDg
+
+}  // Dory
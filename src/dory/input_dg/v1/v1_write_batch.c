@@ -0,0 +1,180 @@
+/* <dory/input_dg/v1/v1_write_batch.c>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/input_dg/v1/v1_write_batch.h>.
+ */
+
+#include <dory/input_dg/v1/v1_write_batch.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <base/field_access.h>
+#include <dory/input_dg/input_dg_constants.h>
+#include <dory/input_dg/v1/v1_input_dg_constants.h>
+
+static inline size_t get_header_size() {
+  return INPUT_DG_SZ_FIELD_SIZE + INPUT_DG_API_KEY_FIELD_SIZE +
+      INPUT_DG_API_VERSION_FIELD_SIZE + INPUT_DG_V1_FLAGS_FIELD_SIZE +
+      INPUT_DG_V1_TOPIC_COUNT_FIELD_SIZE;
+}
+
+/* Return size of a record, not including its size field, with empty key and
+   value. */
+static inline size_t get_record_overhead(int with_partition_key) {
+  return INPUT_DG_V1_TOPIC_INDEX_FIELD_SIZE + INPUT_DG_V1_TS_FIELD_SIZE +
+      (with_partition_key ? INPUT_DG_V1_PARTITION_KEY_FIELD_SIZE : 0) +
+      INPUT_DG_V1_KEY_SZ_FIELD_SIZE + INPUT_DG_V1_VALUE_SZ_FIELD_SIZE;
+}
+
+static inline size_t get_size(const void *begin, const void *end) {
+  assert(begin || (end == begin));
+  assert(end >= begin);
+  return ((const uint8_t *) end) - ((const uint8_t *) begin);
+}
+
+int input_dg_v1_compute_batch_size(size_t *result, int with_partition_key,
+    const input_dg_v1_topic_t *topics, size_t topic_count,
+    const input_dg_v1_msg_t *msgs, size_t msg_count) {
+  assert(result);
+  assert(topics || (topic_count == 0));
+  assert(msgs || (msg_count == 0));
+  *result = 0;
+
+  if (topic_count > INT16_MAX) {
+    return DORY_MSG_TOO_LARGE;
+  }
+
+  /* Neither 'size' nor any of the terms added to it below may exceed
+     INT32_MAX, so the additions can't overflow. */
+  size_t size = get_header_size();
+  size_t i = 0;
+
+  for (i = 0; i < topic_count; ++i) {
+    size_t topic_size = get_size(topics[i].topic_begin, topics[i].topic_end);
+
+    if (topic_size > INT16_MAX) {
+      return DORY_TOPIC_TOO_LARGE;
+    }
+
+    size += INPUT_DG_V1_TOPIC_SZ_FIELD_SIZE + topic_size;
+
+    if (size > INT32_MAX) {
+      return DORY_MSG_TOO_LARGE;
+    }
+  }
+
+  size_t record_overhead = INPUT_DG_V1_RECORD_SZ_FIELD_SIZE +
+      get_record_overhead(with_partition_key);
+
+  for (i = 0; i < msg_count; ++i) {
+    if (msgs[i].topic_index >= topic_count) {
+      return DORY_INVALID_TOPIC_INDEX;
+    }
+
+    size_t key_size = get_size(msgs[i].key_begin, msgs[i].key_end);
+    size_t value_size = get_size(msgs[i].value_begin, msgs[i].value_end);
+    size_t space = INT32_MAX - size;
+
+    if ((record_overhead > space) || (key_size > (space - record_overhead)) ||
+        (value_size > (space - record_overhead - key_size))) {
+      return DORY_MSG_TOO_LARGE;
+    }
+
+    size += record_overhead + key_size + value_size;
+  }
+
+  *result = size;
+  return DORY_OK;
+}
+
+void input_dg_v1_write_batch(void *result_buf, int16_t api_key,
+    int with_partition_key, const input_dg_v1_topic_t *topics,
+    size_t topic_count, const input_dg_v1_msg_t *msgs, size_t msg_count) {
+  assert(result_buf);
+  uint8_t *pos = (uint8_t *) result_buf;
+  size_t dg_size = 0;
+
+  if (input_dg_v1_compute_batch_size(&dg_size, with_partition_key, topics,
+          topic_count, msgs, msg_count) != DORY_OK) {
+    assert(0);
+    return;
+  }
+
+  WriteInt32ToHeader(pos, dg_size);
+  pos += INPUT_DG_SZ_FIELD_SIZE;
+  WriteInt16ToHeader(pos, api_key);
+  pos += INPUT_DG_API_KEY_FIELD_SIZE;
+  WriteInt16ToHeader(pos, 1);  // API version
+  pos += INPUT_DG_API_VERSION_FIELD_SIZE;
+  WriteInt16ToHeader(pos, 0);  // flags
+  pos += INPUT_DG_V1_FLAGS_FIELD_SIZE;
+  WriteInt16ToHeader(pos, topic_count);
+  pos += INPUT_DG_V1_TOPIC_COUNT_FIELD_SIZE;
+  size_t i = 0;
+
+  for (i = 0; i < topic_count; ++i) {
+    size_t topic_size = get_size(topics[i].topic_begin, topics[i].topic_end);
+    WriteInt16ToHeader(pos, topic_size);
+    pos += INPUT_DG_V1_TOPIC_SZ_FIELD_SIZE;
+
+    if (topic_size) {
+      memcpy(pos, topics[i].topic_begin, topic_size);
+    }
+
+    pos += topic_size;
+  }
+
+  size_t record_overhead = get_record_overhead(with_partition_key);
+
+  for (i = 0; i < msg_count; ++i) {
+    const input_dg_v1_msg_t *msg = &msgs[i];
+    size_t key_size = get_size(msg->key_begin, msg->key_end);
+    size_t value_size = get_size(msg->value_begin, msg->value_end);
+    WriteInt32ToHeader(pos, record_overhead + key_size + value_size);
+    pos += INPUT_DG_V1_RECORD_SZ_FIELD_SIZE;
+    WriteInt16ToHeader(pos, msg->topic_index);
+    pos += INPUT_DG_V1_TOPIC_INDEX_FIELD_SIZE;
+    WriteInt64ToHeader(pos, msg->timestamp);
+    pos += INPUT_DG_V1_TS_FIELD_SIZE;
+
+    if (with_partition_key) {
+      WriteInt32ToHeader(pos, msg->partition_key);
+      pos += INPUT_DG_V1_PARTITION_KEY_FIELD_SIZE;
+    }
+
+    WriteInt32ToHeader(pos, key_size);
+    pos += INPUT_DG_V1_KEY_SZ_FIELD_SIZE;
+
+    if (key_size) {
+      memcpy(pos, msg->key_begin, key_size);
+    }
+
+    pos += key_size;
+    WriteInt32ToHeader(pos, value_size);
+    pos += INPUT_DG_V1_VALUE_SZ_FIELD_SIZE;
+
+    if (value_size) {
+      memcpy(pos, msg->value_begin, value_size);
+    }
+
+    pos += value_size;
+  }
+
+  assert(((size_t) (pos - ((uint8_t *) result_buf))) == dg_size);
+}
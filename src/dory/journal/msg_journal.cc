@@ -0,0 +1,684 @@
+/* <dory/journal/msg_journal.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/journal/msg_journal.h>.
+ */
+
+#include <dory/journal/msg_journal.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <base/dir_iter.h>
+#include <base/error_utils.h>
+#include <base/gettid.h>
+#include <base/io_utils.h>
+#include <capped/memory_cap_reached.h>
+#include <dory/journal/segment_reader.h>
+#include <dory/msg_creator.h>
+#include <dory/util/time_util.h>
+#include <server/counter.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Journal;
+using namespace Dory::Util;
+using namespace Thread;
+
+SERVER_COUNTER(JournalAck);
+SERVER_COUNTER(JournalAppend);
+SERVER_COUNTER(JournalCompactSegment);
+SERVER_COUNTER(JournalCopyMsg);
+SERVER_COUNTER(JournalDeleteSegment);
+SERVER_COUNTER(JournalOverMaxSize);
+SERVER_COUNTER(JournalRecoverMsg);
+SERVER_COUNTER(JournalRecoverNoMem);
+SERVER_COUNTER(JournalRecoverTruncatedSegment);
+SERVER_COUNTER(JournalWriteByte);
+SERVER_COUNTER(JournalWriteError);
+
+static const char SEGMENT_PREFIX[] = "journal.";
+
+/* If 'name' is the name of a journal segment file, set 'index' to its index
+   and return true.  Otherwise return false. */
+static bool ParseSegmentName(const char *name, uint64_t &index) {
+  size_t prefix_len = std::strlen(SEGMENT_PREFIX);
+
+  if (std::strncmp(name, SEGMENT_PREFIX, prefix_len)) {
+    return false;
+  }
+
+  const char *digits = name + prefix_len;
+
+  if ((*digits < '0') || (*digits > '9')) {
+    return false;
+  }
+
+  char *end = nullptr;
+  index = std::strtoull(digits, &end, 10);
+  return (*end == '\0');
+}
+
+TMsgJournal::TMsgJournal(const char *journal_dir, size_t segment_size,
+    size_t max_size, size_t flush_interval, TPool &pool,
+    TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
+    TGatePutApi<TMsg::TPtr> &output_queue)
+    : Dir(journal_dir),
+      SegmentSize(segment_size),
+      MaxSize(max_size),
+      FlushInterval(static_cast<int>(flush_interval)),
+      Pool(pool),
+      MsgStateTracker(msg_state_tracker),
+      AnomalyTracker(anomaly_tracker),
+      OutputQueue(output_queue),
+      RecoverySemPushed(false),
+      RecoveredMsgCount(0),
+      NextSeq(0),
+      TotalSize(0),
+      PendingSize(0),
+      FlushRequested(false),
+      WriteIndex(0) {
+  for (TDirIter iter(journal_dir); iter; ++iter) {
+    uint64_t index = 0;
+
+    if (ParseSegmentName(iter.GetName(), index)) {
+      OldSegments.push_back(index);
+    }
+  }
+
+  std::sort(OldSegments.begin(), OldSegments.end());
+  uint64_t first_index = OldSegments.empty() ? 0 : (OldSegments.back() + 1);
+  NextSeq = (first_index << SEQ_INDEX_SHIFT) + 1;
+  Segments.emplace_back(first_index, NextSeq);
+}
+
+TMsgJournal::~TMsgJournal() noexcept {
+  /* This will shut down the thread if something unexpected happens. */
+  ShutdownOnDestroy();
+}
+
+void TMsgJournal::Append(TMsg &msg) {
+  assert(this);
+  bool wake = false;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    wake = DoAppend(msg);
+  }
+
+  if (wake) {
+    FlushSem.Push();
+  }
+}
+
+void TMsgJournal::Append(const std::list<TMsg::TPtr> &msg_list) {
+  assert(this);
+  bool wake = false;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    for (const TMsg::TPtr &msg : msg_list) {
+      assert(msg);
+
+      if (DoAppend(*msg)) {
+        wake = true;
+      }
+    }
+  }
+
+  if (wake) {
+    FlushSem.Push();
+  }
+}
+
+void TMsgJournal::Ack(TMsg &msg) {
+  assert(this);
+
+  if (msg.GetJournalSeq()) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    DoAck(msg);
+  }
+}
+
+void TMsgJournal::Ack(const std::list<TMsg::TPtr> &msg_list) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+
+  for (const TMsg::TPtr &msg : msg_list) {
+    assert(msg);
+
+    if (msg->GetJournalSeq()) {
+      DoAck(*msg);
+    }
+  }
+}
+
+void TMsgJournal::Retain(TMsg &msg) {
+  assert(this);
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    DoAppend(msg);
+  }
+
+  /* The message keeps its segment alive, so a later run will recover it. */
+  msg.SetJournalSeq(0);
+}
+
+void TMsgJournal::Run() {
+  assert(this);
+  int tid = static_cast<int>(Gettid());
+  syslog(LOG_NOTICE, "Message journal thread %d started", tid);
+  bool caught_fatal_exception = false;
+
+  try {
+    DoRun();
+  } catch (const std::exception &x) {
+    caught_fatal_exception = true;
+    syslog(LOG_ERR, "Fatal error in message journal thread %d: %s", tid,
+           x.what());
+  } catch (...) {
+    caught_fatal_exception = true;
+    syslog(LOG_ERR, "Fatal unknown error in message journal thread %d", tid);
+  }
+
+  if (!RecoverySemPushed) {
+    RecoverySem.Push();
+  }
+
+  syslog(LOG_NOTICE, "Message journal thread %d finished %s", tid,
+         caught_fatal_exception ? "on error" : "normally");
+}
+
+std::string TMsgJournal::SegmentPath(uint64_t index) const {
+  assert(this);
+  return Dir + "/" + SEGMENT_PREFIX + std::to_string(index);
+}
+
+std::vector<uint8_t> &TMsgJournal::GetAppendBuf() {
+  assert(this);
+  uint64_t index = Segments.back().Index;
+
+  if (Pending.empty() || (Pending.back().SegmentIndex != index)) {
+    Pending.emplace_back(index);
+  }
+
+  return Pending.back().Data;
+}
+
+bool TMsgJournal::DoAppend(TMsg &msg) {
+  assert(this);
+
+  if (msg.GetJournalSeq()) {
+    return false;
+  }
+
+  if (Segments.back().Size >= SegmentSize) {
+    Segments.emplace_back(Segments.back().Index + 1, NextSeq);
+  }
+
+  uint64_t seq = NextSeq++;
+  std::vector<uint8_t> &buf = GetAppendBuf();
+  size_t old_size = buf.size();
+  AppendMsgRecord(buf, seq, msg);
+  size_t rec_size = buf.size() - old_size;
+  TSegment &segment = Segments.back();
+  segment.Size += rec_size;
+  ++segment.LiveCount;
+  ++segment.MsgCount;
+  segment.Live.push_back(true);
+  msg.SetJournalSeq(seq);
+  JournalAppend.Increment();
+  TotalSize += rec_size;
+  PendingSize += rec_size;
+
+  if ((PendingSize >= FLUSH_THRESHOLD) && !FlushRequested) {
+    FlushRequested = true;
+    return true;
+  }
+
+  return false;
+}
+
+void TMsgJournal::DoAck(TMsg &msg) {
+  assert(this);
+  uint64_t seq = msg.GetJournalSeq();
+  assert(seq);
+  msg.SetJournalSeq(0);
+  auto moved = Moved.find(seq);
+
+  if (moved != Moved.end()) {
+    /* Compaction copied the message to a newer segment. */
+    assert(moved->second >= Segments.front().Index);
+    TSegment &segment = Segments[moved->second - Segments.front().Index];
+    assert(segment.LiveCount);
+    --segment.LiveCount;
+    Moved.erase(moved);
+  } else {
+    /* Find the segment the message was appended to. */
+    auto iter = std::upper_bound(Segments.begin(), Segments.end(), seq,
+        [](uint64_t s, const TSegment &segment) {
+          return s < segment.FirstSeq;
+        });
+
+    if (iter == Segments.begin()) {
+      assert(false);
+      return;
+    }
+
+    --iter;
+    size_t offset = seq - iter->FirstSeq;
+    assert(offset < iter->Live.size());
+    assert(iter->Live[offset]);
+    assert(iter->LiveCount);
+    iter->Live[offset] = false;
+    --iter->LiveCount;
+  }
+
+  std::vector<uint8_t> &buf = GetAppendBuf();
+  size_t old_size = buf.size();
+  AppendAckRecord(buf, seq);
+  size_t rec_size = buf.size() - old_size;
+  Segments.back().Size += rec_size;
+  TotalSize += rec_size;
+  PendingSize += rec_size;
+  JournalAck.Increment();
+}
+
+bool TMsgJournal::IsLiveIn(const TSegment &segment, uint64_t seq) const {
+  assert(this);
+
+  if ((seq >= segment.FirstSeq) &&
+      ((seq - segment.FirstSeq) < segment.Live.size())) {
+    return segment.Live[seq - segment.FirstSeq];
+  }
+
+  auto moved = Moved.find(seq);
+  return (moved != Moved.end()) && (moved->second == segment.Index);
+}
+
+void TMsgJournal::DoRun() {
+  assert(this);
+
+  if (!Recover()) {
+    syslog(LOG_NOTICE,
+           "Message journal thread got shutdown request during recovery");
+    Flush();
+    return;
+  }
+
+  std::array<struct pollfd, 2> events;
+  struct pollfd &shutdown_request_event = events[0];
+  struct pollfd &flush_event = events[1];
+  shutdown_request_event.fd = GetShutdownRequestFd();
+  shutdown_request_event.events = POLLIN;
+  flush_event.fd = FlushSem.GetFd();
+  flush_event.events = POLLIN;
+
+  for (; ; ) {
+    for (auto &item : events) {
+      item.revents = 0;
+    }
+
+    IfLt0(poll(&events[0], events.size(), FlushInterval));
+
+    if (shutdown_request_event.revents) {
+      syslog(LOG_NOTICE, "Message journal thread got shutdown request");
+      break;
+    }
+
+    if (flush_event.revents) {
+      FlushSem.Pop();
+    }
+
+    Flush();
+  }
+
+  Flush();
+  DeleteAckedSegments(true);
+}
+
+bool TMsgJournal::Recover() {
+  assert(this);
+
+  if (OldSegments.empty()) {
+    RecoverySemPushed = true;
+    RecoverySem.Push();
+    return true;
+  }
+
+  syslog(LOG_NOTICE, "Message journal recovering from %lu segment files",
+         static_cast<unsigned long>(OldSegments.size()));
+
+  /* First pass: find which messages were ACKed.  ACKs always follow the
+     messages they refer to, so we can't know in a single pass. */
+  std::unordered_set<uint64_t> acked;
+  TRecord rec;
+
+  for (uint64_t index : OldSegments) {
+    TSegmentReader reader(SegmentPath(index).c_str());
+
+    while (reader.Next(rec)) {
+      if (rec.Type == TRecordType::Ack) {
+        acked.insert(rec.Seq);
+      }
+    }
+
+    if (reader.IsTruncated()) {
+      JournalRecoverTruncatedSegment.Increment();
+      syslog(LOG_WARNING, "Message journal segment %s ends with incomplete "
+             "record", SegmentPath(index).c_str());
+    }
+  }
+
+  /* Second pass: recover unACKed messages in their original order.  A crash
+     during compaction can leave two copies of a message, so skip any
+     sequence number we already recovered. */
+  std::unordered_set<uint64_t> recovered;
+
+  for (uint64_t index : OldSegments) {
+    TSegmentReader reader(SegmentPath(index).c_str());
+
+    while (reader.Next(rec)) {
+      if ((rec.Type == TRecordType::Msg) && !acked.count(rec.Seq) &&
+          recovered.insert(rec.Seq).second && !RecoverMsg(rec)) {
+        return false;
+      }
+    }
+  }
+
+  /* Make sure the recovered messages are in this run's segments before
+     deleting the old ones. */
+  Flush();
+
+  for (uint64_t index : OldSegments) {
+    std::string path = SegmentPath(index);
+
+    if (unlink(path.c_str()) && (errno != ENOENT)) {
+      IfLt0(-1);  // this will throw
+    }
+  }
+
+  OldSegments.clear();
+  syslog(LOG_NOTICE, "Message journal recovered %lu messages",
+         static_cast<unsigned long>(RecoveredMsgCount.load()));
+
+  if (!RecoverySemPushed) {
+    RecoverySemPushed = true;
+    RecoverySem.Push();
+  }
+
+  return true;
+}
+
+bool TMsgJournal::RecoverMsg(const TRecord &rec) {
+  assert(this);
+  const char *topic_end = rec.Topic + rec.TopicSize;
+  TMsg::TPtr msg;
+
+  for (; ; ) {
+    try {
+      msg = (rec.RoutingType == TMsg::TRoutingType::PartitionKey) ?
+          TMsgCreator::CreatePartitionKeyMsg(rec.PartitionKey, rec.Timestamp,
+              rec.Topic, topic_end, rec.Key, rec.KeySize, rec.Value,
+              rec.ValueSize, false, Pool, MsgStateTracker) :
+          TMsgCreator::CreateAnyPartitionMsg(rec.Timestamp, rec.Topic,
+              topic_end, rec.Key, rec.KeySize, rec.Value, rec.ValueSize,
+              false, Pool, MsgStateTracker);
+      break;
+    } catch (const TMemoryCapReached &) {
+      JournalRecoverNoMem.Increment();
+    }
+
+    /* Let the rest of dory start, since the router thread must deliver some
+       messages before we can make progress. */
+    if (!RecoverySemPushed) {
+      RecoverySemPushed = true;
+      RecoverySem.Push();
+    }
+
+    Flush();
+
+    if (GetShutdownRequestFd().IsReadable(RECOVERY_RETRY_INTERVAL)) {
+      return false;
+    }
+  }
+
+  Append(*msg);
+  AnomalyTracker.TrackDuplicate(msg);
+  OutputQueue.Put(std::move(msg));
+  ++RecoveredMsgCount;
+  JournalRecoverMsg.Increment();
+  return true;
+}
+
+void TMsgJournal::Flush() {
+  assert(this);
+  WritePending();
+
+  /* Write the copies before DeleteAckedSegments() can delete the originals.
+   */
+  if (CompactOldestSegment()) {
+    WritePending();
+  }
+
+  DeleteAckedSegments(false);
+}
+
+void TMsgJournal::WritePending() {
+  assert(this);
+  std::list<TChunk> chunks;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    chunks.splice(chunks.end(), Pending);
+    PendingSize = 0;
+    FlushRequested = false;
+  }
+
+  for (const TChunk &chunk : chunks) {
+    try {
+      if (WriteFd.IsOpen() && (WriteIndex != chunk.SegmentIndex)) {
+        WriteFd.Reset();
+      }
+
+      if (!WriteFd.IsOpen()) {
+        WriteFd = IfLt0(open(SegmentPath(chunk.SegmentIndex).c_str(),
+            O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+        WriteIndex = chunk.SegmentIndex;
+      }
+
+      WriteExactly(WriteFd, &chunk.Data[0], chunk.Data.size());
+      JournalWriteByte.Increment(static_cast<uint32_t>(chunk.Data.size()));
+    } catch (const std::exception &x) {
+      /* Keep going without the journal rather than stopping the flow of
+         messages. */
+      JournalWriteError.Increment();
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+
+      if (lim.Test()) {
+        syslog(LOG_ERR, "Failed to write message journal segment: %s",
+               x.what());
+      }
+    }
+  }
+}
+
+bool TMsgJournal::CompactOldestSegment() {
+  assert(this);
+  uint64_t index = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    if ((MaxSize == 0) || (TotalSize <= MaxSize) || (Segments.size() < 2)) {
+      return false;
+    }
+
+    const TSegment &oldest = Segments.front();
+
+    /* A fully ACKed segment just needs deleting.  Also skip the segment if
+       part of it is still unwritten. */
+    if ((oldest.LiveCount == 0) ||
+        (!Pending.empty() && (Pending.front().SegmentIndex <= oldest.Index))) {
+      return false;
+    }
+
+    /* Compact only if it frees more space than it uses: either the next
+       segment can be deleted once the oldest is gone, or at least half the
+       oldest segment's messages are ACKed.  Otherwise we would just keep
+       rewriting unACKed messages. */
+    if ((Segments[1].LiveCount != 0) &&
+        ((oldest.LiveCount * 2) > oldest.MsgCount)) {
+      JournalOverMaxSize.Increment();
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+
+      if (lim.Test()) {
+        syslog(LOG_WARNING, "Message journal size %lu exceeds max size %lu, "
+               "but is mostly unprocessed messages",
+               static_cast<unsigned long>(TotalSize),
+               static_cast<unsigned long>(MaxSize));
+      }
+
+      return false;
+    }
+
+    index = oldest.Index;
+  }
+
+  /* Only the journal thread deletes segments, so the oldest segment stays
+     put while we read it without holding the mutex.  Messages may get ACKed
+     meanwhile, so we copy them all and check which are live below. */
+  std::vector<uint8_t> copies;
+  std::vector<std::pair<uint64_t, size_t>> copy_info;  // seq, record size
+
+  try {
+    TSegmentReader reader(SegmentPath(index).c_str());
+    TRecord rec;
+
+    while (reader.Next(rec)) {
+      if (rec.Type == TRecordType::Msg) {
+        size_t old_size = copies.size();
+        AppendMsgRecord(copies, rec);
+        copy_info.emplace_back(rec.Seq, copies.size() - old_size);
+      }
+    }
+  } catch (const std::exception &x) {
+    JournalWriteError.Increment();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Failed to read message journal segment for "
+             "compaction: %s", x.what());
+    }
+
+    return false;
+  }
+
+  size_t copy_count = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    TSegment &oldest = Segments.front();
+    assert(oldest.Index == index);
+    size_t offset = 0;
+
+    for (const auto &item : copy_info) {
+      uint64_t seq = item.first;
+      size_t rec_size = item.second;
+
+      if (IsLiveIn(oldest, seq)) {
+        if ((seq >= oldest.FirstSeq) &&
+            ((seq - oldest.FirstSeq) < oldest.Live.size())) {
+          oldest.Live[seq - oldest.FirstSeq] = false;
+        }
+
+        --oldest.LiveCount;
+
+        std::vector<uint8_t> &buf = GetAppendBuf();
+        TSegment &newest = Segments.back();
+        buf.insert(buf.end(), copies.begin() + offset,
+                   copies.begin() + offset + rec_size);
+        ++newest.LiveCount;
+        ++newest.MsgCount;
+        newest.Size += rec_size;
+        Moved[seq] = newest.Index;
+        TotalSize += rec_size;
+        PendingSize += rec_size;
+        ++copy_count;
+      }
+
+      offset += rec_size;
+    }
+  }
+
+  JournalCompactSegment.Increment();
+  JournalCopyMsg.Increment(static_cast<uint32_t>(copy_count));
+  return (copy_count != 0);
+}
+
+void TMsgJournal::DeleteAckedSegments(bool shutdown) {
+  assert(this);
+  std::vector<uint64_t> to_delete;
+
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    /* Delete segments in order, so an ACK never outlives a segment it may be
+       needed for.  Leave the segment being appended to, and any segment with
+       unwritten data. */
+    while (!Segments.empty() && (Segments.front().LiveCount == 0) &&
+           (shutdown || (Segments.size() > 1)) &&
+           (Pending.empty() ||
+               (Segments.front().Index < Pending.front().SegmentIndex))) {
+      to_delete.push_back(Segments.front().Index);
+      TotalSize -= Segments.front().Size;
+      Segments.pop_front();
+    }
+
+    if (Segments.empty()) {
+      Segments.emplace_back(to_delete.back() + 1, NextSeq);
+    }
+  }
+
+  for (uint64_t index : to_delete) {
+    if (WriteFd.IsOpen() && (WriteIndex == index)) {
+      WriteFd.Reset();
+    }
+
+    if (unlink(SegmentPath(index).c_str()) == 0) {
+      JournalDeleteSegment.Increment();
+    }
+  }
+}
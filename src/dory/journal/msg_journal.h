@@ -0,0 +1,269 @@
+/* <dory/journal/msg_journal.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Write-behind journal of messages accepted by the router thread, which lets
+   dory recover undelivered messages after a restart or crash.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/event_semaphore.h>
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+#include <capped/pool.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/journal/record.h>
+#include <dory/msg.h>
+#include <dory/msg_state_tracker.h>
+#include <thread/fd_managed_thread.h>
+#include <thread/gate_put_api.h>
+
+namespace Dory {
+
+  namespace Journal {
+
+    /* The router thread appends each message it receives to the journal, and
+       the message is ACKed in the journal when it is processed (either
+       delivered or discarded).  Appends and ACKs only copy records into an
+       in-memory buffer, which the journal thread writes to segment files in
+       'journal_dir' every 'flush_interval' milliseconds.  A segment file is
+       deleted once all messages it contains have been ACKed.  Messages
+       discarded on shutdown are not ACKed, so they stay in the journal.
+
+       Segments are deleted oldest first, since a segment may hold ACKs for
+       messages in older ones.  When the segments add up to more than
+       'max_size' bytes, the journal thread compacts the oldest segment by
+       copying its unACKed messages to the newest one, so a few slow messages
+       don't keep all later segments alive.  A copied message keeps its
+       sequence number.  A 'max_size' of 0 means no limit.
+
+       When the journal thread starts, it first recovers messages left
+       unACKed by a previous run, streaming the old segment files rather than
+       loading them into memory.  Recovered messages are tracked as possible
+       duplicates and passed to 'output_queue' before any new input.  Old
+       segment files are deleted once recovery is finished. */
+    class TMsgJournal final : public Thread::TFdManagedThread {
+      NO_COPY_SEMANTICS(TMsgJournal);
+
+      public:
+      /* Throws std::system_error if 'journal_dir' can't be read. */
+      TMsgJournal(const char *journal_dir, size_t segment_size,
+          size_t max_size, size_t flush_interval, Capped::TPool &pool,
+          TMsgStateTracker &msg_state_tracker,
+          TAnomalyTracker &anomaly_tracker,
+          Thread::TGatePutApi<TMsg::TPtr> &output_queue);
+
+      virtual ~TMsgJournal() noexcept;
+
+      /* Becomes readable once all recovered messages have been passed to the
+         output queue, or recovery is waiting for buffer space.  In the latter
+         case, the remaining messages are recovered as space frees up. */
+      const Base::TFd &GetRecoveryWaitFd() const {
+        assert(this);
+        return RecoverySem.GetFd();
+      }
+
+      /* Returns the number of messages recovered so far. */
+      size_t GetRecoveredMsgCount() const {
+        assert(this);
+        return RecoveredMsgCount.load();
+      }
+
+      /* Called by the router thread when it receives messages.  Messages that
+         are already journaled are skipped. */
+      void Append(TMsg &msg);
+
+      void Append(const std::list<TMsg::TPtr> &msg_list);
+
+      /* Called when messages are processed.  Messages that aren't journaled
+         are skipped. */
+      void Ack(TMsg &msg);
+
+      void Ack(const std::list<TMsg::TPtr> &msg_list);
+
+      /* Called for a message about to be discarded on shutdown.  Journal it if
+         needed, and make sure it isn't ACKed so a later run will recover it.
+       */
+      void Retain(TMsg &msg);
+
+      protected:
+      virtual void Run() override;
+
+      private:
+      /* A segment file written by this run. */
+      struct TSegment {
+        uint64_t Index;
+
+        /* Sequence number of first message in segment. */
+        uint64_t FirstSeq;
+
+        /* Number of messages in segment not yet ACKed, including messages
+           copied here from older segments. */
+        size_t LiveCount;
+
+        /* Number of messages in segment, including copied ones. */
+        size_t MsgCount;
+
+        /* Number of bytes appended to segment. */
+        size_t Size;
+
+        /* Item i is true while the message with sequence number FirstSeq + i
+           is neither ACKed nor copied to a newer segment. */
+        std::vector<bool> Live;
+
+        TSegment(uint64_t index, uint64_t first_seq)
+            : Index(index),
+              FirstSeq(first_seq),
+              LiveCount(0),
+              MsgCount(0),
+              Size(0) {
+        }
+      };  // TSegment
+
+      /* Appended data not yet written to the given segment. */
+      struct TChunk {
+        uint64_t SegmentIndex;
+
+        std::vector<uint8_t> Data;
+
+        explicit TChunk(uint64_t segment_index)
+            : SegmentIndex(segment_index) {
+        }
+      };  // TChunk
+
+      /* Sequence numbers are formed by shifting the index of a run's first
+         segment left by this many bits and adding a counter.  This keeps them
+         unique across runs. */
+      static const unsigned SEQ_INDEX_SHIFT = 40;
+
+      /* Wake up the journal thread early when this many bytes are pending. */
+      static const size_t FLUSH_THRESHOLD = 1024 * 1024;
+
+      /* Milliseconds to wait before retrying recovery after it was blocked by
+         the buffer space cap. */
+      static const int RECOVERY_RETRY_INTERVAL = 50;
+
+      std::string SegmentPath(uint64_t index) const;
+
+      /* Caller must hold 'Mutex'.  Returns the buffer to append the next
+         record to. */
+      std::vector<uint8_t> &GetAppendBuf();
+
+      /* Caller must hold 'Mutex'.  Returns true if the journal thread should
+         be woken up to flush. */
+      bool DoAppend(TMsg &msg);
+
+      /* Caller must hold 'Mutex'. */
+      void DoAck(TMsg &msg);
+
+      /* Caller must hold 'Mutex'.  Returns true if the message with sequence
+         number 'seq' is unACKed and its current copy is in 'segment'. */
+      bool IsLiveIn(const TSegment &segment, uint64_t seq) const;
+
+      void DoRun();
+
+      /* Returns false if a shutdown request arrived during recovery. */
+      bool Recover();
+
+      /* Returns false if a shutdown request arrived while waiting for buffer
+         space. */
+      bool RecoverMsg(const TRecord &rec);
+
+      /* Write pending data to segment files, compact the oldest segment if
+         needed, and delete fully ACKed segments. */
+      void Flush();
+
+      void WritePending();
+
+      /* If the segments are over the size limit, and copying the unACKed
+         messages of the oldest segment would let us delete more than we
+         write, append the copies for the newest segment.  Returns true if
+         any copies were appended. */
+      bool CompactOldestSegment();
+
+      void DeleteAckedSegments(bool shutdown);
+
+      const std::string Dir;
+
+      const size_t SegmentSize;
+
+      const size_t MaxSize;
+
+      const int FlushInterval;
+
+      Capped::TPool &Pool;
+
+      TMsgStateTracker &MsgStateTracker;
+
+      TAnomalyTracker &AnomalyTracker;
+
+      Thread::TGatePutApi<TMsg::TPtr> &OutputQueue;
+
+      /* Indexes of segment files left by previous runs, in ascending order. */
+      std::vector<uint64_t> OldSegments;
+
+      Base::TEventSemaphore RecoverySem;
+
+      bool RecoverySemPushed;
+
+      std::atomic<size_t> RecoveredMsgCount;
+
+      /* Protects everything below except the write side ('WriteFd' and
+         'WriteIndex'), which only the journal thread touches. */
+      std::mutex Mutex;
+
+      uint64_t NextSeq;
+
+      /* Segments of this run not yet deleted, in ascending order.  Never
+         empty.  Indexes are consecutive. */
+      std::deque<TSegment> Segments;
+
+      /* Sum of segment sizes. */
+      size_t TotalSize;
+
+      /* Maps the sequence number of each unACKed message copied by compaction
+         to the index of the segment holding its current copy. */
+      std::unordered_map<uint64_t, uint64_t> Moved;
+
+      std::list<TChunk> Pending;
+
+      size_t PendingSize;
+
+      bool FlushRequested;
+
+      Base::TEventSemaphore FlushSem;
+
+      Base::TFd WriteFd;
+
+      uint64_t WriteIndex;
+    };  // TMsgJournal
+
+  }  // Journal
+
+}  // Dory
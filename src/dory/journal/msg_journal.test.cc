@@ -0,0 +1,349 @@
+/* <dory/journal/msg_journal.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/journal/msg_journal.h>.
+ */
+
+#include <dory/journal/msg_journal.h>
+
+#include <cstring>
+#include <list>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <base/dir_iter.h>
+#include <base/error_utils.h>
+#include <base/fd.h>
+#include <base/io_utils.h>
+#include <base/tmp_dir.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/discard_file_logger.h>
+#include <dory/msg_creator.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/test_util/misc_util.h>
+#include <thread/gate.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Journal;
+using namespace Dory::TestUtil;
+using namespace Thread;
+
+namespace {
+
+  /* The fixture for testing class TMsgJournal. */
+  class TMsgJournalTest : public ::testing::Test {
+    protected:
+    TMsgJournalTest() {
+    }
+
+    virtual ~TMsgJournalTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TMsgJournalTest
+
+  /* Everything a journal needs, for one run of dory. */
+  struct TRun {
+    TPool Pool;
+
+    TMsgStateTracker MsgStateTracker;
+
+    TDiscardFileLogger DiscardFileLogger;
+
+    TAnomalyTracker AnomalyTracker;
+
+    TGate<TMsg::TPtr> Gate;
+
+    TMsgJournal Journal;
+
+    TRun(const char *dir, size_t segment_size, size_t max_size = 0)
+        : Pool(64, 1024, TPool::TSync::Mutexed),
+          AnomalyTracker(DiscardFileLogger, 0, 256),
+          Journal(dir, segment_size, max_size, 10, Pool, MsgStateTracker,
+                  AnomalyTracker, Gate) {
+      MsgStateTracker.SetJournal(&Journal);
+      Journal.Start();
+      Journal.GetRecoveryWaitFd().IsReadable(-1);
+    }
+
+    ~TRun() {
+      if (Journal.IsStarted()) {
+        Stop();
+      }
+    }
+
+    void Stop() {
+      Journal.RequestShutdown();
+      Journal.Join();
+    }
+
+    TMsg::TPtr NewMsg(const std::string &topic, const std::string &value) {
+      return TMsgCreator::CreateAnyPartitionMsg(0, topic.data(),
+          topic.data() + topic.size(), "", 0, value.data(), value.size(),
+          false, Pool, MsgStateTracker);
+    }
+
+    /* Process messages normally, which ACKs them. */
+    void Process(std::list<TMsg::TPtr> &msg_list) {
+      for (TMsg::TPtr &msg : msg_list) {
+        MsgStateTracker.MsgEnterProcessed(*msg);
+      }
+
+      msg_list.clear();
+    }
+
+    size_t GetDuplicateCount() {
+      TAnomalyTracker::TInfo info;
+      AnomalyTracker.GetInfo(info);
+      size_t count = 0;
+
+      for (const auto &item : info.DuplicateTopicMap) {
+        count += item.second.Count;
+      }
+
+      return count;
+    }
+  };  // TRun
+
+  size_t CountFiles(const char *dir) {
+    size_t count = 0;
+
+    for (TDirIter iter(dir); iter; ++iter) {
+      ++count;
+    }
+
+    return count;
+  }
+
+  /* Messages are processed without going through the tracker when the test
+     wants them to stay unACKed, like a message in flight during a crash. */
+  void Abandon(std::list<TMsg::TPtr> &msg_list) {
+    for (TMsg::TPtr &msg : msg_list) {
+      SetProcessed(msg);
+    }
+
+    msg_list.clear();
+  }
+
+  TEST_F(TMsgJournalTest, RecoverUnacked) {
+    TTmpDir dir("/tmp/dory_journal_test.XXXXXX", true);
+
+    {
+      TRun run(dir.GetName(), 64 * 1024);
+      std::list<TMsg::TPtr> msg_list;
+
+      for (size_t i = 1; i <= 4; ++i) {
+        msg_list.push_back(run.NewMsg("topic" + std::to_string(i),
+            "value" + std::to_string(i)));
+      }
+
+      run.Journal.Append(msg_list);
+      ASSERT_NE(msg_list.front()->GetJournalSeq(), 0U);
+
+      /* Messages 2 and 4 are delivered. */
+      auto iter = msg_list.begin();
+      ++iter;
+      run.MsgStateTracker.MsgEnterProcessed(**iter);
+      ++iter;
+      ++iter;
+      run.MsgStateTracker.MsgEnterProcessed(**iter);
+      run.Stop();
+      Abandon(msg_list);
+    }
+
+    ASSERT_GT(CountFiles(dir.GetName()), 0U);
+
+    {
+      TRun run(dir.GetName(), 64 * 1024);
+      ASSERT_EQ(run.Journal.GetRecoveredMsgCount(), 2U);
+      ASSERT_EQ(run.GetDuplicateCount(), 2U);
+      std::list<TMsg::TPtr> msg_list = run.Gate.NonblockingGet();
+      ASSERT_EQ(msg_list.size(), 2U);
+      ASSERT_EQ(msg_list.front()->GetTopic(), "topic1");
+      ASSERT_TRUE(ValueEquals(msg_list.front(), "value1"));
+      ASSERT_EQ(msg_list.back()->GetTopic(), "topic3");
+      ASSERT_TRUE(ValueEquals(msg_list.back(), "value3"));
+
+      /* Recovered messages are journaled again, so appending is a no-op. */
+      ASSERT_NE(msg_list.front()->GetJournalSeq(), 0U);
+      run.Journal.Append(msg_list);
+
+      /* Simulate discarding one message on shutdown, which must keep it in
+         the journal. */
+      run.Journal.Retain(*msg_list.back());
+      run.Process(msg_list);
+      run.Stop();
+    }
+
+    {
+      TRun run(dir.GetName(), 64 * 1024);
+      ASSERT_EQ(run.Journal.GetRecoveredMsgCount(), 1U);
+      std::list<TMsg::TPtr> msg_list = run.Gate.NonblockingGet();
+      ASSERT_EQ(msg_list.size(), 1U);
+      ASSERT_EQ(msg_list.front()->GetTopic(), "topic3");
+      run.Process(msg_list);
+      run.Stop();
+    }
+
+    /* Everything was ACKed, so nothing is left behind. */
+    ASSERT_EQ(CountFiles(dir.GetName()), 0U);
+  }
+
+  TEST_F(TMsgJournalTest, SegmentDeletion) {
+    TTmpDir dir("/tmp/dory_journal_test.XXXXXX", true);
+    TRun run(dir.GetName(), 1);
+    std::list<TMsg::TPtr> msg_list;
+
+    for (size_t i = 0; i < 5; ++i) {
+      msg_list.push_back(run.NewMsg("topic", "value"));
+    }
+
+    /* With a tiny segment size, each message gets its own segment. */
+    run.Journal.Append(msg_list);
+
+    for (size_t i = 0; (i < 100) && (CountFiles(dir.GetName()) < 5); ++i) {
+      usleep(10000);
+    }
+
+    ASSERT_EQ(CountFiles(dir.GetName()), 5U);
+
+    /* ACK the first two messages.  Their segments get deleted.  The last
+       segment stays since it's still being written to. */
+    run.MsgStateTracker.MsgEnterProcessed(*msg_list.front());
+    msg_list.pop_front();
+    run.MsgStateTracker.MsgEnterProcessed(*msg_list.front());
+    msg_list.pop_front();
+
+    for (size_t i = 0; (i < 100) && (CountFiles(dir.GetName()) > 3); ++i) {
+      usleep(10000);
+    }
+
+    ASSERT_EQ(CountFiles(dir.GetName()), 3U);
+    run.MsgStateTracker.MsgEnterProcessed(msg_list);
+    msg_list.clear();
+    run.Stop();
+    ASSERT_EQ(CountFiles(dir.GetName()), 0U);
+  }
+
+  TEST_F(TMsgJournalTest, Compaction) {
+    TTmpDir dir("/tmp/dory_journal_test.XXXXXX", true);
+
+    {
+      /* Each message gets its own segment, and any journal data at all is
+         over the size limit. */
+      TRun run(dir.GetName(), 1, 1);
+      std::list<TMsg::TPtr> msg_list;
+
+      for (size_t i = 1; i <= 5; ++i) {
+        msg_list.push_back(run.NewMsg("topic", "value" + std::to_string(i)));
+      }
+
+      run.Journal.Append(msg_list);
+
+      for (size_t i = 0; (i < 100) && (CountFiles(dir.GetName()) < 5); ++i) {
+        usleep(10000);
+      }
+
+      ASSERT_EQ(CountFiles(dir.GetName()), 5U);
+      TMsg::TPtr first = std::move(msg_list.front());
+      msg_list.pop_front();
+      TMsg::TPtr last = std::move(msg_list.back());
+      msg_list.pop_back();
+
+      /* Messages 2-4 are delivered.  Message 1 is still unACKed, but it must
+         not keep their segments alive.  Compaction copies it to the last
+         segment, so only that segment is left. */
+      run.Process(msg_list);
+
+      for (size_t i = 0; (i < 100) && (CountFiles(dir.GetName()) > 1); ++i) {
+        usleep(10000);
+      }
+
+      ASSERT_EQ(CountFiles(dir.GetName()), 1U);
+
+      /* ACK the copied message.  Message 5 stays unACKed, like a message in
+         flight during a crash. */
+      run.MsgStateTracker.MsgEnterProcessed(*first);
+      first.reset();
+      run.Stop();
+      msg_list.push_back(std::move(last));
+      Abandon(msg_list);
+    }
+
+    {
+      TRun run(dir.GetName(), 1, 1);
+      ASSERT_EQ(run.Journal.GetRecoveredMsgCount(), 1U);
+      std::list<TMsg::TPtr> msg_list = run.Gate.NonblockingGet();
+      ASSERT_EQ(msg_list.size(), 1U);
+      ASSERT_TRUE(ValueEquals(msg_list.front(), "value5"));
+      run.Process(msg_list);
+      run.Stop();
+    }
+
+    ASSERT_EQ(CountFiles(dir.GetName()), 0U);
+  }
+
+  TEST_F(TMsgJournalTest, IncompleteRecord) {
+    TTmpDir dir("/tmp/dory_journal_test.XXXXXX", true);
+
+    {
+      TRun run(dir.GetName(), 64 * 1024);
+      std::list<TMsg::TPtr> msg_list;
+      msg_list.push_back(run.NewMsg("topic1", "value1"));
+      msg_list.push_back(run.NewMsg("topic2", "value2"));
+      run.Journal.Append(msg_list);
+      run.Stop();
+      Abandon(msg_list);
+    }
+
+    /* Simulate a crash in the middle of writing a record. */
+    ASSERT_EQ(CountFiles(dir.GetName()), 1U);
+    TDirIter iter(dir.GetName());
+    std::string path = std::string(dir.GetName()) + "/" + iter.GetName();
+    TFd fd(IfLt0(open(path.c_str(), O_WRONLY | O_APPEND)));
+    WriteExactly(fd, "\x12\x34\x56\x78\x40", 5);
+    fd.Reset();
+
+    {
+      TRun run(dir.GetName(), 64 * 1024);
+      std::list<TMsg::TPtr> msg_list = run.Gate.NonblockingGet();
+      ASSERT_EQ(msg_list.size(), 2U);
+      ASSERT_EQ(msg_list.front()->GetTopic(), "topic1");
+      ASSERT_EQ(msg_list.back()->GetTopic(), "topic2");
+      run.Process(msg_list);
+    }
+
+    ASSERT_EQ(CountFiles(dir.GetName()), 0U);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,186 @@
+/* <dory/journal/record.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/journal/record.h>.
+ */
+
+#include <dory/journal/record.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <base/crc.h>
+#include <capped/reader.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Journal;
+
+template <typename T>
+static inline uint8_t *Put(uint8_t *pos, T value) {
+  std::memcpy(pos, &value, sizeof(value));
+  return pos + sizeof(value);
+}
+
+template <typename T>
+static inline const uint8_t *Get(const uint8_t *pos, T &value) {
+  std::memcpy(&value, pos, sizeof(value));
+  return pos + sizeof(value);
+}
+
+/* Fill in the frame header for the record starting at offset 'rec_offset' of
+   'dst', whose payload extends to the end of 'dst'. */
+static void FinishRecord(std::vector<uint8_t> &dst, size_t rec_offset) {
+  uint8_t *rec = &dst[rec_offset];
+  size_t payload_size = dst.size() - rec_offset - RECORD_FRAME_SIZE;
+  const uint8_t *payload = rec + RECORD_FRAME_SIZE;
+  uint8_t *pos = Put(rec, ComputeCrc32(payload, payload_size));
+  Put(pos, static_cast<uint32_t>(payload_size));
+}
+
+void Dory::Journal::AppendMsgRecord(std::vector<uint8_t> &dst, uint64_t seq,
+    const TMsg &msg) {
+  const std::string &topic = msg.GetTopic();
+  const TBlob &key_and_value = msg.GetKeyAndValue();
+  size_t rec_offset = dst.size();
+  dst.resize(rec_offset + RECORD_FRAME_SIZE + RECORD_PAYLOAD_HEADER_SIZE +
+      MSG_RECORD_FIELDS_SIZE + topic.size() + key_and_value.Size());
+  uint8_t *pos = &dst[rec_offset + RECORD_FRAME_SIZE];
+  pos = Put(pos, static_cast<uint8_t>(TRecordType::Msg));
+  pos = Put(pos, seq);
+  pos = Put(pos, static_cast<int64_t>(msg.GetTimestamp()));
+  pos = Put(pos, msg.GetPartitionKey());
+  pos = Put(pos, static_cast<uint8_t>(msg.GetRoutingType()));
+  pos = Put(pos, static_cast<uint32_t>(topic.size()));
+  pos = Put(pos, static_cast<uint32_t>(msg.GetKeySize()));
+  pos = Put(pos, static_cast<uint32_t>(msg.GetValueSize()));
+  std::memcpy(pos, topic.data(), topic.size());
+  pos += topic.size();
+
+  /* The value immediately follows the key in the blob. */
+  if (key_and_value.Size()) {
+    TReader(&key_and_value).Read(pos, key_and_value.Size());
+  }
+
+  FinishRecord(dst, rec_offset);
+}
+
+void Dory::Journal::AppendMsgRecord(std::vector<uint8_t> &dst,
+    const TRecord &rec) {
+  assert(rec.Type == TRecordType::Msg);
+  size_t rec_offset = dst.size();
+  dst.resize(rec_offset + RECORD_FRAME_SIZE + RECORD_PAYLOAD_HEADER_SIZE +
+      MSG_RECORD_FIELDS_SIZE + rec.TopicSize + rec.KeySize + rec.ValueSize);
+  uint8_t *pos = &dst[rec_offset + RECORD_FRAME_SIZE];
+  pos = Put(pos, static_cast<uint8_t>(TRecordType::Msg));
+  pos = Put(pos, rec.Seq);
+  pos = Put(pos, static_cast<int64_t>(rec.Timestamp));
+  pos = Put(pos, rec.PartitionKey);
+  pos = Put(pos, static_cast<uint8_t>(rec.RoutingType));
+  pos = Put(pos, static_cast<uint32_t>(rec.TopicSize));
+  pos = Put(pos, static_cast<uint32_t>(rec.KeySize));
+  pos = Put(pos, static_cast<uint32_t>(rec.ValueSize));
+  std::memcpy(pos, rec.Topic, rec.TopicSize);
+  pos += rec.TopicSize;
+
+  if (rec.KeySize) {
+    std::memcpy(pos, rec.Key, rec.KeySize);
+    pos += rec.KeySize;
+  }
+
+  if (rec.ValueSize) {
+    std::memcpy(pos, rec.Value, rec.ValueSize);
+  }
+
+  FinishRecord(dst, rec_offset);
+}
+
+void Dory::Journal::AppendAckRecord(std::vector<uint8_t> &dst, uint64_t seq) {
+  size_t rec_offset = dst.size();
+  dst.resize(rec_offset + RECORD_FRAME_SIZE + RECORD_PAYLOAD_HEADER_SIZE);
+  uint8_t *pos = &dst[rec_offset + RECORD_FRAME_SIZE];
+  pos = Put(pos, static_cast<uint8_t>(TRecordType::Ack));
+  Put(pos, seq);
+  FinishRecord(dst, rec_offset);
+}
+
+bool Dory::Journal::DecodePayload(const uint8_t *payload,
+    size_t payload_size, TRecord &rec) {
+  assert(payload || (payload_size == 0));
+
+  if (payload_size < RECORD_PAYLOAD_HEADER_SIZE) {
+    return false;
+  }
+
+  const uint8_t *pos = payload;
+  const uint8_t *end = payload + payload_size;
+  uint8_t type = 0;
+  pos = Get(pos, type);
+  pos = Get(pos, rec.Seq);
+
+  switch (static_cast<TRecordType>(type)) {
+    case TRecordType::Ack: {
+      rec.Type = TRecordType::Ack;
+      return (pos == end);
+    }
+    case TRecordType::Msg: {
+      break;
+    }
+    default: {
+      return false;
+    }
+  }
+
+  if (static_cast<size_t>(end - pos) < MSG_RECORD_FIELDS_SIZE) {
+    return false;
+  }
+
+  int64_t timestamp = 0;
+  uint8_t routing_type = 0;
+  uint32_t topic_size = 0;
+  uint32_t key_size = 0;
+  uint32_t value_size = 0;
+  rec.Type = TRecordType::Msg;
+  pos = Get(pos, timestamp);
+  pos = Get(pos, rec.PartitionKey);
+  pos = Get(pos, routing_type);
+  pos = Get(pos, topic_size);
+  pos = Get(pos, key_size);
+  pos = Get(pos, value_size);
+
+  if ((routing_type >
+          static_cast<uint8_t>(TMsg::TRoutingType::PartitionKey)) ||
+      (topic_size == 0) ||
+      ((static_cast<uint64_t>(topic_size) + key_size + value_size) !=
+          static_cast<uint64_t>(end - pos))) {
+    return false;
+  }
+
+  rec.Timestamp = timestamp;
+  rec.RoutingType = static_cast<TMsg::TRoutingType>(routing_type);
+  rec.Topic = reinterpret_cast<const char *>(pos);
+  rec.TopicSize = topic_size;
+  pos += topic_size;
+  rec.Key = pos;
+  rec.KeySize = key_size;
+  pos += key_size;
+  rec.Value = pos;
+  rec.ValueSize = value_size;
+  return true;
+}
@@ -0,0 +1,137 @@
+/* <dory/journal/record.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   On-disk record format for the message journal.
+
+   Each record consists of an 8 byte frame header followed by a payload:
+
+     uint32 CRC32 of payload
+     uint32 payload size
+
+   The payload starts with a 1 byte record type and an 8 byte sequence number.
+   A message record then contains:
+
+     int64  client timestamp
+     int32  partition key
+     uint8  routing type
+     uint32 topic size
+     uint32 key size
+     uint32 value size
+     topic, key, and value bytes
+
+   An ACK record has no further contents.  Journal files are only read back
+   by dory on the host that wrote them, so integers are stored in host byte
+   order.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <dory/msg.h>
+
+namespace Dory {
+
+  namespace Journal {
+
+    enum class TRecordType : uint8_t {
+      /* A message was accepted by the router thread. */
+      Msg = 1,
+
+      /* The message with the given sequence number was either delivered or
+         discarded, and need not be recovered. */
+      Ack = 2
+    };  // TRecordType
+
+    /* Size of the CRC and payload size fields preceding each payload. */
+    const size_t RECORD_FRAME_SIZE = 8;
+
+    /* Size of the type and sequence number fields at the start of each
+       payload. */
+    const size_t RECORD_PAYLOAD_HEADER_SIZE = 9;
+
+    /* Size of the fixed-size fields following the payload header of a message
+       record. */
+    const size_t MSG_RECORD_FIELDS_SIZE = 25;
+
+    /* Larger payload sizes are treated as corruption when reading. */
+    const size_t MAX_RECORD_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+    /* A decoded record.  For message records, 'Topic', 'Key', and 'Value'
+       point into a buffer owned by whoever did the decoding. */
+    struct TRecord {
+      TRecordType Type;
+
+      uint64_t Seq;
+
+      TMsg::TTimestamp Timestamp;
+
+      int32_t PartitionKey;
+
+      TMsg::TRoutingType RoutingType;
+
+      const char *Topic;
+
+      size_t TopicSize;
+
+      const uint8_t *Key;
+
+      size_t KeySize;
+
+      const uint8_t *Value;
+
+      size_t ValueSize;
+
+      TRecord()
+          : Type(TRecordType::Ack),
+            Seq(0),
+            Timestamp(0),
+            PartitionKey(0),
+            RoutingType(TMsg::TRoutingType::AnyPartition),
+            Topic(nullptr),
+            TopicSize(0),
+            Key(nullptr),
+            KeySize(0),
+            Value(nullptr),
+            ValueSize(0) {
+      }
+    };  // TRecord
+
+    /* Append to 'dst' a message record for 'msg' with sequence number 'seq'.
+     */
+    void AppendMsgRecord(std::vector<uint8_t> &dst, uint64_t seq,
+        const TMsg &msg);
+
+    /* Append to 'dst' a copy of message record 'rec', keeping its sequence
+       number. */
+    void AppendMsgRecord(std::vector<uint8_t> &dst, const TRecord &rec);
+
+    /* Append to 'dst' an ACK record for sequence number 'seq'. */
+    void AppendAckRecord(std::vector<uint8_t> &dst, uint64_t seq);
+
+    /* Decode the 'payload_size' byte payload at 'payload' into 'rec'.  Returns
+       false if the payload is malformed.  On success, pointers in 'rec' refer
+       to memory inside 'payload'. */
+    bool DecodePayload(const uint8_t *payload, size_t payload_size,
+        TRecord &rec);
+
+  }  // Journal
+
+}  // Dory
@@ -0,0 +1,110 @@
+/* <dory/journal/segment_reader.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/journal/segment_reader.h>.
+ */
+
+#include <dory/journal/segment_reader.h>
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <base/crc.h>
+#include <base/error_utils.h>
+#include <base/io_utils.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Journal;
+
+TSegmentReader::TSegmentReader(const char *path)
+    : Fd(IfLt0(open(path, O_RDONLY))),
+      Buf(READ_SIZE),
+      BufOffset(0),
+      BufEnd(0),
+      Truncated(false) {
+}
+
+bool TSegmentReader::Next(TRecord &rec) {
+  assert(this);
+
+  if (!Fill(RECORD_FRAME_SIZE)) {
+    return false;
+  }
+
+  uint32_t crc = 0;
+  uint32_t payload_size = 0;
+  const uint8_t *frame = &Buf[BufOffset];
+  std::memcpy(&crc, frame, sizeof(crc));
+  std::memcpy(&payload_size, frame + sizeof(crc), sizeof(payload_size));
+
+  if (payload_size > MAX_RECORD_PAYLOAD_SIZE) {
+    Truncated = true;
+    return false;
+  }
+
+  if (!Fill(RECORD_FRAME_SIZE + payload_size)) {
+    return false;
+  }
+
+  const uint8_t *payload = &Buf[BufOffset + RECORD_FRAME_SIZE];
+
+  if ((ComputeCrc32(payload, payload_size) != crc) ||
+      !DecodePayload(payload, payload_size, rec)) {
+    Truncated = true;
+    return false;
+  }
+
+  BufOffset += RECORD_FRAME_SIZE + payload_size;
+  return true;
+}
+
+bool TSegmentReader::Fill(size_t size) {
+  assert(this);
+
+  if ((BufEnd - BufOffset) >= size) {
+    return true;
+  }
+
+  /* Move unconsumed bytes to the front of the buffer, and grow it if the
+     record is larger than the buffer. */
+  std::memmove(&Buf[0], &Buf[BufOffset], BufEnd - BufOffset);
+  BufEnd -= BufOffset;
+  BufOffset = 0;
+
+  if (Buf.size() < size) {
+    Buf.resize(size);
+  }
+
+  while (BufEnd < size) {
+    size_t n = ReadAtMost(Fd, &Buf[BufEnd], Buf.size() - BufEnd);
+
+    if (n == 0) {
+      /* Any leftover bytes are a partially written record. */
+      Truncated = (BufEnd != 0);
+      return false;
+    }
+
+    BufEnd += n;
+  }
+
+  return true;
+}
@@ -0,0 +1,83 @@
+/* <dory/journal/segment_reader.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Streaming reader for message journal segment files.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+#include <dory/journal/record.h>
+
+namespace Dory {
+
+  namespace Journal {
+
+    /* Reads the records of a journal segment file in order, without loading
+       more of the file into memory than the current record plus a fixed size
+       read buffer. */
+    class TSegmentReader final {
+      NO_COPY_SEMANTICS(TSegmentReader);
+
+      public:
+      /* Throws std::system_error if 'path' can't be opened. */
+      explicit TSegmentReader(const char *path);
+
+      /* Read the next record into 'rec' and return true, or return false if
+         there are no more valid records.  Pointers in 'rec' remain valid until
+         the next call.  A record left incomplete by a crash, or one whose CRC
+         doesn't match, ends the segment. */
+      bool Next(TRecord &rec);
+
+      /* Returns true if reading stopped at an incomplete or corrupt record
+         rather than a clean end of file. */
+      bool IsTruncated() const {
+        assert(this);
+        return Truncated;
+      }
+
+      private:
+      /* Size of each read from the segment file. */
+      static const size_t READ_SIZE = 256 * 1024;
+
+      /* Make sure at least 'size' unconsumed bytes are in 'Buf', reading more
+         of the file if needed.  Returns false on end of file. */
+      bool Fill(size_t size);
+
+      Base::TFd Fd;
+
+      std::vector<uint8_t> Buf;
+
+      /* Offset of first unconsumed byte in 'Buf'. */
+      size_t BufOffset;
+
+      /* Offset one past the last valid byte in 'Buf'. */
+      size_t BufEnd;
+
+      bool Truncated;
+    };  // TSegmentReader
+
+  }  // Journal
+
+}  // Dory
@@ -0,0 +1,161 @@
+/* <dory/journal/segment_reader.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/journal/segment_reader.h>.
+ */
+
+#include <dory/journal/segment_reader.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <base/error_utils.h>
+#include <base/fd.h>
+#include <base/io_utils.h>
+#include <base/tmp_dir.h>
+#include <dory/journal/record.h>
+#include <dory/msg_creator.h>
+#include <dory/test_util/misc_util.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Journal;
+using namespace Dory::TestUtil;
+
+namespace {
+
+  /* The fixture for testing class TSegmentReader. */
+  class TSegmentReaderTest : public ::testing::Test {
+    protected:
+    TSegmentReaderTest() {
+    }
+
+    virtual ~TSegmentReaderTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TSegmentReaderTest
+
+  void WriteFile(const std::string &path, const std::vector<uint8_t> &data) {
+    TFd fd(IfLt0(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)));
+
+    if (!data.empty()) {
+      WriteExactly(fd, &data[0], data.size());
+    }
+  }
+
+  std::string ToString(const char *data, size_t size) {
+    return std::string(data, size);
+  }
+
+  std::string ToString(const uint8_t *data, size_t size) {
+    return std::string(reinterpret_cast<const char *>(data), size);
+  }
+
+  TEST_F(TSegmentReaderTest, ReadRecords) {
+    TTmpDir dir("/tmp/dory_journal_test.XXXXXX", true);
+    std::string path = std::string(dir.GetName()) + "/segment";
+    TTestMsgCreator mc;
+    TMsg::TPtr msg1 = mc.NewMsg("topic1", "value1", 123, true);
+    std::string topic("topic2");
+    std::string key("key2");
+    std::string value(300 * 1024, 'x');
+    TMsg::TPtr msg2 = TMsgCreator::CreatePartitionKeyMsg(7, 456,
+        topic.data(), topic.data() + topic.size(), key.data(), key.size(),
+        value.data(), value.size(), false, *mc.Pool, mc.MsgStateTracker);
+    SetProcessed(msg2);
+    std::vector<uint8_t> data;
+    AppendMsgRecord(data, 1, *msg1);
+    AppendMsgRecord(data, 2, *msg2);
+    AppendAckRecord(data, 1);
+    WriteFile(path, data);
+
+    TSegmentReader reader(path.c_str());
+    TRecord rec;
+    ASSERT_TRUE(reader.Next(rec));
+    ASSERT_TRUE(rec.Type == TRecordType::Msg);
+    ASSERT_EQ(rec.Seq, 1U);
+    ASSERT_EQ(rec.Timestamp, 123);
+    ASSERT_TRUE(rec.RoutingType == TMsg::TRoutingType::AnyPartition);
+    ASSERT_EQ(ToString(rec.Topic, rec.TopicSize), "topic1");
+    ASSERT_EQ(rec.KeySize, 0U);
+    ASSERT_EQ(ToString(rec.Value, rec.ValueSize), "value1");
+    ASSERT_TRUE(reader.Next(rec));
+    ASSERT_TRUE(rec.Type == TRecordType::Msg);
+    ASSERT_EQ(rec.Seq, 2U);
+    ASSERT_EQ(rec.Timestamp, 456);
+    ASSERT_EQ(rec.PartitionKey, 7);
+    ASSERT_TRUE(rec.RoutingType == TMsg::TRoutingType::PartitionKey);
+    ASSERT_EQ(ToString(rec.Topic, rec.TopicSize), topic);
+    ASSERT_EQ(ToString(rec.Key, rec.KeySize), key);
+    ASSERT_EQ(ToString(rec.Value, rec.ValueSize), value);
+    ASSERT_TRUE(reader.Next(rec));
+    ASSERT_TRUE(rec.Type == TRecordType::Ack);
+    ASSERT_EQ(rec.Seq, 1U);
+    ASSERT_FALSE(reader.Next(rec));
+    ASSERT_FALSE(reader.IsTruncated());
+  }
+
+  TEST_F(TSegmentReaderTest, IncompleteRecord) {
+    TTmpDir dir("/tmp/dory_journal_test.XXXXXX", true);
+    std::string path = std::string(dir.GetName()) + "/segment";
+    TTestMsgCreator mc;
+    TMsg::TPtr msg = mc.NewMsg("topic", "value", 0, true);
+    std::vector<uint8_t> data;
+    AppendMsgRecord(data, 1, *msg);
+    size_t first_size = data.size();
+    AppendMsgRecord(data, 2, *msg);
+
+    /* Simulate a crash while writing the second record. */
+    data.resize(data.size() - 3);
+    WriteFile(path, data);
+    TSegmentReader reader(path.c_str());
+    TRecord rec;
+    ASSERT_TRUE(reader.Next(rec));
+    ASSERT_EQ(rec.Seq, 1U);
+    ASSERT_FALSE(reader.Next(rec));
+    ASSERT_TRUE(reader.IsTruncated());
+
+    /* A corrupted record also ends the segment. */
+    data.resize(first_size);
+    AppendAckRecord(data, 1);
+    data.back() ^= 0xff;
+    WriteFile(path, data);
+    TSegmentReader reader2(path.c_str());
+    ASSERT_TRUE(reader2.Next(rec));
+    ASSERT_FALSE(reader2.Next(rec));
+    ASSERT_TRUE(reader2.IsTruncated());
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
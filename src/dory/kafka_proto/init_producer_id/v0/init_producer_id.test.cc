@@ -0,0 +1,96 @@
+/* <dory/kafka_proto/init_producer_id/v0/init_producer_id.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for
+   <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.h> and
+   <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.h>.
+ */
+
+#include <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.h>
+#include <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.h>
+
+#include <vector>
+
+#include <base/field_access.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::KafkaProto::InitProducerId::V0;
+
+namespace {
+
+  /* The fixture for testing classes TInitProducerIdRequestWriter and
+     TInitProducerIdResponseReader. */
+  class TInitProducerIdTest : public ::testing::Test {
+    protected:
+    TInitProducerIdTest() {
+    }
+
+    virtual ~TInitProducerIdTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TInitProducerIdTest
+
+  TEST_F(TInitProducerIdTest, Request) {
+    std::vector<uint8_t> buf;
+    TInitProducerIdRequestWriter writer;
+    writer.WriteRequest(buf, 1234567, 60000);
+    ASSERT_EQ(buf.size(), 20U);
+    ASSERT_EQ(ReadInt32FromHeader(&buf[0]), 16);
+    ASSERT_EQ(ReadInt16FromHeader(&buf[4]), 22);  // API key
+    ASSERT_EQ(ReadInt16FromHeader(&buf[6]), 0);  // API version
+    ASSERT_EQ(ReadInt32FromHeader(&buf[8]), 1234567);
+    ASSERT_EQ(ReadInt16FromHeader(&buf[12]), -1);  // client ID
+    ASSERT_EQ(ReadInt16FromHeader(&buf[14]), -1);  // transactional ID
+    ASSERT_EQ(ReadInt32FromHeader(&buf[16]), 60000);
+  }
+
+  TEST_F(TInitProducerIdTest, Response) {
+    std::vector<uint8_t> buf(24);
+    WriteInt32ToHeader(&buf[0], 20);
+    WriteInt32ToHeader(&buf[4], 99);  // correlation ID
+    WriteInt32ToHeader(&buf[8], 0);  // throttle time
+    WriteInt16ToHeader(&buf[12], 0);  // error code
+    WriteInt64ToHeader(&buf[14], 123456789012LL);  // producer ID
+    WriteInt16ToHeader(&buf[22], 7);  // producer epoch
+    TInitProducerIdResponseReader reader(&buf[0], buf.size());
+    ASSERT_EQ(reader.GetCorrelationId(), 99);
+    ASSERT_EQ(reader.GetErrorCode(), 0);
+    ASSERT_EQ(reader.GetProducerId(), 123456789012LL);
+    ASSERT_EQ(reader.GetProducerEpoch(), 7);
+
+    ASSERT_THROW(TInitProducerIdResponseReader(&buf[0], buf.size() - 1),
+        TInitProducerIdResponseReader::TBadInitProducerIdResponse);
+    WriteInt32ToHeader(&buf[0], 19);
+    ASSERT_THROW(TInitProducerIdResponseReader(&buf[0], buf.size()),
+        TInitProducerIdResponseReader::TBadInitProducerIdResponse);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,54 @@
+/* <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements
+   <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.h>.
+ */
+
+#include <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.h>
+
+#include <cassert>
+
+#include <base/field_access.h>
+#include <dory/kafka_proto/request_response.h>
+
+using namespace Dory;
+using namespace Dory::KafkaProto;
+using namespace Dory::KafkaProto::InitProducerId::V0;
+
+void TInitProducerIdRequestWriter::WriteRequest(std::vector<uint8_t> &result,
+    int32_t correlation_id, int32_t transaction_timeout_ms) {
+  assert(this);
+  result.resize(REQUEST_SIZE);
+  uint8_t *pos = &result[0];
+  WriteInt32ToHeader(pos, REQUEST_SIZE - REQUEST_OR_RESPONSE_SIZE_SIZE);
+  pos += REQUEST_OR_RESPONSE_SIZE_SIZE;
+  WriteInt16ToHeader(pos, API_KEY);
+  pos += 2;
+  WriteInt16ToHeader(pos, API_VERSION);
+  pos += 2;
+  WriteInt32ToHeader(pos, correlation_id);
+  pos += 4;
+  WriteInt16ToHeader(pos, -1);  // empty client ID
+  pos += 2;
+  WriteInt16ToHeader(pos, -1);  // null transactional ID
+  pos += 2;
+  WriteInt32ToHeader(pos, transaction_timeout_ms);
+  pos += 4;
+  assert(pos == (&result[0] + REQUEST_SIZE));
+}
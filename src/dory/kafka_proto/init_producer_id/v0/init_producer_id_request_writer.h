@@ -0,0 +1,65 @@
+/* <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for writing a version 0 InitProducerId request, which asks a Kafka
+   broker to assign a producer ID for idempotent produce requests.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  namespace KafkaProto {
+
+    namespace InitProducerId {
+
+      namespace V0 {
+
+        class TInitProducerIdRequestWriter final {
+          NO_COPY_SEMANTICS(TInitProducerIdRequestWriter);
+
+          public:
+          enum { API_KEY = 22 };
+
+          enum { API_VERSION = 0 };
+
+          enum { REQUEST_SIZE = 20 };
+
+          TInitProducerIdRequestWriter() = default;
+
+          /* Write a request for a producer ID with no transactional ID to
+             'result', resizing 'result' to the size of the request.  Kafka
+             ignores 'transaction_timeout_ms' when there is no transactional
+             ID. */
+          void WriteRequest(std::vector<uint8_t> &result,
+              int32_t correlation_id, int32_t transaction_timeout_ms);
+        };  // TInitProducerIdRequestWriter
+
+      }  // V0
+
+    }  // InitProducerId
+
+  }  // KafkaProto
+
+}  // Dory
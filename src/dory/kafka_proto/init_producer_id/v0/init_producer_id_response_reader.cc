@@ -0,0 +1,60 @@
+/* <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements
+   <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.h>.
+ */
+
+#include <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.h>
+
+#include <base/field_access.h>
+#include <dory/kafka_proto/request_response.h>
+
+using namespace Dory;
+using namespace Dory::KafkaProto;
+using namespace Dory::KafkaProto::InitProducerId::V0;
+
+TInitProducerIdResponseReader::TInitProducerIdResponseReader(
+    const void *response, size_t response_size) {
+  assert(response || (response_size == 0));
+
+  if (response_size < RESPONSE_SIZE) {
+    THROW_ERROR(TBadInitProducerIdResponse);
+  }
+
+  const uint8_t *pos = reinterpret_cast<const uint8_t *>(response);
+  int32_t size_field = ReadInt32FromHeader(pos);
+
+  /* The size field doesn't include its own size. */
+  if ((size_field < static_cast<int32_t>(
+          RESPONSE_SIZE - REQUEST_OR_RESPONSE_SIZE_SIZE)) ||
+      ((static_cast<size_t>(size_field) + REQUEST_OR_RESPONSE_SIZE_SIZE) >
+          response_size)) {
+    THROW_ERROR(TBadInitProducerIdResponse);
+  }
+
+  pos += REQUEST_OR_RESPONSE_SIZE_SIZE;
+  CorrelationId = ReadInt32FromHeader(pos);
+  pos += 4;
+  pos += 4;  // skip throttle time
+  ErrorCode = ReadInt16FromHeader(pos);
+  pos += 2;
+  ProducerId = ReadInt64FromHeader(pos);
+  pos += 8;
+  ProducerEpoch = ReadInt16FromHeader(pos);
+}
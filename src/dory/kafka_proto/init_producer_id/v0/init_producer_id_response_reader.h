@@ -0,0 +1,91 @@
+/* <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for reading a version 0 InitProducerId response from a Kafka broker.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include <base/no_copy_semantics.h>
+#include <base/thrower.h>
+
+namespace Dory {
+
+  namespace KafkaProto {
+
+    namespace InitProducerId {
+
+      namespace V0 {
+
+        class TInitProducerIdResponseReader final {
+          NO_COPY_SEMANTICS(TInitProducerIdResponseReader);
+
+          public:
+          DEFINE_ERROR(TBadInitProducerIdResponse, std::runtime_error,
+              "Kafka InitProducerId response is invalid");
+
+          enum { RESPONSE_SIZE = 24 };
+
+          /* Parse the response given by 'response' and 'response_size',
+             which includes the leading size field.  Throw
+             TBadInitProducerIdResponse if it is truncated or malformed. */
+          TInitProducerIdResponseReader(const void *response,
+              size_t response_size);
+
+          int32_t GetCorrelationId() const {
+            assert(this);
+            return CorrelationId;
+          }
+
+          int16_t GetErrorCode() const {
+            assert(this);
+            return ErrorCode;
+          }
+
+          int64_t GetProducerId() const {
+            assert(this);
+            return ProducerId;
+          }
+
+          int16_t GetProducerEpoch() const {
+            assert(this);
+            return ProducerEpoch;
+          }
+
+          private:
+          int32_t CorrelationId;
+
+          int16_t ErrorCode;
+
+          int64_t ProducerId;
+
+          int16_t ProducerEpoch;
+        };  // TInitProducerIdResponseReader
+
+      }  // V0
+
+    }  // InitProducerId
+
+  }  // KafkaProto
+
+}  // Dory
@@ -227,6 +227,77 @@ static const TKafkaErrorInfo KafkaErrorInfoTable[] = {
   {
     "unsupported for message format",
     "The message format version on the broker does not support the request."
+  },
+  {
+    "policy violation",
+    "Request parameters do not satisfy the configured policy."
+  },
+  {
+    "out of order sequence number",
+    "The broker received an out of order sequence number."
+  },
+  {
+    "duplicate sequence number",
+    "The broker received a duplicate sequence number."
+  },
+  {
+    "invalid producer epoch",
+    "Producer attempted an operation with an old epoch."
+  },
+  {
+    "invalid txn state",
+    "The producer attempted a transactional operation in an invalid state."
+  },
+  {
+    "invalid producer ID mapping",
+    "The producer attempted to use a producer ID which is not currently "
+        "assigned to its transactional ID."
+  },
+  {
+    "invalid transaction timeout",
+    "The transaction timeout is larger than the maximum value allowed by the "
+        "broker."
+  },
+  {
+    "concurrent transactions",
+    "The producer attempted to update a transaction while another "
+        "concurrent operation on the same transaction was ongoing."
+  },
+  {
+    "transaction coordinator fenced",
+    "Indicates that the transaction coordinator sending a WriteTxnMarker is "
+        "no longer the current coordinator for a given producer."
+  },
+  {
+    "transactional ID authorization failed",
+    "Transactional ID authorization failed."
+  },
+  {
+    "security disabled",
+    "Security features are disabled."
+  },
+  {
+    "operation not attempted",
+    "The broker did not attempt to execute this operation.  This may happen "
+        "for batched RPCs where some operations in the batch failed, causing "
+        "the broker to respond without trying the rest."
+  },
+  {
+    "Kafka storage error",
+    "Disk error when trying to access log file on the disk."
+  },
+  {
+    "log dir not found",
+    "The user-specified log directory is not found in the broker config."
+  },
+  {
+    "SASL authentication failed",
+    "SASL authentication failed."
+  },
+  {
+    "unknown producer ID",
+    "This exception is raised by the broker if it could not locate the "
+        "producer metadata associated with the producer ID in question."
   }
 };
 
@@ -73,7 +73,23 @@ namespace Dory {
       InvalidConfig = 40,
       NotController = 41,
       InvalidRequest = 42,
-      UnsupportedForMessageFormat = 43
+      UnsupportedForMessageFormat = 43,
+      PolicyViolation = 44,
+      OutOfOrderSequenceNumber = 45,
+      DuplicateSequenceNumber = 46,
+      InvalidProducerEpoch = 47,
+      InvalidTxnState = 48,
+      InvalidProducerIdMapping = 49,
+      InvalidTransactionTimeout = 50,
+      ConcurrentTransactions = 51,
+      TransactionCoordinatorFenced = 52,
+      TransactionalIdAuthorizationFailed = 53,
+      SecurityDisabled = 54,
+      OperationNotAttempted = 55,
+      KafkaStorageError = 56,
+      LogDirNotFound = 57,
+      SaslAuthenticationFailed = 58,
+      UnknownProducerId = 59
     };
 
     struct TKafkaErrorInfo {
@@ -28,6 +28,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <base/no_copy_semantics.h>
@@ -68,6 +69,14 @@ namespace Dory {
             std::vector<uint8_t> &result, const char *topic,
             int32_t correlation_id) const = 0;
 
+        /* Write a request for the topics in 'topics', which must not be empty,
+           to 'result'.  Resize 'result' to the size of the written request.
+         */
+        virtual void WriteMultiTopicMetadataRequest(
+            std::vector<uint8_t> &result,
+            const std::vector<std::string> &topics,
+            int32_t correlation_id) const = 0;
+
         /* Throws a subclass of std::runtime_error on bad metadata response.
            Caller assumes responsibility for deleting returned object. */
         virtual TMetadata *BuildMetadataFromResponse(const void *response_buf,
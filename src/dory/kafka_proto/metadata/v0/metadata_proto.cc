@@ -60,6 +60,14 @@ void TMetadataProto::WriteSingleTopicMetadataRequest(
       topic + std::strlen(topic), correlation_id);
 }
 
+void TMetadataProto::WriteMultiTopicMetadataRequest(
+    std::vector<uint8_t> &result, const std::vector<std::string> &topics,
+    int32_t correlation_id) const {
+  assert(this);
+  TMetadataRequestWriter().WriteMultiTopicRequest(result, topics,
+      correlation_id);
+}
+
 static inline bool CanSendToPartition(int16_t error_code) {
   /* Note: If a replica is not available, it is still OK to send to the leader.
    */
@@ -128,6 +128,54 @@ namespace {
     ASSERT_TRUE(reader->GetTopicEnd() == nullptr);
   }
 
+  TEST_F(TMetadataRequestTest, MultiTopicTest) {
+    std::vector<std::string> topics;
+    topics.push_back("topic1");
+    topics.push_back("another topic");
+    topics.push_back("t");
+    std::vector<uint8_t> buf;
+    TMetadataRequestWriter().WriteMultiTopicRequest(buf, topics, 12345);
+    TOpt<TMetadataRequestReader> reader;
+    bool threw = false;
+
+    try {
+      reader.MakeKnown(&buf[0], buf.size());
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+
+    ASSERT_FALSE(threw);
+    ASSERT_EQ(TMetadataRequestReader::RequestSize(&buf[0]), buf.size());
+    ASSERT_EQ(reader->GetCorrelationId(), 12345);
+    ASSERT_FALSE(reader->IsAllTopics());
+    ASSERT_EQ(reader->GetTopicCount(), 3U);
+    std::string first(reader->GetTopicBegin(), reader->GetTopicEnd());
+    ASSERT_EQ(first, topics[0]);
+    std::vector<std::string> topics_copy;
+    reader->GetTopics(topics_copy);
+    ASSERT_TRUE(topics_copy == topics);
+
+    /* A single topic written as a list matches a single topic request. */
+    std::vector<uint8_t> single_buf;
+    topics.resize(1);
+    TMetadataRequestWriter().WriteMultiTopicRequest(buf, topics, 12345);
+    TMetadataRequestWriter().WriteSingleTopicRequest(single_buf,
+        topics[0].data(), topics[0].data() + topics[0].size(), 12345);
+    ASSERT_TRUE(buf == single_buf);
+
+    /* Topic size runs past the end of the request. */
+    ++buf[TMetadataRequestFields::TOPIC_NAME_LENGTH_OFFSET + 1];
+    threw = false;
+
+    try {
+      TMetadataRequestReader(&buf[0], buf.size());
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+
+    ASSERT_TRUE(threw);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
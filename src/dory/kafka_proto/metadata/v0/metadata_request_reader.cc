@@ -33,7 +33,8 @@ TMetadataRequestReader::TMetadataRequestReader(const void *request,
     size_t request_size)
     : Begin(AssignBuf(request)),
       End(Begin + RequestSize(Begin)),
-      AllTopics(false) {
+      AllTopics(false),
+      TopicCount(0) {
   assert((Begin + request_size) == End);
 
   if (request_size < MinSize()) {
@@ -61,35 +62,37 @@ TMetadataRequestReader::TMetadataRequestReader(const void *request,
   int32_t topic_count =
       ReadInt32FromHeader(Begin + THdr::TOPIC_COUNT_OFFSET);
 
-  /* We only send metadata requests for a single topic or all topics. */
-  if ((topic_count != 0) && (topic_count != 1)) {
+  if (topic_count < 0) {
     THROW_ERROR(TBadTopicCount);
   }
 
   AllTopics = (topic_count == 0);
+  TopicCount = static_cast<size_t>(topic_count);
+  const uint8_t *pos = Begin + MinSize();
 
-  if (AllTopics) {
-    if (request_size != MinSize()) {
-      THROW_ERROR(TBadRequestSize);
-    }
-  } else {
-    if (request_size < SingleTopicHeaderSize()) {
+  for (size_t i = 0; i < TopicCount; ++i) {
+    if ((End - pos) < static_cast<ptrdiff_t>(THdr::TOPIC_NAME_LENGTH_SIZE)) {
       THROW_ERROR(TBadRequestSize);
     }
 
-    int16_t topic_size = ReadInt16FromHeader(
-        Begin + THdr::TOPIC_NAME_LENGTH_OFFSET);
+    int16_t topic_size = ReadInt16FromHeader(pos);
 
     /* We assume that the empty string is not a valid topic name. */
     if (topic_size < 1) {
       THROW_ERROR(TBadTopicSize);
     }
 
-    size_t computed_request_size = topic_size + SingleTopicHeaderSize();
+    pos += THdr::TOPIC_NAME_LENGTH_SIZE;
 
-    if (computed_request_size != request_size) {
+    if ((End - pos) < topic_size) {
       THROW_ERROR(TBadRequestSize);
     }
+
+    pos += topic_size;
+  }
+
+  if (pos != End) {
+    THROW_ERROR(TBadRequestSize);
   }
 }
 
@@ -107,3 +110,18 @@ const char *TMetadataRequestReader::GetTopicEnd() const {
       reinterpret_cast<const char *>(Begin + SingleTopicHeaderSize() +
           ReadInt16FromHeader(Begin + THdr::TOPIC_NAME_LENGTH_OFFSET));
 }
+
+void TMetadataRequestReader::GetTopics(
+    std::vector<std::string> &result) const {
+  assert(this);
+  result.clear();
+  const uint8_t *pos = Begin + MinSize();
+
+  for (size_t i = 0; i < TopicCount; ++i) {
+    int16_t topic_size = ReadInt16FromHeader(pos);
+    pos += THdr::TOPIC_NAME_LENGTH_SIZE;
+    const char *topic_begin = reinterpret_cast<const char *>(pos);
+    result.emplace_back(topic_begin, topic_begin + topic_size);
+    pos += topic_size;
+  }
+}
@@ -25,6 +25,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <base/field_access.h>
 #include <base/thrower.h>
@@ -39,10 +41,11 @@ namespace Dory {
       namespace V0 {
 
         /* Class for reading a metadata request.  To keep things simple, this
-           class only supports two kinds of metadata requests:
+           class only supports three kinds of metadata requests:
 
                1.  A request for a single topic.
-               2.  A request for all topics, which is specified by leaving the
+               2.  A request for a list of topics.
+               3.  A request for all topics, which is specified by leaving the
                    topic list empty. */
         class TMetadataRequestReader final {
           using THdr = TMetadataRequestFields;
@@ -122,20 +125,33 @@ namespace Dory {
             return AllTopics;
           }
 
-          /* Returns a pointer to the first byte of the topic, or null if this
-             is an all topics request. */
+          /* Returns the number of topics in the request, which is 0 for an
+             all topics request. */
+          size_t GetTopicCount() const {
+            assert(this);
+            return TopicCount;
+          }
+
+          /* Returns a pointer to the first byte of the first topic, or null if
+             this is an all topics request. */
           const char * GetTopicBegin() const;
 
-          /* Returns a pointer one byte past the last byte of the topic, or
-             null if this is an all topics request. */
+          /* Returns a pointer one byte past the last byte of the first topic,
+             or null if this is an all topics request. */
           const char * GetTopicEnd() const;
 
+          /* Replace the contents of 'result' with all topics in the request.
+           */
+          void GetTopics(std::vector<std::string> &result) const;
+
           private:
           const uint8_t *Begin;
 
           const uint8_t *End;
 
           bool AllTopics;
+
+          size_t TopicCount;
         };  // TMetadataRequestReader
 
       }  // V0
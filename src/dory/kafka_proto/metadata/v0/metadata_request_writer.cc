@@ -57,6 +57,43 @@ void TMetadataRequestWriter::WriteSingleTopicRequest(
   std::memcpy(&result[NUM_SINGLE_TOPIC_HEADER_BYTES], topic_begin, topic_size);
 }
 
+void TMetadataRequestWriter::WriteMultiTopicRequest(
+    std::vector<uint8_t> &result, const std::vector<std::string> &topics,
+    int32_t correlation_id) {
+  assert(this);
+  assert(!topics.empty());
+  size_t size = NUM_ALL_TOPICS_HEADER_BYTES;
+
+  for (const std::string &topic : topics) {
+    assert(!topic.empty());
+    assert(topic.size() <=
+           static_cast<size_t>(std::numeric_limits<int16_t>::max()));
+    size += THdr::TOPIC_NAME_LENGTH_SIZE + topic.size();
+  }
+
+  result.resize(size);
+  uint8_t *buf = &result[0];
+  WriteInt32ToHeader(buf,
+      static_cast<int32_t>(size - THdr::REQUEST_SIZE_SIZE));
+  WriteInt16ToHeader(buf + THdr::API_KEY_OFFSET, THdr::API_KEY);
+  WriteInt16ToHeader(buf + THdr::API_VERSION_OFFSET, THdr::API_VERSION);
+  WriteInt32ToHeader(buf + THdr::CORRELATION_ID_OFFSET, correlation_id);
+  WriteInt16ToHeader(buf + THdr::CLIENT_ID_LENGTH_OFFSET,
+                     THdr::EMPTY_STRING_LENGTH);
+  WriteInt32ToHeader(buf + THdr::TOPIC_COUNT_OFFSET,
+                     static_cast<int32_t>(topics.size()));
+  uint8_t *pos = buf + THdr::TOPIC_NAME_LENGTH_OFFSET;
+
+  for (const std::string &topic : topics) {
+    WriteInt16ToHeader(pos, static_cast<int16_t>(topic.size()));
+    pos += THdr::TOPIC_NAME_LENGTH_SIZE;
+    std::memcpy(pos, topic.data(), topic.size());
+    pos += topic.size();
+  }
+
+  assert(pos == (buf + size));
+}
+
 void TMetadataRequestWriter::WriteAllTopicsRequest(struct iovec &iov,
     void *header_buf, int32_t correlation_id) {
   assert(this);
@@ -24,6 +24,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include <sys/uio.h>
@@ -39,11 +40,12 @@ namespace Dory {
 
       namespace V0 {
 
-        /* To keep things simple, this class only supports two kinds of
+        /* To keep things simple, this class only supports three kinds of
            metadata requests:
 
                1.  A request for a single topic.
-               2.  A request for all topics, which is specified by leaving the
+               2.  A request for a list of topics.
+               3.  A request for all topics, which is specified by leaving the
                    topic list empty.
          */
         class TMetadataRequestWriter final {
@@ -84,6 +86,12 @@ namespace Dory {
               const char *topic_begin, const char *topic_end,
               int32_t correlation_id);
 
+          /* Write a request for the topics in 'topics', which must not be
+             empty, to 'result'.  Resize 'result' to the size of the written
+             request. */
+          void WriteMultiTopicRequest(std::vector<uint8_t> &result,
+              const std::vector<std::string> &topics, int32_t correlation_id);
+
           /* An all topics request requires 1 iovec structure, given by
              parameter 'iov'.  'header_buf' points to a caller-supplied buffer
              with space for the number of bytes returned by static method
@@ -51,7 +51,11 @@ namespace Dory {
           Resend,
           Discard,
           Pause,
-          DiscardAndPause
+          DiscardAndPause,
+
+          /* The broker no longer accepts the producer ID or sequence numbers
+             in use.  Get a new producer ID and resend after pausing. */
+          ResetProducerAndPause
         };
 
         virtual ~TProduceProtocol() noexcept { }
@@ -63,6 +67,13 @@ namespace Dory {
           return Constants.SingleMsgOverhead;
         }
 
+        /* Return true if message sets can carry a producer ID and sequence
+           numbers, so the broker can discard duplicates on resend. */
+        bool SupportsIdempotence() const {
+          assert(this);
+          return Constants.SupportsIdempotence;
+        }
+
         /* Return a pointer to a newly created produce request writer object.
            Caller assumes responsibility for deleting object. */
         virtual TProduceRequestWriterApi *
@@ -84,6 +95,8 @@ namespace Dory {
           /* This is the number of bytes of overhead for a single message in a
              produce request. */
           size_t SingleMsgOverhead;
+
+          bool SupportsIdempotence;
         };
 
         explicit TProduceProtocol(const TConstants &constants)
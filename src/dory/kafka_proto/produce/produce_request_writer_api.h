@@ -34,6 +34,29 @@ namespace Dory {
 
     namespace Produce {
 
+      /* Idempotent producer state for a single message set.  The default
+         values indicate a message set sent without idempotence. */
+      struct TProducerSequence {
+        int64_t ProducerId;
+
+        int16_t ProducerEpoch;
+
+        int32_t BaseSequence;
+
+        TProducerSequence()
+            : ProducerId(-1),
+              ProducerEpoch(-1),
+              BaseSequence(-1) {
+        }
+
+        TProducerSequence(int64_t producer_id, int16_t producer_epoch,
+            int32_t base_sequence)
+            : ProducerId(producer_id),
+              ProducerEpoch(producer_epoch),
+              BaseSequence(base_sequence) {
+        }
+      };  // TProducerSequence
+
       class TProduceRequestWriterApi {
         NO_COPY_SEMANTICS(TProduceRequestWriterApi);
 
@@ -52,6 +75,13 @@ namespace Dory {
 
         virtual void OpenMsgSet(int32_t partition) = 0;
 
+        /* Called after OpenMsgSet() and before any messages are written.
+           'msg_count' is the number of messages the caller will write, or
+           the number of messages inside a compressed message set.  Versions
+           of the wire format without record batches ignore this. */
+        virtual void SetMsgSetInfo(size_t msg_count,
+            const TProducerSequence &seq) = 0;
+
         virtual void OpenMsg(Compress::TCompressionType compression_type,
             size_t key_size, size_t value_size) = 0;
 
@@ -415,5 +415,6 @@ TProduceProtocol::TConstants TProduceProto::ComputeConstants() {
   constants.SingleMsgOverhead = PRC::MSG_OFFSET_SIZE + PRC::MSG_SIZE_SIZE +
       PRC::CRC_SIZE + PRC::MAGIC_BYTE_SIZE + PRC::ATTRIBUTES_SIZE +
       PRC::KEY_LEN_SIZE + PRC::VALUE_LEN_SIZE;
+  constants.SupportsIdempotence = false;
   return constants;
 }
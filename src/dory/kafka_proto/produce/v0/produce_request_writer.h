@@ -63,6 +63,10 @@ namespace Dory {
 
           virtual void OpenMsgSet(int32_t partition) override;
 
+          virtual void SetMsgSetInfo(size_t /*msg_count*/,
+              const TProducerSequence &/*seq*/) override {
+          }
+
           virtual void OpenMsg(Compress::TCompressionType compression_type,
               size_t key_size, size_t value_size) override;
 
@@ -0,0 +1,242 @@
+/* <dory/kafka_proto/produce/v3/msg_set_writer.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/kafka_proto/produce/v3/msg_set_writer.h>.
+ */
+
+#include <dory/kafka_proto/produce/v3/msg_set_writer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace Dory;
+using namespace Dory::Compress;
+using namespace Dory::KafkaProto::Produce::V3;
+
+TMsgSetWriter::TMsgSetWriter() {
+  Reset();
+}
+
+void TMsgSetWriter::Reset() {
+  assert(this);
+  Buf = nullptr;
+  State = TState::Idle;
+  AtOffset = 0;
+  MsgSetSize = 0;
+  FirstRecordOffset = 0;
+  CurrentRecordOffset = 0;
+  MsgCount = 0;
+  CurrentMsgKeyOffset = 0;
+  CurrentMsgValueOffset = 0;
+  CurrentMsgKeySize = 0;
+  CurrentMsgValueSize = 0;
+}
+
+void TMsgSetWriter::OpenMsgSet(std::vector<uint8_t> &result_buf, bool append) {
+  assert(this);
+
+  /* Make sure we start in a sane state.  This guards against cases where an
+     exception previously thrown by this object leaves it in a bad state and we
+     later reuse it for another produce request. */
+  Reset();
+
+  assert(State == TState::Idle);
+  assert(&result_buf);
+
+  if (!append) {
+    result_buf.clear();
+  }
+
+  Buf = &result_buf;
+  AtOffset = Buf->size();
+  FirstRecordOffset = AtOffset;
+  State = TState::InMsgSet;
+}
+
+void TMsgSetWriter::OpenMsg(TCompressionType /*compression_type*/,
+    size_t key_size, size_t value_size) {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(Buf);
+  assert(key_size <= std::numeric_limits<int32_t>::max());
+  assert(value_size <= std::numeric_limits<int32_t>::max());
+  assert(AtOffset == Buf->size());
+  size_t body_size = ComputeRecordBodySize(key_size, value_size);
+
+  /* The header count field that follows the value is appended by CloseMsg(),
+     so the value stays at the end of the buffer while the record is open. */
+  Buf->resize(Buf->size() + VarIntSize(static_cast<int32_t>(body_size)) +
+      body_size - PRC::HEADER_COUNT_SIZE);
+  CurrentRecordOffset = AtOffset;
+  WriteRecordPrefix(key_size, value_size);
+  CurrentMsgKeySize = key_size;
+  CurrentMsgValueSize = value_size;
+  assert((CurrentMsgValueOffset + value_size) == Buf->size());
+  State = TState::InMsg;
+}
+
+size_t TMsgSetWriter::GetCurrentMsgKeyOffset() const {
+  assert(this);
+  assert(State == TState::InMsg);
+  assert(Buf);
+  assert(CurrentMsgKeyOffset > CurrentRecordOffset);
+  return CurrentMsgKeyOffset;
+}
+
+size_t TMsgSetWriter::GetCurrentMsgValueOffset() const {
+  assert(this);
+  assert(State == TState::InMsg);
+  assert(Buf);
+  assert(CurrentMsgValueOffset > CurrentRecordOffset);
+  return CurrentMsgValueOffset;
+}
+
+void TMsgSetWriter::AdjustValueSize(size_t new_size) {
+  assert(this);
+  assert(State == TState::InMsg);
+  assert(Buf);
+  assert(new_size <= std::numeric_limits<int32_t>::max());
+
+  /* The length fields are varints, so changing the value size may change
+     their sizes and move the key and value. */
+  size_t body_size = ComputeRecordBodySize(CurrentMsgKeySize, new_size);
+  size_t key_offset = CurrentRecordOffset +
+      VarIntSize(static_cast<int32_t>(body_size)) +
+      PRC::RECORD_ATTRIBUTES_SIZE + PRC::TIMESTAMP_DELTA_SIZE +
+      VarIntSize(static_cast<int32_t>(MsgCount)) +
+      VarIntSize(LengthField(CurrentMsgKeySize));
+  size_t value_offset = key_offset + CurrentMsgKeySize +
+      VarIntSize(LengthField(new_size));
+  size_t keep = std::min(CurrentMsgValueSize, new_size);
+
+  if ((value_offset + new_size) > Buf->size()) {
+    Buf->resize(value_offset + new_size);
+  }
+
+  uint8_t *base = &(*Buf)[0];
+
+  /* When growing, the key and value only move toward the end of the buffer,
+     so move the value before the key.  When shrinking, do the opposite. */
+  if (value_offset >= CurrentMsgValueOffset) {
+    std::memmove(base + value_offset, base + CurrentMsgValueOffset, keep);
+    std::memmove(base + key_offset, base + CurrentMsgKeyOffset,
+        CurrentMsgKeySize);
+  } else {
+    std::memmove(base + key_offset, base + CurrentMsgKeyOffset,
+        CurrentMsgKeySize);
+    std::memmove(base + value_offset, base + CurrentMsgValueOffset, keep);
+  }
+
+  WriteRecordPrefix(CurrentMsgKeySize, new_size);
+  assert(CurrentMsgKeyOffset == key_offset);
+  assert(CurrentMsgValueOffset == value_offset);
+  Buf->resize(value_offset + new_size);
+  CurrentMsgValueSize = new_size;
+  assert((CurrentMsgValueOffset + new_size) == Buf->size());
+}
+
+void TMsgSetWriter::RollbackOpenMsg() {
+  assert(this);
+  assert(State == TState::InMsg);
+  assert(Buf);
+  assert(CurrentMsgKeyOffset > CurrentRecordOffset);
+  assert(CurrentMsgValueOffset > CurrentRecordOffset);
+  Buf->resize(CurrentRecordOffset);
+  AtOffset = CurrentRecordOffset;
+  CurrentRecordOffset = 0;
+  CurrentMsgKeyOffset = 0;
+  CurrentMsgValueOffset = 0;
+  CurrentMsgKeySize = 0;
+  CurrentMsgValueSize = 0;
+  State = TState::InMsgSet;
+}
+
+void TMsgSetWriter::CloseMsg() {
+  assert(this);
+  assert(State == TState::InMsg);
+  assert(Buf);
+  assert(CurrentMsgKeyOffset > CurrentRecordOffset);
+  assert(CurrentMsgValueOffset > CurrentRecordOffset);
+  assert(Buf->size() >= CurrentMsgValueOffset);
+  assert((Buf->size() - CurrentMsgValueOffset) == CurrentMsgValueSize);
+  Buf->push_back(0);  // header count
+  AtOffset = Buf->size();
+  MsgSetSize += AtOffset - CurrentRecordOffset;
+  CurrentRecordOffset = 0;
+  CurrentMsgKeyOffset = 0;
+  CurrentMsgValueOffset = 0;
+  CurrentMsgKeySize = 0;
+  CurrentMsgValueSize = 0;
+  ++MsgCount;
+  State = TState::InMsgSet;
+}
+
+void TMsgSetWriter::AddMsg(TCompressionType compression_type,
+    const uint8_t *key_begin, const uint8_t *key_end,
+    const uint8_t *value_begin, const uint8_t *value_end) {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(Buf);
+  assert(key_begin || (!key_begin && !key_end));
+  assert(key_end >= key_begin);
+  size_t key_size = key_end - key_begin;
+  assert(key_size <= std::numeric_limits<int32_t>::max());
+  assert(value_begin || (!value_begin && !value_end));
+  assert(value_end >= value_begin);
+  size_t value_size = value_end - value_begin;
+  assert(value_size <= std::numeric_limits<int32_t>::max());
+  OpenMsg(compression_type, key_size, value_size);
+
+  if (key_size) {
+    std::memcpy(&(*Buf)[GetCurrentMsgKeyOffset()], key_begin, key_size);
+  }
+
+  if (value_size) {
+    std::memcpy(&(*Buf)[GetCurrentMsgValueOffset()], value_begin, value_size);
+  }
+
+  CloseMsg();
+}
+
+size_t TMsgSetWriter::CloseMsgSet() {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(Buf);
+  assert(AtOffset >= FirstRecordOffset);
+  assert(MsgSetSize == (AtOffset - FirstRecordOffset));
+  State = TState::Idle;
+  assert(MsgSetSize <= std::numeric_limits<int32_t>::max());
+  return MsgSetSize;
+}
+
+void TMsgSetWriter::WriteRecordPrefix(size_t key_size, size_t value_size) {
+  assert(this);
+  assert(Buf);
+  size_t body_size = ComputeRecordBodySize(key_size, value_size);
+  uint8_t *pos = &(*Buf)[CurrentRecordOffset];
+  pos += WriteVarInt(pos, static_cast<int32_t>(body_size));  // length
+  *pos++ = 0;  // attributes
+  *pos++ = 0;  // timestamp delta
+  pos += WriteVarInt(pos, static_cast<int32_t>(MsgCount));  // offset delta
+  pos += WriteVarInt(pos, LengthField(key_size));  // key length
+  CurrentMsgKeyOffset = pos - &(*Buf)[0];  // key goes here
+  pos += key_size;  // skip space for key
+  pos += WriteVarInt(pos, LengthField(value_size));  // value length
+  CurrentMsgValueOffset = pos - &(*Buf)[0];  // value goes here
+}
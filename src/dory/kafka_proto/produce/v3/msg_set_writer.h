@@ -0,0 +1,147 @@
+/* <dory/kafka_proto/produce/v3/msg_set_writer.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for writing the records of a record batch to a caller-supplied
+   growable buffer of type std::vector<uint8_t>.  The batch header is written
+   by the produce request writer, so the output of this class by itself is
+   what gets compressed when a batch is sent compressed.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <dory/compress/compression_type.h>
+#include <dory/kafka_proto/produce/msg_set_writer_api.h>
+#include <dory/kafka_proto/produce/v3/produce_request_constants.h>
+#include <dory/kafka_proto/produce/v3/varint.h>
+
+namespace Dory {
+
+  namespace KafkaProto {
+
+    namespace Produce {
+
+      namespace V3 {
+
+        class TMsgSetWriter final : public TMsgSetWriterApi {
+          NO_COPY_SEMANTICS(TMsgSetWriter);
+
+          public:
+          TMsgSetWriter();
+
+          virtual ~TMsgSetWriter() noexcept { }
+
+          virtual void Reset() override;
+
+          virtual void OpenMsgSet(std::vector<uint8_t> &result_buf,
+              bool append) override;
+
+          /* Records have no compression attributes of their own, so
+             'compression_type' is ignored.  A compressed batch gets its
+             compression type from the batch header. */
+          virtual void OpenMsg(Compress::TCompressionType compression_type,
+              size_t key_size, size_t value_size) override;
+
+          virtual size_t GetCurrentMsgKeyOffset() const override;
+
+          virtual size_t GetCurrentMsgValueOffset() const override;
+
+          virtual void AdjustValueSize(size_t new_size) override;
+
+          virtual void RollbackOpenMsg() override;
+
+          virtual void CloseMsg() override;
+
+          virtual void AddMsg(Compress::TCompressionType compression_type,
+              const uint8_t *key_begin, const uint8_t *key_end,
+              const uint8_t *value_begin, const uint8_t *value_end) override;
+
+          virtual size_t CloseMsgSet() override;
+
+          /* Return the number of records written since OpenMsgSet(). */
+          size_t GetMsgCount() const {
+            assert(this);
+            return MsgCount;
+          }
+
+          private:
+          using PRC = TProduceRequestConstants;
+
+          enum class TState {
+            Idle,
+            InMsgSet,
+            InMsg
+          };  // TState
+
+          /* Empty keys and values are written with length -1. */
+          static int32_t LengthField(size_t size) {
+            return size ? static_cast<int32_t>(size) : -1;
+          }
+
+          /* Return the size of the current record minus its length field,
+             given the sizes of its key and value. */
+          size_t ComputeRecordBodySize(size_t key_size,
+              size_t value_size) const {
+            assert(this);
+            return PRC::RECORD_ATTRIBUTES_SIZE + PRC::TIMESTAMP_DELTA_SIZE +
+                VarIntSize(static_cast<int32_t>(MsgCount)) +
+                VarIntSize(LengthField(key_size)) + key_size +
+                VarIntSize(LengthField(value_size)) + value_size +
+                PRC::HEADER_COUNT_SIZE;
+          }
+
+          /* Write all fields of the current record that precede its key, and
+             the value length field that follows its key.  Set
+             CurrentMsgKeyOffset and CurrentMsgValueOffset accordingly. */
+          void WriteRecordPrefix(size_t key_size, size_t value_size);
+
+          std::vector<uint8_t> *Buf;
+
+          TState State;
+
+          size_t AtOffset;
+
+          size_t MsgSetSize;
+
+          size_t FirstRecordOffset;
+
+          size_t CurrentRecordOffset;
+
+          size_t MsgCount;
+
+          size_t CurrentMsgKeyOffset;
+
+          size_t CurrentMsgValueOffset;
+
+          size_t CurrentMsgKeySize;
+
+          size_t CurrentMsgValueSize;
+        };  // TMsgSetWriter
+
+      }  // V3
+
+    }  // Produce
+
+  }  // KafkaProto
+
+}  // Dory
@@ -0,0 +1,134 @@
+/* <dory/kafka_proto/produce/v3/produce_proto.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/kafka_proto/produce/v3/produce_proto.h>.
+ */
+
+#include <dory/kafka_proto/produce/v3/produce_proto.h>
+
+#include <cassert>
+
+#include <syslog.h>
+
+#include <dory/kafka_proto/kafka_error_code.h>
+#include <dory/kafka_proto/produce/v3/msg_set_writer.h>
+#include <dory/kafka_proto/produce/v3/produce_request_constants.h>
+#include <dory/kafka_proto/produce/v3/produce_request_writer.h>
+#include <dory/kafka_proto/produce/v3/produce_response_reader.h>
+#include <dory/util/time_util.h>
+#include <server/counter.h>
+
+using namespace Dory;
+using namespace Dory::KafkaProto;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::KafkaProto::Produce::V3;
+using namespace Dory::Util;
+
+SERVER_COUNTER(AckDuplicateSequenceNumber);
+SERVER_COUNTER(AckErrorInvalidProducerEpoch);
+SERVER_COUNTER(AckErrorKafkaStorageError);
+SERVER_COUNTER(AckErrorOutOfOrderSequenceNumber);
+SERVER_COUNTER(AckErrorPolicyViolation);
+SERVER_COUNTER(AckErrorUnknownProducerId);
+
+TProduceRequestWriterApi *
+TProduceProto::CreateProduceRequestWriter() const {
+  assert(this);
+  return new TProduceRequestWriter;
+}
+
+TMsgSetWriterApi *
+TProduceProto::CreateMsgSetWriter() const {
+  assert(this);
+  return new TMsgSetWriter;
+}
+
+TProduceResponseReaderApi *
+TProduceProto::CreateProduceResponseReader() const {
+  assert(this);
+  return new TProduceResponseReader;
+}
+
+static void MaybeLogError(bool log_error, int16_t ack_value) {
+  if (log_error) {
+    const auto &error_info = LookupKafkaErrorCode(ack_value);
+    syslog(LOG_ERR, "Kafka ACK returned error %d (%s): %s",
+        static_cast<int>(ack_value), error_info.ErrorName,
+        error_info.ErrorDescription);
+  }
+}
+
+TProduceProtocol::TAckResultAction
+TProduceProto::ProcessAck(int16_t ack_value) const {
+  assert(this);
+
+  /* See https://kafka.apache.org/protocol for documentation on the error codes
+     below. */
+  switch (static_cast<TKafkaErrorCode>(ack_value)) {
+    case TKafkaErrorCode::PolicyViolation: {
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+      MaybeLogError(lim.Test(), ack_value);
+      AckErrorPolicyViolation.Increment();
+      return TAckResultAction::Discard;
+    }
+    case TKafkaErrorCode::OutOfOrderSequenceNumber: {
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+      MaybeLogError(lim.Test(), ack_value);
+      AckErrorOutOfOrderSequenceNumber.Increment();
+      return TAckResultAction::ResetProducerAndPause;
+    }
+    case TKafkaErrorCode::DuplicateSequenceNumber: {
+      /* The broker already has these messages from an earlier attempt, so
+         treat this as a successful ACK. */
+      AckDuplicateSequenceNumber.Increment();
+      break;
+    }
+    case TKafkaErrorCode::InvalidProducerEpoch: {
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+      MaybeLogError(lim.Test(), ack_value);
+      AckErrorInvalidProducerEpoch.Increment();
+      return TAckResultAction::ResetProducerAndPause;
+    }
+    case TKafkaErrorCode::KafkaStorageError: {
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+      MaybeLogError(lim.Test(), ack_value);
+      AckErrorKafkaStorageError.Increment();
+      return TAckResultAction::Pause;
+    }
+    case TKafkaErrorCode::UnknownProducerId: {
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+      MaybeLogError(lim.Test(), ack_value);
+      AckErrorUnknownProducerId.Increment();
+      return TAckResultAction::ResetProducerAndPause;
+    }
+    default: {
+      return V0Proto.ProcessAck(ack_value);
+    }
+  }
+
+  return TAckResultAction::Ok;
+}
+
+TProduceProtocol::TConstants TProduceProto::ComputeConstants() {
+  using PRC = TProduceRequestConstants;
+  TConstants constants;
+  constants.SingleMsgOverhead = PRC::BATCH_HEADER_SIZE +
+      PRC::MAX_RECORD_OVERHEAD;
+  constants.SupportsIdempotence = true;
+  return constants;
+}
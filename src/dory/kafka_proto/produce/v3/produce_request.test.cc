@@ -0,0 +1,334 @@
+/* <dory/kafka_proto/produce/v3/produce_request.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/kafka_proto/produce/v3/msg_set_writer.h> and
+   <dory/kafka_proto/produce/v3/produce_request_writer.h>.
+ */
+
+#include <dory/kafka_proto/produce/v3/msg_set_writer.h>
+#include <dory/kafka_proto/produce/v3/produce_request_writer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <base/crc.h>
+#include <base/field_access.h>
+#include <dory/compress/compression_type.h>
+#include <dory/kafka_proto/produce/v3/varint.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Compress;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::KafkaProto::Produce::V3;
+
+namespace {
+
+  /* The fixture for testing classes TMsgSetWriter and
+     TProduceRequestWriter. */
+  class TProduceRequestTest : public ::testing::Test {
+    protected:
+    TProduceRequestTest() {
+    }
+
+    virtual ~TProduceRequestTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TProduceRequestTest
+
+  struct TRecord {
+    int32_t OffsetDelta;
+
+    std::string Key;
+
+    std::string Value;
+
+    bool KeyIsNull;
+
+    bool ValueIsNull;
+  };  // TRecord
+
+  /* Decode one record starting at 'pos' and return a pointer to the byte
+     after it, or nullptr on error. */
+  const uint8_t *ReadRecord(const uint8_t *pos, const uint8_t *end,
+      TRecord &record) {
+    int32_t n = 0;
+    size_t len = ReadVarInt(pos, end, n);
+
+    if ((len == 0) || (n < 0) || ((pos + len + n) > end)) {
+      return nullptr;
+    }
+
+    pos += len;
+    const uint8_t *record_end = pos + n;
+
+    if ((record_end - pos) < 2) {
+      return nullptr;
+    }
+
+    if ((*pos++ != 0) || (*pos++ != 0)) {  // attributes, timestamp delta
+      return nullptr;
+    }
+
+    len = ReadVarInt(pos, record_end, record.OffsetDelta);
+
+    if (len == 0) {
+      return nullptr;
+    }
+
+    pos += len;
+    len = ReadVarInt(pos, record_end, n);
+
+    if ((len == 0) || ((pos + len + std::max(n, 0)) > record_end)) {
+      return nullptr;
+    }
+
+    pos += len;
+    record.KeyIsNull = (n < 0);
+    record.Key.assign(pos, pos + std::max(n, 0));
+    pos += std::max(n, 0);
+    len = ReadVarInt(pos, record_end, n);
+
+    if ((len == 0) || ((pos + len + std::max(n, 0)) > record_end)) {
+      return nullptr;
+    }
+
+    pos += len;
+    record.ValueIsNull = (n < 0);
+    record.Value.assign(pos, pos + std::max(n, 0));
+    pos += std::max(n, 0);
+
+    /* header count */
+    if (((pos + 1) != record_end) || (*pos != 0)) {
+      return nullptr;
+    }
+
+    return record_end;
+  }
+
+  TEST_F(TProduceRequestTest, EmptyRequest) {
+    std::vector<uint8_t> buf;
+    TProduceRequestWriter writer;
+    std::string client_id("client id");
+    writer.OpenRequest(buf, 1234567, client_id.data(),
+        client_id.data() + client_id.size(), -1, 100);
+    writer.CloseRequest();
+    ASSERT_EQ(buf.size(), 35U);
+    const uint8_t *pos = &buf[0];
+    ASSERT_EQ(ReadInt32FromHeader(pos), static_cast<int32_t>(buf.size() - 4));
+    ASSERT_EQ(ReadInt16FromHeader(pos + 4), 0);  // API key
+    ASSERT_EQ(ReadInt16FromHeader(pos + 6), 3);  // API version
+    ASSERT_EQ(ReadInt32FromHeader(pos + 8), 1234567);
+    ASSERT_EQ(ReadInt16FromHeader(pos + 12),
+        static_cast<int16_t>(client_id.size()));
+    ASSERT_EQ(std::string(pos + 14, pos + 14 + client_id.size()), client_id);
+    pos += 14 + client_id.size();
+    ASSERT_EQ(ReadInt16FromHeader(pos), -1);  // transactional ID
+    ASSERT_EQ(ReadInt16FromHeader(pos + 2), -1);  // required ACKs
+    ASSERT_EQ(ReadInt32FromHeader(pos + 4), 100);  // replication timeout
+    ASSERT_EQ(ReadInt32FromHeader(pos + 8), 0);  // topic count
+  }
+
+  TEST_F(TProduceRequestTest, UncompressedBatch) {
+    std::vector<uint8_t> buf;
+    TProduceRequestWriter writer;
+    std::string topic("Scooby Doo");
+    std::string key("key");
+    std::string value("Scooby dooby doo");
+    const uint8_t *k = reinterpret_cast<const uint8_t *>(key.data());
+    const uint8_t *v = reinterpret_cast<const uint8_t *>(value.data());
+    writer.OpenRequest(buf, 5, nullptr, nullptr, -1, 100);
+    writer.OpenTopic(topic.data(), topic.data() + topic.size());
+    writer.OpenMsgSet(7);
+    writer.SetMsgSetInfo(2, TProducerSequence(1000, 3, 42));
+    writer.AddMsg(TCompressionType::None, k, k + key.size(), v,
+        v + value.size());
+    writer.AddMsg(TCompressionType::None, nullptr, nullptr, nullptr,
+        nullptr);
+    writer.CloseMsgSet();
+    writer.CloseTopic();
+    writer.CloseRequest();
+
+    const uint8_t *pos = &buf[0];
+    const uint8_t *end = pos + buf.size();
+    ASSERT_EQ(ReadInt32FromHeader(pos), static_cast<int32_t>(buf.size() - 4));
+    pos += 14;  // size, API key, API version, corr ID, null client ID
+    pos += 2 + 2 + 4;  // transactional ID, ACKs, timeout
+    ASSERT_EQ(ReadInt32FromHeader(pos), 1);  // topic count
+    pos += 4;
+    ASSERT_EQ(ReadInt16FromHeader(pos), static_cast<int16_t>(topic.size()));
+    pos += 2 + topic.size();
+    ASSERT_EQ(ReadInt32FromHeader(pos), 1);  // partition count
+    pos += 4;
+    ASSERT_EQ(ReadInt32FromHeader(pos), 7);  // partition
+    pos += 4;
+    int32_t msg_set_size = ReadInt32FromHeader(pos);
+    pos += 4;
+    ASSERT_EQ(pos + msg_set_size, end);
+
+    using PRC = TProduceRequestConstants;
+    const uint8_t *batch = pos;
+    ASSERT_EQ(ReadInt64FromHeader(batch), 0);  // base offset
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::BATCH_LENGTH_OFFSET),
+        msg_set_size - 12);
+    ASSERT_EQ(ReadInt32FromHeader(batch + 12), -1);  // leader epoch
+    ASSERT_EQ(batch[PRC::MAGIC_BYTE_OFFSET], 2);
+    uint32_t crc = ComputeCrc32c(batch + PRC::ATTRIBUTES_OFFSET,
+        msg_set_size - PRC::ATTRIBUTES_OFFSET);
+    ASSERT_EQ(static_cast<uint32_t>(
+        ReadInt32FromHeader(batch + PRC::CRC_OFFSET)), crc);
+    ASSERT_EQ(ReadInt16FromHeader(batch + PRC::ATTRIBUTES_OFFSET), 0);
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::LAST_OFFSET_DELTA_OFFSET), 1);
+    ASSERT_EQ(ReadInt64FromHeader(batch + 27), -1);  // first timestamp
+    ASSERT_EQ(ReadInt64FromHeader(batch + 35), -1);  // max timestamp
+    ASSERT_EQ(ReadInt64FromHeader(batch + PRC::PRODUCER_ID_OFFSET), 1000);
+    ASSERT_EQ(ReadInt16FromHeader(batch + PRC::PRODUCER_ID_OFFSET + 8), 3);
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::PRODUCER_ID_OFFSET + 10), 42);
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::RECORD_COUNT_OFFSET), 2);
+
+    pos = batch + PRC::BATCH_HEADER_SIZE;
+    TRecord record;
+    pos = ReadRecord(pos, end, record);
+    ASSERT_TRUE(pos != nullptr);
+    ASSERT_EQ(record.OffsetDelta, 0);
+    ASSERT_FALSE(record.KeyIsNull);
+    ASSERT_EQ(record.Key, key);
+    ASSERT_FALSE(record.ValueIsNull);
+    ASSERT_EQ(record.Value, value);
+    pos = ReadRecord(pos, end, record);
+    ASSERT_TRUE(pos != nullptr);
+    ASSERT_EQ(record.OffsetDelta, 1);
+    ASSERT_TRUE(record.KeyIsNull);
+    ASSERT_TRUE(record.ValueIsNull);
+    ASSERT_EQ(pos, end);
+  }
+
+  TEST_F(TProduceRequestTest, CompressedBatch) {
+    std::vector<uint8_t> buf;
+    TProduceRequestWriter writer;
+    std::string topic("The Flintstones");
+    std::string payload("compressed records");
+    writer.OpenRequest(buf, 5, nullptr, nullptr, -1, 100);
+    writer.OpenTopic(topic.data(), topic.data() + topic.size());
+    writer.OpenMsgSet(3);
+    writer.SetMsgSetInfo(25, TProducerSequence());
+
+    /* Open, then roll back, to make sure rollback leaves the batch empty. */
+    writer.OpenMsg(TCompressionType::Gzip, 0, 100);
+    writer.RollbackOpenMsg();
+
+    writer.OpenMsg(TCompressionType::Lz4, 0, 100);
+    size_t offset = writer.GetCurrentMsgValueOffset();
+    ASSERT_EQ(buf.size(), offset + 100);
+    std::memcpy(&buf[offset], payload.data(), payload.size());
+    writer.AdjustValueSize(payload.size());
+    writer.CloseMsg();
+    writer.CloseMsgSet();
+    writer.CloseTopic();
+    writer.CloseRequest();
+
+    using PRC = TProduceRequestConstants;
+    const uint8_t *batch = &buf[0] + 14 + 8 + 4 + 2 + topic.size() + 4 + 8;
+    const uint8_t *end = &buf[0] + buf.size();
+    ASSERT_EQ(ReadInt32FromHeader(batch - 4),
+        static_cast<int32_t>(PRC::BATCH_HEADER_SIZE + payload.size()));
+    ASSERT_EQ(ReadInt16FromHeader(batch + PRC::ATTRIBUTES_OFFSET),
+        PRC::LZ4_COMPRESSION_ATTR);
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::LAST_OFFSET_DELTA_OFFSET), 24);
+    ASSERT_EQ(ReadInt64FromHeader(batch + PRC::PRODUCER_ID_OFFSET), -1);
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::PRODUCER_ID_OFFSET + 10), -1);
+    ASSERT_EQ(ReadInt32FromHeader(batch + PRC::RECORD_COUNT_OFFSET), 25);
+    uint32_t crc = ComputeCrc32c(batch + PRC::ATTRIBUTES_OFFSET,
+        end - batch - PRC::ATTRIBUTES_OFFSET);
+    ASSERT_EQ(static_cast<uint32_t>(
+        ReadInt32FromHeader(batch + PRC::CRC_OFFSET)), crc);
+    ASSERT_EQ(std::string(batch + PRC::BATCH_HEADER_SIZE, end), payload);
+  }
+
+  TEST_F(TProduceRequestTest, AdjustValueSize) {
+    std::vector<uint8_t> buf;
+    TMsgSetWriter writer;
+    std::string key("some key");
+    std::string value("value");
+    writer.OpenMsgSet(buf, false);
+
+    /* Grow the value enough to widen both length fields, then shrink it
+       back, checking that the key and the kept part of the value survive
+       each move. */
+    writer.OpenMsg(TCompressionType::None, key.size(), value.size());
+    std::memcpy(&buf[writer.GetCurrentMsgKeyOffset()], key.data(),
+        key.size());
+    std::memcpy(&buf[writer.GetCurrentMsgValueOffset()], value.data(),
+        value.size());
+    writer.AdjustValueSize(300);
+    ASSERT_EQ(buf.size(), writer.GetCurrentMsgValueOffset() + 300);
+    ASSERT_EQ(std::memcmp(&buf[writer.GetCurrentMsgKeyOffset()], key.data(),
+        key.size()), 0);
+    ASSERT_EQ(std::memcmp(&buf[writer.GetCurrentMsgValueOffset()],
+        value.data(), value.size()), 0);
+    writer.AdjustValueSize(3);
+    writer.CloseMsg();
+    size_t size = writer.CloseMsgSet();
+    ASSERT_EQ(size, buf.size());
+    ASSERT_EQ(writer.GetMsgCount(), 1U);
+
+    TRecord record;
+    const uint8_t *end = &buf[0] + buf.size();
+    ASSERT_EQ(ReadRecord(&buf[0], end, record), end);
+    ASSERT_EQ(record.Key, key);
+    ASSERT_EQ(record.Value, value.substr(0, 3));
+  }
+
+  TEST_F(TProduceRequestTest, VarInt) {
+    const int32_t values[] = {
+      0, -1, 1, 63, -64, 64, -65, 8191, 8192, 1000000, -1000000,
+      std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min()
+    };
+    uint8_t buf[5];
+
+    for (int32_t value : values) {
+      size_t size = WriteVarInt(buf, value);
+      ASSERT_EQ(size, VarIntSize(value));
+      int32_t result = 0;
+      ASSERT_EQ(ReadVarInt(buf, buf + size, result), size);
+      ASSERT_EQ(result, value);
+      ASSERT_EQ(ReadVarInt(buf, buf + size - 1, result), 0U);
+    }
+
+    ASSERT_EQ(VarIntSize(-1), 1U);
+    ASSERT_EQ(VarIntSize(63), 1U);
+    ASSERT_EQ(VarIntSize(64), 2U);
+    ASSERT_EQ(VarIntSize(std::numeric_limits<int32_t>::min()), 5U);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
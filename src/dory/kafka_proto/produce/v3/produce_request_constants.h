@@ -0,0 +1,165 @@
+/* <dory/kafka_proto/produce/v3/produce_request_constants.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Constants related to Kafka produce protocol version 3 requests.  Version 3
+   requests carry message sets in the record batch format (magic value 2).
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace Dory {
+
+  namespace KafkaProto {
+
+    namespace Produce {
+
+      namespace V3 {
+
+        class TProduceRequestConstants {
+          public:
+          enum { API_KEY_SIZE = 2 };
+
+          enum { API_VERSION_SIZE = 2 };
+
+          enum { CORRELATION_ID_SIZE = 4 };
+
+          enum { CLIENT_ID_LEN_SIZE = 2 };
+
+          enum { TRANSACTIONAL_ID_LEN_SIZE = 2 };
+
+          enum { REQUIRED_ACKS_SIZE = 2 };
+
+          enum { REPLICATION_TIMEOUT_SIZE = 4 };
+
+          enum { TOPIC_COUNT_SIZE = 4 };
+
+          enum { TOPIC_NAME_LEN_SIZE = 2 };
+
+          enum { PARTITION_COUNT_SIZE = 4 };
+
+          enum { PARTITION_SIZE = 4 };
+
+          enum { MSG_SET_SIZE_SIZE = 4 };
+
+          /* Fields of the record batch header, in wire order. */
+          enum { BASE_OFFSET_SIZE = 8 };
+
+          enum { BATCH_LENGTH_SIZE = 4 };
+
+          enum { PARTITION_LEADER_EPOCH_SIZE = 4 };
+
+          enum { MAGIC_BYTE_SIZE = 1 };
+
+          enum { CRC_SIZE = 4 };
+
+          enum { ATTRIBUTES_SIZE = 2 };
+
+          enum { LAST_OFFSET_DELTA_SIZE = 4 };
+
+          enum { FIRST_TIMESTAMP_SIZE = 8 };
+
+          enum { MAX_TIMESTAMP_SIZE = 8 };
+
+          enum { PRODUCER_ID_SIZE = 8 };
+
+          enum { PRODUCER_EPOCH_SIZE = 2 };
+
+          enum { BASE_SEQUENCE_SIZE = 4 };
+
+          enum { RECORD_COUNT_SIZE = 4 };
+
+          enum {
+            BATCH_LENGTH_OFFSET = BASE_OFFSET_SIZE
+          };
+
+          enum {
+            MAGIC_BYTE_OFFSET = BATCH_LENGTH_OFFSET + BATCH_LENGTH_SIZE +
+                PARTITION_LEADER_EPOCH_SIZE
+          };
+
+          enum {
+            CRC_OFFSET = MAGIC_BYTE_OFFSET + MAGIC_BYTE_SIZE
+          };
+
+          enum {
+            ATTRIBUTES_OFFSET = CRC_OFFSET + CRC_SIZE
+          };
+
+          enum {
+            LAST_OFFSET_DELTA_OFFSET = ATTRIBUTES_OFFSET + ATTRIBUTES_SIZE
+          };
+
+          enum {
+            PRODUCER_ID_OFFSET = LAST_OFFSET_DELTA_OFFSET +
+                LAST_OFFSET_DELTA_SIZE + FIRST_TIMESTAMP_SIZE +
+                MAX_TIMESTAMP_SIZE
+          };
+
+          enum {
+            RECORD_COUNT_OFFSET = PRODUCER_ID_OFFSET + PRODUCER_ID_SIZE +
+                PRODUCER_EPOCH_SIZE + BASE_SEQUENCE_SIZE
+          };
+
+          enum {
+            BATCH_HEADER_SIZE = RECORD_COUNT_OFFSET + RECORD_COUNT_SIZE
+          };
+
+          /* Each record inside a batch has a fixed size attributes field
+             followed by variable length fields.  A 32-bit varint occupies at
+             most 5 bytes.  Dory always writes a timestamp delta of 0 and no
+             record headers, so each of those fields occupies 1 byte. */
+          enum { RECORD_ATTRIBUTES_SIZE = 1 };
+
+          enum { TIMESTAMP_DELTA_SIZE = 1 };
+
+          enum { HEADER_COUNT_SIZE = 1 };
+
+          enum { MAX_VARINT_SIZE = 5 };
+
+          /* Upper bound on the size of a record minus its key and value:
+             length, attributes, timestamp delta, offset delta, key length,
+             value length, and header count. */
+          enum {
+            MAX_RECORD_OVERHEAD = (4 * MAX_VARINT_SIZE) +
+                RECORD_ATTRIBUTES_SIZE + TIMESTAMP_DELTA_SIZE +
+                HEADER_COUNT_SIZE
+          };
+
+          enum { MAGIC_BYTE = 2 };
+
+          /* Dory writes this value in the batch timestamp fields, since v0
+             message sets have no timestamps either. */
+          static const int64_t NO_TIMESTAMP = -1;
+
+          enum {
+            NO_COMPRESSION_ATTR = 0,
+            GZIP_COMPRESSION_ATTR = 1,
+            SNAPPY_COMPRESSION_ATTR = 2,
+            LZ4_COMPRESSION_ATTR = 3
+          };
+        };  // TProduceRequestConstants
+
+      }  // V3
+
+    }  // Produce
+
+  }  // KafkaProto
+
+}  // Dory
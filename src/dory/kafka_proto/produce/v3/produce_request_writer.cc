@@ -0,0 +1,373 @@
+/* <dory/kafka_proto/produce/v3/produce_request_writer.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/kafka_proto/produce/v3/produce_request_writer.h>.
+ */
+
+#include <dory/kafka_proto/produce/v3/produce_request_writer.h>
+
+#include <limits>
+
+#include <base/crc.h>
+#include <base/no_default_case.h>
+#include <dory/kafka_proto/request_response.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Compress;
+using namespace Dory::KafkaProto;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::KafkaProto::Produce::V3;
+
+TProduceRequestWriter::TProduceRequestWriter() {
+  Reset();
+}
+
+void TProduceRequestWriter::Reset() {
+  assert(this);
+  Buf = nullptr;
+  State = TState::Idle;
+  AtOffset = 0;
+  TopicCountOffset = 0;
+  CurrentTopicPartitionCountOffset = 0;
+  TopicCount = 0;
+  CurrentPartitionOffset = 0;
+  PartitionCount = 0;
+  CurrentBatchOffset = 0;
+  MsgSetMsgCount = 0;
+  MsgSetSeq = TProducerSequence();
+  CompressionAttr = PRC::NO_COMPRESSION_ATTR;
+  CompressedOffset = 0;
+  CompressedSize = 0;
+  GotCompressedMsg = false;
+  MsgSetWriter.Reset();
+}
+
+void TProduceRequestWriter::OpenRequest(std::vector<uint8_t> &result_buf,
+    int32_t corr_id, const char *client_id_begin, const char *client_id_end,
+    int16_t required_acks, int32_t replication_timeout) {
+  assert(this);
+
+  /* Make sure we start in a sane state. */
+  Reset();
+
+  assert(State == TState::Idle);
+  assert(&result_buf);
+  assert(client_id_begin || (!client_id_begin && !client_id_end));
+  assert(client_id_end >= client_id_begin);
+  size_t client_id_len = client_id_end - client_id_begin;
+  assert(client_id_len <= std::numeric_limits<int16_t>::max());
+  Buf = &result_buf;
+  assert(Buf);
+  Buf->resize(REQUEST_OR_RESPONSE_SIZE_SIZE + PRC::API_KEY_SIZE +
+      PRC::API_VERSION_SIZE + PRC::CORRELATION_ID_SIZE +
+      PRC::CLIENT_ID_LEN_SIZE + client_id_len +
+      PRC::TRANSACTIONAL_ID_LEN_SIZE + PRC::REQUIRED_ACKS_SIZE +
+      PRC::REPLICATION_TIMEOUT_SIZE + PRC::TOPIC_COUNT_SIZE);
+  AtOffset = REQUEST_OR_RESPONSE_SIZE_SIZE;  // skip produce request size field
+  WriteInt16AtOffset(0);  // API key
+  WriteInt16AtOffset(3);  // API version
+  WriteInt32AtOffset(corr_id);  // correlation ID
+
+  /* Here, -1 indicates a length of 0. */
+  WriteInt16AtOffset(client_id_len ? client_id_len : -1);  // client ID length
+
+  WriteDataAtOffset(client_id_begin, client_id_len);  // client ID
+  WriteInt16AtOffset(-1);  // null transactional ID
+  WriteInt16AtOffset(required_acks);  // required ACKs
+  WriteInt32AtOffset(replication_timeout);  // replication timeout
+  TopicCountOffset = AtOffset;
+  AtOffset += PRC::TOPIC_COUNT_SIZE;  // skip topic count field
+  State = TState::InRequest;
+}
+
+void TProduceRequestWriter::OpenTopic(const char *topic_name_begin,
+    const char *topic_name_end) {
+  assert(this);
+  assert(State == TState::InRequest);
+  assert(topic_name_begin);
+  assert(topic_name_end > topic_name_begin);
+  size_t topic_name_len = topic_name_end - topic_name_begin;
+  assert(Buf);
+  CurrentPartitionOffset = 0;
+  PartitionCount = 0;
+  Buf->resize(Buf->size() + PRC::TOPIC_NAME_LEN_SIZE + topic_name_len +
+      PRC::PARTITION_COUNT_SIZE);  // size of partition count field
+
+  /* Here, -1 indicates a length of 0. */
+  WriteInt16AtOffset(topic_name_len ? topic_name_len : -1);
+
+  WriteDataAtOffset(topic_name_begin, topic_name_len);
+  CurrentTopicPartitionCountOffset = AtOffset;
+  AtOffset += PRC::PARTITION_COUNT_SIZE;  // skip partition count field;
+  State = TState::InTopic;
+}
+
+void TProduceRequestWriter::OpenMsgSet(int32_t partition) {
+  assert(this);
+  assert(State == TState::InTopic);
+  assert(Buf);
+  Buf->resize(Buf->size() + PRC::PARTITION_SIZE + PRC::MSG_SET_SIZE_SIZE +
+      PRC::BATCH_HEADER_SIZE);
+  CurrentPartitionOffset = AtOffset;
+  WriteInt32AtOffset(partition);
+  AtOffset += PRC::MSG_SET_SIZE_SIZE;  // skip message set size field
+  CurrentBatchOffset = AtOffset;
+  AtOffset += PRC::BATCH_HEADER_SIZE;  // batch header is written last
+  MsgSetMsgCount = 0;
+  MsgSetSeq = TProducerSequence();
+  CompressionAttr = PRC::NO_COMPRESSION_ATTR;
+  CompressedOffset = 0;
+  CompressedSize = 0;
+  GotCompressedMsg = false;
+  MsgSetWriter.OpenMsgSet(*Buf, true);
+  State = TState::InMsgSet;
+}
+
+void TProduceRequestWriter::SetMsgSetInfo(size_t msg_count,
+    const TProducerSequence &seq) {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(MsgSetWriter.GetMsgCount() == 0);
+  assert(!GotCompressedMsg);
+  assert(msg_count <= std::numeric_limits<int32_t>::max());
+  MsgSetMsgCount = msg_count;
+  MsgSetSeq = seq;
+}
+
+static int16_t XlateCompressionType(TCompressionType compression_type) {
+  using PRC = TProduceRequestConstants;
+  auto attr = PRC::NO_COMPRESSION_ATTR;
+
+  switch (compression_type) {
+    case TCompressionType::None: {
+      break;
+    }
+    case TCompressionType::Gzip: {
+      attr = PRC::GZIP_COMPRESSION_ATTR;
+      break;
+    }
+    case TCompressionType::Snappy: {
+      attr = PRC::SNAPPY_COMPRESSION_ATTR;
+      break;
+    }
+    case TCompressionType::Lz4: {
+      attr = PRC::LZ4_COMPRESSION_ATTR;
+      break;
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return static_cast<int16_t>(attr);
+}
+
+void TProduceRequestWriter::OpenMsg(TCompressionType compression_type,
+    size_t key_size, size_t value_size) {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(Buf);
+  assert(key_size <= std::numeric_limits<int32_t>::max());
+  assert(value_size <= std::numeric_limits<int32_t>::max());
+  assert(!GotCompressedMsg);
+
+  if (compression_type == TCompressionType::None) {
+    MsgSetWriter.OpenMsg(compression_type, key_size, value_size);
+    return;
+  }
+
+  /* The value holds the compressed records of the entire batch, which
+     directly follow the batch header. */
+  assert(key_size == 0);
+  assert(MsgSetWriter.GetMsgCount() == 0);
+  assert(MsgSetMsgCount > 0);
+  assert(AtOffset == Buf->size());
+  CompressionAttr = XlateCompressionType(compression_type);
+  CompressedOffset = AtOffset;
+  CompressedSize = value_size;
+  Buf->resize(Buf->size() + value_size);
+  State = TState::InCompressedMsg;
+}
+
+size_t TProduceRequestWriter::GetCurrentMsgKeyOffset() const {
+  assert(this);
+  assert(Buf);
+
+  if (State == TState::InCompressedMsg) {
+    return CompressedOffset;
+  }
+
+  assert(State == TState::InMsgSet);
+  return MsgSetWriter.GetCurrentMsgKeyOffset();
+}
+
+size_t TProduceRequestWriter::GetCurrentMsgValueOffset() const {
+  assert(this);
+  assert(Buf);
+
+  if (State == TState::InCompressedMsg) {
+    return CompressedOffset;
+  }
+
+  assert(State == TState::InMsgSet);
+  return MsgSetWriter.GetCurrentMsgValueOffset();
+}
+
+void TProduceRequestWriter::AdjustValueSize(size_t new_size) {
+  assert(this);
+  assert(Buf);
+
+  if (State == TState::InCompressedMsg) {
+    Buf->resize(CompressedOffset + new_size);
+    CompressedSize = new_size;
+    return;
+  }
+
+  assert(State == TState::InMsgSet);
+  MsgSetWriter.AdjustValueSize(new_size);
+}
+
+void TProduceRequestWriter::RollbackOpenMsg() {
+  assert(this);
+  assert(Buf);
+
+  if (State == TState::InCompressedMsg) {
+    Buf->resize(CompressedOffset);
+    CompressionAttr = PRC::NO_COMPRESSION_ATTR;
+    CompressedOffset = 0;
+    CompressedSize = 0;
+    State = TState::InMsgSet;
+    return;
+  }
+
+  assert(State == TState::InMsgSet);
+  MsgSetWriter.RollbackOpenMsg();
+}
+
+void TProduceRequestWriter::CloseMsg() {
+  assert(this);
+  assert(Buf);
+
+  if (State == TState::InCompressedMsg) {
+    assert(Buf->size() == (CompressedOffset + CompressedSize));
+    AtOffset = Buf->size();
+    GotCompressedMsg = true;
+    State = TState::InMsgSet;
+    return;
+  }
+
+  assert(State == TState::InMsgSet);
+  MsgSetWriter.CloseMsg();
+}
+
+void TProduceRequestWriter::AddMsg(TCompressionType compression_type,
+    const uint8_t *key_begin, const uint8_t *key_end,
+    const uint8_t *value_begin, const uint8_t *value_end) {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(Buf);
+  assert(!GotCompressedMsg);
+  assert(compression_type == TCompressionType::None);
+  MsgSetWriter.AddMsg(compression_type, key_begin, key_end, value_begin,
+      value_end);
+}
+
+void TProduceRequestWriter::CloseMsgSet() {
+  assert(this);
+  assert(State == TState::InMsgSet);
+  assert(Buf);
+  size_t records_size = MsgSetWriter.CloseMsgSet();
+  size_t msg_count = MsgSetWriter.GetMsgCount();
+
+  if (GotCompressedMsg) {
+    assert(records_size == 0);
+    assert(msg_count == 0);
+    records_size = CompressedSize;
+    msg_count = MsgSetMsgCount;
+  }
+
+  assert(msg_count > 0);
+  assert((CurrentBatchOffset + PRC::BATCH_HEADER_SIZE + records_size) ==
+      Buf->size());
+  AtOffset = Buf->size();
+  WriteBatchHeader(records_size, msg_count);
+  size_t msg_set_size = PRC::BATCH_HEADER_SIZE + records_size;
+  assert(msg_set_size <= std::numeric_limits<int32_t>::max());
+  WriteInt32(CurrentPartitionOffset + PRC::PARTITION_SIZE, msg_set_size);
+  ++PartitionCount;
+  State = TState::InTopic;
+}
+
+void TProduceRequestWriter::CloseTopic() {
+  assert(this);
+  assert(State == TState::InTopic);
+  assert(Buf);
+  WriteInt32(CurrentTopicPartitionCountOffset, PartitionCount);
+  ++TopicCount;
+  State = TState::InRequest;
+}
+
+void TProduceRequestWriter::CloseRequest() {
+  assert(this);
+  assert(State == TState::InRequest);
+  assert(Buf);
+  WriteInt32(TopicCountOffset, TopicCount);
+  size_t total_request_size = Buf->size();
+  assert(total_request_size > REQUEST_OR_RESPONSE_SIZE_SIZE);
+
+  /* The request size field contains the size of the entire request minus the
+     size of the request size field itself. */
+  size_t request_size_field_value = total_request_size - 4;
+  assert(request_size_field_value <= std::numeric_limits<int32_t>::max());
+
+  WriteInt32(0, request_size_field_value);
+  Buf = nullptr;
+  State = TState::Idle;
+}
+
+void TProduceRequestWriter::WriteBatchHeader(size_t records_size,
+    size_t msg_count) {
+  assert(this);
+  assert(Buf);
+  assert(msg_count > 0);
+  size_t batch = CurrentBatchOffset;
+  size_t batch_size = PRC::BATCH_HEADER_SIZE + records_size;
+  WriteInt64(batch, 0);  // base offset
+  WriteInt32(batch + PRC::BATCH_LENGTH_OFFSET,
+      batch_size - PRC::BASE_OFFSET_SIZE - PRC::BATCH_LENGTH_SIZE);
+  WriteInt32(batch + PRC::BATCH_LENGTH_OFFSET + PRC::BATCH_LENGTH_SIZE,
+      -1);  // partition leader epoch
+  WriteInt8(batch + PRC::MAGIC_BYTE_OFFSET, PRC::MAGIC_BYTE);
+  WriteInt16(batch + PRC::ATTRIBUTES_OFFSET, CompressionAttr);
+  WriteInt32(batch + PRC::LAST_OFFSET_DELTA_OFFSET, msg_count - 1);
+  WriteInt64(batch + PRC::LAST_OFFSET_DELTA_OFFSET +
+      PRC::LAST_OFFSET_DELTA_SIZE, PRC::NO_TIMESTAMP);  // first timestamp
+  WriteInt64(batch + PRC::LAST_OFFSET_DELTA_OFFSET +
+      PRC::LAST_OFFSET_DELTA_SIZE + PRC::FIRST_TIMESTAMP_SIZE,
+      PRC::NO_TIMESTAMP);  // max timestamp
+  WriteInt64(batch + PRC::PRODUCER_ID_OFFSET, MsgSetSeq.ProducerId);
+  WriteInt16(batch + PRC::PRODUCER_ID_OFFSET + PRC::PRODUCER_ID_SIZE,
+      MsgSetSeq.ProducerEpoch);
+  WriteInt32(batch + PRC::PRODUCER_ID_OFFSET + PRC::PRODUCER_ID_SIZE +
+      PRC::PRODUCER_EPOCH_SIZE, MsgSetSeq.BaseSequence);
+  WriteInt32(batch + PRC::RECORD_COUNT_OFFSET, msg_count);
+
+  /* The CRC covers everything from the attributes to the end of the batch. */
+  uint32_t crc = ComputeCrc32c(&(*Buf)[batch + PRC::ATTRIBUTES_OFFSET],
+      batch_size - PRC::ATTRIBUTES_OFFSET);
+  WriteInt32(batch + PRC::CRC_OFFSET, static_cast<int32_t>(crc));
+}
@@ -0,0 +1,163 @@
+/* <dory/kafka_proto/produce/v3/produce_response.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/kafka_proto/produce/v3/produce_response_reader.h>.
+ */
+
+#include <dory/kafka_proto/produce/v3/produce_response_reader.h>
+
+#include <string>
+#include <vector>
+
+#include <base/field_access.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::KafkaProto::Produce::V3;
+
+namespace {
+
+  /* The fixture for testing class TProduceResponseReader. */
+  class TProduceResponseTest : public ::testing::Test {
+    protected:
+    TProduceResponseTest() {
+    }
+
+    virtual ~TProduceResponseTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TProduceResponseTest
+
+  void AppendInt16(std::vector<uint8_t> &buf, int16_t value) {
+    buf.resize(buf.size() + 2);
+    WriteInt16ToHeader(&buf[buf.size() - 2], value);
+  }
+
+  void AppendInt32(std::vector<uint8_t> &buf, int32_t value) {
+    buf.resize(buf.size() + 4);
+    WriteInt32ToHeader(&buf[buf.size() - 4], value);
+  }
+
+  void AppendInt64(std::vector<uint8_t> &buf, int64_t value) {
+    buf.resize(buf.size() + 8);
+    WriteInt64ToHeader(&buf[buf.size() - 8], value);
+  }
+
+  void AppendTopic(std::vector<uint8_t> &buf, const std::string &topic) {
+    AppendInt16(buf, static_cast<int16_t>(topic.size()));
+    buf.insert(buf.end(), topic.begin(), topic.end());
+  }
+
+  TEST_F(TProduceResponseTest, EmptyResponse) {
+    std::vector<uint8_t> buf;
+    AppendInt32(buf, 0);  // size (filled in below)
+    AppendInt32(buf, 1234567);  // correlation ID
+    AppendInt32(buf, 0);  // topic count
+    AppendInt32(buf, 0);  // throttle time
+    WriteInt32ToHeader(&buf[0], static_cast<int32_t>(buf.size() - 4));
+    TProduceResponseReader reader;
+    reader.SetResponse(&buf[0], buf.size());
+    ASSERT_EQ(reader.GetCorrelationId(), 1234567);
+    ASSERT_EQ(reader.GetNumTopics(), 0U);
+    ASSERT_FALSE(reader.FirstTopic());
+  }
+
+  TEST_F(TProduceResponseTest, TwoTopics) {
+    std::vector<uint8_t> buf;
+    AppendInt32(buf, 0);  // size (filled in below)
+    AppendInt32(buf, 42);  // correlation ID
+    AppendInt32(buf, 2);  // topic count
+    AppendTopic(buf, "The Jetsons");
+    AppendInt32(buf, 2);  // partition count
+
+    for (int32_t i = 0; i < 2; ++i) {
+      AppendInt32(buf, 10 + i);  // partition
+      AppendInt16(buf, (i == 0) ? 0 : 46);  // error code
+      AppendInt64(buf, 1000 + i);  // base offset
+      AppendInt64(buf, -1);  // log append time
+    }
+
+    AppendTopic(buf, "The Flintstones");
+    AppendInt32(buf, 1);  // partition count
+    AppendInt32(buf, 3);  // partition
+    AppendInt16(buf, 45);  // error code
+    AppendInt64(buf, -1);  // base offset
+    AppendInt64(buf, -1);  // log append time
+    AppendInt32(buf, 0);  // throttle time
+    WriteInt32ToHeader(&buf[0], static_cast<int32_t>(buf.size() - 4));
+
+    TProduceResponseReader reader;
+    reader.SetResponse(&buf[0], buf.size());
+    ASSERT_EQ(reader.GetCorrelationId(), 42);
+    ASSERT_EQ(reader.GetNumTopics(), 2U);
+    ASSERT_TRUE(reader.FirstTopic());
+    ASSERT_EQ(std::string(reader.GetCurrentTopicNameBegin(),
+        reader.GetCurrentTopicNameEnd()), "The Jetsons");
+    ASSERT_EQ(reader.GetNumPartitionsInCurrentTopic(), 2U);
+    ASSERT_TRUE(reader.FirstPartitionInTopic());
+    ASSERT_EQ(reader.GetCurrentPartitionNumber(), 10);
+    ASSERT_EQ(reader.GetCurrentPartitionErrorCode(), 0);
+    ASSERT_EQ(reader.GetCurrentPartitionOffset(), 1000);
+    ASSERT_TRUE(reader.NextPartitionInTopic());
+    ASSERT_EQ(reader.GetCurrentPartitionNumber(), 11);
+    ASSERT_EQ(reader.GetCurrentPartitionErrorCode(), 46);
+    ASSERT_EQ(reader.GetCurrentPartitionOffset(), 1001);
+    ASSERT_FALSE(reader.NextPartitionInTopic());
+    ASSERT_TRUE(reader.NextTopic());
+    ASSERT_EQ(std::string(reader.GetCurrentTopicNameBegin(),
+        reader.GetCurrentTopicNameEnd()), "The Flintstones");
+    ASSERT_TRUE(reader.FirstPartitionInTopic());
+    ASSERT_EQ(reader.GetCurrentPartitionNumber(), 3);
+    ASSERT_EQ(reader.GetCurrentPartitionErrorCode(), 45);
+    ASSERT_FALSE(reader.NextPartitionInTopic());
+    ASSERT_FALSE(reader.NextTopic());
+  }
+
+  TEST_F(TProduceResponseTest, Truncated) {
+    std::vector<uint8_t> buf;
+    AppendInt32(buf, 0);  // size (filled in below)
+    AppendInt32(buf, 42);  // correlation ID
+    AppendInt32(buf, 1);  // topic count
+    AppendTopic(buf, "The Jetsons");
+    AppendInt32(buf, 1);  // partition count
+    AppendInt32(buf, 10);  // partition
+    AppendInt16(buf, 0);  // error code
+    AppendInt64(buf, 1000);  // base offset
+
+    /* The log append time field is missing. */
+    WriteInt32ToHeader(&buf[0], static_cast<int32_t>(buf.size() - 4));
+    TProduceResponseReader reader;
+    reader.SetResponse(&buf[0], buf.size());
+    ASSERT_TRUE(reader.FirstTopic());
+    ASSERT_THROW(reader.FirstPartitionInTopic(),
+        TProduceResponseReader::TResponseTruncated);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
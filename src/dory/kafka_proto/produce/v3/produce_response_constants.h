@@ -0,0 +1,65 @@
+/* <dory/kafka_proto/produce/v3/produce_response_constants.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Constants related to Kafka produce protocol version 3 responses.
+ */
+
+#pragma once
+
+namespace Dory {
+
+  namespace KafkaProto {
+
+    namespace Produce {
+
+      namespace V3 {
+
+        class TProduceResponseConstants {
+          public:
+          enum { CORRELATION_ID_SIZE = 4 };
+
+          enum { TOPIC_COUNT_SIZE = 4 };
+
+          enum { TOPIC_NAME_LEN_SIZE = 2 };
+
+          enum { PARTITION_COUNT_SIZE = 4 };
+
+          enum { PARTITION_SIZE = 4 };
+
+          enum { ERROR_CODE_SIZE = 2 };
+
+          enum { OFFSET_SIZE = 8 };
+
+          enum { LOG_APPEND_TIME_SIZE = 8 };
+
+          enum {
+            PARTITION_RESPONSE_SIZE = PARTITION_SIZE + ERROR_CODE_SIZE +
+                OFFSET_SIZE + LOG_APPEND_TIME_SIZE
+          };
+
+          /* The throttle time follows the topics.  Dory doesn't use it. */
+          enum { THROTTLE_TIME_SIZE = 4 };
+        };  // TProduceResponseConstants
+
+      }  // V3
+
+    }  // Produce
+
+  }  // KafkaProto
+
+}  // Dory
@@ -0,0 +1,100 @@
+/* <dory/kafka_proto/produce/v3/varint.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Zigzag varint encoding used by the variable length fields of records in
+   Kafka's record batch format.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace Dory {
+
+  namespace KafkaProto {
+
+    namespace Produce {
+
+      namespace V3 {
+
+        inline uint32_t ZigZagEncode(int32_t value) {
+          return (static_cast<uint32_t>(value) << 1) ^
+              ((value < 0) ? 0xffffffffU : 0U);
+        }
+
+        inline int32_t ZigZagDecode(uint32_t value) {
+          return static_cast<int32_t>((value >> 1) ^ (0U - (value & 1U)));
+        }
+
+        /* Return the number of bytes needed to encode 'value'. */
+        inline size_t VarIntSize(int32_t value) {
+          uint32_t n = ZigZagEncode(value);
+          size_t size = 1;
+
+          for (; n >= 0x80U; n >>= 7) {
+            ++size;
+          }
+
+          return size;
+        }
+
+        /* Encode 'value' at 'dst' and return the number of bytes written,
+           which is VarIntSize(value). */
+        inline size_t WriteVarInt(uint8_t *dst, int32_t value) {
+          assert(dst);
+          uint32_t n = ZigZagEncode(value);
+          size_t size = 0;
+
+          for (; n >= 0x80U; n >>= 7) {
+            dst[size++] = static_cast<uint8_t>(n | 0x80U);
+          }
+
+          dst[size++] = static_cast<uint8_t>(n);
+          return size;
+        }
+
+        /* Decode a value starting at 'begin' into 'result' and return the
+           number of bytes consumed.  Return 0 if the encoding is truncated
+           at 'end' or is too long for a 32-bit value. */
+        inline size_t ReadVarInt(const uint8_t *begin, const uint8_t *end,
+            int32_t &result) {
+          assert(begin || (begin == end));
+          assert(end >= begin);
+          uint32_t n = 0;
+
+          for (size_t i = 0; (i < 5) && ((begin + i) < end); ++i) {
+            n |= static_cast<uint32_t>(begin[i] & 0x7fU) << (7 * i);
+
+            if ((begin[i] & 0x80U) == 0) {
+              result = ZigZagDecode(n);
+              return i + 1;
+            }
+          }
+
+          return 0;
+        }
+
+      }  // V3
+
+    }  // Produce
+
+  }  // KafkaProto
+
+}  // Dory
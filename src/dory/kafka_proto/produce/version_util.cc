@@ -25,6 +25,7 @@
 #include <algorithm>
 
 #include <dory/kafka_proto/produce/v0/produce_proto.h>
+#include <dory/kafka_proto/produce/v3/produce_proto.h>
 
 using namespace Dory;
 using namespace Dory::KafkaProto;
@@ -36,12 +37,16 @@ TProduceProtocol *Dory::KafkaProto::Produce::ChooseProduceProto(
     return new Dory::KafkaProto::Produce::V0::TProduceProto;
   }
 
+  if (api_version == 3) {
+    return new Dory::KafkaProto::Produce::V3::TProduceProto;
+  }
+
   return nullptr;  // unsupported API version
 }
 
 const std::vector<size_t> &
 Dory::KafkaProto::Produce::GetSupportedProduceApiVersions() {
-  static const std::vector<size_t> supported_versions = { 0 };
+  static const std::vector<size_t> supported_versions = { 0, 3 };
   return supported_versions;
 }
 
@@ -22,6 +22,7 @@
 #include <dory/metadata_fetcher.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <stdexcept>
 
@@ -31,6 +32,9 @@
 #include <base/io_utils.h>
 #include <base/no_default_case.h>
 #include <base/time_util.h>
+#include <dory/kafka_proto/init_producer_id/v0/init_producer_id_request_writer.h>
+#include <dory/kafka_proto/init_producer_id/v0/init_producer_id_response_reader.h>
+#include <dory/kafka_proto/kafka_error_code.h>
 #include <dory/kafka_proto/request_response.h>
 #include <dory/util/connect_to_host.h>
 #include <dory/util/poll_array.h>
@@ -41,13 +45,23 @@
 using namespace Base;
 using namespace Dory;
 using namespace Dory::KafkaProto;
+using namespace Dory::KafkaProto::InitProducerId::V0;
 using namespace Dory::KafkaProto::Metadata;
 using namespace Dory::Util;
 
+SERVER_COUNTER(BadInitProducerIdResponse);
 SERVER_COUNTER(BadMetadataResponse);
 SERVER_COUNTER(BadMetadataResponseSize);
+SERVER_COUNTER(FetchAllTopicsMetadata);
+SERVER_COUNTER(FetchPartialMetadata);
+SERVER_COUNTER(FetchPartialMetadataTopics);
+SERVER_COUNTER(InitProducerIdError);
+SERVER_COUNTER(InitProducerIdSuccess);
 SERVER_COUNTER(MetadataHasEmptyBrokerList);
 SERVER_COUNTER(MetadataHasEmptyTopicList);
+SERVER_COUNTER(MetadataParseMicroseconds);
+SERVER_COUNTER(MetadataRequestBytes);
+SERVER_COUNTER(MetadataResponseBytes);
 SERVER_COUNTER(MetadataResponseReadLostTcpConnection);
 SERVER_COUNTER(MetadataResponseReadSuccess);
 SERVER_COUNTER(MetadataResponseReadTimeout);
@@ -103,14 +117,33 @@ bool TMetadataFetcher::Connect(const char *host_name, in_port_t port) {
 
 std::unique_ptr<TMetadata> TMetadataFetcher::Fetch(int timeout_ms) {
   assert(this);
+  FetchAllTopicsMetadata.Increment();
+  return DoFetch(MetadataRequest, timeout_ms);
+}
+
+std::unique_ptr<TMetadata> TMetadataFetcher::FetchTopics(
+    const std::vector<std::string> &topics, int timeout_ms) {
+  assert(this);
+  assert(!topics.empty());
+  FetchPartialMetadata.Increment();
+  FetchPartialMetadataTopics.Increment(topics.size());
+  std::vector<uint8_t> request;
+  MetadataProtocol->WriteMultiTopicMetadataRequest(request, topics, 0);
+  return DoFetch(request, timeout_ms);
+}
+
+std::unique_ptr<TMetadata> TMetadataFetcher::DoFetch(
+    const std::vector<uint8_t> &request, int timeout_ms) {
+  assert(this);
 
   if (!Sock.IsOpen()) {
     throw std::logic_error("Must connect to host before getting metadata");
   }
 
   std::unique_ptr<TMetadata> result;
+  MetadataRequestBytes.Increment(request.size());
 
-  if (!SendRequest(MetadataRequest, timeout_ms) || !ReadResponse(timeout_ms)) {
+  if (!SendRequest(request, timeout_ms) || !ReadResponse(timeout_ms)) {
     return std::move(result);
   }
 
@@ -124,9 +157,11 @@ std::unique_ptr<TMetadata> TMetadataFetcher::Fetch(int timeout_ms) {
     return std::move(result);
   }
 
+  MetadataResponseBytes.Increment(response_size);
   const uint8_t *response_begin = StreamReader.GetReadyMsg();
   response.assign(response_begin, response_begin + response_size);
   StreamReader.ConsumeReadyMsg();
+  auto parse_start = std::chrono::steady_clock::now();
 
   try {
     result.reset(MetadataProtocol->BuildMetadataFromResponse(&response[0],
@@ -137,6 +172,10 @@ std::unique_ptr<TMetadata> TMetadataFetcher::Fetch(int timeout_ms) {
     return std::move(result);
   }
 
+  MetadataParseMicroseconds.Increment(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - parse_start).count());
+
   bool bad_metadata = false;
 
   if (result->GetBrokers().empty()) {
@@ -206,6 +245,55 @@ TMetadataFetcher::TopicAutocreate(const char *topic, int timeout_ms) {
                    TTopicAutocreateResult::Fail;
 }
 
+bool TMetadataFetcher::InitProducerId(int64_t &producer_id,
+    int16_t &producer_epoch, int timeout_ms) {
+  assert(this);
+
+  if (!Sock.IsOpen()) {
+    throw std::logic_error("Must connect to host before getting producer ID");
+  }
+
+  /* The broker ignores the transaction timeout, since we have no
+     transactional ID. */
+  std::vector<uint8_t> request;
+  TInitProducerIdRequestWriter().WriteRequest(request, 0, 60000);
+
+  if (!SendRequest(request, timeout_ms) || !ReadResponse(timeout_ms)) {
+    return false;
+  }
+
+  assert(StreamReader.GetState() == TStreamMsgReader::TState::MsgReady);
+  size_t response_size = StreamReader.GetReadyMsgSize();
+  const uint8_t *response_begin = StreamReader.GetReadyMsg();
+  std::vector<uint8_t> response(response_begin,
+      response_begin + response_size);
+  StreamReader.ConsumeReadyMsg();
+
+  try {
+    TInitProducerIdResponseReader reader(response.data(), response.size());
+
+    if (reader.GetErrorCode() != TKafkaErrorCode::None) {
+      InitProducerIdError.Increment();
+      const auto &error_info = LookupKafkaErrorCode(reader.GetErrorCode());
+      syslog(LOG_ERR, "InitProducerId request returned error %d (%s): %s",
+          static_cast<int>(reader.GetErrorCode()), error_info.ErrorName,
+          error_info.ErrorDescription);
+      return false;
+    }
+
+    producer_id = reader.GetProducerId();
+    producer_epoch = reader.GetProducerEpoch();
+  } catch (const TInitProducerIdResponseReader::TBadInitProducerIdResponse
+      &x) {
+    BadInitProducerIdResponse.Increment();
+    syslog(LOG_ERR, "Failed to parse InitProducerId response: %s", x.what());
+    return false;
+  }
+
+  InitProducerIdSuccess.Increment();
+  return true;
+}
+
 bool TMetadataFetcher::SendRequest(const std::vector<uint8_t> &request,
     int timeout_ms) {
   assert(this);
@@ -79,6 +79,14 @@ namespace Dory {
        milliseconds.  A negative timeout value means "infinite timeout". */
     std::unique_ptr<TMetadata> Fetch(int timeout_ms = -1);
 
+    /* Same as Fetch(), but only request metadata for the topics in 'topics',
+       which must not be empty.  The returned metadata contains all brokers,
+       but only those topics that exist.  The broker may include extra topics.
+       Note that brokers configured with auto.create.topics.enable=true will
+       create any requested topic that doesn't exist. */
+    std::unique_ptr<TMetadata> FetchTopics(
+        const std::vector<std::string> &topics, int timeout_ms = -1);
+
     enum class TTopicAutocreateResult {
       /* Topic was successfully created. */
       Success,
@@ -97,7 +105,16 @@ namespace Dory {
        wish to create. */
     TTopicAutocreateResult TopicAutocreate(const char *topic, int timeout_ms);
 
+    /* Ask the broker for a producer ID for idempotent produce requests.  On
+       success, return true and fill in 'producer_id' and 'producer_epoch'.
+       Return false on failure. */
+    bool InitProducerId(int64_t &producer_id, int16_t &producer_epoch,
+        int timeout_ms);
+
     private:
+    std::unique_ptr<TMetadata> DoFetch(const std::vector<uint8_t> &request,
+        int timeout_ms);
+
     bool SendRequest(const std::vector<uint8_t> &request, int timeout_ms);
 
     bool ReadResponse(int timeout_ms);
@@ -0,0 +1,288 @@
+/* <dory/metadata_snapshot.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/metadata_snapshot.h>.
+ */
+
+#include <dory/metadata_snapshot.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <base/crc.h>
+#include <base/error_utils.h>
+#include <base/fd.h>
+#include <base/io_utils.h>
+
+using namespace Base;
+using namespace Dory;
+
+/* "DMS1" in ASCII. */
+static const uint32_t SNAPSHOT_MAGIC = 0x444d5331;
+
+/* Size of the magic number, CRC, and payload size fields preceding the
+   payload. */
+static const size_t SNAPSHOT_HEADER_SIZE = 12;
+
+/* Larger snapshots are treated as corruption when reading. */
+static const size_t MAX_SNAPSHOT_SIZE = 256 * 1024 * 1024;
+
+template <typename T>
+static inline void Put(std::vector<uint8_t> &dst, T value) {
+  size_t offset = dst.size();
+  dst.resize(offset + sizeof(value));
+  std::memcpy(&dst[offset], &value, sizeof(value));
+}
+
+static void PutString(std::vector<uint8_t> &dst, const std::string &s) {
+  assert(s.size() <= std::numeric_limits<uint16_t>::max());
+  Put(dst, static_cast<uint16_t>(s.size()));
+  dst.insert(dst.end(), s.begin(), s.end());
+}
+
+/* Reads fields from a payload, keeping track of whether it has gone past the
+   end. */
+class TPayloadReader final {
+  public:
+  TPayloadReader(const uint8_t *begin, const uint8_t *end)
+      : Pos(begin),
+        End(end),
+        Ok(true) {
+  }
+
+  template <typename T>
+  T Get() {
+    assert(this);
+    T value = 0;
+
+    if (Ok && (static_cast<size_t>(End - Pos) >= sizeof(value))) {
+      std::memcpy(&value, Pos, sizeof(value));
+      Pos += sizeof(value);
+    } else {
+      Ok = false;
+    }
+
+    return value;
+  }
+
+  std::string GetString() {
+    assert(this);
+    size_t size = Get<uint16_t>();
+
+    if (!Ok || (static_cast<size_t>(End - Pos) < size)) {
+      Ok = false;
+      return std::string();
+    }
+
+    std::string result(reinterpret_cast<const char *>(Pos), size);
+    Pos += size;
+    return result;
+  }
+
+  bool IsOk() const {
+    assert(this);
+    return Ok;
+  }
+
+  bool AtEnd() const {
+    assert(this);
+    return (Pos == End);
+  }
+
+  private:
+  const uint8_t *Pos;
+
+  const uint8_t *End;
+
+  bool Ok;
+};  // TPayloadReader
+
+void Dory::EncodeMetadataSnapshot(const TMetadata &md,
+    std::vector<uint8_t> &dst) {
+  dst.clear();
+  dst.resize(SNAPSHOT_HEADER_SIZE);
+  const std::vector<TMetadata::TBroker> &brokers = md.GetBrokers();
+  Put(dst, static_cast<uint32_t>(brokers.size()));
+
+  for (const TMetadata::TBroker &broker : brokers) {
+    Put(dst, broker.GetId());
+    Put(dst, broker.GetPort());
+    PutString(dst, broker.GetHostname());
+  }
+
+  const std::vector<TMetadata::TTopic> &topics = md.GetTopics();
+  Put(dst, static_cast<uint32_t>(topics.size()));
+
+  for (const auto &item : md.GetTopicNameMap()) {
+    assert(item.second < topics.size());
+    const TMetadata::TTopic &topic = topics[item.second];
+    PutString(dst, item.first);
+    Put(dst, static_cast<uint32_t>(topic.GetAllPartitions().size()));
+    std::unordered_set<int32_t> ok_ids;
+
+    for (const TMetadata::TPartition &p : topic.GetOkPartitions()) {
+      ok_ids.insert(p.GetId());
+    }
+
+    for (const TMetadata::TPartition &p : topic.GetAllPartitions()) {
+      assert(p.GetBrokerIndex() < brokers.size());
+      Put(dst, p.GetId());
+      Put(dst, brokers[p.GetBrokerIndex()].GetId());
+      Put(dst, p.GetErrorCode());
+      Put(dst, static_cast<uint8_t>(ok_ids.count(p.GetId()) ? 1 : 0));
+    }
+  }
+
+  size_t payload_size = dst.size() - SNAPSHOT_HEADER_SIZE;
+  uint32_t crc = ComputeCrc32(&dst[SNAPSHOT_HEADER_SIZE], payload_size);
+  uint32_t size_field = static_cast<uint32_t>(payload_size);
+  std::memcpy(&dst[0], &SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  std::memcpy(&dst[4], &crc, sizeof(crc));
+  std::memcpy(&dst[8], &size_field, sizeof(size_field));
+}
+
+std::unique_ptr<TMetadata> Dory::DecodeMetadataSnapshot(const uint8_t *data,
+    size_t size) {
+  assert(data || (size == 0));
+  std::unique_ptr<TMetadata> result;
+
+  if (size < SNAPSHOT_HEADER_SIZE) {
+    return result;
+  }
+
+  uint32_t magic = 0;
+  uint32_t crc = 0;
+  uint32_t payload_size = 0;
+  std::memcpy(&magic, data, sizeof(magic));
+  std::memcpy(&crc, data + 4, sizeof(crc));
+  std::memcpy(&payload_size, data + 8, sizeof(payload_size));
+  const uint8_t *payload = data + SNAPSHOT_HEADER_SIZE;
+
+  if ((magic != SNAPSHOT_MAGIC) ||
+      (payload_size != (size - SNAPSHOT_HEADER_SIZE)) ||
+      (ComputeCrc32(payload, payload_size) != crc)) {
+    return result;
+  }
+
+  TPayloadReader reader(payload, payload + payload_size);
+  TMetadata::TBuilder builder;
+  builder.OpenBrokerList();
+
+  for (size_t i = 0, n = reader.Get<uint32_t>(); reader.IsOk() && (i < n);
+       ++i) {
+    int32_t id = reader.Get<int32_t>();
+    uint16_t port = reader.Get<uint16_t>();
+    std::string hostname = reader.GetString();
+
+    if (reader.IsOk()) {
+      builder.AddBroker(id, std::move(hostname), port);
+    }
+  }
+
+  builder.CloseBrokerList();
+
+  for (size_t i = 0, n = reader.Get<uint32_t>(); reader.IsOk() && (i < n);
+       ++i) {
+    std::string name = reader.GetString();
+
+    if (!reader.IsOk() || !builder.OpenTopic(name)) {
+      return result;
+    }
+
+    for (size_t j = 0, m = reader.Get<uint32_t>(); reader.IsOk() && (j < m);
+         ++j) {
+      int32_t partition_id = reader.Get<int32_t>();
+      int32_t broker_id = reader.Get<int32_t>();
+      int16_t error_code = reader.Get<int16_t>();
+      uint8_t ok = reader.Get<uint8_t>();
+
+      if (reader.IsOk()) {
+        builder.AddPartitionToTopic(partition_id, broker_id, ok != 0,
+            error_code);
+      }
+    }
+
+    builder.CloseTopic();
+  }
+
+  if (!reader.IsOk() || !reader.AtEnd()) {
+    return result;
+  }
+
+  result.reset(builder.Build());
+
+  if (!result->SanityCheck()) {
+    result.reset();
+  }
+
+  return result;
+}
+
+void Dory::WriteMetadataSnapshot(const TMetadata &md,
+    const std::string &path) {
+  std::vector<uint8_t> buf;
+  EncodeMetadataSnapshot(md, buf);
+  std::string tmp_path = path + ".tmp";
+
+  {
+    TFd fd(IfLt0(open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+        0644)));
+    WriteExactly(fd, &buf[0], buf.size());
+    IfLt0(fsync(fd));
+  }
+
+  IfLt0(rename(tmp_path.c_str(), path.c_str()));
+}
+
+std::unique_ptr<TMetadata> Dory::ReadMetadataSnapshot(
+    const std::string &path) {
+  std::unique_ptr<TMetadata> result;
+  int raw_fd = open(path.c_str(), O_RDONLY);
+
+  if ((raw_fd < 0) && (errno == ENOENT)) {
+    return result;
+  }
+
+  TFd fd(IfLt0(raw_fd));
+
+  struct stat st;
+  IfLt0(fstat(fd, &st));
+
+  if ((st.st_size < static_cast<off_t>(SNAPSHOT_HEADER_SIZE)) ||
+      (st.st_size > static_cast<off_t>(MAX_SNAPSHOT_SIZE))) {
+    return result;
+  }
+
+  std::vector<uint8_t> buf(static_cast<size_t>(st.st_size));
+
+  if (!TryReadExactly(fd, &buf[0], buf.size())) {
+    return result;
+  }
+
+  return DecodeMetadataSnapshot(&buf[0], buf.size());
+}
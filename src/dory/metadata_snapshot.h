@@ -0,0 +1,82 @@
+/* <dory/metadata_snapshot.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   On-disk snapshot of the last good metadata, so dory can start routing
+   before the first metadata response arrives.
+
+   A snapshot consists of a 12 byte header followed by a payload:
+
+     uint32 magic number
+     uint32 CRC32 of payload
+     uint32 payload size
+
+   The payload contains:
+
+     uint32 broker count
+     for each broker:
+       int32  Kafka broker ID
+       uint16 port
+       uint16 hostname size
+       hostname bytes
+     uint32 topic count
+     for each topic:
+       uint16 name size
+       name bytes
+       uint32 partition count
+       for each partition:
+         int32  Kafka partition ID
+         int32  Kafka broker ID
+         int16  error code
+         uint8  1 if messages can be sent to the partition, else 0
+
+   Snapshots are only read back by dory on the host that wrote them, so
+   integers are stored in host byte order.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dory/metadata.h>
+
+namespace Dory {
+
+  /* Assign to 'dst' a snapshot of 'md'. */
+  void EncodeMetadataSnapshot(const TMetadata &md, std::vector<uint8_t> &dst);
+
+  /* Decode the 'size' byte snapshot at 'data'.  Returns nullptr if the
+     snapshot is malformed. */
+  std::unique_ptr<TMetadata> DecodeMetadataSnapshot(const uint8_t *data,
+      size_t size);
+
+  /* Write a snapshot of 'md' to 'path', replacing any previous snapshot.  The
+     snapshot is written to a temporary file and then renamed, so a crash
+     never leaves a partially written snapshot at 'path'.  Throws
+     std::system_error on failure. */
+  void WriteMetadataSnapshot(const TMetadata &md, const std::string &path);
+
+  /* Return the metadata from the snapshot at 'path', or nullptr if there is
+     no snapshot or it is malformed.  Throws std::system_error on failure to
+     read an existing snapshot. */
+  std::unique_ptr<TMetadata> ReadMetadataSnapshot(const std::string &path);
+
+}  // Dory
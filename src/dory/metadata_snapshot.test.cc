@@ -0,0 +1,140 @@
+/* <dory/metadata_snapshot.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/metadata_snapshot.h>
+ */
+
+#include <dory/metadata_snapshot.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/fd.h>
+#include <base/io_utils.h>
+#include <base/tmp_file_name.h>
+#include <dory/metadata.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+
+namespace {
+
+  /* The fixture for testing metadata snapshots. */
+  class TMetadataSnapshotTest : public ::testing::Test {
+    protected:
+    TMetadataSnapshotTest() {
+    }
+
+    virtual ~TMetadataSnapshotTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TMetadataSnapshotTest
+
+  std::unique_ptr<TMetadata> MakeMetadata() {
+    TMetadata::TBuilder builder;
+    builder.OpenBrokerList();
+    builder.AddBroker(5, "host1", 101);
+    builder.AddBroker(2, "host2", 102);
+    builder.AddBroker(7, "host3", 103);
+    builder.CloseBrokerList();
+    builder.OpenTopic("topic1");
+    builder.AddPartitionToTopic(6, 5, true, 9);
+    builder.AddPartitionToTopic(3, 2, true, 0);
+    builder.AddPartitionToTopic(7, 2, false, 5);  // out of service partition
+    builder.AddPartitionToTopic(1, 7, false, 6);  // out of service partition
+    builder.CloseTopic();
+    builder.OpenTopic("topic2");
+    builder.CloseTopic();
+    builder.OpenTopic("topic3");
+    builder.AddPartitionToTopic(0, 2, true, 0);
+    builder.AddPartitionToTopic(1, 5, true, 0);
+    builder.CloseTopic();
+    return std::unique_ptr<TMetadata>(builder.Build());
+  }
+
+  TEST_F(TMetadataSnapshotTest, EncodeDecodeTest) {
+    std::unique_ptr<TMetadata> md = MakeMetadata();
+    std::vector<uint8_t> buf;
+    EncodeMetadataSnapshot(*md, buf);
+    std::unique_ptr<TMetadata> md2 =
+        DecodeMetadataSnapshot(&buf[0], buf.size());
+    ASSERT_TRUE(!!md2);
+    ASSERT_TRUE(md2->SanityCheck());
+    ASSERT_TRUE(*md2 == *md);
+
+    TMetadata::TBuilder builder;
+    std::unique_ptr<TMetadata> empty(builder.Build());
+    EncodeMetadataSnapshot(*empty, buf);
+    md2 = DecodeMetadataSnapshot(&buf[0], buf.size());
+    ASSERT_TRUE(!!md2);
+    ASSERT_TRUE(*md2 == *empty);
+  }
+
+  TEST_F(TMetadataSnapshotTest, CorruptTest) {
+    std::unique_ptr<TMetadata> md = MakeMetadata();
+    std::vector<uint8_t> buf;
+    EncodeMetadataSnapshot(*md, buf);
+    ASSERT_FALSE(!!DecodeMetadataSnapshot(&buf[0], buf.size() - 1));
+    ASSERT_FALSE(!!DecodeMetadataSnapshot(&buf[0], 4));
+    ASSERT_FALSE(!!DecodeMetadataSnapshot(nullptr, 0));
+    std::vector<uint8_t> bad(buf);
+    bad.back() ^= 1;
+    ASSERT_FALSE(!!DecodeMetadataSnapshot(&bad[0], bad.size()));
+    bad = buf;
+    bad[0] ^= 1;
+    ASSERT_FALSE(!!DecodeMetadataSnapshot(&bad[0], bad.size()));
+  }
+
+  TEST_F(TMetadataSnapshotTest, FileTest) {
+    TTmpFileName tmp_name;
+    std::string path(tmp_name);
+    ASSERT_FALSE(!!ReadMetadataSnapshot(path));
+    std::unique_ptr<TMetadata> md = MakeMetadata();
+    WriteMetadataSnapshot(*md, path);
+    std::unique_ptr<TMetadata> md2 = ReadMetadataSnapshot(path);
+    ASSERT_TRUE(!!md2);
+    ASSERT_TRUE(*md2 == *md);
+
+    /* A truncated snapshot is ignored. */
+    IfLt0(truncate(path.c_str(), 20));
+    ASSERT_FALSE(!!ReadMetadataSnapshot(path));
+
+    /* A new snapshot replaces the old one. */
+    TMetadata::TBuilder builder;
+    std::unique_ptr<TMetadata> empty(builder.Build());
+    WriteMetadataSnapshot(*empty, path);
+    md2 = ReadMetadataSnapshot(path);
+    ASSERT_TRUE(!!md2);
+    ASSERT_TRUE(*md2 == *empty);
+    IfLt0(unlink(path.c_str()));
+  }
+
+}  // namespace
@@ -0,0 +1,83 @@
+/* <dory/mock_kafka_server/bandwidth_limiter.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Paces reads from a client to simulate a congested link.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace Dory {
+
+  namespace MockKafkaServer {
+
+    /* Tracks bytes read from a client and tells the caller how long to stop
+       reading so the average rate stays at or below a limit.  Once the
+       caller stops reading, the client's socket buffers fill and TCP flow
+       control slows the client, much as a congested link would.  All times
+       are in microseconds on a monotonic clock chosen by the caller. */
+    class TBandwidthLimiter final {
+      public:
+      /* A value of 0 for 'bytes_per_second' means unlimited. */
+      explicit TBandwidthLimiter(size_t bytes_per_second)
+          : BytesPerSecond(bytes_per_second),
+            NextFree(0) {
+      }
+
+      bool IsLimited() const {
+        assert(this);
+        return (BytesPerSecond != 0);
+      }
+
+      /* Return the largest number of bytes that should be read at once, so
+         that reads stay reasonably smooth.  This is about 10 milliseconds
+         worth of data at the limit, but at least 4096 bytes. */
+      size_t GetMaxReadSize() const {
+        assert(this);
+        return std::max<size_t>(BytesPerSecond / 100, 4096);
+      }
+
+      /* Account for 'bytes' read at time 'now'.  Returns the time before
+         which no more data should be read.  A return value less than or equal
+         to 'now' means reading may continue immediately. */
+      uint64_t Consume(size_t bytes, uint64_t now) {
+        assert(this);
+
+        if (!IsLimited()) {
+          return now;
+        }
+
+        NextFree = std::max(NextFree, now) +
+            ((static_cast<uint64_t>(bytes) * 1000000) / BytesPerSecond);
+        return NextFree;
+      }
+
+      private:
+      const size_t BytesPerSecond;
+
+      /* Time when the bytes consumed so far have been paid for. */
+      uint64_t NextFree;
+    };  // TBandwidthLimiter
+
+  }  // MockKafkaServer
+
+}  // Dory
@@ -66,6 +66,22 @@ static void ParseArgs(int argc, char *argv[], TConfig &config) {
     cmd.add(arg_cmd_port);
     SwitchArg arg_single_output_file("", "single_output_file", "Use single "
         "output file for all clients", cmd, config.SingleOutputFile);
+    SwitchArg arg_sink("", "sink", "Run in high-throughput sink mode: only "
+        "validate request framing and CRCs, with one epoll loop per broker "
+        "port.  Error injection and the periodic delays from \"port\" lines "
+        "in the setup file are not supported in this mode.", cmd,
+        config.Sink);
+    ValueArg<decltype(config.SinkSampleInterval)> arg_sink_sample("",
+        "sink_sample", "In sink mode, fully decode one of every N produce "
+        "requests.  0 means never.", false, config.SinkSampleInterval, "N");
+    cmd.add(arg_sink_sample);
+    ValueArg<std::string> arg_sink_ack_delay("", "sink_ack_delay", "In sink "
+        "mode, delay produce responses by a random amount from the given "
+        "distribution: none, fixed:US, uniform:MIN_US:MAX_US, or "
+        "longtail:MEDIAN_US:P99_US (all values in microseconds).  A "
+        "\"port_ack_latency\" line in the setup file overrides this for its "
+        "port.", false, "none", "DIST");
+    cmd.add(arg_sink_ack_delay);
     cmd.parse(argc, &arg_vec[0]);
     config.LogEcho = arg_log_echo.getValue();
     config.ProduceApiVersion = arg_produce_api_version.getValue();
@@ -75,6 +91,14 @@ static void ParseArgs(int argc, char *argv[], TConfig &config) {
     config.OutputDir = arg_output_dir.getValue();
     config.CmdPort = arg_cmd_port.getValue();
     config.SingleOutputFile = arg_single_output_file.getValue();
+    config.Sink = arg_sink.getValue();
+    config.SinkSampleInterval = arg_sink_sample.getValue();
+
+    try {
+      config.SinkAckDelay = TLatencyDist(arg_sink_ack_delay.getValue());
+    } catch (const TLatencyDist::TBadSpec &x) {
+      throw TArgParseError(x.what());
+    }
   } catch (const ArgException &x) {
     throw TArgParseError(x.error(), x.argId());
   }
@@ -86,6 +110,8 @@ TConfig::TConfig(int argc, char *argv[])
       MetadataApiVersion(0),
       QuietLevel(0),
       CmdPort(9080),
-      SingleOutputFile(false) {
+      SingleOutputFile(false),
+      Sink(false),
+      SinkSampleInterval(0) {
   ParseArgs(argc, argv, *this);
 }
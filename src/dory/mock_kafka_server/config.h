@@ -27,6 +27,8 @@
 
 #include <netinet/in.h>
 
+#include <dory/mock_kafka_server/latency_dist.h>
+
 namespace Dory {
 
   namespace MockKafkaServer {
@@ -50,6 +52,23 @@ namespace Dory {
       in_port_t CmdPort;
 
       bool SingleOutputFile;
+
+      /* In sink mode, each simulated broker runs a single epoll loop that
+         only validates request framing and CRCs, rather than a thread per
+         connection that fully parses each request.  Error injection
+         commands and periodic delays from "port" lines in the setup file are
+         ignored. */
+      bool Sink;
+
+      /* In sink mode, fully decode one of every 'SinkSampleInterval' produce
+         requests (0 means never).  Only decoded requests are reported to
+         unit tests as received requests. */
+      size_t SinkSampleInterval;
+
+      /* In sink mode, delay produce responses by a random amount chosen from
+         this distribution, unless the setup file gives a distribution for the
+         port. */
+      TLatencyDist SinkAckDelay;
     };  // TConfig
 
   }  // MockKafkaServer
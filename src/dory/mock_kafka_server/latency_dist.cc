@@ -0,0 +1,162 @@
+/* <dory/mock_kafka_server/latency_dist.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/mock_kafka_server/latency_dist.h>.
+ */
+
+#include <dory/mock_kafka_server/latency_dist.h>
+
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <base/no_default_case.h>
+#include <dory/mock_kafka_server/random.h>
+
+using namespace Dory;
+using namespace Dory::MockKafkaServer;
+
+/* z-score of the 99th percentile of the standard normal distribution */
+static const double Z_99 = 2.3263478740;
+
+TLatencyDist::TBadSpec::TBadSpec(const std::string &spec)
+    : std::runtime_error(std::string("Bad latency distribution [") + spec +
+          "]: must be none, fixed:US, uniform:MIN_US:MAX_US, or "
+          "longtail:MEDIAN_US:P99_US") {
+}
+
+static std::vector<std::string> SplitSpec(const std::string &spec) {
+  std::vector<std::string> result;
+  std::istringstream is(spec);
+  std::string item;
+
+  while (std::getline(is, item, ':')) {
+    result.push_back(item);
+  }
+
+  return result;
+}
+
+static uint64_t ParseValue(const std::string &spec, const std::string &s) {
+  if (s.empty() || (s.find_first_not_of("0123456789") != std::string::npos)) {
+    throw TLatencyDist::TBadSpec(spec);
+  }
+
+  try {
+    return boost::lexical_cast<uint64_t>(s);
+  } catch (const boost::bad_lexical_cast &) {
+    throw TLatencyDist::TBadSpec(spec);
+  }
+}
+
+TLatencyDist::TLatencyDist(const std::string &spec)
+    : TLatencyDist() {
+  std::vector<std::string> fields = SplitSpec(spec);
+
+  if (fields.empty()) {
+    throw TBadSpec(spec);
+  }
+
+  const std::string &kind = fields[0];
+
+  if ((kind == "none") && (fields.size() == 1)) {
+    return;
+  }
+
+  if ((kind == "fixed") && (fields.size() == 2)) {
+    Kind = TKind::Fixed;
+    A = ParseValue(spec, fields[1]);
+  } else if ((kind == "uniform") && (fields.size() == 3)) {
+    Kind = TKind::Uniform;
+    A = ParseValue(spec, fields[1]);
+    B = ParseValue(spec, fields[2]);
+  } else if ((kind == "longtail") && (fields.size() == 3)) {
+    Kind = TKind::LongTail;
+    A = ParseValue(spec, fields[1]);
+    B = ParseValue(spec, fields[2]);
+
+    if (A == 0) {
+      throw TBadSpec(spec);
+    }
+
+    Mu = std::log(static_cast<double>(A));
+    Sigma = (std::log(static_cast<double>(B)) - Mu) / Z_99;
+  } else {
+    throw TBadSpec(spec);
+  }
+
+  if ((Kind != TKind::Fixed) && (B < A)) {
+    throw TBadSpec(spec);
+  }
+}
+
+uint64_t TLatencyDist::Choose(uint64_t &rand_state) const {
+  assert(this);
+
+  switch (Kind) {
+    case TKind::None: {
+      break;
+    }
+    case TKind::Fixed: {
+      return A;
+    }
+    case TKind::Uniform: {
+      return A + (NextRandom(rand_state) % (B - A + 1));
+    }
+    case TKind::LongTail: {
+      /* Box-Muller transform gives a standard normal value. */
+      double u1 = NextUnitRandom(rand_state);
+      double u2 = NextUnitRandom(rand_state);
+      double z = std::sqrt(-2.0 * std::log(u1)) *
+          std::cos(6.283185307179586 * u2);
+      double value = std::exp(Mu + (Sigma * z));
+
+      /* Cap at an hour, so absurd specs can't overflow. */
+      return (value < 3.6e9) ? static_cast<uint64_t>(value) : 3600000000ULL;
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return 0;
+}
+
+std::string TLatencyDist::ToString() const {
+  assert(this);
+
+  switch (Kind) {
+    case TKind::None: {
+      break;
+    }
+    case TKind::Fixed: {
+      return "fixed:" + boost::lexical_cast<std::string>(A);
+    }
+    case TKind::Uniform: {
+      return "uniform:" + boost::lexical_cast<std::string>(A) + ":" +
+          boost::lexical_cast<std::string>(B);
+    }
+    case TKind::LongTail: {
+      return "longtail:" + boost::lexical_cast<std::string>(A) + ":" +
+          boost::lexical_cast<std::string>(B);
+    }
+    NO_DEFAULT_CASE;
+  }
+
+  return "none";
+}
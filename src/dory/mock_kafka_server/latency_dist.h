@@ -0,0 +1,115 @@
+/* <dory/mock_kafka_server/latency_dist.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Random latency distribution for simulated broker delays.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace Dory {
+
+  namespace MockKafkaServer {
+
+    class TLatencyDist final {
+      public:
+      class TBadSpec final : public std::runtime_error {
+        public:
+        explicit TBadSpec(const std::string &spec);
+
+        virtual ~TBadSpec() noexcept { }
+      };  // TBadSpec
+
+      enum class TKind {
+        /* No delay. */
+        None,
+
+        /* Always 'A' microseconds. */
+        Fixed,
+
+        /* Uniform from 'A' to 'B' microseconds. */
+        Uniform,
+
+        /* Lognormal with median 'A' and 99th percentile 'B' microseconds.
+           Most values are near the median, with occasional much larger
+           values. */
+        LongTail
+      };  // TKind
+
+      /* Construct a distribution with no delay. */
+      TLatencyDist()
+          : Kind(TKind::None),
+            A(0),
+            B(0),
+            Mu(0),
+            Sigma(0) {
+      }
+
+      /* Parse a specification of one of the following forms, where all values
+         are in microseconds:
+
+             none
+             fixed:US
+             uniform:MIN_US:MAX_US
+             longtail:MEDIAN_US:P99_US
+
+         Throws TBadSpec on error. */
+      explicit TLatencyDist(const std::string &spec);
+
+      TLatencyDist(const TLatencyDist &) = default;
+
+      TLatencyDist &operator=(const TLatencyDist &) = default;
+
+      TKind GetKind() const {
+        assert(this);
+        return Kind;
+      }
+
+      bool IsNone() const {
+        assert(this);
+        return (Kind == TKind::None);
+      }
+
+      /* Return a random delay in microseconds.  'rand_state' is the caller's
+         random number generator state, which must be nonzero. */
+      uint64_t Choose(uint64_t &rand_state) const;
+
+      /* Return the specification this distribution was parsed from, in
+         canonical form. */
+      std::string ToString() const;
+
+      private:
+      TKind Kind;
+
+      uint64_t A;
+
+      uint64_t B;
+
+      /* Parameters of the underlying normal distribution for LongTail. */
+      double Mu;
+
+      double Sigma;
+    };  // TLatencyDist
+
+  }  // MockKafkaServer
+
+}  // Dory
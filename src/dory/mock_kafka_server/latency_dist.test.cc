@@ -0,0 +1,122 @@
+/* <dory/mock_kafka_server/latency_dist.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/mock_kafka_server/latency_dist.h>.
+ */
+
+#include <dory/mock_kafka_server/latency_dist.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace Dory;
+using namespace Dory::MockKafkaServer;
+
+namespace {
+
+  /* The fixture for testing class TLatencyDist. */
+  class TLatencyDistTest : public ::testing::Test {
+    protected:
+    TLatencyDistTest() {
+    }
+
+    virtual ~TLatencyDistTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TLatencyDistTest
+
+  static bool SpecIsBad(const char *spec) {
+    try {
+      TLatencyDist dist(spec);
+    } catch (const TLatencyDist::TBadSpec &) {
+      return true;
+    }
+
+    return false;
+  }
+
+  TEST_F(TLatencyDistTest, Parse) {
+    ASSERT_TRUE(TLatencyDist().IsNone());
+    ASSERT_TRUE(TLatencyDist("none").IsNone());
+    ASSERT_TRUE(TLatencyDist("fixed:500").GetKind() ==
+        TLatencyDist::TKind::Fixed);
+    ASSERT_EQ(TLatencyDist("fixed:500").ToString(), "fixed:500");
+    ASSERT_TRUE(TLatencyDist("uniform:10:20").GetKind() ==
+        TLatencyDist::TKind::Uniform);
+    ASSERT_EQ(TLatencyDist("uniform:10:20").ToString(), "uniform:10:20");
+    ASSERT_TRUE(TLatencyDist("longtail:1000:50000").GetKind() ==
+        TLatencyDist::TKind::LongTail);
+    ASSERT_EQ(TLatencyDist("longtail:1000:50000").ToString(),
+        "longtail:1000:50000");
+
+    ASSERT_TRUE(SpecIsBad(""));
+    ASSERT_TRUE(SpecIsBad("fixed"));
+    ASSERT_TRUE(SpecIsBad("fixed:"));
+    ASSERT_TRUE(SpecIsBad("fixed:abc"));
+    ASSERT_TRUE(SpecIsBad("fixed:5:6"));
+    ASSERT_TRUE(SpecIsBad("uniform:20:10"));
+    ASSERT_TRUE(SpecIsBad("longtail:1000:500"));
+    ASSERT_TRUE(SpecIsBad("longtail:0:500"));
+    ASSERT_TRUE(SpecIsBad("bogus:1"));
+  }
+
+  TEST_F(TLatencyDistTest, Choose) {
+    uint64_t rand_state = 12345;
+    TLatencyDist none;
+    TLatencyDist fixed("fixed:500");
+    TLatencyDist uniform("uniform:10:20");
+
+    for (size_t i = 0; i < 1000; ++i) {
+      ASSERT_EQ(none.Choose(rand_state), 0U);
+      ASSERT_EQ(fixed.Choose(rand_state), 500U);
+      uint64_t value = uniform.Choose(rand_state);
+      ASSERT_GE(value, 10U);
+      ASSERT_LE(value, 20U);
+    }
+
+    /* Check that the median and 99th percentile are roughly as requested. */
+    TLatencyDist long_tail("longtail:1000:50000");
+    std::vector<uint64_t> values;
+
+    for (size_t i = 0; i < 100000; ++i) {
+      values.push_back(long_tail.Choose(rand_state));
+    }
+
+    std::sort(values.begin(), values.end());
+    uint64_t median = values[values.size() / 2];
+    uint64_t p99 = values[(values.size() * 99) / 100];
+    ASSERT_GT(median, 900U);
+    ASSERT_LT(median, 1100U);
+    ASSERT_GT(p99, 40000U);
+    ASSERT_LT(p99, 60000U);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -32,6 +32,7 @@
 #include <dory/mock_kafka_server/config.h>
 #include <dory/mock_kafka_server/received_request_tracker.h>
 #include <dory/mock_kafka_server/server.h>
+#include <dory/mock_kafka_server/sink_stats.h>
 #include <thread/fd_managed_thread.h>
 
 namespace Dory {
@@ -101,6 +102,16 @@ namespace Dory {
         Server.NonblockingGetHandledRequests(result);
       }
 
+      const Base::TFd &GetHandledRequestsAvailableFd() const {
+        assert(this);
+        return Server.GetHandledRequestsAvailableFd();
+      }
+
+      const TSinkStats &GetSinkStats() const {
+        assert(this);
+        return Server.GetSinkStats();
+      }
+
       protected:
       virtual void Run() override;
 
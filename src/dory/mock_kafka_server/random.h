@@ -0,0 +1,56 @@
+/* <dory/mock_kafka_server/random.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Cheap pseudorandom numbers for simulating broker behavior.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+namespace Dory {
+
+  namespace MockKafkaServer {
+
+    /* Return the next value from a xorshift64* generator whose state is
+       'state', which must be nonzero.  This is fast and good enough for
+       simulation, but must not be used for anything security related. */
+    inline uint64_t NextRandom(uint64_t &state) {
+      assert(state);
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+      return state * 2685821657736338717ULL;
+    }
+
+    /* Return a value uniformly distributed in (0, 1]. */
+    inline double NextUnitRandom(uint64_t &state) {
+      return (static_cast<double>(NextRandom(state) >> 11) + 1.0) /
+          9007199254740992.0;
+    }
+
+    /* Return a nonzero initial generator state derived from 'seed'. */
+    inline uint64_t InitRandomState(uint64_t seed) {
+      uint64_t result = 0x9e3779b97f4a7c15ULL * (seed + 1);
+      return result ? result : 1;
+    }
+
+  }  // MockKafkaServer
+
+}  // Dory
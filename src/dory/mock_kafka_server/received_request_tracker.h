@@ -25,8 +25,10 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <list>
 #include <string>
 
+#include <base/fd.h>
 #include <base/no_copy_semantics.h>
 #include <base/opt.h>
 #include <dory/compress/compression_type.h>
@@ -138,6 +140,13 @@ namespace Dory {
         result.splice(result.end(), Queue.NonblockingGet());
       }
 
+      /* Returns a file descriptor that becomes readable when request info is
+         available. */
+      const Base::TFd &GetRequestInfoAvailableFd() const {
+        assert(this);
+        return Queue.GetMsgAvailableFd();
+      }
+
       private:
       using TQueue = Thread::TGate<TRequestInfo>;
 
@@ -98,7 +98,13 @@ int TServer::Run() {
   }
 
   t_shutdown shutdown(*this);  // destructor calls ShutDownWorkers()
+
+  for (auto &broker : SinkBrokers) {
+    broker->Start();
+  }
+
   Ss.Dispatcher->Run(std::chrono::milliseconds(1), { });  // shutdown on SIGINT
+  ShutDownSinkBrokers();
   ConnectHandlers.clear();
   ListenFdVec.clear();
   return EXIT_SUCCESS;
@@ -136,6 +142,7 @@ bool TServer::InitOutputDir() {
 
 void TServer::ShutDownWorkers() {
   assert(this);
+  ShutDownSinkBrokers();
   std::unordered_map<int, TSharedState::TPerConnectionState> &state_map =
       Ss.PerConnectionMap;
 
@@ -160,6 +167,49 @@ void TServer::ShutDownWorkers() {
   state_map.clear();
 }
 
+void TServer::ShutDownSinkBrokers() {
+  assert(this);
+
+  for (auto &broker : SinkBrokers) {
+    if (broker->IsStarted()) {
+      broker->RequestShutdown();
+    }
+  }
+
+  for (auto &broker : SinkBrokers) {
+    if (!broker->IsStarted()) {
+      continue;
+    }
+
+    try {
+      broker->Join();
+    } catch (const TFdManagedThread::TWorkerError &x) {
+      try {
+        std::rethrow_exception(x.ThrownException);
+      } catch (const std::exception &y) {
+        syslog(LOG_ERR, "Sink broker threw exception: %s", y.what());
+      } catch (...) {
+        syslog(LOG_ERR, "Sink broker threw unknown exception");
+      }
+    }
+  }
+
+  if (!SinkBrokers.empty()) {
+    const TSinkStats &stats = Ss.SinkStats;
+    syslog(LOG_NOTICE, "Sink mode totals: %llu produce requests, %llu "
+        "message sets, %llu messages, %llu bytes, %llu CRC errors, %llu bad "
+        "requests",
+        static_cast<unsigned long long>(stats.ProduceRequests),
+        static_cast<unsigned long long>(stats.MsgSets),
+        static_cast<unsigned long long>(stats.Msgs),
+        static_cast<unsigned long long>(stats.Bytes),
+        static_cast<unsigned long long>(stats.CrcErrors),
+        static_cast<unsigned long long>(stats.BadRequests));
+  }
+
+  SinkBrokers.clear();
+}
+
 bool TServer::InitCmdPort() {
   assert(this);
   in_port_t kafka_port_begin = Ss.Setup.BasePort;
@@ -201,20 +251,26 @@ void TServer::InitKafkaPorts() {
     }
   }
 
+  SinkBrokers.clear();
   ListenFdVec.clear();
   ListenFdVec.resize(Ss.Setup.Ports.size());
   ConnectHandlers.clear();
-  ConnectHandlers.resize(ListenFdVec.size());
 
-  for (size_t port_offset = 0;
-       port_offset < ConnectHandlers.size();
-       ++port_offset) {
-    ConnectHandlers[port_offset].reset(
-        new TConnectHandler(Ss, *ClientHandlerFactory, port_offset, PortMap));
+  if (!Ss.Config.Sink) {
+    ConnectHandlers.resize(ListenFdVec.size());
+
+    for (size_t port_offset = 0;
+         port_offset < ConnectHandlers.size();
+         ++port_offset) {
+      ConnectHandlers[port_offset].reset(
+          new TConnectHandler(Ss, *ClientHandlerFactory, port_offset,
+              PortMap));
+    }
+
+    assert(ConnectHandlers.size() == Ss.Setup.Ports.size());
   }
 
   assert(ListenFdVec.size() == Ss.Setup.Ports.size());
-  assert(ConnectHandlers.size() == Ss.Setup.Ports.size());
 
   for (size_t i = 0; i < Ss.Setup.Ports.size(); ++i) {
     /* See big comment in <dory/mock_kafka_server/port_map.h> for an
@@ -236,8 +292,14 @@ void TServer::InitKafkaPorts() {
     assert(UseEphemeralPorts || (physical_port == virtual_port));
     PortMap->AddMapping(virtual_port, physical_port);
 
-    ConnectHandlers[i]->RegisterWithDispatcher(*Ss.Dispatcher, fd,
-        POLLIN | POLLERR);
+    if (Ss.Config.Sink) {
+      /* Sink mode brokers do their own polling, so they don't use the
+         dispatcher. */
+      SinkBrokers.emplace_back(new TSinkBroker(Ss, *PortMap, i, fd));
+    } else {
+      ConnectHandlers[i]->RegisterWithDispatcher(*Ss.Dispatcher, fd,
+          POLLIN | POLLERR);
+    }
   }
 
   for (TFd &fd : ListenFdVec) {
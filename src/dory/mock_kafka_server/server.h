@@ -40,6 +40,8 @@
 #include <dory/mock_kafka_server/received_request_tracker.h>
 #include <dory/mock_kafka_server/setup.h>
 #include <dory/mock_kafka_server/single_client_handler_base.h>
+#include <dory/mock_kafka_server/sink_broker.h>
+#include <dory/mock_kafka_server/sink_stats.h>
 #include <fiber/dispatcher.h>
 
 namespace Dory {
@@ -111,11 +113,27 @@ namespace Dory {
         Ss.ReceivedRequests.NonblockingGetRequestInfo(result);
       }
 
+      /* Returns a file descriptor that becomes readable when info on handled
+         requests is available. */
+      const Base::TFd &GetHandledRequestsAvailableFd() const {
+        assert(this);
+        return Ss.ReceivedRequests.GetRequestInfoAvailableFd();
+      }
+
+      /* Returns counters maintained in sink mode.  These remain zero when
+         sink mode is not enabled. */
+      const TSinkStats &GetSinkStats() const {
+        assert(this);
+        return Ss.SinkStats;
+      }
+
       private:
       bool InitOutputDir();
 
       void ShutDownWorkers();
 
+      void ShutDownSinkBrokers();
+
       bool InitCmdPort();
 
       void InitKafkaPorts();
@@ -142,6 +160,10 @@ namespace Dory {
       /* There is 1 of these per listening FD. */
       std::vector<std::shared_ptr<TConnectHandler>> ConnectHandlers;
 
+      /* In sink mode, there is 1 of these per listening FD instead of a
+         connect handler. */
+      std::vector<std::unique_ptr<TSinkBroker>> SinkBrokers;
+
       /* This is the port the server listens on for error injection commands.
        */
       in_port_t CmdPort;
@@ -50,6 +50,29 @@ TSetup::TFileFormatError::TFileFormatError(size_t line_num, const char *msg)
       LineNum(line_num) {
 }
 
+size_t TSetup::TInfo::GetLeaderPortOffset(const TTopic &topic,
+    size_t partition, uint64_t elapsed_ms) const {
+  assert(this);
+  assert(partition < topic.Partitions.size());
+  assert(!Ports.empty());
+  size_t result = (topic.FirstPortOffset + partition) % Ports.size();
+  const TPartition &p = topic.Partitions[partition];
+
+  for (const TLeaderChange &change : p.LeaderChanges) {
+    if (change.Time > elapsed_ms) {
+      break;
+    }
+
+    result = change.PortOffset;
+  }
+
+  if (p.LeaderFlapPeriod && ((elapsed_ms / p.LeaderFlapPeriod) % 2)) {
+    result = p.LeaderFlapPortOffset;
+  }
+
+  return result;
+}
+
 TSetup::TSetup()
     : LineNum(0) {
 }
@@ -186,68 +209,132 @@ static bool ParseDelayAndInterval(const std::string &s, size_t &delay,
   return true;
 }
 
-void TSetup::GetPortLines(std::istream &in) {
+size_t TSetup::GetPortOffset(const std::string &token,
+    const char *line_type) {
   assert(this);
   assert(!Result.Ports.empty());
   in_port_t min_port = Result.BasePort;
   in_port_t max_port = min_port + (Result.Ports.size() - 1);
+  in_port_t port = 0;
 
-  for (; !CurrentLineTokens.empty() && (CurrentLineTokens[0] == "port");
-       NextInterestingLine(in)) {
-    if (CurrentLineTokens.size() != 6) {
-      throw TFileFormatError(LineNum,
-          "\"ports\" should be followed by exactly 5 values");
-    }
+  try {
+    port = boost::lexical_cast<in_port_t>(token);
+  } catch (const boost::bad_lexical_cast &x) {
+    std::string msg("invalid port specified in \"");
+    msg += line_type;
+    msg += "\" line";
+    throw TFileFormatError(LineNum, msg.c_str());
+  }
 
-    in_port_t port = 0;
+  if ((port < min_port) || (port > max_port)) {
+    std::string msg("port specified in \"");
+    msg += line_type;
+    msg += "\" line is out of range";
+    throw TFileFormatError(LineNum, msg.c_str());
+  }
 
-    try {
-      port = boost::lexical_cast<in_port_t>(CurrentLineTokens[1]);
-    } catch (const boost::bad_lexical_cast &x) {
-      throw TFileFormatError(LineNum,
-                             "invalid port specified in \"port\" line");
-    }
+  return port - min_port;
+}
 
-    if ((port < min_port) || (port > max_port)) {
-      throw TFileFormatError(LineNum,
-          "port specified in \"port\" line is out of range");
-    }
+void TSetup::GetPortLines(std::istream &in) {
+  assert(this);
 
-    if (CurrentLineTokens[2] != "read_delay") {
-      throw TFileFormatError(LineNum,
-          "third token of \"port\" line should be \"read_delay\"");
+  for (; !CurrentLineTokens.empty(); NextInterestingLine(in)) {
+    const std::string &line_type = CurrentLineTokens[0];
+
+    if (line_type == "port") {
+      GetPortLine();
+    } else if (line_type == "port_ack_latency") {
+      GetPortAckLatencyLine();
+    } else if (line_type == "port_bandwidth") {
+      GetPortBandwidthLine();
+    } else {
+      break;
     }
+  }
+}
 
-    size_t read_delay_time = 0;
-    size_t read_delay_interval = 0;
+void TSetup::GetPortLine() {
+  assert(this);
 
-    if (!ParseDelayAndInterval(CurrentLineTokens[3], read_delay_time,
-                               read_delay_interval)) {
-      throw TFileFormatError(LineNum,
-                             "\"port\" line has invalid read_delay info");
-    }
+  if (CurrentLineTokens.size() != 6) {
+    throw TFileFormatError(LineNum,
+        "\"ports\" should be followed by exactly 5 values");
+  }
 
-    if (CurrentLineTokens[4] != "ack_delay") {
-      throw TFileFormatError(LineNum,
-          "fifth token of \"port\" line should be \"ack_delay\"");
-    }
+  size_t port_index = GetPortOffset(CurrentLineTokens[1], "port");
+
+  if (CurrentLineTokens[2] != "read_delay") {
+    throw TFileFormatError(LineNum,
+        "third token of \"port\" line should be \"read_delay\"");
+  }
 
-    size_t ack_delay_time = 0;
-    size_t ack_delay_interval = 0;
+  size_t read_delay_time = 0;
+  size_t read_delay_interval = 0;
 
-    if (!ParseDelayAndInterval(CurrentLineTokens[5], ack_delay_time,
-                               ack_delay_interval)) {
-      throw TFileFormatError(LineNum,
-                             "\"port\" line has invalid ack_delay info");
-    }
+  if (!ParseDelayAndInterval(CurrentLineTokens[3], read_delay_time,
+                             read_delay_interval)) {
+    throw TFileFormatError(LineNum,
+                           "\"port\" line has invalid read_delay info");
+  }
+
+  if (CurrentLineTokens[4] != "ack_delay") {
+    throw TFileFormatError(LineNum,
+        "fifth token of \"port\" line should be \"ack_delay\"");
+  }
+
+  size_t ack_delay_time = 0;
+  size_t ack_delay_interval = 0;
+
+  if (!ParseDelayAndInterval(CurrentLineTokens[5], ack_delay_time,
+                             ack_delay_interval)) {
+    throw TFileFormatError(LineNum,
+                           "\"port\" line has invalid ack_delay info");
+  }
+
+  TPort &port_info = Result.Ports[port_index];
+  port_info.ReadDelay = read_delay_time;
+  port_info.ReadDelayInterval = read_delay_interval;
+  port_info.AckDelay = ack_delay_time;
+  port_info.AckDelayInterval = ack_delay_interval;
+}
+
+void TSetup::GetPortAckLatencyLine() {
+  assert(this);
+
+  if (CurrentLineTokens.size() != 3) {
+    throw TFileFormatError(LineNum,
+        "\"port_ack_latency\" should be followed by exactly 2 values");
+  }
+
+  size_t port_index = GetPortOffset(CurrentLineTokens[1], "port_ack_latency");
+
+  try {
+    Result.Ports[port_index].AckLatency = TLatencyDist(CurrentLineTokens[2]);
+  } catch (const TLatencyDist::TBadSpec &x) {
+    throw TFileFormatError(LineNum, x.what());
+  }
+}
 
-    size_t port_index = port - min_port;
-    TPort &port_info = Result.Ports[port_index];
-    port_info.ReadDelay = read_delay_time;
-    port_info.ReadDelayInterval = read_delay_interval;
-    port_info.AckDelay = ack_delay_time;
-    port_info.AckDelayInterval = ack_delay_interval;
+void TSetup::GetPortBandwidthLine() {
+  assert(this);
+
+  if (CurrentLineTokens.size() != 3) {
+    throw TFileFormatError(LineNum,
+        "\"port_bandwidth\" should be followed by exactly 2 values");
   }
+
+  size_t port_index = GetPortOffset(CurrentLineTokens[1], "port_bandwidth");
+  size_t bandwidth = 0;
+
+  try {
+    bandwidth = boost::lexical_cast<size_t>(CurrentLineTokens[2]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid bandwidth specified in \"port_bandwidth\" line");
+  }
+
+  Result.Ports[port_index].Bandwidth = bandwidth;
 }
 
 void TSetup::GetTopicLines(std::istream &in) {
@@ -295,62 +382,184 @@ void TSetup::GetTopicLines(std::istream &in) {
   }
 }
 
-void TSetup::GetPartitionErrorLines(std::istream &in) {
+void TSetup::GetPartitionLines(std::istream &in) {
   assert(this);
 
-  for (; !CurrentLineTokens.empty() &&
-           (CurrentLineTokens[0] == "partition_error");
-       NextInterestingLine(in)) {
-    if (CurrentLineTokens.size() != 5) {
-      throw TFileFormatError(LineNum,
-          "\"partition_error\" should be followed by exactly 4 values");
+  for (; !CurrentLineTokens.empty(); NextInterestingLine(in)) {
+    const std::string &line_type = CurrentLineTokens[0];
+
+    if (line_type == "partition_error") {
+      GetPartitionErrorLine();
+    } else if (line_type == "partition_error_rate") {
+      GetPartitionErrorRateLine();
+    } else if (line_type == "leader_change") {
+      GetLeaderChangeLine();
+    } else if (line_type == "leader_flap") {
+      GetLeaderFlapLine();
+    } else {
+      break;
     }
+  }
+}
+
+TSetup::TPartition &TSetup::GetPartitionInfo(const char *line_type) {
+  assert(this);
+  assert(CurrentLineTokens.size() >= 3);
+  auto iter = Result.Topics.find(CurrentLineTokens[1]);
+
+  if (iter == Result.Topics.end()) {
+    std::string msg("\"");
+    msg += line_type;
+    msg += "\" line specifies unknown topic";
+    throw TFileFormatError(LineNum, msg.c_str());
+  }
 
-    auto iter = Result.Topics.find(CurrentLineTokens[1]);
+  size_t partition = 0;
 
-    if (iter == Result.Topics.end()) {
-      throw TFileFormatError(LineNum,
-          "\"partition_error\" line specifies unknown topic");
-    }
+  try {
+    partition = boost::lexical_cast<size_t>(CurrentLineTokens[2]);
+  } catch (const boost::bad_lexical_cast &x) {
+    std::string msg("invalid partition specified in \"");
+    msg += line_type;
+    msg += "\" line";
+    throw TFileFormatError(LineNum, msg.c_str());
+  }
 
-    size_t partition = 0;
+  TTopic &topic = iter->second;
 
-    try {
-      partition = boost::lexical_cast<size_t>(CurrentLineTokens[2]);
-    } catch (const boost::bad_lexical_cast &x) {
-      throw TFileFormatError(LineNum,
-          "invalid partition specified in \"partition_error\" line");
-    }
+  if (partition >= topic.Partitions.size()) {
+    std::string msg("nonexistent partition specified in \"");
+    msg += line_type;
+    msg += "\" line";
+    throw TFileFormatError(LineNum, msg.c_str());
+  }
 
-    TTopic &topic = iter->second;
+  return topic.Partitions[partition];
+}
 
-    if (partition >= topic.Partitions.size()) {
-      throw TFileFormatError(LineNum,
-          "nonexistent partition specified in \"partition_error\" line");
-    }
+void TSetup::GetPartitionErrorLine() {
+  assert(this);
 
-    TPartition &partition_info = topic.Partitions[partition];
-    int16_t ack_error = 0;
+  if (CurrentLineTokens.size() != 5) {
+    throw TFileFormatError(LineNum,
+        "\"partition_error\" should be followed by exactly 4 values");
+  }
 
-    try {
-      ack_error = boost::lexical_cast<int16_t>(CurrentLineTokens[3]);
-    } catch (const boost::bad_lexical_cast &x) {
-      throw TFileFormatError(LineNum,
-          "invalid error code specified in \"partition_error\" line");
-    }
+  TPartition &partition_info = GetPartitionInfo("partition_error");
+  int16_t ack_error = 0;
+
+  try {
+    ack_error = boost::lexical_cast<int16_t>(CurrentLineTokens[3]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid error code specified in \"partition_error\" line");
+  }
 
-    size_t interval = 0;
+  size_t interval = 0;
 
-    try {
-      interval = boost::lexical_cast<size_t>(CurrentLineTokens[4]);
-    } catch (const boost::bad_lexical_cast &x) {
-      throw TFileFormatError(LineNum,
-          "invalid interval specified in \"partition_error\" line");
-    }
+  try {
+    interval = boost::lexical_cast<size_t>(CurrentLineTokens[4]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid interval specified in \"partition_error\" line");
+  }
+
+  partition_info.AckError = ack_error;
+  partition_info.AckErrorInterval = interval;
+}
+
+void TSetup::GetPartitionErrorRateLine() {
+  assert(this);
+
+  if (CurrentLineTokens.size() != 5) {
+    throw TFileFormatError(LineNum,
+        "\"partition_error_rate\" should be followed by exactly 4 values");
+  }
+
+  TPartition &partition_info = GetPartitionInfo("partition_error_rate");
+  int16_t ack_error = 0;
+
+  try {
+    ack_error = boost::lexical_cast<int16_t>(CurrentLineTokens[3]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid error code specified in \"partition_error_rate\" line");
+  }
+
+  double rate = 0.0;
+
+  try {
+    rate = boost::lexical_cast<double>(CurrentLineTokens[4]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid rate specified in \"partition_error_rate\" line");
+  }
+
+  if (!((rate >= 0.0) && (rate <= 1.0))) {
+    throw TFileFormatError(LineNum,
+        "rate in \"partition_error_rate\" line must be from 0 to 1");
+  }
+
+  partition_info.RandomAckError = ack_error;
+  partition_info.RandomAckErrorRate = rate;
+}
+
+void TSetup::GetLeaderChangeLine() {
+  assert(this);
+
+  if (CurrentLineTokens.size() != 5) {
+    throw TFileFormatError(LineNum,
+        "\"leader_change\" should be followed by exactly 4 values");
+  }
+
+  TPartition &partition_info = GetPartitionInfo("leader_change");
+  size_t time = 0;
+
+  try {
+    time = boost::lexical_cast<size_t>(CurrentLineTokens[3]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid time specified in \"leader_change\" line");
+  }
+
+  std::vector<TLeaderChange> &changes = partition_info.LeaderChanges;
+
+  if (!changes.empty() && (time <= changes.back().Time)) {
+    throw TFileFormatError(LineNum,
+        "\"leader_change\" lines for a partition must be in increasing "
+        "time order");
+  }
 
-    partition_info.AckError = ack_error;
-    partition_info.AckErrorInterval = interval;
+  changes.emplace_back(time,
+      GetPortOffset(CurrentLineTokens[4], "leader_change"));
+}
+
+void TSetup::GetLeaderFlapLine() {
+  assert(this);
+
+  if (CurrentLineTokens.size() != 5) {
+    throw TFileFormatError(LineNum,
+        "\"leader_flap\" should be followed by exactly 4 values");
   }
+
+  TPartition &partition_info = GetPartitionInfo("leader_flap");
+  size_t period = 0;
+
+  try {
+    period = boost::lexical_cast<size_t>(CurrentLineTokens[3]);
+  } catch (const boost::bad_lexical_cast &x) {
+    throw TFileFormatError(LineNum,
+        "invalid period specified in \"leader_flap\" line");
+  }
+
+  if (period == 0) {
+    throw TFileFormatError(LineNum,
+        "period in \"leader_flap\" line must be nonzero");
+  }
+
+  partition_info.LeaderFlapPeriod = period;
+  partition_info.LeaderFlapPortOffset =
+      GetPortOffset(CurrentLineTokens[4], "leader_flap");
 }
 
 void TSetup::FillResult(std::istream &in) {
@@ -360,5 +569,5 @@ void TSetup::FillResult(std::istream &in) {
   GetPortsLine(in);
   GetPortLines(in);
   GetTopicLines(in);
-  GetPartitionErrorLines(in);
+  GetPartitionLines(in);
 }
@@ -32,6 +32,8 @@
 
 #include <netinet/in.h>
 
+#include <dory/mock_kafka_server/latency_dist.h>
+
 namespace Dory {
 
   namespace MockKafkaServer {
@@ -55,30 +57,70 @@ namespace Dory {
       /* The mock server listens on a range of consecutive port numbers, with
          each port simulating a separate Kafka broker.  For each simulated
          broker we can inject periodic delays before reading a request and/or
-         sending an ACK. */
+         sending an ACK.  We can also delay every ACK by a random amount and
+         limit the rate at which requests are read, to simulate a slow broker
+         or a congested link. */
       struct TPort {
         size_t ReadDelay;  // delay in milliseconds before socket read
         size_t ReadDelayInterval;  // how often to impose read delay
         size_t AckDelay;  // delay in milliseconds before sending ACK
         size_t AckDelayInterval;  // how often to impose ACK delay
 
+        /* random delay in microseconds before sending each produce ACK */
+        TLatencyDist AckLatency;
+
+        /* maximum bytes per second read from each connection (0 means
+           unlimited) */
+        size_t Bandwidth;
+
         TPort()
             : ReadDelay(0),
               ReadDelayInterval(1),
               AckDelay(0),
-              AckDelayInterval(1) {
+              AckDelayInterval(1),
+              Bandwidth(0) {
         }
       };  // TPort
 
-      /* For each partition within a topic, we can inject periodic ACK errors.
-       */
+      /* A partition's leader moves to the broker at port offset
+         'PortOffset' once 'Time' milliseconds have elapsed since the server
+         started. */
+      struct TLeaderChange {
+        size_t Time;
+        size_t PortOffset;
+
+        TLeaderChange(size_t time, size_t port_offset)
+            : Time(time),
+              PortOffset(port_offset) {
+        }
+      };  // TLeaderChange
+
+      /* For each partition within a topic, we can inject periodic ACK errors
+         and random ACK errors, and schedule changes of leadership. */
       struct TPartition {
         int16_t AckError;
         size_t AckErrorInterval;
 
+        /* error code to return with probability 'RandomAckErrorRate' */
+        int16_t RandomAckError;
+        double RandomAckErrorRate;
+
+        /* ordered by increasing time */
+        std::vector<TLeaderChange> LeaderChanges;
+
+        /* If nonzero, leadership moves to port offset 'LeaderFlapPortOffset'
+           for the second half of each interval of 2 * 'LeaderFlapPeriod'
+           milliseconds, overriding 'LeaderChanges'. */
+        size_t LeaderFlapPeriod;
+        size_t LeaderFlapPortOffset;
+
         TPartition()
             : AckError(0),
-              AckErrorInterval(1) {
+              AckErrorInterval(1),
+              RandomAckError(0),
+              RandomAckErrorRate(0.0),
+              LeaderFlapPeriod(0),
+              LeaderFlapPortOffset(0) {
         }
       };  // TPartition
 
@@ -111,6 +153,12 @@ namespace Dory {
           Ports.clear();
           Topics.clear();
         }
+
+        /* Return the port offset of the broker that leads 'partition' of
+           'topic' once 'elapsed_ms' milliseconds have passed since the server
+           started.  'partition' must be a valid partition of 'topic'. */
+        size_t GetLeaderPortOffset(const TTopic &topic, size_t partition,
+            uint64_t elapsed_ms) const;
       };  // TInfo
 
       TSetup();
@@ -160,6 +208,39 @@ namespace Dory {
              2.  0 or more 'port' lines then follow.
              3.  1 or more 'topic' lines then follow.
              4.  0 or more 'partition_error' lines then follow.
+
+         The 'port' lines may be mixed with the following lines, which
+         simulate slow brokers and congested links:
+
+           port_ack_latency 10001 longtail:2000:50000
+           port_bandwidth 10002 1048576
+
+         The first line specifies that the server instance listening on port
+         10001 will delay each produce ACK by a random amount chosen from the
+         given distribution.  Values are in microseconds, and the distribution
+         may be "fixed:US", "uniform:MIN_US:MAX_US", or
+         "longtail:MEDIAN_US:P99_US".  The second line limits the rate at which
+         the server instance listening on port 10002 reads requests to
+         1048576 bytes per second per connection.
+
+         Likewise, the 'partition_error' lines may be mixed with the following
+         lines:
+
+           partition_error_rate foo 1 7 0.01
+           leader_change foo 2 30000 10000
+           leader_flap foo 3 5000 10001
+
+         The first line specifies that for topic "foo", partition 1, an error
+         ACK with value 7 will be returned for a randomly chosen 1% of message
+         sets.  The second line specifies that 30000 milliseconds after the
+         server starts, leadership of partition 2 moves to the broker on port
+         10000.  The third line specifies that leadership of partition 3
+         alternates between its initial broker and the broker on port 10001
+         every 5000 milliseconds.  Metadata responses report the current
+         leader of each partition, and message sets sent to any other broker
+         get an error ACK with value 6 (not leader for partition).  Multiple
+         'leader_change' lines for a partition must be in increasing time
+         order.
        */
       void Get(const std::string &setup_file_path, TInfo &out);
 
@@ -172,9 +253,27 @@ namespace Dory {
 
       void GetPortLines(std::istream &in);
 
+      void GetPortLine();
+
+      void GetPortAckLatencyLine();
+
+      void GetPortBandwidthLine();
+
+      size_t GetPortOffset(const std::string &token, const char *line_type);
+
       void GetTopicLines(std::istream &in);
 
-      void GetPartitionErrorLines(std::istream &in);
+      void GetPartitionLines(std::istream &in);
+
+      TPartition &GetPartitionInfo(const char *line_type);
+
+      void GetPartitionErrorLine();
+
+      void GetPartitionErrorRateLine();
+
+      void GetLeaderChangeLine();
+
+      void GetLeaderFlapLine();
 
       void FillResult(std::istream &in);
 
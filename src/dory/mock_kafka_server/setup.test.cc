@@ -161,6 +161,107 @@ namespace {
     ASSERT_EQ(topic.Partitions[3].AckErrorInterval, 101U);
   }
 
+  TEST_F(TSetupTest, Test3) {
+    TTmpFile tmp_file;
+    tmp_file.SetDeleteOnDestroy(true);
+    std::ofstream ofs(tmp_file.GetName());
+    ofs << "ports 10000 3" << std::endl
+        << "port_ack_latency 10001 longtail:2000:50000" << std::endl
+        << "port 10002 read_delay 5001:101 ack_delay 6001:51" << std::endl
+        << "port_bandwidth 10002 1048576" << std::endl
+        << "topic foo 4 1" << std::endl
+        << "partition_error_rate foo 1 7 0.25" << std::endl
+        << "leader_change foo 2 1000 10000" << std::endl
+        << "partition_error foo 3 6 101" << std::endl
+        << "leader_change foo 2 2000 10001" << std::endl
+        << "leader_flap foo 3 500 10000" << std::endl;
+    ofs.close();
+    TSetup::TInfo info;
+    std::string filename(tmp_file.GetName());
+    bool threw = false;
+
+    try {
+      TSetup().Get(filename, info);
+    } catch (const std::exception &x) {
+      threw = true;
+    }
+
+    ASSERT_FALSE(threw);
+    ASSERT_EQ(info.Ports.size(), 3U);
+    ASSERT_TRUE(info.Ports[0].AckLatency.IsNone());
+    ASSERT_EQ(info.Ports[0].Bandwidth, 0U);
+    ASSERT_EQ(info.Ports[1].AckLatency.ToString(), "longtail:2000:50000");
+    ASSERT_EQ(info.Ports[2].ReadDelay, 5001U);
+    ASSERT_EQ(info.Ports[2].Bandwidth, 1048576U);
+
+    auto iter = info.Topics.find("foo");
+    ASSERT_TRUE(iter != info.Topics.end());
+    const TSetup::TTopic &topic = iter->second;
+    ASSERT_EQ(topic.Partitions.size(), 4U);
+    ASSERT_EQ(topic.Partitions[1].RandomAckError, 7);
+    ASSERT_EQ(topic.Partitions[1].RandomAckErrorRate, 0.25);
+    ASSERT_EQ(topic.Partitions[2].LeaderChanges.size(), 2U);
+    ASSERT_EQ(topic.Partitions[3].AckError, 6);
+    ASSERT_EQ(topic.Partitions[3].AckErrorInterval, 101U);
+
+    /* Partition 0 never moves. */
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 0, 0), 1U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 0, 5000), 1U);
+
+    /* Partition 2 starts at port offset 0, moves to offset 0 at 1 second
+       (no change), then moves to offset 1 at 2 seconds. */
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 2, 0), 0U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 2, 1500), 0U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 2, 1999), 0U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 2, 2000), 1U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 2, 100000), 1U);
+
+    /* Partition 3 alternates between port offsets 1 and 0. */
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 3, 0), 1U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 3, 499), 1U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 3, 500), 0U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 3, 999), 0U);
+    ASSERT_EQ(info.GetLeaderPortOffset(topic, 3, 1000), 1U);
+  }
+
+  TEST_F(TSetupTest, BadLines) {
+    const char *bad_lines[] = {
+      "port_ack_latency 10000 bogus:5",
+      "port_ack_latency 10003 fixed:5",
+      "port_bandwidth 10000 fast",
+      "topic foo 4 1\npartition_error_rate foo 1 7 1.5",
+      "topic foo 4 1\npartition_error_rate foo 4 7 0.5",
+      "topic foo 4 1\nleader_change bar 1 1000 10000",
+      "topic foo 4 1\nleader_change foo 1 1000 10000\n"
+          "leader_change foo 1 1000 10001",
+      "topic foo 4 1\nleader_flap foo 1 0 10000",
+      "topic foo 4 1\nleader_flap foo 1 100 9999"
+    };
+
+    for (const char *lines : bad_lines) {
+      TTmpFile tmp_file;
+      tmp_file.SetDeleteOnDestroy(true);
+      std::ofstream ofs(tmp_file.GetName());
+      ofs << "ports 10000 3" << std::endl << lines << std::endl;
+
+      if (std::string(lines).find("topic") == std::string::npos) {
+        ofs << "topic foo 4 1" << std::endl;
+      }
+
+      ofs.close();
+      TSetup::TInfo info;
+      bool threw = false;
+
+      try {
+        TSetup().Get(tmp_file.GetName(), info);
+      } catch (const TSetup::TFileFormatError &) {
+        threw = true;
+      }
+
+      ASSERT_TRUE(threw) << lines;
+    }
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
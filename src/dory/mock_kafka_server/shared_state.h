@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -30,6 +32,7 @@
 #include <dory/mock_kafka_server/mock_kafka_worker.h>
 #include <dory/mock_kafka_server/received_request_tracker.h>
 #include <dory/mock_kafka_server/setup.h>
+#include <dory/mock_kafka_server/sink_stats.h>
 #include <dory/mock_kafka_server/thread_terminate_handler.h>
 #include <fiber/dispatcher.h>
 
@@ -57,6 +60,9 @@ namespace Dory {
 
       TSetup::TInfo Setup;
 
+      /* Scheduled leadership changes in 'Setup' are relative to this. */
+      const std::chrono::steady_clock::time_point StartTime;
+
       /* This must appear before ConnectHandlers, since all connection handlers
          must be destroyed before the dispatcher. */
       std::unique_ptr<Fiber::TDispatcher> Dispatcher;
@@ -72,9 +78,20 @@ namespace Dory {
          unit test code removes items. */
       TReceivedRequestTracker ReceivedRequests;
 
+      /* Counters updated by broker threads in sink mode. */
+      TSinkStats SinkStats;
+
       TSharedState(const TConfig &config, bool track_received_requests)
           : Config(config),
-            TrackReceivedRequests(track_received_requests) {
+            TrackReceivedRequests(track_received_requests),
+            StartTime(std::chrono::steady_clock::now()) {
+      }
+
+      /* Return the number of milliseconds since the server started. */
+      uint64_t GetElapsedMs() const {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - StartTime).count());
       }
 
     };  // TSharedState
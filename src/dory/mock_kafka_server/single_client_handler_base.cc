@@ -21,8 +21,10 @@
 
 #include <dory/mock_kafka_server/single_client_handler_base.h>
 
+#include <chrono>
 #include <iostream>
 #include <limits>
+#include <thread>
 
 #include <boost/lexical_cast.hpp>
 #include <sys/syscall.h>
@@ -89,6 +91,10 @@ const char *TSingleClientHandlerBase::ActionToString(TAction action) {
       ret = "unkn";
       break;
     }
+    case TAction::RejectNotLeader: {
+      ret = "nldr";
+      break;
+    }
     case TAction::InjectError1: {
       ret = "inj1";
       break;
@@ -97,6 +103,10 @@ const char *TSingleClientHandlerBase::ActionToString(TAction action) {
       ret = "inj2";
       break;
     }
+    case TAction::InjectRandomError: {
+      ret = "rand";
+      break;
+    }
     case TAction::Respond: {
       ret = "resp";
       break;
@@ -426,11 +436,15 @@ TSingleClientHandlerBase::ChooseMsgSetAction(const TMsgSet &msg_set,
   }
 
   TAction action = TAction::Respond;
-  const TSetup::TPartition *part = FindPartition(topic, partition);
+  bool is_leader = false;
+  const TSetup::TPartition *part = FindPartition(topic, partition, is_leader);
 
   if (part == nullptr) {
     ack_error = 3;  // unknown topic or partition
     action = TAction::RejectBadDest;
+  } else if (!is_leader) {
+    ack_error = 6;  // not leader for partition
+    action = TAction::RejectNotLeader;
   } else if (disconnect) {
     action = TAction::InjectDisconnect;
   } else {
@@ -440,6 +454,10 @@ TSingleClientHandlerBase::ChooseMsgSetAction(const TMsgSet &msg_set,
                ((MsgSetCount % part->AckErrorInterval) == 0)) {
       ack_error = part->AckError;
       action = TAction::InjectError2;
+    } else if (part->RandomAckError &&
+               (NextUnitRandom(RandState) <= part->RandomAckErrorRate)) {
+      ack_error = part->RandomAckError;
+      action = TAction::InjectRandomError;
     }
   }
 
@@ -559,6 +577,12 @@ bool TSingleClientHandlerBase::PrepareProduceResponse(const TProdReq &prod_req,
     if (GetShutdownRequestFd().IsReadable(total_delay)) {
       return false;
     }
+  } else {
+    const TLatencyDist &latency = Setup.Ports[PortOffset].AckLatency;
+
+    if (!latency.IsNone() && !SleepMicroseconds(latency.Choose(RandState))) {
+      return false;
+    }
   }
 
   return true;
@@ -710,8 +734,9 @@ bool TSingleClientHandlerBase::HandleMetadataRequest() {
 }
 
 const TSetup::TPartition *TSingleClientHandlerBase::FindPartition(
-    const std::string &topic, int32_t partition) const {
+    const std::string &topic, int32_t partition, bool &is_leader) const {
   assert(this);
+  is_leader = false;
   auto iter = Setup.Topics.find(topic);
 
   if (iter == Setup.Topics.end()) {
@@ -720,18 +745,45 @@ const TSetup::TPartition *TSingleClientHandlerBase::FindPartition(
 
   const TSetup::TTopic &t = iter->second;
 
-  if (static_cast<size_t>(partition) >= t.Partitions.size()) {
+  if ((partition < 0) ||
+      (static_cast<size_t>(partition) >= t.Partitions.size())) {
     return nullptr;
   }
 
-  size_t topic_port_offset =
-      (t.FirstPortOffset + partition) % Setup.Ports.size();
+  /* The partition may be led by a different "broker". */
+  is_leader = (Setup.GetLeaderPortOffset(t, partition, Ss.GetElapsedMs()) ==
+      PortOffset);
+  return &t.Partitions[partition];
+}
+
+bool TSingleClientHandlerBase::SleepMicroseconds(uint64_t microseconds) {
+  assert(this);
+  const TFd &shutdown_request_fd = GetShutdownRequestFd();
+
+  /* Poll with millisecond resolution so a shutdown request can interrupt a
+     long sleep, then sleep for the rest. */
+  if ((microseconds >= 1000) &&
+      shutdown_request_fd.IsReadable(static_cast<int>(microseconds / 1000))) {
+    return false;
+  }
+
+  std::this_thread::sleep_for(
+      std::chrono::microseconds(microseconds % 1000));
+  return !shutdown_request_fd.IsReadable();
+}
+
+bool TSingleClientHandlerBase::ThrottleReads() {
+  assert(this);
 
-  if (topic_port_offset != PortOffset) {
-    return nullptr;  // this partition lives on a different "broker"
+  if (!ReadLimiter.IsLimited()) {
+    return true;
   }
 
-  return &t.Partitions[partition];
+  uint64_t now = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+  uint64_t resume = ReadLimiter.Consume(InputBuf.size(), now);
+  return (resume <= now) || SleepMicroseconds(resume - now);
 }
 
 void TSingleClientHandlerBase::DoRun() {
@@ -772,7 +824,7 @@ void TSingleClientHandlerBase::DoRun() {
       NO_DEFAULT_CASE;
     }
 
-    if (done) {
+    if (done || !ThrottleReads()) {
       break;
     }
 
@@ -36,12 +36,14 @@
 #include <dory/kafka_proto/produce/msg_set_reader_api.h>
 #include <dory/kafka_proto/produce/produce_request_reader_api.h>
 #include <dory/kafka_proto/produce/produce_response_writer_api.h>
+#include <dory/mock_kafka_server/bandwidth_limiter.h>
 #include <dory/mock_kafka_server/config.h>
 #include <dory/mock_kafka_server/mock_kafka_worker.h>
 #include <dory/mock_kafka_server/port_map.h>
 #include <dory/mock_kafka_server/prod_req/msg_set.h>
 #include <dory/mock_kafka_server/prod_req/prod_req.h>
 #include <dory/mock_kafka_server/prod_req/prod_req_builder.h>
+#include <dory/mock_kafka_server/random.h>
 #include <dory/mock_kafka_server/received_request_tracker.h>
 #include <dory/mock_kafka_server/setup.h>
 #include <dory/mock_kafka_server/shared_state.h>
@@ -100,7 +102,9 @@ namespace Dory {
             ProduceRequestCount(0),
             MetadataRequestCount(0),
             MsgSetCount(0),
-            MsgCount(0) {
+            MsgCount(0),
+            RandState(InitRandomState(port_offset)),
+            ReadLimiter(setup.Ports[port_offset].Bandwidth) {
         assert(PortOffset < Setup.Ports.size());
       }
 
@@ -130,8 +134,10 @@ namespace Dory {
         InjectDisconnect,
         DisconnectOnError,
         RejectBadDest,
+        RejectNotLeader,
         InjectError1,
         InjectError2,
+        InjectRandomError,
         Respond
       };  // TAction
 
@@ -187,8 +193,19 @@ namespace Dory {
 
       bool HandleMetadataRequest();
 
+      /* Return the setup info for the given partition, or nullptr if it
+         doesn't exist.  On return, 'is_leader' indicates whether this broker
+         currently leads the partition. */
       const TSetup::TPartition *FindPartition(const std::string &topic,
-          int32_t partition) const;
+          int32_t partition, bool &is_leader) const;
+
+      /* Sleep for 'microseconds', returning false if interrupted by a
+         shutdown request. */
+      bool SleepMicroseconds(uint64_t microseconds);
+
+      /* Limit the rate at which requests are read, if configured.  Returns
+         false if interrupted by a shutdown request. */
+      bool ThrottleReads();
 
       void DoRun();
 
@@ -205,6 +222,11 @@ namespace Dory {
       TMetadataRequest MetadataRequest;
 
       std::vector<uint8_t> OutputBuf;
+
+      /* For random ACK latency and random error ACKs. */
+      uint64_t RandState;
+
+      TBandwidthLimiter ReadLimiter;
     };  // TSingleClientHandlerBase
 
   }  // MockKafkaServer
@@ -0,0 +1,576 @@
+/* <dory/mock_kafka_server/sink_broker.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/mock_kafka_server/sink_broker.h>.
+ */
+
+#include <dory/mock_kafka_server/sink_broker.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/field_access.h>
+#include <base/opt.h>
+#include <dory/kafka_proto/metadata/v0/metadata_request_reader.h>
+#include <dory/mock_kafka_server/prod_req/prod_req.h>
+#include <dory/mock_kafka_server/prod_req/prod_req_builder.h>
+#include <dory/mock_kafka_server/random.h>
+#include <dory/mock_kafka_server/v0_metadata_response.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::KafkaProto::Metadata::V0;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::MockKafkaServer;
+using namespace Dory::MockKafkaServer::ProdReq;
+
+/* Amount of free buffer space to offer each read from a client. */
+static const size_t READ_CHUNK_SIZE = 1024 * 1024;
+
+static const size_t MAX_EVENTS = 64;
+
+static uint64_t GetMonotonicMicroseconds() {
+  struct timespec ts;
+  IfLt0(clock_gettime(CLOCK_MONOTONIC, &ts));
+  return (static_cast<uint64_t>(ts.tv_sec) * 1000000) +
+      (static_cast<uint64_t>(ts.tv_nsec) / 1000);
+}
+
+TSinkBroker::TSinkBroker(TSharedState &ss, const TPortMap &port_map,
+    size_t port_offset, const TFd &listen_fd)
+    : Ss(ss),
+      PortMap(port_map),
+      PortOffset(port_offset),
+      ListenFd(listen_fd),
+      EventBuf(MAX_EVENTS),
+      RandState(InitRandomState(port_offset)),
+      ProduceRequestCount(0),
+      MsgSetCount(0) {
+}
+
+TSinkBroker::~TSinkBroker() noexcept {
+  /* This will shut down the thread if something unexpected happens. */
+  ShutdownOnDestroy();
+}
+
+void TSinkBroker::Run() {
+  assert(this);
+  Epoll = IfLt0(epoll_create1(EPOLL_CLOEXEC));
+  Timer = IfLt0(timerfd_create(CLOCK_MONOTONIC,
+      TFD_NONBLOCK | TFD_CLOEXEC));
+
+  for (int fd : { static_cast<int>(GetShutdownRequestFd()),
+                  static_cast<int>(ListenFd), static_cast<int>(Timer) }) {
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    IfLt0(epoll_ctl(Epoll, EPOLL_CTL_ADD, fd, &event));
+  }
+
+  for (; ; ) {
+    int count = epoll_wait(Epoll, &EventBuf[0], EventBuf.size(), -1);
+
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      IfLt0(count);  // this will throw
+    }
+
+    uint64_t now = GetMonotonicMicroseconds();
+
+    for (int i = 0; i < count; ++i) {
+      const epoll_event &event = EventBuf[i];
+      int fd = event.data.fd;
+
+      if (fd == GetShutdownRequestFd()) {
+        Conns.clear();
+        return;
+      }
+
+      if (fd == ListenFd) {
+        AcceptConns();
+        continue;
+      }
+
+      if (fd == Timer) {
+        uint64_t expirations = 0;
+
+        if (read(Timer, &expirations, sizeof(expirations)) < 0) {
+          if (errno != EAGAIN) {
+            IfLt0(-1);  // this will throw
+          }
+        }
+
+        /* Send responses whose delays have expired, and resume reading
+           from connections whose bandwidth limits allow it. */
+        for (auto iter = Conns.begin(); iter != Conns.end(); ) {
+          TConn &conn = *iter->second;
+          ++iter;
+
+          if (!FlushOutput(conn, now)) {
+            CloseConn(conn.Sock);
+          }
+        }
+
+        continue;
+      }
+
+      auto iter = Conns.find(fd);
+
+      if (iter == Conns.end()) {
+        continue;  // connection closed while handling an earlier event
+      }
+
+      TConn &conn = *iter->second;
+      bool ok = true;
+
+      if (event.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        ok = HandleReadable(conn, now);
+      }
+
+      if (ok) {
+        ok = FlushOutput(conn, now);
+      }
+
+      if (!ok) {
+        CloseConn(fd);
+      }
+    }
+
+    ArmTimer(now);
+  }
+}
+
+void TSinkBroker::AcceptConns() {
+  assert(this);
+
+  /* The listening socket is blocking, so accept only the one connection that
+     epoll told us about. */
+  int fd = accept4(ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+  if (fd < 0) {
+    if ((errno == EINTR) || (errno == ECONNABORTED)) {
+      return;
+    }
+
+    IfLt0(fd);  // this will throw
+  }
+
+  std::unique_ptr<TConn> conn(new TConn(TFd(fd),
+      Ss.Setup.Ports[PortOffset].Bandwidth));
+  conn->Events = EPOLLIN;
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = conn->Events;
+  event.data.fd = fd;
+  IfLt0(epoll_ctl(Epoll, EPOLL_CTL_ADD, fd, &event));
+  Conns[fd] = std::move(conn);
+}
+
+void TSinkBroker::CloseConn(int fd) {
+  assert(this);
+
+  /* Closing the socket removes it from the epoll set. */
+  Conns.erase(fd);
+}
+
+bool TSinkBroker::HandleReadable(TConn &conn, uint64_t now) {
+  assert(this);
+  size_t read_size = conn.Limiter.IsLimited() ?
+      std::min(conn.Limiter.GetMaxReadSize(), READ_CHUNK_SIZE) :
+      READ_CHUNK_SIZE;
+
+  if (conn.InBuf.size() < (conn.InUsed + read_size)) {
+    conn.InBuf.resize(conn.InUsed + read_size);
+  }
+
+  ssize_t ret = recv(conn.Sock, &conn.InBuf[conn.InUsed], read_size,
+      MSG_DONTWAIT);
+
+  if (ret < 0) {
+    return (errno == EAGAIN) || (errno == EINTR);
+  }
+
+  if (ret == 0) {
+    return false;  // client disconnected
+  }
+
+  conn.InUsed += static_cast<size_t>(ret);
+  Ss.SinkStats.Bytes += static_cast<uint64_t>(ret);
+  conn.ReadResumeTime = conn.Limiter.Consume(static_cast<size_t>(ret), now);
+  size_t offset = 0;
+
+  /* Handle all complete requests in the buffer. */
+  while ((conn.InUsed - offset) >= 6) {
+    const uint8_t *request = &conn.InBuf[offset];
+    int32_t size_field = ReadInt32FromHeader(request);
+
+    if ((size_field < 2) ||
+        (size_field > (std::numeric_limits<int32_t>::max() - 4))) {
+      ++Ss.SinkStats.BadRequests;
+      return false;
+    }
+
+    size_t request_size = 4 + static_cast<size_t>(size_field);
+
+    if ((conn.InUsed - offset) < request_size) {
+      break;
+    }
+
+    if (!HandleRequest(conn, request, request_size)) {
+      return false;
+    }
+
+    offset += request_size;
+  }
+
+  /* Move any partial request to the front of the buffer. */
+  if (offset) {
+    std::memmove(&conn.InBuf[0], &conn.InBuf[offset], conn.InUsed - offset);
+    conn.InUsed -= offset;
+  }
+
+  return true;
+}
+
+bool TSinkBroker::HandleRequest(TConn &conn, const uint8_t *request,
+    size_t request_size) {
+  assert(this);
+
+  switch (ReadInt16FromHeader(request + 4)) {
+    case 0: {
+      return HandleProduceRequest(conn, request, request_size);
+    }
+    case 3: {
+      return HandleMetadataRequest(conn, request, request_size);
+    }
+    default: {
+      break;
+    }
+  }
+
+  ++Ss.SinkStats.BadRequests;
+  return false;
+}
+
+bool TSinkBroker::HandleProduceRequest(TConn &conn, const uint8_t *request,
+    size_t request_size) {
+  assert(this);
+  ++ProduceRequestCount;
+  ++Ss.SinkStats.ProduceRequests;
+  AckErrors.clear();
+  int16_t required_acks = 0;
+  std::string topic;
+  uint64_t elapsed_ms = Ss.GetElapsedMs();
+
+  try {
+    RequestReader.SetRequest(request, request_size);
+    required_acks = RequestReader.GetRequiredAcks();
+    ResponseWriter.OpenResponse(ResponseBuf,
+        RequestReader.GetCorrelationId());
+
+    for (bool more_topics = RequestReader.FirstTopic();
+         more_topics;
+         more_topics = RequestReader.NextTopic()) {
+      const char *topic_begin = RequestReader.GetCurrentTopicNameBegin();
+      const char *topic_end = RequestReader.GetCurrentTopicNameEnd();
+      topic.assign(topic_begin, topic_end);
+      auto topic_iter = Ss.Setup.Topics.find(topic);
+      const TSetup::TTopic *t = (topic_iter == Ss.Setup.Topics.end()) ?
+          nullptr : &topic_iter->second;
+      ResponseWriter.OpenTopic(topic_begin, topic_end);
+
+      for (bool more_msg_sets = RequestReader.FirstMsgSetInTopic();
+           more_msg_sets;
+           more_msg_sets = RequestReader.NextMsgSetInTopic()) {
+        ++MsgSetCount;
+        int32_t partition = RequestReader.GetPartitionOfCurrentMsgSet();
+        size_t msg_count = 0;
+        bool crc_ok = true;
+
+        for (bool more_msgs = RequestReader.FirstMsgInMsgSet();
+             more_msgs;
+             more_msgs = RequestReader.NextMsgInMsgSet()) {
+          ++msg_count;
+          crc_ok = crc_ok && RequestReader.CurrentMsgCrcIsOk();
+        }
+
+        int16_t ack_error = 0;
+
+        if ((t == nullptr) || (partition < 0) ||
+            (static_cast<size_t>(partition) >= t->Partitions.size())) {
+          ack_error = 3;  // unknown topic or partition
+        } else if (Ss.Setup.GetLeaderPortOffset(*t, partition, elapsed_ms) !=
+            PortOffset) {
+          ack_error = 6;  // not leader for partition
+        } else if (!crc_ok) {
+          ack_error = 2;  // corrupt message
+          ++Ss.SinkStats.CrcErrors;
+        } else {
+          const TSetup::TPartition &part = t->Partitions[partition];
+
+          if (part.AckError &&
+              ((MsgSetCount % part.AckErrorInterval) == 0)) {
+            ack_error = part.AckError;
+          } else if (part.RandomAckError &&
+              (NextUnitRandom(RandState) <= part.RandomAckErrorRate)) {
+            ack_error = part.RandomAckError;
+          }
+        }
+
+        ResponseWriter.AddPartition(partition, ack_error, 0);
+        AckErrors.push_back(ack_error);
+        ++Ss.SinkStats.MsgSets;
+        Ss.SinkStats.Msgs += msg_count;
+      }
+
+      ResponseWriter.CloseTopic();
+    }
+
+    ResponseWriter.CloseResponse();
+  } catch (const TProduceRequestReaderApi::TBadProduceRequest &x) {
+    ++Ss.SinkStats.BadRequests;
+    syslog(LOG_ERR, "Sink broker got bad produce request: %s", x.what());
+    ResponseWriter.Reset();
+    return false;
+  }
+
+  const TConfig &config = Ss.Config;
+
+  if (config.SinkSampleInterval && Ss.TrackReceivedRequests &&
+      ((ProduceRequestCount % config.SinkSampleInterval) == 0)) {
+    SampleDecode(request, request_size, AckErrors);
+  }
+
+  if (required_acks != 0) {
+    /* A latency distribution for this port overrides the global one. */
+    const TLatencyDist &port_latency = Ss.Setup.Ports[PortOffset].AckLatency;
+    const TLatencyDist &latency = port_latency.IsNone() ?
+        config.SinkAckDelay : port_latency;
+    QueueResponse(conn, latency.Choose(RandState));
+  }
+
+  return true;
+}
+
+bool TSinkBroker::HandleMetadataRequest(TConn &conn, const uint8_t *request,
+    size_t request_size) {
+  assert(this);
+  ++Ss.SinkStats.MetadataRequests;
+  TReceivedRequestTracker::TRequestInfo info;
+  info.MetadataRequestInfo.MakeKnown();
+  std::string &topic = info.MetadataRequestInfo->Topic;
+  int32_t correlation_id = 0;
+
+  try {
+    TMetadataRequestReader reader(request, request_size);
+    correlation_id = reader.GetCorrelationId();
+
+    /* A request for a list of topics gets metadata for all topics. */
+    if (reader.GetTopicCount() == 1) {
+      topic.assign(reader.GetTopicBegin(), reader.GetTopicEnd());
+    }
+  } catch (const std::runtime_error &x) {
+    ++Ss.SinkStats.BadRequests;
+    syslog(LOG_ERR, "Sink broker got bad metadata request: %s", x.what());
+    return false;
+  }
+
+  WriteV0MetadataResponse(Ss.Setup, PortMap, Ss.GetElapsedMs(),
+      correlation_id, topic, std::string(), 0, ResponseBuf);
+
+  if (Ss.TrackReceivedRequests) {
+    Ss.ReceivedRequests.PutRequestInfo(std::move(info));
+  }
+
+  QueueResponse(conn, 0);
+  return true;
+}
+
+void TSinkBroker::SampleDecode(const uint8_t *request, size_t request_size,
+    const std::vector<int16_t> &ack_errors) {
+  assert(this);
+  TOpt<TProdReq> prod_req;
+
+  try {
+    prod_req.MakeKnown(TProdReqBuilder(RequestReader, MsgSetReader)
+        .BuildProdReq(request, request_size));
+  } catch (const TProduceRequestReaderApi::TBadProduceRequest &x) {
+    /* The request passed validation, so this is a decompression failure. */
+    syslog(LOG_ERR, "Sink broker failed to decode sampled produce request: "
+        "%s", x.what());
+    return;
+  } catch (const TMsgSetReaderApi::TBadMsgSet &x) {
+    syslog(LOG_ERR, "Sink broker failed to decode sampled produce request: "
+        "%s", x.what());
+    return;
+  }
+
+  size_t i = 0;
+
+  for (const TTopicGroup &topic_group : prod_req->GetTopicGroupVec()) {
+    for (const TMsgSet &msg_set : topic_group.GetMsgSetVec()) {
+      TReceivedRequestTracker::TRequestInfo info;
+      info.ProduceRequestInfo.MakeKnown();
+      TReceivedRequestTracker::TProduceRequestInfo &produce_info =
+          *info.ProduceRequestInfo;
+      produce_info.Topic = topic_group.GetTopic();
+      produce_info.Partition = msg_set.GetPartition();
+      produce_info.CompressionType = msg_set.GetCompressionType();
+      const std::vector<TMsg> &msg_vec = msg_set.GetMsgVec();
+      produce_info.MsgCount = msg_vec.size();
+      produce_info.ReturnedErrorCode =
+          (i < ack_errors.size()) ? ack_errors[i] : 0;
+      ++i;
+
+      if (!msg_vec.empty()) {
+        produce_info.FirstMsgKey = msg_vec.front().GetKey();
+        produce_info.FirstMsgValue = msg_vec.front().GetValue();
+      }
+
+      Ss.ReceivedRequests.PutRequestInfo(std::move(info));
+    }
+  }
+}
+
+void TSinkBroker::QueueResponse(TConn &conn, uint64_t delay) {
+  assert(this);
+
+  if (conn.Pending.empty() && (delay == 0)) {
+    conn.OutBuf.insert(conn.OutBuf.end(), ResponseBuf.begin(),
+        ResponseBuf.end());
+    return;
+  }
+
+  uint64_t due = GetMonotonicMicroseconds() + delay;
+
+  if (!conn.Pending.empty()) {
+    due = std::max(due, conn.Pending.back().Due);
+  }
+
+  conn.Pending.push_back(TPendingResponse());
+  TPendingResponse &pending = conn.Pending.back();
+  pending.Due = due;
+  pending.Data.swap(ResponseBuf);
+}
+
+bool TSinkBroker::FlushOutput(TConn &conn, uint64_t now) {
+  assert(this);
+
+  while (!conn.Pending.empty() && (conn.Pending.front().Due <= now)) {
+    const std::vector<uint8_t> &data = conn.Pending.front().Data;
+    conn.OutBuf.insert(conn.OutBuf.end(), data.begin(), data.end());
+    conn.Pending.pop_front();
+  }
+
+  while (conn.OutOffset < conn.OutBuf.size()) {
+    ssize_t ret = send(conn.Sock, &conn.OutBuf[conn.OutOffset],
+        conn.OutBuf.size() - conn.OutOffset, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno == EAGAIN) {
+        break;
+      }
+
+      return false;
+    }
+
+    conn.OutOffset += static_cast<size_t>(ret);
+  }
+
+  if (conn.OutOffset == conn.OutBuf.size()) {
+    conn.OutBuf.clear();
+    conn.OutOffset = 0;
+  }
+
+  UpdateEvents(conn, now);
+  return true;
+}
+
+void TSinkBroker::UpdateEvents(TConn &conn, uint64_t now) {
+  assert(this);
+
+  /* Stop reading while the connection's bandwidth limit is exceeded. */
+  uint32_t events = 0;
+
+  if (conn.ReadResumeTime <= now) {
+    events |= EPOLLIN;
+  }
+
+  if (conn.OutOffset < conn.OutBuf.size()) {
+    events |= EPOLLOUT;
+  }
+
+  if (events != conn.Events) {
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = conn.Sock;
+    IfLt0(epoll_ctl(Epoll, EPOLL_CTL_MOD, conn.Sock, &event));
+    conn.Events = events;
+  }
+}
+
+void TSinkBroker::ArmTimer(uint64_t now) {
+  assert(this);
+  uint64_t earliest = 0;
+
+  for (const auto &item : Conns) {
+    const TConn &conn = *item.second;
+
+    if (!conn.Pending.empty() &&
+        ((earliest == 0) || (conn.Pending.front().Due < earliest))) {
+      earliest = conn.Pending.front().Due;
+    }
+
+    if ((conn.ReadResumeTime > now) &&
+        ((earliest == 0) || (conn.ReadResumeTime < earliest))) {
+      earliest = conn.ReadResumeTime;
+    }
+  }
+
+  /* An all-zero value disarms the timer. */
+  itimerspec spec;
+  std::memset(&spec, 0, sizeof(spec));
+
+  if (earliest) {
+    spec.it_value.tv_sec = static_cast<time_t>(earliest / 1000000);
+    spec.it_value.tv_nsec = static_cast<long>((earliest % 1000000) * 1000);
+  }
+
+  IfLt0(timerfd_settime(Timer, TFD_TIMER_ABSTIME, &spec, nullptr));
+}
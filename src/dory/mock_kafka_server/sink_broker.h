@@ -0,0 +1,185 @@
+/* <dory/mock_kafka_server/sink_broker.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Simulated broker for the mock Kafka server's sink mode.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+#include <dory/kafka_proto/produce/v0/msg_set_reader.h>
+#include <dory/kafka_proto/produce/v0/produce_request_reader.h>
+#include <dory/kafka_proto/produce/v0/produce_response_writer.h>
+#include <dory/mock_kafka_server/bandwidth_limiter.h>
+#include <dory/mock_kafka_server/port_map.h>
+#include <dory/mock_kafka_server/shared_state.h>
+#include <thread/fd_managed_thread.h>
+
+namespace Dory {
+
+  namespace MockKafkaServer {
+
+    /* Handles all client connections for one simulated broker port in a
+       single epoll loop.  Produce requests are checked only for valid framing
+       and message CRCs, and are then acknowledged, optionally after a random
+       delay.  Per-port latency and bandwidth limits, random error ACKs, and
+       scheduled leadership changes from the setup file are simulated.  One
+       of every N requests may be fully decoded and reported to the received
+       request tracker, so unit tests and benchmarks can still inspect message
+       contents. */
+    class TSinkBroker final : public Thread::TFdManagedThread {
+      NO_COPY_SEMANTICS(TSinkBroker);
+
+      public:
+      /* 'listen_fd' is a listening socket for the broker's port, which must
+         remain open until the thread has been joined. */
+      TSinkBroker(TSharedState &ss, const TPortMap &port_map,
+          size_t port_offset, const Base::TFd &listen_fd);
+
+      virtual ~TSinkBroker() noexcept;
+
+      protected:
+      virtual void Run() override;
+
+      private:
+      /* A response waiting for its simulated delay to expire. */
+      struct TPendingResponse {
+        /* CLOCK_MONOTONIC time in microseconds when response may be sent. */
+        uint64_t Due;
+
+        std::vector<uint8_t> Data;
+      };  // TPendingResponse
+
+      struct TConn {
+        Base::TFd Sock;
+
+        /* Bytes [0, InUsed) of InBuf hold data read from the client. */
+        std::vector<uint8_t> InBuf;
+
+        size_t InUsed;
+
+        /* Responses are sent in request order, so a response is never due
+           before the one queued ahead of it. */
+        std::deque<TPendingResponse> Pending;
+
+        /* Bytes [OutOffset, OutBuf.size()) are waiting to be written. */
+        std::vector<uint8_t> OutBuf;
+
+        size_t OutOffset;
+
+        /* Events currently registered with epoll. */
+        uint32_t Events;
+
+        TBandwidthLimiter Limiter;
+
+        /* CLOCK_MONOTONIC time in microseconds when reading may resume. */
+        uint64_t ReadResumeTime;
+
+        TConn(Base::TFd &&sock, size_t bandwidth)
+            : Sock(std::move(sock)),
+              InUsed(0),
+              OutOffset(0),
+              Events(0),
+              Limiter(bandwidth),
+              ReadResumeTime(0) {
+        }
+      };  // TConn
+
+      void AcceptConns();
+
+      void CloseConn(int fd);
+
+      /* Each of the methods below returns false if the connection should be
+         closed. */
+
+      bool HandleReadable(TConn &conn, uint64_t now);
+
+      bool HandleRequest(TConn &conn, const uint8_t *request,
+          size_t request_size);
+
+      bool HandleProduceRequest(TConn &conn, const uint8_t *request,
+          size_t request_size);
+
+      bool HandleMetadataRequest(TConn &conn, const uint8_t *request,
+          size_t request_size);
+
+      bool FlushOutput(TConn &conn, uint64_t now);
+
+      /* Fully decode a produce request and report its message sets to the
+         received request tracker.  'ack_errors' contains the error code
+         returned for each message set, in request order. */
+      void SampleDecode(const uint8_t *request, size_t request_size,
+          const std::vector<int16_t> &ack_errors);
+
+      void QueueResponse(TConn &conn, uint64_t delay);
+
+      void UpdateEvents(TConn &conn, uint64_t now);
+
+      /* Arm the timer for the earliest pending response or resumption of
+         reading, if any. */
+      void ArmTimer(uint64_t now);
+
+      TSharedState &Ss;
+
+      const TPortMap &PortMap;
+
+      const size_t PortOffset;
+
+      const Base::TFd &ListenFd;
+
+      Base::TFd Epoll;
+
+      Base::TFd Timer;
+
+      /* Key is socket FD. */
+      std::unordered_map<int, std::unique_ptr<TConn>> Conns;
+
+      KafkaProto::Produce::V0::TProduceRequestReader RequestReader;
+
+      KafkaProto::Produce::V0::TMsgSetReader MsgSetReader;
+
+      KafkaProto::Produce::V0::TProduceResponseWriter ResponseWriter;
+
+      /* Response currently being built. */
+      std::vector<uint8_t> ResponseBuf;
+
+      std::vector<int16_t> AckErrors;
+
+      std::vector<epoll_event> EventBuf;
+
+      uint64_t RandState;
+
+      size_t ProduceRequestCount;
+
+      size_t MsgSetCount;
+    };  // TSinkBroker
+
+  }  // MockKafkaServer
+
+}  // Dory
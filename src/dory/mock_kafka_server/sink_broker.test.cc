@@ -0,0 +1,311 @@
+/* <dory/mock_kafka_server/sink_broker.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/mock_kafka_server/sink_broker.h>.
+ */
+
+#include <dory/mock_kafka_server/sink_broker.h>
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/fd.h>
+#include <base/field_access.h>
+#include <base/io_utils.h>
+#include <base/tmp_dir.h>
+#include <base/tmp_file.h>
+#include <dory/compress/compression_type.h>
+#include <dory/kafka_proto/metadata/v0/metadata_request_writer.h>
+#include <dory/kafka_proto/metadata/v0/metadata_response_reader.h>
+#include <dory/kafka_proto/produce/v0/produce_request_writer.h>
+#include <dory/kafka_proto/produce/v0/produce_response_reader.h>
+#include <dory/mock_kafka_server/config.h>
+#include <dory/mock_kafka_server/main_thread.h>
+#include <dory/mock_kafka_server/received_request_tracker.h>
+#include <socket/address.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Compress;
+using namespace Dory::KafkaProto::Metadata::V0;
+using namespace Dory::KafkaProto::Produce::V0;
+using namespace Dory::MockKafkaServer;
+using namespace Socket;
+
+namespace {
+
+  /* Read a single size-prefixed response from 'sock'. */
+  static void ReadResponse(int sock, std::vector<uint8_t> &response) {
+    response.resize(4);
+    ReadExactly(sock, &response[0], 4, 30000);
+    size_t size = static_cast<size_t>(ReadInt32FromHeader(&response[0]));
+    response.resize(4 + size);
+    ReadExactly(sock, &response[4], size, 30000);
+  }
+
+  /* The fixture for testing class TSinkBroker. */
+  class TSinkBrokerTest : public ::testing::Test {
+    protected:
+    TSinkBrokerTest() {
+    }
+
+    virtual ~TSinkBrokerTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TSinkBrokerTest
+
+  TEST_F(TSinkBrokerTest, Test1) {
+    /* Partition 0 of topic "t1" is on the first port, and partition 1 is on
+       the second port. */
+    TTmpFile setup_file("/tmp/dory_tmp.XXXXXX", true);
+    std::string setup("ports 10000 2\ntopic t1 2 0\n");
+    IfLt0(write(setup_file.GetFd(), setup.data(), setup.size()));
+    TTmpDir output_dir("/tmp/dory_tmp.XXXXXX", true);
+    std::vector<const char *> args;
+    args.push_back("mock_kafka_server");
+    args.push_back("--output_dir");
+    args.push_back(output_dir.GetName());
+    args.push_back("--setup_file");
+    args.push_back(setup_file.GetName());
+    args.push_back("--sink");
+    args.push_back("--sink_sample");
+    args.push_back("1");
+    args.push_back("--sink_ack_delay");
+    args.push_back("fixed:1000");
+    args.push_back(nullptr);
+    TConfig config(args.size() - 1, const_cast<char **>(&args[0]));
+    TMainThread mock_kafka(config);
+    mock_kafka.Start();
+    ASSERT_TRUE(mock_kafka.GetInitWaitFd().IsReadable(30000));
+
+    TFd sock(IfLt0(socket(AF_INET, SOCK_STREAM, 0)));
+    Connect(sock, TAddress(TAddress::IPv4Loopback,
+        mock_kafka.VirtualPortToPhys(10000)));
+
+    /* A metadata request gets a normal response. */
+    std::string topic("t1");
+    std::vector<uint8_t> request;
+    TMetadataRequestWriter().WriteSingleTopicRequest(request, topic.data(),
+        topic.data() + topic.size(), 7);
+    WriteExactly(sock, &request[0], request.size());
+    std::vector<uint8_t> response;
+    ReadResponse(sock, response);
+    TMetadataResponseReader md_reader(&response[0], response.size());
+    ASSERT_EQ(md_reader.GetCorrelationId(), 7);
+    ASSERT_EQ(md_reader.GetBrokerCount(), 2U);
+    md_reader.SkipRemainingBrokers();
+    ASSERT_EQ(md_reader.GetTopicCount(), 1U);
+    ASSERT_TRUE(md_reader.FirstTopic());
+    ASSERT_EQ(md_reader.GetCurrentTopicErrorCode(), 0);
+    ASSERT_EQ(md_reader.GetCurrentTopicPartitionCount(), 2U);
+
+    /* Send one message to each partition.  The message for partition 1 is
+       sent to the wrong broker. */
+    std::string key("key");
+    std::string value("value");
+    const uint8_t *key_begin = reinterpret_cast<const uint8_t *>(key.data());
+    const uint8_t *value_begin =
+        reinterpret_cast<const uint8_t *>(value.data());
+    TProduceRequestWriter writer;
+    writer.OpenRequest(request, 8, nullptr, nullptr, 1, 1000);
+    writer.OpenTopic(topic.data(), topic.data() + topic.size());
+
+    for (int32_t partition = 0; partition < 2; ++partition) {
+      writer.OpenMsgSet(partition);
+      writer.AddMsg(TCompressionType::None, key_begin,
+          key_begin + key.size(), value_begin, value_begin + value.size());
+      writer.CloseMsgSet();
+    }
+
+    writer.CloseTopic();
+    writer.CloseRequest();
+    WriteExactly(sock, &request[0], request.size());
+    ReadResponse(sock, response);
+    TProduceResponseReader prod_reader;
+    prod_reader.SetResponse(&response[0], response.size());
+    ASSERT_EQ(prod_reader.GetCorrelationId(), 8);
+    ASSERT_TRUE(prod_reader.FirstTopic());
+    ASSERT_TRUE(prod_reader.FirstPartitionInTopic());
+    ASSERT_EQ(prod_reader.GetCurrentPartitionNumber(), 0);
+    ASSERT_EQ(prod_reader.GetCurrentPartitionErrorCode(), 0);
+    ASSERT_TRUE(prod_reader.NextPartitionInTopic());
+    ASSERT_EQ(prod_reader.GetCurrentPartitionNumber(), 1);
+    ASSERT_EQ(prod_reader.GetCurrentPartitionErrorCode(), 6);
+    ASSERT_FALSE(prod_reader.NextPartitionInTopic());
+
+    const TSinkStats &stats = mock_kafka.GetSinkStats();
+    ASSERT_EQ(stats.ProduceRequests, 1U);
+    ASSERT_EQ(stats.MetadataRequests, 1U);
+    ASSERT_EQ(stats.MsgSets, 2U);
+    ASSERT_EQ(stats.Msgs, 2U);
+    ASSERT_EQ(stats.CrcErrors, 0U);
+    ASSERT_EQ(stats.BadRequests, 0U);
+
+    /* With a sample interval of 1, each request is fully decoded and
+       reported. */
+    std::list<TReceivedRequestTracker::TRequestInfo> received;
+
+    while (received.size() < 3) {
+      std::list<TReceivedRequestTracker::TRequestInfo> more;
+      mock_kafka.GetHandledRequests(more);
+      received.splice(received.end(), more);
+    }
+
+    ASSERT_EQ(received.size(), 3U);
+    auto iter = received.begin();
+    ASSERT_TRUE(iter->MetadataRequestInfo.IsKnown());
+    ASSERT_EQ(iter->MetadataRequestInfo->Topic, topic);
+    ++iter;
+    ASSERT_TRUE(iter->ProduceRequestInfo.IsKnown());
+    ASSERT_EQ(iter->ProduceRequestInfo->Partition, 0);
+    ASSERT_EQ(iter->ProduceRequestInfo->MsgCount, 1U);
+    ASSERT_EQ(iter->ProduceRequestInfo->FirstMsgKey, key);
+    ASSERT_EQ(iter->ProduceRequestInfo->FirstMsgValue, value);
+    ASSERT_EQ(iter->ProduceRequestInfo->ReturnedErrorCode, 0);
+    ++iter;
+    ASSERT_TRUE(iter->ProduceRequestInfo.IsKnown());
+    ASSERT_EQ(iter->ProduceRequestInfo->Partition, 1);
+    ASSERT_EQ(iter->ProduceRequestInfo->ReturnedErrorCode, 6);
+
+    sock.Reset();
+    mock_kafka.RequestShutdown();
+    mock_kafka.Join();
+    ASSERT_TRUE(mock_kafka.ShutdownWasOk());
+  }
+
+  TEST_F(TSinkBrokerTest, Test2) {
+    /* Partition 0 of topic "t1" moves from the first broker to the second as
+       soon as the server starts.  Partition 1 always gets error ACKs. */
+    TTmpFile setup_file("/tmp/dory_tmp.XXXXXX", true);
+    std::string setup("ports 10000 2\n"
+        "port_ack_latency 10001 uniform:100:200\n"
+        "topic t1 2 0\n"
+        "leader_change t1 0 0 10001\n"
+        "partition_error_rate t1 1 7 1\n");
+    IfLt0(write(setup_file.GetFd(), setup.data(), setup.size()));
+    TTmpDir output_dir("/tmp/dory_tmp.XXXXXX", true);
+    std::vector<const char *> args;
+    args.push_back("mock_kafka_server");
+    args.push_back("--output_dir");
+    args.push_back(output_dir.GetName());
+    args.push_back("--setup_file");
+    args.push_back(setup_file.GetName());
+    args.push_back("--sink");
+    args.push_back(nullptr);
+    TConfig config(args.size() - 1, const_cast<char **>(&args[0]));
+    TMainThread mock_kafka(config);
+    mock_kafka.Start();
+    ASSERT_TRUE(mock_kafka.GetInitWaitFd().IsReadable(30000));
+
+    /* Metadata shows both partitions led by the second broker. */
+    TFd sock(IfLt0(socket(AF_INET, SOCK_STREAM, 0)));
+    Connect(sock, TAddress(TAddress::IPv4Loopback,
+        mock_kafka.VirtualPortToPhys(10000)));
+    std::string topic("t1");
+    std::vector<uint8_t> request;
+    TMetadataRequestWriter().WriteSingleTopicRequest(request, topic.data(),
+        topic.data() + topic.size(), 1);
+    WriteExactly(sock, &request[0], request.size());
+    std::vector<uint8_t> response;
+    ReadResponse(sock, response);
+    TMetadataResponseReader md_reader(&response[0], response.size());
+    md_reader.SkipRemainingBrokers();
+    ASSERT_TRUE(md_reader.FirstTopic());
+    ASSERT_TRUE(md_reader.FirstPartitionInTopic());
+    ASSERT_EQ(md_reader.GetCurrentPartitionId(), 0);
+    ASSERT_EQ(md_reader.GetCurrentPartitionLeaderId(), 1);
+    ASSERT_TRUE(md_reader.NextPartitionInTopic());
+    ASSERT_EQ(md_reader.GetCurrentPartitionId(), 1);
+    ASSERT_EQ(md_reader.GetCurrentPartitionLeaderId(), 1);
+
+    std::string value("value");
+    const uint8_t *value_begin =
+        reinterpret_cast<const uint8_t *>(value.data());
+    TProduceRequestWriter writer;
+    writer.OpenRequest(request, 2, nullptr, nullptr, 1, 1000);
+    writer.OpenTopic(topic.data(), topic.data() + topic.size());
+    writer.OpenMsgSet(0);
+    writer.AddMsg(TCompressionType::None, nullptr, nullptr, value_begin,
+        value_begin + value.size());
+    writer.CloseMsgSet();
+    writer.CloseTopic();
+    writer.CloseRequest();
+
+    /* The first broker is no longer the leader. */
+    WriteExactly(sock, &request[0], request.size());
+    ReadResponse(sock, response);
+    TProduceResponseReader prod_reader;
+    prod_reader.SetResponse(&response[0], response.size());
+    ASSERT_TRUE(prod_reader.FirstTopic());
+    ASSERT_TRUE(prod_reader.FirstPartitionInTopic());
+    ASSERT_EQ(prod_reader.GetCurrentPartitionErrorCode(), 6);
+
+    /* The second broker accepts the message. */
+    TFd sock2(IfLt0(socket(AF_INET, SOCK_STREAM, 0)));
+    Connect(sock2, TAddress(TAddress::IPv4Loopback,
+        mock_kafka.VirtualPortToPhys(10001)));
+    WriteExactly(sock2, &request[0], request.size());
+    ReadResponse(sock2, response);
+    prod_reader.SetResponse(&response[0], response.size());
+    ASSERT_TRUE(prod_reader.FirstTopic());
+    ASSERT_TRUE(prod_reader.FirstPartitionInTopic());
+    ASSERT_EQ(prod_reader.GetCurrentPartitionErrorCode(), 0);
+
+    /* Partition 1 gets a random error ACK every time. */
+    writer.OpenRequest(request, 3, nullptr, nullptr, 1, 1000);
+    writer.OpenTopic(topic.data(), topic.data() + topic.size());
+    writer.OpenMsgSet(1);
+    writer.AddMsg(TCompressionType::None, nullptr, nullptr, value_begin,
+        value_begin + value.size());
+    writer.CloseMsgSet();
+    writer.CloseTopic();
+    writer.CloseRequest();
+    WriteExactly(sock2, &request[0], request.size());
+    ReadResponse(sock2, response);
+    prod_reader.SetResponse(&response[0], response.size());
+    ASSERT_EQ(prod_reader.GetCorrelationId(), 3);
+    ASSERT_TRUE(prod_reader.FirstTopic());
+    ASSERT_TRUE(prod_reader.FirstPartitionInTopic());
+    ASSERT_EQ(prod_reader.GetCurrentPartitionErrorCode(), 7);
+
+    sock.Reset();
+    sock2.Reset();
+    mock_kafka.RequestShutdown();
+    mock_kafka.Join();
+    ASSERT_TRUE(mock_kafka.ShutdownWasOk());
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,70 @@
+/* <dory/mock_kafka_server/sink_stats.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Counters maintained by the mock Kafka server in sink mode.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  namespace MockKafkaServer {
+
+    /* Totals across all simulated brokers.  These are updated by the sink
+       broker threads, and may be read at any time by other threads. */
+    struct TSinkStats final {
+      NO_COPY_SEMANTICS(TSinkStats);
+
+      std::atomic<uint64_t> ProduceRequests;
+
+      std::atomic<uint64_t> MetadataRequests;
+
+      /* Total size of all requests received, including size fields. */
+      std::atomic<uint64_t> Bytes;
+
+      std::atomic<uint64_t> MsgSets;
+
+      /* Messages at the top level of each message set.  Sink mode does not
+         decompress, so a compressed message set counts as one message. */
+      std::atomic<uint64_t> Msgs;
+
+      /* Message sets that got an error ACK due to a bad CRC. */
+      std::atomic<uint64_t> CrcErrors;
+
+      /* Connections closed due to malformed or unknown requests. */
+      std::atomic<uint64_t> BadRequests;
+
+      TSinkStats()
+          : ProduceRequests(0),
+            MetadataRequests(0),
+            Bytes(0),
+            MsgSets(0),
+            Msgs(0),
+            CrcErrors(0),
+            BadRequests(0) {
+      }
+    };  // TSinkStats
+
+  }  // MockKafkaServer
+
+}  // Dory
@@ -22,16 +22,13 @@
 #include <dory/mock_kafka_server/v0_client_handler.h>
 
 #include <cstdlib>
-#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <string>
 
-#include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <unistd.h>
 
 #include <base/crc.h>
 #include <base/debug_log.h>
@@ -39,6 +36,7 @@
 #include <base/field_access.h>
 #include <base/io_utils.h>
 #include <base/no_default_case.h>
+#include <dory/mock_kafka_server/v0_metadata_response.h>
 #include <socket/address.h>
 
 using namespace Base;
@@ -88,7 +86,9 @@ bool TV0ClientHandler::ValidateMetadataRequest(
   assert(OptMetadataRequestReader.IsKnown());
   request.CorrelationId = OptMetadataRequestReader->GetCorrelationId();
 
-  if (OptMetadataRequestReader->IsAllTopics()) {
+  /* Answer a request for a list of topics with metadata for all topics.
+     Dory accepts extra topics in the response. */
+  if (OptMetadataRequestReader->GetTopicCount() != 1) {
     request.Topic.clear();
   } else {
     request.Topic.assign(OptMetadataRequestReader->GetTopicBegin(),
@@ -101,83 +101,31 @@ bool TV0ClientHandler::ValidateMetadataRequest(
 TSingleClientHandlerBase::TSendMetadataResult
 TV0ClientHandler::SendMetadataResponse(const TMetadataRequest &request,
     int16_t error, const std::string &error_topic, size_t delay) {
-  char host_name[1024];
-  IfLt0(gethostname(host_name, sizeof(host_name)));
-  size_t host_name_len = std::strlen(host_name);
-  const char *host_name_end = &host_name[host_name_len];
-  TMetadataResponseWriter writer;
-  writer.OpenResponse(MdResponseBuf, request.CorrelationId);
-  writer.OpenBrokerList();
-
-  for (size_t node_id = 0; node_id < Setup.Ports.size(); ++node_id) {
-    /* Translate port from virtual to physical before writing port to metadata
-       response.  See big comment in <dory/mock_kafka_server/port_map.h> for
-       an explanation of what is going on here. */
-    in_port_t phys_port = PortMap->VirtualPortToPhys(Setup.BasePort + node_id);
-    assert(phys_port);
-
-    writer.AddBroker(node_id, host_name, host_name_end, phys_port);
-  }
-
-  writer.CloseBrokerList();
-  writer.OpenTopicList();
-  std::string topic;
   TAction action = TAction::Respond;
   int16_t code = 0;
   std::string topic_for_code;
 
   if (request.Topic.empty()) {
-    for (auto iter = Setup.Topics.begin();
-         iter != Setup.Topics.end();
-         ++iter) {
-      const std::string &name = iter->first;
-      const char *topic_begin = name.data();
-      const char *topic_end = topic_begin + name.size();
-      topic.assign(topic_begin, topic_end);
-      int16_t error_to_inject = 0;
-
-      if (topic == error_topic) {
-        error_to_inject = error;
-        topic_for_code = error_topic;
-        code = error;
-      } else {
-        error_to_inject = 0;
-      }
-
-      WriteSingleTopic(writer, iter->second, topic_begin, topic_end,
-                       error_to_inject);
+    if (Setup.Topics.find(error_topic) != Setup.Topics.end()) {
+      topic_for_code = error_topic;
+      code = error;
     }
   } else {
-    const char *topic_begin = request.Topic.data();
-    const char *topic_end = topic_begin + request.Topic.size();
-    topic.assign(topic_begin, topic_end);
-
-    int16_t error_to_inject = 0;
-
-    if (topic == error_topic) {
-      error_to_inject = error;
+    if (request.Topic == error_topic) {
       topic_for_code = error_topic;
       code = error;
-    } else {
-      error_to_inject = 0;
     }
 
-    auto iter = Setup.Topics.find(request.Topic);
-
-    if (iter == Setup.Topics.end()) {
+    if (Setup.Topics.find(request.Topic) == Setup.Topics.end()) {
       code = 3;
       topic_for_code = request.Topic;
       action = TAction::RejectBadDest;
-      writer.OpenTopic(3, topic_begin, topic_end);
-      writer.CloseTopic();
-    } else {
-      WriteSingleTopic(writer, iter->second, topic_begin, topic_end,
-                       error_to_inject);
     }
   }
 
-  writer.CloseTopicList();
-  writer.CloseResponse();
+  WriteV0MetadataResponse(Setup, *PortMap, Ss.GetElapsedMs(),
+      request.CorrelationId, request.Topic, error_topic, error,
+      MdResponseBuf);
   PrintMdReq(GetMetadataRequestCount(), request, action, topic_for_code, code,
              delay);
   OptMetadataRequestReader.Reset();
@@ -209,29 +157,3 @@ TV0ClientHandler::SendMetadataResponse(const TMetadataRequest &request,
 
   return TSendMetadataResult::SentMetadata;
 }
-
-void TV0ClientHandler::WriteSingleTopic(TMetadataResponseWriter &writer,
-    const TSetup::TTopic &topic, const char *name_begin,
-    const char *name_end, int16_t error) {
-  writer.OpenTopic(error, name_begin, name_end);
-  writer.OpenPartitionList();
-  const std::vector<TSetup::TPartition> &pvec = topic.Partitions;
-  size_t node_id = topic.FirstPortOffset;
-  size_t node_count = Setup.Ports.size();
-  assert(node_id < node_count);
-
-  for (size_t i = 0; i < pvec.size(); ++i) {
-    writer.OpenPartition(0, i, node_id);
-    writer.OpenReplicaList();
-    writer.AddReplica(node_id);
-    writer.CloseReplicaList();
-    writer.OpenCaughtUpReplicaList();
-    writer.AddCaughtUpReplica(node_id);
-    writer.CloseCaughtUpReplicaList();
-    writer.ClosePartition();
-    node_id = (node_id + 1) % node_count;
-  }
-
-  writer.ClosePartitionList();
-  writer.CloseTopic();
-}
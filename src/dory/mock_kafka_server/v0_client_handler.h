@@ -32,7 +32,6 @@
 #include <base/no_copy_semantics.h>
 #include <base/opt.h>
 #include <dory/kafka_proto/metadata/v0/metadata_request_reader.h>
-#include <dory/kafka_proto/metadata/v0/metadata_response_writer.h>
 #include <dory/kafka_proto/produce/v0/msg_set_reader.h>
 #include <dory/kafka_proto/produce/v0/produce_request_reader.h>
 #include <dory/kafka_proto/produce/v0/produce_response_writer.h>
@@ -79,11 +78,6 @@ namespace Dory {
           const std::string &error_topic, size_t delay) override;
 
       private:
-      void WriteSingleTopic(
-          KafkaProto::Metadata::V0::TMetadataResponseWriter &writer,
-          const TSetup::TTopic &topic, const char *name_begin,
-          const char *name_end, int16_t error);
-
       Dory::KafkaProto::Produce::V0::TProduceRequestReader
           ProduceRequestReader;
 
@@ -0,0 +1,111 @@
+/* <dory/mock_kafka_server/v0_metadata_response.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/mock_kafka_server/v0_metadata_response.h>.
+ */
+
+#include <dory/mock_kafka_server/v0_metadata_response.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <dory/kafka_proto/metadata/v0/metadata_response_writer.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::KafkaProto::Metadata::V0;
+using namespace Dory::MockKafkaServer;
+
+static void WriteSingleTopic(TMetadataResponseWriter &writer,
+    const TSetup::TInfo &setup, uint64_t elapsed_ms,
+    const TSetup::TTopic &topic, const char *name_begin,
+    const char *name_end, int16_t error) {
+  writer.OpenTopic(error, name_begin, name_end);
+  writer.OpenPartitionList();
+  const std::vector<TSetup::TPartition> &pvec = topic.Partitions;
+
+  for (size_t i = 0; i < pvec.size(); ++i) {
+    size_t node_id = setup.GetLeaderPortOffset(topic, i, elapsed_ms);
+    writer.OpenPartition(0, i, node_id);
+    writer.OpenReplicaList();
+    writer.AddReplica(node_id);
+    writer.CloseReplicaList();
+    writer.OpenCaughtUpReplicaList();
+    writer.AddCaughtUpReplica(node_id);
+    writer.CloseCaughtUpReplicaList();
+    writer.ClosePartition();
+  }
+
+  writer.ClosePartitionList();
+  writer.CloseTopic();
+}
+
+void Dory::MockKafkaServer::WriteV0MetadataResponse(
+    const TSetup::TInfo &setup, const TPortMap &port_map,
+    uint64_t elapsed_ms, int32_t correlation_id, const std::string &topic,
+    const std::string &error_topic, int16_t error,
+    std::vector<uint8_t> &out) {
+  char host_name[1024];
+  IfLt0(gethostname(host_name, sizeof(host_name)));
+  size_t host_name_len = std::strlen(host_name);
+  const char *host_name_end = &host_name[host_name_len];
+  TMetadataResponseWriter writer;
+  writer.OpenResponse(out, correlation_id);
+  writer.OpenBrokerList();
+
+  for (size_t node_id = 0; node_id < setup.Ports.size(); ++node_id) {
+    /* Translate port from virtual to physical before writing port to metadata
+       response.  See big comment in <dory/mock_kafka_server/port_map.h> for
+       an explanation of what is going on here. */
+    in_port_t phys_port = port_map.VirtualPortToPhys(setup.BasePort + node_id);
+    assert(phys_port);
+
+    writer.AddBroker(node_id, host_name, host_name_end, phys_port);
+  }
+
+  writer.CloseBrokerList();
+  writer.OpenTopicList();
+
+  if (topic.empty()) {
+    for (const auto &item : setup.Topics) {
+      const std::string &name = item.first;
+      WriteSingleTopic(writer, setup, elapsed_ms, item.second,
+          name.data(), name.data() + name.size(),
+          (name == error_topic) ? error : 0);
+    }
+  } else {
+    const char *topic_begin = topic.data();
+    const char *topic_end = topic_begin + topic.size();
+    auto iter = setup.Topics.find(topic);
+
+    if (iter == setup.Topics.end()) {
+      writer.OpenTopic(3, topic_begin, topic_end);
+      writer.CloseTopic();
+    } else {
+      WriteSingleTopic(writer, setup, elapsed_ms, iter->second,
+          topic_begin, topic_end, (topic == error_topic) ? error : 0);
+    }
+  }
+
+  writer.CloseTopicList();
+  writer.CloseResponse();
+}
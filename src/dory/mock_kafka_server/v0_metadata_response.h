@@ -0,0 +1,49 @@
+/* <dory/mock_kafka_server/v0_metadata_response.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Function for writing version 0 metadata responses describing the simulated
+   cluster.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <dory/mock_kafka_server/port_map.h>
+#include <dory/mock_kafka_server/setup.h>
+
+namespace Dory {
+
+  namespace MockKafkaServer {
+
+    /* Write to 'out' a metadata response for the cluster described by
+       'setup'.  An empty 'topic' requests all topics.  If 'error_topic' is
+       nonempty, that topic is reported with error code 'error'.  A requested
+       topic that does not exist is reported with error code 3 (unknown topic
+       or partition).  Partition leaders are reported as of 'elapsed_ms'
+       milliseconds after the server started. */
+    void WriteV0MetadataResponse(const TSetup::TInfo &setup,
+        const TPortMap &port_map, uint64_t elapsed_ms, int32_t correlation_id,
+        const std::string &topic, const std::string &error_topic,
+        int16_t error, std::vector<uint8_t> &out);
+
+  }  // MockKafkaServer
+
+}  // Dory
@@ -44,6 +44,7 @@ SERVER_COUNTER(MsgUnprocessedDestroy);
 static TBlob MakeKeyAndValue(const void *key, size_t key_size,
     const void *value, size_t value_size, Capped::TPool &pool) {
   TWriter writer(&pool);
+  writer.Reserve(key_size + value_size);
   writer.Write(key, key_size);
   writer.Write(value, value_size);
   return writer.DraftBlob();
@@ -94,12 +95,17 @@ TMsg::TMsg(TRoutingType routing_type, int32_t partition_key,
       CreationTimestamp(GetMonotonicRawMilliseconds()),
       State(TState::New),
       FailedDeliveryAttemptCount(0),
+      JournalSeq(0),
       Topic(reinterpret_cast<const char *>(topic_begin),
             reinterpret_cast<const char *>(topic_end)),
       Partition(0),
       KeyAndValue(MakeKeyAndValue(key, key_size, value, value_size, pool)),
       KeySize(key_size),
-      BodyTruncated(body_truncated) {
+      BodyTruncated(body_truncated),
+      HighPriority(false),
+      Deadline(UINT64_MAX),
+      ProducerGeneration(0),
+      ProduceSequence(-1) {
   assert(topic_begin);
   assert(topic_end >= topic_end);
   assert(key || (key_size == 0));
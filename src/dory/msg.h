@@ -27,9 +27,11 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include <base/no_copy_semantics.h>
 #include <capped/blob.h>
+#include <dory/topic_quota.h>
 
 namespace Dory {
 
@@ -112,12 +114,41 @@ namespace Dory {
       return Partition;
     }
 
-    /* Sets the Kafka partition to the given value. */
+    /* Sets the Kafka partition to the given value.  A sequence number
+       assigned for a different partition no longer applies. */
     void SetPartition(int32_t partition) {
       assert(this);
+
+      if (partition != Partition) {
+        ProducerGeneration = 0;
+      }
+
       Partition = partition;
     }
 
+    /* Returns the generation of the idempotent producer ID that the message's
+       sequence number was assigned under, or 0 if the message has no sequence
+       number for its current partition. */
+    uint32_t GetProducerGeneration() const {
+      assert(this);
+      return ProducerGeneration;
+    }
+
+    /* Returns the message's idempotent producer sequence number, or -1 if one
+       was never assigned.  The value remains after GetProducerGeneration()
+       drops to 0, which shows that the message may have reached Kafka
+       under an old sequence number. */
+    int32_t GetProduceSequence() const {
+      assert(this);
+      return ProduceSequence;
+    }
+
+    void SetProduceSequence(uint32_t generation, int32_t sequence) {
+      assert(this);
+      ProducerGeneration = generation;
+      ProduceSequence = sequence;
+    }
+
     /* Accessor method for the message body. */
     const Capped::TBlob &GetKeyAndValue() const {
       assert(this);
@@ -165,6 +196,55 @@ namespace Dory {
       State = state;
     }
 
+    /* Returns the message's sequence number in the message journal, or 0 if
+       the message has not been journaled. */
+    uint64_t GetJournalSeq() const {
+      assert(this);
+      return JournalSeq;
+    }
+
+    void SetJournalSeq(uint64_t seq) {
+      assert(this);
+      JournalSeq = seq;
+    }
+
+    /* Returns true if the message belongs to a high priority topic, and
+       therefore goes in the high priority lane of its connector. */
+    bool IsHighPriority() const {
+      assert(this);
+      return HighPriority;
+    }
+
+    void SetHighPriority(bool high_priority) {
+      assert(this);
+      HighPriority = high_priority;
+    }
+
+    /* Returns the monotonic raw timestamp in milliseconds after which the
+       message is too old to be worth delivering, based on its creation
+       timestamp and its topic's max age.  UINT64_MAX indicates no max age. */
+    uint64_t GetDeadline() const {
+      assert(this);
+      return Deadline;
+    }
+
+    void SetDeadline(uint64_t deadline) {
+      assert(this);
+      Deadline = deadline;
+    }
+
+    bool IsExpired(uint64_t now) const {
+      assert(this);
+      return now > Deadline;
+    }
+
+    /* Takes ownership of the bytes charged against the topic's buffer quota
+       for this message.  They are returned when the message is destroyed. */
+    void SetQuotaCharge(TTopicQuota::TCharge &&charge) {
+      assert(this);
+      QuotaCharge = std::move(charge);
+    }
+
     ~TMsg() noexcept;
 
     private:
@@ -218,6 +298,10 @@ namespace Dory {
     /* Number of failed deliveries. */
     size_t FailedDeliveryAttemptCount;
 
+    /* Sequence number assigned by the message journal, or 0 if the message
+       has not been journaled. */
+    uint64_t JournalSeq;
+
     /* The Kafka topic to deliver to. */
     const std::string Topic;
 
@@ -236,6 +320,22 @@ namespace Dory {
        the maximum allowed length. */
     const bool BodyTruncated;
 
+    /* Set by the router thread according to the topic priority config. */
+    bool HighPriority;
+
+    /* Set by the router thread according to the message max age config. */
+    uint64_t Deadline;
+
+    /* Bytes charged against the topic's buffer quota, if quotas are enabled.
+     */
+    TTopicQuota::TCharge QuotaCharge;
+
+    /* Set by TIdempotentProducer when the message is sent with idempotence
+       enabled. */
+    uint32_t ProducerGeneration;
+
+    int32_t ProduceSequence;
+
     friend class TMsgCreator;
   };  // TMsg
 
@@ -22,6 +22,7 @@
 #include <dory/msg_dispatch/broker_msg_queue.h>
 
 #include <algorithm>
+#include <string>
 
 #include <dory/msg_state_tracker.h>
 #include <server/counter.h>
@@ -58,10 +59,20 @@ min_opt_ts(const TOpt<TMsg::TTimestamp> &t1,
 }
 
 TBrokerMsgQueue::TBrokerMsgQueue(const TGlobalBatchConfig &batch_config,
-    TMsgStateTracker &msg_state_tracker)
+    TMsgStateTracker &msg_state_tracker, TAdaptiveBatchStats &adaptive_stats,
+    size_t broker_index, size_t connection_index)
     : PerTopicBatcher(batch_config.GetPerTopicConfig()),
       CombinedTopicsBatcher(batch_config.GetCombinedTopicsConfig()),
       MsgStateTracker(msg_state_tracker) {
+  std::string broker = "broker " + std::to_string(broker_index);
+
+  if (connection_index) {
+    broker += " connection " + std::to_string(connection_index);
+  }
+
+  PerTopicBatcher.SetAdaptiveStats(&adaptive_stats, broker + " topic ");
+  CombinedTopicsBatcher.SetAdaptiveStats(&adaptive_stats,
+      broker + " combined topics");
 }
 
 void TBrokerMsgQueue::Put(TMsg::TTimestamp now, TMsg::TPtr &&msg) {
@@ -221,6 +232,21 @@ bool TBrokerMsgQueue::NonblockingGet(TMsg::TTimestamp now,
   return false;
 }
 
+void TBrokerMsgQueue::SetConfig(const TGlobalBatchConfig &batch_config,
+    TMsg::TTimestamp now) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+  std::list<std::list<TMsg::TPtr>> per_topic =
+      PerTopicBatcher.SetConfig(batch_config.GetPerTopicConfig(), now);
+  std::list<std::list<TMsg::TPtr>> combined_topics =
+      CombinedTopicsBatcher.SetConfig(
+          batch_config.GetCombinedTopicsConfig(), now);
+  MsgStateTracker.MsgEnterSendWait(per_topic);
+  MsgStateTracker.MsgEnterSendWait(combined_topics);
+  ReadyList.splice(ReadyList.end(), std::move(per_topic));
+  ReadyList.splice(ReadyList.end(), std::move(combined_topics));
+}
+
 std::list<std::list<TMsg::TPtr>> TBrokerMsgQueue::GetAllOnShutdown() {
   assert(this);
 
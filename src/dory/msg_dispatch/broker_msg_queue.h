@@ -33,6 +33,7 @@
 #include <base/fd.h>
 #include <base/no_copy_semantics.h>
 #include <base/opt.h>
+#include <dory/batch/adaptive_batch_stats.h>
 #include <dory/batch/combined_topics_batcher.h>
 #include <dory/batch/global_batch_config.h>
 #include <dory/batch/per_topic_batcher.h>
@@ -47,8 +48,12 @@ namespace Dory {
       NO_COPY_SEMANTICS(TBrokerMsgQueue);
 
       public:
+      /* 'broker_index' and 'connection_index' are used only to name this
+         queue's batchers on the adaptive batching status page. */
       TBrokerMsgQueue(const Batch::TGlobalBatchConfig &batch_config,
-          TMsgStateTracker &msg_state_tracker);
+          TMsgStateTracker &msg_state_tracker,
+          Batch::TAdaptiveBatchStats &adaptive_stats, size_t broker_index,
+          size_t connection_index);
 
       /* Returns an FD that becomes readable when an incoming message or batch
          of messages from the router thread triggers one of the following
@@ -111,6 +116,14 @@ namespace Dory {
                           TMsg::TTimestamp &next_batch_complete_time,
                           std::list<std::list<TMsg::TPtr>> &ready_msgs);
 
+      /* Swap in new broker-level batching config from a config file reload.
+         Batched messages are kept unless their batches are complete under the
+         new config, in which case they go to the ready list.  Called by the
+         connector thread, which should then call NonblockingGet() to pick up
+         any ready messages and the new batch expiry time. */
+      void SetConfig(const Batch::TGlobalBatchConfig &batch_config,
+          TMsg::TTimestamp now);
+
       /* Get entire contents of batcher and ready list, regardless of batch
          state.  Avoid popping the semaphore. */
       std::list<std::list<TMsg::TPtr>> GetAllOnShutdown();
@@ -0,0 +1,87 @@
+/* <dory/msg_dispatch/connection_chooser.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/msg_dispatch/connection_chooser.h>.
+ */
+
+#include <dory/msg_dispatch/connection_chooser.h>
+
+#include <utility>
+
+using namespace Dory;
+using namespace Dory::MsgDispatch;
+
+size_t TConnectionChooser::Choose(const TMsg &msg) {
+  assert(this);
+
+  if (ConnectionCount == 1) {
+    return 0;
+  }
+
+  return (msg.GetRoutingType() == TMsg::TRoutingType::PartitionKey) ?
+      GetPartitionConnection(msg) : ChooseAnyPartition();
+}
+
+std::vector<std::list<std::list<TMsg::TPtr>>>
+TConnectionChooser::Split(std::list<std::list<TMsg::TPtr>> &&batch) {
+  assert(this);
+  std::vector<std::list<std::list<TMsg::TPtr>>> shares(ConnectionCount);
+
+  if (ConnectionCount == 1) {
+    shares[0] = std::move(batch);
+    batch.clear();
+    return std::move(shares);
+  }
+
+  std::vector<std::list<TMsg::TPtr>> split(ConnectionCount);
+
+  for (std::list<TMsg::TPtr> &msg_list : batch) {
+    size_t any_partition_index = ChooseAnyPartition();
+
+    for (TMsg::TPtr &msg : msg_list) {
+      assert(msg);
+      size_t index =
+          (msg->GetRoutingType() == TMsg::TRoutingType::PartitionKey) ?
+          GetPartitionConnection(*msg) : any_partition_index;
+      split[index].push_back(std::move(msg));
+    }
+
+    for (size_t i = 0; i < split.size(); ++i) {
+      if (!split[i].empty()) {
+        shares[i].push_back(std::move(split[i]));
+        split[i].clear();
+      }
+    }
+  }
+
+  batch.clear();
+  return std::move(shares);
+}
+
+size_t TConnectionChooser::GetPartitionConnection(const TMsg &msg) const {
+  assert(this);
+  assert(msg.GetRoutingType() == TMsg::TRoutingType::PartitionKey);
+  return static_cast<size_t>(msg.GetPartition()) % ConnectionCount;
+}
+
+size_t TConnectionChooser::ChooseAnyPartition() {
+  assert(this);
+  size_t result = NextAnyPartition;
+  NextAnyPartition = (result + 1) % ConnectionCount;
+  return result;
+}
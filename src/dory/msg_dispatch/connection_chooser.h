@@ -0,0 +1,82 @@
+/* <dory/msg_dispatch/connection_chooser.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class used for choosing which of a broker's connections gets a message or
+   batch.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <vector>
+
+#include <dory/msg.h>
+
+namespace Dory {
+
+  namespace MsgDispatch {
+
+    /* PartitionKey messages are assigned to connections by partition, so that
+       all messages for a given partition are sent in order on the same
+       connection.  AnyPartition messages have no ordering requirements, so
+       they are spread across the connections in round robin order. */
+    class TConnectionChooser final {
+      public:
+      TConnectionChooser()
+          : ConnectionCount(1),
+            NextAnyPartition(0) {
+      }
+
+      explicit TConnectionChooser(size_t connection_count)
+          : ConnectionCount(connection_count),
+            NextAnyPartition(0) {
+        assert(ConnectionCount);
+      }
+
+      size_t GetConnectionCount() const {
+        assert(this);
+        return ConnectionCount;
+      }
+
+      /* Return the index of the connection that gets 'msg'. */
+      size_t Choose(const TMsg &msg);
+
+      /* Split 'batch' into one share per connection, where element i of the
+         result is the share for connection i (possibly empty).  Messages
+         keep their relative order within each share.  AnyPartition messages
+         batched together stay together.  On return, 'batch' is empty. */
+      std::vector<std::list<std::list<TMsg::TPtr>>>
+      Split(std::list<std::list<TMsg::TPtr>> &&batch);
+
+      private:
+      size_t GetPartitionConnection(const TMsg &msg) const;
+
+      size_t ChooseAnyPartition();
+
+      size_t ConnectionCount;
+
+      /* Index of the connection that gets the next AnyPartition message or
+         batch. */
+      size_t NextAnyPartition;
+    };  // TConnectionChooser
+
+  }  // MsgDispatch
+
+}  // Dory
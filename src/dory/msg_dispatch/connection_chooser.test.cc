@@ -0,0 +1,244 @@
+/* <dory/msg_dispatch/connection_chooser.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit tests for <dory/msg_dispatch/connection_chooser.h>.
+ */
+
+#include <dory/msg_dispatch/connection_chooser.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <dory/msg.h>
+#include <dory/msg_creator.h>
+#include <dory/test_util/misc_util.h>
+
+#include <gtest/gtest.h>
+
+using namespace Dory;
+using namespace Dory::MsgDispatch;
+using namespace Dory::TestUtil;
+
+namespace {
+
+  /* The fixture for testing class TConnectionChooser. */
+  class TConnectionChooserTest : public ::testing::Test {
+    protected:
+    TConnectionChooserTest() {
+    }
+
+    virtual ~TConnectionChooserTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TConnectionChooserTest
+
+  TMsg::TPtr NewPartitionKeyMsg(TTestMsgCreator &mc, int32_t partition) {
+    std::string topic("topic");
+    std::string value("value");
+    TMsg::TPtr msg = TMsgCreator::CreatePartitionKeyMsg(partition, 0,
+        topic.data(), topic.data() + topic.size(), nullptr, 0, value.data(),
+        value.size(), false, *mc.Pool, mc.MsgStateTracker);
+    msg->SetPartition(partition);
+    SetProcessed(msg);
+    return std::move(msg);
+  }
+
+  TMsg::TPtr NewAnyPartitionMsg(TTestMsgCreator &mc) {
+    return mc.NewMsg("topic", "value", 0, true);
+  }
+
+  TEST_F(TConnectionChooserTest, SingleConnection) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    TConnectionChooser chooser;
+    ASSERT_EQ(chooser.GetConnectionCount(), 1U);
+
+    for (int32_t i = 0; i < 5; ++i) {
+      ASSERT_EQ(chooser.Choose(*NewPartitionKeyMsg(mc, i)), 0U);
+      ASSERT_EQ(chooser.Choose(*NewAnyPartitionMsg(mc)), 0U);
+    }
+
+    std::list<std::list<TMsg::TPtr>> batch(2);
+    batch.front().push_back(NewPartitionKeyMsg(mc, 3));
+    batch.back().push_back(NewAnyPartitionMsg(mc));
+    const TMsg *first = batch.front().front().get();
+    std::vector<std::list<std::list<TMsg::TPtr>>> shares =
+        chooser.Split(std::move(batch));
+    ASSERT_TRUE(batch.empty());
+    ASSERT_EQ(shares.size(), 1U);
+    ASSERT_EQ(shares[0].size(), 2U);
+    ASSERT_EQ(shares[0].front().front().get(), first);
+  }
+
+  TEST_F(TConnectionChooserTest, AnyPartitionRoundRobin) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    TConnectionChooser chooser(3);
+
+    for (size_t i = 0; i < 7; ++i) {
+      ASSERT_EQ(chooser.Choose(*NewAnyPartitionMsg(mc)), i % 3);
+    }
+  }
+
+  TEST_F(TConnectionChooserTest, PartitionKeySameConnection) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    const size_t connection_count = 3;
+    const int32_t partition_count = 8;
+    TConnectionChooser chooser(connection_count);
+    std::vector<size_t> expected(partition_count);
+
+    for (int32_t i = 0; i < partition_count; ++i) {
+      expected[i] = chooser.Choose(*NewPartitionKeyMsg(mc, i));
+      ASSERT_LT(expected[i], connection_count);
+    }
+
+    /* Interleaved AnyPartition traffic must not move a partition to a
+       different connection, whether its messages are dispatched one at a
+       time or in batches. */
+    for (size_t round = 0; round < 4; ++round) {
+      for (int32_t i = 0; i < partition_count; ++i) {
+        chooser.Choose(*NewAnyPartitionMsg(mc));
+        ASSERT_EQ(chooser.Choose(*NewPartitionKeyMsg(mc, i)), expected[i]);
+      }
+
+      std::list<std::list<TMsg::TPtr>> batch;
+
+      for (int32_t i = 0; i < partition_count; ++i) {
+        batch.emplace_back();
+        batch.back().push_back(NewPartitionKeyMsg(mc, i));
+        batch.back().push_back(NewPartitionKeyMsg(mc, i));
+        batch.emplace_back();
+        batch.back().push_back(NewAnyPartitionMsg(mc));
+      }
+
+      std::vector<std::list<std::list<TMsg::TPtr>>> shares =
+          chooser.Split(std::move(batch));
+      ASSERT_EQ(shares.size(), connection_count);
+
+      for (size_t j = 0; j < shares.size(); ++j) {
+        for (const std::list<TMsg::TPtr> &msg_list : shares[j]) {
+          for (const TMsg::TPtr &msg : msg_list) {
+            if (msg->GetRoutingType() ==
+                TMsg::TRoutingType::PartitionKey) {
+              ASSERT_EQ(j, expected[msg->GetPartition()]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  TEST_F(TConnectionChooserTest, SplitKeepsAllMsgs) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    const size_t connection_count = 4;
+    TConnectionChooser chooser(connection_count);
+    std::list<std::list<TMsg::TPtr>> batch;
+    std::vector<const TMsg *> input_order;
+    std::vector<std::set<const TMsg *>> any_partition_lists;
+
+    for (size_t i = 0; i < 10; ++i) {
+      /* A list with PartitionKey messages for several partitions, as the
+         combined topics batcher produces. */
+      batch.emplace_back();
+
+      for (int32_t j = 0; j < 6; ++j) {
+        batch.back().push_back(
+            NewPartitionKeyMsg(mc, static_cast<int32_t>(i) + j));
+        input_order.push_back(batch.back().back().get());
+      }
+
+      /* A list of AnyPartition messages. */
+      batch.emplace_back();
+      any_partition_lists.emplace_back();
+
+      for (size_t j = 0; j < 3; ++j) {
+        batch.back().push_back(NewAnyPartitionMsg(mc));
+        input_order.push_back(batch.back().back().get());
+        any_partition_lists.back().insert(batch.back().back().get());
+      }
+    }
+
+    std::vector<std::list<std::list<TMsg::TPtr>>> shares =
+        chooser.Split(std::move(batch));
+    ASSERT_TRUE(batch.empty());
+    ASSERT_EQ(shares.size(), connection_count);
+    std::set<const TMsg *> seen;
+    size_t nonempty_share_count = 0;
+
+    for (const std::list<std::list<TMsg::TPtr>> &share : shares) {
+      if (!share.empty()) {
+        ++nonempty_share_count;
+      }
+
+      /* Messages within a share must keep their relative input order. */
+      size_t pos = 0;
+
+      for (const std::list<TMsg::TPtr> &msg_list : share) {
+        ASSERT_FALSE(msg_list.empty());
+
+        for (const TMsg::TPtr &msg : msg_list) {
+          ASSERT_TRUE(!!msg);
+          ASSERT_TRUE(seen.insert(msg.get()).second);
+
+          while ((pos < input_order.size()) &&
+                 (input_order[pos] != msg.get())) {
+            ++pos;
+          }
+
+          ASSERT_LT(pos, input_order.size());
+        }
+
+        /* AnyPartition messages batched together stay together. */
+        if (msg_list.front()->GetRoutingType() ==
+            TMsg::TRoutingType::AnyPartition) {
+          bool found = false;
+
+          for (const std::set<const TMsg *> &s : any_partition_lists) {
+            if (s.count(msg_list.front().get())) {
+              ASSERT_EQ(msg_list.size(), s.size());
+
+              for (const TMsg::TPtr &msg : msg_list) {
+                ASSERT_EQ(s.count(msg.get()), 1U);
+              }
+
+              found = true;
+            }
+          }
+
+          ASSERT_TRUE(found);
+        }
+      }
+    }
+
+    ASSERT_EQ(seen.size(), input_order.size());
+    ASSERT_EQ(nonempty_share_count, connection_count);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -66,6 +66,8 @@ SERVER_COUNTER(BadProduceResponseSize);
 SERVER_COUNTER(BugProduceRequestEmpty);
 SERVER_COUNTER(ConnectorCheckInputQueue);
 SERVER_COUNTER(ConnectorCleanupAfterJoin);
+SERVER_COUNTER(ConnectorConfUpdate);
+SERVER_COUNTER(ConnectorDiscardExpired);
 SERVER_COUNTER(ConnectorConnectFail);
 SERVER_COUNTER(ConnectorConnectSuccess);
 SERVER_COUNTER(ConnectorDoSocketRead);
@@ -83,15 +85,21 @@ SERVER_COUNTER(ConnectorStartWaitShutdownAck);
 SERVER_COUNTER(ConnectorTruncateLongTimeout);
 SERVER_COUNTER(SendProduceRequestOk);
 
-TConnector::TConnector(size_t my_broker_index, TDispatcherSharedState &ds)
+TConnector::TConnector(size_t my_broker_index, size_t my_connection_index,
+    TDispatcherSharedState &ds)
     : MyBrokerIndex(my_broker_index),
+      MyConnectionIndex(my_connection_index),
       Ds(ds),
+      ConfGeneration(ds.GetConfGeneration()),
       DebugLoggerSend(ds.DebugSetup, TDebugSetup::TLogId::MSG_SEND),
       DebugLoggerReceive(ds.DebugSetup, TDebugSetup::TLogId::MSG_GOT_ACK),
-      InputQueue(ds.BatchConfig, ds.MsgStateTracker),
+      InputQueue(ds.GetBatchConfig(), ds.MsgStateTracker, ds.AdaptiveBatchStats,
+          my_broker_index, my_connection_index),
       /* TODO: rethink DebugLogger stuff */
-      RequestFactory(ds.Config, ds.BatchConfig, ds.CompressionConf,
-                     ds.ProduceProtocol, my_broker_index),
+      RequestFactory(ds.Config, ds.GetBatchConfig(), ds.GetCompressionConf(),
+                     ds.CompressionStats, ds.LaneStats,
+                     ds.IdempotentProducer, ds.ProduceProtocol,
+                     my_broker_index),
       PauseInProgress(false),
       Destroying(false),
       ResponseReader(ds.ProduceProtocol->CreateProduceResponseReader()),
@@ -115,7 +123,7 @@ void TConnector::SetMetadata(const std::shared_ptr<TMetadata> &md) {
   assert(this);
   assert(md);
   Metadata = md;
-  RequestFactory.Init(Ds.CompressionConf, md);
+  RequestFactory.Init(Ds.GetCompressionConf(), md);
 }
 
 void TConnector::StartSlowShutdown(uint64_t start_time) {
@@ -219,9 +227,10 @@ void TConnector::Run() {
     );
     assert(MyBrokerIndex < Metadata->GetBrokers().size());
     broker_id = MyBrokerId();
-    syslog(LOG_NOTICE, "Connector thread %d (index %lu broker %ld) started",
-        static_cast<int>(Gettid()), static_cast<unsigned long>(MyBrokerIndex),
-        broker_id);
+    syslog(LOG_NOTICE, "Connector thread %d (index %lu broker %ld "
+        "connection %lu) started", static_cast<int>(Gettid()),
+        static_cast<unsigned long>(MyBrokerIndex), broker_id,
+        static_cast<unsigned long>(MyConnectionIndex));
     DoRun();
   } catch (const TShutdownOnDestroy &) {
     /* Nothing to do here. */
@@ -251,9 +260,10 @@ bool TConnector::DoConnect() {
   const std::string &host = broker.GetHostname();
   uint16_t port = broker.GetPort();
   long broker_id = broker.GetId();
-  syslog(LOG_NOTICE, "Connector thread %d (index %lu broker %ld) connecting "
-      "to host %s port %u", static_cast<int>(Gettid()),
-      static_cast<unsigned long>(MyBrokerIndex), broker_id, host.c_str(),
+  syslog(LOG_NOTICE, "Connector thread %d (index %lu broker %ld connection "
+      "%lu) connecting to host %s port %u", static_cast<int>(Gettid()),
+      static_cast<unsigned long>(MyBrokerIndex), broker_id,
+      static_cast<unsigned long>(MyConnectionIndex), host.c_str(),
       static_cast<unsigned>(port));
 
   try {
@@ -424,6 +434,53 @@ bool TConnector::TrySendProduceRequest() {
   return true;
 }
 
+void TConnector::DiscardExpiredMsgs() {
+  assert(this);
+  std::list<TMsg::TPtr> expired =
+      RequestFactory.TakeExpiredMsgs(GetMonotonicRawMilliseconds());
+
+  if (expired.empty()) {
+    return;
+  }
+
+  ConnectorDiscardExpired.Increment(expired.size());
+
+  if (!Ds.Config.NoLogDiscard) {
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Discarding message because it exceeded max age "
+          "(topic: [%s])", expired.front()->GetTopic().c_str());
+    }
+  }
+
+  Ds.Discard(std::move(expired), TAnomalyTracker::TDiscardReason::Expired);
+}
+
+void TConnector::CheckConfUpdate() {
+  assert(this);
+  assert(!SendInProgress());
+
+  if (Ds.GetConfGeneration() == ConfGeneration) {
+    return;
+  }
+
+  ConnectorConfUpdate.Increment();
+  Conf::TCompressionConf compression_conf;
+  TGlobalBatchConfig batch_config;
+  ConfGeneration = Ds.GetConf(compression_conf, batch_config);
+  syslog(LOG_NOTICE, "Connector thread %d (index %lu broker %ld) swapping in "
+      "new batching and compression config", static_cast<int>(Gettid()),
+      static_cast<unsigned long>(MyBrokerIndex), MyBrokerId());
+  uint64_t now = GetEpochMilliseconds();
+  InputQueue.SetConfig(batch_config, now);
+  RequestFactory.SetConfig(batch_config, compression_conf);
+
+  /* Pick up any batches that are complete under the new config, and the new
+     batch expiry time. */
+  CheckInputQueue(now, false);
+}
+
 bool TConnector::HandleSockWriteReady() {
   assert(this);
   assert(CurrentRequest.IsKnown() == SendInProgress());
@@ -431,6 +488,14 @@ bool TConnector::HandleSockWriteReady() {
   /* See whether we are starting a new produce request, or continuing a
      partially sent one. */
   if (!SendInProgress()) {
+    CheckConfUpdate();
+    DiscardExpiredMsgs();
+
+    if (RequestFactory.IsEmpty()) {
+      /* Everything we had to send was too old. */
+      return true;
+    }
+
     std::vector<uint8_t> buf(SendBuf.TakeStorage());
     CurrentRequest = RequestFactory.BuildRequest(buf);
 
@@ -478,6 +543,7 @@ bool TConnector::HandleSockWriteReady() {
 
     if (ack_expected) {
       AckWaitQueue.emplace_back(std::move(*CurrentRequest));
+      AckWaitSendTimes.push_back(GetMonotonicRawMilliseconds());
     }
 
     CurrentRequest.Reset();
@@ -494,6 +560,12 @@ bool TConnector::ProcessSingleProduceResponse() {
   bool pause = false;
   TProduceRequest request(std::move(AckWaitQueue.front()));
   AckWaitQueue.pop_front();
+  assert(!AckWaitSendTimes.empty());
+  uint64_t now = GetMonotonicRawMilliseconds();
+  uint64_t send_time = AckWaitSendTimes.front();
+  AckWaitSendTimes.pop_front();
+  Ds.AdaptiveBatchStats.RecordAckLatency(
+      (now > send_time) ? (now - send_time) : 0);
   TProduceResponseProcessor processor(*ResponseReader, Ds, DebugLoggerReceive,
       MyBrokerIndex, MyBrokerId());
 
@@ -693,6 +765,17 @@ bool TConnector::PrepareForPoll(uint64_t now, int &poll_timeout) {
     need_batch_timeout = OptNextBatchExpiry.IsKnown();
   }
 
+  /* Kafka tracks sequence numbers for only the 5 most recent produce
+     requests per partition, so an idempotent producer must not have more than
+     that many outstanding.  Wait for an ACK before starting another send. */
+  static const size_t MAX_IDEMPOTENT_IN_FLIGHT = 5;
+
+  if (need_sock_write && !SendInProgress() &&
+      Ds.IdempotentProducer.IsEnabled() &&
+      (AckWaitQueue.size() >= MAX_IDEMPOTENT_IN_FLIGHT)) {
+    need_sock_write = false;
+  }
+
   if (need_sock_write || need_sock_read) {
     poll_timeout = static_cast<int>(Ds.Config.KafkaSocketTimeout * 1000);
   }
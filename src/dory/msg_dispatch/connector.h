@@ -55,12 +55,16 @@ namespace Dory {
 
     /* This class handles a TCP connection between Dory and a single Kafka
        broker.  It uses a single thread for building and sending produce
-       requests, as well as receiving and processing produce responses.  */
+       requests, as well as receiving and processing produce responses.  A
+       broker may have several of these, each with its own connection.  */
     class TConnector final : public Thread::TFdManagedThread {
       NO_COPY_SEMANTICS(TConnector);
 
       public:
-      TConnector(size_t my_broker_index, TDispatcherSharedState &ds);
+      /* 'my_connection_index' identifies which of the broker's connections
+         this is. */
+      TConnector(size_t my_broker_index, size_t my_connection_index,
+          TDispatcherSharedState &ds);
 
       virtual ~TConnector() noexcept;
 
@@ -143,6 +147,16 @@ namespace Dory {
 
       bool TrySendProduceRequest();
 
+      /* Discard queued messages older than their topics' max ages, so they
+         don't take space in the next produce request. */
+      void DiscardExpiredMsgs();
+
+      /* If the router thread has published new compression or batching config
+         since we last looked, swap it into 'InputQueue' and 'RequestFactory'.
+         Queued messages are kept.  This is only called between produce
+         requests. */
+      void CheckConfUpdate();
+
       bool HandleSockWriteReady();
 
       bool ProcessSingleProduceResponse();
@@ -170,9 +184,16 @@ namespace Dory {
          TConnector. */
       const size_t MyBrokerIndex;
 
+      /* Index of this connector among the connectors for our broker. */
+      const size_t MyConnectionIndex;
+
       /* Dispatcher state shared by all TConnector objects. */
       TDispatcherSharedState &Ds;
 
+      /* Generation of the config in 'Ds' that 'InputQueue' and
+         'RequestFactory' are using. */
+      size_t ConfGeneration;
+
       Debug::TDebugLogger DebugLoggerSend;
 
       Debug::TDebugLogger DebugLoggerReceive;
@@ -287,6 +308,11 @@ namespace Dory {
       /* FIFO queue of sent produce requests waiting for responses. */
       std::list<TProduceRequest> AckWaitQueue;
 
+      /* Send completion times in milliseconds from the raw monotonic clock
+         for the requests in 'AckWaitQueue', in the same order.  Used for
+         estimating broker ACK latency for adaptive batching. */
+      std::list<uint64_t> AckWaitSendTimes;
+
       /* Messages that we got no ACK for, and need to be rerouted after pause
          finishes.  The router thread will reroute these and report them as
          possible duplicates. */
@@ -41,15 +41,41 @@ SERVER_COUNTER(AllDispatcherThreadsFinished);
 TDispatcherSharedState::TDispatcherSharedState(const TConfig &config,
      const TCompressionConf &compression_conf,
      TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
+     TCompressionStats &compression_stats, TPriorityLaneStats &lane_stats,
+     TAdaptiveBatchStats &adaptive_batch_stats,
+     TIdempotentProducer &idempotent_producer,
      const TDebugSetup &debug_setup, const TGlobalBatchConfig &batch_config)
     : Config(config),
-      CompressionConf(compression_conf),
       MsgStateTracker(msg_state_tracker),
       AnomalyTracker(anomaly_tracker),
+      CompressionStats(compression_stats),
+      LaneStats(lane_stats),
+      AdaptiveBatchStats(adaptive_batch_stats),
+      IdempotentProducer(idempotent_producer),
       DebugSetup(debug_setup),
-      BatchConfig(batch_config),
       RunningThreadCount(0),
-      AckCount(0) {
+      AckCount(0),
+      CompressionConf(compression_conf),
+      BatchConfig(batch_config),
+      ConfGeneration(0) {
+}
+
+void TDispatcherSharedState::SetConf(const TCompressionConf &compression_conf,
+    const TGlobalBatchConfig &batch_config) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(ConfMutex);
+  CompressionConf = compression_conf;
+  BatchConfig = batch_config;
+  ++ConfGeneration;
+}
+
+size_t TDispatcherSharedState::GetConf(TCompressionConf &compression_conf,
+    TGlobalBatchConfig &batch_config) const {
+  assert(this);
+  std::lock_guard<std::mutex> lock(ConfMutex);
+  compression_conf = CompressionConf;
+  batch_config = BatchConfig;
+  return ConfGeneration.load();
 }
 
 void TDispatcherSharedState::Discard(TMsg::TPtr &&msg,
@@ -26,19 +26,24 @@
 #include <cstddef>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 
 #include <base/event_semaphore.h>
 #include <base/no_copy_semantics.h>
 #include <dory/anomaly_tracker.h>
+#include <dory/batch/adaptive_batch_stats.h>
 #include <dory/batch/global_batch_config.h>
+#include <dory/compression_stats.h>
 #include <dory/conf/compression_conf.h>
 #include <dory/config.h>
 #include <dory/debug/debug_setup.h>
+#include <dory/idempotent_producer.h>
 #include <dory/kafka_proto/produce/produce_protocol.h>
 #include <dory/msg.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/priority_lane_stats.h>
 #include <dory/util/pause_button.h>
 
 namespace Dory {
@@ -50,24 +55,32 @@ namespace Dory {
 
       const TConfig &Config;
 
-      Conf::TCompressionConf CompressionConf;
-
       std::shared_ptr<KafkaProto::Produce::TProduceProtocol> ProduceProtocol;
 
       TMsgStateTracker &MsgStateTracker;
 
       TAnomalyTracker &AnomalyTracker;
 
+      TCompressionStats &CompressionStats;
+
+      TPriorityLaneStats &LaneStats;
+
+      Batch::TAdaptiveBatchStats &AdaptiveBatchStats;
+
+      TIdempotentProducer &IdempotentProducer;
+
       const Debug::TDebugSetup &DebugSetup;
 
       Util::TPauseButton PauseButton;
 
-      const Batch::TGlobalBatchConfig BatchConfig;
-
       TDispatcherSharedState(const TConfig &config,
           const Conf::TCompressionConf &compression_conf,
           TMsgStateTracker &msg_state_tracker,
           TAnomalyTracker &anomaly_tracker,
+          TCompressionStats &compression_stats,
+          TPriorityLaneStats &lane_stats,
+          Batch::TAdaptiveBatchStats &adaptive_batch_stats,
+          TIdempotentProducer &idempotent_producer,
           const Debug::TDebugSetup &debug_setup,
           const Batch::TGlobalBatchConfig &batch_config);
 
@@ -81,6 +94,35 @@ namespace Dory {
         ++AckCount;
       }
 
+      /* Called by the router thread to swap in new compression and
+         broker-level batching config, which may happen while connector
+         threads are running.  Each call starts a new config generation. */
+      void SetConf(const Conf::TCompressionConf &compression_conf,
+          const Batch::TGlobalBatchConfig &batch_config);
+
+      /* Connector threads call this to detect a config change cheaply,
+         without acquiring 'ConfMutex'. */
+      size_t GetConfGeneration() const {
+        assert(this);
+        return ConfGeneration.load();
+      }
+
+      /* Get the current config, and return its generation. */
+      size_t GetConf(Conf::TCompressionConf &compression_conf,
+          Batch::TGlobalBatchConfig &batch_config) const;
+
+      Conf::TCompressionConf GetCompressionConf() const {
+        assert(this);
+        std::lock_guard<std::mutex> lock(ConfMutex);
+        return CompressionConf;
+      }
+
+      Batch::TGlobalBatchConfig GetBatchConfig() const {
+        assert(this);
+        std::lock_guard<std::mutex> lock(ConfMutex);
+        return BatchConfig;
+      }
+
       void Discard(TMsg::TPtr &&msg, TAnomalyTracker::TDiscardReason reason);
 
       void Discard(std::list<TMsg::TPtr> &&msg_list,
@@ -116,6 +158,17 @@ namespace Dory {
       Base::TEventSemaphore ShutdownFinished;
 
       std::atomic<size_t> AckCount;
+
+      /* Protects 'CompressionConf' and 'BatchConfig' from concurrent access
+         by the router thread and connector threads. */
+      mutable std::mutex ConfMutex;
+
+      Conf::TCompressionConf CompressionConf;
+
+      Batch::TGlobalBatchConfig BatchConfig;
+
+      /* Incremented each time SetConf() is called. */
+      std::atomic<size_t> ConfGeneration;
     };  // TDispatcherSharedState
 
   }  // MsgDispatch
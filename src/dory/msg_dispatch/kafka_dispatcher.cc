@@ -49,10 +49,17 @@ SERVER_COUNTER(StartKafkaDispatcher);
 
 TKafkaDispatcher::TKafkaDispatcher(const TConfig &config,
     const TCompressionConf &compression_conf,
+    const TBrokerConnectionsConf &broker_connections_conf,
     TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
+    TCompressionStats &compression_stats, TPriorityLaneStats &lane_stats,
+    TAdaptiveBatchStats &adaptive_batch_stats,
+    TIdempotentProducer &idempotent_producer,
     const TGlobalBatchConfig &batch_config, const TDebugSetup &debug_setup)
     : Ds(config, compression_conf, msg_state_tracker, anomaly_tracker,
-      debug_setup, batch_config), State(TState::Stopped),
+      compression_stats, lane_stats, adaptive_batch_stats,
+      idempotent_producer, debug_setup, batch_config),
+      BrokerConnectionsConf(broker_connections_conf),
+      State(TState::Stopped),
       OkShutdown(true) {
 }
 
@@ -62,6 +69,22 @@ void TKafkaDispatcher::SetProduceProtocol(
   Ds.ProduceProtocol.reset(protocol);
 }
 
+void TKafkaDispatcher::SetConfig(const TCompressionConf &compression_conf,
+    const TBrokerConnectionsConf &broker_connections_conf,
+    const TGlobalBatchConfig &batch_config) {
+  assert(this);
+  assert(State == TState::Stopped);
+  assert(Ds.GetRunningThreadCount() == 0);
+  BrokerConnectionsConf = broker_connections_conf;
+  Ds.SetConf(compression_conf, batch_config);
+}
+
+void TKafkaDispatcher::UpdateConfig(const TCompressionConf &compression_conf,
+    const TGlobalBatchConfig &batch_config) {
+  assert(this);
+  Ds.SetConf(compression_conf, batch_config);
+}
+
 TKafkaDispatcherApi::TState TKafkaDispatcher::GetState() const {
   assert(this);
   return State;
@@ -100,18 +123,39 @@ void TKafkaDispatcher::Start(const std::shared_ptr<TMetadata> &md) {
 
   Connectors.clear();
   Connectors.resize(num_in_service);
-  Ds.MarkAllThreadsRunning(num_in_service);
+  size_t thread_count = 0;
 
   for (size_t i = 0; i < Connectors.size(); ++i) {
     assert(brokers[i].IsInService());
-    std::unique_ptr<TConnector> &broker_ptr = Connectors[i];
-    assert(!broker_ptr);
-    broker_ptr.reset(new TConnector(i, Ds));
-    syslog(LOG_NOTICE, "Starting connector thread for broker index %lu (Kafka "
-           "ID %lu)", static_cast<unsigned long>(i),
-           static_cast<unsigned long>(brokers[i].GetId()));
-    broker_ptr->SetMetadata(md);
-    broker_ptr->Start();
+
+    /* Sequence numbers for a partition must reach the broker in order, which
+       multiple connections can't guarantee. */
+    Connectors[i].Connections.resize(Ds.IdempotentProducer.IsEnabled() ?
+        1 : BrokerConnectionsConf.GetCount(brokers[i].GetId()));
+    Connectors[i].Chooser =
+        TConnectionChooser(Connectors[i].Connections.size());
+    thread_count += Connectors[i].Connections.size();
+  }
+
+  Ds.MarkAllThreadsRunning(thread_count);
+
+  for (size_t i = 0; i < Connectors.size(); ++i) {
+    std::vector<std::unique_ptr<TConnector>> &connections =
+        Connectors[i].Connections;
+
+    for (size_t j = 0; j < connections.size(); ++j) {
+      std::unique_ptr<TConnector> &broker_ptr = connections[j];
+      assert(!broker_ptr);
+      broker_ptr.reset(new TConnector(i, j, Ds));
+      syslog(LOG_NOTICE, "Starting connector thread for broker index %lu "
+             "(Kafka ID %lu) connection %lu of %lu",
+             static_cast<unsigned long>(i),
+             static_cast<unsigned long>(brokers[i].GetId()),
+             static_cast<unsigned long>(j + 1),
+             static_cast<unsigned long>(connections.size()));
+      broker_ptr->SetMetadata(md);
+      broker_ptr->Start();
+    }
   }
 
   for (size_t i = Connectors.size(); i < brokers.size(); ++i) {
@@ -148,8 +192,10 @@ void TKafkaDispatcher::Dispatch(TMsg::TPtr &&msg, size_t broker_index) {
     return;
   }
 
-  assert(Connectors[broker_index]);
-  Connectors[broker_index]->Dispatch(std::move(msg));
+  TBrokerConnections &broker = Connectors[broker_index];
+  size_t index = broker.Chooser.Choose(*msg);
+  assert(broker.Connections[index]);
+  broker.Connections[index]->Dispatch(std::move(msg));
   assert(!msg);
 }
 
@@ -175,8 +221,10 @@ void TKafkaDispatcher::DispatchNow(TMsg::TPtr &&msg, size_t broker_index) {
     return;
   }
 
-  assert(Connectors[broker_index]);
-  Connectors[broker_index]->DispatchNow(std::move(msg));
+  TBrokerConnections &broker = Connectors[broker_index];
+  size_t index = broker.Chooser.Choose(*msg);
+  assert(broker.Connections[index]);
+  broker.Connections[index]->DispatchNow(std::move(msg));
   assert(!msg);
 }
 
@@ -207,9 +255,29 @@ void TKafkaDispatcher::DispatchNow(std::list<std::list<TMsg::TPtr>> &&batch,
     return;
   }
 
-  assert(Connectors[broker_index]);
-  Connectors[broker_index]->DispatchNow(std::move(batch));
+  TBrokerConnections &broker = Connectors[broker_index];
+  std::vector<std::unique_ptr<TConnector>> &connections = broker.Connections;
+
+  if (connections.size() == 1) {
+    assert(connections[0]);
+    connections[0]->DispatchNow(std::move(batch));
+    assert(batch.empty());
+    return;
+  }
+
+  /* Split the batch across the broker's connections, preserving the order of
+     messages within each connection's share. */
+  assert(broker.Chooser.GetConnectionCount() == connections.size());
+  std::vector<std::list<std::list<TMsg::TPtr>>> shares =
+      broker.Chooser.Split(std::move(batch));
   assert(batch.empty());
+
+  for (size_t i = 0; i < shares.size(); ++i) {
+    if (!shares[i].empty()) {
+      assert(connections[i]);
+      connections[i]->DispatchNow(std::move(shares[i]));
+    }
+  }
 }
 
 void TKafkaDispatcher::StartSlowShutdown(uint64_t start_time) {
@@ -220,14 +288,18 @@ void TKafkaDispatcher::StartSlowShutdown(uint64_t start_time) {
   if (Connectors.empty()) {
     Ds.HandleAllThreadsFinished();
   } else {
-    for (std::unique_ptr<TConnector> &c : Connectors) {
-      assert(c);
-      c->StartSlowShutdown(start_time);
+    for (TBrokerConnections &broker : Connectors) {
+      for (std::unique_ptr<TConnector> &c : broker.Connections) {
+        assert(c);
+        c->StartSlowShutdown(start_time);
+      }
     }
 
-    for (std::unique_ptr<TConnector> &c : Connectors) {
-      assert(c);
-      c->WaitForShutdownAck();
+    for (TBrokerConnections &broker : Connectors) {
+      for (std::unique_ptr<TConnector> &c : broker.Connections) {
+        assert(c);
+        c->WaitForShutdownAck();
+      }
     }
   }
 
@@ -242,14 +314,18 @@ void TKafkaDispatcher::StartFastShutdown() {
   if (Connectors.empty()) {
     Ds.HandleAllThreadsFinished();
   } else {
-    for (std::unique_ptr<TConnector> &c : Connectors) {
-      assert(c);
-      c->StartFastShutdown();
+    for (TBrokerConnections &broker : Connectors) {
+      for (std::unique_ptr<TConnector> &c : broker.Connections) {
+        assert(c);
+        c->StartFastShutdown();
+      }
     }
 
-    for (std::unique_ptr<TConnector> &c : Connectors) {
-      assert(c);
-      c->WaitForShutdownAck();
+    for (TBrokerConnections &broker : Connectors) {
+      for (std::unique_ptr<TConnector> &c : broker.Connections) {
+        assert(c);
+        c->WaitForShutdownAck();
+      }
     }
   }
 
@@ -273,13 +349,15 @@ void TKafkaDispatcher::JoinAll() {
   syslog(LOG_NOTICE, "Start waiting for dispatcher shutdown status");
   bool ok_shutdown = true;
 
-  for (std::unique_ptr<TConnector> &c : Connectors) {
-    assert(c);
-    c->Join();
-    c->CleanupAfterJoin();
+  for (TBrokerConnections &broker : Connectors) {
+    for (std::unique_ptr<TConnector> &c : broker.Connections) {
+      assert(c);
+      c->Join();
+      c->CleanupAfterJoin();
 
-    if (!c->ShutdownWasOk()) {
-      ok_shutdown = false;
+      if (!c->ShutdownWasOk()) {
+        ok_shutdown = false;
+      }
     }
   }
 
@@ -312,8 +390,14 @@ TKafkaDispatcher::GetNoAckQueueAfterShutdown(size_t broker_index) {
     return std::list<std::list<TMsg::TPtr>>();
   }
 
-  assert(Connectors[broker_index]);
-  return Connectors[broker_index]->GetNoAckQueueAfterShutdown();
+  std::list<std::list<TMsg::TPtr>> result;
+
+  for (auto &c : Connectors[broker_index].Connections) {
+    assert(c);
+    result.splice(result.end(), c->GetNoAckQueueAfterShutdown());
+  }
+
+  return std::move(result);
 }
 
 std::list<std::list<TMsg::TPtr>>
@@ -330,8 +414,14 @@ TKafkaDispatcher::GetSendWaitQueueAfterShutdown(size_t broker_index) {
     return std::list<std::list<TMsg::TPtr>>();
   }
 
-  assert(Connectors[broker_index]);
-  return Connectors[broker_index]->GetSendWaitQueueAfterShutdown();
+  std::list<std::list<TMsg::TPtr>> result;
+
+  for (auto &c : Connectors[broker_index].Connections) {
+    assert(c);
+    result.splice(result.end(), c->GetSendWaitQueueAfterShutdown());
+  }
+
+  return std::move(result);
 }
 
 size_t TKafkaDispatcher::GetAckCount() const {
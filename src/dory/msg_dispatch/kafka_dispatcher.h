@@ -33,17 +33,23 @@
 #include <base/fd.h>
 #include <base/no_copy_semantics.h>
 #include <dory/anomaly_tracker.h>
+#include <dory/batch/adaptive_batch_stats.h>
 #include <dory/batch/global_batch_config.h>
+#include <dory/conf/broker_connections_conf.h>
+#include <dory/compression_stats.h>
 #include <dory/conf/compression_conf.h>
 #include <dory/config.h>
 #include <dory/debug/debug_setup.h>
+#include <dory/idempotent_producer.h>
 #include <dory/kafka_proto/produce/produce_protocol.h>
 #include <dory/metadata.h>
 #include <dory/msg.h>
+#include <dory/msg_dispatch/connection_chooser.h>
 #include <dory/msg_dispatch/connector.h>
 #include <dory/msg_dispatch/dispatcher_shared_state.h>
 #include <dory/msg_dispatch/kafka_dispatcher_api.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/priority_lane_stats.h>
 
 namespace Dory {
 
@@ -55,8 +61,13 @@ namespace Dory {
       public:
       TKafkaDispatcher(const TConfig &config,
           const Conf::TCompressionConf &compression_conf,
+          const Conf::TBrokerConnectionsConf &broker_connections_conf,
           TMsgStateTracker &msg_state_tracker,
           TAnomalyTracker &anomaly_tracker,
+          TCompressionStats &compression_stats,
+          TPriorityLaneStats &lane_stats,
+          Batch::TAdaptiveBatchStats &adaptive_batch_stats,
+          TIdempotentProducer &idempotent_producer,
           const Batch::TGlobalBatchConfig &batch_config,
           const Debug::TDebugSetup &debug_setup);
 
@@ -65,6 +76,13 @@ namespace Dory {
       void SetProduceProtocol(
           KafkaProto::Produce::TProduceProtocol *protocol) noexcept override;
 
+      virtual void SetConfig(const Conf::TCompressionConf &compression_conf,
+          const Conf::TBrokerConnectionsConf &broker_connections_conf,
+          const Batch::TGlobalBatchConfig &batch_config) override;
+
+      virtual void UpdateConfig(const Conf::TCompressionConf &compression_conf,
+          const Batch::TGlobalBatchConfig &batch_config) override;
+
       virtual TState GetState() const override;
 
       virtual size_t GetBrokerCount() const override;
@@ -99,13 +117,32 @@ namespace Dory {
       virtual size_t GetAckCount() const override;
 
       private:
+      /* The connector threads for a single broker.  Each has its own TCP
+         connection. */
+      struct TBrokerConnections {
+        std::vector<std::unique_ptr<TConnector>> Connections;
+
+        /* Chooses the element of 'Connections' that gets each message or
+           batch. */
+        TConnectionChooser Chooser;
+
+        TBrokerConnections() = default;
+
+        TBrokerConnections(TBrokerConnections &&) = default;
+
+        TBrokerConnections &operator=(TBrokerConnections &&) = default;
+      };  // TBrokerConnections
+
       TDispatcherSharedState Ds;
 
+      Conf::TBrokerConnectionsConf BrokerConnectionsConf;
+
       TState State;
 
       bool OkShutdown;
 
-      std::vector<std::unique_ptr<TConnector>> Connectors;
+      /* Indexed by broker index. */
+      std::vector<TBrokerConnections> Connectors;
     };  // TKafkaDispatcher
 
   }  // MsgDispatch
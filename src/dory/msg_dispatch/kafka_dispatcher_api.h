@@ -28,6 +28,9 @@
 
 #include <base/fd.h>
 #include <base/no_copy_semantics.h>
+#include <dory/batch/global_batch_config.h>
+#include <dory/conf/broker_connections_conf.h>
+#include <dory/conf/compression_conf.h>
 #include <dory/kafka_proto/produce/produce_protocol.h>
 #include <dory/metadata.h>
 #include <dory/msg.h>
@@ -50,6 +53,22 @@ namespace Dory {
       virtual void SetProduceProtocol(
           KafkaProto::Produce::TProduceProtocol *protocol) noexcept = 0;
 
+      /* Replace the compression, broker connection count, and broker-level
+         batching config.  This may only be called while the dispatcher is
+         stopped.  Connector threads created by the next call to Start() will
+         use the new config. */
+      virtual void SetConfig(const Conf::TCompressionConf &compression_conf,
+          const Conf::TBrokerConnectionsConf &broker_connections_conf,
+          const Batch::TGlobalBatchConfig &batch_config) = 0;
+
+      /* Replace the compression and broker-level batching config without
+         stopping the dispatcher.  Each connector thread swaps in the new
+         config before building its next produce request, keeping its queued
+         and unacknowledged messages.  Unlike SetConfig(), this may be called
+         in any state. */
+      virtual void UpdateConfig(const Conf::TCompressionConf &compression_conf,
+          const Batch::TGlobalBatchConfig &batch_config) = 0;
+
       virtual TState GetState() const = 0;
 
       virtual size_t GetBrokerCount() const = 0;
@@ -21,11 +21,13 @@
 
 #include <dory/msg_dispatch/produce_request_factory.h>
 
+#include <chrono>
 #include <utility>
 
 #include <syslog.h>
 
 #include <base/no_default_case.h>
+#include <base/time_util.h>
 #include <dory/util/time_util.h>
 #include <server/counter.h>
 
@@ -45,6 +47,7 @@ SERVER_COUNTER(BugMsgSetEmpty);
 SERVER_COUNTER(BugMultiPartitionGroupEmpty);
 SERVER_COUNTER(MsgSetCompressionError);
 SERVER_COUNTER(MsgSetCompressionNo);
+SERVER_COUNTER(MsgSetCompressionSkipped);
 SERVER_COUNTER(MsgSetCompressionYes);
 SERVER_COUNTER(MsgSetNotCompressible);
 SERVER_COUNTER(SerializeMsg);
@@ -55,6 +58,8 @@ SERVER_COUNTER(SerializeTopicGroup);
 TProduceRequestFactory::TProduceRequestFactory(const TConfig &config,
     const TGlobalBatchConfig &batch_config,
     const TCompressionConf &compression_conf,
+    TCompressionStats &compression_stats, TPriorityLaneStats &lane_stats,
+    TIdempotentProducer &idempotent_producer,
     const std::shared_ptr<TProduceProtocol> &produce_protocol,
     size_t broker_index)
     : Config(config),
@@ -64,10 +69,14 @@ TProduceRequestFactory::TProduceRequestFactory(const TConfig &config,
       MessageMaxBytes(batch_config.GetMessageMaxBytes()),
       SingleMsgOverhead(produce_protocol->GetSingleMsgOverhead()),
       MaxCompressionRatio(compression_conf.GetSizeThresholdPercent() / 100.0f),
+      CompressionStats(compression_stats),
+      LaneStats(lane_stats),
+      IdempotentProducer(idempotent_producer),
       RequestWriter(produce_protocol->CreateProduceRequestWriter()),
       MsgSetWriter(produce_protocol->CreateMsgSetWriter()),
       DefaultTopicCompressionInfo(compression_conf.GetDefaultTopicConfig()),
-      CorrIdCounter(0) {
+      CorrIdCounter(0),
+      NextDeadline(UINT64_MAX) {
   InitTopicDataMap(compression_conf);
 }
 
@@ -89,6 +98,106 @@ void TProduceRequestFactory::Reset() {
   TopicDataMap.clear();
 }
 
+void TProduceRequestFactory::SetConfig(const TGlobalBatchConfig &batch_config,
+    const TCompressionConf &compression_conf) {
+  assert(this);
+  ProduceRequestDataLimit = batch_config.GetProduceRequestDataLimit();
+  MessageMaxBytes = batch_config.GetMessageMaxBytes();
+  MaxCompressionRatio = compression_conf.GetSizeThresholdPercent() / 100.0f;
+  DefaultTopicCompressionInfo =
+      TCompressionInfo(compression_conf.GetDefaultTopicConfig());
+  InitTopicDataMap(compression_conf);
+}
+
+static TPriorityLaneStats::TLane
+GetLaneId(const std::list<TMsg::TPtr> &batch) {
+  return (!batch.empty() && batch.front()->IsHighPriority()) ?
+      TPriorityLaneStats::TLane::High : TPriorityLaneStats::TLane::Low;
+}
+
+void TProduceRequestFactory::Put(std::list<TMsg::TPtr> &&batch) {
+  assert(this);
+  LaneStats.AddQueued(GetLaneId(batch), batch.size());
+  UpdateNextDeadline(batch);
+  GetLane(batch).push_back(std::move(batch));
+}
+
+void TProduceRequestFactory::Put(
+    std::list<std::list<TMsg::TPtr>> &&batch_list) {
+  assert(this);
+  std::list<std::list<TMsg::TPtr>> high_priority;
+  SplitLanes(batch_list, high_priority);
+  HighPriorityQueue.splice(HighPriorityQueue.end(), std::move(high_priority));
+  InputQueue.splice(InputQueue.end(), std::move(batch_list));
+}
+
+void TProduceRequestFactory::PutFront(std::list<TMsg::TPtr> &&batch) {
+  assert(this);
+  LaneStats.AddQueued(GetLaneId(batch), batch.size());
+  UpdateNextDeadline(batch);
+  GetLane(batch).push_front(std::move(batch));
+}
+
+void TProduceRequestFactory::PutFront(
+    std::list<std::list<TMsg::TPtr>> &&batch_list) {
+  assert(this);
+  std::list<std::list<TMsg::TPtr>> high_priority;
+  SplitLanes(batch_list, high_priority);
+  HighPriorityQueue.splice(HighPriorityQueue.begin(),
+      std::move(high_priority));
+  InputQueue.splice(InputQueue.begin(), std::move(batch_list));
+}
+
+static size_t CountMsgs(const std::list<std::list<TMsg::TPtr>> &batch_list) {
+  size_t count = 0;
+
+  for (const auto &batch : batch_list) {
+    count += batch.size();
+  }
+
+  return count;
+}
+
+std::list<std::list<TMsg::TPtr>> TProduceRequestFactory::GetAll() {
+  assert(this);
+  LaneStats.RemoveQueued(TPriorityLaneStats::TLane::High,
+      CountMsgs(HighPriorityQueue));
+  LaneStats.RemoveQueued(TPriorityLaneStats::TLane::Low,
+      CountMsgs(InputQueue));
+  std::list<std::list<TMsg::TPtr>> result(std::move(HighPriorityQueue));
+  result.splice(result.end(), std::move(InputQueue));
+  HighPriorityQueue.clear();
+  InputQueue.clear();
+  NextDeadline = UINT64_MAX;
+  return std::move(result);
+}
+
+std::list<TMsg::TPtr> TProduceRequestFactory::TakeExpiredMsgs(uint64_t now) {
+  assert(this);
+  std::list<TMsg::TPtr> result;
+
+  if (now <= NextDeadline) {
+    return std::move(result);
+  }
+
+  NextDeadline = Util::TakeExpiredMsgs(HighPriorityQueue, now, result);
+
+  if (!result.empty()) {
+    LaneStats.RemoveQueued(TPriorityLaneStats::TLane::High, result.size());
+  }
+
+  size_t high_count = result.size();
+  NextDeadline = std::min(NextDeadline,
+      Util::TakeExpiredMsgs(InputQueue, now, result));
+
+  if (result.size() > high_count) {
+    LaneStats.RemoveQueued(TPriorityLaneStats::TLane::Low,
+        result.size() - high_count);
+  }
+
+  return std::move(result);
+}
+
 TOpt<TProduceRequest> TProduceRequestFactory::BuildRequest(
     std::vector<uint8_t> &dst) {
   assert(this);
@@ -128,9 +237,15 @@ TOpt<TProduceRequest> TProduceRequestFactory::BuildRequest(
     assert(!partition_group.empty());
 
     for (const auto &partition_group_elem : partition_group) {
+      const TMsgSet &msg_set = partition_group_elem.second;
       RequestWriter->OpenMsgSet(partition_group_elem.first);
-      WriteOneMsgSet(partition_group_elem.second,
-          GetTopicData(topic).CompressionInfo, dst);
+      RequestWriter->SetMsgSetInfo(msg_set.Contents.size(),
+          IdempotentProducer.IsEnabled() ?
+              IdempotentProducer.AssignSequences(topic,
+                  partition_group_elem.first, msg_set.Contents) :
+              TProducerSequence());
+      WriteOneMsgSet(topic, msg_set, GetTopicData(topic).CompressionInfo,
+          dst);
       RequestWriter->CloseMsgSet();
       SerializeMsgSet.Increment();
     }
@@ -278,26 +393,59 @@ static void SanityCheckRequestContents(TAllTopics &contents) {
   }
 }
 
+void TProduceRequestFactory::SplitLanes(
+    std::list<std::list<TMsg::TPtr>> &batch_list,
+    std::list<std::list<TMsg::TPtr>> &high_priority) {
+  assert(this);
+  size_t high_count = 0;
+  size_t low_count = 0;
+
+  for (auto iter = batch_list.begin(), next = iter;
+       iter != batch_list.end();
+       iter = next) {
+    ++next;
+    UpdateNextDeadline(*iter);
+
+    if (GetLaneId(*iter) == TPriorityLaneStats::TLane::High) {
+      high_count += iter->size();
+      high_priority.splice(high_priority.end(), batch_list, iter);
+    } else {
+      low_count += iter->size();
+    }
+  }
+
+  if (high_count) {
+    LaneStats.AddQueued(TPriorityLaneStats::TLane::High, high_count);
+  }
+
+  if (low_count) {
+    LaneStats.AddQueued(TPriorityLaneStats::TLane::Low, low_count);
+  }
+}
+
 size_t TProduceRequestFactory::AddFirstMsg(TAllTopics &result) {
   assert(this);
-  assert(!InputQueue.empty());
+  assert(!IsEmpty());
+  std::list<std::list<TMsg::TPtr>> &queue =
+      HighPriorityQueue.empty() ? InputQueue : HighPriorityQueue;
   TMsg::TPtr msg_ptr;
 
   {
-    std::list<TMsg::TPtr> &first_batch = InputQueue.front();
+    std::list<TMsg::TPtr> &first_batch = queue.front();
     assert(!first_batch.empty());
     msg_ptr = std::move(first_batch.front());
     first_batch.pop_front();
 
     if (first_batch.empty()) {
-      InputQueue.pop_front();
+      queue.pop_front();
     }
   }
 
   const std::string &topic = msg_ptr->GetTopic();
   TTopicData &topic_data = GetTopicData(topic);
 
-  if (msg_ptr->GetRoutingType() == TMsg::TRoutingType::AnyPartition) {
+  if ((msg_ptr->GetRoutingType() == TMsg::TRoutingType::AnyPartition) &&
+      !IdempotentProducer.HoldsCurrentSequence(*msg_ptr)) {
     msg_ptr->SetPartition(topic_data.AnyPartitionChooser.GetChoice(BrokerIndex,
         *Metadata, topic));
     topic_data.AnyPartitionChooser.SetChoiceUsed();
@@ -321,8 +469,11 @@ bool TProduceRequestFactory::TryConsumeFrontMsg(
   assert(this);
   assert(!next_batch.empty());
   TMsg::TPtr &msg_ptr = next_batch.front();
+  /* A resent message whose sequence number still applies must go back to
+     the same partition, or the broker can't detect a duplicate. */
   bool any_partition =
-      (msg_ptr->GetRoutingType() == TMsg::TRoutingType::AnyPartition);
+      (msg_ptr->GetRoutingType() == TMsg::TRoutingType::AnyPartition) &&
+      !IdempotentProducer.HoldsCurrentSequence(*msg_ptr);
 
   if (any_partition) {
     msg_ptr->SetPartition(topic_data.AnyPartitionChooser.GetChoice(BrokerIndex,
@@ -364,56 +515,67 @@ bool TProduceRequestFactory::TryConsumeFrontMsg(
   return true;
 }
 
-TAllTopics TProduceRequestFactory::BuildRequestContents() {
+bool TProduceRequestFactory::ConsumeQueue(
+    std::list<std::list<TMsg::TPtr>> &queue, size_t &result_data_size,
+    TAllTopics &result) {
   assert(this);
-  assert(!InputQueue.empty());
-  TAllTopics result;
-  size_t result_data_size = AddFirstMsg(result);
+  bool result_full = false;
 
-  /* Once we have reached the data limit for an entire request, we can't add
-     any more messages.  However, we allow a single message by itself to exceed
-     the limit.  We don't check 'MessageMaxBytes' here because no single
-     message that large will get this far. */
-  if (result_data_size < ProduceRequestDataLimit) {
-    bool result_full = false;
-
-    while (!InputQueue.empty()) {
-      std::list<TMsg::TPtr> &next_batch = InputQueue.front();
-      assert(!next_batch.empty());
-      const std::string &topic = next_batch.front()->GetTopic();
-      TTopicData &topic_data = GetTopicData(topic);
-
-      for (; ; ) {
-        TMsg::TPtr &msg_ptr = next_batch.front();
-
-        if (msg_ptr->GetTopic() != topic) {
-          /* We should _never_ get here. */
-          if (MultipleTopicBugFixup(InputQueue)) {
-            break;
-          }
-
-          continue;
-        }
+  while (!queue.empty()) {
+    std::list<TMsg::TPtr> &next_batch = queue.front();
+    assert(!next_batch.empty());
+    const std::string &topic = next_batch.front()->GetTopic();
+    TTopicData &topic_data = GetTopicData(topic);
 
-        result_full = !TryConsumeFrontMsg(next_batch, topic, topic_data,
-                                          result_data_size, result);
+    for (; ; ) {
+      TMsg::TPtr &msg_ptr = next_batch.front();
 
-        if (result_full) {
+      if (msg_ptr->GetTopic() != topic) {
+        /* We should _never_ get here. */
+        if (MultipleTopicBugFixup(queue)) {
           break;
         }
 
-        next_batch.pop_front();
-
-        if (next_batch.empty()) {
-          InputQueue.pop_front();
-          break;
-        }
+        continue;
       }
 
+      result_full = !TryConsumeFrontMsg(next_batch, topic, topic_data,
+                                        result_data_size, result);
+
       if (result_full) {
         break;
       }
+
+      next_batch.pop_front();
+
+      if (next_batch.empty()) {
+        queue.pop_front();
+        break;
+      }
     }
+
+    if (result_full) {
+      break;
+    }
+  }
+
+  return result_full;
+}
+
+TAllTopics TProduceRequestFactory::BuildRequestContents() {
+  assert(this);
+  assert(!IsEmpty());
+  TAllTopics result;
+  size_t result_data_size = AddFirstMsg(result);
+
+  /* Once we have reached the data limit for an entire request, we can't add
+     any more messages.  However, we allow a single message by itself to exceed
+     the limit.  We don't check 'MessageMaxBytes' here because no single
+     message that large will get this far.  The high priority lane is drained
+     first. */
+  if ((result_data_size < ProduceRequestDataLimit) &&
+      !ConsumeQueue(HighPriorityQueue, result_data_size, result)) {
+    ConsumeQueue(InputQueue, result_data_size, result);
   }
 
   for (auto &elem : result) {
@@ -421,9 +583,36 @@ TAllTopics TProduceRequestFactory::BuildRequestContents() {
   }
 
   SanityCheckRequestContents(result);
+  RecordLaneStats(result);
   return std::move(result);
 }
 
+void TProduceRequestFactory::RecordLaneStats(const TAllTopics &contents) {
+  assert(this);
+  uint64_t now = GetMonotonicRawMilliseconds();
+  size_t count[2] = {0, 0};
+  uint64_t total_latency[2] = {0, 0};
+  uint64_t max_latency[2] = {0, 0};
+
+  for (const auto &topic_elem : contents) {
+    for (const auto &group_elem : topic_elem.second) {
+      for (const TMsg::TPtr &msg_ptr : group_elem.second.Contents) {
+        size_t i = msg_ptr->IsHighPriority() ? 0 : 1;
+        uint64_t created = msg_ptr->GetCreationTimestamp();
+        uint64_t latency = (now > created) ? (now - created) : 0;
+        ++count[i];
+        total_latency[i] += latency;
+        max_latency[i] = std::max(max_latency[i], latency);
+      }
+    }
+  }
+
+  LaneStats.RecordSent(TPriorityLaneStats::TLane::High, count[0],
+      total_latency[0], max_latency[0]);
+  LaneStats.RecordSent(TPriorityLaneStats::TLane::Low, count[1],
+      total_latency[1], max_latency[1]);
+}
+
 void TProduceRequestFactory::SerializeUncompressedMsgSet(
     const std::list<TMsg::TPtr> &msg_set, std::vector<uint8_t> &dst) {
   assert(this);
@@ -473,68 +662,90 @@ void TProduceRequestFactory::SerializeToCompressionBuf(
   MsgSetWriter->CloseMsgSet();
 }
 
-void TProduceRequestFactory::WriteOneMsgSet(const TMsgSet &msg_set,
+bool TProduceRequestFactory::TryWriteCompressedMsgSet(
+    const std::string &topic, const TMsgSet &msg_set,
     const TCompressionInfo &info, std::vector<uint8_t> &dst) {
   assert(this);
+  assert(info.CompressionCodec);
 
-  if (info.CompressionCodec && (msg_set.DataSize >= info.MinCompressionSize)) {
-    SerializeToCompressionBuf(msg_set.Contents);
-    assert(info.CompressionCodec);
-    const TCompressionCodecApi &codec = *info.CompressionCodec;
-    bool msg_opened = false;
-
-    try {
-      /* Kafka compresses individual message sets.  A message set is compressed
-         and encapsulated within a single message whose attributes are set to
-         indicate that it contains a compressed message set. */
-      size_t max_compressed_size = codec.ComputeCompressedResultBufSpace(
-          &CompressionBuf[0], CompressionBuf.size(), info.CompressionLevel);
-      RequestWriter->OpenMsg(info.CompressionType, 0,
-          max_compressed_size);
-      msg_opened = true;
-      size_t value_offset = RequestWriter->GetCurrentMsgValueOffset();
-      assert(dst.size() >= value_offset);
-      assert((dst.size() - value_offset) == max_compressed_size);
-      size_t compressed_size = codec.Compress(&CompressionBuf[0],
-          CompressionBuf.size(), &dst[value_offset], max_compressed_size,
-          info.CompressionLevel);
-      /* If we get this far, compression finished without errors. */
-
-      float compression_ratio = static_cast<float>(compressed_size) /
-          static_cast<float>(CompressionBuf.size());
-
-      if (compression_ratio <= MaxCompressionRatio) {
-        /* Send the data compressed. */
-        RequestWriter->AdjustValueSize(compressed_size);
-        RequestWriter->CloseMsg();
-        MsgSetCompressionYes.Increment();
-        return;
-      }
+  if (!CompressionStats.ShouldCompress(topic)) {
+    /* This topic has recently compressed poorly, so don't waste CPU cycles
+       trying.  CompressionStats occasionally lets a message set through as a
+       probe, so we notice if the topic starts compressing well. */
+    MsgSetCompressionSkipped.Increment();
+    return false;
+  }
 
-      /* If we get here, we wasted some CPU cycles on data that didn't compress
-         very well.  Send it uncompressed so the broker avoids wasting more CPU
-         cycles dealing with the compression.
+  SerializeToCompressionBuf(msg_set.Contents);
+  const TCompressionCodecApi &codec = *info.CompressionCodec;
+  bool msg_opened = false;
+
+  try {
+    /* Kafka compresses individual message sets.  A message set is compressed
+       and encapsulated within a single message whose attributes are set to
+       indicate that it contains a compressed message set. */
+    size_t max_compressed_size = codec.ComputeCompressedResultBufSpace(
+        &CompressionBuf[0], CompressionBuf.size(), info.CompressionLevel);
+    RequestWriter->OpenMsg(info.CompressionType, 0, max_compressed_size);
+    msg_opened = true;
+    size_t value_offset = RequestWriter->GetCurrentMsgValueOffset();
+    assert(dst.size() >= value_offset);
+    assert((dst.size() - value_offset) == max_compressed_size);
+    auto start = std::chrono::steady_clock::now();
+    size_t compressed_size = codec.Compress(&CompressionBuf[0],
+        CompressionBuf.size(), &dst[value_offset], max_compressed_size,
+        info.CompressionLevel);
+    /* If we get this far, compression finished without errors. */
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CompressionStats.RecordCompression(topic, CompressionBuf.size(),
+        compressed_size,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            elapsed).count(),
+        MaxCompressionRatio);
+
+    float compression_ratio = static_cast<float>(compressed_size) /
+        static_cast<float>(CompressionBuf.size());
+
+    if (compression_ratio <= MaxCompressionRatio) {
+      /* Send the data compressed. */
+      RequestWriter->AdjustValueSize(compressed_size);
+      RequestWriter->CloseMsg();
+      MsgSetCompressionYes.Increment();
+      return true;
+    }
 
-         TODO: Add a per-topic compression statistics reporting feature to
-         Dory's web interface.  This would facilitate identifying topics that
-         don't compress very well, so Dory's compression config can be
-         adjusted. */
+    /* If we get here, we wasted some CPU cycles on data that didn't compress
+       very well.  Send it uncompressed so the broker avoids wasting more CPU
+       cycles dealing with the compression.  If this keeps happening,
+       CompressionStats will have us stop trying for this topic. */
+    RequestWriter->RollbackOpenMsg();
+    MsgSetNotCompressible.Increment();
+  } catch (const TCompressionCodecApi::TError &x) {
+    MsgSetCompressionError.Increment();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Error compressing message set: %s", x.what());
+    }
+
+    if (msg_opened) {
       RequestWriter->RollbackOpenMsg();
-      MsgSetNotCompressible.Increment();
-    } catch (const TCompressionCodecApi::TError &x) {
-      MsgSetCompressionError.Increment();
-      static TLogRateLimiter lim(std::chrono::seconds(30));
+    }
 
-      if (lim.Test()) {
-        syslog(LOG_ERR, "Error compressing message set: %s", x.what());
-      }
+    /* As a fallback, send the data uncompressed. */
+  }
 
-      if (msg_opened) {
-        RequestWriter->RollbackOpenMsg();
-      }
+  return false;
+}
 
-      /* As a fallback, send the data uncompressed. */
-    }
+void TProduceRequestFactory::WriteOneMsgSet(const std::string &topic,
+    const TMsgSet &msg_set, const TCompressionInfo &info,
+    std::vector<uint8_t> &dst) {
+  assert(this);
+
+  if (info.CompressionCodec && (msg_set.DataSize >= info.MinCompressionSize) &&
+      TryWriteCompressedMsgSet(topic, msg_set, info, dst)) {
+    return;
   }
 
   SerializeUncompressedMsgSet(msg_set.Contents, dst);
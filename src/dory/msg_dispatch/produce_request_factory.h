@@ -38,9 +38,11 @@
 #include <dory/compress/compression_codec_api.h>
 #include <dory/compress/compression_type.h>
 #include <dory/compress/get_compression_codec.h>
+#include <dory/compression_stats.h>
 #include <dory/conf/compression_conf.h>
 #include <dory/config.h>
 #include <dory/debug/debug_logger.h>
+#include <dory/idempotent_producer.h>
 #include <dory/kafka_proto/produce/msg_set_writer_api.h>
 #include <dory/kafka_proto/produce/produce_protocol.h>
 #include <dory/kafka_proto/produce/produce_request_writer_api.h>
@@ -48,6 +50,7 @@
 #include <dory/msg.h>
 #include <dory/msg_dispatch/any_partition_chooser.h>
 #include <dory/msg_dispatch/common.h>
+#include <dory/priority_lane_stats.h>
 #include <dory/util/msg_util.h>
 
 namespace Dory {
@@ -61,6 +64,9 @@ namespace Dory {
       TProduceRequestFactory(const TConfig &config,
           const Batch::TGlobalBatchConfig &batch_config,
           const Conf::TCompressionConf &compression_conf,
+          TCompressionStats &compression_stats,
+          TPriorityLaneStats &lane_stats,
+          TIdempotentProducer &idempotent_producer,
           const std::shared_ptr<KafkaProto::Produce::TProduceProtocol>
               &produce_protocol,
           size_t broker_index);
@@ -70,42 +76,44 @@ namespace Dory {
 
       void Reset();
 
+      /* Swap in new batching and compression config from a config file
+         reload.  Queued messages are kept, and the new config applies to
+         requests built from now on. */
+      void SetConfig(const Batch::TGlobalBatchConfig &batch_config,
+          const Conf::TCompressionConf &compression_conf);
+
       bool IsEmpty() const {
         assert(this);
-        return InputQueue.empty();
+        return HighPriorityQueue.empty() && InputQueue.empty();
       }
 
       /* Queue input message as a single item batch. */
       void Put(TMsg::TPtr &&msg);
 
-      /* Queue a single batch. */
-      void Put(std::list<TMsg::TPtr> &&batch) {
-        assert(this);
-        InputQueue.push_back(std::move(batch));
-      }
+      /* Queue a single batch.  Each batch goes in the high or low priority
+         lane according to the priority of its first message.  Batches only
+         contain messages for a single topic, so all of a batch's messages
+         have the same priority. */
+      void Put(std::list<TMsg::TPtr> &&batch);
 
       /* Queue multiple batches. */
-      void Put(std::list<std::list<TMsg::TPtr>> &&batch_list) {
-        assert(this);
-        InputQueue.splice(InputQueue.end(), std::move(batch_list));
-      }
+      void Put(std::list<std::list<TMsg::TPtr>> &&batch_list);
 
       /* Used for resending messages. */
-      void PutFront(std::list<TMsg::TPtr> &&batch) {
-        assert(this);
-        InputQueue.push_front(std::move(batch));
-      }
+      void PutFront(std::list<TMsg::TPtr> &&batch);
 
       /* Used for resending messages. */
-      void PutFront(std::list<std::list<TMsg::TPtr>> &&batch_list) {
-        assert(this);
-        InputQueue.splice(InputQueue.begin(), std::move(batch_list));
-      }
+      void PutFront(std::list<std::list<TMsg::TPtr>> &&batch_list);
 
-      std::list<std::list<TMsg::TPtr>> GetAll() {
-        assert(this);
-        return std::move(InputQueue);
-      }
+      /* Return the contents of both lanes, with high priority batches first.
+       */
+      std::list<std::list<TMsg::TPtr>> GetAll();
+
+      /* Remove and return all queued messages that have expired as of 'now',
+         a monotonic raw timestamp in milliseconds.  This is cheap when
+         nothing has expired, since the factory keeps track of the earliest
+         deadline among the first messages of its queued batches. */
+      std::list<TMsg::TPtr> TakeExpiredMsgs(uint64_t now);
 
       /* Build a produce request containing messages stored in the factory by
          previous calls to the above Put() and PutFront() methods.  If the
@@ -133,7 +141,11 @@ namespace Dory {
          request so that all messages are grouped first by topic and then by
          partition.  Then each message set has a unique topic/partition
          combination.  A single message set may contain a mixture of
-         AnyPartition and PartitionKey messages. */
+         AnyPartition and PartitionKey messages.
+
+         Messages in the high priority lane are always consumed first, so
+         they never wait behind queued low priority messages.  Any space left
+         in the request is filled from the low priority lane. */
       Base::TOpt<TProduceRequest> BuildRequest(std::vector<uint8_t> &dst);
 
       private:
@@ -166,22 +178,53 @@ namespace Dory {
 
       TTopicData &GetTopicData(const std::string &topic);
 
+      std::list<std::list<TMsg::TPtr>> &GetLane(
+          const std::list<TMsg::TPtr> &batch) {
+        assert(this);
+        return (!batch.empty() && batch.front()->IsHighPriority()) ?
+            HighPriorityQueue : InputQueue;
+      }
+
+      /* Move the high priority batches in 'batch_list' to the back of
+         'high_priority' and update the queued message counts for both lanes.
+         On return, 'batch_list' contains only low priority batches. */
+      void SplitLanes(std::list<std::list<TMsg::TPtr>> &batch_list,
+          std::list<std::list<TMsg::TPtr>> &high_priority);
+
+      void UpdateNextDeadline(const std::list<TMsg::TPtr> &batch) {
+        assert(this);
+        NextDeadline = std::min(NextDeadline, Util::GetMinDeadline(batch));
+      }
+
       size_t AddFirstMsg(TAllTopics &result);
 
       bool TryConsumeFrontMsg(std::list<TMsg::TPtr> &next_batch,
           const std::string &topic, TTopicData &topic_data,
           size_t &result_data_size, TAllTopics &result);
 
+      /* Add messages from 'queue' to 'result' until 'queue' is empty or the
+         request is full.  Returns true if the request is full. */
+      bool ConsumeQueue(std::list<std::list<TMsg::TPtr>> &queue,
+          size_t &result_data_size, TAllTopics &result);
+
       TAllTopics BuildRequestContents();
 
+      /* Update per-lane latency stats for messages in 'contents'. */
+      void RecordLaneStats(const TAllTopics &contents);
+
       void SerializeUncompressedMsgSet(const std::list<TMsg::TPtr> &msg_set,
           std::vector<uint8_t> &dst);
 
       void SerializeToCompressionBuf(const std::list<TMsg::TPtr> &msg_set);
 
-      void WriteOneMsgSet(const TMsgSet &msg_set, const TCompressionInfo &info,
+      /* Returns true if 'msg_set' was written compressed. */
+      bool TryWriteCompressedMsgSet(const std::string &topic,
+          const TMsgSet &msg_set, const TCompressionInfo &info,
           std::vector<uint8_t> &dst);
 
+      void WriteOneMsgSet(const std::string &topic, const TMsgSet &msg_set,
+          const TCompressionInfo &info, std::vector<uint8_t> &dst);
+
       const TConfig &Config;
 
       const size_t BrokerIndex;
@@ -189,16 +232,28 @@ namespace Dory {
       const std::shared_ptr<KafkaProto::Produce::TProduceProtocol>
           ProduceProtocol;
 
-      const size_t ProduceRequestDataLimit;
+      size_t ProduceRequestDataLimit;
 
-      const size_t MessageMaxBytes;
+      size_t MessageMaxBytes;
 
       const size_t SingleMsgOverhead;
 
       /* If (compressed message set size / uncompressed message set size)
          exceeds this value, then we send it uncompressed so the broker avoids
          spending CPU cycles dealing with the compression. */
-      const float MaxCompressionRatio;
+      float MaxCompressionRatio;
+
+      /* Shared with other connector threads.  Decides which topics are worth
+         compressing, and collects stats for the web interface. */
+      TCompressionStats &CompressionStats;
+
+      /* Shared with other connector threads.  Collects queue depth and latency
+         stats for the high and low priority lanes. */
+      TPriorityLaneStats &LaneStats;
+
+      /* Shared with other connector threads and the router thread.  Assigns
+         sequence numbers to message sets when idempotence is enabled. */
+      TIdempotentProducer &IdempotentProducer;
 
       const std::unique_ptr<KafkaProto::Produce::TProduceRequestWriterApi>
           RequestWriter;
@@ -213,9 +268,19 @@ namespace Dory {
       /* Correlation ID counter. */
       int32_t CorrIdCounter;
 
-      /* Batches of messages to be combined into produce requests. */
+      /* Batches of messages for high priority topics.  These are consumed
+         before anything in 'InputQueue'. */
+      std::list<std::list<TMsg::TPtr>> HighPriorityQueue;
+
+      /* Batches of messages to be combined into produce requests.  This is
+         the low priority lane, which holds messages for all topics not
+         configured as high priority. */
       std::list<std::list<TMsg::TPtr>> InputQueue;
 
+      /* No queued message can expire before this time.  UINT64_MAX when no
+         queued message has a deadline. */
+      uint64_t NextDeadline;
+
       /* Key is topic and value is TTopicData pertaining to topic. */
       std::unordered_map<std::string, TTopicData> TopicDataMap;
 
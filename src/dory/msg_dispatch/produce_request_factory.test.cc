@@ -0,0 +1,328 @@
+/* <dory/msg_dispatch/produce_request_factory.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/msg_dispatch/produce_request_factory.h>
+ */
+
+#include <dory/msg_dispatch/produce_request_factory.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/opt.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/batch/batch_config_builder.h>
+#include <dory/batch/global_batch_config.h>
+#include <dory/compress/compression_type.h>
+#include <dory/compression_stats.h>
+#include <dory/conf/compression_conf.h>
+#include <dory/config.h>
+#include <dory/discard_file_logger.h>
+#include <dory/idempotent_producer.h>
+#include <dory/kafka_proto/produce/produce_protocol.h>
+#include <dory/kafka_proto/produce/version_util.h>
+#include <dory/metadata.h>
+#include <dory/msg.h>
+#include <dory/msg_dispatch/common.h>
+#include <dory/priority_lane_stats.h>
+#include <dory/test_util/misc_util.h>
+#include <dory/util/msg_util.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Batch;
+using namespace Dory::Compress;
+using namespace Dory::Conf;
+using namespace Dory::KafkaProto::Produce;
+using namespace Dory::MsgDispatch;
+using namespace Dory::TestUtil;
+using namespace Dory::Util;
+
+namespace {
+
+  /* The fixture for testing class TProduceRequestFactory. */
+  class TProduceRequestFactoryTest : public ::testing::Test {
+    protected:
+    TProduceRequestFactoryTest() {
+    }
+
+    virtual ~TProduceRequestFactoryTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TProduceRequestFactoryTest
+
+  std::unique_ptr<TConfig> MakeConfig() {
+    std::vector<const char *> args;
+    args.push_back("dory");
+    args.push_back("--config_path");
+    args.push_back("/nonexistent/path");
+    args.push_back("--msg_buffer_max");
+    args.push_back("1");
+    args.push_back("--receive_socket_name");
+    args.push_back("dummy_value");
+    args.push_back(nullptr);
+    return std::unique_ptr<TConfig>(new TConfig(
+        static_cast<int>(args.size() - 1), const_cast<char **>(&args[0]),
+        true));
+  }
+
+  std::shared_ptr<TMetadata> MakeMetadata(
+      const std::vector<std::string> &topics) {
+    TMetadata::TBuilder builder;
+    builder.OpenBrokerList();
+    builder.AddBroker(1, "localhost", 9092);
+    builder.CloseBrokerList();
+
+    for (const std::string &topic : topics) {
+      builder.OpenTopic(topic);
+      builder.AddPartitionToTopic(0, 1, true, 0);
+      builder.CloseTopic();
+    }
+
+    return std::shared_ptr<TMetadata>(builder.Build());
+  }
+
+  /* Only room for one 100 byte message per produce request. */
+  TGlobalBatchConfig MakeBatchConfig() {
+    TBatchConfigBuilder batch_builder;
+    batch_builder.SetProduceRequestDataLimit(150);
+    batch_builder.SetMessageMaxBytes(1024);
+    return batch_builder.Build();
+  }
+
+  TCompressionConf MakeCompressionConf() {
+    TCompressionConf::TBuilder compression_builder;
+    compression_builder.AddNamedConfig("none", TCompressionType::None, 0,
+        TOpt<int>());
+    compression_builder.SetDefaultTopicConfig("none");
+    return compression_builder.Build();
+  }
+
+  std::list<TMsg::TPtr> MakeBatch(TTestMsgCreator &mc,
+      const std::string &topic, size_t msg_count, bool high_priority,
+      uint64_t deadline = UINT64_MAX) {
+    std::list<TMsg::TPtr> batch;
+
+    for (size_t i = 0; i < msg_count; ++i) {
+      TMsg::TPtr msg = mc.NewMsg(topic, std::string(100, 'x'), 0);
+      msg->SetHighPriority(high_priority);
+      msg->SetDeadline(deadline);
+      batch.push_back(std::move(msg));
+    }
+
+    return std::move(batch);
+  }
+
+  /* Returns the topic of the single message in 'request', and marks the
+     message as processed. */
+  std::string TakeSingleTopic(TProduceRequest &request) {
+    std::list<std::list<TMsg::TPtr>> msgs;
+    EmptyAllTopics(request.second, msgs);
+    EXPECT_EQ(msgs.size(), 1U);
+    EXPECT_EQ(msgs.front().size(), 1U);
+    std::string topic = msgs.front().front()->GetTopic();
+    SetProcessed(std::move(msgs));
+    return topic;
+  }
+
+  TEST_F(TProduceRequestFactoryTest, PriorityLanesTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    std::unique_ptr<TConfig> config = MakeConfig();
+    TGlobalBatchConfig batch_config = MakeBatchConfig();
+    TCompressionConf compression_conf = MakeCompressionConf();
+    std::shared_ptr<TProduceProtocol> protocol(ChooseProduceProto(0));
+    TCompressionStats compression_stats(0);
+    TPriorityLaneStats lane_stats;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TIdempotentProducer idempotent_producer(false, anomaly_tracker);
+    TProduceRequestFactory factory(*config, batch_config, compression_conf,
+        compression_stats, lane_stats, idempotent_producer, protocol, 0);
+    factory.Init(compression_conf, MakeMetadata({"bulk", "billing"}));
+    ASSERT_TRUE(factory.IsEmpty());
+
+    factory.Put(MakeBatch(mc, "bulk", 3, false));
+    std::list<std::list<TMsg::TPtr>> batch_list;
+    batch_list.push_back(MakeBatch(mc, "bulk", 2, false));
+    batch_list.push_back(MakeBatch(mc, "billing", 2, true));
+    factory.Put(std::move(batch_list));
+    ASSERT_FALSE(factory.IsEmpty());
+    ASSERT_EQ(
+        lane_stats.GetStats(TPriorityLaneStats::TLane::High).QueuedMsgCount,
+        2U);
+    ASSERT_EQ(
+        lane_stats.GetStats(TPriorityLaneStats::TLane::Low).QueuedMsgCount,
+        5U);
+
+    /* High priority messages go first even though they were queued last. */
+    std::vector<uint8_t> buf;
+    std::vector<std::string> topics;
+
+    for (size_t i = 0; i < 3; ++i) {
+      TOpt<TProduceRequest> request = factory.BuildRequest(buf);
+      ASSERT_TRUE(request.IsKnown());
+      topics.push_back(TakeSingleTopic(*request));
+    }
+
+    ASSERT_EQ(topics[0], "billing");
+    ASSERT_EQ(topics[1], "billing");
+    ASSERT_EQ(topics[2], "bulk");
+    TPriorityLaneStats::TLaneStats high =
+        lane_stats.GetStats(TPriorityLaneStats::TLane::High);
+    TPriorityLaneStats::TLaneStats low =
+        lane_stats.GetStats(TPriorityLaneStats::TLane::Low);
+    ASSERT_EQ(high.QueuedMsgCount, 0U);
+    ASSERT_EQ(high.SentMsgCount, 2U);
+    ASSERT_EQ(low.QueuedMsgCount, 4U);
+    ASSERT_EQ(low.SentMsgCount, 1U);
+
+    /* A high priority resend goes ahead of queued low priority messages. */
+    factory.PutFront(MakeBatch(mc, "billing", 1, true));
+    TOpt<TProduceRequest> request = factory.BuildRequest(buf);
+    ASSERT_TRUE(request.IsKnown());
+    ASSERT_EQ(TakeSingleTopic(*request), "billing");
+
+    /* GetAll() returns high priority batches first. */
+    factory.Put(MakeBatch(mc, "billing", 1, true));
+    std::list<std::list<TMsg::TPtr>> all = factory.GetAll();
+    ASSERT_TRUE(factory.IsEmpty());
+    ASSERT_EQ(all.size(), 3U);
+    ASSERT_TRUE(all.front().front()->IsHighPriority());
+    ASSERT_FALSE(all.back().front()->IsHighPriority());
+    SetProcessed(std::move(all));
+    ASSERT_EQ(
+        lane_stats.GetStats(TPriorityLaneStats::TLane::High).QueuedMsgCount,
+        0U);
+    ASSERT_EQ(
+        lane_stats.GetStats(TPriorityLaneStats::TLane::Low).QueuedMsgCount,
+        0U);
+  }
+
+  TEST_F(TProduceRequestFactoryTest, MaxAgeTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    std::unique_ptr<TConfig> config = MakeConfig();
+    TGlobalBatchConfig batch_config = MakeBatchConfig();
+    TCompressionConf compression_conf = MakeCompressionConf();
+    std::shared_ptr<TProduceProtocol> protocol(ChooseProduceProto(0));
+    TCompressionStats compression_stats(0);
+    TPriorityLaneStats lane_stats;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TIdempotentProducer idempotent_producer(false, anomaly_tracker);
+    TProduceRequestFactory factory(*config, batch_config, compression_conf,
+        compression_stats, lane_stats, idempotent_producer, protocol, 0);
+    factory.Init(compression_conf,
+        MakeMetadata({"short", "long", "forever", "billing"}));
+
+    factory.Put(MakeBatch(mc, "long", 2, false, 1000));
+    std::list<std::list<TMsg::TPtr>> batch_list;
+    batch_list.push_back(MakeBatch(mc, "forever", 1, false));
+    batch_list.push_back(MakeBatch(mc, "billing", 1, true, 100));
+    factory.Put(std::move(batch_list));
+    factory.PutFront(MakeBatch(mc, "short", 3, false, 100));
+
+    /* Nothing has expired yet. */
+    ASSERT_TRUE(factory.TakeExpiredMsgs(100).empty());
+
+    std::list<TMsg::TPtr> expired = factory.TakeExpiredMsgs(101);
+    ASSERT_EQ(expired.size(), 4U);
+    ASSERT_EQ(expired.front()->GetTopic(), "billing");
+    ASSERT_EQ(expired.back()->GetTopic(), "short");
+    SetProcessed(std::move(expired));
+    ASSERT_EQ(
+        lane_stats.GetStats(TPriorityLaneStats::TLane::High).QueuedMsgCount,
+        0U);
+    ASSERT_EQ(
+        lane_stats.GetStats(TPriorityLaneStats::TLane::Low).QueuedMsgCount,
+        3U);
+
+    /* Expired messages are not sent. */
+    std::vector<uint8_t> buf;
+    TOpt<TProduceRequest> request = factory.BuildRequest(buf);
+    ASSERT_TRUE(request.IsKnown());
+    ASSERT_EQ(TakeSingleTopic(*request), "long");
+    ASSERT_TRUE(factory.TakeExpiredMsgs(1000).empty());
+    expired = factory.TakeExpiredMsgs(1001);
+    ASSERT_EQ(expired.size(), 1U);
+    ASSERT_EQ(expired.front()->GetTopic(), "long");
+    SetProcessed(std::move(expired));
+
+    /* Messages for topics without a max age never expire. */
+    ASSERT_TRUE(factory.TakeExpiredMsgs(UINT64_MAX).empty());
+    std::list<std::list<TMsg::TPtr>> all = factory.GetAll();
+    ASSERT_TRUE(factory.IsEmpty());
+    ASSERT_EQ(all.size(), 1U);
+    ASSERT_EQ(all.front().front()->GetTopic(), "forever");
+    SetProcessed(std::move(all));
+  }
+
+  TEST_F(TProduceRequestFactoryTest, CombinedTopicsMaxAgeTest) {
+    TTestMsgCreator mc;  // create this first since it contains buffer pool
+    std::unique_ptr<TConfig> config = MakeConfig();
+    TGlobalBatchConfig batch_config = MakeBatchConfig();
+    TCompressionConf compression_conf = MakeCompressionConf();
+    std::shared_ptr<TProduceProtocol> protocol(ChooseProduceProto(0));
+    TCompressionStats compression_stats(0);
+    TPriorityLaneStats lane_stats;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TIdempotentProducer idempotent_producer(false, anomaly_tracker);
+    TProduceRequestFactory factory(*config, batch_config, compression_conf,
+        compression_stats, lane_stats, idempotent_producer, protocol, 0);
+    factory.Init(compression_conf, MakeMetadata({"short", "long"}));
+
+    /* A combined topics batch whose first message has the longer max age.
+       The messages with the shorter max age must still expire on time. */
+    std::list<TMsg::TPtr> batch = MakeBatch(mc, "long", 1, false, 1000);
+    batch.splice(batch.end(), MakeBatch(mc, "short", 2, false, 100));
+    batch.splice(batch.end(), MakeBatch(mc, "long", 1, false, 1000));
+    ASSERT_EQ(GetMinDeadline(batch), 100U);
+    factory.Put(std::move(batch));
+    ASSERT_TRUE(factory.TakeExpiredMsgs(100).empty());
+    std::list<TMsg::TPtr> expired = factory.TakeExpiredMsgs(101);
+    ASSERT_EQ(expired.size(), 2U);
+    ASSERT_EQ(expired.front()->GetTopic(), "short");
+    ASSERT_EQ(expired.back()->GetTopic(), "short");
+    SetProcessed(std::move(expired));
+
+    /* The rest of the batch expires at its own deadline. */
+    ASSERT_TRUE(factory.TakeExpiredMsgs(1000).empty());
+    expired = factory.TakeExpiredMsgs(1001);
+    ASSERT_EQ(expired.size(), 2U);
+    ASSERT_EQ(expired.front()->GetTopic(), "long");
+    SetProcessed(std::move(expired));
+    ASSERT_TRUE(factory.IsEmpty());
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -40,6 +40,7 @@ SERVER_COUNTER(ConnectorGotDiscardAndPauseAck);
 SERVER_COUNTER(ConnectorGotOkProduceResponse);
 SERVER_COUNTER(ConnectorGotPauseAck);
 SERVER_COUNTER(ConnectorGotResendAck);
+SERVER_COUNTER(ConnectorGotResetProducerAck);
 SERVER_COUNTER(ConnectorGotSuccessfulAck);
 SERVER_COUNTER(ConnectorQueueImmediateResendMsgSet);
 SERVER_COUNTER(ConnectorQueueNoAckMsgs);
@@ -316,6 +317,23 @@ bool TProduceResponseProcessor::ProcessOneAck(std::list<TMsg::TPtr> &&msg_set,
           TAnomalyTracker::TDiscardReason::KafkaErrorAck);
       return false;
     }
+    case TAckResultAction::ResetProducerAndPause: {
+      ConnectorGotResetProducerAck.Increment();
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+
+      if (lim.Test()) {
+        syslog(LOG_ERR, "Connector thread %d (index %lu broker %ld) got ACK "
+            "error that rejects producer ID or sequence number: topic [%s]",
+            static_cast<int>(Gettid()), MyBrokerIndex, MyBrokerId,
+            msg_set.front()->GetTopic().c_str());
+      }
+
+      /* The router thread will get a new producer ID when it fetches
+         metadata, and the messages will be renumbered when resent. */
+      Ds.IdempotentProducer.Reset(msg_set.front()->GetProducerGeneration());
+      ProcessPauseAndResendMsgSet(std::move(msg_set), topic);
+      return false;
+    }
     NO_DEFAULT_CASE;
   }
 
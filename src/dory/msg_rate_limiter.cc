@@ -19,6 +19,7 @@
    Implements <dory/msg_rate_limiter.h>.
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include <dory/msg_rate_limiter.h>
@@ -27,7 +28,7 @@ using namespace Dory;
 using namespace Dory::Conf;
 
 bool TMsgRateLimiter::WouldExceedLimit(const std::string &topic,
-    uint64_t timestamp) {
+    uint64_t timestamp, size_t msg_size) {
   assert(this);
 
   if (!IsEnabled) {
@@ -36,19 +37,24 @@ bool TMsgRateLimiter::WouldExceedLimit(const std::string &topic,
   }
 
   TTopicState &state = GetTopicState(topic, timestamp);
+
+  if (state.TokenBucket) {
+    return !TakeTokens(state, timestamp, msg_size);
+  }
+
   ++state.Count;
   return state.Enable && (state.Count > state.MaxCount);
 }
 
 bool TMsgRateLimiter::RateLimitingIsEnabled(const Conf::TTopicRateConf &conf) {
-  if (conf.GetDefaultTopicConfig().MaxCount.IsKnown()) {
+  if (conf.GetDefaultTopicConfig().IsLimited()) {
     return true;
   }
 
   const TTopicRateConf::TTopicMap &m = conf.GetTopicConfigs();
 
   for (const auto &elem : m) {
-    if (elem.second.MaxCount.IsKnown()) {
+    if (elem.second.IsLimited()) {
       return true;
     }
   }
@@ -56,6 +62,51 @@ bool TMsgRateLimiter::RateLimitingIsEnabled(const Conf::TTopicRateConf &conf) {
   return false;
 }
 
+void TMsgRateLimiter::Refill(int64_t &tokens, int64_t capacity,
+    uint64_t rate, uint64_t elapsed) {
+  if ((rate == 0) || (tokens >= capacity)) {
+    return;
+  }
+
+  /* Avoid overflow in the multiplication below when a topic has been idle for
+     a long time. */
+  uint64_t deficit = static_cast<uint64_t>(capacity - tokens);
+
+  if (elapsed > (deficit / rate)) {
+    tokens = capacity;
+  } else {
+    tokens += static_cast<int64_t>(elapsed * rate);
+  }
+}
+
+bool TMsgRateLimiter::TakeTokens(TTopicState &state, uint64_t timestamp,
+    size_t msg_size) {
+  /* Creation timestamps of messages from different clients may be slightly
+     out of order.  Treat an earlier timestamp as no time elapsed. */
+  if (timestamp > state.LastRefill) {
+    uint64_t elapsed = timestamp - state.LastRefill;
+    Refill(state.MsgTokens, state.MsgCapacity, state.MsgRate, elapsed);
+    Refill(state.ByteTokens, state.ByteCapacity, state.ByteRate, elapsed);
+    state.LastRefill = timestamp;
+  }
+
+  int64_t msg_cost = (state.MsgRate == 0) ? 0 : 1000;
+  int64_t byte_cost = (state.ByteRate == 0) ?
+      0 : static_cast<int64_t>(msg_size) * 1000;
+
+  /* A message larger than a full bucket is allowed when the bucket is full,
+     leaving the bucket in debt.  Otherwise such a message could never be
+     sent. */
+  if ((state.MsgTokens < std::min(msg_cost, state.MsgCapacity)) ||
+      (state.ByteTokens < std::min(byte_cost, state.ByteCapacity))) {
+    return false;
+  }
+
+  state.MsgTokens -= msg_cost;
+  state.ByteTokens -= byte_cost;
+  return true;
+}
+
 TMsgRateLimiter::TTopicState &
 TMsgRateLimiter::GetTopicState(const std::string &topic, uint64_t timestamp) {
   assert(this);
@@ -64,7 +115,8 @@ TMsgRateLimiter::GetTopicState(const std::string &topic, uint64_t timestamp) {
   if (iter != TopicStateMap.end()) {
     TTopicState &state = iter->second;
 
-    if (timestamp >= (state.IntervalStart + state.Interval)) {
+    if (!state.TokenBucket &&
+        (timestamp >= (state.IntervalStart + state.Interval))) {
       size_t interval_delta =
           (timestamp - state.IntervalStart) / state.Interval;
       state.IntervalStart += (interval_delta * state.Interval);
@@ -79,6 +131,26 @@ TMsgRateLimiter::GetTopicState(const std::string &topic, uint64_t timestamp) {
   const TTopicRateConf::TConf &conf = (map_iter == m.end()) ?
       Conf.GetDefaultTopicConfig() : map_iter->second;
   TTopicState &state = TopicStateMap[topic];
+
+  if (conf.IsTokenBucket()) {
+    state.TokenBucket = true;
+
+    if (conf.MsgRate.IsKnown()) {
+      state.MsgRate = *conf.MsgRate;
+      state.MsgCapacity = static_cast<int64_t>(*conf.MsgBurst) * 1000;
+    }
+
+    if (conf.ByteRate.IsKnown()) {
+      state.ByteRate = *conf.ByteRate;
+      state.ByteCapacity = static_cast<int64_t>(*conf.ByteBurst) * 1000;
+    }
+
+    state.MsgTokens = state.MsgCapacity;
+    state.ByteTokens = state.ByteCapacity;
+    state.LastRefill = timestamp;
+    return state;
+  }
+
   state.Enable = conf.MaxCount.IsKnown();
 
   if (state.Enable) {
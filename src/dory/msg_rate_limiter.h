@@ -40,7 +40,15 @@ namespace Dory {
      discard messages across many topics.  The goal of rate limiting is to
      contain the damage by discarding excess messages for topic T, preventing
      the Kafka cluster from becoming overwhelmed and forcing Dory to discard
-     messages for other topics. */
+     messages for other topics.
+
+     Each topic is limited either by a fixed window (at most a given number of
+     messages per interval) or by token buckets with separate message and byte
+     rates.  Token buckets allow bursts up to a configured size regardless of
+     where window boundaries fall, and byte limits catch topics that send a
+     few huge messages.  The clock is the message's creation timestamp, which
+     is taken once per message on input, so checking a message costs only a
+     hash lookup and a few arithmetic operations. */
   class TMsgRateLimiter final {
     NO_COPY_SEMANTICS(TMsgRateLimiter);
 
@@ -52,8 +60,13 @@ namespace Dory {
 
     /* Return true if forwarding a message with the given topic would cause the
        rate limit for the topic to be exceeded.  Otherwise return false.  The
-       message's rate limiting timestamp is given by 'timestamp'. */
-    bool WouldExceedLimit(const std::string &topic, uint64_t timestamp);
+       message's rate limiting timestamp is given by 'timestamp', in
+       milliseconds from a monotonic clock.  'msg_size' gives the message's
+       key and value size in bytes, and is only used by byte rate limits.  If
+       false is returned, the message is counted against the topic's limits.
+     */
+    bool WouldExceedLimit(const std::string &topic, uint64_t timestamp,
+        size_t msg_size = 0);
 
     private:
     /* Rate limiting state for a single topic. */
@@ -74,17 +87,61 @@ namespace Dory {
            'IntervalStart' */
         size_t Count;
 
+        /* true indicates that token buckets are used instead of the fixed
+           window above. */
+        bool TokenBucket;
+
+        /* Message and byte rates per second.  0 indicates no limit. */
+        uint64_t MsgRate;
+
+        uint64_t ByteRate;
+
+        /* Bucket sizes and current contents in thousandths of a message or
+           byte, so that refilling for each elapsed millisecond adds exactly
+           the per second rate.  The contents go negative when a message
+           larger than a full bucket is allowed, so such messages are still
+           limited to the configured average rate. */
+        int64_t MsgCapacity;
+
+        int64_t ByteCapacity;
+
+        int64_t MsgTokens;
+
+        int64_t ByteTokens;
+
+        /* Timestamp in milliseconds when the buckets were last refilled. */
+        uint64_t LastRefill;
+
         TTopicState()
             : Enable(false),
               Interval(1),
               MaxCount(0),
               IntervalStart(0),
-              Count(0) {
+              Count(0),
+              TokenBucket(false),
+              MsgRate(0),
+              ByteRate(0),
+              MsgCapacity(0),
+              ByteCapacity(0),
+              MsgTokens(0),
+              ByteTokens(0),
+              LastRefill(0) {
         }
     };  // TTopicState
 
     static bool RateLimitingIsEnabled(const Conf::TTopicRateConf &conf);
 
+    /* Add tokens accumulated over 'elapsed' milliseconds at 'rate' per second
+       to 'tokens', without exceeding 'capacity'. */
+    static void Refill(int64_t &tokens, int64_t capacity, uint64_t rate,
+        uint64_t elapsed);
+
+    /* Refill the topic's token buckets and take tokens for a message of
+       'msg_size' bytes.  Return true if the message is allowed, or false if
+       not enough tokens are available. */
+    static bool TakeTokens(TTopicState &state, uint64_t timestamp,
+        size_t msg_size);
+
     TTopicState &GetTopicState(const std::string &topic, uint64_t timestamp);
 
     /* Rate limiting config from config file. */
@@ -21,10 +21,12 @@
 
 #include <dory/msg_rate_limiter.h>
 
+#include <base/opt.h>
 #include <dory/conf/topic_rate_conf.h>
 
 #include <gtest/gtest.h>
 
+using namespace Base;
 using namespace Dory;
 using namespace Dory::Conf;
 
@@ -140,6 +142,90 @@ namespace {
     ASSERT_TRUE(lim.WouldExceedLimit("topic6", 174));
   }
 
+  TEST_F(TMsgRateLimiterTest, TokenBucketTest) {
+    TTopicRateConf::TBuilder b;
+    b.AddUnlimitedNamedConfig("default_conf");
+    b.AddTokenBucketNamedConfig("msgs", 2, 3, TOpt<size_t>(),
+        TOpt<size_t>());
+    b.AddTokenBucketNamedConfig("bytes", TOpt<size_t>(), TOpt<size_t>(),
+        1000, 2000);
+    b.AddTokenBucketNamedConfig("both", 1, TOpt<size_t>(), 100,
+        TOpt<size_t>());
+    b.SetDefaultTopicConfig("default_conf");
+    b.SetTopicConfig("m", "msgs");
+    b.SetTopicConfig("b", "bytes");
+    b.SetTopicConfig("x", "both");
+    TTopicRateConf conf = b.Build();
+    TMsgRateLimiter lim(conf);
+
+    for (size_t i = 0; i < 100; ++i) {
+      ASSERT_FALSE(lim.WouldExceedLimit("blah", 0, 1000000));
+    }
+
+    /* A full bucket allows a burst regardless of when it starts. */
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 1000));
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 1000));
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 1000));
+    ASSERT_TRUE(lim.WouldExceedLimit("m", 1000));
+    ASSERT_TRUE(lim.WouldExceedLimit("m", 1499));
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 1500));
+    ASSERT_TRUE(lim.WouldExceedLimit("m", 1500));
+
+    /* Refilling stops at the burst size. */
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 100000));
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 100000));
+    ASSERT_FALSE(lim.WouldExceedLimit("m", 100000));
+    ASSERT_TRUE(lim.WouldExceedLimit("m", 100000));
+
+    /* An earlier timestamp adds no tokens. */
+    ASSERT_TRUE(lim.WouldExceedLimit("m", 90000));
+
+    /* Byte limits count message sizes rather than messages. */
+    ASSERT_FALSE(lim.WouldExceedLimit("b", 0, 1500));
+    ASSERT_TRUE(lim.WouldExceedLimit("b", 0, 600));
+    ASSERT_FALSE(lim.WouldExceedLimit("b", 0, 500));
+    ASSERT_TRUE(lim.WouldExceedLimit("b", 0, 1));
+    ASSERT_FALSE(lim.WouldExceedLimit("b", 600, 600));
+    ASSERT_TRUE(lim.WouldExceedLimit("b", 600, 1));
+
+    /* A message larger than the burst size is allowed when the bucket is
+       full, but leaves the bucket in debt. */
+    ASSERT_FALSE(lim.WouldExceedLimit("b", 10000, 5000));
+    ASSERT_TRUE(lim.WouldExceedLimit("b", 12000, 1));
+    ASSERT_FALSE(lim.WouldExceedLimit("b", 15000, 2000));
+    ASSERT_TRUE(lim.WouldExceedLimit("b", 15000, 1));
+
+    /* With both limits, a message must pass both, and a rejected message
+       takes no tokens. */
+    ASSERT_FALSE(lim.WouldExceedLimit("x", 0, 10));
+    ASSERT_TRUE(lim.WouldExceedLimit("x", 0, 10));
+    ASSERT_FALSE(lim.WouldExceedLimit("x", 1000, 200));
+    ASSERT_TRUE(lim.WouldExceedLimit("x", 2000, 1));
+    ASSERT_FALSE(lim.WouldExceedLimit("x", 2000, 0));
+    ASSERT_TRUE(lim.WouldExceedLimit("x", 2000, 0));
+  }
+
+  TEST_F(TMsgRateLimiterTest, TokenBucketConfTest) {
+    TTopicRateConf::TBuilder b;
+    ASSERT_THROW(b.AddTokenBucketNamedConfig("c", 0, TOpt<size_t>(),
+        TOpt<size_t>(), TOpt<size_t>()),
+        TTopicRateConf::TBuilder::TZeroTokenBucketSetting);
+    ASSERT_THROW(b.AddTokenBucketNamedConfig("c", 10, 0, TOpt<size_t>(),
+        TOpt<size_t>()), TTopicRateConf::TBuilder::TZeroTokenBucketSetting);
+    ASSERT_THROW(b.AddTokenBucketNamedConfig("c", 10, TOpt<size_t>(),
+        TOpt<size_t>(), 100), TTopicRateConf::TBuilder::TBurstWithoutRate);
+    b.AddTokenBucketNamedConfig("c", 10, TOpt<size_t>(), 100, 500);
+    b.SetDefaultTopicConfig("c");
+    TTopicRateConf conf = b.Build();
+    const TTopicRateConf::TConf &c = conf.GetDefaultTopicConfig();
+    ASSERT_TRUE(c.IsTokenBucket());
+    ASSERT_FALSE(c.MaxCount.IsKnown());
+    ASSERT_EQ(*c.MsgRate, 10U);
+    ASSERT_EQ(*c.MsgBurst, 10U);
+    ASSERT_EQ(*c.ByteRate, 100U);
+    ASSERT_EQ(*c.ByteBurst, 500U);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -24,6 +24,7 @@
 #include <syslog.h>
 
 #include <base/no_default_case.h>
+#include <dory/journal/msg_journal.h>
 #include <dory/util/time_util.h>
 
 using namespace Base;
@@ -125,6 +126,11 @@ void TMsgStateTracker::MsgEnterAckWait(
 
 void TMsgStateTracker::MsgEnterProcessed(TMsg &msg) {
   assert(this);
+
+  if (MsgJournal) {
+    MsgJournal->Ack(msg);
+  }
+
   TDeltaComputer comp;
   comp.CountProcessedEntered(msg.GetState());
   msg.SetState(TMsg::TState::Processed);
@@ -139,6 +145,10 @@ void TMsgStateTracker::MsgEnterProcessed(
     return;
   }
 
+  if (MsgJournal) {
+    MsgJournal->Ack(msg_list);
+  }
+
   const std::string &topic = msg_list.front()->GetTopic();
   TDeltaComputer comp;
 
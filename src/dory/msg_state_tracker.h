@@ -34,6 +34,12 @@
 
 namespace Dory {
 
+  namespace Journal {
+
+    class TMsgJournal;
+
+  }  // Journal
+
   /* Singleton class for tracking info on message states.  If Kafka starts
      falling behind, this lets us see which topics are lagging. */
   class TMsgStateTracker final {
@@ -55,7 +61,16 @@ namespace Dory {
     };  // TTopicStats
 
     TMsgStateTracker()
-        : NewCount(0) {
+        : MsgJournal(nullptr),
+          NewCount(0) {
+    }
+
+    /* If 'journal' is not null, messages entering state
+       TMsg::TState::Processed are ACKed in it.  Must not be called while
+       other threads are using the tracker. */
+    void SetJournal(Journal::TMsgJournal *journal) {
+      assert(this);
+      MsgJournal = journal;
     }
 
     /* A brand new message has been created.  Update our stats to indicate
@@ -199,6 +214,9 @@ namespace Dory {
 
     void UpdateStats(const std::string &topic, const TDeltaComputer &comp);
 
+    /* If not null, processed messages are ACKed here. */
+    Journal::TMsgJournal *MsgJournal;
+
     /* Protects 'TopicStats' and 'NewCount'. */
     mutable std::mutex Mutex;
 
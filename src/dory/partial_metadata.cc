@@ -0,0 +1,115 @@
+/* <dory/partial_metadata.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/partial_metadata.h>.
+ */
+
+#include <dory/partial_metadata.h>
+
+#include <cassert>
+#include <string>
+#include <unordered_set>
+
+using namespace Dory;
+
+/* Add the partitions of 'topic' from 'md' to the topic currently open in
+   'builder'.  Return false if a partition's broker is not in 'broker_ids'. */
+static bool AddTopicPartitions(TMetadata::TBuilder &builder,
+    const TMetadata &md, const TMetadata::TTopic &topic,
+    const std::unordered_set<int32_t> &broker_ids) {
+  const std::vector<TMetadata::TBroker> &brokers = md.GetBrokers();
+
+  for (const TMetadata::TPartition &p : topic.GetOkPartitions()) {
+    assert(p.GetBrokerIndex() < brokers.size());
+    int32_t broker_id = brokers[p.GetBrokerIndex()].GetId();
+
+    if (broker_ids.count(broker_id) == 0) {
+      return false;
+    }
+
+    builder.AddPartitionToTopic(p.GetId(), broker_id, true,
+        p.GetErrorCode());
+  }
+
+  for (const TMetadata::TPartition &p : topic.GetOutOfServicePartitions()) {
+    assert(p.GetBrokerIndex() < brokers.size());
+    int32_t broker_id = brokers[p.GetBrokerIndex()].GetId();
+
+    if (broker_ids.count(broker_id) == 0) {
+      return false;
+    }
+
+    builder.AddPartitionToTopic(p.GetId(), broker_id, false,
+        p.GetErrorCode());
+  }
+
+  return true;
+}
+
+std::unique_ptr<TMetadata> Dory::MergePartialMetadata(const TMetadata &cached,
+    const TMetadata &partial,
+    const std::vector<std::string> &requested_topics) {
+  std::unique_ptr<TMetadata> result;
+  TMetadata::TBuilder builder;
+  std::unordered_set<int32_t> broker_ids;
+  builder.OpenBrokerList();
+
+  for (const TMetadata::TBroker &broker : partial.GetBrokers()) {
+    broker_ids.insert(broker.GetId());
+    builder.AddBroker(broker.GetId(), std::string(broker.GetHostname()),
+        broker.GetPort());
+  }
+
+  builder.CloseBrokerList();
+  const std::vector<TMetadata::TTopic> &partial_topics = partial.GetTopics();
+
+  for (const auto &item : partial.GetTopicNameMap()) {
+    assert(item.second < partial_topics.size());
+
+    if (builder.OpenTopic(item.first)) {
+      AddTopicPartitions(builder, partial, partial_topics[item.second],
+          broker_ids);
+      builder.CloseTopic();
+    }
+  }
+
+  std::unordered_set<std::string> requested(requested_topics.begin(),
+      requested_topics.end());
+  const std::vector<TMetadata::TTopic> &cached_topics = cached.GetTopics();
+
+  for (const auto &item : cached.GetTopicNameMap()) {
+    assert(item.second < cached_topics.size());
+
+    if (requested.count(item.first) ||
+        (partial.FindTopicIndex(item.first) >= 0)) {
+      continue;
+    }
+
+    if (builder.OpenTopic(item.first)) {
+      if (!AddTopicPartitions(builder, cached, cached_topics[item.second],
+          broker_ids)) {
+        return std::move(result);
+      }
+
+      builder.CloseTopic();
+    }
+  }
+
+  result.reset(builder.Build());
+  return std::move(result);
+}
@@ -0,0 +1,45 @@
+/* <dory/partial_metadata.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Combines metadata fetched for a subset of topics with cached metadata for
+   all other topics, so periodic refreshes don't need to fetch and parse
+   metadata for every topic in a large cluster.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dory/metadata.h>
+
+namespace Dory {
+
+  /* 'partial' contains metadata fetched for the topics in 'requested_topics'.
+     Return metadata with the brokers from 'partial', all topics in 'partial',
+     and each topic in 'cached' that was not requested and isn't in 'partial'.
+     A requested topic missing from 'partial' is left out, as it would be
+     from a full fetch.  Returns nullptr if a partition of a topic taken from
+     'cached' is led by a broker that doesn't appear in 'partial'.  In that
+     case the cached metadata is stale, and a full fetch is needed. */
+  std::unique_ptr<TMetadata> MergePartialMetadata(const TMetadata &cached,
+      const TMetadata &partial,
+      const std::vector<std::string> &requested_topics);
+
+}  // Dory
@@ -0,0 +1,131 @@
+/* <dory/partial_metadata.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/partial_metadata.h>
+ */
+
+#include <dory/partial_metadata.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace Dory;
+
+namespace {
+
+  /* The fixture for testing MergePartialMetadata(). */
+  class TPartialMetadataTest : public ::testing::Test {
+    protected:
+    TPartialMetadataTest() {
+    }
+
+    virtual ~TPartialMetadataTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TPartialMetadataTest
+
+  void AddBrokers(TMetadata::TBuilder &builder,
+      const std::vector<int32_t> &broker_ids) {
+    builder.OpenBrokerList();
+
+    for (int32_t id : broker_ids) {
+      builder.AddBroker(id, "host" + std::to_string(id), 9092);
+    }
+
+    builder.CloseBrokerList();
+  }
+
+  /* Add a topic with one partition per broker in 'leader_ids'. */
+  void AddTopic(TMetadata::TBuilder &builder, const std::string &name,
+      const std::vector<int32_t> &leader_ids) {
+    ASSERT_TRUE(builder.OpenTopic(name));
+
+    for (size_t i = 0; i < leader_ids.size(); ++i) {
+      builder.AddPartitionToTopic(static_cast<int32_t>(i), leader_ids[i],
+          true, 0);
+    }
+
+    builder.CloseTopic();
+  }
+
+  TEST_F(TPartialMetadataTest, MergeTest) {
+    TMetadata::TBuilder builder;
+    AddBrokers(builder, {1, 2});
+    AddTopic(builder, "a", {1, 2});
+    AddTopic(builder, "b", {2, 1});
+    AddTopic(builder, "c", {1});
+    std::unique_ptr<TMetadata> cached(builder.Build());
+    ASSERT_TRUE(cached->SanityCheck());
+
+    /* Topic "a" has a new leader for partition 1, topic "c" was deleted, and
+       the response includes extra topic "x". */
+    builder.Reset();
+    AddBrokers(builder, {1, 2});
+    AddTopic(builder, "a", {1, 1});
+    AddTopic(builder, "x", {2});
+    std::unique_ptr<TMetadata> partial(builder.Build());
+    std::unique_ptr<TMetadata> merged = MergePartialMetadata(*cached,
+        *partial, {"a", "c"});
+    ASSERT_TRUE(!!merged);
+    ASSERT_TRUE(merged->SanityCheck());
+
+    builder.Reset();
+    AddBrokers(builder, {1, 2});
+    AddTopic(builder, "a", {1, 1});
+    AddTopic(builder, "b", {2, 1});
+    AddTopic(builder, "x", {2});
+    std::unique_ptr<TMetadata> expected(builder.Build());
+    ASSERT_TRUE(*merged == *expected);
+
+    /* Nothing changed */
+    builder.Reset();
+    AddBrokers(builder, {1, 2});
+    AddTopic(builder, "c", {1});
+    partial.reset(builder.Build());
+    merged = MergePartialMetadata(*cached, *partial, {"c"});
+    ASSERT_TRUE(!!merged);
+    ASSERT_TRUE(*merged == *cached);
+  }
+
+  TEST_F(TPartialMetadataTest, LostBrokerTest) {
+    TMetadata::TBuilder builder;
+    AddBrokers(builder, {1, 2});
+    AddTopic(builder, "a", {1});
+    AddTopic(builder, "b", {2});
+    std::unique_ptr<TMetadata> cached(builder.Build());
+
+    /* Broker 2 is gone, so cached metadata for topic "b" is stale. */
+    builder.Reset();
+    AddBrokers(builder, {1});
+    AddTopic(builder, "a", {1});
+    std::unique_ptr<TMetadata> partial(builder.Build());
+    ASSERT_FALSE(MergePartialMetadata(*cached, *partial, {"a"}));
+
+    /* Requesting topic "b" too makes the merge possible. */
+    ASSERT_TRUE(!!MergePartialMetadata(*cached, *partial, {"a", "b"}));
+  }
+
+}  // namespace
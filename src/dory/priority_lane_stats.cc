@@ -0,0 +1,70 @@
+/* <dory/priority_lane_stats.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/priority_lane_stats.h>.
+ */
+
+#include <dory/priority_lane_stats.h>
+
+#include <algorithm>
+
+using namespace Dory;
+
+const float TPriorityLaneStats::LATENCY_SMOOTHING = 0.1f;
+
+void TPriorityLaneStats::AddQueued(TLane lane, size_t count) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+  Lanes[ToIndex(lane)].QueuedMsgCount += count;
+}
+
+void TPriorityLaneStats::RemoveQueued(TLane lane, size_t count) {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+  TLaneStats &stats = Lanes[ToIndex(lane)];
+  assert(stats.QueuedMsgCount >= count);
+  stats.QueuedMsgCount -= std::min<uint64_t>(count, stats.QueuedMsgCount);
+}
+
+void TPriorityLaneStats::RecordSent(TLane lane, size_t count,
+    uint64_t total_latency_ms, uint64_t max_latency_ms) {
+  assert(this);
+
+  if (count == 0) {
+    return;
+  }
+
+  float avg = static_cast<float>(total_latency_ms) / count;
+  std::lock_guard<std::mutex> lock(Mutex);
+  TLaneStats &stats = Lanes[ToIndex(lane)];
+  assert(stats.QueuedMsgCount >= count);
+  stats.QueuedMsgCount -= std::min<uint64_t>(count, stats.QueuedMsgCount);
+  stats.RecentLatencyMs = (stats.SentMsgCount == 0) ? avg :
+      (LATENCY_SMOOTHING * avg) +
+          ((1.0f - LATENCY_SMOOTHING) * stats.RecentLatencyMs);
+  stats.SentMsgCount += count;
+  stats.TotalLatencyMs += total_latency_ms;
+  stats.MaxLatencyMs = std::max(stats.MaxLatencyMs, max_latency_ms);
+}
+
+TPriorityLaneStats::TLaneStats
+TPriorityLaneStats::GetStats(TLane lane) const {
+  assert(this);
+  std::lock_guard<std::mutex> lock(Mutex);
+  return Lanes[ToIndex(lane)];
+}
@@ -0,0 +1,107 @@
+/* <dory/priority_lane_stats.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for tracking queue depth and latency of the high and low priority
+   lanes in the connector threads.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  /* Shared by all connector threads.  Each connector keeps high priority
+     messages in a separate queue that is drained before its low priority
+     queue when building produce requests.  For each lane, this class tracks
+     the total number of messages queued in all connectors, and how long
+     messages waited between creation and being placed in a produce request.
+   */
+  class TPriorityLaneStats final {
+    NO_COPY_SEMANTICS(TPriorityLaneStats);
+
+    public:
+    enum class TLane {
+      High,
+      Low
+    };  // TLane
+
+    /* Weight given to the most recent produce request when updating a lane's
+       running average latency. */
+    static const float LATENCY_SMOOTHING;
+
+    struct TLaneStats {
+      /* # of messages currently queued in all connectors. */
+      uint64_t QueuedMsgCount;
+
+      /* # of messages placed in produce requests so far. */
+      uint64_t SentMsgCount;
+
+      /* Sum of latencies in milliseconds of all sent messages. */
+      uint64_t TotalLatencyMs;
+
+      /* Largest latency in milliseconds of any sent message. */
+      uint64_t MaxLatencyMs;
+
+      /* Running average latency in milliseconds. */
+      float RecentLatencyMs;
+
+      TLaneStats()
+          : QueuedMsgCount(0),
+            SentMsgCount(0),
+            TotalLatencyMs(0),
+            MaxLatencyMs(0),
+            RecentLatencyMs(0.0f) {
+      }
+    };  // TLaneStats
+
+    TPriorityLaneStats() = default;
+
+    /* Record 'count' messages entering (or reentering, in the case of
+       resends) the given lane of a connector. */
+    void AddQueued(TLane lane, size_t count);
+
+    /* Record 'count' messages leaving the given lane of a connector without
+       being sent, for instance when the dispatcher is restarted. */
+    void RemoveQueued(TLane lane, size_t count);
+
+    /* Record 'count' messages from the given lane being placed in a produce
+       request.  'total_latency_ms' is the sum of their latencies, and
+       'max_latency_ms' is the largest. */
+    void RecordSent(TLane lane, size_t count, uint64_t total_latency_ms,
+        uint64_t max_latency_ms);
+
+    TLaneStats GetStats(TLane lane) const;
+
+    private:
+    static size_t ToIndex(TLane lane) {
+      return (lane == TLane::High) ? 0 : 1;
+    }
+
+    /* Protects 'Lanes'. */
+    mutable std::mutex Mutex;
+
+    TLaneStats Lanes[2];
+  };  // TPriorityLaneStats
+
+}  // Dory
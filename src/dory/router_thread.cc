@@ -39,7 +39,10 @@
 #include <dory/kafka_proto/metadata/version_util.h>
 #include <dory/kafka_proto/produce/produce_protocol.h>
 #include <dory/kafka_proto/produce/version_util.h>
+#include <dory/metadata_snapshot.h>
+#include <dory/partial_metadata.h>
 #include <dory/util/connect_to_host.h>
+#include <dory/util/msg_util.h>
 #include <dory/util/system_error_codes.h>
 #include <dory/util/time_util.h>
 #include <dory/util/topic_map.h>
@@ -57,6 +60,10 @@ using namespace Dory::MsgDispatch;
 using namespace Dory::Util;
 
 SERVER_COUNTER(BatchExpiryDetected);
+SERVER_COUNTER(CancelBackgroundMetadataFetch);
+SERVER_COUNTER(ConfReloadApplied);
+SERVER_COUNTER(ConfReloadNoDispatcherRestart);
+SERVER_COUNTER(ConfReloadRequested);
 SERVER_COUNTER(ConnectFailOnTopicAutocreate);
 SERVER_COUNTER(ConnectFailOnTryGetMetadata);
 SERVER_COUNTER(ConnectSuccessOnTopicAutocreate);
@@ -65,6 +72,7 @@ SERVER_COUNTER(DiscardBadTopicMsgOnRoute);
 SERVER_COUNTER(DiscardBadTopicOnReroute);
 SERVER_COUNTER(DiscardDeletedTopicMsg);
 SERVER_COUNTER(DiscardDueToRateLimit);
+SERVER_COUNTER(DiscardExpiredMsgOnRoute);
 SERVER_COUNTER(DiscardLongMsg);
 SERVER_COUNTER(DiscardNoAvailablePartition);
 SERVER_COUNTER(DiscardNoAvailablePartitionOnReroute);
@@ -73,9 +81,16 @@ SERVER_COUNTER(DiscardOnTopicAutocreateFail);
 SERVER_COUNTER(FinishRefreshMetadata);
 SERVER_COUNTER(GetMetadataFail);
 SERVER_COUNTER(GetMetadataSuccess);
+SERVER_COUNTER(HoldMsgForSnapshotUnknownTopic);
 SERVER_COUNTER(MetadataChangedOnRefresh);
+SERVER_COUNTER(MetadataSnapshotLoaded);
+SERVER_COUNTER(MetadataSnapshotReadFail);
+SERVER_COUNTER(MetadataSnapshotWriteFail);
+SERVER_COUNTER(MetadataSnapshotWritten);
 SERVER_COUNTER(MetadataUnchangedOnRefresh);
 SERVER_COUNTER(MetadataUpdated);
+SERVER_COUNTER(PartialMetadataMergeFail);
+SERVER_COUNTER(PartialMetadataMerged);
 SERVER_COUNTER(PerTopicBatchAnyPartition);
 SERVER_COUNTER(PossibleDuplicateMsg);
 SERVER_COUNTER(RefreshMetadataSuccess);
@@ -86,6 +101,7 @@ SERVER_COUNTER(RouterThreadStartPause);
 SERVER_COUNTER(RouteSingleAnyPartitionMsg);
 SERVER_COUNTER(RouteSingleMsg);
 SERVER_COUNTER(RouteSinglePartitionKeyMsg);
+SERVER_COUNTER(SequencedMsgLostPartition);
 SERVER_COUNTER(SetBatchExpiry);
 SERVER_COUNTER(StartRefreshMetadata);
 SERVER_COUNTER(TopicHasNoAvailablePartitions);
@@ -97,23 +113,39 @@ static unsigned GetRandomNumber() {
 TRouterThread::TRouterThread(const TConfig &config, const TConf &conf,
     TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
     const Batch::TGlobalBatchConfig &batch_config,
+    Batch::TAdaptiveBatchStats &adaptive_batch_stats,
+    TIdempotentProducer &idempotent_producer,
     const Debug::TDebugSetup &debug_setup,
-    MsgDispatch::TKafkaDispatcherApi &dispatcher)
+    MsgDispatch::TKafkaDispatcherApi &dispatcher,
+    TConfGeneration &conf_generation)
     : Config(config),
       TopicRateConf(conf.GetTopicRateConf()),
-      MsgRateLimiter(TopicRateConf),
+      MsgRateLimiter(new TMsgRateLimiter(TopicRateConf)),
+      TopicPriorityConf(conf.GetTopicPriorityConf()),
+      TopicMaxAgeConf(conf.GetTopicMaxAgeConf()),
       SingleMsgOverhead(0),
       MessageMaxBytes(batch_config.GetMessageMaxBytes()),
+      DispatcherCompressionConf(conf.GetCompressionConf()),
+      DispatcherBrokerConnectionsConf(conf.GetBrokerConnectionsConf()),
+      DispatcherBatchConfig(batch_config),
       AnomalyTracker(anomaly_tracker),
       MsgStateTracker(msg_state_tracker),
+      IdempotentProducer(idempotent_producer),
       DebugSetup(debug_setup),
+      MsgJournal(nullptr),
       Destroying(false),
       NeedToContinueShutdown(false),
       OkShutdown(true),
+      InitialBrokers(conf.GetInitialBrokers()),
       KnownBrokers(conf.GetInitialBrokers()),
+      MetadataFromSnapshot(false),
+      NeedFullMetadata(true),
+      LastFullMetadataTime(0),
       PerTopicBatcher(batch_config.GetPerTopicConfig()),
       Dispatcher(dispatcher),
+      ConfGeneration(conf_generation),
       DebugLogger(debug_setup, TDebugSetup::TLogId::MSG_RECEIVE) {
+  PerTopicBatcher.SetAdaptiveStats(&adaptive_batch_stats, "topic ");
 }
 
 TRouterThread::~TRouterThread() noexcept {
@@ -124,6 +156,20 @@ TRouterThread::~TRouterThread() noexcept {
   ShutdownOnDestroy();
 }
 
+void TRouterThread::RequestConfReload(size_t generation, TConf &&conf,
+    TGlobalBatchConfig &&batch_config) {
+  assert(this);
+  ConfReloadRequested.Increment();
+
+  {
+    std::lock_guard<std::mutex> lock(PendingConfMutex);
+    PendingConf.reset(new TPendingConf(generation, std::move(conf),
+        std::move(batch_config)));
+  }
+
+  ConfReloadRequestSem.Push();
+}
+
 void TRouterThread::Run() {
   assert(this);
   int tid = static_cast<int>(Gettid());
@@ -177,6 +223,12 @@ void TRouterThread::Discard(TMsg::TPtr &&msg,
   assert(msg);
   TMsg::TPtr to_discard(std::move(msg));
   AnomalyTracker.TrackDiscard(to_discard, reason);
+
+  if (MsgJournal &&
+      (reason == TAnomalyTracker::TDiscardReason::ServerShutdown)) {
+    MsgJournal->Retain(*to_discard);
+  }
+
   MsgStateTracker.MsgEnterProcessed(*to_discard);
 }
 
@@ -184,10 +236,16 @@ void TRouterThread::Discard(std::list<TMsg::TPtr> &&msg_list,
     TAnomalyTracker::TDiscardReason reason) {
   assert(this);
   std::list<TMsg::TPtr> to_discard(std::move(msg_list));
+  bool retain = MsgJournal &&
+      (reason == TAnomalyTracker::TDiscardReason::ServerShutdown);
 
   for (TMsg::TPtr &msg : to_discard) {
     assert(msg);
     AnomalyTracker.TrackDiscard(msg, reason);
+
+    if (retain) {
+      MsgJournal->Retain(*msg);
+    }
   }
 
   MsgStateTracker.MsgEnterProcessed(to_discard);
@@ -197,11 +255,17 @@ void TRouterThread::Discard(std::list<std::list<TMsg::TPtr>> &&batch_list,
     TAnomalyTracker::TDiscardReason reason) {
   assert(this);
   std::list<std::list<TMsg::TPtr>> to_discard(std::move(batch_list));
+  bool retain = MsgJournal &&
+      (reason == TAnomalyTracker::TDiscardReason::ServerShutdown);
 
   for (std::list<TMsg::TPtr> &msg_list : to_discard) {
     for (TMsg::TPtr &msg : msg_list) {
       assert(msg);
       AnomalyTracker.TrackDiscard(msg, reason);
+
+      if (retain) {
+        MsgJournal->Retain(*msg);
+      }
     }
   }
 
@@ -220,6 +284,10 @@ bool TRouterThread::UpdateMetadataAfterTopicAutocreate(
   for (size_t i = 0; ; ) {
     SleepMilliseconds(sleep_ms);
 
+    /* The new topic isn't one we have seen, so partial metadata won't
+       include it. */
+    NeedFullMetadata = true;
+
     if (!HandleMetadataUpdate()) {
       /* Shutdown delay expired during metadata update. */
       return false;
@@ -328,6 +396,24 @@ bool TRouterThread::ValidateNewMsg(TMsg::TPtr &msg) {
   const std::string &topic = msg->GetTopic();
   int topic_index = Metadata->FindTopicIndex(topic);
 
+  if ((topic_index < 0) && MetadataFromSnapshot &&
+      BackgroundMetadataFetcher && ShutdownStartTime.IsUnknown()) {
+    /* The topic may have been created after the snapshot was saved.  Hold the
+       message until the background fetch gets fresh metadata, rather than
+       blocking here while we wait for the brokers. */
+    HoldMsgForSnapshotUnknownTopic.Increment();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_NOTICE, "Router thread holding message with topic [%s] "
+             "missing from metadata snapshot until background metadata fetch "
+             "finishes", topic.c_str());
+    }
+
+    SnapshotUnknownTopicMsgs.push_back(std::move(msg));
+    return true;
+  }
+
   if (topic_index < 0) {
     if (Config.TopicAutocreate) {
       if (!AutocreateTopic(msg)) {
@@ -346,6 +432,10 @@ bool TRouterThread::ValidateNewMsg(TMsg::TPtr &msg) {
     }
 
     if (topic_index < 0) {
+      /* The topic may have been created since we last got metadata for all
+         topics, so make sure the next update finds it. */
+      NeedFullMetadata = true;
+
       if (!Config.NoLogDiscard) {
         static TLogRateLimiter lim(std::chrono::seconds(30));
 
@@ -363,6 +453,9 @@ bool TRouterThread::ValidateNewMsg(TMsg::TPtr &msg) {
     }
   }
 
+  assert(static_cast<size_t>(topic_index) < TopicSeen.size());
+  TopicSeen[topic_index] = true;
+
   if (msg->BodyIsTruncated() ||
       ((msg->GetKeyAndValue().Size() + SingleMsgOverhead) > MessageMaxBytes)) {
     /* Check for truncation _after_ checking for topic existence.  If the topic
@@ -404,8 +497,8 @@ bool TRouterThread::ValidateNewMsg(TMsg::TPtr &msg) {
       Discard(std::move(msg),
               TAnomalyTracker::TDiscardReason::NoAvailablePartitions);
       DiscardNoAvailablePartition.Increment();
-    } else if (MsgRateLimiter.WouldExceedLimit(topic,
-        msg->GetCreationTimestamp())) {
+    } else if (MsgRateLimiter->WouldExceedLimit(topic,
+        msg->GetCreationTimestamp(), msg->GetKeyAndValue().Size())) {
       if (!Config.NoLogDiscard) {
         static TLogRateLimiter lim(std::chrono::seconds(30));
 
@@ -417,6 +510,10 @@ bool TRouterThread::ValidateNewMsg(TMsg::TPtr &msg) {
 
       Discard(std::move(msg), TAnomalyTracker::TDiscardReason::RateLimit);
       DiscardDueToRateLimit.Increment();
+    } else {
+      msg->SetHighPriority(TopicPriorityConf.IsHighPriority(topic));
+      msg->SetDeadline(TopicMaxAgeConf.GetDeadline(topic,
+          msg->GetCreationTimestamp()));
     }
   }
 
@@ -596,6 +693,7 @@ void TRouterThread::RouteAnyPartitionNow(
   }
 
   RouteMsgBatchList.Increment();
+  DiscardExpired(batch_list);
 
   /* Map batches to brokers. */
   while (!batch_list.empty()) {
@@ -617,6 +715,35 @@ void TRouterThread::RouteAnyPartitionNow(
   }
 }
 
+void TRouterThread::DiscardExpired(
+    std::list<std::list<TMsg::TPtr>> &batch_list) {
+  assert(this);
+
+  if (!TopicMaxAgeConf.IsEnabled()) {
+    return;
+  }
+
+  std::list<TMsg::TPtr> expired;
+  TakeExpiredMsgs(batch_list, GetMonotonicRawMilliseconds(), expired);
+
+  if (expired.empty()) {
+    return;
+  }
+
+  DiscardExpiredMsgOnRoute.Increment(expired.size());
+
+  if (!Config.NoLogDiscard) {
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Discarding message because it exceeded max age: [%s]",
+          expired.front()->GetTopic().c_str());
+    }
+  }
+
+  Discard(std::move(expired), TAnomalyTracker::TDiscardReason::Expired);
+}
+
 void TRouterThread::RoutePartitionKeyNow(
     std::list<std::list<TMsg::TPtr>> &&batch_list) {
   assert(this);
@@ -664,6 +791,63 @@ void TRouterThread::RoutePartitionKeyNow(
   }
 }
 
+void TRouterThread::RouteSequencedNow(std::list<TMsg::TPtr> &&msg_list) {
+  assert(this);
+  assert(Metadata);
+
+  if (msg_list.empty()) {
+    return;
+  }
+
+  /* Key is broker index (not ID), and value is list of messages with mixed
+     topics. */
+  std::unordered_map<size_t, std::list<TMsg::TPtr>>
+      broker_map(Metadata->GetBrokers().size());
+  std::list<std::list<TMsg::TPtr>> unsequenced;
+
+  for (auto &msg_ptr : msg_list) {
+    assert(msg_ptr);
+    const TMetadata::TTopic &topic_meta =
+        GetValidTopicMetadata(msg_ptr->GetTopic());
+    const TMetadata::TPartition *partition = nullptr;
+
+    for (const TMetadata::TPartition &p : topic_meta.GetOkPartitions()) {
+      if (p.GetId() == msg_ptr->GetPartition()) {
+        partition = &p;
+        break;
+      }
+    }
+
+    if (partition) {
+      broker_map[partition->GetBrokerIndex()].push_back(std::move(msg_ptr));
+    } else {
+      /* Keep the old sequence number, so the message gets tracked as a
+         possible duplicate when renumbered. */
+      SequencedMsgLostPartition.Increment();
+      msg_ptr->SetProduceSequence(0, msg_ptr->GetProduceSequence());
+      unsequenced.emplace_back();
+      unsequenced.back().push_back(std::move(msg_ptr));
+    }
+  }
+
+  msg_list.clear();
+  TTopicMap topic_map;
+
+  for (auto &item : broker_map) {
+    assert(topic_map.IsEmpty());
+
+    for (auto &msg_ptr : item.second) {
+      topic_map.Put(std::move(msg_ptr));
+      assert(!msg_ptr);
+    }
+
+    /* Dispatch messages grouped by topic. */
+    Dispatcher.DispatchNow(topic_map.Get(), item.first);
+  }
+
+  RouteAnyPartitionNow(std::move(unsequenced));
+}
+
 void TRouterThread::Reroute(std::list<std::list<TMsg::TPtr>> &&batch_list) {
   assert(this);
 
@@ -671,7 +855,9 @@ void TRouterThread::Reroute(std::list<std::list<TMsg::TPtr>> &&batch_list) {
     return;
   }
 
+  DiscardExpired(batch_list);
   std::list<std::list<TMsg::TPtr>> partition_key_batches;
+  std::list<TMsg::TPtr> sequenced;
   std::list<TMsg::TPtr> tmp;
 
   /* Separate PartitionKey messages from AnyPartition messages. */
@@ -695,6 +881,9 @@ void TRouterThread::Reroute(std::list<std::list<TMsg::TPtr>> &&batch_list) {
 
       if ((*iter2)->GetRoutingType() == TMsg::TRoutingType::PartitionKey) {
         tmp.splice(tmp.end(), batch, iter2);
+      } else if (IdempotentProducer.HoldsCurrentSequence(**iter2)) {
+        /* An AnyPartition message that must return to its partition. */
+        sequenced.splice(sequenced.end(), batch, iter2);
       }
     }
 
@@ -704,15 +893,18 @@ void TRouterThread::Reroute(std::list<std::list<TMsg::TPtr>> &&batch_list) {
 
     if (batch.empty()) {
       /* Either the above call to ValidateBeforeReroute() emptied the batch, or
-         the batch became empty when we removed all PartitionKey messages. */
+         the batch became empty when we removed all PartitionKey and sequenced
+         messages. */
       batch_list.erase(iter);
     }
   }
 
   RouteAnyPartitionNow(std::move(batch_list));
   RoutePartitionKeyNow(std::move(partition_key_batches));
+  RouteSequencedNow(std::move(sequenced));
   assert(batch_list.empty());
   assert(partition_key_batches.empty());
+  assert(sequenced.empty());
 }
 
 void TRouterThread::RouteFinalMsgs() {
@@ -726,6 +918,14 @@ void TRouterThread::RouteFinalMsgs() {
   /* Get any remaining queued messages from the input thread. */
   std::list<TMsg::TPtr> msg_list = MsgChannel.NonblockingGet();
 
+  if (MsgJournal) {
+    MsgJournal->Append(msg_list);
+  }
+
+  /* Messages held for topics missing from the metadata snapshot arrived
+     first, so they go first.  They were journaled when they arrived. */
+  msg_list.splice(msg_list.begin(), SnapshotUnknownTopicMsgs);
+
   bool keep_running = true;
 
   for (TMsg::TPtr &msg : msg_list) {
@@ -788,11 +988,12 @@ void TRouterThread::InitWireProtocol() {
   assert(this);
 
   /* This code is just a placeholder, since Dory currently supports only
-     version 0 of the metadata and produce wire protocols.  Eventually code
-     will go here that handles cases where a specific metadata or produce
-     protocol version was not specified as a command line arg.  In this case,
-     we will probe the Kafka cluster and choose the highest version supported
-     by both Dory and the Kafka brokers. */
+     version 0 of the metadata wire protocol and versions 0 and 3 of the
+     produce wire protocol, and uses version 0 unless told otherwise.
+     Eventually code will go here that handles cases where a specific metadata
+     or produce protocol version was not specified as a command line arg.  In
+     this case, we will probe the Kafka cluster and choose the highest version
+     supported by both Dory and the Kafka brokers. */
   size_t metadata_api_version = Config.MetadataApiVersion.IsKnown() ?
       *Config.MetadataApiVersion : 0;
   std::unique_ptr<TMetadataProtocol> metadata_protocol(
@@ -813,9 +1014,38 @@ bool TRouterThread::Init() {
   assert(this);
   InitWireProtocol();
   std::shared_ptr<TMetadata> meta;
+  bool from_snapshot = false;
+
+  if (!Config.MetadataSnapshotPath.empty()) {
+    try {
+      meta = ReadMetadataSnapshot(Config.MetadataSnapshotPath);
+    } catch (const std::exception &x) {
+      MetadataSnapshotReadFail.Increment();
+      syslog(LOG_ERR, "Router thread failed to read metadata snapshot [%s]: "
+             "%s", Config.MetadataSnapshotPath.c_str(), x.what());
+    }
+
+    if (meta) {
+      MetadataSnapshotLoaded.Increment();
+      syslog(LOG_NOTICE, "Router thread loaded metadata snapshot: starting "
+             "background metadata fetch");
+
+      /* Fetch from the configured brokers rather than the ones in the
+         snapshot, since the cluster may have changed while we were down. */
+      BackgroundMetadataFetcher.reset(new TBackgroundMetadataFetcher(Config,
+          KnownBrokers, IdempotentProducer));
+      BackgroundMetadataFetcher->Start();
+      from_snapshot = true;
+    } else {
+      syslog(LOG_NOTICE, "No usable metadata snapshot in [%s]",
+             Config.MetadataSnapshotPath.c_str());
+    }
+  }
 
-  syslog(LOG_NOTICE, "Router thread sending initial metadata request");
-  meta = GetInitialMetadata();
+  if (!meta) {
+    syslog(LOG_NOTICE, "Router thread sending initial metadata request");
+    meta = GetInitialMetadata();
+  }
 
   if (!meta) {
     syslog(LOG_NOTICE, "Router thread got shutdown request while getting "
@@ -830,7 +1060,7 @@ bool TRouterThread::Init() {
     return false;
   }
 
-  SetMetadata(std::move(meta));
+  SetMetadata(std::move(meta), !from_snapshot, from_snapshot);
 
   syslog(LOG_NOTICE,
          "Router thread starting dispatcher during initialization");
@@ -920,6 +1150,7 @@ bool TRouterThread::RefreshMetadata() {
 
     if (unchanged) {
       MetadataUnchangedOnRefresh.Increment();
+      HandleMetadataFromBroker();
       syslog(LOG_INFO, "Metadata is unchanged on refresh");
       InitMetadataRefreshTimer();
       return true;
@@ -931,6 +1162,104 @@ bool TRouterThread::RefreshMetadata() {
   return ReplaceMetadataOnRefresh(std::move(meta));
 }
 
+bool TRouterThread::HandleBackgroundMetadata() {
+  assert(this);
+  assert(BackgroundMetadataFetcher);
+
+  /* Metadata from a broker would have stopped the fetch. */
+  assert(MetadataFromSnapshot);
+  BackgroundMetadataFetcher->Join();
+  std::shared_ptr<TMetadata> meta = BackgroundMetadataFetcher->TakeResult();
+  BackgroundMetadataFetcher.reset();
+
+  if (!meta) {
+    /* The fetch was shut down.  This happens only during shutdown. */
+    return true;
+  }
+
+  syslog(LOG_NOTICE, "Router thread got metadata from background fetch");
+  NeedFullMetadata = false;
+  LastFullMetadataTime = GetEpochMilliseconds();
+  UpdateKnownBrokers(*meta);
+  HandleMetadataFromBroker();
+  bool unchanged = (*meta == *Metadata);
+  MetadataTimestamp.RecordUpdate(!unchanged);
+
+  if (unchanged) {
+    MetadataUnchangedOnRefresh.Increment();
+    syslog(LOG_NOTICE, "Metadata snapshot matches fetched metadata");
+    InitMetadataRefreshTimer();
+    return true;
+  }
+
+  MetadataChangedOnRefresh.Increment();
+  syslog(LOG_NOTICE, "Metadata snapshot differs from fetched metadata: "
+         "replacing");
+  return ReplaceMetadataOnRefresh(std::move(meta));
+}
+
+bool TRouterThread::RouteSnapshotUnknownTopicMsgs() {
+  assert(this);
+  assert(!MetadataFromSnapshot);
+  std::list<TMsg::TPtr> msg_list(std::move(SnapshotUnknownTopicMsgs));
+  SnapshotUnknownTopicMsgs.clear();
+  syslog(LOG_NOTICE, "Router thread routing %lu messages held for topics "
+         "missing from metadata snapshot",
+         static_cast<unsigned long>(msg_list.size()));
+  bool keep_running = true;
+
+  for (TMsg::TPtr &msg : msg_list) {
+    keep_running = ValidateNewMsg(msg);
+
+    if (!keep_running) {
+      break;
+    }
+
+    if (msg) {
+      DebugLogger.LogMsg(msg);
+      Route(std::move(msg));
+    }
+
+    assert(!msg);
+  }
+
+  if (!keep_running) {
+    /* Shutdown delay expired while fetching metadata due to topic autocreate.
+       Discard all remaining messages. */
+    for (TMsg::TPtr &msg : msg_list) {
+      if (msg) {
+        DiscardOnShutdownDuringMetadataUpdate(std::move(msg));
+      }
+    }
+  }
+
+  return keep_running;
+}
+
+void TRouterThread::HandleMetadataFromBroker() {
+  assert(this);
+  MetadataFromSnapshot = false;
+
+  if (BackgroundMetadataFetcher) {
+    /* We already have metadata at least as new as what the fetch would
+       get, so don't let its result replace ours later. */
+    CancelBackgroundMetadataFetch.Increment();
+    syslog(LOG_NOTICE, "Router thread stopping background metadata fetch "
+           "since it got metadata from a broker");
+    StopBackgroundMetadataFetch();
+  }
+}
+
+void TRouterThread::StopBackgroundMetadataFetch() {
+  assert(this);
+
+  if (BackgroundMetadataFetcher) {
+    BackgroundMetadataFetcher->RequestShutdown();
+    BackgroundMetadataFetcher->Join();
+    BackgroundMetadataFetcher.reset();
+  }
+}
+
 std::list<std::list<TMsg::TPtr>> TRouterThread::EmptyDispatcher() {
   assert(this);
   std::vector<std::list<std::list<TMsg::TPtr>>> broker_lists;
@@ -943,6 +1272,13 @@ std::list<std::list<TMsg::TPtr>> TRouterThread::EmptyDispatcher() {
 
     for (const std::list<TMsg::TPtr> &msg_list : tmp) {
       for (const TMsg::TPtr &msg : msg_list) {
+        if (IdempotentProducer.HoldsCurrentSequence(*msg)) {
+          /* The broker will detect a duplicate when we resend it, so don't
+             track it here.  If it loses its sequence number before then, it
+             will be tracked when renumbered. */
+          continue;
+        }
+
         /* We are resending a message that we previously sent but didn't get an
            ACK for.  Track this event, since it may cause a duplicate message.
          */
@@ -958,6 +1294,10 @@ std::list<std::list<TMsg::TPtr>> TRouterThread::EmptyDispatcher() {
 
         AnomalyTracker.TrackDuplicate(msg);
         PossibleDuplicateMsg.Increment();
+
+        /* Any old sequence number is already accounted for, so don't track
+           the message again when it gets a new one. */
+        msg->SetProduceSequence(0, -1);
       }
     }
 
@@ -1077,6 +1417,7 @@ bool TRouterThread::HandleMetadataUpdate() {
     MetadataUpdateRequestSem.Pop();
     syslog(LOG_NOTICE, "Router thread responding to user-initiated metadata "
            "update request");
+    NeedFullMetadata = true;
   }
 
   StartRefreshMetadata.Increment();
@@ -1093,6 +1434,113 @@ bool TRouterThread::HandleMetadataUpdate() {
   return keep_running;
 }
 
+bool TRouterThread::HaveNewInitialBrokers(const TConf &conf) const {
+  assert(this);
+  const std::vector<TConf::TBroker> &brokers = conf.GetInitialBrokers();
+
+  if (brokers.size() != InitialBrokers.size()) {
+    return true;
+  }
+
+  for (size_t i = 0; i < brokers.size(); ++i) {
+    if ((brokers[i].Host != InitialBrokers[i].Host) ||
+        (brokers[i].Port != InitialBrokers[i].Port)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TRouterThread::HandleConfReload() {
+  assert(this);
+  assert(ShutdownStartTime.IsUnknown());
+  ConfReloadRequestSem.Pop();
+  std::unique_ptr<TPendingConf> pending;
+
+  {
+    std::lock_guard<std::mutex> lock(PendingConfMutex);
+    pending = std::move(PendingConf);
+  }
+
+  if (!pending) {
+    return;
+  }
+
+  syslog(LOG_NOTICE, "Router thread swapping in config file generation %lu",
+         static_cast<unsigned long>(pending->Generation));
+  const TConf &conf = pending->Conf;
+  const TGlobalBatchConfig &batch_config = pending->BatchConfig;
+
+  /* Rate limiting state starts over, since the limits themselves may have
+     changed. */
+  TopicRateConf = conf.GetTopicRateConf();
+  MsgRateLimiter.reset(new TMsgRateLimiter(TopicRateConf));
+  TopicPriorityConf = conf.GetTopicPriorityConf();
+  TopicMaxAgeConf = conf.GetTopicMaxAgeConf();
+  MessageMaxBytes = batch_config.GetMessageMaxBytes();
+
+  if (HaveNewInitialBrokers(conf)) {
+    /* The brokers we know about from the current metadata are still usable,
+       so we don't wait for new metadata here.  The metadata update requested
+       below will use the new brokers. */
+    syslog(LOG_NOTICE, "Initial brokers changed on config file reload: "
+           "requesting metadata update");
+    InitialBrokers = conf.GetInitialBrokers();
+    KnownBrokers = InitialBrokers;
+    MetadataUpdateRequestSem.Push();
+  }
+
+  bool dispatcher_conf_changed =
+      (conf.GetCompressionConf() != DispatcherCompressionConf) ||
+      (batch_config != DispatcherBatchConfig);
+  DispatcherCompressionConf = conf.GetCompressionConf();
+  DispatcherBatchConfig = batch_config;
+
+  if (conf.GetBrokerConnectionsConf() != DispatcherBrokerConnectionsConf) {
+    /* A different number of connections per broker needs a different set of
+       connector threads, so restart the dispatcher.  This is the same as what
+       happens on a metadata refresh. */
+    syslog(LOG_NOTICE, "Router thread starting fast dispatcher shutdown for "
+           "broker connection change on config file reload");
+    Dispatcher.StartFastShutdown();
+    CheckDispatcherShutdown();
+    DispatcherBrokerConnectionsConf = conf.GetBrokerConnectionsConf();
+    Dispatcher.SetConfig(DispatcherCompressionConf,
+        DispatcherBrokerConnectionsConf, DispatcherBatchConfig);
+    std::list<std::list<TMsg::TPtr>> to_reroute = EmptyDispatcher();
+    Dispatcher.Start(Metadata);
+    syslog(LOG_NOTICE, "Router thread restarted dispatcher for config file "
+           "reload");
+    Reroute(std::move(to_reroute));
+  } else {
+    ConfReloadNoDispatcherRestart.Increment();
+
+    if (dispatcher_conf_changed) {
+      /* Each connector swaps in the new compression and broker-level
+         batching config before building its next produce request.  Queued
+         and unACKed messages are unaffected, so nothing gets resent. */
+      syslog(LOG_NOTICE, "Router thread publishing new dispatcher config for "
+             "config file reload");
+      Dispatcher.UpdateConfig(DispatcherCompressionConf,
+          DispatcherBatchConfig);
+    } else {
+      syslog(LOG_NOTICE, "Dispatcher config unchanged on config file reload");
+    }
+  }
+
+  /* Messages batched under the old per topic config stay in their batches,
+     unless the batches are complete under the new config. */
+  RouteAnyPartitionNow(PerTopicBatcher.SetConfig(
+      batch_config.GetPerTopicConfig(), GetEpochMilliseconds()));
+  OptNextBatchExpiry = PerTopicBatcher.GetNextCompleteTime();
+
+  ConfGeneration.RecordInUse(pending->Generation);
+  ConfReloadApplied.Increment();
+  syslog(LOG_NOTICE, "Router thread finished swapping in config file "
+         "generation %lu", static_cast<unsigned long>(pending->Generation));
+}
+
 void TRouterThread::ContinueShutdown() {
   assert(this);
   NeedToContinueShutdown = false;
@@ -1102,6 +1550,7 @@ void TRouterThread::ContinueShutdown() {
      watching for metadata refresh events.
    */
   MetadataRefreshTimer.reset();
+  StopBackgroundMetadataFetch();
 
   /* Get any remaining queued messages from the input thread and forward them
      to the brokers.  When the brokers get the slow shutdown message, they will
@@ -1157,6 +1606,10 @@ void TRouterThread::InitMainLoopPollArray() {
       MainLoopPollArray[TMainLoopPollItem::MdRefresh];
   struct pollfd &shutdown_finished_item =
       MainLoopPollArray[TMainLoopPollItem::ShutdownFinished];
+  struct pollfd &conf_reload_request_item =
+      MainLoopPollArray[TMainLoopPollItem::ConfReloadRequest];
+  struct pollfd &background_md_item =
+      MainLoopPollArray[TMainLoopPollItem::BackgroundMd];
   bool shutdown_started = ShutdownStartTime.IsKnown();
   pause_item.fd = Dispatcher.GetPauseFd();
   pause_item.events = POLLIN;
@@ -1179,6 +1632,14 @@ void TRouterThread::InitMainLoopPollArray() {
       int(Dispatcher.GetShutdownWaitFd()) : -1;
   shutdown_finished_item.events = POLLIN;
   shutdown_finished_item.revents = 0;
+  conf_reload_request_item.fd = shutdown_started ?
+      -1 : int(ConfReloadRequestSem.GetFd());
+  conf_reload_request_item.events = POLLIN;
+  conf_reload_request_item.revents = 0;
+  background_md_item.fd = (shutdown_started || !BackgroundMetadataFetcher) ?
+      -1 : int(BackgroundMetadataFetcher->GetShutdownWaitFd());
+  background_md_item.events = POLLIN;
+  background_md_item.revents = 0;
 }
 
 void TRouterThread::DoRun() {
@@ -1224,6 +1685,22 @@ void TRouterThread::DoRun() {
       break;  // shutdown delay expired during metadata update
     }
 
+    if (MainLoopPollArray[TMainLoopPollItem::BackgroundMd].revents &&
+        BackgroundMetadataFetcher && ShutdownStartTime.IsUnknown() &&
+        !HandleBackgroundMetadata()) {
+      break;  // shutdown delay expired during metadata update
+    }
+
+    if (!SnapshotUnknownTopicMsgs.empty() && !MetadataFromSnapshot &&
+        !RouteSnapshotUnknownTopicMsgs()) {
+      break;  // shutdown delay expired during metadata update
+    }
+
+    if (MainLoopPollArray[TMainLoopPollItem::ConfReloadRequest].revents &&
+        ShutdownStartTime.IsUnknown()) {
+      HandleConfReload();
+    }
+
     uint64_t now = GetEpochMilliseconds();
 
     if (OptNextBatchExpiry.IsKnown() &&
@@ -1238,6 +1715,8 @@ void TRouterThread::DoRun() {
 
   Discard(PerTopicBatcher.GetAllBatches(),
           TAnomalyTracker::TDiscardReason::ServerShutdown);
+  Discard(std::move(SnapshotUnknownTopicMsgs),
+          TAnomalyTracker::TDiscardReason::ServerShutdown);
   OkShutdown = true;
 }
 
@@ -1293,6 +1772,11 @@ void TRouterThread::HandleMsgAvailable(uint64_t now) {
   std::list<TMsg::TPtr> remaining;
   bool keep_running = true;
 
+  if (MsgJournal) {
+    /* Journal the messages before anything else can happen to them. */
+    MsgJournal->Append(msg_list);
+  }
+
   for (auto iter = msg_list.begin(), next = iter;
        iter != msg_list.end();
        iter = next) {
@@ -1431,6 +1915,65 @@ void TRouterThread::UpdateKnownBrokers(const TMetadata &md) {
   KnownBrokers = std::move(broker_vec);
 }
 
+bool TRouterThread::GetPartialMetadataTopics(
+    std::vector<std::string> &topics) const {
+  assert(this);
+  topics.clear();
+
+  if (!Config.PartialMetadataRefresh || NeedFullMetadata || !Metadata ||
+      ((GetEpochMilliseconds() - LastFullMetadataTime) >=
+       (Config.FullMetadataRefreshInterval * 60 * 1000))) {
+    return false;
+  }
+
+  for (const auto &item : Metadata->GetTopicNameMap()) {
+    assert(item.second < TopicSeen.size());
+
+    if (TopicSeen[item.second]) {
+      topics.push_back(item.first);
+    }
+  }
+
+  return !topics.empty();
+}
+
+std::shared_ptr<TMetadata> TRouterThread::FetchMetadataFromBroker() {
+  assert(this);
+  int timeout_ms = Config.KafkaSocketTimeout * 1000;
+  std::shared_ptr<TMetadata> result;
+  std::vector<std::string> topics;
+
+  if (GetPartialMetadataTopics(topics)) {
+    std::unique_ptr<TMetadata> partial =
+        MetadataFetcher->FetchTopics(topics, timeout_ms);
+
+    if (!partial) {
+      return std::move(result);
+    }
+
+    result = MergePartialMetadata(*Metadata, *partial, topics);
+
+    if (result) {
+      PartialMetadataMerged.Increment();
+      return std::move(result);
+    }
+
+    /* Our cached metadata refers to a broker that is gone. */
+    PartialMetadataMergeFail.Increment();
+    syslog(LOG_NOTICE, "Router thread could not merge partial metadata: "
+           "requesting metadata for all topics");
+  }
+
+  result = MetadataFetcher->Fetch(timeout_ms);
+
+  if (result) {
+    NeedFullMetadata = false;
+    LastFullMetadataTime = GetEpochMilliseconds();
+  }
+
+  return std::move(result);
+}
+
 std::shared_ptr<TMetadata> TRouterThread::TryGetMetadata() {
   assert(this);
   assert(!KnownBrokers.empty());
@@ -1453,10 +1996,22 @@ std::shared_ptr<TMetadata> TRouterThread::TryGetMetadata() {
     }
 
     ConnectSuccessOnTryGetMetadata.Increment();
-    result = std::move(
-        MetadataFetcher->Fetch(Config.KafkaSocketTimeout * 1000));
+    result = FetchMetadataFromBroker();
 
     if (result) {
+      if (IdempotentProducer.NeedsProducerId()) {
+        /* Ask the same broker for a producer ID while we are connected.  If
+           this fails, we keep sending without idempotence and try again on
+           the next metadata update. */
+        int64_t producer_id = -1;
+        int16_t producer_epoch = -1;
+
+        if (MetadataFetcher->InitProducerId(producer_id, producer_epoch,
+                Config.KafkaSocketTimeout * 1000)) {
+          IdempotentProducer.SetProducerId(producer_id, producer_epoch);
+        }
+      }
+
       break;  // success
     }
 
@@ -1694,7 +2249,7 @@ void TRouterThread::UpdateBatchStateForNewMetadata(const TMetadata &old_md,
 }
 
 void TRouterThread::SetMetadata(std::shared_ptr<TMetadata> &&meta,
-        bool record_update) {
+        bool record_update, bool from_snapshot) {
   assert(this);
   assert(meta);
 
@@ -1724,13 +2279,36 @@ void TRouterThread::SetMetadata(std::shared_ptr<TMetadata> &&meta,
      is routed. */
   RouteCounters.resize(meta->GetTopics().size(), 0);
 
+  std::vector<bool> topic_seen(meta->GetTopics().size(), false);
+
   if (Metadata) {
     UpdateBatchStateForNewMetadata(*Metadata, *meta);
+
+    for (const auto &item : Metadata->GetTopicNameMap()) {
+      assert(item.second < TopicSeen.size());
+
+      if (TopicSeen[item.second]) {
+        int index = meta->FindTopicIndex(item.first);
+
+        if (index >= 0) {
+          topic_seen[index] = true;
+        }
+      }
+    }
   }
 
+  TopicSeen = std::move(topic_seen);
+
   Metadata = std::move(meta);
   MetadataUpdated.Increment();
 
+  if (from_snapshot) {
+    MetadataFromSnapshot = true;
+  } else {
+    HandleMetadataFromBroker();
+    WriteSnapshot();
+  }
+
   MsgStateTracker.PruneTopics(
       TMsgStateTracker::TTopicExistsFn(t_topic_exists_fn(*Metadata)));
 
@@ -1751,3 +2329,27 @@ void TRouterThread::SetMetadata(std::shared_ptr<TMetadata> &&meta,
 
   TmpBrokerMap.clear();
 }
+
+void TRouterThread::WriteSnapshot() {
+  assert(this);
+  assert(Metadata);
+
+  if (Config.MetadataSnapshotPath.empty()) {
+    return;
+  }
+
+  try {
+    WriteMetadataSnapshot(*Metadata, Config.MetadataSnapshotPath);
+    MetadataSnapshotWritten.Increment();
+  } catch (const std::exception &x) {
+    /* Routing doesn't depend on the snapshot, so keep going.  We will try
+       again on the next metadata change. */
+    MetadataSnapshotWriteFail.Increment();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Router thread failed to write metadata snapshot [%s]: "
+             "%s", Config.MetadataSnapshotPath.c_str(), x.what());
+    }
+  }
+}
@@ -42,13 +42,21 @@
 #include <base/opt.h>
 #include <base/timer_fd.h>
 #include <dory/anomaly_tracker.h>
+#include <dory/background_metadata_fetcher.h>
 #include <dory/batch/global_batch_config.h>
 #include <dory/batch/per_topic_batcher.h>
+#include <dory/conf/broker_connections_conf.h>
+#include <dory/conf/compression_conf.h>
 #include <dory/conf/conf.h>
+#include <dory/conf/topic_max_age_conf.h>
+#include <dory/conf/topic_priority_conf.h>
 #include <dory/conf/topic_rate_conf.h>
+#include <dory/conf_generation.h>
 #include <dory/config.h>
 #include <dory/debug/debug_logger.h>
 #include <dory/debug/debug_setup.h>
+#include <dory/idempotent_producer.h>
+#include <dory/journal/msg_journal.h>
 #include <dory/metadata_timestamp.h>
 #include <dory/metadata.h>
 #include <dory/metadata_fetcher.h>
@@ -71,8 +79,11 @@ namespace Dory {
     TRouterThread(const TConfig &config, const Conf::TConf &conf,
         TAnomalyTracker &anomaly_tracker, TMsgStateTracker &msg_state_tracker,
         const Batch::TGlobalBatchConfig &batch_config,
+        Batch::TAdaptiveBatchStats &adaptive_batch_stats,
+        TIdempotentProducer &idempotent_producer,
         const Debug::TDebugSetup &debug_setup,
-        MsgDispatch::TKafkaDispatcherApi &dispatcher);
+        MsgDispatch::TKafkaDispatcherApi &dispatcher,
+        TConfGeneration &conf_generation);
 
     virtual ~TRouterThread() noexcept;
 
@@ -109,6 +120,21 @@ namespace Dory {
       return MetadataTimestamp;
     }
 
+    /* Called by the main thread once it has loaded and validated a new
+       version of the config file.  The router thread swaps in the new config
+       the next time it gets around to it.  If a previously requested config
+       has not yet been swapped in, it is replaced by this one. */
+    void RequestConfReload(size_t generation, Conf::TConf &&conf,
+        Batch::TGlobalBatchConfig &&batch_config);
+
+    /* If 'journal' is not null, messages received from the input threads are
+       appended to it, and messages discarded on shutdown are retained in it.
+       Must be called before the thread is started. */
+    void SetJournal(Journal::TMsgJournal *journal) {
+      assert(this);
+      MsgJournal = journal;
+    }
+
     /* Used by main thread during shutdown. */
     std::list<TMsg::TPtr> GetRemainingMsgs() {
       assert(this);
@@ -204,11 +230,23 @@ namespace Dory {
        broker level will be bypassed. */
     void RouteAnyPartitionNow(std::list<std::list<TMsg::TPtr>> &&batch_list);
 
+    /* Discard messages in 'batch_list' that are older than their topics' max
+       ages.  Does nothing if no topic has a max age. */
+    void DiscardExpired(std::list<std::list<TMsg::TPtr>> &batch_list);
+
     /* Route a list of message batches.  For each batch, all messages have the
        same topic, and all have routing type PartitionKey.  Batching at the
        broker level will be bypassed. */
     void RoutePartitionKeyNow(std::list<std::list<TMsg::TPtr>> &&batch_list);
 
+    /* Route a list of AnyPartition messages with mixed topics, each holding a
+       sequence number that still applies.  Send each message to the broker
+       leading its partition, so a broker can detect a duplicate.  If the
+       partition is no longer available, the message loses its sequence number
+       and is routed like any other AnyPartition message.  Batching at the
+       broker level will be bypassed. */
+    void RouteSequencedNow(std::list<TMsg::TPtr> &&msg_list);
+
     /* Reroute a list of message batches obtained from the dispatcher after it
        has shut down in preparation for new metadata.  For each batch, all
        messages have the same topic, although their routing types may differ.
@@ -230,6 +268,24 @@ namespace Dory {
 
     bool RefreshMetadata();
 
+    /* Called when the background metadata fetch started from a snapshot
+       during initialization finishes.  Return true on success, or false if
+       we got a shutdown signal and the shutdown delay expired. */
+    bool HandleBackgroundMetadata();
+
+    /* Called once we have metadata from a broker.  Route the messages held
+       for topics missing from the snapshot, discarding any whose topics are
+       still unknown.  Return true on success, or false if the shutdown delay
+       expired during a metadata update due to topic autocreate. */
+    bool RouteSnapshotUnknownTopicMsgs();
+
+    /* Called when we get metadata from a broker, whether or not it differs
+       from 'Metadata'.  Stop any background fetch still in progress, since
+       its result may be older than what we got. */
+    void HandleMetadataFromBroker();
+
+    void StopBackgroundMetadataFetch();
+
     std::list<std::list<TMsg::TPtr>> EmptyDispatcher();
 
     bool RespondToPause();
@@ -244,6 +300,16 @@ namespace Dory {
 
     bool HandleMetadataUpdate();
 
+    bool HaveNewInitialBrokers(const Conf::TConf &conf) const;
+
+    /* Swap in a config file reloaded by the main thread.  Router-side
+       settings, including per topic batching, are swapped in place.  New
+       compression and batching config is handed to the running dispatcher,
+       whose connectors swap it in between produce requests.  The dispatcher
+       is restarted only if the broker connection config changed.  This
+       doesn't wait for new metadata. */
+    void HandleConfReload();
+
     void ContinueShutdown();
 
     int ComputeMainLoopPollTimeout();
@@ -262,6 +328,16 @@ namespace Dory {
 
     void UpdateKnownBrokers(const TMetadata &md);
 
+    /* If a partial metadata request should be sent, fill 'topics' with the
+       topics to request and return true.  Otherwise return false. */
+    bool GetPartialMetadataTopics(std::vector<std::string> &topics) const;
+
+    /* Get metadata from the broker 'MetadataFetcher' is connected to.  This
+       requests metadata only for the topics we have seen if possible, and
+       merges the result with our current metadata.  Returned shared_ptr
+       contains a TMetadata on success, or nothing on failure. */
+    std::shared_ptr<TMetadata> FetchMetadataFromBroker();
+
     /* Returned shared_ptr contains a TMetadata on success, or nothing on
        failure. */
     std::shared_ptr<TMetadata> TryGetMetadata();
@@ -288,31 +364,61 @@ namespace Dory {
     void UpdateBatchStateForNewMetadata(const TMetadata &old_md,
         const TMetadata &new_md);
 
+    /* Unless 'from_snapshot' is true, also save 'meta' to the snapshot
+       file. */
     void SetMetadata(std::shared_ptr<TMetadata> &&meta,
-        bool record_update = true);
+        bool record_update = true, bool from_snapshot = false);
+
+    /* Save 'Metadata' to the snapshot file, if one is configured. */
+    void WriteSnapshot();
 
     const TConfig &Config;
 
     /* Configuration for per-topic message rate limiting. */
     Conf::TTopicRateConf TopicRateConf;
 
-    /* Limits message rates according to 'TopicRateConf'. */
-    TMsgRateLimiter MsgRateLimiter;
+    /* Limits message rates according to 'TopicRateConf'.  Replaced when the
+       config file is reloaded. */
+    std::unique_ptr<TMsgRateLimiter> MsgRateLimiter;
+
+    /* Decides which messages go in the high priority lane of their connector.
+       Replaced when the config file is reloaded. */
+    Conf::TTopicPriorityConf TopicPriorityConf;
+
+    /* Gives the max age of messages for each topic.  Replaced when the config
+       file is reloaded. */
+    Conf::TTopicMaxAgeConf TopicMaxAgeConf;
 
     /* Header overhead for a single message.  For checking message size. */
     size_t SingleMsgOverhead;
 
     /* Maximum total message size (key + value + header space (see
        'SingleMsgOverhead' above)) allowed by Kafka brokers. */
-    const size_t MessageMaxBytes;
+    size_t MessageMaxBytes;
+
+    /* The config most recently given to the dispatcher.  On config file
+       reload, the dispatcher is restarted only if the broker connection
+       config changes. */
+    Conf::TCompressionConf DispatcherCompressionConf;
+
+    Conf::TBrokerConnectionsConf DispatcherBrokerConnectionsConf;
+
+    Batch::TGlobalBatchConfig DispatcherBatchConfig;
 
     /* For tracking discarded messages and possible duplicates. */
     TAnomalyTracker &AnomalyTracker;
 
     TMsgStateTracker &MsgStateTracker;
 
+    /* Shared with the dispatcher.  When enabled, we get a producer ID along
+       with each metadata update if we don't already have one. */
+    TIdempotentProducer &IdempotentProducer;
+
     const Debug::TDebugSetup &DebugSetup;
 
+    /* Message journal, or null if journaling is disabled. */
+    Journal::TMsgJournal *MsgJournal;
+
     /* This becomes readable when the router thread has finished its
        initialization and is open for business. */
     Base::TEventSemaphore InitFinishedSem;
@@ -334,6 +440,9 @@ namespace Dory {
     /* Object responsible for getting metadata requests from brokers. */
     std::unique_ptr<TMetadataFetcher> MetadataFetcher;
 
+    /* Initial brokers from the config file currently in use. */
+    std::vector<TKafkaBroker> InitialBrokers;
+
     /* List of known Kafka brokers.  We pick one of these when we need to send
        a metadata request. */
     std::vector<TKafkaBroker> KnownBrokers;
@@ -341,6 +450,21 @@ namespace Dory {
     /* Metadata used for routing messages to brokers. */
     std::shared_ptr<TMetadata> Metadata;
 
+    /* True while 'Metadata' came from the snapshot file rather than from a
+       broker.  A message for an unknown topic is then held in
+       'SnapshotUnknownTopicMsgs', since the topic may have been created after
+       the snapshot was saved. */
+    bool MetadataFromSnapshot;
+
+    /* Fetches metadata after we start up using the snapshot file.  Null once
+       the fetch has finished. */
+    std::unique_ptr<TBackgroundMetadataFetcher> BackgroundMetadataFetcher;
+
+    /* Messages for topics missing from the snapshot metadata, in arrival
+       order.  They are routed once the background fetch gets fresh metadata.
+     */
+    std::list<TMsg::TPtr> SnapshotUnknownTopicMsgs;
+
     /* The vector item indexes correspond to the topic indexes in the metadata.
        Each time a message or batch of messages is routed, the counter for that
        topic is incremented.  The counter values are used for broker selection.
@@ -348,6 +472,19 @@ namespace Dory {
        time a message for the corresponding topic is routed. */
     std::vector<size_t> RouteCounters;
 
+    /* The vector item indexes correspond to the topic indexes in the metadata.
+       An item is true if we have received a message for that topic.  When
+       partial metadata refresh is enabled, we request metadata only for these
+       topics. */
+    std::vector<bool> TopicSeen;
+
+    /* True when the next metadata fetch must request all topics. */
+    bool NeedFullMetadata;
+
+    /* Time in milliseconds since the epoch when we last got metadata for all
+       topics. */
+    uint64_t LastFullMetadataTime;
+
     /* Per-topic batching for AnyPartition messages is done here, before
        messages get routed to a broker.  Per-topic batching for PartitionKey
        messages is done at the broker level. */
@@ -372,10 +509,12 @@ namespace Dory {
       MsgAvailable = 2,
       MdUpdateRequest = 3,
       MdRefresh = 4,
-      ShutdownFinished = 5
+      ShutdownFinished = 5,
+      ConfReloadRequest = 6,
+      BackgroundMd = 7
     };  // TMainLoopPollItem
 
-    Util::TPollArray<TMainLoopPollItem, 6> MainLoopPollArray;
+    Util::TPollArray<TMainLoopPollItem, 8> MainLoopPollArray;
 
     /* This becomes known when a slow shutdown starts.  The units are
        milliseconds since the epoch. */
@@ -395,6 +534,33 @@ namespace Dory {
     /* Push to tell daemon to update its metadata. */
     Base::TEventSemaphore MetadataUpdateRequestSem;
 
+    /* A reloaded config file waiting to be swapped in. */
+    struct TPendingConf {
+      size_t Generation;
+
+      Conf::TConf Conf;
+
+      Batch::TGlobalBatchConfig BatchConfig;
+
+      TPendingConf(size_t generation, Conf::TConf &&conf,
+          Batch::TGlobalBatchConfig &&batch_config)
+          : Generation(generation),
+            Conf(std::move(conf)),
+            BatchConfig(std::move(batch_config)) {
+      }
+    };  // TPendingConf
+
+    /* Protects 'PendingConf', which the main thread sets. */
+    std::mutex PendingConfMutex;
+
+    std::unique_ptr<TPendingConf> PendingConf;
+
+    /* Main thread pushes this after setting 'PendingConf'. */
+    Base::TEventSemaphore ConfReloadRequestSem;
+
+    /* Tracks which config file generation is in use. */
+    TConfGeneration &ConfGeneration;
+
     Debug::TDebugLogger DebugLogger;
   };  // TRouterThread
 
@@ -0,0 +1,355 @@
+/* <dory/shm/shm_input_agent.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/shm/shm_input_agent.h>.
+ */
+
+#include <dory/shm/shm_input_agent.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/gettid.h>
+#include <base/no_default_case.h>
+#include <dory/input_dg/input_dg_util.h>
+#include <dory/shm/shm_ring_layout.h>
+#include <dory/util/time_util.h>
+#include <server/counter.h>
+#include <socket/address.h>
+#include <socket/fd_passing.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Shm;
+using namespace Dory::Spool;
+using namespace Dory::Util;
+using namespace Socket;
+using namespace Thread;
+
+SERVER_COUNTER(ShmInputAgentForwardMsg);
+SERVER_COUNTER(ShmInputAgentReadDg);
+SERVER_COUNTER(ShmInputAgentRingClosed);
+SERVER_COUNTER(ShmInputAgentRingCorrupt);
+SERVER_COUNTER(ShmInputAgentRingCreateFailed);
+SERVER_COUNTER(ShmInputAgentRingOpened);
+SERVER_COUNTER(ShmInputAgentRejectTooManyRings);
+
+const size_t TShmInputAgent::MAX_DGS_PER_RING;
+
+TShmInputAgent::TShmInputAgent(const TConfig &config, TPool &pool,
+    TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
+    TGatePutApi<TMsg::TPtr> &output_queue, TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota)
+    : Config(config),
+      Destroying(false),
+      Pool(pool),
+      MsgStateTracker(msg_state_tracker),
+      AnomalyTracker(anomaly_tracker),
+      ControlSocket(SOCK_STREAM, 0),
+      OutputQueue(output_queue),
+      OverflowSpool(overflow_spool),
+      TopicQuota(topic_quota),
+      SyncStartSuccess(false),
+      SyncStartNotify(nullptr) {
+}
+
+TShmInputAgent::~TShmInputAgent() noexcept {
+  /* This will shut down the thread if something unexpected happens.  Setting
+     the 'Destroying' flag tells the thread to shut down immediately when it
+     gets the shutdown request. */
+  Destroying = true;
+  ShutdownOnDestroy();
+}
+
+bool TShmInputAgent::SyncStart() {
+  assert(this);
+
+  if (IsStarted()) {
+    throw std::logic_error("Cannot call SyncStart() when shared memory input "
+        "agent is already started");
+  }
+
+  SyncStartSuccess = false;
+  TEventSemaphore started;
+  SyncStartNotify = &started;
+  Start();
+  started.Pop();
+  SyncStartNotify = nullptr;
+  return SyncStartSuccess;
+}
+
+void TShmInputAgent::Run() {
+  assert(this);
+  int tid = static_cast<int>(Gettid());
+  syslog(LOG_NOTICE, "Shared memory input thread %d started", tid);
+
+  try {
+    OpenControlSocket();
+  } catch (...) {
+    if (SyncStartNotify) {
+      try {
+        SyncStartNotify->Push();
+      } catch (...) {
+        syslog(LOG_ERR,
+            "Failed to notify on error starting shared memory input agent");
+        _exit(EXIT_FAILURE);
+      }
+    }
+
+    throw;
+  }
+
+  if (SyncStartNotify) {
+    SyncStartSuccess = true;
+    SyncStartNotify->Push();
+  }
+
+  syslog(LOG_NOTICE, "Shared memory input thread finished initialization, "
+      "forwarding messages");
+  ForwardMessages();
+}
+
+void TShmInputAgent::OpenControlSocket() {
+  assert(this);
+  syslog(LOG_NOTICE, "Shared memory input thread opening control socket");
+  TAddress address;
+  address.SetFamily(AF_LOCAL);
+  address.SetPath(Config.ShmSocketName.c_str());
+
+  try {
+    Bind(ControlSocket, address);
+  } catch (const std::system_error &x) {
+    syslog(LOG_ERR, "Failed to create shared memory control socket file: %s",
+        x.what());
+    throw;
+  }
+
+  /* Set the permission bits on the socket file if they were specified as a
+     command line argument.  If unspecified, the umask determines the
+     permission bits. */
+  if (Config.ShmSocketMode.IsKnown()) {
+    IfLt0(chmod(Config.ShmSocketName.c_str(), *Config.ShmSocketMode));
+  }
+
+  IfLt0(listen(ControlSocket, 16));
+}
+
+void TShmInputAgent::AcceptClient() {
+  assert(this);
+  int fd = accept4(ControlSocket, nullptr, nullptr, SOCK_CLOEXEC);
+
+  if (fd < 0) {
+    if ((errno == EINTR) || (errno == ECONNABORTED) || (errno == EAGAIN)) {
+      return;
+    }
+
+    IfLt0(fd);  // this will throw
+  }
+
+  TFd conn(fd);
+  uint8_t hello[SHM_HELLO_SIZE] = { SHM_PROTOCOL_VERSION, SHM_STATUS_OK };
+
+  if (Rings.size() >= Config.ShmMaxRings) {
+    ShmInputAgentRejectTooManyRings.Increment();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_WARNING, "Rejecting shared memory client because limit of "
+          "%lu rings is reached",
+          static_cast<unsigned long>(Config.ShmMaxRings));
+    }
+
+    hello[1] = SHM_STATUS_TOO_MANY_RINGS;
+    send(conn, hello, sizeof(hello), MSG_NOSIGNAL | MSG_DONTWAIT);
+    return;
+  }
+
+  try {
+    Rings.emplace_back(1024 * Config.ShmRingSize, std::move(conn));
+  } catch (const std::system_error &x) {
+    /* The client sees its connection closed. */
+    ShmInputAgentRingCreateFailed.Increment();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Failed to create shared memory ring: %s", x.what());
+    }
+
+    return;
+  }
+
+  const TShmRing &ring = Rings.back();
+
+  try {
+    SendFds(ring.GetConn(), hello, sizeof(hello),
+        { ring.GetMemFd(), ring.GetDoorbellFd() });
+  } catch (const std::system_error &x) {
+    Rings.pop_back();
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      syslog(LOG_ERR, "Failed to send shared memory ring to client: %s",
+          x.what());
+    }
+
+    return;
+  }
+
+  ShmInputAgentRingOpened.Increment();
+}
+
+bool TShmInputAgent::ReadRing(TShmRing &ring,
+    std::list<TMsg::TPtr> &msg_list, bool &more) {
+  assert(this);
+  more = false;
+
+  for (size_t i = 0; i < MAX_DGS_PER_RING; ++i) {
+    const uint8_t *dg = nullptr;
+    size_t dg_size = 0;
+
+    switch (ring.Peek(dg, dg_size)) {
+      case TShmRing::TPeekResult::Empty: {
+        return true;
+      }
+      case TShmRing::TPeekResult::Corrupt: {
+        return false;
+      }
+      case TShmRing::TPeekResult::Ready: {
+        break;
+      }
+      NO_DEFAULT_CASE;
+    }
+
+    /* This copies the message contents into the pool, so the space can be
+       returned to the client right away. */
+    ShmInputAgentReadDg.Increment();
+    InputDg::BuildMsgsFromDg(dg, dg_size, Config, Pool, AnomalyTracker,
+        MsgStateTracker, msg_list, OverflowSpool, TopicQuota);
+    ring.Consume();
+  }
+
+  more = true;
+  return true;
+}
+
+bool TShmInputAgent::CheckConn(const TShmRing &ring) {
+  assert(this);
+  uint8_t buf[64];
+  ssize_t ret = recv(ring.GetConn(), buf, sizeof(buf), MSG_DONTWAIT);
+
+  if (ret > 0) {
+    return true;  // client isn't supposed to send anything, so ignore it
+  }
+
+  return (ret < 0) && ((errno == EAGAIN) || (errno == EINTR));
+}
+
+void TShmInputAgent::ForwardMessages() {
+  assert(this);
+  std::list<TMsg::TPtr> msg_list;
+
+  /* True if a ring may have more datagrams ready to read. */
+  bool more = false;
+
+  for (; ; ) {
+    Events.clear();
+    Events.push_back({ GetShutdownRequestFd(), POLLIN, 0 });
+    Events.push_back({ ControlSocket.GetFd(), POLLIN, 0 });
+
+    for (const TShmRing &ring : Rings) {
+      Events.push_back({ ring.GetDoorbellFd(), POLLIN, 0 });
+      Events.push_back({ ring.GetConn(), POLLIN, 0 });
+    }
+
+    IfLt0(poll(&Events[0], Events.size(), more ? 0 : -1));
+    bool shutting_down = (Events[0].revents != 0);
+
+    if (shutting_down && Destroying) {
+      break;
+    }
+
+    more = false;
+    size_t i = 2;
+
+    for (auto iter = Rings.begin(); iter != Rings.end(); i += 2) {
+      TShmRing &ring = *iter;
+
+      if (Events[i].revents) {
+        ring.ClearDoorbell();
+      }
+
+      /* On shutdown or when the client goes away, read everything the client
+         wrote before closing the ring. */
+      bool closing = shutting_down ||
+          (Events[i + 1].revents && !CheckConn(ring));
+      bool ring_more = false;
+      bool ok = ReadRing(ring, msg_list, ring_more);
+
+      while (ok && closing && ring_more) {
+        ok = ReadRing(ring, msg_list, ring_more);
+      }
+
+      if (!ok) {
+        ShmInputAgentRingCorrupt.Increment();
+        static TLogRateLimiter lim(std::chrono::seconds(30));
+
+        if (lim.Test()) {
+          syslog(LOG_ERR, "Closing corrupt shared memory ring");
+        }
+      }
+
+      if (!ok || closing) {
+        ShmInputAgentRingClosed.Increment();
+        iter = Rings.erase(iter);
+      } else {
+        more = more || ring_more;
+        ++iter;
+      }
+    }
+
+    if (!msg_list.empty()) {
+      /* Forward messages to router thread. */
+      ShmInputAgentForwardMsg.Increment(msg_list.size());
+      OutputQueue.Put(std::move(msg_list));
+      msg_list.clear();
+    }
+
+    if (shutting_down) {
+      syslog(LOG_NOTICE, "Shared memory input thread got shutdown request, "
+          "closing control socket");
+      ControlSocket.Reset();
+      break;
+    }
+
+    if (Events[1].revents) {
+      AcceptClient();
+    }
+  }
+}
@@ -0,0 +1,133 @@
+/* <dory/shm/shm_input_agent.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Input thread for shared memory rings.  Clients on the same host connect to
+   a UNIX domain stream control socket, and each gets its own ring to write
+   input datagrams to (see <dory/shm/shm_ring_layout.h>).  The thread builds
+   messages directly from the ring contents into the pool, and passes them to
+   the router thread.  It only sleeps once all rings are empty, so a busy
+   client sends messages without making any system calls.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <vector>
+
+#include <poll.h>
+
+#include <base/event_semaphore.h>
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+#include <capped/pool.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/config.h>
+#include <dory/msg.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/shm/shm_ring.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
+#include <socket/named_unix_socket.h>
+#include <thread/fd_managed_thread.h>
+#include <thread/gate_put_api.h>
+
+namespace Dory {
+
+  namespace Shm {
+
+    class TShmInputAgent final : public Thread::TFdManagedThread {
+      NO_COPY_SEMANTICS(TShmInputAgent);
+
+      public:
+      TShmInputAgent(const TConfig &config, Capped::TPool &pool,
+          TMsgStateTracker &msg_state_tracker,
+          TAnomalyTracker &anomaly_tracker,
+          Thread::TGatePutApi<TMsg::TPtr> &output_queue,
+          Spool::TOverflowSpool *overflow_spool = nullptr,
+          TTopicQuota *topic_quota = nullptr);
+
+      virtual ~TShmInputAgent() noexcept;
+
+      /* Start agent and wait for it to open control socket.  Return true on
+         success or false on failure. */
+      bool SyncStart();
+
+      protected:
+      virtual void Run() override;
+
+      private:
+      /* Maximum number of datagrams read from one ring before moving on to
+         the next, so a busy client can't starve the others. */
+      static const size_t MAX_DGS_PER_RING = 256;
+
+      void OpenControlSocket();
+
+      void AcceptClient();
+
+      /* Read up to MAX_DGS_PER_RING datagrams from 'ring', appending the
+         messages built from them to 'msg_list'.  Return false if the ring is
+         corrupt.  On return, 'more' indicates whether datagrams are left. */
+      bool ReadRing(TShmRing &ring, std::list<TMsg::TPtr> &msg_list,
+          bool &more);
+
+      /* Return false if the client closed its control connection. */
+      bool CheckConn(const TShmRing &ring);
+
+      void ForwardMessages();
+
+      const TConfig &Config;
+
+      bool Destroying;
+
+      /* Blocks for TBlob objects containing message data get allocated from
+         here. */
+      Capped::TPool &Pool;
+
+      TMsgStateTracker &MsgStateTracker;
+
+      /* For tracking discarded messages and possible duplicates. */
+      TAnomalyTracker &AnomalyTracker;
+
+      /* Clients connect here to get a ring. */
+      Socket::TNamedUnixSocket ControlSocket;
+
+      std::list<TShmRing> Rings;
+
+      std::vector<struct pollfd> Events;
+
+      /* Messages are queued here for the router thread. */
+      Thread::TGatePutApi<TMsg::TPtr> &OutputQueue;
+
+      /* If not null, messages that don't fit in 'Pool' are handed to the
+         spool rather than discarded. */
+      Spool::TOverflowSpool * const OverflowSpool;
+
+      /* If not null, messages are charged against their topics' buffer
+         quotas. */
+      TTopicQuota * const TopicQuota;
+
+      bool SyncStartSuccess;
+
+      Base::TEventSemaphore *SyncStartNotify;
+    };  // TShmInputAgent
+
+  }  // Shm
+
+}  // Dory
@@ -0,0 +1,382 @@
+/* <dory/shm/shm_input_agent.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/shm/shm_input_agent.h>.
+ */
+
+#include <dory/shm/shm_input_agent.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <base/thrower.h>
+#include <base/time_util.h>
+#include <base/tmp_file_name.h>
+#include <capped/pool.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/client/dory_client.h>
+#include <dory/client/dory_shm_ring.h>
+#include <dory/client/status_codes.h>
+#include <dory/config.h>
+#include <dory/discard_file_logger.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/test_util/misc_util.h>
+#include <thread/gate.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Client;
+using namespace Dory::Shm;
+using namespace Dory::TestUtil;
+using namespace Thread;
+
+namespace {
+
+  struct TDoryConfig {
+    private:
+    bool DoryStarted;
+
+    public:
+    DEFINE_ERROR(TStartFailure, std::runtime_error,
+        "Failed to start shared memory input agent");
+
+    TTmpFileName ShmSocketName;
+
+    std::vector<const char *> Args;
+
+    std::unique_ptr<TConfig> Cfg;
+
+    TPool Pool;
+
+    TDiscardFileLogger DiscardFileLogger;
+
+    TAnomalyTracker AnomalyTracker;
+
+    TMsgStateTracker MsgStateTracker;
+
+    std::unique_ptr<TGate<TMsg::TPtr>> OutputQueue;
+
+    std::unique_ptr<TShmInputAgent> ShmInputAgent;
+
+    explicit TDoryConfig(const char *max_rings);
+
+    ~TDoryConfig() noexcept {
+      StopDory();
+    }
+
+    void StartDory() {
+      if (!DoryStarted) {
+        if (!ShmInputAgent->SyncStart()) {
+          THROW_ERROR(TStartFailure);
+        }
+
+        DoryStarted = true;
+      }
+    }
+
+    void StopDory() {
+      if (DoryStarted) {
+        TShmInputAgent &shm_input_agent = *ShmInputAgent;
+        shm_input_agent.RequestShutdown();
+        shm_input_agent.Join();
+        DoryStarted = false;
+      }
+    }
+  };  // TDoryConfig
+
+  TDoryConfig::TDoryConfig(const char *max_rings)
+      : DoryStarted(false),
+        Pool(256, 256, TPool::TSync::Mutexed),
+        AnomalyTracker(DiscardFileLogger, 0,
+                       std::numeric_limits<size_t>::max()) {
+    Args.push_back("dory");
+    Args.push_back("--config_path");
+    Args.push_back("/nonexistent/path");
+    Args.push_back("--msg_buffer_max");
+    Args.push_back("64");  /* this is 64 * 1024 bytes, not 64 bytes */
+    Args.push_back("--shm_socket_name");
+    Args.push_back(ShmSocketName);
+
+    /* Use the smallest possible ring so it wraps around quickly. */
+    Args.push_back("--shm_ring_size");
+    Args.push_back("1");
+
+    Args.push_back("--shm_max_rings");
+    Args.push_back(max_rings);
+    Args.push_back(nullptr);
+    Cfg.reset(
+        new TConfig(Args.size() - 1, const_cast<char **>(&Args[0]), true));
+    OutputQueue.reset(new TGate<TMsg::TPtr>);
+    ShmInputAgent.reset(new TShmInputAgent(*Cfg, Pool, MsgStateTracker,
+        AnomalyTracker, *OutputQueue));
+  }
+
+  static void MakeDg(std::vector<uint8_t> &dg, const std::string &topic,
+      const std::string &body) {
+    size_t dg_size = 0;
+    int ret = dory_find_any_partition_msg_size(topic.size(), 0,
+            body.size(), &dg_size);
+    ASSERT_EQ(ret, DORY_OK);
+    dg.resize(dg_size);
+    ret = dory_write_any_partition_msg(&dg[0], dg.size(), topic.c_str(),
+            GetEpochMilliseconds(), nullptr, 0, body.data(), body.size());
+    ASSERT_EQ(ret, DORY_OK);
+  }
+
+  /* Move messages from 'output_queue' to 'msg_list' until it contains
+     'count' messages or we time out. */
+  static void GetMsgs(TGate<TMsg::TPtr> &output_queue,
+      std::list<TMsg::TPtr> &msg_list, size_t count) {
+    const Base::TFd &msg_available_fd = output_queue.GetMsgAvailableFd();
+
+    while (msg_list.size() < count) {
+      if (!msg_available_fd.IsReadable(30000)) {
+        break;
+      }
+
+      msg_list.splice(msg_list.end(), output_queue.Get());
+    }
+  }
+
+  /* Check that 'msg_list' holds the given bodies in order for 'topic', and
+     mark the messages processed. */
+  static void CheckMsgs(std::list<TMsg::TPtr> &msg_list,
+      const std::string &topic, const std::vector<std::string> &bodies) {
+    ASSERT_EQ(msg_list.size(), bodies.size());
+    size_t i = 0;
+
+    for (const TMsg::TPtr &msg_ptr : msg_list) {
+      /* Prevent spurious assertion failure in msg dtor. */
+      SetProcessed(msg_ptr);
+
+      ASSERT_EQ(msg_ptr->GetTopic(), topic);
+      ASSERT_TRUE(ValueEquals(msg_ptr, bodies[i]));
+      ++i;
+    }
+  }
+
+  /* The fixture for testing class TShmInputAgent. */
+  class TShmInputAgentTest : public ::testing::Test {
+    protected:
+    TShmInputAgentTest() {
+    }
+
+    virtual ~TShmInputAgentTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TShmInputAgentTest
+
+  TEST_F(TShmInputAgentTest, SuccessfulForwarding) {
+    TDoryConfig conf("4");
+    TGate<TMsg::TPtr> &output_queue = *conf.OutputQueue;
+
+    try {
+      conf.StartDory();
+    } catch (const TDoryConfig::TStartFailure &) {
+      ASSERT_TRUE(false);
+    }
+
+    TDoryShmRing ring;
+    int ret = ring.Open(conf.ShmSocketName);
+    ASSERT_EQ(ret, DORY_OK);
+    ASSERT_TRUE(ring.IsOpen());
+    std::vector<std::string> bodies;
+    bodies.push_back("Scooby");
+    bodies.push_back("Shaggy");
+    bodies.push_back("Velma");
+    bodies.push_back("Daphne");
+    std::vector<uint8_t> dg_buf;
+
+    for (const std::string &body : bodies) {
+      MakeDg(dg_buf, "topic", body);
+      ret = ring.Send(&dg_buf[0], dg_buf.size());
+      ASSERT_EQ(ret, DORY_OK);
+    }
+
+    std::list<TMsg::TPtr> msg_list;
+    GetMsgs(output_queue, msg_list, bodies.size());
+    CheckMsgs(msg_list, "topic", bodies);
+    msg_list.clear();
+    TAnomalyTracker::TInfo bad_stuff;
+    conf.AnomalyTracker.GetInfo(bad_stuff);
+    ASSERT_EQ(bad_stuff.DiscardTopicMap.size(), 0U);
+    ASSERT_EQ(bad_stuff.MalformedMsgCount, 0U);
+  }
+
+  TEST_F(TShmInputAgentTest, Wraparound) {
+    TDoryConfig conf("4");
+    TGate<TMsg::TPtr> &output_queue = *conf.OutputQueue;
+
+    try {
+      conf.StartDory();
+    } catch (const TDoryConfig::TStartFailure &) {
+      ASSERT_TRUE(false);
+    }
+
+    TDoryShmRing ring;
+    int ret = ring.Open(conf.ShmSocketName);
+    ASSERT_EQ(ret, DORY_OK);
+
+    /* Odd sizes make records need padding to stay aligned, and make the
+       padding at the end of the data area vary from lap to lap. */
+    std::vector<std::string> bodies;
+
+    for (size_t i = 0; i < 500; ++i) {
+      bodies.push_back(std::string(1 + (i % 37), 'a' + (i % 26)));
+    }
+
+    /* Messages are checked and released as they arrive, since the pool is
+       much smaller than the total size of all messages. */
+    size_t received = 0;
+    auto check_msgs = [&](std::list<TMsg::TPtr> &&msg_list) {
+      for (const TMsg::TPtr &msg_ptr : msg_list) {
+        /* Prevent spurious assertion failure in msg dtor. */
+        SetProcessed(msg_ptr);
+
+        ASSERT_LT(received, bodies.size());
+        ASSERT_TRUE(ValueEquals(msg_ptr, bodies[received]));
+        ++received;
+      }
+    };
+    std::vector<uint8_t> dg_buf;
+
+    for (const std::string &body : bodies) {
+      MakeDg(dg_buf, "topic", body);
+
+      for (size_t i = 0; ; ++i) {
+        ret = ring.Send(&dg_buf[0], dg_buf.size());
+
+        if (ret != EAGAIN) {
+          break;
+        }
+
+        /* Ring is full.  Give dory time to catch up. */
+        ASSERT_LT(i, 3000U);
+        check_msgs(output_queue.NonblockingGet());
+        SleepMilliseconds(1);
+      }
+
+      ASSERT_EQ(ret, DORY_OK);
+    }
+
+    const Base::TFd &msg_available_fd = output_queue.GetMsgAvailableFd();
+
+    while ((received < bodies.size()) && msg_available_fd.IsReadable(30000)) {
+      check_msgs(output_queue.Get());
+    }
+
+    ASSERT_EQ(received, bodies.size());
+    TAnomalyTracker::TInfo bad_stuff;
+    conf.AnomalyTracker.GetInfo(bad_stuff);
+    ASSERT_EQ(bad_stuff.DiscardTopicMap.size(), 0U);
+    ASSERT_EQ(bad_stuff.MalformedMsgCount, 0U);
+  }
+
+  TEST_F(TShmInputAgentTest, TooLarge) {
+    TDoryConfig conf("4");
+
+    try {
+      conf.StartDory();
+    } catch (const TDoryConfig::TStartFailure &) {
+      ASSERT_TRUE(false);
+    }
+
+    TDoryShmRing ring;
+    int ret = ring.Open(conf.ShmSocketName);
+    ASSERT_EQ(ret, DORY_OK);
+    std::vector<uint8_t> dg_buf;
+    MakeDg(dg_buf, "topic", std::string(2048, 'x'));
+    ret = ring.Send(&dg_buf[0], dg_buf.size());
+    ASSERT_EQ(ret, EMSGSIZE);
+  }
+
+  TEST_F(TShmInputAgentTest, DrainOnClose) {
+    TDoryConfig conf("1");
+    TGate<TMsg::TPtr> &output_queue = *conf.OutputQueue;
+
+    try {
+      conf.StartDory();
+    } catch (const TDoryConfig::TStartFailure &) {
+      ASSERT_TRUE(false);
+    }
+
+    TDoryShmRing ring;
+    int ret = ring.Open(conf.ShmSocketName);
+    ASSERT_EQ(ret, DORY_OK);
+
+    /* The limit of 1 ring is reached. */
+    TDoryShmRing ring2;
+    ret = ring2.Open(conf.ShmSocketName);
+    ASSERT_EQ(ret, EBUSY);
+    ASSERT_FALSE(ring2.IsOpen());
+
+    std::vector<std::string> bodies;
+    bodies.push_back("Fred");
+    bodies.push_back("Scrappy");
+    std::vector<uint8_t> dg_buf;
+
+    for (const std::string &body : bodies) {
+      MakeDg(dg_buf, "topic", body);
+      ret = ring.Send(&dg_buf[0], dg_buf.size());
+      ASSERT_EQ(ret, DORY_OK);
+    }
+
+    /* Messages written before closing the ring still get through. */
+    ring.Close();
+    ASSERT_FALSE(ring.IsOpen());
+    std::list<TMsg::TPtr> msg_list;
+    GetMsgs(output_queue, msg_list, bodies.size());
+    CheckMsgs(msg_list, "topic", bodies);
+    msg_list.clear();
+
+    /* Once dory releases the closed ring, there is room for a new one. */
+    for (size_t i = 0; ; ++i) {
+      ret = ring2.Open(conf.ShmSocketName);
+
+      if (ret != EBUSY) {
+        break;
+      }
+
+      ASSERT_LT(i, 3000U);
+      SleepMilliseconds(10);
+    }
+
+    ASSERT_EQ(ret, DORY_OK);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
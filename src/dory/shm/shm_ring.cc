@@ -0,0 +1,157 @@
+/* <dory/shm/shm_ring.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/shm/shm_ring.h>.
+ */
+
+#include <dory/shm/shm_ring.h>
+
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+#include <base/field_access.h>
+#include <dory/input_dg/input_dg_constants.h>
+#include <dory/shm/shm_ring_layout.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Shm;
+
+static inline uint64_t *GetField(uint8_t *mem, size_t offset) {
+  return reinterpret_cast<uint64_t *>(mem + offset);
+}
+
+static inline size_t AlignRecordSize(size_t size) {
+  return (size + SHM_RING_RECORD_ALIGN - 1) &
+      ~(static_cast<size_t>(SHM_RING_RECORD_ALIGN) - 1);
+}
+
+TShmRing::TShmRing(size_t data_size, TFd &&conn)
+    : Mem(nullptr),
+      MemSize(SHM_RING_DATA_OFFSET + data_size),
+      DataSize(data_size),
+      Tail(0),
+      NextTail(0),
+      MemFd(IfLt0(memfd_create("dory_shm_ring",
+          MFD_CLOEXEC | MFD_ALLOW_SEALING))),
+      DoorbellFd(IfLt0(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))),
+      Conn(std::move(conn)) {
+  assert(DataSize >= SHM_RING_RECORD_ALIGN);
+  assert((DataSize & (DataSize - 1)) == 0);
+  IfLt0(ftruncate(MemFd, static_cast<off_t>(MemSize)));
+
+  /* The client must not be able to resize the memfd, since touching pages
+     past its end would kill us with SIGBUS. */
+  IfLt0(fcntl(MemFd, F_ADD_SEALS,
+      F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+  void *addr = mmap(nullptr, MemSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+      MemFd, 0);
+
+  if (addr == MAP_FAILED) {
+    IfLt0(-1);  // this will throw
+  }
+
+  Mem = reinterpret_cast<uint8_t *>(addr);
+  *reinterpret_cast<uint32_t *>(Mem + SHM_RING_MAGIC_OFFSET) = SHM_RING_MAGIC;
+  *reinterpret_cast<uint32_t *>(Mem + SHM_RING_VERSION_OFFSET) =
+      SHM_RING_VERSION;
+  *GetField(Mem, SHM_RING_DATA_SIZE_OFFSET) = DataSize;
+}
+
+TShmRing::~TShmRing() noexcept {
+  munmap(Mem, MemSize);
+}
+
+void TShmRing::ClearDoorbell() {
+  assert(this);
+  eventfd_t count = 0;
+
+  if ((eventfd_read(DoorbellFd, &count) < 0) && (errno != EAGAIN)) {
+    IfLt0(-1);  // this will throw
+  }
+}
+
+TShmRing::TPeekResult TShmRing::Peek(const uint8_t *&dg, size_t &dg_size) {
+  assert(this);
+  uint64_t *head_field = GetField(Mem, SHM_RING_HEAD_OFFSET);
+  uint8_t *data = Mem + SHM_RING_DATA_OFFSET;
+
+  for (; ; ) {
+    uint64_t head = __atomic_load_n(head_field, __ATOMIC_ACQUIRE);
+
+    if (head == Tail) {
+      /* Pairs with the fence the client executes between advancing the head
+         and checking whether the ring was empty.  Either we see its new
+         head, or it sees our tail and rings the doorbell. */
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      head = __atomic_load_n(head_field, __ATOMIC_ACQUIRE);
+
+      if (head == Tail) {
+        return TPeekResult::Empty;
+      }
+    }
+
+    uint64_t used = head - Tail;
+
+    if ((used > DataSize) || (used % SHM_RING_RECORD_ALIGN)) {
+      return TPeekResult::Corrupt;
+    }
+
+    size_t pos = Tail & (DataSize - 1);
+    size_t contig = DataSize - pos;
+    int32_t size = ReadInt32FromHeader(data + pos);
+
+    if (size == 0) {
+      /* Padding.  The next record starts at the beginning of the data area.
+       */
+      if (used < contig) {
+        return TPeekResult::Corrupt;
+      }
+
+      Tail += contig;
+      __atomic_store_n(GetField(Mem, SHM_RING_TAIL_OFFSET), Tail,
+          __ATOMIC_RELEASE);
+      continue;
+    }
+
+    if ((size < INPUT_DG_SZ_FIELD_SIZE) ||
+        (static_cast<size_t>(size) > contig) ||
+        (AlignRecordSize(size) > used)) {
+      return TPeekResult::Corrupt;
+    }
+
+    dg = data + pos;
+    dg_size = static_cast<size_t>(size);
+    NextTail = Tail + AlignRecordSize(dg_size);
+    return TPeekResult::Ready;
+  }
+}
+
+void TShmRing::Consume() {
+  assert(this);
+  assert(NextTail > Tail);
+  Tail = NextTail;
+  __atomic_store_n(GetField(Mem, SHM_RING_TAIL_OFFSET), Tail,
+      __ATOMIC_RELEASE);
+}
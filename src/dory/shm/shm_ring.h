@@ -0,0 +1,112 @@
+/* <dory/shm/shm_ring.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Consumer side of a shared memory ring that a client writes input datagrams
+   to.  See <dory/shm/shm_ring_layout.h> for the ring layout.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  namespace Shm {
+
+    class TShmRing final {
+      NO_COPY_SEMANTICS(TShmRing);
+
+      public:
+      enum class TPeekResult {
+        /* Nothing to read. */
+        Empty,
+
+        /* A datagram is ready to read. */
+        Ready,
+
+        /* The client wrote something that doesn't follow the ring format.
+           The ring can't be used any more. */
+        Corrupt
+      };  // TPeekResult
+
+      /* Create a ring backed by a new memfd, with a data area of 'data_size'
+         bytes, which must be a power of 2.  'conn' is the control
+         connection to the client that will write to the ring.  Throws
+         std::system_error on error. */
+      TShmRing(size_t data_size, Base::TFd &&conn);
+
+      ~TShmRing() noexcept;
+
+      const Base::TFd &GetMemFd() const noexcept {
+        assert(this);
+        return MemFd;
+      }
+
+      const Base::TFd &GetDoorbellFd() const noexcept {
+        assert(this);
+        return DoorbellFd;
+      }
+
+      const Base::TFd &GetConn() const noexcept {
+        assert(this);
+        return Conn;
+      }
+
+      /* Reset the doorbell after it becomes readable. */
+      void ClearDoorbell();
+
+      /* Find the next datagram in the ring.  On a return value of Ready,
+         'dg' and 'dg_size' give the datagram, which stays in place until
+         Consume() is called.  When the ring is found empty, the client is
+         guaranteed to ring the doorbell when it next writes. */
+      TPeekResult Peek(const uint8_t *&dg, size_t &dg_size);
+
+      /* Release the space of the datagram returned by the last call to
+         Peek() to the client. */
+      void Consume();
+
+      private:
+      /* Points to start of shared mapping. */
+      uint8_t *Mem;
+
+      size_t MemSize;
+
+      /* Size of data area.  A power of 2. */
+      const size_t DataSize;
+
+      /* Our copy of the tail.  Only we write it. */
+      uint64_t Tail;
+
+      /* Tail after datagram returned by Peek() is consumed. */
+      uint64_t NextTail;
+
+      Base::TFd MemFd;
+
+      Base::TFd DoorbellFd;
+
+      Base::TFd Conn;
+    };  // TShmRing
+
+  }  // Shm
+
+}  // Dory
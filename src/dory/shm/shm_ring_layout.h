@@ -0,0 +1,84 @@
+/* <dory/shm/shm_ring_layout.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Layout of a shared memory ring for sending messages to dory, and the
+   protocol for obtaining one.
+
+   A client connects to dory's UNIX domain stream control socket.  Dory
+   replies with a message of SHM_HELLO_SIZE bytes: the protocol version
+   followed by a status.  On success, the memfd holding the ring and an
+   eventfd doorbell are attached as SCM_RIGHTS ancillary data, in that order.
+   The ring stays in use until the client closes the connection, after which
+   dory processes whatever is left in it and releases it.
+
+   The ring starts with a header holding the fields below at the given byte
+   offsets, in host byte order.  Head and tail are byte counts that only
+   increase.  Only the client writes the head, and only dory writes the tail.
+   The data area follows the header.  Its size is a power of 2.
+
+   Each record in the data area is a datagram in the input datagram format
+   (see <dory/input_dg/input_dg_util.h>), starting at an offset that is a
+   multiple of SHM_RING_RECORD_ALIGN.  A record never wraps around the end of
+   the data area.  If the next record doesn't fit before the end, the client
+   writes a 4-byte 0 there in place of the datagram size field, and starts the
+   record at the beginning of the data area.
+
+   After advancing the head, the client writes to the doorbell if the ring was
+   empty, meaning the tail was equal to the old head.  Dory only waits on the
+   doorbell after it finds the ring empty, so a busy ring costs no system
+   calls on either side.
+ */
+
+#pragma once
+
+/* It should be possible to compile everything in here with a C compiler.
+   That's why there are no namespaces below. */
+
+enum { SHM_PROTOCOL_VERSION = 1 };
+
+enum { SHM_HELLO_SIZE = 2 };
+
+/* Status values in hello message. */
+enum { SHM_STATUS_OK = 0 };
+
+enum { SHM_STATUS_TOO_MANY_RINGS = 1 };
+
+enum { SHM_STATUS_ERROR = 2 };
+
+enum { SHM_RING_MAGIC = 0x444f5259 };
+
+enum { SHM_RING_VERSION = 1 };
+
+/* uint32_t */
+enum { SHM_RING_MAGIC_OFFSET = 0 };
+
+/* uint32_t */
+enum { SHM_RING_VERSION_OFFSET = 4 };
+
+/* uint64_t: size in bytes of data area */
+enum { SHM_RING_DATA_SIZE_OFFSET = 8 };
+
+/* uint64_t: written by client.  Head and tail are on separate cache lines. */
+enum { SHM_RING_HEAD_OFFSET = 64 };
+
+/* uint64_t: written by dory */
+enum { SHM_RING_TAIL_OFFSET = 128 };
+
+enum { SHM_RING_DATA_OFFSET = 192 };
+
+enum { SHM_RING_RECORD_ALIGN = 8 };
@@ -0,0 +1,358 @@
+/* <dory/spool/overflow_spool.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/spool/overflow_spool.h>.
+ */
+
+#include <dory/spool/overflow_spool.h>
+
+#include <array>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <string>
+#include <system_error>
+
+#include <poll.h>
+#include <syslog.h>
+
+#include <base/error_utils.h>
+#include <base/gettid.h>
+#include <capped/memory_cap_reached.h>
+#include <dory/msg_creator.h>
+#include <dory/util/time_util.h>
+#include <server/counter.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::Spool;
+using namespace Dory::Util;
+using namespace Thread;
+
+SERVER_COUNTER(SpoolDiscardHandoffFull);
+SERVER_COUNTER(SpoolDiscardLogFull);
+SERVER_COUNTER(SpoolDiscardOnShutdown);
+SERVER_COUNTER(SpoolDiscardWriteError);
+SERVER_COUNTER(SpoolMsgReplay);
+SERVER_COUNTER(SpoolMsgWrite);
+SERVER_COUNTER(SpoolReplayByte);
+SERVER_COUNTER(SpoolReplayNoMem);
+SERVER_COUNTER(SpoolWriteByte);
+
+TOverflowSpool::TOverflowSpool(const char *spool_dir, size_t max_size,
+    size_t segment_size, size_t max_handoff_size, bool no_log_discard,
+    TPool &pool, TMsgStateTracker &msg_state_tracker,
+    TAnomalyTracker &anomaly_tracker, TGatePutApi<TMsg::TPtr> &output_queue)
+    : MaxSize(max_size),
+      MaxHandoffSize(max_handoff_size),
+      NoLogDiscard(no_log_discard),
+      Pool(pool),
+      MsgStateTracker(msg_state_tracker),
+      AnomalyTracker(anomaly_tracker),
+      OutputQueue(output_queue),
+      Log(spool_dir, segment_size,
+          std::max<size_t>(1, max_size / segment_size)),
+      HandoffSize(0),
+      SpooledBytes(0),
+      SpooledMsgs(0) {
+}
+
+TOverflowSpool::~TOverflowSpool() noexcept {
+  /* This will shut down the thread if something unexpected happens. */
+  ShutdownOnDestroy();
+}
+
+bool TOverflowSpool::TryPut(TMsg::TRoutingType routing_type,
+    int32_t partition_key, TMsg::TTimestamp timestamp,
+    const char *topic_begin, const char *topic_end, const void *key_begin,
+    size_t key_size, const void *value_begin, size_t value_size) {
+  assert(this);
+  assert(topic_end >= topic_begin);
+  size_t topic_size = topic_end - topic_begin;
+  size_t rec_size = sizeof(TRecordHeader) + topic_size + key_size +
+      value_size;
+
+  /* Check limits before copying anything.  The checks are repeated below
+     while holding the mutex. */
+  if (((SpooledBytes.load() + rec_size) > MaxSize) ||
+      (rec_size > MaxHandoffSize) || (rec_size > Log.GetMaxRecordSize())) {
+    SpoolDiscardHandoffFull.Increment();
+    return false;
+  }
+
+  TRecordHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.Timestamp = timestamp;
+  header.PartitionKey = partition_key;
+  header.TopicSize = static_cast<uint32_t>(topic_size);
+  header.KeySize = static_cast<uint32_t>(key_size);
+  header.ValueSize = static_cast<uint32_t>(value_size);
+  header.RoutingType = static_cast<uint8_t>(routing_type);
+  std::vector<uint8_t> rec(rec_size);
+  uint8_t *pos = &rec[0];
+  std::memcpy(pos, &header, sizeof(header));
+  pos += sizeof(header);
+  std::memcpy(pos, topic_begin, topic_size);
+  pos += topic_size;
+
+  if (key_size) {
+    std::memcpy(pos, key_begin, key_size);
+    pos += key_size;
+  }
+
+  if (value_size) {
+    std::memcpy(pos, value_begin, value_size);
+  }
+
+  bool was_empty = false;
+
+  {
+    std::lock_guard<std::mutex> lock(HandoffMutex);
+
+    if (((HandoffSize + rec_size) > MaxHandoffSize) ||
+        ((SpooledBytes.load() + rec_size) > MaxSize)) {
+      SpoolDiscardHandoffFull.Increment();
+      return false;
+    }
+
+    was_empty = HandoffList.empty();
+    HandoffList.push_back(std::move(rec));
+    HandoffSize += rec_size;
+    SpooledBytes += rec_size;
+    ++SpooledMsgs;
+  }
+
+  if (was_empty) {
+    HandoffSem.Push();
+  }
+
+  return true;
+}
+
+void TOverflowSpool::Run() {
+  assert(this);
+  int tid = static_cast<int>(Gettid());
+  syslog(LOG_NOTICE, "Overflow spool thread %d started", tid);
+  bool caught_fatal_exception = false;
+
+  try {
+    DoRun();
+  } catch (const std::exception &x) {
+    caught_fatal_exception = true;
+    syslog(LOG_ERR, "Fatal error in overflow spool thread %d: %s", tid,
+           x.what());
+  } catch (...) {
+    caught_fatal_exception = true;
+    syslog(LOG_ERR, "Fatal unknown error in overflow spool thread %d", tid);
+  }
+
+  DiscardAll();
+  syslog(LOG_NOTICE, "Overflow spool thread %d finished %s", tid,
+         caught_fatal_exception ? "on error" : "normally");
+}
+
+void TOverflowSpool::DoRun() {
+  assert(this);
+  std::array<struct pollfd, 2> events;
+  struct pollfd &shutdown_request_event = events[0];
+  struct pollfd &handoff_event = events[1];
+  shutdown_request_event.fd = GetShutdownRequestFd();
+  shutdown_request_event.events = POLLIN;
+  handoff_event.fd = HandoffSem.GetFd();
+  handoff_event.events = POLLIN;
+  int timeout = -1;
+
+  for (; ; ) {
+    for (auto &item : events) {
+      item.revents = 0;
+    }
+
+    IfLt0(poll(&events[0], events.size(), timeout));
+
+    if (shutdown_request_event.revents) {
+      syslog(LOG_NOTICE, "Overflow spool thread got shutdown request");
+      break;
+    }
+
+    if (handoff_event.revents) {
+      HandoffSem.Pop();
+      WriteHandoffMsgs();
+    }
+
+    /* Try replaying whenever we wake up.  If the buffer space cap prevents
+       progress, poll with a timeout so we retry later.  If we stopped only
+       because we replayed a full batch, continue immediately. */
+    if (Replay()) {
+      timeout = 0;
+    } else {
+      timeout = Log.IsEmpty() ? -1 : REPLAY_RETRY_INTERVAL;
+    }
+  }
+}
+
+void TOverflowSpool::WriteHandoffMsgs() {
+  assert(this);
+  std::list<std::vector<uint8_t>> handoff_list;
+
+  {
+    std::lock_guard<std::mutex> lock(HandoffMutex);
+    handoff_list.splice(handoff_list.end(), HandoffList);
+    HandoffSize = 0;
+  }
+
+  for (const std::vector<uint8_t> &rec : handoff_list) {
+    bool appended = false;
+
+    try {
+      appended = Log.Append(&rec[0], rec.size());
+    } catch (const std::system_error &x) {
+      SpoolDiscardWriteError.Increment();
+      static TLogRateLimiter lim(std::chrono::seconds(30));
+
+      if (lim.Test()) {
+        syslog(LOG_ERR, "Failed to create overflow spool segment: %s",
+               x.what());
+      }
+
+      DiscardRecord(&rec[0]);
+      continue;
+    }
+
+    if (appended) {
+      SpoolMsgWrite.Increment();
+      SpoolWriteByte.Increment(static_cast<uint32_t>(rec.size()));
+    } else {
+      SpoolDiscardLogFull.Increment();
+      DiscardRecord(&rec[0]);
+    }
+  }
+}
+
+bool TOverflowSpool::Replay() {
+  assert(this);
+
+  for (size_t i = 0; i < REPLAY_BATCH_SIZE; ++i) {
+    if (Log.IsEmpty()) {
+      return false;
+    }
+
+    size_t rec_size = 0;
+    const uint8_t *rec = Log.Front(rec_size);
+    TMsg::TPtr msg;
+
+    try {
+      msg = CreateMsg(rec);
+    } catch (const TMemoryCapReached &) {
+      SpoolReplayNoMem.Increment();
+      return false;
+    }
+
+    Log.PopFront();
+
+    /* Put the message before updating the counts.  Input threads hand off
+       new messages to us while the count is nonzero, so this keeps the last
+       replayed message ahead of them. */
+    OutputQueue.Put(std::move(msg));
+    SpooledBytes -= rec_size;
+    --SpooledMsgs;
+    SpoolMsgReplay.Increment();
+    SpoolReplayByte.Increment(static_cast<uint32_t>(rec_size));
+  }
+
+  return !Log.IsEmpty();
+}
+
+TMsg::TPtr TOverflowSpool::CreateMsg(const uint8_t *rec) {
+  assert(this);
+  TRecordHeader header;
+  std::memcpy(&header, rec, sizeof(header));
+  const char *topic_begin =
+      reinterpret_cast<const char *>(rec + sizeof(header));
+  const char *topic_end = topic_begin + header.TopicSize;
+  const uint8_t *key_begin = reinterpret_cast<const uint8_t *>(topic_end);
+  const uint8_t *value_begin = key_begin + header.KeySize;
+
+  if (static_cast<TMsg::TRoutingType>(header.RoutingType) ==
+      TMsg::TRoutingType::PartitionKey) {
+    return TMsgCreator::CreatePartitionKeyMsg(header.PartitionKey,
+        header.Timestamp, topic_begin, topic_end, key_begin, header.KeySize,
+        value_begin, header.ValueSize, false, Pool, MsgStateTracker);
+  }
+
+  return TMsgCreator::CreateAnyPartitionMsg(header.Timestamp, topic_begin,
+      topic_end, key_begin, header.KeySize, value_begin, header.ValueSize,
+      false, Pool, MsgStateTracker);
+}
+
+void TOverflowSpool::DiscardRecord(const uint8_t *rec) {
+  assert(this);
+  TRecordHeader header;
+  std::memcpy(&header, rec, sizeof(header));
+  const char *topic_begin =
+      reinterpret_cast<const char *>(rec + sizeof(header));
+  const char *topic_end = topic_begin + header.TopicSize;
+  const uint8_t *key_begin = reinterpret_cast<const uint8_t *>(topic_end);
+  const uint8_t *value_begin = key_begin + header.KeySize;
+  AnomalyTracker.TrackNoMemDiscard(header.Timestamp, topic_begin, topic_end,
+      key_begin, key_begin + header.KeySize, value_begin,
+      value_begin + header.ValueSize);
+  SpooledBytes -= sizeof(header) + header.TopicSize + header.KeySize +
+      header.ValueSize;
+  --SpooledMsgs;
+
+  if (!NoLogDiscard) {
+    static TLogRateLimiter lim(std::chrono::seconds(30));
+
+    if (lim.Test()) {
+      std::string topic(topic_begin, topic_end);
+      syslog(LOG_ERR, "Discarding spooled message (topic: [%s])",
+             topic.c_str());
+    }
+  }
+}
+
+void TOverflowSpool::DiscardAll() {
+  assert(this);
+  std::list<std::vector<uint8_t>> handoff_list;
+
+  {
+    std::lock_guard<std::mutex> lock(HandoffMutex);
+    handoff_list.splice(handoff_list.end(), HandoffList);
+    HandoffSize = 0;
+  }
+
+  size_t count = 0;
+
+  for (; !Log.IsEmpty(); Log.PopFront()) {
+    size_t rec_size = 0;
+    DiscardRecord(Log.Front(rec_size));
+    ++count;
+  }
+
+  for (const std::vector<uint8_t> &rec : handoff_list) {
+    DiscardRecord(&rec[0]);
+    ++count;
+  }
+
+  if (count) {
+    SpoolDiscardOnShutdown.Increment(static_cast<uint32_t>(count));
+    syslog(LOG_WARNING, "Overflow spool discarded %lu messages on shutdown",
+           static_cast<unsigned long>(count));
+  }
+}
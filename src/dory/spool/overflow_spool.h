@@ -0,0 +1,177 @@
+/* <dory/spool/overflow_spool.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Thread that spools messages to local disk when the buffer space cap is
+   reached, and feeds them back to the router thread as buffer space becomes
+   available.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include <base/event_semaphore.h>
+#include <base/no_copy_semantics.h>
+#include <capped/pool.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/msg.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/spool/segment_log.h>
+#include <thread/fd_managed_thread.h>
+#include <thread/gate_put_api.h>
+
+namespace Dory {
+
+  namespace Spool {
+
+    /* When an input thread fails to create a message because the buffer space
+       cap has been reached, it may hand the message contents to this class
+       instead of discarding the message.  Handing off a message only copies
+       it into a small in-memory queue, so input threads never wait for disk
+       I/O.  The spool thread appends queued messages to a TSegmentLog, and
+       replays them in FIFO order to the router thread as buffer space frees
+       up.  Messages still spooled at shutdown are discarded. */
+    class TOverflowSpool final : public Thread::TFdManagedThread {
+      NO_COPY_SEMANTICS(TOverflowSpool);
+
+      public:
+      /* 'spool_dir' is the directory for segment files.  'max_size' and
+         'segment_size' give the disk space limit and segment file size in
+         bytes.  'max_handoff_size' limits the combined size in bytes of
+         messages handed off by input threads but not yet written to disk.
+         Replayed messages are passed to 'output_queue'. */
+      TOverflowSpool(const char *spool_dir, size_t max_size,
+          size_t segment_size, size_t max_handoff_size, bool no_log_discard,
+          Capped::TPool &pool, TMsgStateTracker &msg_state_tracker,
+          TAnomalyTracker &anomaly_tracker,
+          Thread::TGatePutApi<TMsg::TPtr> &output_queue);
+
+      virtual ~TOverflowSpool() noexcept;
+
+      /* Called by input threads.  Queue a copy of the given message for
+         spooling and return true, or return false if there is no room in
+         the spool, in which case the caller should discard the message.
+         Never blocks on disk I/O. */
+      bool TryPut(TMsg::TRoutingType routing_type, int32_t partition_key,
+          TMsg::TTimestamp timestamp, const char *topic_begin,
+          const char *topic_end, const void *key_begin, size_t key_size,
+          const void *value_begin, size_t value_size);
+
+      /* Returns the combined size in bytes of all messages currently held by
+         the spool, including those not yet written to disk. */
+      size_t GetSpooledByteCount() const {
+        assert(this);
+        return SpooledBytes.load();
+      }
+
+      /* Returns the number of messages currently held by the spool, including
+         those not yet written to disk. */
+      size_t GetSpooledMsgCount() const {
+        assert(this);
+        return SpooledMsgs.load();
+      }
+
+      protected:
+      virtual void Run() override;
+
+      private:
+      /* Fixed-size part of a spooled message.  Since segment files never
+         outlive the process, fields are stored in host byte order. */
+      struct TRecordHeader {
+        int64_t Timestamp;
+
+        int32_t PartitionKey;
+
+        uint32_t TopicSize;
+
+        uint32_t KeySize;
+
+        uint32_t ValueSize;
+
+        uint8_t RoutingType;
+      };  // TRecordHeader
+
+      /* Milliseconds to wait before retrying replay after it was blocked by
+         the buffer space cap. */
+      static const int REPLAY_RETRY_INTERVAL = 50;
+
+      /* Maximum number of messages replayed before checking for handed off
+         messages and shutdown requests. */
+      static const size_t REPLAY_BATCH_SIZE = 1024;
+
+      void DoRun();
+
+      /* Write all handed off messages to 'Log'. */
+      void WriteHandoffMsgs();
+
+      /* Returns true if 'Log' still contains messages that could be replayed
+         immediately. */
+      bool Replay();
+
+      /* Create a message from the spooled record at 'rec'.  Throws
+         TMemoryCapReached if there is not enough buffer space. */
+      TMsg::TPtr CreateMsg(const uint8_t *rec);
+
+      void DiscardRecord(const uint8_t *rec);
+
+      /* Discard everything still held by the spool. */
+      void DiscardAll();
+
+      const size_t MaxSize;
+
+      const size_t MaxHandoffSize;
+
+      const bool NoLogDiscard;
+
+      Capped::TPool &Pool;
+
+      TMsgStateTracker &MsgStateTracker;
+
+      TAnomalyTracker &AnomalyTracker;
+
+      Thread::TGatePutApi<TMsg::TPtr> &OutputQueue;
+
+      /* Only accessed by the spool thread. */
+      TSegmentLog Log;
+
+      /* Protects 'HandoffList' and 'HandoffSize'. */
+      std::mutex HandoffMutex;
+
+      /* Messages handed off by input threads, waiting to be written to disk.
+         Each item has the same format as a record in 'Log'. */
+      std::list<std::vector<uint8_t>> HandoffList;
+
+      size_t HandoffSize;
+
+      /* Pushed when 'HandoffList' becomes nonempty. */
+      Base::TEventSemaphore HandoffSem;
+
+      std::atomic<size_t> SpooledBytes;
+
+      std::atomic<size_t> SpooledMsgs;
+    };  // TOverflowSpool
+
+  }  // Spool
+
+}  // Dory
@@ -0,0 +1,319 @@
+/* <dory/spool/overflow_spool.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/spool/overflow_spool.h>.
+ */
+
+#include <dory/spool/overflow_spool.h>
+
+#include <cstring>
+#include <list>
+#include <string>
+
+#include <base/time_util.h>
+#include <base/tmp_dir.h>
+#include <capped/memory_cap_reached.h>
+#include <dory/anomaly_tracker.h>
+#include <dory/discard_file_logger.h>
+#include <dory/input_dg/input_dg_common.h>
+#include <dory/msg_creator.h>
+#include <dory/msg_state_tracker.h>
+#include <dory/test_util/misc_util.h>
+#include <thread/gate.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Capped;
+using namespace Dory;
+using namespace Dory::InputDg;
+using namespace Dory::Spool;
+using namespace Dory::TestUtil;
+using namespace Thread;
+
+namespace {
+
+  /* The fixture for testing class TOverflowSpool. */
+  class TOverflowSpoolTest : public ::testing::Test {
+    protected:
+    TOverflowSpoolTest() {
+    }
+
+    virtual ~TOverflowSpoolTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TOverflowSpoolTest
+
+  bool PutMsg(TOverflowSpool &spool, const std::string &topic,
+      const std::string &value) {
+    return spool.TryPut(TMsg::TRoutingType::AnyPartition, 0, 0,
+        topic.data(), topic.data() + topic.size(), "", 0, value.data(),
+        value.size());
+  }
+
+  /* Wait until 'count' messages have arrived in 'gate'. */
+  std::list<TMsg::TPtr> GetMsgs(TGate<TMsg::TPtr> &gate, size_t count) {
+    std::list<TMsg::TPtr> result;
+
+    while (result.size() < count) {
+      result.splice(result.end(), gate.Get());
+    }
+
+    return std::move(result);
+  }
+
+  /* The spool updates its counts just after passing on a replayed message, so
+     wait a bit for them to reach 0. */
+  void WaitForEmptySpool(const TOverflowSpool &spool) {
+    for (size_t i = 0; (i < 1000) && spool.GetSpooledMsgCount(); ++i) {
+      SleepMilliseconds(1);
+    }
+  }
+
+  TEST_F(TOverflowSpoolTest, ReplayWhenMemoryFrees) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TPool pool(64, 4, TPool::TSync::Mutexed);
+    TMsgStateTracker msg_state_tracker;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TGate<TMsg::TPtr> gate;
+    TOverflowSpool spool(dir.GetName(), 64 * 1024, 4096, 4096, true, pool,
+        msg_state_tracker, anomaly_tracker, gate);
+
+    /* Fill up the pool. */
+    std::string big(3 * 64, 'x');
+    std::string topic("filler");
+    const char *topic_end = topic.data() + topic.size();
+    TMsg::TPtr filler = TMsgCreator::CreateAnyPartitionMsg(0, topic.data(),
+        topic_end, "", 0, big.data(), big.size(), false, pool,
+        msg_state_tracker);
+    ASSERT_THROW(TMsgCreator::CreateAnyPartitionMsg(0, topic.data(),
+        topic_end, "", 0, big.data(), big.size(), false, pool,
+        msg_state_tracker), TMemoryCapReached);
+
+    ASSERT_TRUE(PutMsg(spool, "topic1", "value1"));
+    ASSERT_TRUE(PutMsg(spool, "topic2", "value2"));
+    ASSERT_TRUE(PutMsg(spool, "topic3", "value3"));
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 3U);
+    spool.Start();
+
+    /* Nothing can be replayed until memory frees up. */
+    ASSERT_FALSE(gate.GetMsgAvailableFd().IsReadable(200));
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 3U);
+    SetProcessed(filler);
+    filler.reset();
+    std::list<TMsg::TPtr> msgs = GetMsgs(gate, 3);
+    ASSERT_EQ(msgs.size(), 3U);
+    size_t i = 1;
+
+    for (TMsg::TPtr &msg : msgs) {
+      ASSERT_EQ(msg->GetTopic(), "topic" + std::to_string(i));
+      ASSERT_TRUE(ValueEquals(msg, "value" + std::to_string(i)));
+      SetProcessed(msg);
+      ++i;
+    }
+
+    WaitForEmptySpool(spool);
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 0U);
+    ASSERT_EQ(spool.GetSpooledByteCount(), 0U);
+    spool.RequestShutdown();
+    spool.Join();
+  }
+
+  TEST_F(TOverflowSpoolTest, InOrderWithNewInput) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TPool pool(64, 256, TPool::TSync::Mutexed);
+    TMsgStateTracker msg_state_tracker;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TGate<TMsg::TPtr> gate;
+    TOverflowSpool spool(dir.GetName(), 64 * 1024, 4096, 4096, true, pool,
+        msg_state_tracker, anomaly_tracker, gate);
+    spool.Start();
+    std::string topic("topic");
+    const char *topic_end = topic.data() + topic.size();
+
+    /* Fill up the pool. */
+    std::list<TMsg::TPtr> fillers;
+
+    for (; ; ) {
+      try {
+        fillers.push_back(TMsgCreator::CreateAnyPartitionMsg(0,
+            topic.data(), topic_end, "", 0, "x", 1, false, pool,
+            msg_state_tracker));
+      } catch (const TMemoryCapReached &) {
+        break;
+      }
+    }
+
+    /* Act like an input thread, which passes the messages it creates to the
+       router thread.  The first messages get spooled. */
+    const size_t num_msgs = 100;
+    const size_t num_spooled = 10;
+
+    for (size_t i = 0; i < num_msgs; ++i) {
+      if (i == num_spooled) {
+        /* Free up memory while the spool still holds messages.  New messages
+           must not get ahead of them. */
+        for (TMsg::TPtr &msg : fillers) {
+          SetProcessed(msg);
+        }
+
+        fillers.clear();
+      }
+
+      std::string value = std::to_string(i);
+      TMsg::TPtr msg = TryCreateAnyPartitionMsg(0, topic.data(), topic_end,
+          "", 0, value.data(), value.size(), pool, anomaly_tracker,
+          msg_state_tracker, &spool, nullptr, true);
+
+      if (msg) {
+        ASSERT_GE(i, num_spooled);
+        gate.Put(std::move(msg));
+      }
+    }
+
+    std::list<TMsg::TPtr> msgs = GetMsgs(gate, num_msgs);
+    ASSERT_EQ(msgs.size(), num_msgs);
+    size_t i = 0;
+
+    for (TMsg::TPtr &msg : msgs) {
+      ASSERT_TRUE(ValueEquals(msg, std::to_string(i)));
+      SetProcessed(msg);
+      ++i;
+    }
+
+    WaitForEmptySpool(spool);
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 0U);
+    spool.RequestShutdown();
+    spool.Join();
+  }
+
+  TEST_F(TOverflowSpoolTest, NoOvertakeWhenFull) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TPool pool(64, 256, TPool::TSync::Mutexed);
+    TMsgStateTracker msg_state_tracker;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TGate<TMsg::TPtr> gate;
+    TOverflowSpool spool(dir.GetName(), 64 * 1024, 4096, 256, true, pool,
+        msg_state_tracker, anomaly_tracker, gate);
+    std::string topic("topic");
+    const char *topic_end = topic.data() + topic.size();
+    std::string value(100, 'x');
+
+    /* Fill up the pool. */
+    std::list<TMsg::TPtr> fillers;
+
+    for (; ; ) {
+      try {
+        fillers.push_back(TMsgCreator::CreateAnyPartitionMsg(0,
+            topic.data(), topic_end, "", 0, "x", 1, false, pool,
+            msg_state_tracker));
+      } catch (const TMemoryCapReached &) {
+        break;
+      }
+    }
+
+    /* The first message gets spooled.  Since the spool thread isn't
+       running, the handoff queue then stays full. */
+    ASSERT_FALSE(TryCreateAnyPartitionMsg(0, topic.data(), topic_end, "", 0,
+        value.data(), value.size(), pool, anomaly_tracker, msg_state_tracker,
+        &spool, nullptr, true));
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 1U);
+
+    for (TMsg::TPtr &msg : fillers) {
+      SetProcessed(msg);
+    }
+
+    fillers.clear();
+
+    /* There is buffer space now, but the message would get ahead of the
+       spooled one, so it is discarded. */
+    ASSERT_FALSE(TryCreateAnyPartitionMsg(0, topic.data(), topic_end, "", 0,
+        value.data(), value.size(), pool, anomaly_tracker, msg_state_tracker,
+        &spool, nullptr, true));
+    ASSERT_FALSE(TryCreatePartitionKeyMsg(0, 0, topic.data(), topic_end, "",
+        0, value.data(), value.size(), pool, anomaly_tracker,
+        msg_state_tracker, &spool, nullptr, true));
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 1U);
+    TAnomalyTracker::TInfo info;
+    anomaly_tracker.GetInfo(info);
+    ASSERT_EQ(info.DiscardTopicMap.size(), 1U);
+    ASSERT_EQ(info.DiscardTopicMap.begin()->second.Count, 2U);
+
+    /* Once the spooled message is replayed, new messages are created
+       directly again. */
+    spool.Start();
+    std::list<TMsg::TPtr> msgs = GetMsgs(gate, 1);
+    ASSERT_EQ(msgs.size(), 1U);
+    SetProcessed(msgs.front());
+    WaitForEmptySpool(spool);
+    TMsg::TPtr msg = TryCreateAnyPartitionMsg(0, topic.data(), topic_end, "",
+        0, value.data(), value.size(), pool, anomaly_tracker,
+        msg_state_tracker, &spool, nullptr, true);
+    ASSERT_TRUE(!!msg);
+    SetProcessed(msg);
+    spool.RequestShutdown();
+    spool.Join();
+  }
+
+  TEST_F(TOverflowSpoolTest, LimitsAndShutdownDiscard) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TPool pool(64, 1, TPool::TSync::Mutexed);
+    TMsgStateTracker msg_state_tracker;
+    TDiscardFileLogger discard_file_logger;
+    TAnomalyTracker anomaly_tracker(discard_file_logger, 0, 256);
+    TGate<TMsg::TPtr> gate;
+    TOverflowSpool spool(dir.GetName(), 1024, 1024, 256, true, pool,
+        msg_state_tracker, anomaly_tracker, gate);
+
+    /* Exceeds handoff limit. */
+    ASSERT_FALSE(PutMsg(spool, "topic", std::string(300, 'x')));
+
+    ASSERT_TRUE(PutMsg(spool, "topic", std::string(100, 'x')));
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 1U);
+
+    /* Handoff queue is full since spool thread isn't running. */
+    ASSERT_FALSE(PutMsg(spool, "topic", std::string(100, 'x')));
+
+    spool.Start();
+    spool.RequestShutdown();
+    spool.Join();
+
+    /* The message is still too large for the pool, so it gets discarded on
+       shutdown. */
+    ASSERT_TRUE(gate.NonblockingGet().empty());
+    ASSERT_EQ(spool.GetSpooledMsgCount(), 0U);
+    TAnomalyTracker::TInfo info;
+    anomaly_tracker.GetInfo(info);
+    ASSERT_EQ(info.DiscardTopicMap.size(), 1U);
+    ASSERT_EQ(info.DiscardTopicMap.begin()->second.Count, 1U);
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
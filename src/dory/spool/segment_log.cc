@@ -0,0 +1,179 @@
+/* <dory/spool/segment_log.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/spool/segment_log.h>.
+ */
+
+#include <dory/spool/segment_log.h>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <base/error_utils.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Spool;
+
+TSegmentLog::TSegmentLog(const char *dir, size_t segment_size,
+    size_t max_segment_count)
+    : Dir(dir),
+      SegmentSize(segment_size),
+      MaxSegmentCount(max_segment_count),
+      RecordCount(0),
+      ByteCount(0) {
+  assert(SegmentSize > RECORD_HEADER_SIZE);
+}
+
+TSegmentLog::~TSegmentLog() noexcept {
+  for (TSegment &segment : Segments) {
+    ReleaseSegment(segment);
+  }
+
+  for (TSegment &segment : Spare) {
+    ReleaseSegment(segment);
+  }
+}
+
+bool TSegmentLog::Append(const void *data, size_t size) {
+  assert(this);
+  assert(data || (size == 0));
+
+  if ((size > GetMaxRecordSize()) ||
+      (size > std::numeric_limits<uint32_t>::max())) {
+    return false;
+  }
+
+  size_t total_size = RECORD_HEADER_SIZE + size;
+
+  if (Segments.empty() ||
+      ((SegmentSize - Segments.back().WriteOffset) < total_size)) {
+    if (Spare.empty() &&
+        ((Segments.size() + Spare.size()) >= MaxSegmentCount)) {
+      return false;
+    }
+
+    AddSegment();
+  }
+
+  TSegment &segment = Segments.back();
+  uint8_t *pos = segment.Data + segment.WriteOffset;
+  uint32_t record_size = static_cast<uint32_t>(size);
+  std::memcpy(pos, &record_size, RECORD_HEADER_SIZE);
+  std::memcpy(pos + RECORD_HEADER_SIZE, data, size);
+  segment.WriteOffset += total_size;
+  ++RecordCount;
+  ByteCount += size;
+  return true;
+}
+
+const uint8_t *TSegmentLog::Front(size_t &size) const {
+  assert(this);
+  assert(!IsEmpty());
+  const TSegment &segment = Segments.front();
+  assert(segment.ReadOffset < segment.WriteOffset);
+  const uint8_t *pos = segment.Data + segment.ReadOffset;
+  uint32_t record_size = 0;
+  std::memcpy(&record_size, pos, RECORD_HEADER_SIZE);
+  size = record_size;
+  return pos + RECORD_HEADER_SIZE;
+}
+
+void TSegmentLog::PopFront() {
+  assert(this);
+  assert(!IsEmpty());
+  size_t size = 0;
+  Front(size);
+  TSegment &segment = Segments.front();
+  segment.ReadOffset += RECORD_HEADER_SIZE + size;
+  assert(segment.ReadOffset <= segment.WriteOffset);
+  --RecordCount;
+  ByteCount -= size;
+
+  if (segment.ReadOffset == segment.WriteOffset) {
+    /* Segment is fully consumed.  Recycle it if we don't already have a
+       spare, and otherwise give its disk space back. */
+    segment.ReadOffset = 0;
+    segment.WriteOffset = 0;
+
+    if (Spare.empty()) {
+      Spare.splice(Spare.end(), Segments, Segments.begin());
+    } else {
+      ReleaseSegment(segment);
+      Segments.pop_front();
+    }
+  }
+}
+
+void TSegmentLog::AddSegment() {
+  assert(this);
+
+  if (!Spare.empty()) {
+    Segments.splice(Segments.end(), Spare, Spare.begin());
+    return;
+  }
+
+  std::string name_template(Dir);
+  name_template += "/dory_spool.XXXXXX";
+  std::vector<char> name(name_template.begin(), name_template.end());
+  name.push_back('\0');
+  TSegment segment;
+  segment.Fd = IfLt0(mkstemp(&name[0]));
+
+  /* Nobody else needs to see the file, and we don't want it to outlive us.
+   */
+  IfLt0(unlink(&name[0]));
+
+  /* Reserve the disk space up front.  With a sparse file, running out of
+     disk space while writing to the mapping would cause SIGBUS. */
+  int err = posix_fallocate(segment.Fd, 0, static_cast<off_t>(SegmentSize));
+
+  if (err) {
+    throw std::system_error(err, std::system_category());
+  }
+
+  void *addr = mmap(nullptr, SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+      segment.Fd, 0);
+
+  if (addr == MAP_FAILED) {
+    IfLt0(-1);  // this will throw
+  }
+
+  /* Records are written and consumed in order. */
+  madvise(addr, SegmentSize, MADV_SEQUENTIAL);
+  segment.Data = reinterpret_cast<uint8_t *>(addr);
+  Segments.push_back(std::move(segment));
+}
+
+void TSegmentLog::ReleaseSegment(TSegment &segment) noexcept {
+  assert(this);
+
+  if (segment.Data) {
+    munmap(segment.Data, SegmentSize);
+    segment.Data = nullptr;
+  }
+
+  segment.Fd.Reset();
+}
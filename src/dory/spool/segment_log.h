@@ -0,0 +1,147 @@
+/* <dory/spool/segment_log.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Append-only FIFO log of variable-length records, stored in fixed-size
+   memory-mapped segment files.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+
+#include <base/fd.h>
+#include <base/no_copy_semantics.h>
+
+namespace Dory {
+
+  namespace Spool {
+
+    /* A FIFO queue of records backed by a directory on local disk.  Storage
+       is divided into segments of 'segment_size' bytes, each of which is a
+       file that is memory-mapped while in use.  Segment files are unlinked
+       immediately after creation, so nothing is left behind if dory
+       terminates unexpectedly.  At most 'max_segment_count' segments exist at
+       any time, which bounds the disk space used.  Not thread-safe: a single
+       thread is expected to do all appending and consuming. */
+    class TSegmentLog final {
+      NO_COPY_SEMANTICS(TSegmentLog);
+
+      public:
+      /* Each record is preceded by a header of this many bytes. */
+      static const size_t RECORD_HEADER_SIZE = 4;
+
+      TSegmentLog(const char *dir, size_t segment_size,
+          size_t max_segment_count);
+
+      ~TSegmentLog() noexcept;
+
+      /* Returns the largest record that Append() can ever accept. */
+      size_t GetMaxRecordSize() const {
+        assert(this);
+        return SegmentSize - RECORD_HEADER_SIZE;
+      }
+
+      /* Append a copy of the 'size' bytes at 'data' to the back of the log.
+         Returns false if the log lacks space for the record.  Throws
+         std::system_error if creating a new segment file fails. */
+      bool Append(const void *data, size_t size);
+
+      bool IsEmpty() const {
+        assert(this);
+        return (RecordCount == 0);
+      }
+
+      /* Returns a pointer to the oldest record in the log and sets 'size' to
+         its size in bytes.  The pointer remains valid until the next call to
+         PopFront().  Must not be called when the log is empty. */
+      const uint8_t *Front(size_t &size) const;
+
+      /* Remove the oldest record from the log.  Must not be called when the
+         log is empty. */
+      void PopFront();
+
+      /* Returns the number of records in the log. */
+      size_t GetRecordCount() const {
+        assert(this);
+        return RecordCount;
+      }
+
+      /* Returns the combined size in bytes of all records in the log,
+         excluding header overhead. */
+      size_t GetByteCount() const {
+        assert(this);
+        return ByteCount;
+      }
+
+      /* Returns the number of segment files currently in use. */
+      size_t GetSegmentCount() const {
+        assert(this);
+        return Segments.size();
+      }
+
+      private:
+      struct TSegment {
+        Base::TFd Fd;
+
+        uint8_t *Data;
+
+        /* Offset of first byte past the last record written. */
+        size_t WriteOffset;
+
+        /* Offset of the oldest unconsumed record. */
+        size_t ReadOffset;
+
+        TSegment()
+            : Data(nullptr),
+              WriteOffset(0),
+              ReadOffset(0) {
+        }
+      };  // TSegment
+
+      /* Create, map, and append to 'Segments' a new segment.  If a recycled
+         segment is available, it is reused instead. */
+      void AddSegment();
+
+      void ReleaseSegment(TSegment &segment) noexcept;
+
+      const std::string Dir;
+
+      const size_t SegmentSize;
+
+      const size_t MaxSegmentCount;
+
+      /* Front is the oldest segment, from which records are consumed.  Back is
+         the segment being appended to. */
+      std::list<TSegment> Segments;
+
+      /* A fully consumed segment kept around so steady spooling doesn't have
+         to create and map a new file every time a segment fills up. */
+      std::list<TSegment> Spare;
+
+      size_t RecordCount;
+
+      size_t ByteCount;
+    };  // TSegmentLog
+
+  }  // Spool
+
+}  // Dory
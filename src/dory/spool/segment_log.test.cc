@@ -0,0 +1,130 @@
+/* <dory/spool/segment_log.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/spool/segment_log.h>.
+ */
+
+#include <dory/spool/segment_log.h>
+
+#include <cstddef>
+#include <string>
+
+#include <base/tmp_dir.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Spool;
+
+namespace {
+
+  /* The fixture for testing class TSegmentLog. */
+  class TSegmentLogTest : public ::testing::Test {
+    protected:
+    TSegmentLogTest() {
+    }
+
+    virtual ~TSegmentLogTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TSegmentLogTest
+
+  std::string PopString(TSegmentLog &log) {
+    size_t size = 0;
+    const uint8_t *rec = log.Front(size);
+    std::string result(reinterpret_cast<const char *>(rec), size);
+    log.PopFront();
+    return result;
+  }
+
+  TEST_F(TSegmentLogTest, FifoOrder) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TSegmentLog log(dir.GetName(), 64, 4);
+    ASSERT_TRUE(log.IsEmpty());
+    ASSERT_EQ(log.GetMaxRecordSize(), 64U - TSegmentLog::RECORD_HEADER_SIZE);
+
+    for (size_t i = 0; i < 10; ++i) {
+      std::string s = "msg " + std::to_string(i);
+      ASSERT_TRUE(log.Append(s.data(), s.size()));
+    }
+
+    ASSERT_EQ(log.GetRecordCount(), 10U);
+    ASSERT_GT(log.GetSegmentCount(), 1U);
+
+    for (size_t i = 0; i < 10; ++i) {
+      ASSERT_EQ(PopString(log), "msg " + std::to_string(i));
+    }
+
+    ASSERT_TRUE(log.IsEmpty());
+    ASSERT_EQ(log.GetByteCount(), 0U);
+    ASSERT_EQ(log.GetSegmentCount(), 0U);
+  }
+
+  TEST_F(TSegmentLogTest, SizeCap) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TSegmentLog log(dir.GetName(), 64, 2);
+    std::string big(61, 'x');
+    ASSERT_FALSE(log.Append(big.data(), big.size()));
+    std::string s(28, 'a');
+
+    /* Each segment holds two records of size 28 plus headers. */
+    ASSERT_TRUE(log.Append(s.data(), s.size()));
+    ASSERT_TRUE(log.Append(s.data(), s.size()));
+    ASSERT_TRUE(log.Append(s.data(), s.size()));
+    ASSERT_TRUE(log.Append(s.data(), s.size()));
+    ASSERT_FALSE(log.Append(s.data(), s.size()));
+    ASSERT_EQ(log.GetRecordCount(), 4U);
+    ASSERT_EQ(log.GetByteCount(), 4U * 28U);
+
+    /* Consuming a whole segment makes room for more records. */
+    PopString(log);
+    ASSERT_FALSE(log.Append(s.data(), s.size()));
+    PopString(log);
+    ASSERT_TRUE(log.Append(s.data(), s.size()));
+    ASSERT_TRUE(log.Append(s.data(), s.size()));
+    ASSERT_FALSE(log.Append(s.data(), s.size()));
+    ASSERT_EQ(log.GetRecordCount(), 4U);
+
+    while (!log.IsEmpty()) {
+      ASSERT_EQ(PopString(log), s);
+    }
+  }
+
+  TEST_F(TSegmentLogTest, EmptyRecord) {
+    TTmpDir dir("/tmp/dory_spool_test.XXXXXX", true);
+    TSegmentLog log(dir.GetName(), 64, 1);
+    ASSERT_TRUE(log.Append(nullptr, 0));
+    ASSERT_TRUE(log.Append("abc", 3));
+    ASSERT_EQ(log.GetRecordCount(), 2U);
+    ASSERT_EQ(PopString(log), "");
+    ASSERT_EQ(PopString(log), "abc");
+    ASSERT_TRUE(log.IsEmpty());
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
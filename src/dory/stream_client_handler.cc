@@ -32,20 +32,24 @@
 using namespace Base;
 using namespace Capped;
 using namespace Dory;
+using namespace Dory::Spool;
 using namespace Dory::Util;
 using namespace Thread;
 
 TStreamClientHandler::TStreamClientHandler(bool is_tcp, const TConfig &config,
     TPool &pool, TMsgStateTracker &msg_state_tracker,
     TAnomalyTracker &anomaly_tracker, TGatePutApi<TMsg::TPtr> &output_queue,
-    TWorkerPool &worker_pool) noexcept
+    TWorkerPool &worker_pool, TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota) noexcept
     : IsTcp(is_tcp),
       Config(config),
       Pool(pool),
       MsgStateTracker(msg_state_tracker),
       AnomalyTracker(anomaly_tracker),
       OutputQueue(output_queue),
-      WorkerPool(worker_pool) {
+      WorkerPool(worker_pool),
+      OverflowSpool(overflow_spool),
+      TopicQuota(topic_quota) {
 }
 
 void TStreamClientHandler::HandleConnection(Base::TFd &&sock,
@@ -53,8 +57,8 @@ void TStreamClientHandler::HandleConnection(Base::TFd &&sock,
   assert(this);
   TWorkerPool::TReadyWorker worker = WorkerPool.GetReadyWorker();
   worker.GetWorkFn().SetState(IsTcp, Config, Pool, MsgStateTracker,
-      AnomalyTracker, OutputQueue, WorkerPool.GetShutdownRequestFd(),
-      std::move(sock));
+      AnomalyTracker, OutputQueue, OverflowSpool, TopicQuota,
+      WorkerPool.GetShutdownRequestFd(), std::move(sock));
   worker.Launch();
 }
 
@@ -40,7 +40,9 @@ namespace Dory {
         Capped::TPool &pool, TMsgStateTracker &msg_state_tracker,
         TAnomalyTracker &anomaly_tracker,
         Thread::TGatePutApi<TMsg::TPtr> &output_queue,
-        TWorkerPool &worker_pool) noexcept;
+        TWorkerPool &worker_pool,
+        Spool::TOverflowSpool *overflow_spool = nullptr,
+        TTopicQuota *topic_quota = nullptr) noexcept;
 
     virtual void HandleConnection(Base::TFd &&sock,
         const struct sockaddr *addr, socklen_t addr_len) override;
@@ -69,6 +71,14 @@ namespace Dory {
     /* We allocate workers from this thread pool to handle client
        connections. */
     TWorkerPool &WorkerPool;
+
+    /* If not null, messages that don't fit in 'Pool' are handed to the spool
+       rather than discarded. */
+    Spool::TOverflowSpool * const OverflowSpool;
+
+    /* If not null, messages are charged against their topics' buffer quotas.
+     */
+    TTopicQuota * const TopicQuota;
   };  // TStreamClientHandler
 
 }  // Dory
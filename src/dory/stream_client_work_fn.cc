@@ -22,6 +22,7 @@
 #include <dory/stream_client_work_fn.h>
 
 #include <cassert>
+#include <list>
 #include <system_error>
 #include <utility>
 
@@ -40,6 +41,7 @@
 using namespace Base;
 using namespace Capped;
 using namespace Dory;
+using namespace Dory::Spool;
 using namespace Dory::Util;
 using namespace Thread;
 
@@ -69,6 +71,8 @@ TStreamClientWorkFn::TStreamClientWorkFn(nullptr_t) noexcept
       MsgStateTracker(nullptr),
       AnomalyTracker(nullptr),
       OutputQueue(nullptr),
+      OverflowSpool(nullptr),
+      TopicQuota(nullptr),
       ShutdownRequestFd(nullptr),
       /* The value of 0 for the max message body size is just a placeholder.
          The real value will be set in SetState(). */
@@ -84,6 +88,8 @@ TStreamClientWorkFn &TStreamClientWorkFn::TStreamClientWorkFn::operator=(
   MsgStateTracker = nullptr;
   AnomalyTracker = nullptr;
   OutputQueue = nullptr;
+  OverflowSpool = nullptr;
+  TopicQuota = nullptr;
   ShutdownRequestFd = nullptr;
   ClientSocket.Reset();
   StreamReader.Reset();
@@ -133,6 +139,7 @@ void TStreamClientWorkFn::operator()() {
 void TStreamClientWorkFn::SetState(bool is_tcp, const TConfig &config,
     TPool &pool, TMsgStateTracker &msg_state_tracker,
     TAnomalyTracker &anomaly_tracker, TGatePutApi<TMsg::TPtr> &output_queue,
+    TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
     const TFd &shutdown_request_fd, TFd &&client_socket) noexcept {
   assert(this);
   IsTcp = is_tcp;
@@ -141,6 +148,8 @@ void TStreamClientWorkFn::SetState(bool is_tcp, const TConfig &config,
   MsgStateTracker = &msg_state_tracker;
   AnomalyTracker = &anomaly_tracker;
   OutputQueue = &output_queue;
+  OverflowSpool = overflow_spool;
+  TopicQuota = topic_quota;
   ShutdownRequestFd = &shutdown_request_fd;
   ClientSocket = std::move(client_socket);
   StreamReader.Reset(ClientSocket);
@@ -266,18 +275,19 @@ bool TStreamClientWorkFn::HandleSockReadReady() {
         break;
       }
       case TStreamMsgReader::TState::MsgReady: {
-        TMsg::TPtr msg = InputDg::BuildMsgFromDg(StreamReader.GetReadyMsg(),
+        std::list<TMsg::TPtr> msg_list;
+        InputDg::BuildMsgsFromDg(StreamReader.GetReadyMsg(),
             StreamReader.GetReadyMsgSize(), *Config, *Pool, *AnomalyTracker,
-            *MsgStateTracker);
-
-        if (msg) {
-          OutputQueue->Put(std::move(msg));
+            *MsgStateTracker, msg_list, OverflowSpool, TopicQuota);
 
+        if (!msg_list.empty()) {
           if (IsTcp) {
-            TcpInputForwardMsg.Increment();
+            TcpInputForwardMsg.Increment(msg_list.size());
           } else {
-            UnixStreamInputForwardMsg.Increment();
+            UnixStreamInputForwardMsg.Increment(msg_list.size());
           }
+
+          OutputQueue->Put(std::move(msg_list));
         }
 
         reader_state = StreamReader.ConsumeReadyMsg();
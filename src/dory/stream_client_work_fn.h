@@ -30,6 +30,8 @@
 #include <dory/anomaly_tracker.h>
 #include <dory/config.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
 #include <thread/gate_put_api.h>
 
 namespace Dory {
@@ -47,6 +49,7 @@ namespace Dory {
     void SetState(bool is_tcp, const TConfig &config, Capped::TPool &pool,
         TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
         Thread::TGatePutApi<TMsg::TPtr> &output_queue,
+        Spool::TOverflowSpool *overflow_spool, TTopicQuota *topic_quota,
         const Base::TFd &shutdown_request_fd,
         Base::TFd &&client_socket) noexcept;
 
@@ -75,6 +78,14 @@ namespace Dory {
     /* Messages are queued here for the router thread. */
     Thread::TGatePutApi<TMsg::TPtr> *OutputQueue;
 
+    /* If not null, messages that don't fit in 'Pool' are handed to the spool
+       rather than discarded. */
+    Spool::TOverflowSpool *OverflowSpool;
+
+    /* If not null, messages are charged against their topics' buffer quotas.
+     */
+    TTopicQuota *TopicQuota;
+
     /* Becomes readable when thread pool receives a shutdown request. */
     const Base::TFd *ShutdownRequestFd;
 
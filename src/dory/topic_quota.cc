@@ -0,0 +1,214 @@
+/* <dory/topic_quota.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <dory/topic_quota.h>.
+ */
+
+#include <dory/topic_quota.h>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <server/counter.h>
+
+using namespace Base;
+using namespace Dory;
+using namespace Dory::Conf;
+
+SERVER_COUNTER(TopicQuotaBurstCharge);
+SERVER_COUNTER(TopicQuotaLowPriorityReject);
+SERVER_COUNTER(TopicQuotaOverflowSlot);
+SERVER_COUNTER(TopicQuotaReject);
+
+static size_t HashTopic(const char *topic_begin, const char *topic_end) {
+  /* 64-bit FNV-1a.  Topics are short, and this avoids constructing a
+     std::string for each message. */
+  uint64_t h = 14695981039346656037ULL;
+
+  for (const char *p = topic_begin; p < topic_end; ++p) {
+    h ^= static_cast<unsigned char>(*p);
+    h *= 1099511628211ULL;
+  }
+
+  return static_cast<size_t>(h ^ (h >> 32));
+}
+
+TTopicQuota::TTopicQuota(const TTopicQuotaConf &conf,
+    const TTopicPriorityConf &priority_conf)
+    : Conf(conf),
+      PriorityConf(priority_conf),
+      BurstBytes(conf.GetBurstBytes()),
+      BurstUsed(0),
+      LowPriorityMaxBytes(priority_conf.GetLowPriorityMaxBytes().IsKnown() ?
+          *priority_conf.GetLowPriorityMaxBytes() :
+          std::numeric_limits<size_t>::max()),
+      LowPriorityUsed(0),
+      OverflowState(nullptr, nullptr,
+          ToMaxBytes(conf.GetDefaultTopicConfig()), false) {
+  for (auto &slot : Slots) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+TTopicQuota::~TTopicQuota() noexcept {
+  for (auto &slot : Slots) {
+    delete slot.load(std::memory_order_relaxed);
+  }
+}
+
+bool TTopicQuota::TryCharge(const char *topic_begin, const char *topic_end,
+    size_t size, TCharge &charge) {
+  assert(this);
+  assert(topic_begin);
+  assert(topic_end >= topic_begin);
+  TTopicState &state = GetTopicState(topic_begin, topic_end);
+  std::atomic<size_t> *low_priority_counter = nullptr;
+
+  if (!state.HighPriority &&
+      (LowPriorityMaxBytes != std::numeric_limits<size_t>::max())) {
+    size_t low_used =
+        LowPriorityUsed.fetch_add(size, std::memory_order_relaxed) + size;
+
+    if (low_used > LowPriorityMaxBytes) {
+      LowPriorityUsed.fetch_sub(size, std::memory_order_relaxed);
+      state.DiscardCount.fetch_add(1, std::memory_order_relaxed);
+      TopicQuotaLowPriorityReject.Increment();
+      return false;
+    }
+
+    low_priority_counter = &LowPriorityUsed;
+  }
+
+  size_t used = state.Used.fetch_add(size, std::memory_order_relaxed) + size;
+
+  if (used <= state.MaxBytes) {
+    charge = TCharge(state.Used, low_priority_counter, size);
+    return true;
+  }
+
+  state.Used.fetch_sub(size, std::memory_order_relaxed);
+
+  /* The topic is over its quota, so try to borrow from the burst region. */
+  used = BurstUsed.fetch_add(size, std::memory_order_relaxed) + size;
+
+  if (used <= BurstBytes) {
+    TopicQuotaBurstCharge.Increment();
+    charge = TCharge(BurstUsed, low_priority_counter, size);
+    return true;
+  }
+
+  BurstUsed.fetch_sub(size, std::memory_order_relaxed);
+
+  if (low_priority_counter) {
+    low_priority_counter->fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  state.DiscardCount.fetch_add(1, std::memory_order_relaxed);
+  TopicQuotaReject.Increment();
+  return false;
+}
+
+std::vector<TTopicQuota::TTopicStats> TTopicQuota::GetTopicStats() const {
+  assert(this);
+  std::vector<TTopicStats> result;
+
+  auto add = [&result](const TTopicState &state) {
+    result.push_back(TTopicStats());
+    TTopicStats &stats = result.back();
+    stats.Topic = state.Topic;
+
+    if (state.MaxBytes != std::numeric_limits<size_t>::max()) {
+      stats.MaxBytes.MakeKnown(state.MaxBytes);
+    }
+
+    stats.UsedBytes = state.Used.load(std::memory_order_relaxed);
+    stats.DiscardCount = state.DiscardCount.load(std::memory_order_relaxed);
+    stats.HighPriority = state.HighPriority;
+  };
+
+  for (const auto &slot : Slots) {
+    const TTopicState *state = slot.load(std::memory_order_acquire);
+
+    if (state) {
+      add(*state);
+    }
+  }
+
+  if (OverflowState.Used.load(std::memory_order_relaxed) ||
+      OverflowState.DiscardCount.load(std::memory_order_relaxed)) {
+    add(OverflowState);
+  }
+
+  return std::move(result);
+}
+
+size_t TTopicQuota::ToMaxBytes(const TTopicQuotaConf::TConf &conf) {
+  return conf.MaxBytes.IsKnown() ?
+      *conf.MaxBytes : std::numeric_limits<size_t>::max();
+}
+
+size_t TTopicQuota::LookupMaxBytes(const char *topic_begin,
+    const char *topic_end) const {
+  assert(this);
+  const TTopicQuotaConf::TTopicMap &topic_map = Conf.GetTopicConfigs();
+  auto iter = topic_map.find(std::string(topic_begin, topic_end));
+  return ToMaxBytes((iter == topic_map.end()) ?
+      Conf.GetDefaultTopicConfig() : iter->second);
+}
+
+TTopicQuota::TTopicState &TTopicQuota::GetTopicState(const char *topic_begin,
+    const char *topic_end) {
+  assert(this);
+  size_t topic_size = topic_end - topic_begin;
+  size_t index = HashTopic(topic_begin, topic_end);
+  TTopicState *new_state = nullptr;
+
+  for (size_t i = 0; i < MAX_PROBE_COUNT; ++i, ++index) {
+    std::atomic<TTopicState *> &slot = Slots[index % SLOT_COUNT];
+    TTopicState *state = slot.load(std::memory_order_acquire);
+
+    if (state == nullptr) {
+      /* First time we have seen this topic.  Try to claim the empty slot.  If
+         another thread claims it first, 'state' gets its value and we check
+         whether it is for our topic. */
+      if (new_state == nullptr) {
+        new_state = new TTopicState(topic_begin, topic_end,
+            LookupMaxBytes(topic_begin, topic_end),
+            PriorityConf.IsHighPriority(std::string(topic_begin, topic_end)));
+      }
+
+      if (slot.compare_exchange_strong(state, new_state,
+              std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return *new_state;
+      }
+    }
+
+    assert(state);
+
+    if ((state->Topic.size() == topic_size) &&
+        !std::memcmp(state->Topic.data(), topic_begin, topic_size)) {
+      delete new_state;
+      return *state;
+    }
+  }
+
+  delete new_state;
+  TopicQuotaOverflowSlot.Increment();
+  return OverflowState;
+}
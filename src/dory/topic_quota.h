@@ -0,0 +1,252 @@
+/* <dory/topic_quota.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Class for per-topic quotas on buffered message data.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <base/no_copy_semantics.h>
+#include <base/opt.h>
+#include <dory/conf/topic_priority_conf.h>
+#include <dory/conf/topic_quota_conf.h>
+
+namespace Dory {
+
+  /* This class limits the number of bytes of message data that each topic may
+     have buffered.  The buffer pool is a single budget shared by all topics,
+     so without quotas a single topic whose messages can't be delivered (for
+     instance, due to a slow broker) can fill the entire pool, after which
+     messages for all topics are discarded.  With quotas, a topic that has
+     used up its quota may borrow from a shared burst region.  Once that is
+     full too, only messages for topics over quota are discarded.
+
+     Messages are charged on the input path, which may consist of several
+     threads, so accounting uses atomic counters.  Topics are assigned slots in
+     a fixed size open addressing table the first time they are seen.  Slots
+     are never removed, so lookup is lock free.  If the table fills up (or a
+     probe sequence gets too long), remaining topics share a single overflow
+     slot that uses the default quota.
+
+     If the topic priority config limits the total bytes buffered for low
+     priority topics, messages for those topics are also charged against that
+     limit.  Once it is reached, low priority messages are discarded while the
+     remaining buffer space stays available to high priority topics. */
+  class TTopicQuota final {
+    NO_COPY_SEMANTICS(TTopicQuota);
+
+    public:
+    /* Represents bytes charged against a topic's quota or the burst region,
+       and possibly also against the low priority limit.  The bytes are
+       returned when the charge is destroyed, so a charge is stored in the
+       message it was obtained for. */
+    class TCharge final {
+      NO_COPY_SEMANTICS(TCharge);
+
+      public:
+      TCharge() noexcept
+          : Counter(nullptr),
+            LowPriorityCounter(nullptr),
+            Size(0) {
+      }
+
+      TCharge(TCharge &&that) noexcept
+          : Counter(that.Counter),
+            LowPriorityCounter(that.LowPriorityCounter),
+            Size(that.Size) {
+        that.Counter = nullptr;
+        that.LowPriorityCounter = nullptr;
+        that.Size = 0;
+      }
+
+      ~TCharge() noexcept {
+        Release();
+      }
+
+      TCharge &operator=(TCharge &&that) noexcept {
+        if (&that != this) {
+          Release();
+          Counter = that.Counter;
+          LowPriorityCounter = that.LowPriorityCounter;
+          Size = that.Size;
+          that.Counter = nullptr;
+          that.LowPriorityCounter = nullptr;
+          that.Size = 0;
+        }
+
+        return *this;
+      }
+
+      size_t GetSize() const noexcept {
+        return Size;
+      }
+
+      void Release() noexcept {
+        if (Counter) {
+          Counter->fetch_sub(Size, std::memory_order_relaxed);
+          Counter = nullptr;
+        }
+
+        if (LowPriorityCounter) {
+          LowPriorityCounter->fetch_sub(Size, std::memory_order_relaxed);
+          LowPriorityCounter = nullptr;
+        }
+
+        Size = 0;
+      }
+
+      private:
+      TCharge(std::atomic<size_t> &counter,
+          std::atomic<size_t> *low_priority_counter, size_t size) noexcept
+          : Counter(&counter),
+            LowPriorityCounter(low_priority_counter),
+            Size(size) {
+      }
+
+      std::atomic<size_t> *Counter;
+
+      /* Null unless the charge counts against the low priority limit. */
+      std::atomic<size_t> *LowPriorityCounter;
+
+      size_t Size;
+
+      friend class TTopicQuota;
+    };  // TCharge
+
+    /* Usage info for a single topic, for status reporting. */
+    struct TTopicStats {
+      /* Empty for the overflow slot shared by topics that didn't get their
+         own slots. */
+      std::string Topic;
+
+      /* Unknown if the topic has no quota. */
+      Base::TOpt<size_t> MaxBytes;
+
+      /* Bytes currently charged against the topic's quota.  Bytes borrowed
+         from the burst region are not included. */
+      size_t UsedBytes;
+
+      /* # of messages discarded due to the topic exceeding its quota, or the
+         low priority limit being reached. */
+      size_t DiscardCount;
+
+      bool HighPriority;
+    };  // TTopicStats
+
+    enum { SLOT_COUNT = 4096 };
+
+    enum { MAX_PROBE_COUNT = 32 };
+
+    explicit TTopicQuota(const Conf::TTopicQuotaConf &conf,
+        const Conf::TTopicPriorityConf &priority_conf =
+            Conf::TTopicPriorityConf());
+
+    ~TTopicQuota() noexcept;
+
+    /* Try to charge 'size' bytes for a message with the topic given by
+       'topic_begin' and 'topic_end'.  On success, return true and store the
+       charge in 'charge'.  Otherwise the topic is over its quota and the burst
+       region is full, or the topic is low priority and the low priority limit
+       has been reached.  In that case the message should be discarded. */
+    bool TryCharge(const char *topic_begin, const char *topic_end,
+        size_t size, TCharge &charge);
+
+    size_t GetBurstBytes() const noexcept {
+      assert(this);
+      return BurstBytes;
+    }
+
+    size_t GetBurstUsedBytes() const noexcept {
+      assert(this);
+      return BurstUsed.load(std::memory_order_relaxed);
+    }
+
+    /* Returns the limit on bytes buffered for all low priority topics
+       combined, or SIZE_MAX if there is no limit. */
+    size_t GetLowPriorityMaxBytes() const noexcept {
+      assert(this);
+      return LowPriorityMaxBytes;
+    }
+
+    size_t GetLowPriorityUsedBytes() const noexcept {
+      assert(this);
+      return LowPriorityUsed.load(std::memory_order_relaxed);
+    }
+
+    /* Return usage info for all topics seen so far. */
+    std::vector<TTopicStats> GetTopicStats() const;
+
+    private:
+    /* Accounting state for a single topic.  Once created, a state is never
+       destroyed until the TTopicQuota is destroyed. */
+    struct TTopicState {
+      const std::string Topic;
+
+      /* SIZE_MAX if the topic has no quota. */
+      const size_t MaxBytes;
+
+      std::atomic<size_t> Used;
+
+      std::atomic<size_t> DiscardCount;
+
+      const bool HighPriority;
+
+      TTopicState(const char *topic_begin, const char *topic_end,
+          size_t max_bytes, bool high_priority)
+          : Topic(topic_begin, topic_end),
+            MaxBytes(max_bytes),
+            Used(0),
+            DiscardCount(0),
+            HighPriority(high_priority) {
+      }
+    };  // TTopicState
+
+    static size_t ToMaxBytes(const Conf::TTopicQuotaConf::TConf &conf);
+
+    size_t LookupMaxBytes(const char *topic_begin,
+        const char *topic_end) const;
+
+    TTopicState &GetTopicState(const char *topic_begin,
+        const char *topic_end);
+
+    const Conf::TTopicQuotaConf Conf;
+
+    const Conf::TTopicPriorityConf PriorityConf;
+
+    const size_t BurstBytes;
+
+    std::atomic<size_t> BurstUsed;
+
+    /* SIZE_MAX if there is no limit on low priority topics. */
+    const size_t LowPriorityMaxBytes;
+
+    std::atomic<size_t> LowPriorityUsed;
+
+    /* Shared by topics that could not be given their own slots. */
+    TTopicState OverflowState;
+
+    std::atomic<TTopicState *> Slots[SLOT_COUNT];
+  };  // TTopicQuota
+
+}  // Dory
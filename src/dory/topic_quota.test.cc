@@ -0,0 +1,257 @@
+/* <dory/topic_quota.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <dory/topic_quota.h>
+ */
+
+#include <dory/topic_quota.h>
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dory/conf/topic_priority_conf.h>
+#include <dory/conf/topic_quota_conf.h>
+
+#include <gtest/gtest.h>
+
+using namespace Dory;
+using namespace Dory::Conf;
+
+namespace {
+
+  /* The fixture for testing class TTopicQuota. */
+  class TTopicQuotaTest : public ::testing::Test {
+    protected:
+    TTopicQuotaTest() {
+    }
+
+    virtual ~TTopicQuotaTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TTopicQuotaTest
+
+  bool Charge(TTopicQuota &quota, const char *topic, size_t size,
+      TTopicQuota::TCharge &charge) {
+    return quota.TryCharge(topic, topic + std::strlen(topic), size, charge);
+  }
+
+  size_t GetUsed(const TTopicQuota &quota, const std::string &topic) {
+    for (const auto &s : quota.GetTopicStats()) {
+      if (s.Topic == topic) {
+        return s.UsedBytes;
+      }
+    }
+
+    return 0;
+  }
+
+  TEST_F(TTopicQuotaTest, ConfTest) {
+    TTopicQuotaConf::TBuilder b;
+    b.AddUnlimitedNamedConfig("unlimited");
+    b.SetDefaultTopicConfig("unlimited");
+    TTopicQuotaConf conf = b.Build();
+    ASSERT_FALSE(conf.IsEnabled());
+    ASSERT_EQ(conf.GetBurstBytes(), 0U);
+
+    b.AddUnlimitedNamedConfig("unlimited");
+    b.AddBoundedNamedConfig("small", 100);
+    ASSERT_THROW(b.AddBoundedNamedConfig("small", 200),
+        TTopicQuotaConf::TBuilder::TDuplicateNamedConfig);
+    ASSERT_THROW(b.SetDefaultTopicConfig("blah"),
+        TTopicQuotaConf::TBuilder::TUnknownDefaultTopicConfig);
+    b.SetDefaultTopicConfig("unlimited");
+    ASSERT_THROW(b.SetDefaultTopicConfig("unlimited"),
+        TTopicQuotaConf::TBuilder::TDuplicateDefaultTopicConfig);
+    b.SetTopicConfig("t1", "small");
+    ASSERT_THROW(b.SetTopicConfig("t1", "small"),
+        TTopicQuotaConf::TBuilder::TDuplicateTopicConfig);
+    ASSERT_THROW(b.SetTopicConfig("t2", "blah"),
+        TTopicQuotaConf::TBuilder::TUnknownTopicConfig);
+    b.SetBurstBytes(50);
+    conf = b.Build();
+    ASSERT_TRUE(conf.IsEnabled());
+    ASSERT_EQ(conf.GetBurstBytes(), 50U);
+    ASSERT_EQ(conf.GetTopicConfigs().size(), 1U);
+    ASSERT_EQ(*conf.GetTopicConfigs().at("t1").MaxBytes, 100U);
+
+    ASSERT_THROW(b.Build(), TTopicQuotaConf::TBuilder::TMissingDefaultTopic);
+  }
+
+  TEST_F(TTopicQuotaTest, QuotaAndBurstTest) {
+    TTopicQuotaConf::TBuilder b;
+    b.AddBoundedNamedConfig("default", 100);
+    b.AddBoundedNamedConfig("big", 1000);
+    b.AddUnlimitedNamedConfig("unlimited");
+    b.SetDefaultTopicConfig("default");
+    b.SetTopicConfig("big_topic", "big");
+    b.SetTopicConfig("free_topic", "unlimited");
+    b.SetBurstBytes(50);
+    TTopicQuota quota(b.Build());
+
+    TTopicQuota::TCharge c1, c2, c3, c4, c5;
+    ASSERT_TRUE(Charge(quota, "t1", 60, c1));
+    ASSERT_TRUE(Charge(quota, "t1", 40, c2));
+    ASSERT_EQ(GetUsed(quota, "t1"), 100U);
+    ASSERT_EQ(quota.GetBurstUsedBytes(), 0U);
+
+    /* "t1" is at its quota, so this comes from the burst region. */
+    ASSERT_TRUE(Charge(quota, "t1", 30, c3));
+    ASSERT_EQ(GetUsed(quota, "t1"), 100U);
+    ASSERT_EQ(quota.GetBurstUsedBytes(), 30U);
+
+    /* Burst region doesn't have room. */
+    ASSERT_FALSE(Charge(quota, "t1", 30, c4));
+    ASSERT_EQ(c4.GetSize(), 0U);
+
+    /* Other topics are unaffected by "t1" being over quota. */
+    ASSERT_TRUE(Charge(quota, "t2", 100, c4));
+    ASSERT_TRUE(Charge(quota, "big_topic", 1000, c5));
+    ASSERT_FALSE(Charge(quota, "big_topic", 21, c5));
+    ASSERT_EQ(GetUsed(quota, "big_topic"), 1000U);
+
+    /* Releasing a charge makes room again. */
+    c1.Release();
+    ASSERT_EQ(GetUsed(quota, "t1"), 40U);
+    c3 = TTopicQuota::TCharge();
+    ASSERT_EQ(quota.GetBurstUsedBytes(), 0U);
+
+    {
+      TTopicQuota::TCharge tmp;
+      ASSERT_TRUE(Charge(quota, "t1", 60, tmp));
+      TTopicQuota::TCharge moved(std::move(tmp));
+      ASSERT_EQ(tmp.GetSize(), 0U);
+      ASSERT_EQ(moved.GetSize(), 60U);
+      ASSERT_EQ(GetUsed(quota, "t1"), 100U);
+    }
+
+    ASSERT_EQ(GetUsed(quota, "t1"), 40U);
+
+    /* Topics with no quota are never limited, but usage is still tracked. */
+    for (size_t i = 0; i < 10; ++i) {
+      TTopicQuota::TCharge c;
+      ASSERT_TRUE(Charge(quota, "free_topic", 1000000, c));
+    }
+
+    size_t discard_count = 0;
+
+    for (const auto &s : quota.GetTopicStats()) {
+      if (s.Topic == "free_topic") {
+        ASSERT_FALSE(s.MaxBytes.IsKnown());
+      } else {
+        ASSERT_TRUE(s.MaxBytes.IsKnown());
+      }
+
+      discard_count += s.DiscardCount;
+    }
+
+    ASSERT_EQ(discard_count, 2U);
+  }
+
+  TEST_F(TTopicQuotaTest, LowPriorityLimitTest) {
+    TTopicQuotaConf::TBuilder b;
+    b.AddUnlimitedNamedConfig("unlimited");
+    b.SetDefaultTopicConfig("unlimited");
+    TTopicPriorityConf::TBuilder pb;
+    pb.AddHighPriorityTopic("billing");
+    ASSERT_THROW(pb.AddHighPriorityTopic("billing"),
+        TTopicPriorityConf::TBuilder::TDuplicateTopic);
+    pb.SetLowPriorityMaxBytes(100);
+    TTopicQuota quota(b.Build(), pb.Build());
+    ASSERT_EQ(quota.GetLowPriorityMaxBytes(), 100U);
+
+    /* Low priority topics share the limit. */
+    TTopicQuota::TCharge c1, c2, c3, c4;
+    ASSERT_TRUE(Charge(quota, "bulk1", 60, c1));
+    ASSERT_TRUE(Charge(quota, "bulk2", 40, c2));
+    ASSERT_EQ(quota.GetLowPriorityUsedBytes(), 100U);
+    ASSERT_FALSE(Charge(quota, "bulk1", 1, c3));
+    ASSERT_EQ(GetUsed(quota, "bulk1"), 60U);
+
+    /* High priority topics are not affected by the limit. */
+    ASSERT_TRUE(Charge(quota, "billing", 1000, c3));
+    ASSERT_EQ(quota.GetLowPriorityUsedBytes(), 100U);
+
+    /* Releasing a low priority charge makes room again. */
+    c1.Release();
+    ASSERT_EQ(quota.GetLowPriorityUsedBytes(), 40U);
+    ASSERT_TRUE(Charge(quota, "bulk2", 60, c4));
+    ASSERT_EQ(GetUsed(quota, "bulk2"), 100U);
+    c4 = TTopicQuota::TCharge();
+    ASSERT_EQ(quota.GetLowPriorityUsedBytes(), 40U);
+    ASSERT_EQ(GetUsed(quota, "bulk2"), 40U);
+
+    for (const auto &s : quota.GetTopicStats()) {
+      ASSERT_EQ(s.HighPriority, (s.Topic == "billing"));
+      ASSERT_EQ(s.DiscardCount, (s.Topic == "bulk1") ? 1U : 0U);
+    }
+
+    /* A low priority limit requires at least one high priority topic. */
+    pb.SetLowPriorityMaxBytes(100);
+    ASSERT_THROW(pb.Build(),
+        TTopicPriorityConf::TBuilder::TMissingHighPriorityTopics);
+  }
+
+  TEST_F(TTopicQuotaTest, ManyTopicsTest) {
+    TTopicQuotaConf::TBuilder b;
+    b.AddBoundedNamedConfig("default", 10);
+    b.SetDefaultTopicConfig("default");
+    TTopicQuota quota(b.Build());
+    std::vector<TTopicQuota::TCharge> charges;
+    const size_t topic_count = 2 * TTopicQuota::SLOT_COUNT;
+
+    /* Once the table fills up, remaining topics share the overflow slot, so
+       not all of them can be charged. */
+    size_t success_count = 0;
+
+    for (size_t i = 0; i < topic_count; ++i) {
+      std::string topic("topic_");
+      topic += std::to_string(i);
+      TTopicQuota::TCharge c;
+
+      if (quota.TryCharge(topic.data(), topic.data() + topic.size(), 10, c)) {
+        ++success_count;
+        charges.push_back(std::move(c));
+      }
+    }
+
+    ASSERT_GT(success_count, size_t(TTopicQuota::SLOT_COUNT / 2));
+    ASSERT_LT(success_count, topic_count);
+
+    /* A topic seen before still finds its own slot. */
+    std::string topic("topic_0");
+    TTopicQuota::TCharge c;
+    ASSERT_FALSE(quota.TryCharge(topic.data(), topic.data() + topic.size(),
+        1, c));
+    charges.clear();
+    ASSERT_TRUE(quota.TryCharge(topic.data(), topic.data() + topic.size(), 10,
+        c));
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -24,7 +24,9 @@
 #include <algorithm>
 #include <array>
 #include <exception>
+#include <stdexcept>
 #include <system_error>
+#include <utility>
 
 #include <poll.h>
 #include <sys/socket.h>
@@ -43,6 +45,7 @@
 using namespace Base;
 using namespace Capped;
 using namespace Dory;
+using namespace Dory::Spool;
 using namespace Dory::Util;
 using namespace Socket;
 using namespace Thread;
@@ -51,15 +54,19 @@ SERVER_COUNTER(UnixDgInputAgentForwardMsg);
 
 TUnixDgInputAgent::TUnixDgInputAgent(const TConfig &config, TPool &pool,
     TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
-    TGatePutApi<TMsg::TPtr> &output_queue)
+    TGatePutApi<TMsg::TPtr> &output_queue, TOverflowSpool *overflow_spool,
+    TTopicQuota *topic_quota)
     : Config(config),
       Destroying(false),
       Pool(pool),
       MsgStateTracker(msg_state_tracker),
       AnomalyTracker(anomaly_tracker),
       InputSocket(SOCK_DGRAM, 0),
+      UnlinkOnClose(true),
       InputBuf(config.MaxInputMsgSize),
       OutputQueue(output_queue),
+      OverflowSpool(overflow_spool),
+      TopicQuota(topic_quota),
       SyncStartSuccess(false),
       SyncStartNotify(nullptr) {
 }
@@ -70,6 +77,21 @@ TUnixDgInputAgent::~TUnixDgInputAgent() noexcept {
      gets the shutdown request. */
   Destroying = true;
   ShutdownOnDestroy();
+
+  if (!UnlinkOnClose.load()) {
+    InputSocket.Release();
+  }
+}
+
+void TUnixDgInputAgent::AdoptSocket(TFd &&sock) {
+  assert(this);
+
+  if (IsStarted()) {
+    throw std::logic_error("Cannot call AdoptSocket() when UNIX datagram "
+        "input agent is already started");
+  }
+
+  AdoptedSocket = std::move(sock);
 }
 
 bool TUnixDgInputAgent::SyncStart() {
@@ -122,6 +144,13 @@ void TUnixDgInputAgent::Run() {
 
 void TUnixDgInputAgent::OpenUnixSocket() {
   assert(this);
+
+  if (AdoptedSocket.IsOpen()) {
+    syslog(LOG_NOTICE, "UNIX datagram input thread using inherited socket");
+    InputSocket.Adopt(std::move(AdoptedSocket), Config.ReceiveSocketName);
+    return;
+  }
+
   syslog(LOG_NOTICE, "UNIX datagram input thread opening socket");
   TAddress input_socket_address;
   input_socket_address.SetFamily(AF_LOCAL);
@@ -149,12 +178,12 @@ void TUnixDgInputAgent::OpenUnixSocket() {
   }
 }
 
-TMsg::TPtr TUnixDgInputAgent::ReadOneMsg() {
+void TUnixDgInputAgent::ReadMsgs(std::list<TMsg::TPtr> &msg_list) {
   assert(this);
   char * const msg_begin = reinterpret_cast<char *>(&InputBuf[0]);
   ssize_t result = IfLt0(recv(InputSocket, msg_begin, InputBuf.size(), 0));
-  return InputDg::BuildMsgFromDg(msg_begin, result, Config, Pool,
-      AnomalyTracker, MsgStateTracker);
+  InputDg::BuildMsgsFromDg(msg_begin, result, Config, Pool, AnomalyTracker,
+      MsgStateTracker, msg_list, OverflowSpool, TopicQuota);
 }
 
 void TUnixDgInputAgent::ForwardMessages() {
@@ -166,7 +195,7 @@ void TUnixDgInputAgent::ForwardMessages() {
   shutdown_request_event.events = POLLIN;
   input_socket_event.fd = InputSocket.GetFd();
   input_socket_event.events = POLLIN;
-  TMsg::TPtr msg;
+  std::list<TMsg::TPtr> msg_list;
 
   for (; ; ) {
     for (auto &item : events) {
@@ -181,21 +210,27 @@ void TUnixDgInputAgent::ForwardMessages() {
         syslog(LOG_NOTICE, "UNIX datagram input thread got shutdown request, "
             "closing socket");
         /* We received a shutdown request from the thread that created us.
-           Close the input socket and terminate. */
-        InputSocket.Reset();
+           Close the input socket and terminate.  Leave the socket file alone
+           if another process has taken over the socket. */
+        if (UnlinkOnClose.load()) {
+          InputSocket.Reset();
+        } else {
+          InputSocket.Release();
+        }
       }
 
       break;
     }
 
     assert(input_socket_event.revents);
-    assert(!msg);
-    msg = ReadOneMsg();
-
-    if (msg) {
-      /* Forward message to router thread. */
-      OutputQueue.Put(std::move(msg));
-      UnixDgInputAgentForwardMsg.Increment();
+    assert(msg_list.empty());
+    ReadMsgs(msg_list);
+
+    if (!msg_list.empty()) {
+      /* Forward messages to router thread. */
+      UnixDgInputAgentForwardMsg.Increment(msg_list.size());
+      OutputQueue.Put(std::move(msg_list));
+      msg_list.clear();
     }
   }
 }
@@ -45,9 +45,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <list>
 #include <vector>
 
 #include <netinet/in.h>
@@ -60,6 +62,8 @@
 #include <dory/config.h>
 #include <dory/msg.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/spool/overflow_spool.h>
+#include <dory/topic_quota.h>
 #include <socket/named_unix_socket.h>
 #include <thread/fd_managed_thread.h>
 #include <thread/gate_put_api.h>
@@ -72,21 +76,46 @@ namespace Dory {
     public:
     TUnixDgInputAgent(const TConfig &config, Capped::TPool &pool,
         TMsgStateTracker &msg_state_tracker, TAnomalyTracker &anomaly_tracker,
-        Thread::TGatePutApi<TMsg::TPtr> &output_queue);
+        Thread::TGatePutApi<TMsg::TPtr> &output_queue,
+        Spool::TOverflowSpool *overflow_spool = nullptr,
+        TTopicQuota *topic_quota = nullptr);
 
     virtual ~TUnixDgInputAgent() noexcept;
 
+    /* Call before starting the agent to use 'sock', which must already be
+       bound to the configured socket path, instead of creating the socket.
+       This is for a socket received from another process. */
+    void AdoptSocket(Base::TFd &&sock);
+
+    /* Specify whether the socket file is unlinked when the agent closes its
+       socket.  The default is true.  Pass false when another process has
+       taken over the socket, or may still be using it.  Must be called before
+       requesting shutdown. */
+    void SetUnlinkOnClose(bool unlink_on_close) noexcept {
+      assert(this);
+      UnlinkOnClose.store(unlink_on_close);
+    }
+
     /* Start agent and wait for it to open input socket.  Return true on
        success or false on failure. */
     bool SyncStart();
 
+    /* Return the input socket.  Do not call unless the agent has been
+       successfully started and is still running. */
+    const Base::TFd &GetSocket() const noexcept {
+      assert(this);
+      return InputSocket.GetFd();
+    }
+
     protected:
     virtual void Run() override;
 
     private:
     void OpenUnixSocket();
 
-    TMsg::TPtr ReadOneMsg();
+    /* Read one datagram, and append the messages built from it to
+       'msg_list'.  A batch datagram may yield many messages. */
+    void ReadMsgs(std::list<TMsg::TPtr> &msg_list);
 
     void ForwardMessages();
 
@@ -106,12 +135,26 @@ namespace Dory {
     /* This is the UNIX domain datagram socket that web clients write to. */
     Socket::TNamedUnixSocket InputSocket;
 
+    /* Socket passed to AdoptSocket(), to be moved into 'InputSocket' when the
+       agent starts. */
+    Base::TFd AdoptedSocket;
+
+    std::atomic<bool> UnlinkOnClose;
+
     /* We read from the UNIX datagram socket into this buffer. */
     std::vector<uint8_t> InputBuf;
 
     /* Messages are queued here for the router thread. */
     Thread::TGatePutApi<TMsg::TPtr> &OutputQueue;
 
+    /* If not null, messages that don't fit in 'Pool' are handed to the spool
+       rather than discarded. */
+    Spool::TOverflowSpool * const OverflowSpool;
+
+    /* If not null, messages are charged against their topics' buffer quotas.
+     */
+    TTopicQuota * const TopicQuota;
+
     bool SyncStartSuccess;
 
     Base::TEventSemaphore *SyncStartNotify;
@@ -246,6 +246,87 @@ namespace {
     msg_list.clear();
   }
 
+  TEST_F(TUnixDgInputAgentTest, BatchForwarding) {
+    /* If this value is set too large, message(s) will be discarded and the
+       test will fail. */
+    const size_t pool_block_size = 256;
+
+    TDoryConfig conf(pool_block_size);
+    TGate<TMsg::TPtr> &output_queue = *conf.OutputQueue;
+
+    try {
+      conf.StartDory();
+    } catch (const TDoryConfig::TStartFailure &) {
+      ASSERT_TRUE(false);
+    }
+
+    TDoryClientSocket sock;
+    int ret = sock.Bind(conf.UnixSocketName);
+    ASSERT_EQ(ret, DORY_OK);
+    std::vector<std::string> topics;
+    std::vector<std::string> bodies;
+    topics.push_back("topic1");
+    bodies.push_back("Scooby");
+    topics.push_back("topic2");
+    bodies.push_back("Shaggy");
+
+    /* This one is too large for the socket, so it fails with EMSGSIZE but
+       doesn't prevent the ones after it from being sent. */
+    topics.push_back("topic3");
+    bodies.push_back(std::string(1024 * 1024, 'x'));
+
+    topics.push_back("topic4");
+    bodies.push_back("Velma");
+    std::vector<std::vector<uint8_t>> dg_bufs(topics.size());
+    std::vector<dory_msg_buf_t> msgs(topics.size());
+
+    for (size_t i = 0; i < topics.size(); ++i) {
+      MakeDg(dg_bufs[i], topics[i], bodies[i]);
+      msgs[i].msg = &dg_bufs[i][0];
+      msgs[i].msg_size = dg_bufs[i].size();
+    }
+
+    std::vector<int> status(msgs.size(), -1);
+    size_t sent_count = 0;
+    ret = sock.SendBatch(&msgs[0], msgs.size(), &status[0], &sent_count);
+    ASSERT_EQ(ret, EMSGSIZE);
+    ASSERT_EQ(sent_count, 3U);
+    ASSERT_EQ(status[0], DORY_OK);
+    ASSERT_EQ(status[1], DORY_OK);
+    ASSERT_EQ(status[2], EMSGSIZE);
+    ASSERT_EQ(status[3], DORY_OK);
+    topics.erase(topics.begin() + 2);
+    bodies.erase(bodies.begin() + 2);
+    std::list<TMsg::TPtr> msg_list;
+    const Base::TFd &msg_available_fd = output_queue.GetMsgAvailableFd();
+
+    while (msg_list.size() < 3) {
+      if (!msg_available_fd.IsReadable(30000)) {
+        ASSERT_TRUE(false);
+        break;
+      }
+
+      msg_list.splice(msg_list.end(), output_queue.Get());
+    }
+
+    ASSERT_EQ(msg_list.size(), 3U);
+    size_t i = 0;
+
+    for (std::list<TMsg::TPtr>::iterator iter = msg_list.begin();
+         iter != msg_list.end();
+         ++i, ++iter) {
+      TMsg::TPtr &msg_ptr = *iter;
+
+      /* Prevent spurious assertion failure in msg dtor. */
+      SetProcessed(msg_ptr);
+
+      ASSERT_EQ(msg_ptr->GetTopic(), topics[i]);
+      ASSERT_TRUE(ValueEquals(msg_ptr, bodies[i]));
+    }
+
+    msg_list.clear();
+  }
+
   TEST_F(TUnixDgInputAgentTest, NoBufferSpaceDiscard) {
     /* This setting must be chosen properly, since it determines how many
        messages will be discarded. */
@@ -41,6 +41,50 @@ size_t Dory::Util::GetDataSize(const std::list<TMsg::TPtr> &batch) {
   return total_size;
 }
 
+uint64_t Dory::Util::GetMinDeadline(const std::list<TMsg::TPtr> &batch) {
+  uint64_t deadline = UINT64_MAX;
+
+  for (const TMsg::TPtr &msg_ptr : batch) {
+    assert(msg_ptr);
+    deadline = std::min(deadline, msg_ptr->GetDeadline());
+  }
+
+  return deadline;
+}
+
+uint64_t Dory::Util::TakeExpiredMsgs(
+    std::list<std::list<TMsg::TPtr>> &batch_list, uint64_t now,
+    std::list<TMsg::TPtr> &expired) {
+  uint64_t next_deadline = UINT64_MAX;
+
+  for (auto iter = batch_list.begin(), next = iter;
+       iter != batch_list.end();
+       iter = next) {
+    ++next;
+    std::list<TMsg::TPtr> &batch = *iter;
+    assert(!batch.empty());
+
+    for (auto msg_iter = batch.begin(), msg_next = msg_iter;
+         msg_iter != batch.end();
+         msg_iter = msg_next) {
+      ++msg_next;
+      const TMsg &msg = **msg_iter;
+
+      if (msg.IsExpired(now)) {
+        expired.splice(expired.end(), batch, msg_iter);
+      } else {
+        next_deadline = std::min(next_deadline, msg.GetDeadline());
+      }
+    }
+
+    if (batch.empty()) {
+      batch_list.erase(iter);
+    }
+  }
+
+  return next_deadline;
+}
+
 void Dory::Util::WriteKey(std::vector<uint8_t> &dst, size_t offset,
     const TMsg &msg) {
   size_t key_size = msg.GetKeySize();
@@ -37,6 +37,19 @@ namespace Dory {
        messages in 'batch'. */
     size_t GetDataSize(const std::list<TMsg::TPtr> &batch);
 
+    /* Return the earliest deadline of the messages in 'batch', or UINT64_MAX
+       if 'batch' is empty.  A batch that combines topics may mix max ages, so
+       this isn't necessarily the deadline of its first message. */
+    uint64_t GetMinDeadline(const std::list<TMsg::TPtr> &batch);
+
+    /* Move messages from 'batch_list' that have expired as of 'now' (a
+       monotonic raw timestamp in milliseconds) to the back of 'expired', and
+       remove any batches left empty.  Every message is checked, since a batch
+       that combines topics may mix max ages.  Return the earliest deadline of
+       the remaining messages, or UINT64_MAX if none has a deadline. */
+    uint64_t TakeExpiredMsgs(std::list<std::list<TMsg::TPtr>> &batch_list,
+        uint64_t now, std::list<TMsg::TPtr> &expired);
+
     /* Write key of 'msg' into 'dst' starting at offset 'offset'.  Increase
        size of 'dst' if necessary to make space for key.  This function makes
        _no_ assumptions about the size of 'dst' on entry, and will never shrink
@@ -43,7 +43,13 @@ SERVER_COUNTER(MongooseGetServerInfoRequest);
 SERVER_COUNTER(MongooseGetCountersRequest);
 SERVER_COUNTER(MongooseGetDiscardsRequest);
 SERVER_COUNTER(MongooseGetMetadataFetchTimeRequest);
+SERVER_COUNTER(MongooseGetPoolStatsRequest);
+SERVER_COUNTER(MongooseGetCompressionStatsRequest);
+SERVER_COUNTER(MongooseGetConfInfoRequest);
 SERVER_COUNTER(MongooseGetQueueStatsRequest);
+SERVER_COUNTER(MongooseGetTopicQuotasRequest);
+SERVER_COUNTER(MongooseGetPriorityLanesRequest);
+SERVER_COUNTER(MongooseGetAdaptiveBatchingRequest);
 SERVER_COUNTER(MongooseHttpRequest);
 SERVER_COUNTER(MongooseStdException);
 SERVER_COUNTER(MongooseUnknownException);
@@ -78,6 +84,24 @@ const char *TWebInterface::ToErrorBlurb(TRequestType request_type) {
     case TRequestType::GET_QUEUE_STATS: {
       return "Get queue stats";
     }
+    case TRequestType::GET_POOL_STATS: {
+      return "Get pool stats";
+    }
+    case TRequestType::GET_COMPRESSION_STATS: {
+      return "Get compression stats";
+    }
+    case TRequestType::GET_CONF_INFO: {
+      return "Get config file info";
+    }
+    case TRequestType::GET_TOPIC_QUOTAS: {
+      return "Get topic buffer quotas";
+    }
+    case TRequestType::GET_PRIORITY_LANES: {
+      return "Get priority lane stats";
+    }
+    case TRequestType::GET_ADAPTIVE_BATCHING: {
+      return "Get adaptive batching stats";
+    }
     case TRequestType::MSG_DEBUG_GET_TOPICS: {
       return "Msg debug get topics";
     }
@@ -99,6 +123,9 @@ const char *TWebInterface::ToErrorBlurb(TRequestType request_type) {
     case TRequestType::METADATA_UPDATE: {
       return "Metadata update";
     }
+    case TRequestType::CONF_RELOAD: {
+      return "Config file reload";
+    }
     NO_DEFAULT_CASE;
   }
 
@@ -190,6 +217,29 @@ void TWebInterface::WriteFrontPage(std::ostream &os) {
       << "      Get queued message info: [<a href=\"/queues/plain\">"
       << "plain</a>]" << std::endl
       << "          [<a href=\"/queues/json\">JSON</a>]<br/>" << std::endl
+      << "      Get buffer pool info: [<a href=\"/pool/plain\">"
+      << "plain</a>]" << std::endl
+      << "          [<a href=\"/pool/json\">JSON</a>]<br/>" << std::endl
+      << "      Get compression info: [<a href=\"/compression/plain\">"
+      << "plain</a>]" << std::endl
+      << "          [<a href=\"/compression/json\">JSON</a>]<br/>"
+      << std::endl
+      << "      Get config file generation: [<a href=\"/conf/plain\">"
+      << "plain</a>]" << std::endl
+      << "          [<a href=\"/conf/json\">JSON</a>]<br/>" << std::endl
+      << "      Get topic buffer quota info: [<a href=\"/topic_quotas/plain\">"
+      << "plain</a>]" << std::endl
+      << "          [<a href=\"/topic_quotas/json\">JSON</a>]<br/>"
+      << std::endl
+      << "      Get priority lane info: [<a href=\"/priority_lanes/plain\">"
+      << "plain</a>]" << std::endl
+      << "          [<a href=\"/priority_lanes/json\">JSON</a>]<br/>"
+      << std::endl
+      << "      Get adaptive batching info:" << std::endl
+      << "          [<a href=\"/adaptive_batching/plain\">plain</a>]"
+      << std::endl
+      << "          [<a href=\"/adaptive_batching/json\">JSON</a>]<br/>"
+      << std::endl
       << "      Get metadata fetch time:" << std::endl
       << "          [<a href=\"/metadata_fetch_time/plain\">plain</a>]"
       << std::endl
@@ -203,6 +253,12 @@ void TWebInterface::WriteFrontPage(std::ostream &os) {
       << std::endl
       << "      </div>" << std::endl
       << "    </form>" << std::endl
+      << "    <form action=\"/conf_reload\" method=\"post\">" << std::endl
+      << "      <div>" << std::endl
+      << "        <input type=\"submit\" value=\"Reload Config File\"/>"
+      << std::endl
+      << "      </div>" << std::endl
+      << "    </form>" << std::endl
       << "  </body>" << std::endl
       << "</html>" << std::endl;
 }
@@ -284,6 +340,65 @@ void TWebInterface::HandleHttpRequest(mg_connection *conn,
       MongooseGetQueueStatsRequest.Increment();
       TWebRequestHandler().HandleQueueStatsRequestJson(oss, MsgStateTracker);
       response_type = TResponseType::Json;
+    } else if (!std::strcmp(request_info->uri, "/pool/plain")) {
+      request_type = TRequestType::GET_POOL_STATS;
+      MongooseGetPoolStatsRequest.Increment();
+      TWebRequestHandler().HandlePoolStatsRequestPlain(oss, Pool);
+    } else if (!std::strcmp(request_info->uri, "/pool/json")) {
+      request_type = TRequestType::GET_POOL_STATS;
+      MongooseGetPoolStatsRequest.Increment();
+      TWebRequestHandler().HandlePoolStatsRequestJson(oss, Pool);
+      response_type = TResponseType::Json;
+    } else if (!std::strcmp(request_info->uri, "/compression/plain")) {
+      request_type = TRequestType::GET_COMPRESSION_STATS;
+      MongooseGetCompressionStatsRequest.Increment();
+      TWebRequestHandler().HandleCompressionStatsRequestPlain(oss,
+          CompressionStats);
+    } else if (!std::strcmp(request_info->uri, "/compression/json")) {
+      request_type = TRequestType::GET_COMPRESSION_STATS;
+      MongooseGetCompressionStatsRequest.Increment();
+      TWebRequestHandler().HandleCompressionStatsRequestJson(oss,
+          CompressionStats);
+      response_type = TResponseType::Json;
+    } else if (!std::strcmp(request_info->uri, "/conf/plain")) {
+      request_type = TRequestType::GET_CONF_INFO;
+      MongooseGetConfInfoRequest.Increment();
+      TWebRequestHandler().HandleConfInfoRequestPlain(oss, ConfGeneration);
+    } else if (!std::strcmp(request_info->uri, "/conf/json")) {
+      request_type = TRequestType::GET_CONF_INFO;
+      MongooseGetConfInfoRequest.Increment();
+      TWebRequestHandler().HandleConfInfoRequestJson(oss, ConfGeneration);
+      response_type = TResponseType::Json;
+    } else if (!std::strcmp(request_info->uri, "/topic_quotas/plain")) {
+      request_type = TRequestType::GET_TOPIC_QUOTAS;
+      MongooseGetTopicQuotasRequest.Increment();
+      TWebRequestHandler().HandleTopicQuotaRequestPlain(oss, TopicQuota);
+    } else if (!std::strcmp(request_info->uri, "/topic_quotas/json")) {
+      request_type = TRequestType::GET_TOPIC_QUOTAS;
+      MongooseGetTopicQuotasRequest.Increment();
+      TWebRequestHandler().HandleTopicQuotaRequestJson(oss, TopicQuota);
+    } else if (!std::strcmp(request_info->uri, "/priority_lanes/plain")) {
+      request_type = TRequestType::GET_PRIORITY_LANES;
+      MongooseGetPriorityLanesRequest.Increment();
+      TWebRequestHandler().HandlePriorityLanesRequestPlain(oss, LaneStats,
+          TopicQuota);
+    } else if (!std::strcmp(request_info->uri, "/priority_lanes/json")) {
+      request_type = TRequestType::GET_PRIORITY_LANES;
+      MongooseGetPriorityLanesRequest.Increment();
+      TWebRequestHandler().HandlePriorityLanesRequestJson(oss, LaneStats,
+          TopicQuota);
+      response_type = TResponseType::Json;
+    } else if (!std::strcmp(request_info->uri, "/adaptive_batching/plain")) {
+      request_type = TRequestType::GET_ADAPTIVE_BATCHING;
+      MongooseGetAdaptiveBatchingRequest.Increment();
+      TWebRequestHandler().HandleAdaptiveBatchingRequestPlain(oss,
+          AdaptiveBatchStats);
+    } else if (!std::strcmp(request_info->uri, "/adaptive_batching/json")) {
+      request_type = TRequestType::GET_ADAPTIVE_BATCHING;
+      MongooseGetAdaptiveBatchingRequest.Increment();
+      TWebRequestHandler().HandleAdaptiveBatchingRequestJson(oss,
+          AdaptiveBatchStats);
+      response_type = TResponseType::Json;
     } else if (!std::strcmp(request_info->uri, "/msg_debug/get_topics")) {
       request_type = TRequestType::MSG_DEBUG_GET_TOPICS;
       TWebRequestHandler().HandleGetDebugTopicsRequest(oss, DebugSetup);
@@ -318,11 +433,15 @@ void TWebInterface::HandleHttpRequest(mg_connection *conn,
       request_type = TRequestType::METADATA_UPDATE;
       TWebRequestHandler().HandleMetadataUpdateRequest(oss,
           MetadataUpdateRequestSem);
+    } else if (!std::strcmp(request_info->uri, "/conf_reload")) {
+      request_type = TRequestType::CONF_RELOAD;
+      TWebRequestHandler().HandleConfReloadRequest(oss,
+          ConfReloadRequestSem);
     } else {
       request_type = TRequestType::UNKNOWN_POST_REQUEST;
       mg_printf(conn, "HTTP/1.1 404 NOT FOUND\r\n"
                       "Content-Type: text/plain\r\n\r\n"
-                      "[not found: try /metadata_update]");
+                      "[not found: try /metadata_update or /conf_reload]");
       return;
     }
   } else {
@@ -31,10 +31,16 @@
 #include <base/event_semaphore.h>
 #include <base/indent.h>
 #include <base/no_copy_semantics.h>
+#include <capped/pool.h>
 #include <dory/anomaly_tracker.h>
+#include <dory/batch/adaptive_batch_stats.h>
+#include <dory/compression_stats.h>
+#include <dory/conf_generation.h>
 #include <dory/debug/debug_setup.h>
 #include <dory/metadata_timestamp.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/priority_lane_stats.h>
+#include <dory/topic_quota.h>
 #include <third_party/mongoose/mongoose.h>
 
 namespace Dory {
@@ -47,14 +53,27 @@ namespace Dory {
                   TAnomalyTracker &anomaly_tracker,
                   const TMetadataTimestamp &metadata_timestamp,
                   Base::TEventSemaphore &metadata_update_request_sem,
-                  Debug::TDebugSetup &debug_setup)
+                  Debug::TDebugSetup &debug_setup, const Capped::TPool &pool,
+                  const TCompressionStats &compression_stats,
+                  Base::TEventSemaphore &conf_reload_request_sem,
+                  const TConfGeneration &conf_generation,
+                  const TTopicQuota *topic_quota,
+                  const TPriorityLaneStats &lane_stats,
+                  const Batch::TAdaptiveBatchStats &adaptive_batch_stats)
         : Port(port),
           HttpServerStarted(false),
           MsgStateTracker(msg_state_tracker),
           AnomalyTracker(anomaly_tracker),
           MetadataTimestamp(metadata_timestamp),
           MetadataUpdateRequestSem(metadata_update_request_sem),
-          DebugSetup(debug_setup) {
+          DebugSetup(debug_setup),
+          Pool(pool),
+          CompressionStats(compression_stats),
+          ConfReloadRequestSem(conf_reload_request_sem),
+          ConfGeneration(conf_generation),
+          TopicQuota(topic_quota),
+          LaneStats(lane_stats),
+          AdaptiveBatchStats(adaptive_batch_stats) {
     }
 
     virtual ~TWebInterface() noexcept {
@@ -95,13 +114,20 @@ namespace Dory {
       GET_DISCARDS,
       GET_METADATA_FETCH_TIME,
       GET_QUEUE_STATS,
+      GET_POOL_STATS,
+      GET_COMPRESSION_STATS,
+      GET_CONF_INFO,
+      GET_TOPIC_QUOTAS,
+      GET_PRIORITY_LANES,
+      GET_ADAPTIVE_BATCHING,
       MSG_DEBUG_GET_TOPICS,
       MSG_DEBUG_ADD_ALL_TOPICS,
       MSG_DEBUG_DEL_ALL_TOPICS,
       MSG_DEBUG_TRUNCATE_FILES,
       MSG_DEBUG_ADD_TOPIC,
       MSG_DEBUG_DEL_TOPIC,
-      METADATA_UPDATE
+      METADATA_UPDATE,
+      CONF_RELOAD
     };  // TRequestType
 
     static const char *ToErrorBlurb(TRequestType request_type);
@@ -131,6 +157,21 @@ namespace Dory {
     Base::TEventSemaphore &MetadataUpdateRequestSem;
 
     Debug::TDebugSetup &DebugSetup;
+
+    const Capped::TPool &Pool;
+
+    const TCompressionStats &CompressionStats;
+
+    Base::TEventSemaphore &ConfReloadRequestSem;
+
+    const TConfGeneration &ConfGeneration;
+
+    /* Null if topic buffer quotas are disabled. */
+    const TTopicQuota * const TopicQuota;
+
+    const TPriorityLaneStats &LaneStats;
+
+    const Batch::TAdaptiveBatchStats &AdaptiveBatchStats;
   };  // TWebInterface
 
 }  // Dory
@@ -24,8 +24,10 @@
 #include <cassert>
 #include <cstring>
 #include <iomanip>
+#include <limits>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <sys/types.h>
 #include <time.h>
@@ -38,6 +40,7 @@
 
 using namespace Base;
 using namespace Dory;
+using namespace Dory::Batch;
 using namespace Dory::Debug;
 using namespace Server;
 
@@ -400,6 +403,630 @@ void TWebRequestHandler::HandleQueueStatsRequestJson(std::ostream &os,
   os << ind0 << "}" << std::endl;
 }
 
+void TWebRequestHandler::HandlePoolStatsRequestPlain(std::ostream &os,
+    const Capped::TPool &pool) {
+  assert(this);
+  size_t in_use_bytes = 0;
+  size_t max_bytes = 0;
+  std::vector<Capped::TPool::TSizeClassStats> stats =
+      pool.GetStats(in_use_bytes, max_bytes);
+  uint64_t now = GetEpochSeconds();
+  char now_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, now_time_buf);
+  time_t start_time = GetServerStartTime();
+  char start_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(start_time, start_time_buf);
+  os << "pid: " << getpid() << std::endl
+      << "version: " << dory_build_id << std::endl
+      << "since: " << start_time << " " << start_time_buf << std::endl
+      << "now: " << now << " " << now_time_buf << std::endl << std::endl;
+
+  for (const auto &item : stats) {
+    os << "chunk_size: " << std::setw(10) << item.ChunkSize
+        << "  in_use: " << std::setw(10) << item.InUseCount
+        << "  free: " << std::setw(10) << item.FreeCount << std::endl;
+  }
+
+  os << std::endl
+      << std::setw(10) << in_use_bytes << " bytes in use" << std::endl
+      << std::setw(10) << max_bytes << " bytes max" << std::endl;
+}
+
+void TWebRequestHandler::HandlePoolStatsRequestJson(std::ostream &os,
+    const Capped::TPool &pool) {
+  assert(this);
+  size_t in_use_bytes = 0;
+  size_t max_bytes = 0;
+  std::vector<Capped::TPool::TSizeClassStats> stats =
+      pool.GetStats(in_use_bytes, max_bytes);
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"pid\": " << getpid() << "," << std::endl
+        << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"since\": " << start_time << "," << std::endl
+        << ind1 << "\"now\": " << now << "," << std::endl
+        << ind1 << "\"size_classes\": [";
+
+    {
+      TIndent ind2(ind1);
+      bool first_time = true;
+
+      for (const auto &item : stats) {
+        if (!first_time) {
+          os << ",";
+        }
+
+        os << std::endl << ind2 << "{" << std::endl;
+
+        {
+          TIndent ind3(ind2);
+          os << ind3 << "\"chunk_size\": " << item.ChunkSize << ","
+              << std::endl
+              << ind3 << "\"in_use\": " << item.InUseCount << ","
+              << std::endl
+              << ind3 << "\"free\": " << item.FreeCount << std::endl;
+        }
+
+        os << ind2 << "}";
+        first_time = false;
+      }
+
+      os << std::endl;
+    }
+
+    os << ind1 << "]," << std::endl
+        << ind1 << "\"in_use_bytes\": " << in_use_bytes << "," << std::endl
+        << ind1 << "\"max_bytes\": " << max_bytes << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+/* Ratio of total compressed size to total uncompressed size over all of a
+   topic's compression attempts. */
+static double OverallRatio(const TCompressionStats::TTopicStats &stats) {
+  return stats.UncompressedBytes ?
+      (static_cast<double>(stats.CompressedBytes) /
+       static_cast<double>(stats.UncompressedBytes)) :
+      0.0;
+}
+
+void TWebRequestHandler::HandleCompressionStatsRequestPlain(std::ostream &os,
+    const TCompressionStats &stats) {
+  assert(this);
+  std::vector<TCompressionStats::TTopicStatsItem> topic_stats;
+  stats.GetStats(topic_stats);
+  uint64_t now = GetEpochSeconds();
+  char now_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, now_time_buf);
+  time_t start_time = GetServerStartTime();
+  char start_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(start_time, start_time_buf);
+  os << "pid: " << getpid() << std::endl
+      << "version: " << dory_build_id << std::endl
+      << "since: " << start_time << " " << start_time_buf << std::endl
+      << "now: " << now << " " << now_time_buf << std::endl
+      << "probe_interval: " << stats.GetProbeInterval() << std::endl
+      << std::endl << std::fixed;
+  uint64_t total_saved = 0;
+  uint64_t total_ns = 0;
+
+  for (const auto &item : topic_stats) {
+    const TCompressionStats::TTopicStats &s = item.second;
+    total_saved += s.BytesSaved;
+    total_ns += s.CompressionNs;
+    os << "ratio: " << std::setprecision(3) << OverallRatio(s)
+        << "  recent: " << std::setprecision(3) << s.RecentRatio
+        << "  saved: " << std::setw(12) << s.BytesSaved
+        << "  compress_ms: " << std::setw(10) << (s.CompressionNs / 1000000)
+        << "  attempts: " << std::setw(10) << s.AttemptCount
+        << "  not_compressible: " << std::setw(10) << s.NotCompressibleCount
+        << "  skipped: " << std::setw(10) << s.SkipCount
+        << (s.Skipping ? "  (skipping)" : "")
+        << "  topic: [" << item.first << "]" << std::endl;
+  }
+
+  if (!topic_stats.empty()) {
+    os << std::endl;
+  }
+
+  os << std::setw(12) << total_saved << " total bytes saved" << std::endl
+      << std::setw(12) << (total_ns / 1000000)
+      << " total compression milliseconds" << std::endl;
+}
+
+void TWebRequestHandler::HandleCompressionStatsRequestJson(std::ostream &os,
+    const TCompressionStats &stats) {
+  assert(this);
+  std::vector<TCompressionStats::TTopicStatsItem> topic_stats;
+  stats.GetStats(topic_stats);
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"pid\": " << getpid() << "," << std::endl
+        << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"since\": " << start_time << "," << std::endl
+        << ind1 << "\"now\": " << now << "," << std::endl
+        << ind1 << "\"probe_interval\": " << stats.GetProbeInterval() << ","
+        << std::endl
+        << ind1 << "\"topics\": [";
+
+    {
+      TIndent ind2(ind1);
+      bool first_time = true;
+
+      for (const auto &item : topic_stats) {
+        const TCompressionStats::TTopicStats &s = item.second;
+
+        if (!first_time) {
+          os << ",";
+        }
+
+        os << std::endl << ind2 << "{" << std::endl;
+
+        {
+          TIndent ind3(ind2);
+          os << ind3 << "\"topic\": \"" << item.first << "\"," << std::endl
+              << ind3 << "\"attempts\": " << s.AttemptCount << ","
+              << std::endl
+              << ind3 << "\"not_compressible\": " << s.NotCompressibleCount
+              << "," << std::endl
+              << ind3 << "\"skipped\": " << s.SkipCount << "," << std::endl
+              << ind3 << "\"uncompressed_bytes\": " << s.UncompressedBytes
+              << "," << std::endl
+              << ind3 << "\"compressed_bytes\": " << s.CompressedBytes
+              << "," << std::endl
+              << ind3 << "\"bytes_saved\": " << s.BytesSaved << ","
+              << std::endl
+              << ind3 << "\"compression_ns\": " << s.CompressionNs << ","
+              << std::endl
+              << ind3 << "\"ratio\": " << OverallRatio(s) << ","
+              << std::endl
+              << ind3 << "\"recent_ratio\": " << s.RecentRatio << ","
+              << std::endl
+              << ind3 << "\"skipping\": "
+              << (s.Skipping ? "true" : "false") << std::endl;
+        }
+
+        os << ind2 << "}";
+        first_time = false;
+      }
+
+      os << std::endl;
+    }
+
+    os << ind1 << "]" << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+/* Write 's' to 'os' as a JSON string, including the enclosing quotes. */
+static void WriteJsonString(std::ostream &os, const std::string &s) {
+  os << "\"";
+
+  for (char c : s) {
+    switch (c) {
+      case '"':
+      case '\\': {
+        os << '\\' << c;
+        break;
+      }
+      case '\n': {
+        os << "\\n";
+        break;
+      }
+      default: {
+        if (static_cast<unsigned char>(c) < 0x20) {
+          os << ' ';
+        } else {
+          os << c;
+        }
+
+        break;
+      }
+    }
+  }
+
+  os << "\"";
+}
+
+void TWebRequestHandler::HandleConfInfoRequestPlain(std::ostream &os,
+    const TConfGeneration &conf_generation) {
+  assert(this);
+  TConfGeneration::TInfo info = conf_generation.GetInfo();
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  char now_time_buf[TIME_BUF_SIZE], start_time_buf[TIME_BUF_SIZE],
+      in_use_since_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, now_time_buf);
+  FillTimeBuf(start_time, start_time_buf);
+  FillTimeBuf(info.InUseSince / 1000, in_use_since_buf);
+  os << "pid: " << getpid() << std::endl
+      << "version: " << dory_build_id << std::endl
+      << "since: " << start_time << " " << start_time_buf << std::endl
+      << "now: " << now << " " << now_time_buf << std::endl << std::endl
+      << "config generation in use: " << info.InUse << std::endl
+      << "in use since (milliseconds since epoch): " << info.InUseSince
+      << " " << in_use_since_buf << std::endl
+      << "latest config generation loaded: " << info.Loaded << std::endl
+      << "failed reload count: " << info.FailedCount << std::endl;
+
+  if (info.FailedCount) {
+    char error_time_buf[TIME_BUF_SIZE];
+    FillTimeBuf(info.LastErrorTime / 1000, error_time_buf);
+    os << "last failed reload at (milliseconds since epoch): "
+        << info.LastErrorTime << " " << error_time_buf << std::endl
+        << "last reload error: " << info.LastError << std::endl;
+  }
+}
+
+void TWebRequestHandler::HandleConfInfoRequestJson(std::ostream &os,
+    const TConfGeneration &conf_generation) {
+  assert(this);
+  TConfGeneration::TInfo info = conf_generation.GetInfo();
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"pid\": " << getpid() << "," << std::endl
+        << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"since\": " << start_time << "," << std::endl
+        << ind1 << "\"now\": " << now << "," << std::endl
+        << ind1 << "\"in_use\": " << info.InUse << "," << std::endl
+        << ind1 << "\"in_use_since\": " << info.InUseSince << ","
+        << std::endl
+        << ind1 << "\"loaded\": " << info.Loaded << "," << std::endl
+        << ind1 << "\"failed_count\": " << info.FailedCount << ","
+        << std::endl
+        << ind1 << "\"last_error_time\": " << info.LastErrorTime << ","
+        << std::endl
+        << ind1 << "\"last_error\": ";
+    WriteJsonString(os, info.LastError);
+    os << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+void TWebRequestHandler::HandleTopicQuotaRequestPlain(std::ostream &os,
+    const TTopicQuota *topic_quota) {
+  assert(this);
+  uint64_t now = GetEpochSeconds();
+  char now_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, now_time_buf);
+  time_t start_time = GetServerStartTime();
+  char start_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(start_time, start_time_buf);
+  os << "pid: " << getpid() << std::endl
+      << "version: " << dory_build_id << std::endl
+      << "since: " << start_time << " " << start_time_buf << std::endl
+      << "now: " << now << " " << now_time_buf << std::endl << std::endl;
+
+  if (topic_quota == nullptr) {
+    os << "topic buffer quotas disabled" << std::endl;
+    return;
+  }
+
+  std::vector<TTopicQuota::TTopicStats> topic_stats =
+      topic_quota->GetTopicStats();
+
+  for (const auto &s : topic_stats) {
+    os << "used: " << std::setw(12) << s.UsedBytes << "  max: ";
+
+    if (s.MaxBytes.IsKnown()) {
+      os << std::setw(12) << *s.MaxBytes;
+    } else {
+      os << std::setw(12) << "unlimited";
+    }
+
+    os << "  discards: " << std::setw(10) << s.DiscardCount;
+
+    if (s.Topic.empty()) {
+      os << "  (topics without their own slots)" << std::endl;
+    } else {
+      os << "  topic: [" << s.Topic << "]" << std::endl;
+    }
+  }
+
+  if (!topic_stats.empty()) {
+    os << std::endl;
+  }
+
+  os << "burst used: " << topic_quota->GetBurstUsedBytes() << std::endl
+      << "burst max: " << topic_quota->GetBurstBytes() << std::endl;
+}
+
+void TWebRequestHandler::HandleTopicQuotaRequestJson(std::ostream &os,
+    const TTopicQuota *topic_quota) {
+  assert(this);
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"pid\": " << getpid() << "," << std::endl
+        << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"since\": " << start_time << "," << std::endl
+        << ind1 << "\"now\": " << now << "," << std::endl
+        << ind1 << "\"enabled\": " << (topic_quota ? "true" : "false");
+
+    if (topic_quota) {
+      os << "," << std::endl
+          << ind1 << "\"burst_used\": " << topic_quota->GetBurstUsedBytes()
+          << "," << std::endl
+          << ind1 << "\"burst_max\": " << topic_quota->GetBurstBytes() << ","
+          << std::endl
+          << ind1 << "\"topics\": [";
+
+      {
+        TIndent ind2(ind1);
+        bool first_time = true;
+
+        for (const auto &s : topic_quota->GetTopicStats()) {
+          if (!first_time) {
+            os << ",";
+          }
+
+          os << std::endl << ind2 << "{" << std::endl;
+
+          {
+            TIndent ind3(ind2);
+            os << ind3 << "\"topic\": ";
+            WriteJsonString(os, s.Topic);
+            os << "," << std::endl
+                << ind3 << "\"used\": " << s.UsedBytes << "," << std::endl
+                << ind3 << "\"max\": ";
+
+            if (s.MaxBytes.IsKnown()) {
+              os << *s.MaxBytes;
+            } else {
+              os << "null";
+            }
+
+            os << "," << std::endl
+                << ind3 << "\"discards\": " << s.DiscardCount << std::endl;
+          }
+
+          os << ind2 << "}";
+          first_time = false;
+        }
+
+        if (!first_time) {
+          os << std::endl << ind1;
+        }
+      }
+
+      os << "]";
+    }
+
+    os << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+static double AvgLatencyMs(const TPriorityLaneStats::TLaneStats &stats) {
+  return stats.SentMsgCount ?
+      (static_cast<double>(stats.TotalLatencyMs) / stats.SentMsgCount) : 0.0;
+}
+
+static bool HasLowPriorityLimit(const TTopicQuota *topic_quota) {
+  return topic_quota && (topic_quota->GetLowPriorityMaxBytes() !=
+      std::numeric_limits<size_t>::max());
+}
+
+void TWebRequestHandler::HandlePriorityLanesRequestPlain(std::ostream &os,
+    const TPriorityLaneStats &lane_stats, const TTopicQuota *topic_quota) {
+  assert(this);
+  uint64_t now = GetEpochSeconds();
+  char now_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, now_time_buf);
+  time_t start_time = GetServerStartTime();
+  char start_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(start_time, start_time_buf);
+  os << "pid: " << getpid() << std::endl
+      << "version: " << dory_build_id << std::endl
+      << "since: " << start_time << " " << start_time_buf << std::endl
+      << "now: " << now << " " << now_time_buf << std::endl << std::endl;
+
+  static const struct {
+    TPriorityLaneStats::TLane Lane;
+    const char *Name;
+  } lanes[] = {
+    {TPriorityLaneStats::TLane::High, "high"},
+    {TPriorityLaneStats::TLane::Low, "low "}
+  };
+
+  for (const auto &lane : lanes) {
+    TPriorityLaneStats::TLaneStats s = lane_stats.GetStats(lane.Lane);
+    os << "lane " << lane.Name << "  queued: " << std::setw(10)
+        << s.QueuedMsgCount << "  sent: " << std::setw(12) << s.SentMsgCount
+        << std::fixed << std::setprecision(1)
+        << "  avg latency ms: " << std::setw(9) << AvgLatencyMs(s)
+        << "  recent latency ms: " << std::setw(9) << s.RecentLatencyMs
+        << "  max latency ms: " << std::setw(9) << s.MaxLatencyMs
+        << std::endl;
+  }
+
+  os << std::endl << "low priority buffered bytes: ";
+
+  if (HasLowPriorityLimit(topic_quota)) {
+    os << topic_quota->GetLowPriorityUsedBytes() << std::endl
+        << "low priority max bytes: " << topic_quota->GetLowPriorityMaxBytes()
+        << std::endl;
+  } else {
+    os << "not tracked" << std::endl
+        << "low priority max bytes: unlimited" << std::endl;
+  }
+}
+
+void TWebRequestHandler::HandlePriorityLanesRequestJson(std::ostream &os,
+    const TPriorityLaneStats &lane_stats, const TTopicQuota *topic_quota) {
+  assert(this);
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"pid\": " << getpid() << "," << std::endl
+        << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"since\": " << start_time << "," << std::endl
+        << ind1 << "\"now\": " << now << "," << std::endl;
+
+    static const struct {
+      TPriorityLaneStats::TLane Lane;
+      const char *Name;
+    } lanes[] = {
+      {TPriorityLaneStats::TLane::High, "high"},
+      {TPriorityLaneStats::TLane::Low, "low"}
+    };
+
+    for (const auto &lane : lanes) {
+      TPriorityLaneStats::TLaneStats s = lane_stats.GetStats(lane.Lane);
+      os << ind1 << "\"" << lane.Name << "\": {" << std::endl;
+
+      {
+        TIndent ind2(ind1);
+        os << ind2 << "\"queued\": " << s.QueuedMsgCount << "," << std::endl
+            << ind2 << "\"sent\": " << s.SentMsgCount << "," << std::endl
+            << ind2 << "\"avg_latency_ms\": " << AvgLatencyMs(s) << ","
+            << std::endl
+            << ind2 << "\"recent_latency_ms\": " << s.RecentLatencyMs << ","
+            << std::endl
+            << ind2 << "\"max_latency_ms\": " << s.MaxLatencyMs
+            << std::endl;
+      }
+
+      os << ind1 << "}," << std::endl;
+    }
+
+    os << ind1 << "\"low_priority_used\": ";
+
+    if (HasLowPriorityLimit(topic_quota)) {
+      os << topic_quota->GetLowPriorityUsedBytes() << "," << std::endl
+          << ind1 << "\"low_priority_max\": "
+          << topic_quota->GetLowPriorityMaxBytes() << std::endl;
+    } else {
+      os << "null," << std::endl
+          << ind1 << "\"low_priority_max\": null" << std::endl;
+    }
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
+void TWebRequestHandler::HandleAdaptiveBatchingRequestPlain(std::ostream &os,
+    const TAdaptiveBatchStats &stats) {
+  assert(this);
+  std::vector<TAdaptiveBatchStats::TGroupStatsItem> group_stats;
+  stats.GetStats(group_stats);
+  uint64_t now = GetEpochSeconds();
+  char now_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, now_time_buf);
+  time_t start_time = GetServerStartTime();
+  char start_time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(start_time, start_time_buf);
+  os << "pid: " << getpid() << std::endl
+      << "version: " << dory_build_id << std::endl
+      << "since: " << start_time << " " << start_time_buf << std::endl
+      << "now: " << now << " " << now_time_buf << std::endl
+      << "ack latency ms: " << stats.GetAckLatency() << std::endl
+      << std::endl;
+
+  for (const auto &item : group_stats) {
+    const TAdaptiveBatchStats::TGroupStats &s = item.second;
+    os << "target ms: " << std::setw(6) << s.LatencyTarget
+        << "  time ms: " << std::setw(6) << s.TimeLimit
+        << "  bytes: " << std::setw(10) << s.ByteCount
+        << "  bytes/sec: " << std::setw(12) << s.ByteRate
+        << "  ack ms: " << std::setw(6) << s.AckLatency
+        << "  group: [" << item.first << "]" << std::endl;
+  }
+}
+
+void TWebRequestHandler::HandleAdaptiveBatchingRequestJson(std::ostream &os,
+    const TAdaptiveBatchStats &stats) {
+  assert(this);
+  std::vector<TAdaptiveBatchStats::TGroupStatsItem> group_stats;
+  stats.GetStats(group_stats);
+  uint64_t now = GetEpochSeconds();
+  time_t start_time = GetServerStartTime();
+  std::string indent_str;
+  TIndent ind0(indent_str, TIndent::StartAt::Zero, 4);
+  os << ind0 << "{" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    os << ind1 << "\"pid\": " << getpid() << "," << std::endl
+        << ind1 << "\"version\": \"" << dory_build_id << "\"," << std::endl
+        << ind1 << "\"since\": " << start_time << "," << std::endl
+        << ind1 << "\"now\": " << now << "," << std::endl
+        << ind1 << "\"ack_latency_ms\": " << stats.GetAckLatency() << ","
+        << std::endl
+        << ind1 << "\"groups\": [";
+
+    {
+      TIndent ind2(ind1);
+      bool first_time = true;
+
+      for (const auto &item : group_stats) {
+        const TAdaptiveBatchStats::TGroupStats &s = item.second;
+
+        if (!first_time) {
+          os << ",";
+        }
+
+        os << std::endl << ind2 << "{" << std::endl;
+
+        {
+          TIndent ind3(ind2);
+          os << ind3 << "\"group\": ";
+          WriteJsonString(os, item.first);
+          os << "," << std::endl
+              << ind3 << "\"latency_target_ms\": " << s.LatencyTarget << ","
+              << std::endl
+              << ind3 << "\"time_ms\": " << s.TimeLimit << "," << std::endl
+              << ind3 << "\"bytes\": " << s.ByteCount << "," << std::endl
+              << ind3 << "\"bytes_per_sec\": " << s.ByteRate << ","
+              << std::endl
+              << ind3 << "\"ack_latency_ms\": " << s.AckLatency << std::endl;
+        }
+
+        os << ind2 << "}";
+        first_time = false;
+      }
+
+      os << std::endl;
+    }
+
+    os << ind1 << "]" << std::endl;
+  }
+
+  os << ind0 << "}" << std::endl;
+}
+
 void TWebRequestHandler::HandleGetDebugTopicsRequest(std::ostream &os,
     const Debug::TDebugSetup &debug_setup) {
   assert(this);
@@ -472,6 +1099,17 @@ void TWebRequestHandler::HandleMetadataUpdateRequest(std::ostream &os,
       << std::endl;
 }
 
+void TWebRequestHandler::HandleConfReloadRequest(std::ostream &os,
+        Base::TEventSemaphore &reload_request_sem) {
+  assert(this);
+  reload_request_sem.Push();
+  uint64_t now = GetEpochSeconds();
+  char time_buf[TIME_BUF_SIZE];
+  FillTimeBuf(now, time_buf);
+  os << "Config file reload initiated at " << now << " " << time_buf
+      << std::endl;
+}
+
 void TWebRequestHandler::WriteDiscardReportPlain(std::ostream &os,
     const TAnomalyTracker::TInfo &info) {
   assert(this);
@@ -593,6 +1231,30 @@ void TWebRequestHandler::WriteDiscardReportPlain(std::ostream &os,
 
   first_time = true;
 
+  for (auto &x : info.TopicQuotaDiscardMap) {
+    if (first_time) {
+      os << std::endl;
+      first_time = false;
+    }
+
+    os << "    topic quota discard topic: " << x.first.size() << "["
+        << x.first << "] count " << x.second << std::endl;
+  }
+
+  first_time = true;
+
+  for (auto &x : info.ExpiredDiscardMap) {
+    if (first_time) {
+      os << std::endl;
+      first_time = false;
+    }
+
+    os << "    expired discard topic: " << x.first.size() << "[" << x.first
+        << "] count " << x.second << std::endl;
+  }
+
+  first_time = true;
+
   for (auto &x : info.DiscardTopicMap) {
     if (first_time) {
       os << std::endl;
@@ -814,6 +1476,64 @@ void TWebRequestHandler::WriteDiscardReportJson(std::ostream &os,
     }
   }
 
+  os << ind0 << "]," << std::endl
+      << ind0 << "\"topic_quota_discard\": [" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    bool first_time = true;
+
+    for (auto &x : info.TopicQuotaDiscardMap) {
+      if (!first_time) {
+        os << "," << std::endl;
+      }
+
+      os << ind1 << "{" << std::endl;
+
+      {
+        TIndent ind2(ind1);
+        os << ind2 << "\"topic\": \"" << x.first << "\"," << std::endl
+            << ind2 << "\"count\": " << x.second << std::endl;
+      }
+
+      os << ind1 << "}";
+      first_time = false;
+    }
+
+    if (!first_time) {
+      os << std::endl;
+    }
+  }
+
+  os << ind0 << "]," << std::endl
+      << ind0 << "\"expired_discard\": [" << std::endl;
+
+  {
+    TIndent ind1(ind0);
+    bool first_time = true;
+
+    for (auto &x : info.ExpiredDiscardMap) {
+      if (!first_time) {
+        os << "," << std::endl;
+      }
+
+      os << ind1 << "{" << std::endl;
+
+      {
+        TIndent ind2(ind1);
+        os << ind2 << "\"topic\": \"" << x.first << "\"," << std::endl
+            << ind2 << "\"count\": " << x.second << std::endl;
+      }
+
+      os << ind1 << "}";
+      first_time = false;
+    }
+
+    if (!first_time) {
+      os << std::endl;
+    }
+  }
+
   os << ind0 << "]," << std::endl
       << ind0 << "\"discard_topic\": [" << std::endl;
 
@@ -26,10 +26,16 @@
 #include <base/event_semaphore.h>
 #include <base/indent.h>
 #include <base/no_copy_semantics.h>
+#include <capped/pool.h>
 #include <dory/anomaly_tracker.h>
+#include <dory/batch/adaptive_batch_stats.h>
+#include <dory/compression_stats.h>
+#include <dory/conf_generation.h>
 #include <dory/debug/debug_setup.h>
 #include <dory/metadata_timestamp.h>
 #include <dory/msg_state_tracker.h>
+#include <dory/priority_lane_stats.h>
+#include <dory/topic_quota.h>
 
 namespace Dory {
 
@@ -65,6 +71,45 @@ namespace Dory {
     void HandleQueueStatsRequestJson(std::ostream &os,
         const TMsgStateTracker &tracker);
 
+    void HandlePoolStatsRequestPlain(std::ostream &os,
+        const Capped::TPool &pool);
+
+    void HandlePoolStatsRequestJson(std::ostream &os,
+        const Capped::TPool &pool);
+
+    void HandleCompressionStatsRequestPlain(std::ostream &os,
+        const TCompressionStats &stats);
+
+    void HandleCompressionStatsRequestJson(std::ostream &os,
+        const TCompressionStats &stats);
+
+    void HandleConfInfoRequestPlain(std::ostream &os,
+        const TConfGeneration &conf_generation);
+
+    void HandleConfInfoRequestJson(std::ostream &os,
+        const TConfGeneration &conf_generation);
+
+    /* 'topic_quota' is null if topic buffer quotas are disabled. */
+    void HandleTopicQuotaRequestPlain(std::ostream &os,
+        const TTopicQuota *topic_quota);
+
+    void HandleTopicQuotaRequestJson(std::ostream &os,
+        const TTopicQuota *topic_quota);
+
+    /* 'topic_quota' is null if neither topic buffer quotas nor a low priority
+       limit are configured. */
+    void HandlePriorityLanesRequestPlain(std::ostream &os,
+        const TPriorityLaneStats &lane_stats, const TTopicQuota *topic_quota);
+
+    void HandlePriorityLanesRequestJson(std::ostream &os,
+        const TPriorityLaneStats &lane_stats, const TTopicQuota *topic_quota);
+
+    void HandleAdaptiveBatchingRequestPlain(std::ostream &os,
+        const Batch::TAdaptiveBatchStats &stats);
+
+    void HandleAdaptiveBatchingRequestJson(std::ostream &os,
+        const Batch::TAdaptiveBatchStats &stats);
+
     void HandleGetDebugTopicsRequest(std::ostream &os,
         const Debug::TDebugSetup &debug_setup);
 
@@ -86,6 +131,9 @@ namespace Dory {
     void HandleMetadataUpdateRequest(std::ostream &os,
         Base::TEventSemaphore &update_request_sem);
 
+    void HandleConfReloadRequest(std::ostream &os,
+        Base::TEventSemaphore &reload_request_sem);
+
     private:
     void WriteDiscardReportPlain(std::ostream &os,
         const TAnomalyTracker::TInfo &info);
@@ -73,6 +73,22 @@ void TStreamServerBase::Bind() {
   }
 }
 
+void TStreamServerBase::Adopt(TFd &&sock) {
+  assert(this);
+
+  if (IsBound()) {
+    throw std::logic_error(
+        "TStreamServerBase::Adopt() called on bound server");
+  }
+
+  if (!sock.IsOpen()) {
+    throw std::logic_error(
+        "TStreamServerBase::Adopt() requires an open socket");
+  }
+
+  ListeningSocket = std::move(sock);
+}
+
 bool TStreamServerBase::SyncStart() {
   assert(this);
 
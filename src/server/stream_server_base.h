@@ -91,11 +91,21 @@ namespace Server {
 
     void Bind();
 
+    /* Use 'sock', which must already be bound, as the listening socket
+       instead of calling Bind().  This is for a socket received from another
+       process, which may already be listening on it. */
+    void Adopt(Base::TFd &&sock);
+
     bool IsBound() const noexcept {
       assert(this);
       return ListeningSocket.IsOpen();
     }
 
+    const Base::TFd &GetListeningSocket() const noexcept {
+      assert(this);
+      return ListeningSocket;
+    }
+
     /* To start the server, you can call the Start() method of our base class,
        or you can call this method.  The difference is that this method doesn't
        return until the acceptor thread has either successfully called listen()
@@ -143,11 +153,6 @@ namespace Server {
 
     virtual void Run() override;
 
-    const Base::TFd &GetListeningSocket() const noexcept {
-      assert(this);
-      return ListeningSocket;
-    }
-
     private:
     void AcceptClients();
 
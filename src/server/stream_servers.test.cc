@@ -39,6 +39,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <base/error_utils.h>
 #include <base/io_utils.h>
@@ -412,6 +413,49 @@ namespace {
     ASSERT_TRUE(threw);
   }
 
+  TEST_F(TStreamServerTest, UnixStreamAdoptTest) {
+    std::list<TConnectionWorker> workers;
+    TTmpFile tmp_file;
+    tmp_file.SetDeleteOnDestroy(true);
+    TUnixStreamServer server_1(16, tmp_file.GetName(),
+        new TTestServerConnectionHandler(workers),
+        [](const char *) noexcept {
+          ASSERT_TRUE(false);
+        });
+    ASSERT_TRUE(server_1.SyncStart());
+
+    /* Hand the listening socket over to a second server, as if it came from
+       another process. */
+    TUnixStreamServer server_2(16, tmp_file.GetName(),
+        new TTestServerConnectionHandler(workers),
+        [](const char *) noexcept {
+          ASSERT_TRUE(false);
+        });
+    server_2.Adopt(TFd(dup(server_1.GetListeningSocket())));
+    ASSERT_TRUE(server_2.IsBound());
+    ASSERT_TRUE(server_2.SyncStart());
+    server_1.SetUnlinkOnClose(false);
+    server_1.RequestShutdown();
+    server_1.Join();
+
+    {
+      TFd sock = UnixStreamConnect(tmp_file.GetName());
+      int input[2] = { 2, 3 };
+      ASSERT_TRUE(TryWriteExactly(sock, input, sizeof(input)));
+      int output = 0;
+      ASSERT_TRUE(TryReadExactly(sock, &output, sizeof(output), 15000));
+      ASSERT_EQ(output, 5);
+    }
+
+    server_2.RequestShutdown();
+    server_2.Join();
+    ASSERT_NE(access(tmp_file.GetName(), F_OK), 0);
+
+    for (auto &w : workers) {
+      w.Join();
+    }
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -36,7 +36,8 @@ TUnixStreamServer::TUnixStreamServer(int backlog, const char *path,
     : TStreamServerBase(backlog,
           reinterpret_cast<struct sockaddr *>(&ClientAddr), sizeof(ClientAddr),
           connection_handler, fatal_error_handler),
-      Path(path) {
+      Path(path),
+      UnlinkOnClose(true) {
   if (std::strlen(path) >= sizeof(ClientAddr.sun_path)) {
     ThrowSystemError(ENAMETOOLONG);
   }
@@ -48,7 +49,8 @@ TUnixStreamServer::TUnixStreamServer(int backlog, const char *path,
     : TStreamServerBase(backlog,
           reinterpret_cast<struct sockaddr *>(&ClientAddr), sizeof(ClientAddr),
           connection_handler, std::move(fatal_error_handler)),
-      Path(path) {
+      Path(path),
+      UnlinkOnClose(true) {
   if (std::strlen(path) >= sizeof(ClientAddr.sun_path)) {
     ThrowSystemError(ENAMETOOLONG);
   }
@@ -89,7 +91,10 @@ void TUnixStreamServer::InitListeningSocket(TFd &sock) {
 
 void TUnixStreamServer::CloseListeningSocket(TFd &sock) {
   TStreamServerBase::CloseListeningSocket(sock);
-  UnlinkPath();
+
+  if (UnlinkOnClose.load()) {
+    UnlinkPath();
+  }
 }
 
 void TUnixStreamServer::UnlinkPath() {
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <string>
 #include <utility>
@@ -89,6 +90,15 @@ namespace Server {
       Mode.Reset();
     }
 
+    /* Specify whether the socket file is unlinked when the listening socket
+       is closed.  The default is true.  Pass false when another process has
+       taken over the socket, or may still be using it.  Must be called before
+       requesting shutdown. */
+    void SetUnlinkOnClose(bool unlink_on_close) noexcept {
+      assert(this);
+      UnlinkOnClose.store(unlink_on_close);
+    }
+
     protected:
     virtual void InitListeningSocket(Base::TFd &sock) override;
 
@@ -101,6 +111,8 @@ namespace Server {
 
     Base::TOpt<mode_t> Mode;
 
+    std::atomic<bool> UnlinkOnClose;
+
     struct sockaddr_un ClientAddr;
   };  // TUnixStreamServer
 
@@ -0,0 +1,132 @@
+/* <socket/fd_passing.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Implements <socket/fd_passing.h>.
+ */
+
+#include <socket/fd_passing.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <base/error_utils.h>
+
+using namespace Base;
+using namespace Socket;
+
+/* Space for ancillary data carrying the maximum number of file descriptors.
+   The union provides the alignment required for struct cmsghdr. */
+union TFdControlBuf {
+  struct cmsghdr Align;
+
+  char Buf[CMSG_SPACE(MAX_PASSED_FDS * sizeof(int))];
+};  // TFdControlBuf
+
+void Socket::SendFds(int sock, const void *data, size_t size,
+    const std::vector<int> &fds) {
+  assert(size);
+
+  if (fds.size() > MAX_PASSED_FDS) {
+    ThrowSystemError(EMSGSIZE);
+  }
+
+  struct iovec iov;
+  iov.iov_base = const_cast<void *>(data);
+  iov.iov_len = size;
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  TFdControlBuf control;
+
+  if (!fds.empty()) {
+    size_t fds_size = fds.size() * sizeof(int);
+    std::memset(&control, 0, sizeof(control));
+    msg.msg_control = control.Buf;
+    msg.msg_controllen = CMSG_SPACE(fds_size);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(fds_size);
+    std::memcpy(CMSG_DATA(cmsg), &fds[0], fds_size);
+  }
+
+  ssize_t ret;
+
+  do {
+    ret = sendmsg(sock, &msg, MSG_NOSIGNAL);
+  } while ((ret < 0) && (errno == EINTR));
+
+  IfLt0(ret);
+
+  if (static_cast<size_t>(ret) != size) {
+    /* The file descriptors went with the first part of the message, so there
+       is no sensible way to send the rest. */
+    ThrowSystemError(EMSGSIZE);
+  }
+}
+
+size_t Socket::RecvFds(int sock, void *buf, size_t buf_size,
+    std::vector<TFd> &fds) {
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = buf_size;
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  TFdControlBuf control;
+  std::memset(&control, 0, sizeof(control));
+  msg.msg_control = control.Buf;
+  msg.msg_controllen = sizeof(control.Buf);
+  ssize_t ret;
+
+  do {
+    ret = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  } while ((ret < 0) && (errno == EINTR));
+
+  IfLt0(ret);
+
+  /* Take ownership of everything received before checking for errors, so
+     nothing leaks. */
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) &&
+        (cmsg->cmsg_type == SCM_RIGHTS)) {
+      size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const unsigned char *data = CMSG_DATA(cmsg);
+
+      for (size_t i = 0; i < count; ++i) {
+        int fd = -1;
+        std::memcpy(&fd, data + (i * sizeof(int)), sizeof(fd));
+        fds.emplace_back(fd);
+      }
+    }
+  }
+
+  if (msg.msg_flags & MSG_CTRUNC) {
+    ThrowSystemError(EMSGSIZE);
+  }
+
+  return static_cast<size_t>(ret);
+}
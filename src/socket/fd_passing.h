@@ -0,0 +1,51 @@
+/* <socket/fd_passing.h>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Passing file descriptors between processes over UNIX domain sockets.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <base/fd.h>
+
+namespace Socket {
+
+  /* Maximum number of file descriptors passed in a single message. */
+  const size_t MAX_PASSED_FDS = 16;
+
+  /* Send 'size' bytes starting at 'data' over connected UNIX domain socket
+     'sock', with 'fds' attached as SCM_RIGHTS ancillary data.  'size' must be
+     positive, and 'fds' may hold at most MAX_PASSED_FDS items.  The receiver
+     gets duplicates of 'fds', so the caller still owns them.  Throws
+     std::system_error on error. */
+  void SendFds(int sock, const void *data, size_t size,
+      const std::vector<int> &fds);
+
+  /* Receive a message sent by SendFds() into the 'buf_size' bytes starting at
+     'buf', and append any file descriptors that came with it to 'fds'.
+     Returns the number of bytes received, or 0 on end of file.  Received
+     file descriptors have the close-on-exec flag set.  Throws
+     std::system_error on error, including EMSGSIZE if the message carried
+     more than MAX_PASSED_FDS file descriptors. */
+  size_t RecvFds(int sock, void *buf, size_t buf_size,
+      std::vector<Base::TFd> &fds);
+
+}  // Socket
@@ -0,0 +1,101 @@
+/* <socket/fd_passing.test.cc>
+
+   ----------------------------------------------------------------------------
+   Copyright 2017 Dave Peterson <dave@dspeterson.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   ----------------------------------------------------------------------------
+
+   Unit test for <socket/fd_passing.h>.
+ */
+
+#include <socket/fd_passing.h>
+
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <base/fd.h>
+#include <base/io_utils.h>
+
+#include <gtest/gtest.h>
+
+using namespace Base;
+using namespace Socket;
+
+namespace {
+
+  /* The fixture for testing fd passing. */
+  class TFdPassingTest : public ::testing::Test {
+    protected:
+    TFdPassingTest() {
+    }
+
+    virtual ~TFdPassingTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+  };  // TFdPassingTest
+
+  TEST_F(TFdPassingTest, PassFds) {
+    TFd sender, receiver;
+    TFd::SocketPair(sender, receiver, AF_LOCAL, SOCK_STREAM);
+    TFd pipe1_read, pipe1_write, pipe2_read, pipe2_write;
+    TFd::Pipe(pipe1_read, pipe1_write);
+    TFd::Pipe(pipe2_read, pipe2_write);
+    SendFds(sender, "abc", 3, { pipe1_write, pipe2_write });
+
+    /* The sender keeps its copies. */
+    ASSERT_TRUE(pipe1_write.IsOpen());
+    ASSERT_TRUE(pipe2_write.IsOpen());
+    pipe1_write.Reset();
+    pipe2_write.Reset();
+
+    char buf[16];
+    std::vector<TFd> fds;
+    ASSERT_EQ(RecvFds(receiver, buf, sizeof(buf), fds), 3U);
+    ASSERT_EQ(std::memcmp(buf, "abc", 3), 0);
+    ASSERT_EQ(fds.size(), 2U);
+    ASSERT_TRUE(fcntl(fds[0], F_GETFD) & FD_CLOEXEC);
+
+    /* The received fds refer to the pipes, in order. */
+    WriteExactly(fds[0], "1", 1);
+    WriteExactly(fds[1], "2", 1);
+    ASSERT_EQ(ReadAtMost(pipe1_read, buf, sizeof(buf)), 1U);
+    ASSERT_EQ(buf[0], '1');
+    ASSERT_EQ(ReadAtMost(pipe2_read, buf, sizeof(buf)), 1U);
+    ASSERT_EQ(buf[0], '2');
+
+    /* A message without fds, then end of file. */
+    SendFds(sender, "x", 1, std::vector<int>());
+    fds.clear();
+    ASSERT_EQ(RecvFds(receiver, buf, sizeof(buf), fds), 1U);
+    ASSERT_TRUE(fds.empty());
+    sender.Reset();
+    ASSERT_EQ(RecvFds(receiver, buf, sizeof(buf), fds), 0U);
+    ASSERT_TRUE(fds.empty());
+  }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
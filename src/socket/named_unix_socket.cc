@@ -21,6 +21,8 @@
 
 #include <socket/named_unix_socket.h>
 
+#include <utility>
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -43,3 +45,16 @@ void TNamedUnixSocket::Reset() {
     Path.clear();
   }
 }
+
+void TNamedUnixSocket::Adopt(TFd &&fd, const std::string &path) {
+  assert(this);
+  Reset();
+  Fd = std::move(fd);
+  Path = path;
+}
+
+void TNamedUnixSocket::Release() {
+  assert(this);
+  Fd.Reset();
+  Path.clear();
+}
@@ -70,8 +70,18 @@ namespace Socket {
       return Fd.IsOpen();
     }
 
+    /* Close the socket and unlink its file. */
     void Reset();
 
+    /* Close any socket we hold and take ownership of 'fd', which must already
+       be bound to 'path'.  This is for a socket received from another
+       process.  Reset() will unlink 'path' as usual. */
+    void Adopt(Base::TFd &&fd, const std::string &path);
+
+    /* Close the socket without unlinking its file.  This is for when another
+       process has taken over the socket. */
+    void Release();
+
     private:
     Base::TFd Fd;
 
@@ -91,6 +91,30 @@ namespace {
     ASSERT_EQ(ret, -1);
   }
 
+  TEST_F(TNamedUnixSocketTest, AdoptAndRelease) {
+    const char path[] = "/tmp/named_unix_socket_test";
+    TAddress address;
+    address.SetFamily(AF_LOCAL);
+    address.SetPath(path);
+    TNamedUnixSocket sock(SOCK_DGRAM, 0);
+    Bind(sock, address);
+
+    /* Hand the socket over as if it came from another process. */
+    TNamedUnixSocket sock2(SOCK_DGRAM, 0);
+    sock2.Adopt(Base::TFd(dup(sock.GetFd())), path);
+    ASSERT_TRUE(sock2.IsBound());
+    ASSERT_EQ(sock2.GetPath(), path);
+    sock.Release();
+    ASSERT_FALSE(sock.IsOpen());
+    ASSERT_FALSE(sock.IsBound());
+    struct stat buf;
+    int ret = stat(path, &buf);
+    ASSERT_EQ(ret, 0);
+    sock2.Reset();
+    ret = stat(path, &buf);
+    ASSERT_EQ(ret, -1);
+  }
+
 }  // namespace
 
 int main(int argc, char **argv) {